@@ -0,0 +1,114 @@
+#include "block_cache.h"
+#include <cstring>
+
+BlockCache::BlockCache(u32 block_size, u32 capacity, u32 threads, BlockLoader loader, void* user)
+    : size_of_block(block_size), capacity(capacity), loader(loader), user(user), stop(false), hit_count(0), miss_count(0) {
+    for (u32 i = 0; i < threads; i++) {
+        this->threads.emplace_back(&BlockCache::run_prefetch, this);
+    }
+}
+
+BlockCache::~BlockCache() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+u64 BlockCache::hits() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return hit_count;
+}
+
+u64 BlockCache::misses() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return miss_count;
+}
+
+bool BlockCache::read(u32 block, u32 offset, u32 size, u8* out) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto it = entries.find(block);
+    if (it != entries.end()) {
+        Entry& entry = it->second;
+        entry.waiters++;
+        done.wait(lock, [&entry] { return !entry.loading; });
+        entry.waiters--;
+        hit_count++;
+        lru.splice(lru.begin(), lru, entry.lru);
+        if (entry.ok) {
+            std::memcpy(out, entry.data.data() + offset, size);
+        }
+        return entry.ok;
+    }
+
+    miss_count++;
+    Entry& entry = insert(block);
+    lock.unlock();
+    const bool ok = loader(user, block, entry.data.data());
+    lock.lock();
+    loaded(entry, ok);
+    if (ok) {
+        std::memcpy(out, entry.data.data() + offset, size);
+    }
+    return ok;
+}
+
+void BlockCache::prefetch(u32 block) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (threads.empty() || entries.count(block) || queue.size() >= capacity / 2) {
+            return;
+        }
+        queue.push_back(block);
+    }
+    wake.notify_one();
+}
+
+// Adds a loading entry for `block`, evicting the least recently used blocks nobody is
+// loading or waiting for. Mutex held. Entries never move, so a loader fills one unlocked.
+BlockCache::Entry& BlockCache::insert(u32 block) {
+    for (auto victim = lru.end(); entries.size() >= capacity && victim != lru.begin();) {
+        --victim;
+        const auto it = entries.find(*victim);
+        if (!it->second.loading && it->second.waiters == 0) {
+            entries.erase(it);
+            victim = lru.erase(victim);
+        }
+    }
+    Entry& entry = entries[block];
+    entry.data.resize(size_of_block);
+    lru.push_front(block);
+    entry.lru = lru.begin();
+    return entry;
+}
+
+// Mutex held.
+void BlockCache::loaded(Entry& entry, bool ok) {
+    entry.loading = false;
+    entry.ok = ok;
+    done.notify_all();
+}
+
+void BlockCache::run_prefetch() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stop || !queue.empty(); });
+        if (stop) {
+            return;
+        }
+        const u32 block = queue.front();
+        queue.pop_front();
+        if (entries.count(block)) {
+            continue;
+        }
+        Entry& entry = insert(block);
+        lock.unlock();
+        const bool ok = loader(user, block, entry.data.data());
+        lock.lock();
+        loaded(entry, ok);
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// Loads block `block` into `out` (block_size bytes). Called on the reading thread or on
+// a prefetch thread, possibly on several threads at once for different blocks.
+using BlockLoader = bool (*)(void* user, u32 block, u8* out);
+
+/**
+ * @brief LRU cache of the fixed-size blocks of a disc image that cannot be mapped, with
+ * prefetch threads that load the blocks a sequential reader will want next. A read that
+ * finds its block still on its way waits for it instead of loading it twice.
+ */
+class BlockCache {
+public:
+    BlockCache(u32 block_size, u32 capacity, u32 threads, BlockLoader loader, void* user);
+    ~BlockCache();
+
+    BlockCache(const BlockCache&) = delete;
+    BlockCache& operator=(const BlockCache&) = delete;
+
+    /**
+     * @brief Copies `size` bytes at `offset` in `block` to `out`, loading the block on the
+     * calling thread if nobody has.
+     * @return false if the block could not be loaded.
+     */
+    bool read(u32 block, u32 offset, u32 size, u8* out);
+
+    // Queues `block` for the prefetch threads unless it is cached or on its way. Never
+    // blocks; requests beyond what the cache could hold are dropped.
+    void prefetch(u32 block);
+
+    u32 block_size() const { return size_of_block; }
+
+    // Reads that found their block cached (or being prefetched), and that did not.
+    u64 hits() const;
+    u64 misses() const;
+
+private:
+    struct Entry {
+        std::vector<u8> data;
+        bool loading = true;
+        bool ok = false;
+        u32 waiters = 0;        // Readers waiting for it to load
+        std::list<u32>::iterator lru;
+    };
+
+    Entry& insert(u32 block);
+    void loaded(Entry& entry, bool ok);
+    void run_prefetch();
+
+    const u32 size_of_block;
+    const u32 capacity;
+    const BlockLoader loader;
+    void* const user;
+
+    mutable std::mutex mutex;
+    std::condition_variable done;       // A block finished loading
+    std::condition_variable wake;       // Work for the prefetch threads
+    std::unordered_map<u32, Entry> entries;
+    std::list<u32> lru;                 // Most recently used first
+    std::deque<u32> queue;
+    std::vector<std::thread> threads;
+    bool stop;
+    u64 hit_count;
+    u64 miss_count;
+};
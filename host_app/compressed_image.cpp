@@ -0,0 +1,327 @@
+#include "compressed_image.h"
+#include "lz.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+namespace compressed_image {
+
+namespace {
+
+constexpr u32 SECTOR_SIZE = 2048;
+
+// Blocks read and compressed together per thread, between the serial dedup-and-write steps.
+constexpr u32 BATCH_PER_THREAD = 4;
+
+u32 get32(const u8* data, u32 offset) {
+    u32 value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+u64 get64(const u8* data, u32 offset) {
+    u64 value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+void put32(u8* data, u32 offset, u32 value) {
+    std::memcpy(data + offset, &value, sizeof(value));
+}
+
+void put64(u8* data, u32 offset, u64 value) {
+    std::memcpy(data + offset, &value, sizeof(value));
+}
+
+// Reads up to `size` bytes at `offset`, fewer only at the end of the file; -1 on error.
+ssize_t read_at(int fd, u8* out, size_t size, u64 offset) {
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t got = pread(fd, out + done, size - done, (off_t)(offset + done));
+        if (got < 0) {
+            return -1;
+        }
+        if (got == 0) {
+            break;
+        }
+        done += (size_t)got;
+    }
+    return (ssize_t)done;
+}
+
+bool write_at(int fd, const u8* data, size_t size, u64 offset) {
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t put = pwrite(fd, data + done, size - done, (off_t)(offset + done));
+        if (put <= 0) {
+            return false;
+        }
+        done += (size_t)put;
+    }
+    return true;
+}
+
+u64 fnv1a(const u8* data, size_t size) {
+    u64 hash = 0xCBF29CE484222325ull;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+bool valid_block_size(u32 block_size) {
+    return block_size != 0 && block_size % SECTOR_SIZE == 0 && block_size <= MAX_BLOCK_SIZE;
+}
+
+// A block on its way through compress().
+struct Slot {
+    std::vector<u8> raw;
+    std::vector<u8> packed;
+    size_t packed_size = 0;
+    BlockKind kind = BlockKind::Zero;
+
+    const u8* stored() const { return kind == BlockKind::Lz ? packed.data() : raw.data(); }
+    size_t stored_size() const { return kind == BlockKind::Lz ? packed_size : raw.size(); }
+};
+
+// Only worth keeping if it is smaller than the block.
+void pack(Slot& slot) {
+    const size_t size = slot.raw.size();
+    if (slot.raw[0] == 0 && std::memcmp(slot.raw.data(), slot.raw.data() + 1, size - 1) == 0) {
+        slot.kind = BlockKind::Zero;
+        return;
+    }
+    slot.packed.resize(lz_bound(size));
+    slot.packed_size = lz_compress(slot.raw.data(), size, slot.packed.data(), size - 1);
+    slot.kind = slot.packed_size ? BlockKind::Lz : BlockKind::Raw;
+}
+
+class Compressor {
+public:
+    Compressor(int in, int out, u64 image_size, u32 block_size, u32 count, u32 threads)
+        : in(in), out(out), image_size(image_size), block_size(block_size), count(count), threads(threads),
+          data_end(HEADER_SIZE + (u64)count * ENTRY_SIZE) {
+        blocks.reserve(count);
+    }
+
+    bool run(CompressStats& stats) {
+        std::vector<Slot> slots(threads * BATCH_PER_THREAD);
+        for (Slot& slot : slots) {
+            slot.raw.resize(block_size);
+        }
+        for (u32 first = 0; first < count; first += (u32)slots.size()) {
+            const u32 n = std::min((u32)slots.size(), count - first);
+            for (u32 i = 0; i < n; i++) {
+                const ssize_t got = read_at(in, slots[i].raw.data(), block_size, (u64)(first + i) * block_size);
+                if (got < 0) {
+                    return false;
+                }
+                std::memset(slots[i].raw.data() + got, 0, block_size - (size_t)got);
+            }
+            pack_all(slots, n);
+            for (u32 i = 0; i < n; i++) {
+                if (!store(slots[i], stats)) {
+                    return false;
+                }
+            }
+        }
+        stats.blocks = count;
+        stats.file_size = data_end;
+        return write_index();
+    }
+
+private:
+    void pack_all(std::vector<Slot>& slots, u32 n) {
+        const u32 stride = std::min(threads, n);
+        auto work = [&slots, n, stride](u32 first) {
+            for (u32 i = first; i < n; i += stride) {
+                pack(slots[i]);
+            }
+        };
+        std::vector<std::thread> workers;
+        for (u32 t = 1; t < stride; t++) {
+            workers.emplace_back(work, t);
+        }
+        work(0);
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // Appends the block, or points it at an earlier copy of the same data.
+    bool store(const Slot& slot, CompressStats& stats) {
+        if (slot.kind == BlockKind::Zero) {
+            blocks.push_back(Block{ 0, 0, BlockKind::Zero });
+            stats.zero_blocks++;
+            return true;
+        }
+        const u8* data = slot.stored();
+        const size_t size = slot.stored_size();
+        const u64 hash = fnv1a(data, size);
+        for (auto [it, end] = seen.equal_range(hash); it != end; ++it) {
+            const Block earlier = blocks[it->second];
+            if (earlier.kind == slot.kind && earlier.size == size && same_as_stored(earlier, data)) {
+                blocks.push_back(earlier);
+                stats.duplicate_blocks++;
+                return true;
+            }
+        }
+        if (!write_at(out, data, size, data_end)) {
+            return false;
+        }
+        seen.emplace(hash, (u32)blocks.size());
+        blocks.push_back(Block{ data_end, (u32)size, slot.kind });
+        data_end += size;
+        stats.raw_blocks += slot.kind == BlockKind::Raw;
+        return true;
+    }
+
+    bool same_as_stored(const Block& block, const u8* data) {
+        scratch.resize(block.size);
+        return read_at(out, scratch.data(), block.size, block.offset) == (ssize_t)block.size &&
+               std::memcmp(scratch.data(), data, block.size) == 0;
+    }
+
+    // The header goes last, so an interrupted conversion is never mistaken for an image.
+    bool write_index() {
+        std::vector<u8> table((size_t)count * ENTRY_SIZE);
+        for (u32 i = 0; i < count; i++) {
+            u8* entry = table.data() + (size_t)i * ENTRY_SIZE;
+            put64(entry, ENTRY_OFFSET, blocks[i].offset);
+            put32(entry, ENTRY_STORED_SIZE, blocks[i].size);
+            put32(entry, ENTRY_KIND, (u32)blocks[i].kind);
+        }
+        if (!write_at(out, table.data(), table.size(), HEADER_SIZE)) {
+            return false;
+        }
+        u8 header[HEADER_SIZE] = {};
+        std::memcpy(header + HEADER_MAGIC, MAGIC, sizeof(MAGIC));
+        put32(header, HEADER_VERSION, VERSION);
+        put32(header, HEADER_BLOCK_SIZE, block_size);
+        put32(header, HEADER_BLOCK_COUNT, count);
+        put64(header, HEADER_IMAGE_SIZE, image_size);
+        return write_at(out, header, HEADER_SIZE, 0);
+    }
+
+    const int in;
+    const int out;
+    const u64 image_size;
+    const u32 block_size;
+    const u32 count;
+    const u32 threads;
+    u64 data_end;
+    std::vector<Block> blocks;
+    std::unordered_multimap<u64, u32> seen;     // Stored data hash -> first block with it
+    std::vector<u8> scratch;
+};
+
+} // namespace
+
+bool is_compressed(int fd) {
+    u8 magic[sizeof(MAGIC)];
+    return read_at(fd, magic, sizeof(magic), 0) == (ssize_t)sizeof(magic) &&
+           std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+bool read_index(int fd, Index& index) {
+    u8 header[HEADER_SIZE];
+    struct stat info;
+    if (read_at(fd, header, HEADER_SIZE, 0) != (ssize_t)HEADER_SIZE || fstat(fd, &info) != 0 ||
+        std::memcmp(header + HEADER_MAGIC, MAGIC, sizeof(MAGIC)) != 0 || get32(header, HEADER_VERSION) != VERSION) {
+        return false;
+    }
+    const u32 block_size = get32(header, HEADER_BLOCK_SIZE);
+    const u32 count = get32(header, HEADER_BLOCK_COUNT);
+    const u64 image_size = get64(header, HEADER_IMAGE_SIZE);
+    const u64 file_size = (u64)info.st_size;
+    const u64 data_start = HEADER_SIZE + (u64)count * ENTRY_SIZE;
+    if (!valid_block_size(block_size) || (image_size + block_size - 1) / block_size != count || data_start > file_size) {
+        return false;
+    }
+
+    std::vector<u8> table((size_t)count * ENTRY_SIZE);
+    if (read_at(fd, table.data(), table.size(), HEADER_SIZE) != (ssize_t)table.size()) {
+        return false;
+    }
+    std::vector<Block> blocks(count);
+    for (u32 i = 0; i < count; i++) {
+        const u8* entry = table.data() + (size_t)i * ENTRY_SIZE;
+        Block& block = blocks[i];
+        block.offset = get64(entry, ENTRY_OFFSET);
+        block.size = get32(entry, ENTRY_STORED_SIZE);
+        block.kind = (BlockKind)get32(entry, ENTRY_KIND);
+        bool ok;
+        switch (block.kind) {
+        case BlockKind::Zero: ok = block.size == 0; break;
+        case BlockKind::Lz: ok = block.size > 0 && block.size < block_size; break;
+        case BlockKind::Raw: ok = block.size == block_size; break;
+        default: ok = false; break;
+        }
+        const bool inside = block.offset >= data_start && block.offset <= file_size && block.size <= file_size - block.offset;
+        if (!ok || (block.size && !inside)) {
+            return false;
+        }
+    }
+    index.block_size = block_size;
+    index.image_size = image_size;
+    index.blocks = std::move(blocks);
+    return true;
+}
+
+bool read_block(int fd, const Index& index, u32 block, u8* out) {
+    if (block >= index.blocks.size()) {
+        return false;
+    }
+    const Block& entry = index.blocks[block];
+    switch (entry.kind) {
+    case BlockKind::Zero:
+        std::memset(out, 0, index.block_size);
+        return true;
+    case BlockKind::Raw:
+        return read_at(fd, out, entry.size, entry.offset) == (ssize_t)entry.size;
+    case BlockKind::Lz: {
+        thread_local std::vector<u8> packed;
+        packed.resize(entry.size);
+        return read_at(fd, packed.data(), entry.size, entry.offset) == (ssize_t)entry.size &&
+               lz_decompress(packed.data(), entry.size, out, index.block_size);
+    }
+    }
+    return false;
+}
+
+bool compress(const std::string& input, const std::string& output, u32 block_size, u32 threads, CompressStats* stats) {
+    if (!valid_block_size(block_size)) {
+        return false;
+    }
+    const int in = ::open(input.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0) {
+        return false;
+    }
+    struct stat info;
+    const u64 count = fstat(in, &info) == 0 ? ((u64)info.st_size + block_size - 1) / block_size : ~0ull;
+    const int out = count <= 0xFFFFFFFFull ? ::open(output.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) : -1;
+    if (out < 0) {
+        ::close(in);
+        return false;
+    }
+
+    CompressStats local;
+    local.image_size = (u64)info.st_size;
+    Compressor compressor(in, out, local.image_size, block_size, (u32)count, std::max(threads, 1u));
+    const bool ok = compressor.run(local);
+    ::close(in);
+    if (::close(out) != 0 || !ok) {
+        unlink(output.c_str());
+        return false;
+    }
+    if (stats) {
+        *stats = local;
+    }
+    return true;
+}
+
+} // namespace compressed_image
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <string>
+#include <vector>
+
+// Block-compressed disc images. The image is cut into fixed-size blocks and each is
+// compressed on its own with the codec in lz.h, so any block can be read without the ones
+// before it:
+//
+//   header      HEADER_SIZE bytes, fields below
+//   index       one ENTRY_SIZE entry per block: where its data is, how big, and what kind
+//   data        the stored blocks
+//
+// All-zero blocks store nothing, and a block identical to an earlier one points at that
+// block's data, so padding and repeated files cost only their index entry. A block that
+// does not compress is stored as is. The last block is padded with zeros to a full block.
+// Little-endian throughout. DiscImage (disc_image.h) reads these like a plain .iso; the
+// compress_disc tool writes them.
+
+namespace compressed_image {
+    constexpr char MAGIC[4] = { 'P', 'S', '2', 'Z' };
+    constexpr u32 VERSION = 1;
+    constexpr u32 DEFAULT_BLOCK_SIZE = 64 * 1024;
+    constexpr u32 MAX_BLOCK_SIZE = 16 * 1024 * 1024;
+
+    constexpr u32 HEADER_SIZE = 32;
+    constexpr u32 HEADER_MAGIC = 0;
+    constexpr u32 HEADER_VERSION = 4;
+    constexpr u32 HEADER_BLOCK_SIZE = 8;
+    constexpr u32 HEADER_BLOCK_COUNT = 12;
+    constexpr u32 HEADER_IMAGE_SIZE = 16;       // u64, bytes of the original image
+
+    constexpr u32 ENTRY_SIZE = 16;
+    constexpr u32 ENTRY_OFFSET = 0;             // u64, from the start of the file
+    constexpr u32 ENTRY_STORED_SIZE = 8;
+    constexpr u32 ENTRY_KIND = 12;
+
+    enum class BlockKind : u32 {
+        Zero,       // Nothing stored
+        Lz,         // lz_compress()ed
+        Raw,        // Stored as is
+    };
+
+    struct Block {
+        u64 offset;
+        u32 size;
+        BlockKind kind;
+    };
+
+    struct Index {
+        u32 block_size = 0;
+        u64 image_size = 0;
+        std::vector<Block> blocks;
+    };
+
+    struct CompressStats {
+        u32 blocks = 0;
+        u32 zero_blocks = 0;
+        u32 duplicate_blocks = 0;
+        u32 raw_blocks = 0;
+        u64 image_size = 0;
+        u64 file_size = 0;
+    };
+
+    // Whether the file starts with MAGIC.
+    bool is_compressed(int fd);
+
+    /**
+     * @brief Reads and checks the header and index of an open compressed image.
+     * @return false if it is not one, or an entry points outside the file.
+     */
+    bool read_index(int fd, Index& index);
+
+    /**
+     * @brief Decompresses block `block` into `out` (index.block_size bytes). Safe to call
+     * from several threads at once.
+     * @return false if the read fails or the block data is corrupt.
+     */
+    bool read_block(int fd, const Index& index, u32 block, u8* out);
+
+    /**
+     * @brief Converts the raw image at `input` into a compressed image at `output`,
+     * compressing `threads` blocks at a time.
+     * @param block_size A multiple of 2048 (one sector), at most MAX_BLOCK_SIZE.
+     * @return false on an I/O error or a bad block size; no output is left behind then.
+     */
+    bool compress(const std::string& input, const std::string& output, u32 block_size, u32 threads,
+                  CompressStats* stats = nullptr);
+}
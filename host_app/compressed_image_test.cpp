@@ -0,0 +1,198 @@
+#include "gtest/gtest.h"
+#include "compressed_image.h"
+#include "disc_image.h"
+#include "lz.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr u32 SECTOR = DiscImage::SECTOR_SIZE;
+constexpr u32 BLOCK = 4 * SECTOR;
+
+// Sectors of the test image, by what is in them.
+constexpr u32 TEXT_LSN = 20;            // Through 35: compressible
+constexpr u32 NOISE_LSN = 36;           // Through 43: incompressible
+constexpr u32 COPY_LSN = 44;            // Through 47: the block at TEXT_LSN again
+constexpr u32 IMAGE_SECTORS = 50;       // Ends halfway through a block
+
+std::vector<u8> noise(size_t size, u32 seed) {
+    std::vector<u8> data(size);
+    for (u8& byte : data) {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        byte = (u8)seed;
+    }
+    return data;
+}
+
+std::vector<u8> text(size_t size) {
+    static const char words[] = "the quick brown fox jumps over the lazy dog while the cat sleeps ";
+    std::vector<u8> data(size);
+    for (size_t i = 0; i < size; i++) {
+        data[i] = (u8)words[(i * 7 + i / 61) % (sizeof(words) - 1)];
+    }
+    return data;
+}
+
+std::string temp_path() {
+    char path[] = "/tmp/compressed_image_testXXXXXX";
+    const int fd = mkstemp(path);
+    EXPECT_GE(fd, 0);
+    close(fd);
+    return path;
+}
+
+std::vector<u8> round_trip(const std::vector<u8>& data) {
+    std::vector<u8> packed(lz_bound(data.size()));
+    const size_t size = lz_compress(data.data(), data.size(), packed.data(), packed.size());
+    EXPECT_GT(size, 0u);
+    std::vector<u8> out(data.size());
+    EXPECT_TRUE(lz_decompress(packed.data(), size, out.data(), out.size()));
+    return out;
+}
+
+class CompressedImageTest : public ::testing::Test {
+protected:
+    CompressedImageTest() : raw_path(temp_path()), packed_path(temp_path()) {
+        raw.resize(IMAGE_SECTORS * SECTOR);
+        raw[16 * SECTOR] = 1;
+        std::memcpy(&raw[16 * SECTOR + 1], "CD001", 5);
+        const std::vector<u8> words = text((NOISE_LSN - TEXT_LSN) * SECTOR);
+        std::memcpy(&raw[TEXT_LSN * SECTOR], words.data(), words.size());
+        const std::vector<u8> random = noise((COPY_LSN - NOISE_LSN) * SECTOR, 0x1234567);
+        std::memcpy(&raw[NOISE_LSN * SECTOR], random.data(), random.size());
+        std::memcpy(&raw[COPY_LSN * SECTOR], &raw[TEXT_LSN * SECTOR], BLOCK);
+        std::memset(&raw[(IMAGE_SECTORS - 2) * SECTOR], 0xEE, 2 * SECTOR);
+
+        FILE* file = std::fopen(raw_path.c_str(), "wb");
+        EXPECT_EQ(std::fwrite(raw.data(), 1, raw.size(), file), raw.size());
+        std::fclose(file);
+    }
+    ~CompressedImageTest() override {
+        std::remove(raw_path.c_str());
+        std::remove(packed_path.c_str());
+    }
+
+    std::string raw_path;
+    std::string packed_path;
+    std::vector<u8> raw;
+};
+
+} // namespace
+
+TEST(LzTest, RoundTripsAssortedData) {
+    const std::vector<u8> runs(5000, 0x41);
+    const std::vector<u8> words = text(64 * 1024);
+    const std::vector<u8> random = noise(64 * 1024, 99);
+    EXPECT_EQ(round_trip({}), std::vector<u8>{});
+    EXPECT_EQ(round_trip({ 1, 2, 3 }), (std::vector<u8>{ 1, 2, 3 }));
+    EXPECT_EQ(round_trip(runs), runs);
+    EXPECT_EQ(round_trip(words), words);
+    EXPECT_EQ(round_trip(random), random);
+}
+
+TEST(LzTest, CompressesRepetitiveData) {
+    const std::vector<u8> words = text(64 * 1024);
+    std::vector<u8> packed(lz_bound(words.size()));
+    const size_t size = lz_compress(words.data(), words.size(), packed.data(), packed.size());
+    EXPECT_GT(size, 0u);
+    EXPECT_LT(size, words.size() / 4);
+}
+
+TEST(LzTest, GivesUpWhenTheOutputIsTooSmall) {
+    const std::vector<u8> random = noise(4096, 7);
+    std::vector<u8> packed(lz_bound(random.size()));
+    EXPECT_EQ(lz_compress(random.data(), random.size(), packed.data(), random.size() - 1), 0u);
+}
+
+TEST(LzTest, RejectsCorruptInput) {
+    // 1. Arrange
+    const std::vector<u8> words = text(4096);
+    std::vector<u8> packed(lz_bound(words.size()));
+    const size_t size = lz_compress(words.data(), words.size(), packed.data(), packed.size());
+    std::vector<u8> out(words.size());
+
+    // 2. Act / 3. Assert: truncated, the wrong size, and a match before the start.
+    EXPECT_FALSE(lz_decompress(packed.data(), size - 1, out.data(), out.size()));
+    EXPECT_FALSE(lz_decompress(packed.data(), size, out.data(), out.size() - 1));
+    const u8 before_start[] = { 0x14, 'a', 0x05, 0x00, 0x00 };
+    EXPECT_FALSE(lz_decompress(before_start, sizeof(before_start), out.data(), 9));
+    const u8 zero_offset[] = { 0x14, 'a', 0x00, 0x00, 0x00 };
+    EXPECT_FALSE(lz_decompress(zero_offset, sizeof(zero_offset), out.data(), 9));
+}
+
+TEST_F(CompressedImageTest, ZeroAndRepeatedBlocksAreStoredOnce) {
+    // 1. Act
+    compressed_image::CompressStats stats;
+    ASSERT_TRUE(compressed_image::compress(raw_path, packed_path, BLOCK, 3, &stats));
+
+    // 2. Assert: blocks 0-3 are the zeros before the PVD, block 11 repeats block 5, and
+    // the two blocks of noise do not compress.
+    EXPECT_EQ(stats.blocks, (IMAGE_SECTORS + 3) / 4);
+    EXPECT_EQ(stats.zero_blocks, 4u);
+    EXPECT_EQ(stats.duplicate_blocks, 1u);
+    EXPECT_EQ(stats.raw_blocks, 2u);
+    EXPECT_EQ(stats.image_size, raw.size());
+    EXPECT_LT(stats.file_size, raw.size());
+}
+
+TEST_F(CompressedImageTest, ReadsLikeTheOriginal) {
+    // 1. Arrange
+    ASSERT_TRUE(compressed_image::compress(raw_path, packed_path, BLOCK, 2));
+    DiscImage disc;
+    ASSERT_TRUE(disc.open(packed_path));
+
+    // 2. Act: a sequential pass, which reads ahead, then a few seeks.
+    std::vector<u8> sector(SECTOR);
+    bool same = true;
+    for (u32 lsn = 0; lsn < IMAGE_SECTORS; lsn++) {
+        ASSERT_TRUE(disc.read(lsn, 1, sector.data()));
+        same = same && std::memcmp(sector.data(), &raw[lsn * SECTOR], SECTOR) == 0;
+    }
+    std::vector<u8> run(6 * SECTOR);
+    for (u32 lsn : { 45u, 3u, 33u }) {
+        ASSERT_TRUE(disc.read(lsn, 5, run.data()));
+        same = same && std::memcmp(run.data(), &raw[lsn * SECTOR], 5 * SECTOR) == 0;
+    }
+
+    // 3. Assert
+    EXPECT_TRUE(disc.is_compressed());
+    EXPECT_FALSE(disc.is_mapped());
+    EXPECT_EQ(disc.sector_count(), IMAGE_SECTORS);
+    EXPECT_EQ(disc.cache()->block_size(), BLOCK);
+    EXPECT_TRUE(same);
+    EXPECT_FALSE(disc.read(IMAGE_SECTORS - 1, 2, run.data()));
+}
+
+TEST_F(CompressedImageTest, CorruptIndexIsRejected) {
+    // 1. Arrange: point the first stored block past the end of the file.
+    ASSERT_TRUE(compressed_image::compress(raw_path, packed_path, BLOCK, 1));
+    const int fd = open(packed_path.c_str(), O_RDWR);
+    ASSERT_GE(fd, 0);
+    compressed_image::Index index;
+    ASSERT_TRUE(compressed_image::read_index(fd, index));
+    const u64 past_end = 1ull << 40;
+    const u32 entry = compressed_image::HEADER_SIZE + compressed_image::ENTRY_SIZE * 4;
+    ASSERT_EQ(index.blocks[4].kind, compressed_image::BlockKind::Lz);
+    ASSERT_EQ(pwrite(fd, &past_end, sizeof(past_end), entry + compressed_image::ENTRY_OFFSET), 8);
+
+    // 2. Act / 3. Assert
+    EXPECT_FALSE(compressed_image::read_index(fd, index));
+    close(fd);
+    DiscImage disc;
+    EXPECT_FALSE(disc.open(packed_path));
+}
+
+TEST_F(CompressedImageTest, BadBlockSizesAreRefused) {
+    std::remove(packed_path.c_str());
+    EXPECT_FALSE(compressed_image::compress(raw_path, packed_path, 1000, 1));
+    EXPECT_FALSE(compressed_image::compress(raw_path, packed_path, 0, 1));
+    EXPECT_NE(access(packed_path.c_str(), F_OK), 0);
+}
@@ -0,0 +1,79 @@
+#include <benchmark/benchmark.h>
+#include "memory.h"
+
+// Compares the two ways generated code can reach the EE state: a global `context` (the
+// original form) and an `EmotionEngineState* __restrict ctx` passed down every call
+// (what recompiler_tool emits now). Both run the same chain of blocks, shaped like the
+// output for a word copy loop: load, add, store, bump both pointers, charge cycles.
+
+EmotionEngineState bench_context;
+
+namespace {
+
+constexpr u32 SRC = 0x00100000;
+constexpr u32 DST = 0x00180000;
+
+[[gnu::noinline]] void event_test() {
+    benchmark::ClobberMemory();
+}
+
+#define COPY_BLOCK(S) \
+    S cpuRegs.GPR.r[8].SD[0] = (s32)ReadMemory32((u32)S cpuRegs.GPR.r[4].UD[0]); \
+    S cpuRegs.GPR.r[9].SD[0] = (s64)(s32)(S cpuRegs.GPR.r[8].UD[0] + 1); \
+    WriteMemory32((u32)S cpuRegs.GPR.r[5].UD[0], (u32)S cpuRegs.GPR.r[9].UD[0]); \
+    S cpuRegs.GPR.r[4].SD[0] = (s64)(s32)(S cpuRegs.GPR.r[4].UD[0] + 4); \
+    S cpuRegs.GPR.r[5].SD[0] = (s64)(s32)(S cpuRegs.GPR.r[5].UD[0] + 4); \
+    S cpuRegs.GPR.r[6].SD[0] = (s64)(s32)(S cpuRegs.GPR.r[6].UD[0] - 1); \
+    S cpuRegs.cycle += 6; \
+    if ((s32)(S cpuRegs.cycle - S cpuRegs.nextEventCycle) >= 0) event_test();
+
+// --- Global form ---
+
+[[gnu::noinline]] void global_block_3() { COPY_BLOCK(bench_context.) }
+[[gnu::noinline]] void global_block_2() { COPY_BLOCK(bench_context.) global_block_3(); }
+[[gnu::noinline]] void global_block_1() { COPY_BLOCK(bench_context.) global_block_2(); }
+[[gnu::noinline]] void global_block_0() { COPY_BLOCK(bench_context.) global_block_1(); }
+
+// --- Context pointer form ---
+
+[[gnu::noinline]] void ctx_block_3(EmotionEngineState* __restrict ctx) { COPY_BLOCK(ctx->) }
+[[gnu::noinline]] void ctx_block_2(EmotionEngineState* __restrict ctx) { COPY_BLOCK(ctx->) ctx_block_3(ctx); }
+[[gnu::noinline]] void ctx_block_1(EmotionEngineState* __restrict ctx) { COPY_BLOCK(ctx->) ctx_block_2(ctx); }
+[[gnu::noinline]] void ctx_block_0(EmotionEngineState* __restrict ctx) { COPY_BLOCK(ctx->) ctx_block_1(ctx); }
+
+#undef COPY_BLOCK
+
+// Each iteration copies four words; pointers wrap within 64 KB.
+void reset(EmotionEngineState& state, u32 offset) {
+    state.cpuRegs.GPR.r[4].UD[0] = SRC + offset;
+    state.cpuRegs.GPR.r[5].UD[0] = DST + offset;
+    state.cpuRegs.nextEventCycle = 0x7FFFFFFF;
+    state.cpuRegs.cycle = 0;
+}
+
+void BM_Blocks_GlobalContext(benchmark::State& state) {
+    fastmem_init();
+    u32 offset = 0;
+    for (auto _ : state) {
+        reset(bench_context, offset);
+        global_block_0();
+        offset = (offset + 16) & 0xFFFF;
+    }
+    state.SetItemsProcessed(state.iterations() * 4);
+}
+
+void BM_Blocks_ContextPointer(benchmark::State& state) {
+    fastmem_init();
+    u32 offset = 0;
+    for (auto _ : state) {
+        reset(bench_context, offset);
+        ctx_block_0(&bench_context);
+        offset = (offset + 16) & 0xFFFF;
+    }
+    state.SetItemsProcessed(state.iterations() * 4);
+}
+
+} // namespace
+
+BENCHMARK(BM_Blocks_GlobalContext);
+BENCHMARK(BM_Blocks_ContextPointer);
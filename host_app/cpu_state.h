@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
 
 // Basic type definitions from PCSX2's Pcsx2Defs.h
@@ -13,15 +14,16 @@ using s16 = int16_t;
 using s32 = int32_t;
 using s64 = int64_t;
 
-// Basic vector types that GPRs can be viewed as.
-union u128 {
+// Basic vector types that GPRs can be viewed as. 16-byte aligned so whole-register
+// copies are single aligned SSE moves.
+union alignas(16) u128 {
     u64 UD[2];
     u32 UL[4];
     u16 US[8];
     u8 UC[16];
 };
 
-union s128 {
+union alignas(16) s128 {
     s64 SD[2];
     s32 SL[4];
     s16 SS[8];
@@ -65,7 +67,7 @@ union PERFregs {
 };
 
 // Represents a single 128-bit General Purpose Register (GPR).
-union GPR_reg {
+union alignas(16) GPR_reg {
     u128 UQ;
     s128 SQ;
     u64 UD[2];
@@ -126,29 +128,35 @@ union CP0regs {
 	u32 r[32];
 };
 // A container for the core CPU registers.
-struct cpuRegisters {
+//
+// Laid out by how often recompiled code touches each field: the GPRs and the scalars
+// every block reads or writes (cycle, nextEventCycle, pc) fill the first nine 64-byte
+// lines, and everything else (COP0, perf counters, bookkeeping) sits in a cold section
+// after them. The offsets generated code depends on are checked below.
+struct alignas(64) cpuRegisters {
+	// --- Hot: touched by (nearly) every block ---
 	GPRregs GPR;		// GPR regs
-	// NOTE: don't change order since recompiler uses it
 	GPR_reg HI;
 	GPR_reg LO;			// hi & log 128bit wide
-	CP0regs CP0;		// is COP0 32bit?
-	u32 sa;				// shift amount (32bit), needs to be 16 byte aligned
+	u32 cycle;			// calculate cpucycles..
+	// if cpuRegs.cycle is greater than this cycle, should check cpu_event_test for updates (see scheduler.h)
+	u32 nextEventCycle;
+	u32 pc;				// Program counter
+	u32 sa;				// shift amount (32bit)
+	u32 interrupt;
 	u32 IsDelaySlot;	// set true when the current instruction is a delay slot.
-	u32 pc;				// Program counter, when changing offset in struct, check iR5900-X.S to make sure offset is correct
 	u32 code;			// current instruction
+	int branch;
+
+	// --- Cold ---
+	alignas(64) CP0regs CP0;	// is COP0 32bit?
 	PERFregs PERF;
 	u32 eCycle[32];
 	u32 sCycle[32];		// for internal counters
-	u32 cycle;			// calculate cpucycles..
-	u32 interrupt;
-	int branch;
 	int opmode;			// operating mode
 	u32 tempcycles;
 	u32 dmastall;
 	u32 pcWriteback;
-
-	// if cpuRegs.cycle is greater than this cycle, should check cpuEventTest for updates
-	u32 nextEventCycle;
 	u32 lastEventCycle;
 	u32 lastCOP0Cycle;
 	u32 lastPERFCycle[2];
@@ -161,11 +169,12 @@ union FPRreg {
     s32 SL;
 };
 
-// Represents the state of the Floating Point Unit (FPU).
-struct fpuRegisters {
+// Represents the state of the Floating Point Unit (FPU). The registers and ACC share
+// the first three lines; the control registers (only FCR31 is used in practice) follow.
+struct alignas(64) fpuRegisters {
     FPRreg fpr[32];
-    u32 fprc[32]; // FPU control registers
     FPRreg ACC;   // Accumulator register
+    u32 fprc[32]; // FPU control registers
 };
 
 // This is the main, complete state of the Emotion Engine that our
@@ -174,4 +183,18 @@ struct fpuRegisters {
 struct EmotionEngineState {
     cpuRegisters cpuRegs;
     fpuRegisters fpuRegs;
-};
\ No newline at end of file
+};
+
+// Layout generated code relies on. The recompiler addresses fields by name, so these
+// only guard the cache-line split: change them together with the hot section above.
+static_assert(offsetof(EmotionEngineState, cpuRegs) == 0, "GPRs must start the context");
+static_assert(offsetof(cpuRegisters, GPR) == 0 && sizeof(GPRregs) == 32 * 16, "GPRs are lines 0-7");
+static_assert(offsetof(cpuRegisters, HI) == 512 && offsetof(cpuRegisters, LO) == 528, "HI/LO start line 8");
+static_assert(offsetof(cpuRegisters, cycle) == 544 && offsetof(cpuRegisters, nextEventCycle) == 548,
+              "The event check reads one line after the GPRs");
+static_assert(offsetof(cpuRegisters, pc) == 552, "pc shares line 8");
+static_assert(offsetof(cpuRegisters, branch) + sizeof(int) <= 576, "Hot section is nine lines");
+static_assert(offsetof(cpuRegisters, CP0) == 576, "Cold section starts on its own line");
+static_assert(alignof(GPR_reg) == 16 && offsetof(cpuRegisters, LO) % 16 == 0, "128-bit registers are aligned");
+static_assert(offsetof(EmotionEngineState, fpuRegs) % 64 == 0, "FPU state starts on its own line");
+static_assert(offsetof(fpuRegisters, ACC) == 128, "ACC follows the FPRs");
@@ -0,0 +1,153 @@
+#include "csc.h"
+#include <algorithm>
+#if CSC_SIMD_ENABLED
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Coefficients with 7 fraction bits. Blue and red are applied halved with one fraction
+// bit less, which is exact and keeps the products in 16 bits.
+constexpr s32 Y_SCALE = 149;            // 1.164
+constexpr s32 R_FROM_CR_HALF = 102;     // 1.596 (204), halved
+constexpr s32 G_FROM_CR = -104;         // -0.813
+constexpr s32 G_FROM_CB = -50;          // -0.391
+constexpr s32 B_FROM_CB_HALF = 129;     // 2.016 (258), halved
+constexpr u32 OPAQUE = 0x80;
+constexpr u32 TRANSLUCENT = 0x40;
+
+constexpr s32 DITHER[4][4] = {
+    { -4,  0, -3,  1 },
+    {  2, -2,  3, -1 },
+    { -3,  1, -4,  0 },
+    {  3, -1,  2, -2 },
+};
+
+u32 clamp_channel(s32 value) {
+    return (u32)std::min(255, std::max(0, value));
+}
+
+} // namespace
+
+void csc_scalar(const Raw8Macroblock& in, u32 out[256]) {
+    for (u32 row = 0; row < 16; row++) {
+        for (u32 column = 0; column < 16; column++) {
+            const u32 chroma = (row >> 1) * 8 + (column >> 1);
+            const s32 cb = (s32)in.cb[chroma] - 128;
+            const s32 cr = (s32)in.cr[chroma] - 128;
+            const s32 luma = (Y_SCALE * std::max(0, (s32)in.y[row * 16 + column] - 16)) >> 6;
+            const s32 red = (R_FROM_CR_HALF * cr) >> 5;
+            const s32 green = ((G_FROM_CR * cr) >> 6) + ((G_FROM_CB * cb) >> 6);
+            const s32 blue = (B_FROM_CB_HALF * cb) >> 5;
+            out[row * 16 + column] = clamp_channel((luma + red + 1) >> 1) |
+                                     clamp_channel((luma + green + 1) >> 1) << 8 |
+                                     clamp_channel((luma + blue + 1) >> 1) << 16 | OPAQUE << 24;
+        }
+    }
+}
+
+#if CSC_SIMD_ENABLED
+// One chroma row serves two luma rows; each chroma term is computed once for 8 samples
+// and doubled up to the 16 pixels of a row.
+void csc_sse2(const Raw8Macroblock& in, u32 out[256]) {
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi16(128);
+    const __m128i one = _mm_set1_epi16(1);
+    const __m128i alpha = _mm_set1_epi8((char)OPAQUE);
+    for (u32 chroma_row = 0; chroma_row < 8; chroma_row++) {
+        const __m128i cb = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in.cb + chroma_row * 8)), zero), bias);
+        const __m128i cr = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(in.cr + chroma_row * 8)), zero), bias);
+        const __m128i red = _mm_srai_epi16(_mm_mullo_epi16(cr, _mm_set1_epi16(R_FROM_CR_HALF)), 5);
+        const __m128i green = _mm_add_epi16(_mm_srai_epi16(_mm_mullo_epi16(cr, _mm_set1_epi16(G_FROM_CR)), 6),
+                                            _mm_srai_epi16(_mm_mullo_epi16(cb, _mm_set1_epi16(G_FROM_CB)), 6));
+        const __m128i blue = _mm_srai_epi16(_mm_mullo_epi16(cb, _mm_set1_epi16(B_FROM_CB_HALF)), 5);
+        const __m128i terms[3][2] = {
+            { _mm_unpacklo_epi16(red, red), _mm_unpackhi_epi16(red, red) },
+            { _mm_unpacklo_epi16(green, green), _mm_unpackhi_epi16(green, green) },
+            { _mm_unpacklo_epi16(blue, blue), _mm_unpackhi_epi16(blue, blue) },
+        };
+
+        for (u32 row = chroma_row * 2; row < chroma_row * 2 + 2; row++) {
+            const __m128i y = _mm_subs_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in.y + row * 16)), _mm_set1_epi8(16));
+            // 239 * 149 still fits in 16 unsigned bits.
+            const __m128i luma[2] = {
+                _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(y, zero), _mm_set1_epi16(Y_SCALE)), 6),
+                _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(y, zero), _mm_set1_epi16(Y_SCALE)), 6),
+            };
+            __m128i channels[3];
+            for (u32 c = 0; c < 3; c++) {
+                const __m128i low = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(luma[0], terms[c][0]), one), 1);
+                const __m128i high = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(luma[1], terms[c][1]), one), 1);
+                channels[c] = _mm_packus_epi16(low, high);
+            }
+            const __m128i rg_low = _mm_unpacklo_epi8(channels[0], channels[1]);
+            const __m128i rg_high = _mm_unpackhi_epi8(channels[0], channels[1]);
+            const __m128i ba_low = _mm_unpacklo_epi8(channels[2], alpha);
+            const __m128i ba_high = _mm_unpackhi_epi8(channels[2], alpha);
+            __m128i* dest = reinterpret_cast<__m128i*>(out + row * 16);
+            _mm_storeu_si128(dest + 0, _mm_unpacklo_epi16(rg_low, ba_low));
+            _mm_storeu_si128(dest + 1, _mm_unpackhi_epi16(rg_low, ba_low));
+            _mm_storeu_si128(dest + 2, _mm_unpacklo_epi16(rg_high, ba_high));
+            _mm_storeu_si128(dest + 3, _mm_unpackhi_epi16(rg_high, ba_high));
+        }
+    }
+}
+#endif
+
+CscFunction csc_select() {
+#if CSC_SIMD_ENABLED
+    return &csc_sse2;
+#else
+    return &csc_scalar;
+#endif
+}
+
+void csc_alpha(u32 pixels[256], u32 transparent, u32 translucent) {
+    if (!transparent && !translucent) {
+        return;
+    }
+    for (u32 i = 0; i < 256; i++) {
+        const u32 brightest = std::max({ pixels[i] & 0xFF, (pixels[i] >> 8) & 0xFF, (pixels[i] >> 16) & 0xFF });
+        if (brightest < transparent) {
+            pixels[i] = 0;
+        } else if (brightest < translucent) {
+            pixels[i] = (pixels[i] & 0x00FFFFFF) | TRANSLUCENT << 24;
+        }
+    }
+}
+
+void csc_rgb16(const u32 in[256], u16 out[256], bool dither) {
+    for (u32 row = 0; row < 16; row++) {
+        for (u32 column = 0; column < 16; column++) {
+            const u32 pixel = in[row * 16 + column];
+            const s32 offset = dither ? DITHER[row & 3][column & 3] : 0;
+            const u32 red = clamp_channel((s32)(pixel & 0xFF) + offset) >> 3;
+            const u32 green = clamp_channel((s32)((pixel >> 8) & 0xFF) + offset) >> 3;
+            const u32 blue = clamp_channel((s32)((pixel >> 16) & 0xFF) + offset) >> 3;
+            const u32 alpha = (pixel >> 24) == TRANSLUCENT;
+            out[row * 16 + column] = (u16)(red | green << 5 | blue << 10 | alpha << 15);
+        }
+    }
+}
+
+void csc_indx4(const u16 in[256], const u16 clut[16], u8 out[128]) {
+    for (u32 i = 0; i < 256; i++) {
+        u32 best = 0;
+        s32 best_distance = 0x7FFFFFFF;
+        for (u32 k = 0; k < 16; k++) {
+            const s32 red = (s32)(in[i] & 0x1F) - (s32)(clut[k] & 0x1F);
+            const s32 green = (s32)((in[i] >> 5) & 0x1F) - (s32)((clut[k] >> 5) & 0x1F);
+            const s32 blue = (s32)((in[i] >> 10) & 0x1F) - (s32)((clut[k] >> 10) & 0x1F);
+            const s32 distance = red * red + green * green + blue * blue;
+            if (distance < best_distance) {
+                best = k;
+                best_distance = distance;
+            }
+        }
+        if (i & 1) {
+            out[i >> 1] |= (u8)(best << 4);
+        } else {
+            out[i >> 1] = (u8)best;
+        }
+    }
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "cpu_state.h"
+
+// The IPU's colour conversions, a 16x16 macroblock at a time: YCbCr 4:2:0 to RGB32
+// (IDEC, CSC), and RGB32 to RGB16 or to 4-bit CLUT indices (IDEC, PACK).
+//
+// YCbCr to RGB is ITU-R BT.601 in 7-bit fixed point with the IPU's rounding:
+//   R = 1.164 (Y - 16) + 1.596 (Cr - 128)
+//   G = 1.164 (Y - 16) - 0.391 (Cb - 128) - 0.813 (Cr - 128)
+//   B = 1.164 (Y - 16) + 2.016 (Cb - 128)
+// clamped to 0-255, with alpha 0x80. Every intermediate fits in 16 bits, so the SSE2
+// version does a row of 16 pixels per pass in 16-bit lanes and is bit-exact with the
+// scalar reference.
+//
+// Pixels are the GS's: RGB32 is R, G, B, A in byte order; RGB16 is 5:5:5 with R in the
+// low bits and the alpha bit on top.
+
+#if defined(__x86_64__)
+#define CSC_SIMD_ENABLED 1
+#else
+#define CSC_SIMD_ENABLED 0
+#endif
+
+// A macroblock as BDEC decodes it and CSC takes it (RAW8): all of Y, then Cb, then Cr.
+struct Raw8Macroblock {
+    u8 y[256];
+    u8 cb[64];
+    u8 cr[64];
+};
+static_assert(sizeof(Raw8Macroblock) == 384, "RAW8 macroblocks are 24 quadwords");
+
+using CscFunction = void (*)(const Raw8Macroblock& in, u32 out[256]);
+
+void csc_scalar(const Raw8Macroblock& in, u32 out[256]);
+#if CSC_SIMD_ENABLED
+void csc_sse2(const Raw8Macroblock& in, u32 out[256]);
+#endif
+
+// The fastest version this CPU runs.
+CscFunction csc_select();
+
+/**
+ * @brief Applies the SETTH alpha thresholds: a pixel whose R, G and B are all below
+ * `transparent` becomes 0 altogether, one with all below `translucent` gets alpha 0x40.
+ * Zero thresholds never match.
+ */
+void csc_alpha(u32 pixels[256], u32 transparent, u32 translucent);
+
+/**
+ * @brief RGB32 to RGB16, optionally through the IPU's 4x4 ordered dither. Alpha 0x40
+ * sets the alpha bit.
+ */
+void csc_rgb16(const u32 in[256], u16 out[256], bool dither);
+
+/**
+ * @brief RGB16 to 4-bit indices into `clut` (the SETVQ table): each pixel becomes the
+ * nearest entry by squared distance, the first on a tie. Two pixels per byte, the first
+ * in the low nibble.
+ */
+void csc_indx4(const u16 in[256], const u16 clut[16], u8 out[128]);
@@ -0,0 +1,274 @@
+#include "disc_image.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// Primary volume descriptor and directory record fields (ECMA-119).
+constexpr u32 PVD_LSN = 16;
+constexpr u32 PVD_ROOT_RECORD = 156;
+constexpr u32 RECORD_LENGTH = 0;
+constexpr u32 RECORD_EXTENT = 2;
+constexpr u32 RECORD_SIZE = 10;
+constexpr u32 RECORD_DATE = 18;
+constexpr u32 RECORD_FLAGS = 25;
+constexpr u32 RECORD_NAME_LENGTH = 32;
+constexpr u32 RECORD_NAME = 33;
+constexpr u8 FLAG_DIRECTORY = 0x02;
+
+// Deeper than ISO9660 allows (8 levels), so a looping image cannot hang the indexer.
+constexpr u32 MAX_DEPTH = 16;
+
+u32 le32(const u8* data) {
+    return (u32)data[0] | ((u32)data[1] << 8) | ((u32)data[2] << 16) | ((u32)data[3] << 24);
+}
+
+} // namespace
+
+DiscImage::DiscImage()
+    : fd(-1), sectors(0), mapping(nullptr), mapping_size(0), block_sectors(BLOCK_SECTORS), next_lsn(0), ahead_lsn(0) {}
+
+DiscImage::~DiscImage() {
+    close();
+}
+
+bool DiscImage::open(const std::string& path, bool map) {
+    close();
+    fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        close();
+        return false;
+    }
+    sectors = (u32)(info.st_size / SECTOR_SIZE);
+
+    if (compressed_image::is_compressed(fd)) {
+        if (!compressed_image::read_index(fd, packed) || packed.blocks.empty()) {
+            close();
+            return false;
+        }
+        sectors = (u32)(packed.image_size / SECTOR_SIZE);
+        block_sectors = packed.block_size / SECTOR_SIZE;
+        const u32 threads = std::min(MAX_DECOMPRESS_THREADS, std::max(1u, std::thread::hardware_concurrency()));
+        blocks.reset(new BlockCache(packed.block_size, std::max(4u, CACHE_SIZE / packed.block_size), threads,
+                                    &load_block, this));
+    } else if (map && info.st_size > 0) {
+        void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (view != MAP_FAILED) {
+            mapping = static_cast<const u8*>(view);
+            mapping_size = (size_t)info.st_size;
+        }
+    }
+    if (!mapping && !blocks) {
+        blocks.reset(new BlockCache(BLOCK_SECTORS * SECTOR_SIZE, CACHE_SIZE / (BLOCK_SECTORS * SECTOR_SIZE), 1,
+                                    &load_block, this));
+    }
+
+    u8 pvd[SECTOR_SIZE];
+    if (!read_sectors(PVD_LSN, 1, pvd) || pvd[0] != 1 || std::memcmp(pvd + 1, "CD001", 5) != 0) {
+        close();
+        return false;
+    }
+    build_index(le32(pvd + PVD_ROOT_RECORD + RECORD_EXTENT), le32(pvd + PVD_ROOT_RECORD + RECORD_SIZE));
+    return true;
+}
+
+void DiscImage::close() {
+    blocks.reset();
+    if (mapping) {
+        munmap(const_cast<u8*>(mapping), mapping_size);
+    }
+    if (fd >= 0) {
+        ::close(fd);
+    }
+    fd = -1;
+    sectors = 0;
+    mapping = nullptr;
+    mapping_size = 0;
+    packed = compressed_image::Index();
+    block_sectors = BLOCK_SECTORS;
+    index.clear();
+    next_lsn = 0;
+    ahead_lsn = 0;
+}
+
+bool DiscImage::read(u32 lsn, u32 count, u8* out) {
+    if (!read_sectors(lsn, count, out)) {
+        return false;
+    }
+    read_ahead(lsn, count);
+    return true;
+}
+
+bool DiscImage::read_sectors(u32 lsn, u32 count, u8* out) const {
+    if (fd < 0 || lsn > sectors || count > sectors - lsn) {
+        return false;
+    }
+    if (mapping) {
+        std::memcpy(out, mapping + (size_t)lsn * SECTOR_SIZE, (size_t)count * SECTOR_SIZE);
+        return true;
+    }
+    while (count > 0) {
+        const u32 block = lsn / block_sectors;
+        const u32 first = lsn % block_sectors;
+        const u32 run = std::min(count, block_sectors - first);
+        if (!blocks->read(block, first * SECTOR_SIZE, run * SECTOR_SIZE, out)) {
+            return false;
+        }
+        lsn += run;
+        count -= run;
+        out += (size_t)run * SECTOR_SIZE;
+    }
+    return true;
+}
+
+// A block of an unmapped or compressed image, on whichever thread asked for it. The last
+// block of a plain image may run past its end; its tail reads as zeros.
+bool DiscImage::load_block(void* user, u32 block, u8* out) {
+    const DiscImage& disc = *static_cast<const DiscImage*>(user);
+    if (disc.is_compressed()) {
+        return compressed_image::read_block(disc.fd, disc.packed, block, out);
+    }
+    const size_t size = (size_t)BLOCK_SECTORS * SECTOR_SIZE;
+    const off_t start = (off_t)block * (off_t)size;
+    size_t done = 0;
+    while (done < size) {
+        const ssize_t got = pread(disc.fd, out + done, size - done, start + (off_t)done);
+        if (got < 0) {
+            return false;
+        }
+        if (got == 0) {
+            std::memset(out + done, 0, size - done);
+            break;
+        }
+        done += (size_t)got;
+    }
+    return true;
+}
+
+// Continuing where the last read ended is a stream: keep READ_AHEAD_SECTORS requested
+// past it, topping up once half of that has been consumed. Anything else is a seek and
+// starts over.
+void DiscImage::read_ahead(u32 lsn, u32 count) {
+    const u32 end = lsn + count;
+    const bool sequential = lsn == next_lsn;
+    next_lsn = end;
+    if (!sequential) {
+        ahead_lsn = end;
+        return;
+    }
+    if (ahead_lsn >= end + READ_AHEAD_SECTORS / 2) {
+        return;
+    }
+    const u32 from = std::max(ahead_lsn, end);
+    const u32 to = std::min(sectors, end + READ_AHEAD_SECTORS);
+    if (from >= to) {
+        return;
+    }
+    if (mapping) {
+        const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        const size_t start = (size_t)from * SECTOR_SIZE / page * page;
+        madvise(const_cast<u8*>(mapping) + start, (size_t)to * SECTOR_SIZE - start, MADV_WILLNEED);
+    } else {
+        for (u32 block = from / block_sectors; block <= (to - 1) / block_sectors; block++) {
+            blocks->prefetch(block);
+        }
+    }
+    ahead_lsn = to;
+}
+
+// "\data\file.bin;1" -> "DATA\FILE.BIN": upper case, '\' separated, no version.
+std::string DiscImage::index_key(const std::string& path) {
+    std::string key;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find_first_of("\\/", start);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        std::string component = path.substr(start, end - start);
+        start = end + 1;
+        component = component.substr(0, component.find(';'));
+        if (component.empty()) {
+            continue;
+        }
+        if (!key.empty()) {
+            key += '\\';
+        }
+        for (char c : component) {
+            key += (char)std::toupper((unsigned char)c);
+        }
+    }
+    return key;
+}
+
+// Walks every directory once. Records never straddle a sector; a zero length skips to
+// the next one.
+void DiscImage::build_index(u32 root_lsn, u32 root_size) {
+    struct Pending {
+        std::string prefix;
+        u32 lsn;
+        u32 size;
+        u32 depth;
+    };
+    std::vector<Pending> pending{ Pending{ "", root_lsn, root_size, 0 } };
+    std::vector<u8> dir;
+    while (!pending.empty()) {
+        const Pending current = pending.back();
+        pending.pop_back();
+        if (current.lsn >= sectors || current.size > (u64)(sectors - current.lsn) * SECTOR_SIZE) {
+            continue;
+        }
+        dir.resize((current.size + SECTOR_SIZE - 1) / SECTOR_SIZE * SECTOR_SIZE);
+        if (dir.empty() || !read_sectors(current.lsn, (u32)(dir.size() / SECTOR_SIZE), dir.data())) {
+            continue;
+        }
+        for (u32 offset = 0; offset < current.size;) {
+            const u8* record = dir.data() + offset;
+            if (record[RECORD_LENGTH] == 0) {
+                offset = (offset / SECTOR_SIZE + 1) * SECTOR_SIZE;
+                continue;
+            }
+            const u32 length = record[RECORD_LENGTH];
+            const u32 name_length = length > RECORD_NAME ? record[RECORD_NAME_LENGTH] : 0;
+            if (offset + length > dir.size() || RECORD_NAME + name_length > length) {
+                break;      // Corrupt directory: keep what was indexed so far
+            }
+            offset += length;
+            // "." and ".." are recorded as the single bytes 0 and 1.
+            if (name_length == 0 || (name_length == 1 && record[RECORD_NAME] <= 1)) {
+                continue;
+            }
+
+            DiscFile file;
+            file.lsn = le32(record + RECORD_EXTENT);
+            file.size = le32(record + RECORD_SIZE);
+            file.name.assign((const char*)record + RECORD_NAME, name_length);
+            std::memcpy(file.date, record + RECORD_DATE, sizeof(file.date));
+            const std::string key = index_key(current.prefix + "\\" + file.name);
+            if ((record[RECORD_FLAGS] & FLAG_DIRECTORY) && current.depth < MAX_DEPTH) {
+                pending.push_back(Pending{ key, file.lsn, file.size, current.depth + 1 });
+            }
+            index.emplace(key, std::move(file));
+        }
+    }
+}
+
+bool DiscImage::find(const std::string& path, DiscFile& file) const {
+    const auto it = index.find(index_key(path));
+    if (it == index.end()) {
+        return false;
+    }
+    file = it->second;
+    return true;
+}
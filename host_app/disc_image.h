@@ -0,0 +1,105 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "block_cache.h"
+#include "compressed_image.h"
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+// A disc image in 2048-byte sectors (a plain .iso or a block-compressed image, see
+// compressed_image.h), and the ISO9660 file system on it. Used by the CDVD server (see
+// iop_cdvd.h) on its worker thread.
+//
+// A plain image is memory-mapped when the file allows it, so a read is one copy out of
+// the page cache; otherwise sectors go through a BlockCache filled with pread(). A
+// compressed image always goes through the cache, with several threads decompressing
+// blocks ahead of the reader. Either way a sequential stream is detected and read ahead
+// of the game: the mapping is handed to the kernel's readahead with madvise(), the cache
+// to its prefetch threads. The whole directory tree is indexed when the image is opened,
+// so looking a file up is a single hash lookup.
+
+// A file as sceCdSearchFile() reports it.
+struct DiscFile {
+    u32 lsn;
+    u32 size;
+    std::string name;       // Last path component, as recorded on the disc ("FILE.BIN;1")
+    u8 date[7];             // ISO9660 recording date: years since 1900, month, day, h, m, s, GMT offset
+};
+
+class DiscImage {
+public:
+    static constexpr u32 SECTOR_SIZE = 2048;
+
+    // How far ahead of a sequential stream sectors are requested.
+    static constexpr u32 READ_AHEAD_SECTORS = 512;
+
+    // Unmapped plain images are cached in 64 KB blocks; compressed ones in their own.
+    static constexpr u32 BLOCK_SECTORS = 32;
+    static constexpr u32 CACHE_SIZE = 8 * 1024 * 1024;
+
+    // Most threads decompressing ahead of a compressed image's reader.
+    static constexpr u32 MAX_DECOMPRESS_THREADS = 4;
+
+    DiscImage();
+    ~DiscImage();
+
+    DiscImage(const DiscImage&) = delete;
+    DiscImage& operator=(const DiscImage&) = delete;
+
+    /**
+     * @brief Opens an image, replacing the current one, and indexes its file system.
+     * @param map Map a plain image if possible; false reads through the block cache.
+     * @return false if it cannot be read, a compressed image's index is corrupt, or there
+     * is no ISO9660 volume descriptor.
+     */
+    bool open(const std::string& path, bool map = true);
+    void close();
+
+    bool is_open() const { return fd >= 0; }
+    bool is_mapped() const { return mapping != nullptr; }
+    bool is_compressed() const { return !packed.blocks.empty(); }
+    u32 sector_count() const { return sectors; }
+
+    /**
+     * @brief Copies `count` sectors starting at `lsn` into `out`, and reads ahead if this
+     * continues the previous read.
+     * @return false if the range runs past the end of the image or the read fails.
+     */
+    bool read(u32 lsn, u32 count, u8* out);
+
+    /**
+     * @brief Looks a path up in the directory index. Components are separated by '\' or
+     * '/', compared case-insensitively, and a missing ";1" version is allowed.
+     */
+    bool find(const std::string& path, DiscFile& file) const;
+
+    // Files and directories in the index.
+    u32 file_count() const { return (u32)index.size(); }
+
+    // The block cache of an unmapped or compressed image, or nullptr.
+    const BlockCache* cache() const { return blocks.get(); }
+
+    // The form paths are indexed under: "\data\file.bin;1" -> "DATA\FILE.BIN".
+    static std::string index_key(const std::string& path);
+
+private:
+    static bool load_block(void* user, u32 block, u8* out);
+
+    bool read_sectors(u32 lsn, u32 count, u8* out) const;
+    void read_ahead(u32 lsn, u32 count);
+    void build_index(u32 root_lsn, u32 root_size);
+
+    int fd;
+    u32 sectors;
+    const u8* mapping;
+    size_t mapping_size;
+    compressed_image::Index packed;
+    u32 block_sectors;      // Sectors per cached block
+    std::unique_ptr<BlockCache> blocks;
+    std::unordered_map<std::string, DiscFile> index;
+
+    // Sequential stream detection.
+    u32 next_lsn;           // Where the last read ended
+    u32 ahead_lsn;          // Sectors before this have been asked for
+};
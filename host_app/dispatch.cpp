@@ -0,0 +1,41 @@
+#include "dispatch.h"
+#include <iostream>
+#include <unordered_map>
+
+static std::unordered_map<u32, RecompiledFunction> functions;
+static std::vector<RecompiledCode> code_ranges;
+
+void register_function(u32 address, RecompiledFunction function, u32 size, u32 hash) {
+    functions[address] = function;
+    if (size > 0) {
+        code_ranges.push_back(RecompiledCode{ address, size, hash });
+    }
+}
+
+const std::vector<RecompiledCode>& recompiled_code() {
+    return code_ranges;
+}
+
+RecompiledFunction find_function(u32 address) {
+    const auto it = functions.find(address);
+    return it != functions.end() ? it->second : nullptr;
+}
+
+void host_dispatch_jump(EmotionEngineState* __restrict ctx, u64 target) {
+    const u32 address = (u32)target;
+    if (address == RETURN_TO_HOST) {
+        return;
+    }
+    const RecompiledFunction function = find_function(address);
+    if (!function) {
+        std::cerr << "FATAL_ERROR: No recompiled code for jump target." << std::endl;
+        std::cerr << "Attempted to jump to address: 0x" << std::hex << address << std::endl;
+        exit(1);
+    }
+    function(ctx);
+}
+
+void call_guest_function(EmotionEngineState& context, u32 address) {
+    context.cpuRegs.GPR.n.ra.UD[0] = RETURN_TO_HOST;
+    host_dispatch_jump(&context, address);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <vector>
+
+// Maps guest addresses to the recompiled functions generated for them, for jumps whose
+// target is only known at runtime (JR/JALR) and for calls the runtime makes into game
+// code (interrupt handlers, threads).
+//
+// The table is shared by every EE instance in the process: fill it before creating
+// them, after which it is only read.
+
+// Recompiled functions take the state they run against as their only argument. It is
+// __restrict (nothing else aliases it while guest code runs) and passed down every call,
+// so the host compiler keeps it in a register instead of reloading a global's address.
+using RecompiledFunction = void (*)(EmotionEngineState* __restrict ctx);
+
+// Return address the runtime puts in $ra when it calls into guest code. A `jr $ra` to
+// it unwinds back to the host instead of dispatching.
+constexpr u32 RETURN_TO_HOST = 0xFFFFFFF0;
+
+// Where a function's code came from, for write-protecting it (see smc.h).
+struct RecompiledCode {
+    u32 address;
+    u32 size;
+    u32 hash;
+};
+
+/**
+ * @brief Adds a function to the table.
+ * @param size Bytes of guest code it was generated from, 0 if unknown.
+ * @param hash code_hash() of those bytes.
+ */
+void register_function(u32 address, RecompiledFunction function, u32 size = 0, u32 hash = 0);
+
+// Every registered function with a known code range.
+const std::vector<RecompiledCode>& recompiled_code();
+
+// The recompiled function for `address`, or nullptr if there is none.
+RecompiledFunction find_function(u32 address);
+
+/**
+ * @brief Continues execution at a guest address computed at runtime.
+ * @param ctx State of the calling function, passed on to the target.
+ * @param target Guest address; RETURN_TO_HOST returns to the runtime.
+ */
+void host_dispatch_jump(EmotionEngineState* __restrict ctx, u64 target);
+
+/**
+ * @brief Calls the guest function at `address` and returns once it does. Arguments are
+ * passed in the guest registers as usual; $ra is overwritten.
+ */
+void call_guest_function(EmotionEngineState& context, u32 address);
+
+// Emitted by recompiler_tool into recomp_code.cpp: registers every generated function.
+void register_recompiled_functions();
@@ -0,0 +1,612 @@
+#include "dmac.h"
+#include <algorithm>
+#include <cstring>
+
+// Base address of each channel's register block, indexed by DmacChannel.
+static constexpr u32 channel_base[DMAC_CHANNEL_COUNT] = {
+    0x10008000, 0x10009000, 0x1000A000, 0x1000B000, 0x1000B400,
+    0x1000C000, 0x1000C400, 0x1000C800, 0x1000D000, 0x1000D400,
+};
+
+// Register offsets inside a channel block.
+enum : u32 {
+    REG_CHCR = 0x00,
+    REG_MADR = 0x10,
+    REG_QWC  = 0x20,
+    REG_TADR = 0x30,
+    REG_ASR0 = 0x40,
+    REG_ASR1 = 0x50,
+    REG_SADR = 0x80,
+};
+
+static constexpr u32 SPR_SIZE = 16 * 1024;
+static constexpr u32 D_ENABLE_DISABLED = 1u << 16;
+
+static int channel_from_address(u32 address) {
+    const u32 block = address & ~0xFFu;
+    for (u32 i = 0; i < DMAC_CHANNEL_COUNT; i++) {
+        if (channel_base[i] == block) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+// Whether the channel moves data out of memory to its peripheral.
+static bool reads_from_memory(u32 channel, u32 chcr_value) {
+    switch (channel) {
+        case DMAC_VIF0:
+        case DMAC_GIF:
+        case DMAC_IPU_TO:
+        case DMAC_SIF1:
+        case DMAC_SPR_TO:
+            return true;
+        case DMAC_VIF1:
+        case DMAC_SIF2:
+            return (chcr_value & chcr::DIR) != 0;
+        default:
+            return false;
+    }
+}
+
+static u32 tag_id_of(u32 chcr_value) {
+    return (chcr_value >> 28) & 7;
+}
+
+Dmac::Dmac(const DmaMemory& memory) : memory(memory) {
+    for (u32 i = 0; i < DMAC_CHANNEL_COUNT; i++) {
+        consumers[i] = nullptr;
+        consumer_user[i] = nullptr;
+    }
+    completion_hook = nullptr;
+    completion_user = nullptr;
+    reset();
+}
+
+void Dmac::reset() {
+    std::memset(channels, 0, sizeof(channels));
+    for (u32 i = 0; i < DMAC_CHANNEL_COUNT; i++) {
+        state[i] = State::Idle;
+        tag_end[i] = false;
+        burst_cycles[i] = 0;
+    }
+    d_ctrl = 0;
+    d_stat = 0;
+    d_pcr = 0;
+    d_sqwc = 0;
+    d_rbsr = 0;
+    d_rbor = 0;
+    d_stadr = 0;
+    d_enable = 0x1201;
+}
+
+void Dmac::save_state(StateWriter& out) const {
+    out.write(channels);
+    out.write(state);
+    out.write(tag_end);
+    out.write(burst_cycles);
+    const u32 globals[] = { d_ctrl, d_stat, d_pcr, d_sqwc, d_rbsr, d_rbor, d_stadr, d_enable };
+    out.write(globals);
+}
+
+bool Dmac::load_state(StateReader& in) {
+    u32 globals[8];
+    if (!in.read(channels) || !in.read(state) || !in.read(tag_end) || !in.read(burst_cycles) || !in.read(globals)) {
+        return false;
+    }
+    d_ctrl = globals[0];
+    d_stat = globals[1];
+    d_pcr = globals[2];
+    d_sqwc = globals[3];
+    d_rbsr = globals[4];
+    d_rbor = globals[5];
+    d_stadr = globals[6];
+    d_enable = globals[7];
+    return true;
+}
+
+u32 Dmac::read32(u32 address) const {
+    switch (address) {
+        case D_CTRL:    return d_ctrl;
+        case D_STAT:    return d_stat;
+        case D_PCR:     return d_pcr;
+        case D_SQWC:    return d_sqwc;
+        case D_RBSR:    return d_rbsr;
+        case D_RBOR:    return d_rbor;
+        case D_STADR:   return d_stadr;
+        case D_ENABLER: return d_enable;
+    }
+
+    const int ch = channel_from_address(address);
+    if (ch < 0) {
+        return 0;
+    }
+    const DmaChannelRegs& c = channels[ch];
+    switch (address & 0xFF) {
+        case REG_CHCR: return c.chcr;
+        case REG_MADR: return c.madr;
+        case REG_QWC:  return c.qwc;
+        case REG_TADR: return c.tadr;
+        case REG_ASR0: return c.asr0;
+        case REG_ASR1: return c.asr1;
+        case REG_SADR: return c.sadr;
+    }
+    return 0;
+}
+
+u32 Dmac::command_bits(u32 address) {
+    return address == D_STAT ? 0xFFFFFFFF : 0;
+}
+
+void Dmac::write32(u32 address, u32 value) {
+    switch (address) {
+        case D_CTRL:
+            d_ctrl = value;
+            resume_all();
+            return;
+        case D_STAT:
+            // Status bits are write-1-to-clear, mask bits are write-1-to-flip.
+            d_stat &= ~(value & 0x0000FFFF);
+            d_stat ^= (value & 0xFFFF0000);
+            return;
+        case D_PCR:   d_pcr = value; return;
+        case D_SQWC:  d_sqwc = value; return;
+        case D_RBSR:  d_rbsr = value & 0x7FFFFFF0; return;
+        case D_RBOR:  d_rbor = value & 0x7FFFFFF0; return;
+        case D_STADR:
+            d_stadr = value & 0x7FFFFFF0;
+            release_stall_drain();
+            return;
+        case D_ENABLEW:
+            d_enable = value;
+            resume_all();
+            return;
+    }
+
+    const int ch = channel_from_address(address);
+    if (ch < 0) {
+        return;
+    }
+    DmaChannelRegs& c = channels[ch];
+    switch (address & 0xFF) {
+        case REG_CHCR: {
+            const bool was_busy = (c.chcr & chcr::STR) != 0;
+            if (was_busy && state[ch] != State::Idle) {
+                // Only STR can be changed while a transfer is in flight; clearing it aborts.
+                if (!(value & chcr::STR)) {
+                    c.chcr &= ~chcr::STR;
+                    state[ch] = State::Idle;
+                }
+                return;
+            }
+            // The TAG field is read-only.
+            c.chcr = (value & 0xFFFF) | (c.chcr & 0xFFFF0000);
+            if (c.chcr & chcr::STR) {
+                start(ch);
+            }
+            return;
+        }
+        case REG_MADR: c.madr = value & 0xFFFFFFF0; return;
+        case REG_QWC:  c.qwc = value & 0xFFFF; return;
+        case REG_TADR: c.tadr = value & 0xFFFFFFF0; return;
+        case REG_ASR0: c.asr0 = value & 0xFFFFFFF0; return;
+        case REG_ASR1: c.asr1 = value & 0xFFFFFFF0; return;
+        case REG_SADR: c.sadr = value & (SPR_SIZE - 16); return;
+    }
+}
+
+void Dmac::set_memory(const DmaMemory& memory) {
+    this->memory = memory;
+}
+
+void Dmac::set_consumer(u32 channel, DmaConsumer consumer, void* user) {
+    consumers[channel] = consumer;
+    consumer_user[channel] = user;
+}
+
+void Dmac::set_completion_hook(DmaCompletionHook hook, void* user) {
+    completion_hook = hook;
+    completion_user = user;
+}
+
+void Dmac::complete(u32 channel) {
+    if (state[channel] != State::Running) {
+        return;
+    }
+    state[channel] = State::Idle;
+    channels[channel].chcr &= ~chcr::STR;
+    d_stat |= 1u << channel;
+}
+
+void Dmac::resume(u32 channel) {
+    if (state[channel] == State::Stalled) {
+        run(channel);
+    }
+}
+
+bool Dmac::int1_asserted() const {
+    const u32 maskable = dstat::CIS_MASK | dstat::SIS | dstat::MEIS;
+    return (d_stat & (d_stat >> 16) & maskable) != 0 || (d_stat & dstat::BEIS) != 0;
+}
+
+// --- Internal helpers ---
+
+bool Dmac::enabled() const {
+    return (d_ctrl & 1) != 0 && (d_enable & D_ENABLE_DISABLED) == 0;
+}
+
+u8* Dmac::resolve(u32 address, u32 qwc) {
+    const u32 bytes = qwc * 16;
+    if (address & 0x80000000) {
+        const u32 offset = address & (SPR_SIZE - 16);
+        if (!memory.spr || offset + bytes > memory.spr_size) {
+            return nullptr;
+        }
+        return memory.spr + offset;
+    }
+    if (!memory.ram || (u64)address + bytes > memory.ram_size) {
+        return nullptr;
+    }
+    return memory.ram + address;
+}
+
+bool Dmac::is_mfifo_drain(u32 channel) const {
+    const u32 mfd = (d_ctrl >> 2) & 3;
+    return (mfd == 2 && channel == DMAC_VIF1) || (mfd == 3 && channel == DMAC_GIF);
+}
+
+bool Dmac::is_stall_source(u32 channel) const {
+    switch ((d_ctrl >> 4) & 3) {
+        case 1: return channel == DMAC_SIF0;
+        case 2: return channel == DMAC_SPR_FROM;
+        case 3: return channel == DMAC_IPU_FROM;
+    }
+    return false;
+}
+
+bool Dmac::is_stall_drain(u32 channel) const {
+    switch ((d_ctrl >> 6) & 3) {
+        case 1: return channel == DMAC_VIF1;
+        case 2: return channel == DMAC_GIF;
+        case 3: return channel == DMAC_SIF1;
+    }
+    return false;
+}
+
+// Whether the channel's data lives in the MFIFO ring buffer and must wrap at its end.
+bool Dmac::uses_ring(u32 channel) const {
+    if ((d_ctrl >> 2) & 2) {
+        if (channel == DMAC_SPR_FROM) {
+            return true;
+        }
+        if (is_mfifo_drain(channel)) {
+            const u32 id = tag_id_of(channels[channel].chcr);
+            return id != DMA_TAG_REF && id != DMA_TAG_REFE && id != DMA_TAG_REFS;
+        }
+    }
+    return false;
+}
+
+void Dmac::bus_error(u32 channel) {
+    d_stat |= dstat::BEIS;
+    channels[channel].chcr &= ~chcr::STR;
+    state[channel] = State::Idle;
+    burst_cycles[channel] = 0;
+}
+
+// Hands `qwc` quadwords at `data` to the channel's peripheral. The scratchpad channels
+// have the scratchpad itself as their peripheral.
+u32 Dmac::hand_off(u32 channel, u8* data, u32 qwc, bool is_tag) {
+    DmaChannelRegs& c = channels[channel];
+    if (channel == DMAC_SPR_FROM || channel == DMAC_SPR_TO) {
+        if (!memory.spr) {
+            return 0;
+        }
+        for (u32 i = 0; i < qwc; i++) {
+            u8* spr = memory.spr + c.sadr;
+            if (channel == DMAC_SPR_TO) {
+                std::memcpy(spr, data + i * 16, 16);
+            } else {
+                std::memcpy(data + i * 16, spr, 16);
+            }
+            c.sadr = (c.sadr + 16) & (SPR_SIZE - 16);
+        }
+        return qwc;
+    }
+
+    if (!consumers[channel]) {
+        // Nothing attached: the peripheral swallows everything.
+        return qwc;
+    }
+    const DmaSpan span{ data, qwc, is_tag };
+    const u32 taken = consumers[channel](consumer_user[channel], channel, span);
+    return taken < qwc ? taken : qwc;
+}
+
+// Moves the channel's pending QWC from MADR, splitting the run only where it wraps around
+// the MFIFO ring or where stall control cuts it short.
+Dmac::Step Dmac::transfer_data(u32 channel) {
+    DmaChannelRegs& c = channels[channel];
+    const bool ring = uses_ring(channel);
+    const bool interleave = ((c.chcr & chcr::MOD_MASK) >> chcr::MOD_SHIFT) == 2;
+    const u32 interleave_tqwc = (d_sqwc >> 16) & 0xFF;
+    const u32 interleave_sqwc = d_sqwc & 0xFF;
+    u32 interleave_done = 0;
+
+    while (c.qwc > 0) {
+        if (ring) {
+            c.madr = d_rbor | (c.madr & d_rbsr);
+        }
+
+        u32 run = c.qwc;
+        if (ring) {
+            const u32 ring_end = d_rbor + d_rbsr + 16;
+            run = std::min(run, (ring_end - c.madr) / 16);
+        }
+        if (interleave && interleave_tqwc) {
+            run = std::min(run, interleave_tqwc - interleave_done);
+        }
+
+        bool stall_cut = false;
+        if (is_stall_drain(channel) && tag_id_of(c.chcr) == DMA_TAG_REFS) {
+            const u32 limit = d_stadr > c.madr ? (d_stadr - c.madr) / 16 : 0;
+            if (limit < run) {
+                run = limit;
+                stall_cut = true;
+            }
+        }
+
+        if (run > 0) {
+            u8* data = resolve(c.madr, run);
+            if (!data) {
+                bus_error(channel);
+                return Step::Error;
+            }
+            const u32 taken = hand_off(channel, data, run, false);
+            c.madr += taken * 16;
+            c.qwc -= taken;
+            burst_cycles[channel] += taken * CYCLES_PER_QWC;
+            if (is_stall_source(channel)) {
+                d_stadr = c.madr;
+            }
+            if (taken < run) {
+                return Step::Stall;
+            }
+        }
+
+        if (stall_cut) {
+            d_stat |= dstat::SIS;
+            return Step::Stall;
+        }
+
+        if (interleave && interleave_tqwc) {
+            interleave_done += run;
+            if (interleave_done == interleave_tqwc) {
+                c.madr += interleave_sqwc * 16;
+                interleave_done = 0;
+            }
+        }
+    }
+    return Step::Done;
+}
+
+// Reads the next source chain DMAtag from TADR and applies it.
+Dmac::Step Dmac::read_source_tag(u32 channel) {
+    DmaChannelRegs& c = channels[channel];
+    if (is_mfifo_drain(channel)) {
+        c.tadr = d_rbor | (c.tadr & d_rbsr);
+        if (c.tadr == channels[DMAC_SPR_FROM].madr) {
+            d_stat |= dstat::MEIS;
+            return Step::Stall;
+        }
+    }
+
+    u8* tag_qw = resolve(c.tadr, 1);
+    if (!tag_qw) {
+        bus_error(channel);
+        return Step::Error;
+    }
+
+    if (c.chcr & chcr::TTE) {
+        if (hand_off(channel, tag_qw, 1, true) == 0) {
+            return Step::Stall;
+        }
+    }
+
+    u64 tag;
+    std::memcpy(&tag, tag_qw, sizeof(tag));
+    const u32 tag_lo = (u32)tag;
+    const u32 tag_addr = (u32)(tag >> 32) & 0xFFFFFFF0;
+    const u32 id = (tag_lo >> 28) & 7;
+    const bool irq = (tag_lo >> 31) != 0;
+
+    c.chcr = (c.chcr & 0xFFFF) | (tag_lo & 0xFFFF0000);
+    c.qwc = tag_lo & 0xFFFF;
+    burst_cycles[channel] += CYCLES_PER_QWC;
+
+    u32 asp = (c.chcr & chcr::ASP_MASK) >> chcr::ASP_SHIFT;
+    switch (id) {
+        case DMA_TAG_REFE:
+            c.madr = tag_addr;
+            c.tadr += 16;
+            tag_end[channel] = true;
+            break;
+        case DMA_TAG_CNT:
+            c.madr = c.tadr + 16;
+            c.tadr = c.madr + c.qwc * 16;
+            break;
+        case DMA_TAG_NEXT:
+            c.madr = c.tadr + 16;
+            c.tadr = tag_addr;
+            break;
+        case DMA_TAG_REF:
+        case DMA_TAG_REFS:
+            c.madr = tag_addr;
+            c.tadr += 16;
+            break;
+        case DMA_TAG_CALL:
+            c.madr = c.tadr + 16;
+            if (asp == 0) {
+                c.asr0 = c.madr + c.qwc * 16;
+            } else if (asp == 1) {
+                c.asr1 = c.madr + c.qwc * 16;
+            } else {
+                // The address stack is only two deep.
+                bus_error(channel);
+                return Step::Error;
+            }
+            c.tadr = tag_addr;
+            asp++;
+            break;
+        case DMA_TAG_RET:
+            c.madr = c.tadr + 16;
+            if (asp == 2) {
+                c.tadr = c.asr1;
+                asp--;
+            } else if (asp == 1) {
+                c.tadr = c.asr0;
+                asp--;
+            } else {
+                tag_end[channel] = true;
+            }
+            break;
+        case DMA_TAG_END:
+            c.madr = c.tadr + 16;
+            tag_end[channel] = true;
+            break;
+    }
+    c.chcr = (c.chcr & ~chcr::ASP_MASK) | (asp << chcr::ASP_SHIFT);
+
+    if (irq && (c.chcr & chcr::TIE)) {
+        tag_end[channel] = true;
+    }
+    return Step::Done;
+}
+
+// Reads the next destination chain DMAtag. SPR_FROM takes it from the scratchpad
+// stream; every other channel asks its peripheral to fill it in.
+Dmac::Step Dmac::read_dest_tag(u32 channel) {
+    DmaChannelRegs& c = channels[channel];
+    alignas(16) u8 tag_qw[16] = {};
+
+    if (channel == DMAC_SPR_FROM) {
+        if (!memory.spr) {
+            bus_error(channel);
+            return Step::Error;
+        }
+        std::memcpy(tag_qw, memory.spr + c.sadr, 16);
+        c.sadr = (c.sadr + 16) & (SPR_SIZE - 16);
+    } else if (!consumers[channel] || hand_off(channel, tag_qw, 1, true) == 0) {
+        return Step::Stall;
+    }
+
+    u64 tag;
+    std::memcpy(&tag, tag_qw, sizeof(tag));
+    const u32 tag_lo = (u32)tag;
+    const u32 id = (tag_lo >> 28) & 7;
+
+    c.chcr = (c.chcr & 0xFFFF) | (tag_lo & 0xFFFF0000);
+    c.qwc = tag_lo & 0xFFFF;
+    c.madr = (u32)(tag >> 32) & 0xFFFFFFF0;
+    burst_cycles[channel] += CYCLES_PER_QWC;
+
+    if (id == DMA_TAG_END || ((tag_lo >> 31) && (c.chcr & chcr::TIE))) {
+        tag_end[channel] = true;
+    }
+    return Step::Done;
+}
+
+void Dmac::start(u32 channel) {
+    DmaChannelRegs& c = channels[channel];
+    const u32 mode = (c.chcr & chcr::MOD_MASK) >> chcr::MOD_SHIFT;
+
+    tag_end[channel] = false;
+    burst_cycles[channel] = 0;
+    if (mode == 1 && c.qwc > 0) {
+        // Resuming a chain: CHCR.TAG holds the last DMAtag that was read.
+        const u32 id = tag_id_of(c.chcr);
+        if (reads_from_memory(channel, c.chcr)) {
+            tag_end[channel] = id == DMA_TAG_REFE || id == DMA_TAG_END;
+        } else {
+            tag_end[channel] = id == DMA_TAG_END;
+        }
+        if ((c.chcr >> 31) && (c.chcr & chcr::TIE)) {
+            tag_end[channel] = true;
+        }
+    }
+    run(channel);
+}
+
+// Walks the channel as far as it can go in one burst.
+void Dmac::run(u32 channel) {
+    DmaChannelRegs& c = channels[channel];
+    state[channel] = State::Stalled;
+    if (!enabled()) {
+        return;
+    }
+
+    const u32 mode = (c.chcr & chcr::MOD_MASK) >> chcr::MOD_SHIFT;
+    if (mode != 1) {
+        if (transfer_data(channel) != Step::Done) {
+            return;
+        }
+    } else {
+        const bool source_chain = reads_from_memory(channel, c.chcr);
+        while (true) {
+            if (c.qwc > 0 && transfer_data(channel) != Step::Done) {
+                return;
+            }
+            if (tag_end[channel]) {
+                break;
+            }
+            const Step step = source_chain ? read_source_tag(channel) : read_dest_tag(channel);
+            if (step != Step::Done) {
+                return;
+            }
+        }
+    }
+
+    post_completion(channel);
+    if (is_stall_source(channel)) {
+        release_stall_drain();
+    }
+    if (channel == DMAC_SPR_FROM && ((d_ctrl >> 2) & 2)) {
+        release_mfifo_drain();
+    }
+}
+
+void Dmac::post_completion(u32 channel) {
+    const u32 cycles = burst_cycles[channel];
+    burst_cycles[channel] = 0;
+    state[channel] = State::Running;
+    if (completion_hook) {
+        completion_hook(completion_user, channel, cycles);
+    } else {
+        complete(channel);
+    }
+}
+
+void Dmac::release_stall_drain() {
+    for (u32 i = 0; i < DMAC_CHANNEL_COUNT; i++) {
+        if (is_stall_drain(i)) {
+            resume(i);
+        }
+    }
+}
+
+void Dmac::release_mfifo_drain() {
+    for (u32 i = 0; i < DMAC_CHANNEL_COUNT; i++) {
+        if (is_mfifo_drain(i)) {
+            resume(i);
+        }
+    }
+}
+
+void Dmac::resume_all() {
+    if (!enabled()) {
+        return;
+    }
+    for (u32 i = 0; i < DMAC_CHANNEL_COUNT; i++) {
+        resume(i);
+    }
+}
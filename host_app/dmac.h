@@ -0,0 +1,217 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "state_stream.h"
+
+// EE DMA controller (DMAC), see "DMA Controller (DMAC)" in docs/ps2_docs.txt.
+//
+// A transfer is never stepped one quadword at a time. When a channel is started the
+// whole chain is walked in one go: every contiguous run of quadwords is handed to the
+// peripheral as a pointer into main_memory (or the scratchpad) plus a length, and the
+// time the real DMAC would have needed is posted as a single completion.
+
+// Channel numbers, in the order of their register blocks at 0x10008000-0x1000D4FF.
+enum DmacChannel : u32 {
+    DMAC_VIF0 = 0,
+    DMAC_VIF1,
+    DMAC_GIF,
+    DMAC_IPU_FROM,
+    DMAC_IPU_TO,
+    DMAC_SIF0,
+    DMAC_SIF1,
+    DMAC_SIF2,
+    DMAC_SPR_FROM,
+    DMAC_SPR_TO,
+    DMAC_CHANNEL_COUNT
+};
+
+// Source chain DMAtag IDs (DMAtag bits 28-30).
+enum DmaTagId : u32 {
+    DMA_TAG_REFE = 0,
+    DMA_TAG_CNT  = 1,
+    DMA_TAG_NEXT = 2,
+    DMA_TAG_REF  = 3,
+    DMA_TAG_REFS = 4,
+    DMA_TAG_CALL = 5,
+    DMA_TAG_RET  = 6,
+    DMA_TAG_END  = 7,
+};
+
+// Bits of Dn_CHCR.
+namespace chcr {
+    constexpr u32 DIR = 1u << 0;    // 1 = from memory
+    constexpr u32 MOD_SHIFT = 2;    // 0 = normal, 1 = chain, 2 = interleave
+    constexpr u32 MOD_MASK = 3u << MOD_SHIFT;
+    constexpr u32 ASP_SHIFT = 4;
+    constexpr u32 ASP_MASK = 3u << ASP_SHIFT;
+    constexpr u32 TTE = 1u << 6;
+    constexpr u32 TIE = 1u << 7;
+    constexpr u32 STR = 1u << 8;
+}
+
+// Bits of D_STAT that are not per-channel.
+namespace dstat {
+    constexpr u32 CIS_MASK = 0x3FF;   // Channel interrupt status
+    constexpr u32 SIS = 1u << 13;     // Stall interrupt status
+    constexpr u32 MEIS = 1u << 14;    // MFIFO empty interrupt status
+    constexpr u32 BEIS = 1u << 15;    // Bus error interrupt status
+}
+
+// A contiguous run of quadwords handed to (or filled by) a peripheral.
+// `data` points straight into emulated memory; nothing is copied.
+struct DmaSpan {
+    u8* data;
+    u32 qwc;
+    bool is_tag;    // Set for the DMAtag quadword sent when CHCR.TTE is on.
+};
+
+// Peripheral side of a channel. For channels reading from memory the consumer reads
+// `span`, for channels writing to memory it fills it. Returns how many quadwords it
+// took; returning fewer than span.qwc stalls the channel until Dmac::resume().
+using DmaConsumer = u32 (*)(void* user, u32 channel, const DmaSpan& span);
+
+// Called once per burst with the number of EE cycles the transfer would have taken.
+// The owner is expected to call Dmac::complete(channel) once that time has passed.
+using DmaCompletionHook = void (*)(void* user, u32 channel, u32 cycles);
+
+// Memory the DMAC can reach: main RAM, and the scratchpad when MADR/TADR bit 31 is set.
+struct DmaMemory {
+    u8* ram = nullptr;
+    u32 ram_size = 0;
+    u8* spr = nullptr;
+    u32 spr_size = 0;
+};
+
+struct DmaChannelRegs {
+    u32 chcr;
+    u32 madr;
+    u32 qwc;
+    u32 tadr;
+    u32 asr0;
+    u32 asr1;
+    u32 sadr;
+};
+
+class Dmac {
+public:
+    // Register block of the DMAC, including the channel blocks.
+    static constexpr u32 IO_START = 0x10008000;
+    static constexpr u32 IO_END = 0x1000F000;   // exclusive
+    static constexpr u32 D_CTRL = 0x1000E000;
+    static constexpr u32 D_STAT = 0x1000E010;
+    static constexpr u32 D_PCR = 0x1000E020;
+    static constexpr u32 D_SQWC = 0x1000E030;
+    static constexpr u32 D_RBSR = 0x1000E040;
+    static constexpr u32 D_RBOR = 0x1000E050;
+    static constexpr u32 D_STADR = 0x1000E060;
+    static constexpr u32 D_ENABLER = 0x1000F520;
+    static constexpr u32 D_ENABLEW = 0x1000F590;
+
+    // The DMAC moves one quadword per bus cycle, and the bus runs at half the EE clock.
+    static constexpr u32 CYCLES_PER_QWC = 2;
+
+    explicit Dmac(const DmaMemory& memory);
+
+    void reset();
+
+    // Points the DMAC at the memory it transfers from/to.
+    void set_memory(const DmaMemory& memory);
+
+    /**
+     * @brief Reads a DMAC register.
+     * @param address Physical address of the register (0x10008000-0x1000E060, D_ENABLER).
+     * @return The register value, 0 for unmapped offsets.
+     */
+    u32 read32(u32 address) const;
+
+    /**
+     * @brief Writes a DMAC register. Setting CHCR.STR starts the channel.
+     * @param address Physical address of the register (0x10008000-0x1000E060, D_ENABLEW).
+     * @param value The 32-bit value to write.
+     */
+    void write32(u32 address, u32 value);
+
+    // Bits of a register that act when written as 1 rather than hold the value (D_STAT).
+    static u32 command_bits(u32 address);
+
+    void set_consumer(u32 channel, DmaConsumer consumer, void* user);
+    void set_completion_hook(DmaCompletionHook hook, void* user);
+
+    /**
+     * @brief Finishes a burst posted through the completion hook: clears CHCR.STR and
+     * raises the channel's D_STAT bit.
+     */
+    void complete(u32 channel);
+
+    /**
+     * @brief Restarts a channel that was stalled by its consumer, by stall control or
+     * by an empty MFIFO.
+     */
+    void resume(u32 channel);
+
+    // True when (D_STAT status & D_STAT mask) != 0, i.e. INT1 is asserted.
+    bool int1_asserted() const;
+
+    DmaChannelRegs& channel(u32 index) { return channels[index]; }
+    const DmaChannelRegs& channel(u32 index) const { return channels[index]; }
+
+    u32 ctrl() const { return d_ctrl; }
+    u32 stat() const { return d_stat; }
+
+    // Save states (see savestate.h): the registers and where each channel is. Consumers,
+    // hooks and the memory pointers stay as they are.
+    void save_state(StateWriter& out) const;
+    bool load_state(StateReader& in);
+
+private:
+    // Where a channel currently is in its transfer.
+    enum class State : u8 {
+        Idle,
+        Running,      // Burst done, completion posted.
+        Stalled,      // Waiting on the consumer, stall control or the MFIFO.
+    };
+
+    enum class Step : u8 {
+        Done,
+        Stall,
+        Error,
+    };
+
+    bool enabled() const;
+    u8* resolve(u32 address, u32 qwc);
+    bool is_mfifo_drain(u32 channel) const;
+    bool is_stall_drain(u32 channel) const;
+    bool is_stall_source(u32 channel) const;
+    bool uses_ring(u32 channel) const;
+    void bus_error(u32 channel);
+
+    void start(u32 channel);
+    void run(u32 channel);
+    u32 hand_off(u32 channel, u8* data, u32 qwc, bool is_tag);
+    Step transfer_data(u32 channel);
+    Step read_source_tag(u32 channel);
+    Step read_dest_tag(u32 channel);
+    void post_completion(u32 channel);
+    void release_stall_drain();
+    void release_mfifo_drain();
+    void resume_all();
+
+    DmaMemory memory;
+    DmaChannelRegs channels[DMAC_CHANNEL_COUNT];
+    State state[DMAC_CHANNEL_COUNT];
+    bool tag_end[DMAC_CHANNEL_COUNT];
+    u32 burst_cycles[DMAC_CHANNEL_COUNT];
+    DmaConsumer consumers[DMAC_CHANNEL_COUNT];
+    void* consumer_user[DMAC_CHANNEL_COUNT];
+    DmaCompletionHook completion_hook;
+    void* completion_user;
+
+    u32 d_ctrl;
+    u32 d_stat;
+    u32 d_pcr;
+    u32 d_sqwc;
+    u32 d_rbsr;
+    u32 d_rbor;
+    u32 d_stadr;
+    u32 d_enable;
+};
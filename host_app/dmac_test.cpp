@@ -0,0 +1,212 @@
+#include "gtest/gtest.h"
+#include "dmac.h"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Records every span a channel hands over, so tests can check the walk order and
+// that the data pointers point straight into RAM.
+struct Recorder {
+    std::vector<DmaSpan> spans;
+    u32 accept_limit = 0xFFFFFFFF;   // Quadwords accepted before stalling.
+
+    static u32 consume(void* user, u32, const DmaSpan& span) {
+        Recorder* self = static_cast<Recorder*>(user);
+        u32 taken = span.qwc < self->accept_limit ? span.qwc : self->accept_limit;
+        self->accept_limit -= taken;
+        if (taken > 0) {
+            self->spans.push_back({ span.data, taken, span.is_tag });
+        }
+        return taken;
+    }
+};
+
+struct Completions {
+    std::vector<std::pair<u32, u32>> posted;   // (channel, cycles)
+
+    static void post(void* user, u32 channel, u32 cycles) {
+        static_cast<Completions*>(user)->posted.push_back({ channel, cycles });
+    }
+};
+
+class DmacTest : public ::testing::Test {
+protected:
+    DmacTest() : ram(1024 * 1024), spr(16 * 1024), dmac(DmaMemory{ ram.data(), (u32)ram.size(), spr.data(), (u32)spr.size() }) {
+        dmac.set_consumer(DMAC_GIF, &Recorder::consume, &gif);
+        dmac.set_completion_hook(&Completions::post, &completions);
+        dmac.write32(Dmac::D_CTRL, 1);   // DMA enable
+    }
+
+    void write_tag(u32 address, u32 qwc, u32 id, u32 addr, bool irq = false) {
+        const u64 tag = (u64)qwc | ((u64)id << 28) | ((u64)irq << 31) | ((u64)addr << 32);
+        std::memcpy(&ram[address], &tag, sizeof(tag));
+    }
+
+    u32 gif_reg(u32 offset) const { return 0x1000A000 + offset; }
+
+    std::vector<u8> ram;
+    std::vector<u8> spr;
+    Dmac dmac;
+    Recorder gif;
+    Completions completions;
+};
+
+} // namespace
+
+TEST_F(DmacTest, NormalTransferHandsOffOneSpanWithoutCopying) {
+    // 1. Arrange: 4 quadwords at 0x1000 for the GIF.
+    dmac.write32(gif_reg(0x10), 0x1000);   // MADR
+    dmac.write32(gif_reg(0x20), 4);        // QWC
+
+    // 2. Act: start in normal mode, from memory.
+    dmac.write32(gif_reg(0x00), chcr::STR | chcr::DIR);
+
+    // 3. Assert: a single span pointing into RAM, and one completion for the burst.
+    ASSERT_EQ(gif.spans.size(), 1u);
+    EXPECT_EQ(gif.spans[0].data, &ram[0x1000]);
+    EXPECT_EQ(gif.spans[0].qwc, 4u);
+    ASSERT_EQ(completions.posted.size(), 1u);
+    EXPECT_EQ(completions.posted[0].first, (u32)DMAC_GIF);
+    EXPECT_EQ(completions.posted[0].second, 4 * Dmac::CYCLES_PER_QWC);
+    EXPECT_EQ(dmac.channel(DMAC_GIF).madr, 0x1040u);
+    EXPECT_EQ(dmac.channel(DMAC_GIF).qwc, 0u);
+
+    // The channel stays busy until the posted completion fires.
+    EXPECT_TRUE(dmac.read32(gif_reg(0x00)) & chcr::STR);
+    dmac.complete(DMAC_GIF);
+    EXPECT_FALSE(dmac.read32(gif_reg(0x00)) & chcr::STR);
+    EXPECT_EQ(dmac.stat() & (1u << DMAC_GIF), 1u << DMAC_GIF);
+}
+
+TEST_F(DmacTest, SourceChainWalksWholeChainInOneBurst) {
+    // CNT (2 qw inline) -> CALL 0x3000 -> [REF 0x8000, RET] -> END (1 qw inline)
+    write_tag(0x2000, 2, DMA_TAG_CNT, 0);
+    write_tag(0x2030, 0, DMA_TAG_CALL, 0x3000);
+    write_tag(0x3000, 3, DMA_TAG_REF, 0x8000);
+    write_tag(0x3010, 0, DMA_TAG_RET, 0);
+    write_tag(0x2040, 1, DMA_TAG_END, 0);
+
+    dmac.write32(gif_reg(0x30), 0x2000);   // TADR
+    dmac.write32(gif_reg(0x00), chcr::STR | chcr::DIR | (1u << chcr::MOD_SHIFT));
+
+    ASSERT_EQ(gif.spans.size(), 3u);
+    EXPECT_EQ(gif.spans[0].data, &ram[0x2010]);
+    EXPECT_EQ(gif.spans[0].qwc, 2u);
+    EXPECT_EQ(gif.spans[1].data, &ram[0x8000]);
+    EXPECT_EQ(gif.spans[1].qwc, 3u);
+    EXPECT_EQ(gif.spans[2].data, &ram[0x2050]);
+    EXPECT_EQ(gif.spans[2].qwc, 1u);
+
+    // Five tags and six quadwords of data, all posted as one completion.
+    ASSERT_EQ(completions.posted.size(), 1u);
+    EXPECT_EQ(completions.posted[0].second, (5 + 6) * Dmac::CYCLES_PER_QWC);
+    EXPECT_EQ((dmac.channel(DMAC_GIF).chcr >> 28) & 7, (u32)DMA_TAG_END);
+    EXPECT_EQ(dmac.channel(DMAC_GIF).chcr & chcr::ASP_MASK, 0u);
+}
+
+TEST_F(DmacTest, TagInterruptBitEndsTransferWhenTieIsSet) {
+    write_tag(0x2000, 1, DMA_TAG_CNT, 0, true);
+    write_tag(0x2020, 1, DMA_TAG_END, 0);
+
+    dmac.write32(gif_reg(0x30), 0x2000);
+    dmac.write32(gif_reg(0x00), chcr::STR | chcr::DIR | chcr::TIE | (1u << chcr::MOD_SHIFT));
+
+    ASSERT_EQ(gif.spans.size(), 1u);
+    EXPECT_EQ(dmac.channel(DMAC_GIF).tadr, 0x2020u);
+}
+
+TEST_F(DmacTest, ConsumerStallResumesWhereItLeftOff) {
+    gif.accept_limit = 3;
+    dmac.write32(gif_reg(0x10), 0x1000);
+    dmac.write32(gif_reg(0x20), 8);
+    dmac.write32(gif_reg(0x00), chcr::STR | chcr::DIR);
+
+    EXPECT_TRUE(completions.posted.empty());
+    EXPECT_EQ(dmac.channel(DMAC_GIF).qwc, 5u);
+
+    gif.accept_limit = 0xFFFFFFFF;
+    dmac.resume(DMAC_GIF);
+
+    ASSERT_EQ(gif.spans.size(), 2u);
+    EXPECT_EQ(gif.spans[1].data, &ram[0x1030]);
+    EXPECT_EQ(gif.spans[1].qwc, 5u);
+    ASSERT_EQ(completions.posted.size(), 1u);
+    EXPECT_EQ(completions.posted[0].second, 8 * Dmac::CYCLES_PER_QWC);
+}
+
+TEST_F(DmacTest, StallControlHoldsRefsUntilStallAddressAdvances) {
+    // GIF drains (STD=2) behind SPR_FROM (STS=2).
+    dmac.write32(Dmac::D_CTRL, 1 | (2 << 4) | (2 << 6));
+    dmac.write32(Dmac::D_STADR, 0x4020);
+
+    write_tag(0x2000, 4, DMA_TAG_REFS, 0x4000);
+    write_tag(0x2010, 0, DMA_TAG_END, 0);
+    dmac.write32(gif_reg(0x30), 0x2000);
+    dmac.write32(gif_reg(0x00), chcr::STR | chcr::DIR | (1u << chcr::MOD_SHIFT));
+
+    ASSERT_EQ(gif.spans.size(), 1u);
+    EXPECT_EQ(gif.spans[0].qwc, 2u);
+    EXPECT_TRUE(dmac.stat() & dstat::SIS);
+    EXPECT_TRUE(completions.posted.empty());
+
+    dmac.write32(Dmac::D_STADR, 0x4040);
+    ASSERT_EQ(gif.spans.size(), 2u);
+    EXPECT_EQ(gif.spans[1].data, &ram[0x4020]);
+    EXPECT_EQ(completions.posted.size(), 1u);
+}
+
+TEST_F(DmacTest, MfifoDrainStallsOnEmptyRingAndWrapsSpans) {
+    // Ring of 4 quadwords at 0x10000, drained by the GIF (MFD=3).
+    dmac.write32(Dmac::D_CTRL, 1 | (3 << 2));
+    dmac.write32(Dmac::D_RBOR, 0x10000);
+    dmac.write32(Dmac::D_RBSR, 0x30);
+
+    // Nothing written to the ring yet: the drain sees TADR == SPR_FROM.MADR.
+    dmac.write32(0x1000D010, 0x10000);   // SPR_FROM MADR
+    dmac.write32(gif_reg(0x30), 0x10000);
+    dmac.write32(gif_reg(0x00), chcr::STR | chcr::DIR | (1u << chcr::MOD_SHIFT));
+    EXPECT_TRUE(dmac.stat() & dstat::MEIS);
+    EXPECT_TRUE(gif.spans.empty());
+
+    // SPR_FROM fills the ring with an END tag followed by 1 qw, starting near the end
+    // so that the data wraps around to the start of the buffer.
+    const u64 tag = 1ull | ((u64)DMA_TAG_END << 28);
+    std::memcpy(&spr[0], &tag, sizeof(tag));
+    std::memset(&spr[16], 0xAB, 16);
+    dmac.write32(0x1000D010, 0x10030);
+    dmac.write32(gif_reg(0x30), 0x10030);
+    dmac.write32(0x1000D080, 0);   // SADR
+    dmac.write32(0x1000D020, 2);   // QWC
+    dmac.write32(0x1000D000, chcr::STR);
+
+    ASSERT_EQ(gif.spans.size(), 1u);
+    EXPECT_EQ(gif.spans[0].data, &ram[0x10000]);
+    EXPECT_EQ(ram[0x10000], 0xAB);
+    EXPECT_EQ(dmac.channel(DMAC_SPR_FROM).madr, 0x10010u);
+}
+
+TEST_F(DmacTest, Int1FollowsStatusAndMask) {
+    dmac.write32(gif_reg(0x20), 0);
+    dmac.write32(gif_reg(0x00), chcr::STR | chcr::DIR);
+    dmac.complete(DMAC_GIF);
+    EXPECT_FALSE(dmac.int1_asserted());
+
+    // Writing a 1 to a mask bit flips it.
+    dmac.write32(Dmac::D_STAT, 1u << (16 + DMAC_GIF));
+    EXPECT_TRUE(dmac.int1_asserted());
+
+    // Writing a 1 to a status bit clears it.
+    dmac.write32(Dmac::D_STAT, 1u << DMAC_GIF);
+    EXPECT_FALSE(dmac.int1_asserted());
+}
+
+TEST_F(DmacTest, BadAddressRaisesBusError) {
+    dmac.write32(gif_reg(0x10), 0x01FFFFF0);   // Past the end of the 1 MB test RAM
+    dmac.write32(gif_reg(0x20), 1);
+    dmac.write32(gif_reg(0x00), chcr::STR | chcr::DIR);
+
+    EXPECT_TRUE(dmac.stat() & dstat::BEIS);
+    EXPECT_TRUE(dmac.int1_asserted());
+    EXPECT_FALSE(dmac.read32(gif_reg(0x00)) & chcr::STR);
+}
@@ -0,0 +1,669 @@
+#include "fastmem.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <new>
+
+#if FASTMEM_ENABLED
+#include <signal.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+struct FastmemSpace {
+    u8* base = nullptr;
+    u8* ram = nullptr;
+    u8* scratchpad = nullptr;
+
+    // One entry per 4 KB guest page mapped through the TLB, allocated with the first
+    // mapping: 0 for the fixed layout, the host address of the page for RAM/scratchpad,
+    // or the physical address | PAGE_DEVICE for device pages.
+    uintptr_t* page_table = nullptr;
+
+    // RAM and the scratchpad are memory objects so TLB mappings can alias them anywhere.
+    int ram_fd = -1;
+    int scratchpad_fd = -1;
+
+    MmioReadHandler mmio_read_handler = nullptr;
+    MmioWriteHandler mmio_write_handler = nullptr;
+    WriteFaultHook write_fault_hook = nullptr;
+};
+
+constexpr uintptr_t PAGE_DEVICE = 1;
+
+FASTMEM_TLS u8* fastmem_base = nullptr;
+FASTMEM_TLS u8* ram_memory = nullptr;
+FASTMEM_TLS u8* scratchpad_memory = nullptr;
+static FASTMEM_TLS FastmemSpace* space = nullptr;
+
+void fastmem_bind(FastmemSpace* bound) {
+    space = bound;
+    fastmem_base = bound ? bound->base : nullptr;
+    ram_memory = bound ? bound->ram : nullptr;
+    scratchpad_memory = bound ? bound->scratchpad : nullptr;
+}
+
+FastmemSpace* fastmem_current() {
+    return space;
+}
+
+u8* fastmem_ram() {
+    return ram_memory;
+}
+
+u8* fastmem_scratchpad() {
+    return scratchpad_memory;
+}
+
+bool fastmem_set_mmio_handlers(MmioReadHandler read, MmioWriteHandler write) {
+    if (!space) {
+        return false;
+    }
+    space->mmio_read_handler = read;
+    space->mmio_write_handler = write;
+    return true;
+}
+
+bool fastmem_set_write_fault_hook(WriteFaultHook hook) {
+    if (!space) {
+        return false;
+    }
+    space->write_fault_hook = hook;
+    return true;
+}
+
+bool fastmem_protect_ram_page(u32 offset, bool writable) {
+    return fastmem_protect_ram_range(offset & ~(fastmem::PAGE_SIZE - 1), fastmem::PAGE_SIZE, writable);
+}
+
+bool fastmem_protect_ram_range(u32 offset, u32 size, bool writable) {
+#if FASTMEM_ENABLED
+    if (!fastmem_base) {
+        return false;
+    }
+    const u32 start = offset & ~(fastmem::PAGE_SIZE - 1);
+    const u32 end = (offset + size + fastmem::PAGE_SIZE - 1) & ~(fastmem::PAGE_SIZE - 1);
+    for (u32 mirror : fastmem::RAM_MIRRORS) {
+        if (mprotect(fastmem_base + mirror + start, end - start, writable ? PROT_READ | PROT_WRITE : PROT_READ) != 0) {
+            return false;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+u8* fastmem_translate(u32 address, u32 size) {
+    if (!space) {
+        return nullptr;
+    }
+    if (space->page_table) {
+        if (const uintptr_t page = space->page_table[address >> fastmem::PAGE_SHIFT]) {
+            const u32 offset = address & (fastmem::PAGE_SIZE - 1);
+            if ((page & PAGE_DEVICE) || offset + size > fastmem::PAGE_SIZE) {
+                return nullptr;
+            }
+            return reinterpret_cast<u8*>(page) + offset;
+        }
+    }
+    for (u32 mirror : fastmem::RAM_MIRRORS) {
+        const u32 offset = address - mirror;
+        if (offset < fastmem::RAM_SIZE) {
+            return offset + size <= fastmem::RAM_SIZE ? ram_memory + offset : nullptr;
+        }
+    }
+    const u32 offset = address - fastmem::SCRATCHPAD_START;
+    if (offset < fastmem::SCRATCHPAD_SIZE && offset + size <= fastmem::SCRATCHPAD_SIZE) {
+        return scratchpad_memory + offset;
+    }
+    return nullptr;
+}
+
+// KSEG0/KSEG1 are direct windows onto the first 512 MB of physical memory. Device pages
+// mapped through the TLB carry their physical address in the page table.
+static u32 physical_address(u32 address) {
+    if (space->page_table) {
+        const uintptr_t page = space->page_table[address >> fastmem::PAGE_SHIFT];
+        if (page & PAGE_DEVICE) {
+            return (u32)(page & ~(uintptr_t)(fastmem::PAGE_SIZE - 1)) | (address & (fastmem::PAGE_SIZE - 1));
+        }
+    }
+    if (address >= 0x80000000 && address < 0xC0000000) {
+        return address & 0x1FFFFFFF;
+    }
+    return address;
+}
+
+bool mmio_read(u32 address, u32 size, void* value) {
+    return space && space->mmio_read_handler && space->mmio_read_handler(physical_address(address), size, value);
+}
+
+bool mmio_write(u32 address, u32 size, const void* value) {
+    return space && space->mmio_write_handler && space->mmio_write_handler(physical_address(address), size, value);
+}
+
+void memory_access_fault(u32 address, u32 size, bool write) {
+    std::cerr << "FATAL_ERROR: Out-of-bounds memory " << (write ? "write." : "read.") << std::endl;
+    std::cerr << "Attempted to " << (write ? "write " : "read ") << std::dec << size << " bytes at address: 0x" << std::hex << address << std::endl;
+    exit(1);
+}
+
+#if FASTMEM_ENABLED
+
+// --- Fault handling ---
+
+// A decoded host memory access: one of the MOV forms the compiler or the accessors in
+// fastmem.h produce for a guest load or store.
+struct HostAccess {
+    u8* address;        // Effective address
+    u32 size;           // Bytes accessed
+    u32 length;         // Instruction length
+    bool write;
+    bool xmm;           // Register operand is an XMM register
+    int reg;            // Register operand (x86 encoding, 0-15)
+    bool high_byte;     // reg 4-7 names AH/CH/DH/BH
+    u32 dest_size;      // Loads: bytes written to the register
+    bool sign_extend;
+    bool has_imm;
+    u64 imm;
+};
+
+// x86 register number -> ucontext gregs index.
+static const int gpr_index[16] = {
+    REG_RAX, REG_RCX, REG_RDX, REG_RBX, REG_RSP, REG_RBP, REG_RSI, REG_RDI,
+    REG_R8,  REG_R9,  REG_R10, REG_R11, REG_R12, REG_R13, REG_R14, REG_R15,
+};
+
+static u64 read_gpr(const ucontext_t* uc, int reg) {
+    return (u64)uc->uc_mcontext.gregs[gpr_index[reg]];
+}
+
+// Decodes the ModRM/SIB/displacement at `p` into an effective address.
+// Returns the number of bytes consumed.
+static u32 decode_modrm(const u8* p, u8 rex, const ucontext_t* uc, u32 imm_size, u32 prefix_and_opcode, HostAccess& access) {
+    const u8 modrm = p[0];
+    const u32 mod = modrm >> 6;
+    const u32 rm = modrm & 7;
+    u32 used = 1;
+    u64 address = 0;
+
+    access.reg = ((modrm >> 3) & 7) | ((rex & 4) ? 8 : 0);
+    if (rm == 4) {
+        const u8 sib = p[used++];
+        const u32 scale = sib >> 6;
+        const u32 index = ((sib >> 3) & 7) | ((rex & 2) ? 8 : 0);
+        const u32 base = (sib & 7) | ((rex & 1) ? 8 : 0);
+        if (index != 4) {
+            address += read_gpr(uc, index) << scale;
+        }
+        if ((sib & 7) == 5 && mod == 0) {
+            s32 disp;
+            std::memcpy(&disp, p + used, 4);
+            used += 4;
+            address += (s64)disp;
+        } else {
+            address += read_gpr(uc, base);
+        }
+    } else if (rm == 5 && mod == 0) {
+        s32 disp;
+        std::memcpy(&disp, p + used, 4);
+        used += 4;
+        // RIP-relative: relative to the end of the instruction.
+        const u64 rip = (u64)uc->uc_mcontext.gregs[REG_RIP];
+        address = rip + prefix_and_opcode + used + imm_size + (s64)disp;
+    } else {
+        address = read_gpr(uc, rm | ((rex & 1) ? 8 : 0));
+    }
+
+    if (mod == 1) {
+        address += (s64)(s8)p[used];
+        used += 1;
+    } else if (mod == 2) {
+        s32 disp;
+        std::memcpy(&disp, p + used, 4);
+        used += 4;
+        address += (s64)disp;
+    }
+    access.address = (u8*)address;
+    return used;
+}
+
+static bool decode_access(const u8* rip, const ucontext_t* uc, HostAccess& access) {
+    const u8* p = rip;
+    bool opsize = false;
+    bool rep = false;
+    bool repne = false;
+    u8 rex = 0;
+
+    for (;; p++) {
+        if (*p == 0x66) {
+            opsize = true;
+        } else if (*p == 0xF3) {
+            rep = true;
+        } else if (*p == 0xF2) {
+            repne = true;
+        } else if (*p == 0x2E || *p == 0x3E || *p == 0x26 || *p == 0x36 || *p == 0x64 || *p == 0x65) {
+            // Segment overrides do not change anything for a flat user-mode access.
+        } else {
+            break;
+        }
+    }
+    if ((*p & 0xF0) == 0x40) {
+        rex = *p++;
+    }
+    const bool wide = (rex & 8) != 0;
+    const u32 gpr_size = wide ? 8 : (opsize ? 2 : 4);
+
+    access = {};
+    u32 imm_size = 0;
+    const u8 op = *p++;
+    if (op == 0x0F) {
+        const u8 op2 = *p++;
+        switch (op2) {
+            case 0xB6: case 0xB7: case 0xBE: case 0xBF:   // MOVZX/MOVSX
+                access.size = (op2 & 1) ? 2 : 1;
+                access.dest_size = wide ? 8 : 4;
+                access.sign_extend = op2 >= 0xBE;
+                break;
+            case 0x10: case 0x11:                         // MOVUPS/MOVUPD/MOVSS/MOVSD
+                access.xmm = true;
+                access.size = rep ? 4 : (repne ? 8 : 16);
+                access.write = op2 == 0x11;
+                break;
+            case 0x28: case 0x29:                         // MOVAPS/MOVAPD
+                access.xmm = true;
+                access.size = 16;
+                access.write = op2 == 0x29;
+                break;
+            case 0x6F: case 0x7F:                         // MOVDQA/MOVDQU
+                if (!opsize && !rep) {
+                    return false;                         // MMX
+                }
+                access.xmm = true;
+                access.size = 16;
+                access.write = op2 == 0x7F;
+                break;
+            case 0x6E:                                    // MOVD/MOVQ xmm, m
+                if (!opsize) {
+                    return false;
+                }
+                access.xmm = true;
+                access.size = wide ? 8 : 4;
+                break;
+            case 0x7E:                                    // MOVQ xmm, m / MOVD m, xmm
+                access.xmm = true;
+                if (rep) {
+                    access.size = 8;
+                } else if (opsize) {
+                    access.size = wide ? 8 : 4;
+                    access.write = true;
+                } else {
+                    return false;
+                }
+                break;
+            case 0xD6:                                    // MOVQ m, xmm
+                if (!opsize) {
+                    return false;
+                }
+                access.xmm = true;
+                access.size = 8;
+                access.write = true;
+                break;
+            default:
+                return false;
+        }
+    } else {
+        switch (op) {
+            case 0x8A:                                    // MOV r8, m8
+                access.size = 1;
+                break;
+            case 0x8B:                                    // MOV r, m
+                access.size = gpr_size;
+                break;
+            case 0x63:                                    // MOVSXD r64, m32
+                if (!wide) {
+                    return false;
+                }
+                access.size = 4;
+                access.dest_size = 8;
+                access.sign_extend = true;
+                break;
+            case 0x88:                                    // MOV m8, r8
+                access.size = 1;
+                access.write = true;
+                break;
+            case 0x89:                                    // MOV m, r
+                access.size = gpr_size;
+                access.write = true;
+                break;
+            case 0xC6:                                    // MOV m8, imm8
+                access.size = 1;
+                access.write = true;
+                access.has_imm = true;
+                imm_size = 1;
+                break;
+            case 0xC7:                                    // MOV m, imm16/imm32
+                access.size = gpr_size;
+                access.write = true;
+                access.has_imm = true;
+                imm_size = opsize ? 2 : 4;
+                break;
+            default:
+                return false;
+        }
+    }
+
+    if ((*p >> 6) == 3) {
+        return false;                                     // Register operand, not memory
+    }
+    const u32 prefix_and_opcode = (u32)(p - rip);
+    p += decode_modrm(p, rex, uc, imm_size, prefix_and_opcode, access);
+
+    if (access.has_imm) {
+        switch (imm_size) {
+            case 1: access.imm = *p; break;
+            case 2: { u16 v; std::memcpy(&v, p, 2); access.imm = v; break; }
+            default: { s32 v; std::memcpy(&v, p, 4); access.imm = (u64)(s64)v; break; }
+        }
+        p += imm_size;
+    }
+    if (!access.xmm && access.size == 1 && !rex && access.reg >= 4 && access.reg < 8 && !access.dest_size) {
+        access.high_byte = true;
+        access.reg -= 4;
+    }
+    if (!access.dest_size) {
+        access.dest_size = access.size;
+    }
+    access.length = (u32)(p - rip);
+    return true;
+}
+
+static void complete_load(ucontext_t* uc, const HostAccess& access, const u8* data) {
+    if (access.xmm) {
+        // MOVSS/MOVSD/MOVD/MOVQ loads clear the rest of the register.
+        u8 full[16] = {};
+        std::memcpy(full, data, access.size);
+        std::memcpy(&uc->uc_mcontext.fpregs->_xmm[access.reg], full, 16);
+        return;
+    }
+
+    greg_t& reg = uc->uc_mcontext.gregs[gpr_index[access.reg]];
+    u64 value = 0;
+    std::memcpy(&value, data, access.size);
+    if (access.sign_extend) {
+        const u32 shift = 64 - access.size * 8;
+        value = (u64)(((s64)(value << shift)) >> shift);
+    }
+    switch (access.dest_size) {
+        case 1:
+            if (access.high_byte) {
+                reg = (greg_t)(((u64)reg & ~0xFF00ull) | ((value & 0xFF) << 8));
+            } else {
+                reg = (greg_t)(((u64)reg & ~0xFFull) | (value & 0xFF));
+            }
+            break;
+        case 2:
+            reg = (greg_t)(((u64)reg & ~0xFFFFull) | (value & 0xFFFF));
+            break;
+        case 4:
+            reg = (greg_t)(value & 0xFFFFFFFF);   // 32-bit writes zero the upper half
+            break;
+        default:
+            reg = (greg_t)value;
+            break;
+    }
+}
+
+static void store_value(const ucontext_t* uc, const HostAccess& access, u8* data) {
+    if (access.has_imm) {
+        std::memcpy(data, &access.imm, access.size);
+    } else if (access.xmm) {
+        std::memcpy(data, &uc->uc_mcontext.fpregs->_xmm[access.reg], access.size);
+    } else {
+        u64 value = read_gpr(uc, access.reg);
+        if (access.high_byte) {
+            value >>= 8;
+        }
+        std::memcpy(data, &value, access.size);
+    }
+}
+
+static struct sigaction previous_segv_action;
+
+static void forward_signal(int signal, siginfo_t* info, void* context) {
+    if (previous_segv_action.sa_flags & SA_SIGINFO) {
+        previous_segv_action.sa_sigaction(signal, info, context);
+        return;
+    }
+    if (previous_segv_action.sa_handler != SIG_DFL && previous_segv_action.sa_handler != SIG_IGN) {
+        previous_segv_action.sa_handler(signal);
+        return;
+    }
+    // Not ours and nobody else wants it: restore the default action and let the access
+    // fault again.
+    struct sigaction action = {};
+    action.sa_handler = SIG_DFL;
+    sigaction(signal, &action, nullptr);
+}
+
+static void on_segv(int signal, siginfo_t* info, void* context) {
+    ucontext_t* uc = static_cast<ucontext_t*>(context);
+    u8* fault = static_cast<u8*>(info->si_addr);
+    if (!fastmem_base || fault < fastmem_base || fault >= fastmem_base + fastmem::ADDRESS_SPACE_SIZE) {
+        forward_signal(signal, info, context);
+        return;
+    }
+
+    // A store to a write-protected code page (see smc.h): once the hook has made the
+    // page writable, the store just runs again.
+    const bool write_fault = (uc->uc_mcontext.gregs[REG_ERR] & 2) != 0;
+    if (write_fault && space->write_fault_hook && space->write_fault_hook((u32)(fault - fastmem_base))) {
+        return;
+    }
+
+    const u8* rip = (const u8*)uc->uc_mcontext.gregs[REG_RIP];
+    HostAccess access;
+    if (!decode_access(rip, uc, access)) {
+        std::cerr << "FATAL_ERROR: Could not decode faulting host instruction at " << (const void*)rip << std::endl;
+        memory_access_fault((u32)(fault - fastmem_base), 0, false);
+    }
+
+    const u32 address = (u32)(access.address - fastmem_base);
+    u8 data[16] = {};
+    if (access.write) {
+        store_value(uc, access, data);
+        if (!mmio_write(address, access.size, data)) {
+            memory_access_fault(address, access.size, true);
+        }
+    } else {
+        if (!mmio_read(address, access.size, data)) {
+            memory_access_fault(address, access.size, false);
+        }
+        complete_load(uc, access, data);
+    }
+    uc->uc_mcontext.gregs[REG_RIP] += access.length;
+}
+
+// --- Mapping ---
+
+// Points the host view of [address, address + size) at `fd` + offset, or at nothing.
+static bool remap_host(FastmemSpace& target, u32 address, u64 size, int fd, u32 offset) {
+    void* at = target.base + address;
+    void* result = fd >= 0
+        ? mmap(at, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, offset)
+        : mmap(at, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+    return result != MAP_FAILED;
+}
+
+// Puts [address, address + size) back to the fixed layout, one region at a time.
+static bool restore_host(FastmemSpace& target, u32 address, u64 size) {
+    u64 current = address;
+    const u64 end = current + size;
+    while (current < end) {
+        int fd = -1;
+        u32 offset = 0;
+        u64 region_end = fastmem::ADDRESS_SPACE_SIZE;
+        for (u32 mirror : fastmem::RAM_MIRRORS) {
+            if (current >= mirror && current < (u64)mirror + fastmem::RAM_SIZE) {
+                fd = target.ram_fd;
+                offset = (u32)(current - mirror);
+                region_end = (u64)mirror + fastmem::RAM_SIZE;
+            } else if (mirror > current && mirror < region_end) {
+                region_end = mirror;
+            }
+        }
+        if (current >= fastmem::SCRATCHPAD_START && current < (u64)fastmem::SCRATCHPAD_START + fastmem::SCRATCHPAD_SIZE) {
+            fd = target.scratchpad_fd;
+            offset = (u32)(current - fastmem::SCRATCHPAD_START);
+            region_end = (u64)fastmem::SCRATCHPAD_START + fastmem::SCRATCHPAD_SIZE;
+        } else if (fastmem::SCRATCHPAD_START > current && fastmem::SCRATCHPAD_START < region_end) {
+            region_end = fastmem::SCRATCHPAD_START;
+        }
+
+        const u64 chunk_end = region_end < end ? region_end : end;
+        if (!remap_host(target, (u32)current, chunk_end - current, fd, offset)) {
+            return false;
+        }
+        current = chunk_end;
+    }
+    return true;
+}
+
+// The handler is process-wide; it finds the faulting thread's space through `space`.
+static bool install_segv_handler() {
+    static std::once_flag once;
+    static bool installed = false;
+    std::call_once(once, [] {
+        struct sigaction action = {};
+        action.sa_sigaction = &on_segv;
+        action.sa_flags = SA_SIGINFO | SA_NODEFER;
+        sigemptyset(&action.sa_mask);
+        installed = sigaction(SIGSEGV, &action, &previous_segv_action) == 0;
+    });
+    return installed;
+}
+
+static void unmap_address_space(FastmemSpace& target) {
+    if (target.base) {
+        munmap(target.base, fastmem::ADDRESS_SPACE_SIZE);
+    }
+    if (target.ram_fd >= 0) {
+        close(target.ram_fd);
+    }
+    if (target.scratchpad_fd >= 0) {
+        close(target.scratchpad_fd);
+    }
+}
+
+static bool map_address_space(FastmemSpace& target) {
+    void* reserved = mmap(nullptr, fastmem::ADDRESS_SPACE_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (reserved == MAP_FAILED) {
+        return false;
+    }
+    target.base = static_cast<u8*>(reserved);
+
+    target.ram_fd = memfd_create("ee_ram", MFD_CLOEXEC);
+    target.scratchpad_fd = memfd_create("ee_scratchpad", MFD_CLOEXEC);
+    if (target.ram_fd < 0 || target.scratchpad_fd < 0 ||
+        ftruncate(target.ram_fd, fastmem::RAM_SIZE) != 0 || ftruncate(target.scratchpad_fd, fastmem::SCRATCHPAD_SIZE) != 0 ||
+        !restore_host(target, 0, fastmem::ADDRESS_SPACE_SIZE) || !install_segv_handler()) {
+        unmap_address_space(target);
+        return false;
+    }
+
+    target.ram = target.base;
+    target.scratchpad = target.base + fastmem::SCRATCHPAD_START;
+    return true;
+}
+
+#endif // FASTMEM_ENABLED
+
+void fastmem_map_pages(u32 address, u32 size, PageTarget target, u32 offset) {
+    if (!space) {
+        std::cerr << "FATAL_ERROR: Could not map TLB page at 0x" << std::hex << address
+                  << ": no address space is bound to this thread." << std::endl;
+        exit(1);
+    }
+    if (!space->page_table) {
+        space->page_table = new uintptr_t[fastmem::PAGE_COUNT]();
+    }
+    for (u32 page = 0; page < size; page += fastmem::PAGE_SIZE) {
+        uintptr_t& entry = space->page_table[(address + page) >> fastmem::PAGE_SHIFT];
+        switch (target) {
+            case PageTarget::Ram: entry = reinterpret_cast<uintptr_t>(ram_memory + offset + page); break;
+            case PageTarget::Scratchpad: entry = reinterpret_cast<uintptr_t>(scratchpad_memory + offset + page); break;
+            case PageTarget::Device: entry = (uintptr_t)(offset + page) | PAGE_DEVICE; break;
+        }
+    }
+
+#if FASTMEM_ENABLED
+    const int fd = target == PageTarget::Ram ? space->ram_fd : target == PageTarget::Scratchpad ? space->scratchpad_fd : -1;
+    if (!remap_host(*space, address, size, fd, offset)) {
+        std::cerr << "FATAL_ERROR: Could not map TLB page at 0x" << std::hex << address << std::endl;
+        exit(1);
+    }
+#endif
+}
+
+void fastmem_unmap_pages(u32 address, u32 size) {
+    if (!space || !space->page_table) {
+        return;
+    }
+    for (u32 page = 0; page < size; page += fastmem::PAGE_SIZE) {
+        space->page_table[(address + page) >> fastmem::PAGE_SHIFT] = 0;
+    }
+
+#if FASTMEM_ENABLED
+    if (!restore_host(*space, address, size)) {
+        std::cerr << "FATAL_ERROR: Could not unmap TLB page at 0x" << std::hex << address << std::endl;
+        exit(1);
+    }
+#endif
+}
+
+FastmemSpace* fastmem_create() {
+    FastmemSpace* created = new FastmemSpace();
+#if FASTMEM_ENABLED
+    if (!map_address_space(*created)) {
+        delete created;
+        return nullptr;
+    }
+#else
+    created->ram = new u8[fastmem::RAM_SIZE]();
+    created->scratchpad = static_cast<u8*>(::operator new(fastmem::SCRATCHPAD_SIZE, std::align_val_t(fastmem::SCRATCHPAD_SIZE)));
+    std::memset(created->scratchpad, 0, fastmem::SCRATCHPAD_SIZE);
+#endif
+    return created;
+}
+
+void fastmem_destroy(FastmemSpace* destroyed) {
+    if (!destroyed) {
+        return;
+    }
+    if (destroyed == space) {
+        fastmem_bind(nullptr);
+    }
+#if FASTMEM_ENABLED
+    unmap_address_space(*destroyed);
+#else
+    delete[] destroyed->ram;
+    ::operator delete(destroyed->scratchpad, std::align_val_t(fastmem::SCRATCHPAD_SIZE));
+#endif
+    delete[] destroyed->page_table;
+    delete destroyed;
+}
+
+bool fastmem_init() {
+    if (space) {
+        return true;
+    }
+    FastmemSpace* created = fastmem_create();
+    if (!created) {
+        return false;
+    }
+    fastmem_bind(created);
+    return true;
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "cpu_state.h"
+
+// Fastmem: the EE's 32-bit address space laid out 1:1 in one 4 GB block of host address
+// space, so a guest access is a single host load/store at fastmem_base + address.
+//
+// The 32 MB of RAM is one shared memory object mapped at every place the EE sees it
+// (0x00000000, the uncached mirrors at 0x20000000/0x30000000, KSEG0 at 0x80000000 and
+// KSEG1 at 0xA0000000), and the scratchpad is mapped at 0x70000000. Everything else is
+// left PROT_NONE. An access there faults, and the SIGSEGV handler decodes the faulting
+// host instruction, performs the access through the MMIO handlers and resumes after it.
+// Pages the game maps through the TLB (see tlb.h) are remapped on top of that layout.
+//
+// Hosts without mmap/SIGSEGV support (anything but x86-64 Linux for now) fall back to
+// translating each address in software.
+//
+// Each EE instance (see runtime.h) has its own address space. Memory accesses go to the
+// space bound to the calling thread, so a process can run one instance per thread.
+
+#if defined(__linux__) && defined(__x86_64__)
+#define FASTMEM_ENABLED 1
+#else
+#define FASTMEM_ENABLED 0
+#endif
+
+#if FASTMEM_ENABLED
+#include <emmintrin.h>
+#include <cstring>
+#endif
+
+// Per-thread state. __thread where the compiler has it, since thread_local may put a
+// lazy-initialisation check in front of every guest memory access.
+#if defined(__GNUC__)
+#define FASTMEM_TLS __thread
+#else
+#define FASTMEM_TLS thread_local
+#endif
+
+namespace fastmem {
+    constexpr u32 RAM_SIZE = 32 * 1024 * 1024;
+    constexpr u32 SCRATCHPAD_START = 0x70000000;
+    constexpr u32 SCRATCHPAD_SIZE = 16 * 1024;
+    constexpr u32 RAM_MIRRORS[] = { 0x00000000, 0x20000000, 0x30000000, 0x80000000, 0xA0000000 };
+    constexpr u64 ADDRESS_SPACE_SIZE = 1ull << 32;
+
+    // Granule of the software page table that TLB mappings are kept in.
+    constexpr u32 PAGE_SHIFT = 12;
+    constexpr u32 PAGE_SIZE = 1u << PAGE_SHIFT;
+    constexpr u32 PAGE_COUNT = (u32)(ADDRESS_SPACE_SIZE >> PAGE_SHIFT);
+}
+
+// What a TLB-mapped range of guest pages is backed by.
+enum class PageTarget {
+    Ram,            // RAM at a physical offset
+    Scratchpad,     // The scratchpad (EntryLo.S)
+    Device,         // Passed to the MMIO handlers with the physical address
+};
+
+// Device side of accesses that do not hit RAM or the scratchpad. KSEG0/KSEG1 addresses
+// are passed on as physical addresses. Return false if nothing is mapped at `address`.
+using MmioReadHandler = bool (*)(u32 address, u32 size, void* value);
+using MmioWriteHandler = bool (*)(u32 address, u32 size, const void* value);
+
+// One guest address space: RAM, the scratchpad, TLB mappings and the device handlers.
+struct FastmemSpace;
+
+// For the space bound to the calling thread:
+// Host address of guest address 0 (nullptr when fastmem is not available).
+extern FASTMEM_TLS u8* fastmem_base;
+
+// The 32 MB of RAM (at fastmem_base with fastmem).
+extern FASTMEM_TLS u8* ram_memory;
+
+// The 16 KB scratchpad buffer (at fastmem_base + SCRATCHPAD_START with fastmem). SPR DMA
+// and recompiled scratchpad accesses use it directly.
+extern FASTMEM_TLS u8* scratchpad_memory;
+
+/**
+ * @brief Reserves an address space and maps RAM and the scratchpad into it. The first
+ * call also installs the SIGSEGV handler.
+ * @return nullptr if the host refused the mappings.
+ */
+FastmemSpace* fastmem_create();
+
+// Unmaps a space. It must not be bound to any thread.
+void fastmem_destroy(FastmemSpace* space);
+
+/**
+ * @brief Makes `space` the one the calling thread's accesses go to (nullptr unbinds).
+ * A space must only be used by one thread at a time.
+ */
+void fastmem_bind(FastmemSpace* space);
+
+FastmemSpace* fastmem_current();
+
+/**
+ * @brief Gives the calling thread a space of its own if it has none bound yet. Safe to
+ * call more than once.
+ * @return false if the host refused the mappings.
+ */
+bool fastmem_init();
+
+u8* fastmem_ram();
+u8* fastmem_scratchpad();
+
+// The device handlers of the current space. False if the thread has no space bound.
+bool fastmem_set_mmio_handlers(MmioReadHandler read, MmioWriteHandler write);
+
+/**
+ * @brief Software translation of a guest address to the RAM or scratchpad backing it.
+ * Pages mapped through the TLB cost one page table lookup; everything else uses the
+ * fixed layout above.
+ * @return nullptr if [address, address + size) is not entirely RAM or scratchpad, or the
+ * thread has no space bound.
+ */
+u8* fastmem_translate(u32 address, u32 size);
+
+/**
+ * @brief Maps [address, address + size) (page aligned) onto `target` at `offset`, as a
+ * TLB entry does. With fastmem the host view is remapped too, so these pages still take
+ * a single host load/store. Fatal if the thread has no space bound.
+ */
+void fastmem_map_pages(u32 address, u32 size, PageTarget target, u32 offset);
+
+/**
+ * @brief Drops TLB mappings for [address, address + size), going back to the fixed layout.
+ */
+void fastmem_unmap_pages(u32 address, u32 size);
+
+// Called for write faults inside the fastmem region before they are treated as device
+// accesses. Returns true if it made the page writable and the write can be retried.
+using WriteFaultHook = bool (*)(u32 address);
+
+bool fastmem_set_write_fault_hook(WriteFaultHook hook);     // Current space; false if none is bound
+
+/**
+ * @brief Makes one 4 KB page of RAM read-only or writable again, at every RAM mirror.
+ * @param offset Offset of the page into RAM.
+ * @return false without fastmem, where pages cannot be protected.
+ */
+bool fastmem_protect_ram_page(u32 offset, bool writable);
+
+// fastmem_protect_ram_page() for the whole pages of [offset, offset + size), with one
+// mprotect() per mirror.
+bool fastmem_protect_ram_range(u32 offset, u32 size, bool writable);
+
+// Accesses through the MMIO handlers; false when nothing handles `address`.
+bool mmio_read(u32 address, u32 size, void* value);
+bool mmio_write(u32 address, u32 size, const void* value);
+
+/**
+ * @brief Reports an access to unmapped memory and terminates.
+ */
+[[noreturn]] void memory_access_fault(u32 address, u32 size, bool write);
+
+#if FASTMEM_ENABLED
+// Guest accesses. Written as inline assembly so they always stay a single plain MOV
+// (never folded into an ALU instruction or split up by the compiler), which is what the
+// SIGSEGV handler knows how to decode and emulate.
+
+inline u8 fastmem_read8(u32 address) {
+    u32 value;
+    asm volatile("movzbl %1, %0" : "=r"(value) : "m"(*(const u8*)(fastmem_base + address)));
+    return (u8)value;
+}
+
+inline u16 fastmem_read16(u32 address) {
+    u32 value;
+    asm volatile("movzwl %1, %0" : "=r"(value) : "m"(*(const u16*)(fastmem_base + address)));
+    return (u16)value;
+}
+
+inline u32 fastmem_read32(u32 address) {
+    u32 value;
+    asm volatile("movl %1, %0" : "=r"(value) : "m"(*(const u32*)(fastmem_base + address)));
+    return value;
+}
+
+inline u64 fastmem_read64(u32 address) {
+    u64 value;
+    asm volatile("movq %1, %0" : "=r"(value) : "m"(*(const u64*)(fastmem_base + address)));
+    return value;
+}
+
+inline u128 fastmem_read128(u32 address) {
+    __m128i value;
+    asm volatile("movdqu %1, %0" : "=x"(value) : "m"(*(const __m128i*)(fastmem_base + address)));
+    u128 result;
+    std::memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+inline void fastmem_write8(u32 address, u8 value) {
+    asm volatile("movb %1, %0" : "=m"(*(u8*)(fastmem_base + address)) : "q"(value));
+}
+
+inline void fastmem_write16(u32 address, u16 value) {
+    asm volatile("movw %1, %0" : "=m"(*(u16*)(fastmem_base + address)) : "r"(value));
+}
+
+inline void fastmem_write32(u32 address, u32 value) {
+    asm volatile("movl %1, %0" : "=m"(*(u32*)(fastmem_base + address)) : "r"(value));
+}
+
+inline void fastmem_write64(u32 address, u64 value) {
+    asm volatile("movq %1, %0" : "=m"(*(u64*)(fastmem_base + address)) : "r"(value));
+}
+
+inline void fastmem_write128(u32 address, const u128& value) {
+    __m128i data;
+    std::memcpy(&data, &value, sizeof(data));
+    asm volatile("movdqu %1, %0" : "=m"(*(__m128i*)(fastmem_base + address)) : "x"(data));
+}
+#endif
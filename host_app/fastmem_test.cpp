@@ -0,0 +1,155 @@
+#include "gtest/gtest.h"
+#include "memory.h"
+#include "fastmem.h"
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Records device accesses and answers reads with a fixed pattern.
+struct MmioLog {
+    u32 address;
+    u32 size;
+    u64 value;
+    bool write;
+};
+std::vector<MmioLog> mmio_log;
+
+bool is_device(u32 address) {
+    return address >= 0x10000000 && address < 0x10010000;
+}
+
+bool on_mmio_read(u32 address, u32 size, void* value) {
+    if (!is_device(address)) {
+        return false;
+    }
+    mmio_log.push_back({ address, size, 0, false });
+    const u64 pattern = 0x8877665544332211ull;
+    std::memcpy(value, &pattern, size < 8 ? size : 8);
+    return true;
+}
+
+bool on_mmio_write(u32 address, u32 size, const void* value) {
+    if (!is_device(address)) {
+        return false;
+    }
+    u64 data = 0;
+    std::memcpy(&data, value, size < 8 ? size : 8);
+    mmio_log.push_back({ address, size, data, true });
+    return true;
+}
+
+class FastmemTest : public ::testing::Test {
+protected:
+    FastmemTest() {
+        EXPECT_TRUE(fastmem_init());
+        fastmem_set_mmio_handlers(&on_mmio_read, &on_mmio_write);
+        mmio_log.clear();
+    }
+    ~FastmemTest() override {
+        fastmem_set_mmio_handlers(nullptr, nullptr);
+    }
+};
+
+using FastmemDeathTest = FastmemTest;
+
+} // namespace
+
+TEST_F(FastmemTest, RamIsVisibleAtEveryMirror) {
+    // 1. Arrange
+    const u32 test_value = 0xCAFEF00D;
+
+    // 2. Act: write through one mirror.
+    WriteMemory32(0x00001000, test_value);
+
+    // 3. Assert: every other mirror sees the same memory.
+    EXPECT_EQ(ReadMemory32(0x20001000), test_value);
+    EXPECT_EQ(ReadMemory32(0x30001000), test_value);
+    EXPECT_EQ(ReadMemory32(0x80001000), test_value);
+    EXPECT_EQ(ReadMemory32(0xA0001000), test_value);
+
+    WriteMemory8(0xA0001003, 0x11);
+    EXPECT_EQ(main_memory[0x1003], 0x11);
+}
+
+TEST_F(FastmemTest, ScratchpadIsSeparateFromRam) {
+    WriteMemory64(fastmem::SCRATCHPAD_START + 0x10, 0x0123456789ABCDEFull);
+    EXPECT_EQ(ReadMemory64(fastmem::SCRATCHPAD_START + 0x10), 0x0123456789ABCDEFull);
+    EXPECT_EQ(fastmem_scratchpad()[0x10], 0xEF);
+    EXPECT_EQ(ReadScratchpad<u64>(0x10), 0x0123456789ABCDEFull);
+    WriteScratchpad<u32>(0x3FFC, 0x600DF00D);
+    EXPECT_EQ(ReadMemory32(fastmem::SCRATCHPAD_START + 0x3FFC), 0x600DF00Du);
+    EXPECT_NE(ReadMemory64(0x10), 0x0123456789ABCDEFull);
+}
+
+TEST_F(FastmemTest, DeviceAccessesGoToMmioHandlers) {
+    EXPECT_EQ(ReadMemory32(0x10000000), 0x44332211u);
+    WriteMemory16(0xB0001010, 0xBEEF);     // KSEG1 view of 0x10001010
+
+    ASSERT_EQ(mmio_log.size(), 2u);
+    EXPECT_FALSE(mmio_log[0].write);
+    EXPECT_EQ(mmio_log[0].address, 0x10000000u);
+    EXPECT_EQ(mmio_log[0].size, 4u);
+    EXPECT_TRUE(mmio_log[1].write);
+    EXPECT_EQ(mmio_log[1].address, 0x10001010u);
+    EXPECT_EQ(mmio_log[1].size, 2u);
+    EXPECT_EQ(mmio_log[1].value, 0xBEEFu);
+
+    // The rest of the register file is untouched by the emulated access.
+    u128 quad = ReadMemory128(0x10000100);
+    EXPECT_EQ(quad.UD[0], 0x8877665544332211ull);
+}
+
+#if FASTMEM_ENABLED
+TEST_F(FastmemTest, CompilerGeneratedAccessesAreEmulated) {
+    // Plain C++ pointer accesses let the compiler pick the encoding (immediate stores,
+    // sign extension, base+index addressing).
+    volatile u32* reg32 = reinterpret_cast<volatile u32*>(fastmem_base + 0x10002000);
+    volatile s8* reg8 = reinterpret_cast<volatile s8*>(fastmem_base + 0x10002010);
+
+    *reg32 = 0x12345678;
+    const s64 extended = *reg8;
+
+    ASSERT_EQ(mmio_log.size(), 2u);
+    EXPECT_EQ(mmio_log[0].value, 0x12345678u);
+    EXPECT_EQ(mmio_log[1].size, 1u);
+    EXPECT_EQ(extended, 0x11);
+}
+#endif
+
+TEST(FastmemUnboundTest, ThreadsWithoutASpaceFailCleanly) {
+    // 1. Arrange: a thread that never bound a space.
+    bool translated = true, read = true, written = true, handlers = true, hook = true;
+    u32 value = 0;
+
+    // 2. Act
+    std::thread thread([&] {
+        translated = fastmem_translate(0x00100000, 4) != nullptr;
+        read = mmio_read(0x10000000, 4, &value);
+        written = mmio_write(0x10000000, 4, &value);
+        handlers = fastmem_set_mmio_handlers(&on_mmio_read, &on_mmio_write);
+        hook = fastmem_set_write_fault_hook(nullptr);
+        fastmem_unmap_pages(0x00100000, fastmem::PAGE_SIZE);
+    });
+    thread.join();
+
+    // 3. Assert
+    EXPECT_FALSE(translated);
+    EXPECT_FALSE(read);
+    EXPECT_FALSE(written);
+    EXPECT_FALSE(handlers);
+    EXPECT_FALSE(hook);
+}
+
+TEST(FastmemUnboundDeathTest, MappingPagesWithoutASpaceIsFatal) {
+    ASSERT_DEATH({
+        std::thread thread([] { fastmem_map_pages(0x00100000, fastmem::PAGE_SIZE, PageTarget::Ram, 0); });
+        thread.join();
+    }, "no address space is bound");
+}
+
+TEST_F(FastmemDeathTest, UnmappedAccessIsFatal) {
+    ASSERT_DEATH({
+        ReadMemory32(0x04000000);
+    }, "Out-of-bounds memory read");
+}
@@ -0,0 +1,133 @@
+#include "fiber.h"
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#define FIBER_ASM_SWITCH 1
+#else
+#define FIBER_ASM_SWITCH 0
+#include <ucontext.h>
+#endif
+
+#if FIBER_ASM_SWITCH
+// fiber_switch(&from->context, to->context): pushes the System V callee-saved registers,
+// stores the stack pointer, loads the other one and pops its registers. A fresh fiber's
+// stack is laid out by reset() so that this "returns" into fiber_trampoline, with the
+// function to call in r12 and its argument in r13.
+extern "C" void fiber_switch(void** from, void* to);
+extern "C" void fiber_trampoline();
+
+asm(R"(
+    .text
+    .globl fiber_switch
+    .type fiber_switch, @function
+fiber_switch:
+    pushq %rbp
+    pushq %rbx
+    pushq %r12
+    pushq %r13
+    pushq %r14
+    pushq %r15
+    movq %rsp, (%rdi)
+    movq %rsi, %rsp
+    popq %r15
+    popq %r14
+    popq %r13
+    popq %r12
+    popq %rbx
+    popq %rbp
+    ret
+    .size fiber_switch, .-fiber_switch
+
+    .globl fiber_trampoline
+    .type fiber_trampoline, @function
+fiber_trampoline:
+    movq %r13, %rdi
+    callq *%r12
+    ud2
+    .size fiber_trampoline, .-fiber_trampoline
+)");
+#else
+// makecontext() only passes ints.
+void fiber_ucontext_start(unsigned int high, unsigned int low) {
+    Fiber::start(reinterpret_cast<Fiber*>(((uintptr_t)high << 32) | low));
+}
+#endif
+
+Fiber::Fiber() : context(nullptr), stack(nullptr), stack_size(0), entry(nullptr), user(nullptr) {
+#if !FIBER_ASM_SWITCH
+    context = new ucontext_t();
+#endif
+}
+
+Fiber::Fiber(Entry entry, void* user, size_t stack_size)
+    : context(nullptr), stack(nullptr), stack_size(stack_size), entry(entry), user(user) {
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    this->stack_size = (stack_size + page - 1) & ~(page - 1);
+    void* mapping = mmap(nullptr, this->stack_size + page, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK, -1, 0);
+    if (mapping == MAP_FAILED || mprotect(mapping, page, PROT_NONE) != 0) {
+        std::cerr << "FATAL_ERROR: Could not map a " << this->stack_size << " byte fiber stack." << std::endl;
+        exit(1);
+    }
+    stack = static_cast<char*>(mapping) + page;
+#if !FIBER_ASM_SWITCH
+    context = new ucontext_t();
+#endif
+    reset();
+}
+
+Fiber::~Fiber() {
+    if (stack) {
+        const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+        munmap(stack - page, stack_size + page);
+    }
+#if !FIBER_ASM_SWITCH
+    delete static_cast<ucontext_t*>(context);
+#endif
+}
+
+void Fiber::start(Fiber* fiber) {
+    fiber->entry(fiber->user);
+    std::cerr << "FATAL_ERROR: A fiber's entry function returned." << std::endl;
+    abort();
+}
+
+void Fiber::reset() {
+    if (!stack) {
+        return;
+    }
+#if FIBER_ASM_SWITCH
+    // What fiber_switch pops: r15, r14, r13, r12, rbx, rbp, then the return address. The
+    // trampoline then starts with the stack 16-byte aligned, as a call expects.
+    const uintptr_t top = ((uintptr_t)stack + stack_size) & ~(uintptr_t)15;
+    void** frame = reinterpret_cast<void**>(top - 9 * sizeof(void*));
+    frame[0] = nullptr;
+    frame[1] = nullptr;
+    frame[2] = this;
+    frame[3] = reinterpret_cast<void*>(&Fiber::start);
+    frame[4] = nullptr;
+    frame[5] = nullptr;
+    frame[6] = reinterpret_cast<void*>(&fiber_trampoline);
+    context = frame;
+#else
+    ucontext_t* uc = static_cast<ucontext_t*>(context);
+    getcontext(uc);
+    uc->uc_stack.ss_sp = stack;
+    uc->uc_stack.ss_size = stack_size;
+    uc->uc_link = nullptr;
+    const uintptr_t self = reinterpret_cast<uintptr_t>(this);
+    makecontext(uc, reinterpret_cast<void (*)()>(&fiber_ucontext_start), 2, (unsigned int)(self >> 32), (unsigned int)self);
+#endif
+}
+
+void Fiber::switch_to(Fiber& next) {
+#if FIBER_ASM_SWITCH
+    fiber_switch(&context, next.context);
+#else
+    swapcontext(static_cast<ucontext_t*>(context), static_cast<ucontext_t*>(next.context));
+#endif
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+
+// Host fibers: separate stacks switched between on one host thread, with no OS thread or
+// system call involved.
+//
+// Recompiled functions call each other on the host stack, so an EE thread that blocks
+// in the middle of a call tree keeps that whole tree on its stack; switching EE threads
+// means switching host stacks. Each EE thread gets a fiber, and the kernel switches
+// between them (see kernel.h).
+//
+// On x86-64 a switch saves the callee-saved registers and swaps the stack pointer, in a
+// handful of instructions. Elsewhere it falls back to ucontext, which also saves the
+// signal mask (a system call per switch).
+//
+// Stacks are mapped with MAP_NORESERVE, so only the part a fiber actually uses costs
+// memory, and an inaccessible guard page below each one turns an overflow into a crash
+// instead of silently corrupting whatever is mapped below.
+
+class Fiber {
+public:
+    using Entry = void (*)(void* user);
+
+    static constexpr size_t DEFAULT_STACK_SIZE = 1024 * 1024;
+
+    // The fiber the calling host thread is already running on, on its own stack.
+    Fiber();
+
+    /**
+     * @brief A fiber with a stack of its own that starts in `entry(user)` the first time
+     * it is switched to. `entry` must never return; it switches away for good instead.
+     */
+    Fiber(Entry entry, void* user, size_t stack_size = DEFAULT_STACK_SIZE);
+    ~Fiber();
+
+    Fiber(const Fiber&) = delete;
+    Fiber& operator=(const Fiber&) = delete;
+
+    /**
+     * @brief Makes the fiber start over at `entry(user)` the next time it is switched
+     * to, dropping whatever was on its stack. Not for the running fiber.
+     */
+    void reset();
+
+    /**
+     * @brief Suspends this fiber, which must be the running one, and continues `next`.
+     * Returns once something switches back to this fiber.
+     */
+    void switch_to(Fiber& next);
+
+    bool owns_stack() const { return stack != nullptr; }
+
+private:
+    friend void fiber_ucontext_start(unsigned int high, unsigned int low);
+
+    static void start(Fiber* fiber);
+
+    void* context;          // Saved stack pointer (x86-64) or ucontext_t
+    char* stack;            // Lowest usable byte; the guard page is right below it
+    size_t stack_size;
+    Entry entry;
+    void* user;
+};
@@ -0,0 +1,69 @@
+#include <benchmark/benchmark.h>
+#include "fiber.h"
+#include "runtime.h"
+#include "memory.h"
+
+// Cost of switching EE threads: the bare fiber switch, and a whole kernel round trip
+// (RotateThreadReadyQueue between two threads of one priority), which adds the syscall,
+// the ready queue and saving and loading the EE registers.
+
+namespace {
+
+struct PingPong {
+    Fiber main;
+    Fiber* worker = nullptr;
+};
+
+void bounce(void* user) {
+    PingPong& state = *static_cast<PingPong*>(user);
+    for (;;) {
+        state.worker->switch_to(state.main);
+    }
+}
+
+void BM_FiberSwitch(benchmark::State& state) {
+    PingPong pingpong;
+    Fiber worker(&bounce, &pingpong);
+    pingpong.worker = &worker;
+    for (auto _ : state) {
+        pingpong.main.switch_to(worker);
+    }
+    state.SetItemsProcessed(state.iterations() * 2);    // There and back
+}
+BENCHMARK(BM_FiberSwitch);
+
+constexpr u32 PARAM = 0x00100000;
+constexpr u32 ROTATOR = 0x00200000;
+constexpr u32 PRIORITY = 10;
+
+void rotate(EmotionEngineState& ctx) {
+    ctx.cpuRegs.GPR.n.a0.SD[0] = PRIORITY;
+    ctx.cpuRegs.GPR.n.v1.SD[0] = SYS_ROTATE_THREAD_READY_QUEUE;
+    cpu_syscall(ctx);
+}
+
+void rotator(EmotionEngineState* ctx) {
+    for (;;) {
+        rotate(*ctx);
+    }
+}
+
+void BM_ThreadSwitch(benchmark::State& state) {
+    register_function(ROTATOR, &rotator);
+    EEInstance instance;
+    instance.bind();
+    WriteMemory32(PARAM + kernel::thread_param::FUNC, ROTATOR);
+    WriteMemory32(PARAM + kernel::thread_param::STACK, 0x00400000);
+    WriteMemory32(PARAM + kernel::thread_param::STACK_SIZE, 0x1000);
+    WriteMemory32(PARAM + kernel::thread_param::INITIAL_PRIORITY, PRIORITY);
+    instance.kernel.change_thread_priority(kernel::MAIN_THREAD, PRIORITY);
+    instance.kernel.start_thread(instance.kernel.create_thread(PARAM), 0);
+
+    for (auto _ : state) {
+        rotate(instance);
+    }
+    state.SetItemsProcessed(state.iterations() * 2);
+}
+BENCHMARK(BM_ThreadSwitch);
+
+} // namespace
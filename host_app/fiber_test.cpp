@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+#include "fiber.h"
+#include <vector>
+
+namespace {
+
+struct PingPong {
+    Fiber main;
+    Fiber* worker = nullptr;
+    std::vector<int> steps;
+};
+
+// Counts up on its own stack, handing back to the main fiber after every step.
+void count_steps(void* user) {
+    PingPong& state = *static_cast<PingPong*>(user);
+    for (int step = 0;; step++) {
+        state.steps.push_back(step);
+        state.worker->switch_to(state.main);
+    }
+}
+
+} // namespace
+
+TEST(FiberTest, AdoptedFiberHasNoStackOfItsOwn) {
+    Fiber adopted;
+    Fiber spawned(&count_steps, nullptr, 64 * 1024);
+
+    EXPECT_FALSE(adopted.owns_stack());
+    EXPECT_TRUE(spawned.owns_stack());
+}
+
+TEST(FiberTest, SwitchesBackAndForthKeepingLocals) {
+    // 1. Arrange
+    PingPong state;
+    Fiber worker(&count_steps, &state);
+    state.worker = &worker;
+
+    // 2. Act
+    for (int i = 0; i < 3; i++) {
+        state.main.switch_to(worker);
+    }
+
+    // 3. Assert: the worker's loop counter survived each trip back to main.
+    EXPECT_EQ(state.steps, (std::vector<int>{ 0, 1, 2 }));
+}
+
+TEST(FiberTest, ResetStartsTheEntryOver) {
+    // 1. Arrange
+    PingPong state;
+    Fiber worker(&count_steps, &state);
+    state.worker = &worker;
+    state.main.switch_to(worker);
+    state.main.switch_to(worker);
+
+    // 2. Act
+    worker.reset();
+    state.main.switch_to(worker);
+
+    // 3. Assert
+    EXPECT_EQ(state.steps, (std::vector<int>{ 0, 1, 0 }));
+}
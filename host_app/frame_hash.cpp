@@ -0,0 +1,156 @@
+#include "frame_hash.h"
+#include "runtime.h"
+#include "state_hash.h"
+#include "state_stream.h"
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr char LOG_MAGIC[8] = { 'E', 'E', 'F', 'R', 'A', 'M', 'E', '1' };
+
+// Frame, then the three hashes, unpadded.
+constexpr size_t RECORD_SIZE = sizeof(u32) + 3 * sizeof(u64);
+
+// A few seconds of frames are written at a time.
+constexpr size_t FLUSH_SIZE = 64 * 1024;
+
+bool write_all(int fd, const u8* data, size_t size) {
+    while (size > 0) {
+        const ssize_t put = ::write(fd, data, size);
+        if (put <= 0) {
+            return false;
+        }
+        data += put;
+        size -= (size_t)put;
+    }
+    return true;
+}
+
+} // namespace
+
+FrameHasher::FrameHasher(EEInstance& instance)
+    : instance(instance), tracker(smc_track_writes()), page_hashes(SMC_PAGE_COUNT), pages_hashed(0), fd(-1),
+      write_failed(false) {}
+
+FrameHasher::~FrameHasher() {
+    stop_log();
+    smc_untrack_writes(tracker);
+}
+
+FrameHash FrameHasher::hash_frame(u32 frame) {
+    // A new tracker starts with every page written, so the first frame hashes them all.
+    u64 written[SMC_PAGE_COUNT / 64];
+    smc_collect_written_pages(tracker, written);
+    pages_hashed = 0;
+    for (u32 word = 0; word < SMC_PAGE_COUNT / 64; word++) {
+        for (u64 bits = written[word]; bits != 0; bits &= bits - 1) {
+            const u32 page = word * 64 + (u32)__builtin_ctzll(bits);
+            page_hashes[page] = state_hash(ram_memory + (page << SMC_PAGE_SHIFT), 1u << SMC_PAGE_SHIFT);
+            pages_hashed++;
+        }
+    }
+
+    FrameHash hash;
+    hash.frame = frame;
+    hash.registers = state_hash(static_cast<const EmotionEngineState*>(&instance), sizeof(EmotionEngineState));
+    hash.ram = state_hash(page_hashes.data(), page_hashes.size() * sizeof(u64));
+    hash.scratchpad = state_hash(scratchpad_memory, fastmem::SCRATCHPAD_SIZE);
+    return hash;
+}
+
+bool FrameHasher::start_log(const std::string& path) {
+    stop_log();
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    write_failed = false;
+    pending.assign(LOG_MAGIC, LOG_MAGIC + sizeof(LOG_MAGIC));
+    instance.set_vsync_hook(&on_vsync, this);
+    return true;
+}
+
+bool FrameHasher::stop_log() {
+    if (fd < 0) {
+        return true;
+    }
+    instance.set_vsync_hook(nullptr, nullptr);
+    const bool ok = flush();
+    const bool closed = close(fd) == 0;
+    fd = -1;
+    return ok && closed;
+}
+
+bool FrameHasher::flush() {
+    if (!write_failed && !write_all(fd, pending.data(), pending.size())) {
+        write_failed = true;
+    }
+    pending.clear();
+    return !write_failed;
+}
+
+void FrameHasher::on_vsync(void* user, u32 frame) {
+    FrameHasher* hasher = static_cast<FrameHasher*>(user);
+    const FrameHash hash = hasher->hash_frame(frame);
+    StateWriter writer(hasher->pending);
+    writer.write(hash.frame);
+    writer.write(hash.registers);
+    writer.write(hash.ram);
+    writer.write(hash.scratchpad);
+    if (hasher->pending.size() >= FLUSH_SIZE) {
+        hasher->flush();
+    }
+}
+
+bool frame_hash_read_log(const std::string& path, std::vector<FrameHash>& hashes) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    std::vector<u8> log;
+    if (fstat(fd, &info) == 0) {
+        log.resize((size_t)info.st_size);
+    }
+    size_t done = 0;
+    while (done < log.size()) {
+        const ssize_t got = ::read(fd, log.data() + done, log.size() - done);
+        if (got <= 0) {
+            break;
+        }
+        done += (size_t)got;
+    }
+    close(fd);
+    if (done != log.size() || log.size() < sizeof(LOG_MAGIC) || (log.size() - sizeof(LOG_MAGIC)) % RECORD_SIZE != 0 ||
+        std::memcmp(log.data(), LOG_MAGIC, sizeof(LOG_MAGIC)) != 0) {
+        return false;
+    }
+
+    StateReader reader(log.data() + sizeof(LOG_MAGIC), log.size() - sizeof(LOG_MAGIC));
+    hashes.clear();
+    hashes.reserve((log.size() - sizeof(LOG_MAGIC)) / RECORD_SIZE);
+    while (!reader.at_end()) {
+        FrameHash hash;
+        if (!reader.read(hash.frame) || !reader.read(hash.registers) || !reader.read(hash.ram) ||
+            !reader.read(hash.scratchpad)) {
+            return false;
+        }
+        hashes.push_back(hash);
+    }
+    return true;
+}
+
+s64 frame_hash_first_divergence(const std::vector<FrameHash>& a, const std::vector<FrameHash>& b) {
+    const size_t count = std::min(a.size(), b.size());
+    for (size_t i = 0; i < count; i++) {
+        if (a[i].frame != b[i].frame || a[i].registers != b[i].registers || a[i].ram != b[i].ram ||
+            a[i].scratchpad != b[i].scratchpad) {
+            return (s64)i;
+        }
+    }
+    return -1;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <string>
+#include <vector>
+
+class EEInstance;
+
+// Per-frame hashes of an EE instance, to check that two runs (two builds, two hosts, a
+// replayed recording) stay in step, and find the first frame where they do not.
+//
+// At each VBLANK start the registers, RAM and the scratchpad are hashed (see
+// state_hash.h). RAM is hashed a page at a time, and only the pages written since the
+// last frame (see smc.h) are hashed again; the RAM hash is the hash of the table of page
+// hashes. Without fastmem every page is hashed every frame.
+//
+// A log is a header and a record per frame. frame_hash_first_divergence() compares two,
+// and tools/frame_diff prints the first frame they disagree on and what differs.
+//
+// The GS is not emulated and has no memory to hash; neither is sound RAM, which the IOP
+// side writes from its own threads.
+
+struct FrameHash {
+    u32 frame;          // Frames completed, see Timers::frame()
+    u64 registers;      // EmotionEngineState
+    u64 ram;
+    u64 scratchpad;
+};
+
+class FrameHasher {
+public:
+    /**
+     * @brief Starts tracking the RAM writes of the instance bound to the calling thread,
+     * which must be `instance`.
+     */
+    explicit FrameHasher(EEInstance& instance);
+    ~FrameHasher();
+
+    FrameHasher(const FrameHasher&) = delete;
+    FrameHasher& operator=(const FrameHasher&) = delete;
+
+    // Hashes the instance as it is now. Call on the instance's thread.
+    FrameHash hash_frame(u32 frame);
+
+    /**
+     * @brief Creates (or truncates) the log at `path` and appends a record to it at every
+     * VBLANK start from now on, through the instance's vsync hook.
+     * @return false if the file cannot be created.
+     */
+    bool start_log(const std::string& path);
+
+    /**
+     * @brief Writes out what is buffered, closes the log and removes the hook.
+     * @return false if part of the log could not be written.
+     */
+    bool stop_log();
+
+    bool is_logging() const { return fd >= 0; }
+
+    // RAM pages hashed by the last hash_frame().
+    u32 last_pages_hashed() const { return pages_hashed; }
+
+private:
+    static void on_vsync(void* user, u32 frame);
+
+    bool flush();
+
+    EEInstance& instance;
+    int tracker;                // Of RAM writes, see smc.h
+    std::vector<u64> page_hashes;
+    u32 pages_hashed;
+    int fd;
+    bool write_failed;
+    std::vector<u8> pending;    // Records not written out yet
+};
+
+/**
+ * @brief Reads a log written by FrameHasher.
+ * @return false if the file cannot be read, is not a frame hash log, or ends mid-record.
+ */
+bool frame_hash_read_log(const std::string& path, std::vector<FrameHash>& hashes);
+
+/**
+ * @brief The index of the first record where `a` and `b` differ, in any field. Records
+ * past the end of the shorter log are not compared.
+ * @return The index, or -1 if they agree.
+ */
+s64 frame_hash_first_divergence(const std::vector<FrameHash>& a, const std::vector<FrameHash>& b);
@@ -0,0 +1,64 @@
+#include <benchmark/benchmark.h>
+#include "frame_hash.h"
+#include "state_hash.h"
+#include "runtime.h"
+#include "memory.h"
+#include <random>
+#include <vector>
+
+// What a frame hash costs: hashing throughput on its own, then a whole frame's hash after
+// the guest stores to `range(0)` RAM pages, new ones each frame or the same ones every
+// frame (a game's working set, which goes hot, see smc.h). A frame is 16.7 ms.
+
+namespace {
+
+void BM_StateHash(benchmark::State& state) {
+    const StateHashFunction hash = state.range(0) ? state_hash_select() : &state_hash_scalar;
+    std::vector<u8> data(4096);
+    std::mt19937 random(50);
+    for (u8& byte : data) {
+        byte = (u8)random();
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(hash(data.data(), data.size()));
+    }
+    state.SetBytesProcessed((int64_t)state.iterations() * (int64_t)data.size());
+    state.SetLabel(state.range(0) ? "selected" : "scalar");
+}
+BENCHMARK(BM_StateHash)->Arg(0)->Arg(1);
+
+void hash_frames(benchmark::State& state, bool same_pages) {
+    EEInstance instance;
+    instance.bind();
+    FrameHasher hasher(instance);
+    hasher.hash_frame(0);
+    std::mt19937 random(51);
+    std::vector<u32> pages((size_t)state.range(0));
+    for (u32& page : pages) {
+        page = random() % (fastmem::RAM_SIZE >> SMC_PAGE_SHIFT);
+    }
+    u32 frame = 1;
+    for (auto _ : state) {
+        state.PauseTiming();
+        for (u32& page : pages) {
+            if (!same_pages) {
+                page = random() % (fastmem::RAM_SIZE >> SMC_PAGE_SHIFT);
+            }
+            WriteMemory32((page << SMC_PAGE_SHIFT) + (random() % 1024) * 4, random());
+        }
+        state.ResumeTiming();
+        benchmark::DoNotOptimize(hasher.hash_frame(frame++));
+    }
+}
+
+void BM_HashFrameNewPages(benchmark::State& state) {
+    hash_frames(state, false);
+}
+BENCHMARK(BM_HashFrameNewPages)->Arg(0)->Arg(64)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+void BM_HashFrameSamePages(benchmark::State& state) {
+    hash_frames(state, true);
+}
+BENCHMARK(BM_HashFrameSamePages)->Arg(64)->Arg(512)->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -0,0 +1,184 @@
+#include "gtest/gtest.h"
+#include "frame_hash.h"
+#include "state_hash.h"
+#include "runtime.h"
+#include "memory.h"
+#include <memory>
+#include <random>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+std::string temp_path() {
+    char path[] = "/tmp/frame_hash_testXXXXXX";
+    const int fd = mkstemp(path);
+    EXPECT_GE(fd, 0);
+    close(fd);
+    return path;
+}
+
+class FrameHashTest : public ::testing::Test {
+protected:
+    // Instances rebind the test thread; give it its own space back afterwards.
+    FrameHashTest() : previous_space(fastmem_current()), previous_smc(smc_current()) {}
+    ~FrameHashTest() override {
+        fastmem_bind(previous_space);
+        smc_bind(previous_smc);
+    }
+
+    // Moves an instance through `frames` frames the way recompiled code does, storing
+    // `value` into RAM at the start of each one; frame `odd_frame` stores something else.
+    void run_frames(const std::string& log, u32 frames, u32 value, u32 odd_frame = ~0u) {
+        EEInstance instance;
+        instance.bind();
+        FrameHasher hasher(instance);
+        ASSERT_TRUE(hasher.start_log(log));
+        const u32 frame_cycles = Timers::SCANLINES_PER_FRAME * Timers::CYCLES_PER_SCANLINE;
+        for (u32 frame = 0; frame < frames; frame++) {
+            WriteMemory32(0x00100000 + frame * 4, frame == odd_frame ? value + 1 : value);
+            for (u32 done = 0; done < frame_cycles; done += 100000) {
+                instance.cpuRegs.cycle += 100000;
+                if ((s32)(instance.cpuRegs.cycle - instance.cpuRegs.nextEventCycle) >= 0) {
+                    instance.scheduler.run_due();
+                }
+            }
+        }
+        ASSERT_TRUE(hasher.stop_log());
+    }
+
+    FastmemSpace* previous_space;
+    SmcState* previous_smc;
+};
+
+} // namespace
+
+TEST(StateHashTest, Sse2MatchesScalar) {
+    std::mt19937 random(50);
+    std::vector<u8> data(5000);
+    for (u8& byte : data) {
+        byte = (u8)random();
+    }
+    // Every length around the stripe, block and page boundaries, and at odd offsets.
+    std::vector<size_t> sizes;
+    for (size_t size = 0; size <= 300; size++) {
+        sizes.push_back(size);
+    }
+    for (size_t size : { 1023, 1024, 1025, 1088, 2047, 2048, 2049, 4095, 4096, 4097, 4999 }) {
+        sizes.push_back(size);
+    }
+    for (size_t size : sizes) {
+        const u8* start = data.data() + (size < 4999 ? size % 7 : 0);
+        const u64 scalar = state_hash_scalar(start, size);
+#if STATE_HASH_SIMD_ENABLED
+        ASSERT_EQ(scalar, state_hash_sse2(start, size)) << size;
+#endif
+        ASSERT_EQ(scalar, state_hash(start, size)) << size;
+    }
+}
+
+TEST(StateHashTest, EveryByteAndTheLengthCount) {
+    // 1. Arrange
+    std::vector<u8> page(4096);
+    const u64 zeros = state_hash(page.data(), page.size());
+
+    // 2. Act / 3. Assert: a bit anywhere, and zeros of another length.
+    for (size_t offset : { 0, 7, 63, 64, 1000, 1024, 2500, 4031, 4032, 4095 }) {
+        page[offset] ^= 0x10;
+        EXPECT_NE(state_hash(page.data(), page.size()), zeros) << offset;
+        page[offset] ^= 0x10;
+    }
+    EXPECT_EQ(state_hash(page.data(), page.size()), zeros);
+    EXPECT_NE(state_hash(page.data(), page.size() - 1), zeros);
+    EXPECT_NE(state_hash(page.data(), 64), state_hash(page.data(), 65));
+}
+
+TEST_F(FrameHashTest, OnlyWrittenPagesAreHashedAgain) {
+    // 1. Arrange
+    EEInstance instance;
+    instance.bind();
+    FrameHasher hasher(instance);
+    const FrameHash first = hasher.hash_frame(0);
+    EXPECT_EQ(hasher.last_pages_hashed(), SMC_PAGE_COUNT);
+
+    // 2. Act
+    WriteMemory32(0x00100000, 0x1234);
+    WriteMemory32(0x00100010, 0x5678);
+    const FrameHash written = hasher.hash_frame(1);
+    const u32 pages = hasher.last_pages_hashed();
+    WriteMemory32(0x00100000, 0);
+    WriteMemory32(0x00100010, 0);
+    const FrameHash back = hasher.hash_frame(2);
+
+    // 3. Assert: memory that is the same again hashes the same again.
+#if FASTMEM_ENABLED
+    EXPECT_EQ(pages, 1u);
+#endif
+    EXPECT_NE(written.ram, first.ram);
+    EXPECT_EQ(written.registers, first.registers);
+    EXPECT_EQ(back.ram, first.ram);
+}
+
+TEST_F(FrameHashTest, RegistersAndScratchpadAreHashed) {
+    // 1. Arrange
+    EEInstance instance;
+    instance.bind();
+    FrameHasher hasher(instance);
+    const FrameHash first = hasher.hash_frame(0);
+
+    // 2. Act
+    instance.cpuRegs.GPR.n.a0.UD[0] = 1;
+    const FrameHash registers = hasher.hash_frame(0);
+    WriteMemory32(0x70000100, 1);
+    const FrameHash scratchpad = hasher.hash_frame(0);
+
+    // 3. Assert
+    EXPECT_NE(registers.registers, first.registers);
+    EXPECT_EQ(registers.scratchpad, first.scratchpad);
+    EXPECT_NE(scratchpad.scratchpad, first.scratchpad);
+    EXPECT_EQ(scratchpad.ram, first.ram);
+}
+
+TEST_F(FrameHashTest, LogsFindTheFirstDivergingFrame) {
+    // 1. Arrange
+    const std::string a = temp_path();
+    const std::string b = temp_path();
+    const std::string c = temp_path();
+
+    // 2. Act: the same run twice, and one that stores something else in frame 3.
+    run_frames(a, 5, 7);
+    run_frames(b, 5, 7);
+    run_frames(c, 5, 7, 3);
+
+    // 3. Assert: a record per VBLANK, the first taken before any frame completed.
+    std::vector<FrameHash> run_a, run_b, run_c;
+    ASSERT_TRUE(frame_hash_read_log(a, run_a));
+    ASSERT_TRUE(frame_hash_read_log(b, run_b));
+    ASSERT_TRUE(frame_hash_read_log(c, run_c));
+    ASSERT_EQ(run_a.size(), 5u);
+    EXPECT_EQ(run_a[0].frame, 0u);
+    EXPECT_EQ(run_a[4].frame, 4u);
+    EXPECT_EQ(frame_hash_first_divergence(run_a, run_b), -1);
+    ASSERT_EQ(frame_hash_first_divergence(run_a, run_c), 3);
+    EXPECT_NE(run_a[3].ram, run_c[3].ram);
+    EXPECT_EQ(run_a[3].registers, run_c[3].registers);
+    unlink(a.c_str());
+    unlink(b.c_str());
+    unlink(c.c_str());
+}
+
+TEST_F(FrameHashTest, DamagedLogsAreRejected) {
+    // 1. Arrange
+    const std::string path = temp_path();
+    run_frames(path, 2, 1);
+
+    // 2. Act
+    ASSERT_EQ(truncate(path.c_str(), 8 + 28 + 5), 0);
+
+    // 3. Assert
+    std::vector<FrameHash> hashes;
+    EXPECT_FALSE(frame_hash_read_log(path, hashes));
+    EXPECT_FALSE(frame_hash_read_log("/nonexistent/log", hashes));
+    unlink(path.c_str());
+}
@@ -0,0 +1,95 @@
+#include "host_directory.h"
+#include "disc_image.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+HostDirectory::~HostDirectory() {
+    close();
+}
+
+bool HostDirectory::open(const std::string& root) {
+    close();
+    struct stat info;
+    if (stat(root.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+        return false;
+    }
+
+    struct Pending {
+        std::string path;
+        std::string key;
+        u32 depth;
+    };
+    std::vector<Pending> pending{ Pending{ root, "", 0 } };
+    while (!pending.empty()) {
+        const Pending current = pending.back();
+        pending.pop_back();
+        DIR* dir = opendir(current.path.c_str());
+        if (!dir) {
+            continue;
+        }
+        while (const dirent* entry = readdir(dir)) {
+            const std::string name = entry->d_name;
+            if (name == "." || name == "..") {
+                continue;
+            }
+            const std::string path = current.path + "/" + name;
+            const std::string key = DiscImage::index_key(current.key + "\\" + name);
+            if (stat(path.c_str(), &info) != 0 || index.count(key)) {
+                continue;       // Gone, or differs from another name only in case
+            }
+            if (S_ISDIR(info.st_mode)) {
+                index.emplace(key, HostFile{ nullptr, 0, true });
+                if (current.depth < MAX_DEPTH) {
+                    pending.push_back(Pending{ path, key, current.depth + 1 });
+                }
+            } else if (S_ISREG(info.st_mode)) {
+                add_file(key, path);
+            }
+        }
+        closedir(dir);
+    }
+    opened = true;
+    return true;
+}
+
+// The descriptor is closed straight away; the mapping keeps the file readable.
+void HostDirectory::add_file(const std::string& key, const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+    struct stat info;
+    HostFile file{ nullptr, 0, false };
+    bool ok = fstat(fd, &info) == 0;
+    if (ok && info.st_size > 0) {
+        void* view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = view != MAP_FAILED;
+        if (ok) {
+            file.data = static_cast<const u8*>(view);
+            file.size = (u64)info.st_size;
+        }
+    }
+    ::close(fd);
+    if (ok) {
+        index.emplace(key, file);
+    }
+}
+
+void HostDirectory::close() {
+    for (auto& [key, file] : index) {
+        if (file.data) {
+            munmap(const_cast<u8*>(file.data), (size_t)file.size);
+        }
+    }
+    index.clear();
+    opened = false;
+}
+
+const HostFile* HostDirectory::find(const std::string& path) const {
+    const auto it = index.find(DiscImage::index_key(path));
+    return it == index.end() ? nullptr : &it->second;
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <string>
+#include <unordered_map>
+
+// A directory on the host standing in for a disc's file system: an extracted game, served
+// as cdrom0: by the FILEIO server (see iop_fileio.h) so it runs without being re-imaged.
+//
+// Everything is done when the directory is opened: the tree is walked once into a path
+// index keyed like a disc's (see DiscImage::index_key), and every file is mapped. After
+// that the directory is read-only, so any thread may look files up and read the mappings
+// without a lock, and a read can copy straight from a mapping into EE RAM.
+
+struct HostFile {
+    const u8* data;         // The whole file, mapped; nullptr if it is empty
+    u64 size;
+    bool directory;
+};
+
+class HostDirectory {
+public:
+    // Deeper than ISO9660 allows, so a symlink loop cannot hang the walk.
+    static constexpr u32 MAX_DEPTH = 16;
+
+    HostDirectory() = default;
+    ~HostDirectory();
+
+    HostDirectory(const HostDirectory&) = delete;
+    HostDirectory& operator=(const HostDirectory&) = delete;
+
+    /**
+     * @brief Indexes and maps everything under `root`, replacing what was open. Files that
+     * cannot be opened or mapped are left out.
+     * @return false if `root` is not a readable directory.
+     */
+    bool open(const std::string& root);
+    void close();
+
+    bool is_open() const { return opened; }
+
+    /**
+     * @brief Looks a path up like DiscImage::find(): '\' or '/' separated, any case, with
+     * or without a ";1" version.
+     * @return nullptr if there is no such file or directory.
+     */
+    const HostFile* find(const std::string& path) const;
+
+    // Files and directories in the index.
+    u32 file_count() const { return (u32)index.size(); }
+
+private:
+    void add_file(const std::string& key, const std::string& path);
+
+    bool opened = false;
+    std::unordered_map<std::string, HostFile> index;
+};
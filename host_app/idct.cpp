@@ -0,0 +1,149 @@
+#include "idct.h"
+#include <cmath>
+#if IDCT_SIMD_ENABLED
+#include <immintrin.h>
+#endif
+
+namespace {
+
+// BASIS[u][x] = c(u) / 2 * cos((2x + 1) u pi / 16), c(0) = 1 / sqrt(2).
+struct Basis {
+    alignas(32) float rows[8][8];
+
+    Basis() {
+        const double pi = 3.14159265358979323846;
+        for (int u = 0; u < 8; u++) {
+            const double scale = u == 0 ? std::sqrt(0.125) : 0.5;
+            for (int x = 0; x < 8; x++) {
+                rows[u][x] = (float)(scale * std::cos((2 * x + 1) * u * pi / 16));
+            }
+        }
+    }
+};
+
+const Basis BASIS;
+
+bool row_is_zero(const s16* row) {
+    u64 a, b;
+    __builtin_memcpy(&a, row, 8);
+    __builtin_memcpy(&b, row + 4, 8);
+    return (a | b) == 0;
+}
+
+s16 saturate(float value) {
+    const long rounded = std::lrint(value);
+    return (s16)(rounded < -32768 ? -32768 : rounded > 32767 ? 32767 : rounded);
+}
+
+} // namespace
+
+void idct_scalar(const s16 coefficients[64], s16 out[64]) {
+    float rows[8][8];
+    bool live[8];
+    for (int v = 0; v < 8; v++) {
+        const s16* in = coefficients + v * 8;
+        live[v] = !row_is_zero(in);
+        if (!live[v]) {
+            continue;
+        }
+        for (int x = 0; x < 8; x++) {
+            float sum = 0.0f;
+            for (int u = 0; u < 8; u++) {
+                sum += (float)in[u] * BASIS.rows[u][x];
+            }
+            rows[v][x] = sum;
+        }
+    }
+    for (int y = 0; y < 8; y++) {
+        for (int x = 0; x < 8; x++) {
+            float sum = 0.0f;
+            for (int v = 0; v < 8; v++) {
+                if (live[v]) {
+                    sum += BASIS.rows[v][y] * rows[v][x];
+                }
+            }
+            out[y * 8 + x] = saturate(sum);
+        }
+    }
+}
+
+#if IDCT_SIMD_ENABLED
+void idct_sse2(const s16 coefficients[64], s16 out[64]) {
+    __m128 rows[8][2];
+    bool live[8];
+    for (int v = 0; v < 8; v++) {
+        const s16* in = coefficients + v * 8;
+        live[v] = !row_is_zero(in);
+        if (!live[v]) {
+            continue;
+        }
+        __m128 low = _mm_setzero_ps();
+        __m128 high = _mm_setzero_ps();
+        for (int u = 0; u < 8; u++) {
+            const __m128 f = _mm_set1_ps((float)in[u]);
+            low = _mm_add_ps(low, _mm_mul_ps(f, _mm_load_ps(&BASIS.rows[u][0])));
+            high = _mm_add_ps(high, _mm_mul_ps(f, _mm_load_ps(&BASIS.rows[u][4])));
+        }
+        rows[v][0] = low;
+        rows[v][1] = high;
+    }
+    for (int y = 0; y < 8; y++) {
+        __m128 low = _mm_setzero_ps();
+        __m128 high = _mm_setzero_ps();
+        for (int v = 0; v < 8; v++) {
+            if (live[v]) {
+                const __m128 c = _mm_set1_ps(BASIS.rows[v][y]);
+                low = _mm_add_ps(low, _mm_mul_ps(c, rows[v][0]));
+                high = _mm_add_ps(high, _mm_mul_ps(c, rows[v][1]));
+            }
+        }
+        const __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(low), _mm_cvtps_epi32(high));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + y * 8), packed);
+    }
+}
+
+__attribute__((target("avx2")))
+void idct_avx2(const s16 coefficients[64], s16 out[64]) {
+    __m256 rows[8];
+    bool live[8];
+    for (int v = 0; v < 8; v++) {
+        const s16* in = coefficients + v * 8;
+        live[v] = !row_is_zero(in);
+        if (!live[v]) {
+            continue;
+        }
+        __m256 sum = _mm256_setzero_ps();
+        for (int u = 0; u < 8; u++) {
+            const __m256 f = _mm256_set1_ps((float)in[u]);
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(f, _mm256_load_ps(BASIS.rows[u])));
+        }
+        rows[v] = sum;
+    }
+    for (int y = 0; y < 8; y += 2) {
+        __m256 first = _mm256_setzero_ps();
+        __m256 second = _mm256_setzero_ps();
+        for (int v = 0; v < 8; v++) {
+            if (live[v]) {
+                first = _mm256_add_ps(first, _mm256_mul_ps(_mm256_set1_ps(BASIS.rows[v][y]), rows[v]));
+                second = _mm256_add_ps(second, _mm256_mul_ps(_mm256_set1_ps(BASIS.rows[v][y + 1]), rows[v]));
+            }
+        }
+        // packs works within 128-bit lanes: (first.lo, second.lo, first.hi, second.hi).
+        const __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(first), _mm256_cvtps_epi32(second));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + y * 8), _mm256_permute4x64_epi64(packed, 0xD8));
+    }
+}
+
+bool idct_has_avx2() {
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+IdctFunction idct_select() {
+#if IDCT_SIMD_ENABLED
+    return idct_has_avx2() ? &idct_avx2 : &idct_sse2;
+#else
+    return &idct_scalar;
+#endif
+}
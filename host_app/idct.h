@@ -0,0 +1,36 @@
+#pragma once
+
+#include "cpu_state.h"
+
+// The IPU's inverse 8x8 DCT, separable in single precision: a pass over the rows by the
+// cosine matrix, then one over the columns, then rounding to the nearest integer.
+//
+// The SSE2 and AVX2 versions keep a row of eight in one or two registers and do the
+// exact same float operations in the exact same order as the scalar one (no FMA, no
+// reassociation), so all three are bit-exact and the scalar one is the reference the
+// others are tested against. Rows of zero coefficients, the common case after
+// quantisation, are skipped in both passes, which leaves the result unchanged.
+//
+// idct.cpp must be built with floating-point contraction off, or the compiler may fuse
+// the scalar version's multiply-adds where the vector versions do not.
+
+#if defined(__x86_64__)
+#define IDCT_SIMD_ENABLED 1
+#else
+#define IDCT_SIMD_ENABLED 0
+#endif
+
+// Transforms `coefficients` (dequantised, raster order) into `out`.
+using IdctFunction = void (*)(const s16 coefficients[64], s16 out[64]);
+
+void idct_scalar(const s16 coefficients[64], s16 out[64]);
+#if IDCT_SIMD_ENABLED
+void idct_sse2(const s16 coefficients[64], s16 out[64]);
+// Only on a CPU with AVX2 (see idct_has_avx2()).
+void idct_avx2(const s16 coefficients[64], s16 out[64]);
+
+bool idct_has_avx2();
+#endif
+
+// The fastest version this CPU runs.
+IdctFunction idct_select();
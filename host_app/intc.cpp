@@ -0,0 +1,48 @@
+#include "intc.h"
+
+static constexpr u32 LINE_MASK = (1u << INTC_LINE_COUNT) - 1;
+
+Intc::Intc() {
+    reset();
+}
+
+void Intc::reset() {
+    stat = 0;
+    mask = 0;
+}
+
+void Intc::save_state(StateWriter& out) const {
+    out.write(stat);
+    out.write(mask);
+}
+
+bool Intc::load_state(StateReader& in) {
+    return in.read(stat) && in.read(mask);
+}
+
+u32 Intc::read32(u32 address) const {
+    switch (address) {
+        case INTC_STAT: return stat;
+        case INTC_MASK: return mask;
+        default:        return 0;
+    }
+}
+
+void Intc::write32(u32 address, u32 value) {
+    switch (address) {
+        case INTC_STAT:
+            stat &= ~(value & LINE_MASK);
+            break;
+        case INTC_MASK:
+            mask ^= value & LINE_MASK;
+            break;
+    }
+}
+
+u32 Intc::command_bits(u32 address) {
+    return address == INTC_STAT || address == INTC_MASK ? LINE_MASK : 0;
+}
+
+void Intc::raise(u32 line) {
+    stat |= 1u << line;
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "state_stream.h"
+
+// EE interrupt controller (INTC). Collects the device interrupt lines into INTC_STAT and
+// asserts INT0 while (INTC_STAT & INTC_MASK) != 0. See "INTC_STAT" in docs/ps2_docs.txt.
+
+// Interrupt lines, i.e. bit numbers of INTC_STAT/INTC_MASK.
+enum IntcLine : u32 {
+    INTC_GS = 0,
+    INTC_SBUS,
+    INTC_VBLANK_START,
+    INTC_VBLANK_END,
+    INTC_VIF0,
+    INTC_VIF1,
+    INTC_VU0,
+    INTC_VU1,
+    INTC_IPU,
+    INTC_TIMER0,
+    INTC_TIMER1,
+    INTC_TIMER2,
+    INTC_TIMER3,
+    INTC_SFIFO,
+    INTC_VU0_WATCHDOG,
+    INTC_LINE_COUNT
+};
+
+class Intc {
+public:
+    static constexpr u32 INTC_STAT = 0x1000F000;
+    static constexpr u32 INTC_MASK = 0x1000F010;
+
+    Intc();
+
+    void reset();
+
+    /**
+     * @brief Reads INTC_STAT or INTC_MASK.
+     * @return The register value, 0 for any other address.
+     */
+    u32 read32(u32 address) const;
+
+    /**
+     * @brief Writes INTC_STAT (1 clears the bit) or INTC_MASK (1 flips the bit).
+     */
+    void write32(u32 address, u32 value);
+
+    // Bits of a register that act when written as 1: all of INTC_STAT and INTC_MASK.
+    static u32 command_bits(u32 address);
+
+    // Latches `line` in INTC_STAT.
+    void raise(u32 line);
+
+    bool int0_asserted() const { return (stat & mask) != 0; }
+
+    u32 pending() const { return stat & mask; }
+
+    // Save states (see savestate.h).
+    void save_state(StateWriter& out) const;
+    bool load_state(StateReader& in);
+
+private:
+    u32 stat;
+    u32 mask;
+};
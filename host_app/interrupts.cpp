@@ -0,0 +1,200 @@
+#include "interrupts.h"
+#include "dispatch.h"
+#include <algorithm>
+
+Interrupts::Interrupts(EmotionEngineState& context, Intc& intc, Dmac& dmac, Scheduler& scheduler)
+    : context(context), intc(intc), dmac(dmac), scheduler(scheduler), next_id(1) {
+}
+
+int Interrupts::add_intc_handler(u32 line, u32 function, u32 arg, bool first) {
+    if (line >= INTC_LINE_COUNT) {
+        return -1;
+    }
+    insert_handler(intc_handlers[line], { next_id, function, arg }, first);
+    return next_id++;
+}
+
+bool Interrupts::remove_intc_handler(u32 line, int id) {
+    return line < INTC_LINE_COUNT && remove_handler(intc_handlers[line], id);
+}
+
+int Interrupts::add_dmac_handler(u32 channel, u32 function, u32 arg, bool first) {
+    if (channel >= DMAC_CHANNEL_COUNT) {
+        return -1;
+    }
+    insert_handler(dmac_handlers[channel], { next_id, function, arg }, first);
+    return next_id++;
+}
+
+bool Interrupts::remove_dmac_handler(u32 channel, int id) {
+    return channel < DMAC_CHANNEL_COUNT && remove_handler(dmac_handlers[channel], id);
+}
+
+void Interrupts::insert_handler(std::vector<Handler>& chain, const Handler& handler, bool first) {
+    chain.insert(first ? chain.begin() : chain.end(), handler);
+}
+
+bool Interrupts::remove_handler(std::vector<Handler>& chain, int id) {
+    const auto it = std::find_if(chain.begin(), chain.end(), [id](const Handler& h) { return h.id == id; });
+    if (it == chain.end()) {
+        return false;
+    }
+    chain.erase(it);
+    return true;
+}
+
+void Interrupts::save_chain(StateWriter& out, const std::vector<Handler>& chain) {
+    out.write((u32)chain.size());
+    out.write_bytes(chain.data(), chain.size() * sizeof(Handler));
+}
+
+bool Interrupts::load_chain(StateReader& in, std::vector<Handler>& chain) {
+    u32 size = 0;
+    if (!in.read(size) || size > 0x10000) {
+        return false;
+    }
+    chain.resize(size);
+    return in.read_bytes(chain.data(), size * sizeof(Handler));
+}
+
+void Interrupts::save_state(StateWriter& out) const {
+    for (const std::vector<Handler>& chain : intc_handlers) {
+        save_chain(out, chain);
+    }
+    for (const std::vector<Handler>& chain : dmac_handlers) {
+        save_chain(out, chain);
+    }
+    out.write(next_id);
+}
+
+bool Interrupts::load_state(StateReader& in) {
+    for (std::vector<Handler>& chain : intc_handlers) {
+        if (!load_chain(in, chain)) {
+            return false;
+        }
+    }
+    for (std::vector<Handler>& chain : dmac_handlers) {
+        if (!load_chain(in, chain)) {
+            return false;
+        }
+    }
+    return in.read(next_id);
+}
+
+void Interrupts::update() {
+    cpuRegisters& regs = context.cpuRegs;
+    u32 ip = regs.CP0.n.Cause & CAUSE_IP7;
+    if (intc.int0_asserted()) {
+        ip |= CAUSE_IP2;
+    }
+    if (dmac.int1_asserted()) {
+        ip |= CAUSE_IP3;
+    }
+    regs.CP0.n.Cause = (regs.CP0.n.Cause & ~CAUSE_IP_MASK) | ip;
+
+    regs.interrupt = ip & regs.CP0.n.Status.val;
+    if (deliverable()) {
+        scheduler.request_check();
+    }
+}
+
+// Status.IE and Status.EIE both set, and not already in an exception or error handler.
+bool Interrupts::enabled() const {
+    const auto& status = context.cpuRegs.CP0.n.Status.b;
+    return status.IE && status.EIE && !status.EXL && !status.ERL;
+}
+
+bool Interrupts::deliverable() const {
+    return context.cpuRegs.interrupt != 0 && enabled();
+}
+
+void Interrupts::deliver() {
+    if (!deliverable()) {
+        return;
+    }
+    cpuRegisters& regs = context.cpuRegs;
+
+    // The handlers run on top of the interrupted code, on its stack, so everything they
+    // may clobber is put back afterwards.
+    const SavedRegisters saved = save_registers();
+
+    regs.CP0.n.EPC = regs.pc;
+    regs.CP0.n.Cause &= ~CAUSE_EXCCODE_MASK;    // ExcCode 0: interrupt
+    regs.CP0.n.Status.b.EXL = 1;
+
+    if (regs.interrupt & CAUSE_IP2) {
+        const u32 lines = intc.pending();
+        for (u32 line = 0; line < INTC_LINE_COUNT; line++) {
+            if (lines & (1u << line)) {
+                intc.write32(Intc::INTC_STAT, 1u << line);
+                run_chain(intc_handlers[line], line);
+            }
+        }
+    }
+    if (regs.interrupt & CAUSE_IP3) {
+        const u32 stat = dmac.stat();
+        const u32 channels = stat & (stat >> 16) & dstat::CIS_MASK;
+        for (u32 channel = 0; channel < DMAC_CHANNEL_COUNT; channel++) {
+            if (channels & (1u << channel)) {
+                dmac.write32(Dmac::D_STAT, 1u << channel);
+                run_chain(dmac_handlers[channel], channel);
+            }
+        }
+    }
+
+    // The kernel keeps the COP0 timer for itself and games never install a handler for
+    // it; consume it so it does not fire again until the next Compare match.
+    regs.CP0.n.Cause &= ~CAUSE_IP7;
+
+    // ERET back into the interrupted code.
+    restore_registers(saved);
+    regs.pc = regs.CP0.n.EPC;
+    regs.CP0.n.Status.b.EXL = 0;
+    update();
+}
+
+s32 Interrupts::call_handler(u32 function, u32 a0, u32 a1, u32 a2) {
+    cpuRegisters& regs = context.cpuRegs;
+    const SavedRegisters saved = save_registers();
+    const u32 saved_exl = regs.CP0.n.Status.b.EXL;
+    regs.CP0.n.Status.b.EXL = 1;
+
+    regs.GPR.n.a0.SD[0] = (s32)a0;
+    regs.GPR.n.a1.SD[0] = (s32)a1;
+    regs.GPR.n.a2.SD[0] = (s32)a2;
+    call_guest_function(context, function);
+    const s32 result = regs.GPR.n.v0.SL[0];
+
+    restore_registers(saved);
+    regs.CP0.n.Status.b.EXL = saved_exl;
+    update();
+    return result;
+}
+
+Interrupts::SavedRegisters Interrupts::save_registers() const {
+    const cpuRegisters& regs = context.cpuRegs;
+    return SavedRegisters{ regs.GPR, regs.HI, regs.LO, regs.sa, context.fpuRegs };
+}
+
+void Interrupts::restore_registers(const SavedRegisters& saved) {
+    cpuRegisters& regs = context.cpuRegs;
+    regs.GPR = saved.gpr;
+    regs.HI = saved.hi;
+    regs.LO = saved.lo;
+    regs.sa = saved.sa;
+    context.fpuRegs = saved.fpu;
+}
+
+// Handlers get (cause, arg, 0) and return an int; a negative return value ends the chain.
+void Interrupts::run_chain(const std::vector<Handler>& chain, u32 cause) {
+    cpuRegisters& regs = context.cpuRegs;
+    for (const Handler& handler : chain) {
+        regs.GPR.n.a0.SD[0] = (s32)cause;
+        regs.GPR.n.a1.SD[0] = (s32)handler.arg;
+        regs.GPR.n.a2.SD[0] = 0;
+        call_guest_function(context, handler.function);
+        if (regs.GPR.n.v0.SL[0] < 0) {
+            break;
+        }
+    }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "intc.h"
+#include "dmac.h"
+#include "scheduler.h"
+#include <vector>
+
+// Interrupt delivery to the game.
+//
+// INT0 (INTC), INT1 (DMAC) and the COP0 timer (IP7) are folded into Cause.IP, and the
+// ones Status.IM lets through are kept in cpuRegs.interrupt. Nothing checks that word
+// per instruction: when it becomes non-zero while interrupts are enabled the scheduler
+// is asked for an early check, so the interrupt is taken at the next block exit, in
+// cpu_event_test().
+//
+// Taking an interrupt does what the kernel's handler at 0x80000200 would: it saves the
+// interrupted registers, sets EPC and Status.EXL, acknowledges each pending cause and
+// calls the handlers the game registered for it (AddIntcHandler/AddDmacHandler), which
+// are recompiled functions, then restores the registers and returns as ERET would.
+
+class Interrupts {
+public:
+    static constexpr u32 CAUSE_IP2 = 1u << 10;    // INT0
+    static constexpr u32 CAUSE_IP3 = 1u << 11;    // INT1
+    static constexpr u32 CAUSE_IP7 = 1u << 15;    // COP0 timer
+    static constexpr u32 CAUSE_IP_MASK = CAUSE_IP2 | CAUSE_IP3 | CAUSE_IP7;
+    static constexpr u32 CAUSE_EXCCODE_MASK = 0x1F << 2;
+
+    Interrupts(EmotionEngineState& context, Intc& intc, Dmac& dmac, Scheduler& scheduler);
+
+    /**
+     * @brief Adds a handler to the end of an INTC line's chain.
+     * @param function Guest address of the (recompiled) handler.
+     * @param arg Passed to the handler in $a1; the line number goes in $a0.
+     * @param first Put it at the front of the chain instead.
+     * @return Handler id for remove_intc_handler().
+     */
+    int add_intc_handler(u32 line, u32 function, u32 arg, bool first = false);
+    bool remove_intc_handler(u32 line, int id);
+
+    /**
+     * @brief Adds a handler to the end of a DMAC channel's chain.
+     * @return Handler id for remove_dmac_handler().
+     */
+    int add_dmac_handler(u32 channel, u32 function, u32 arg, bool first = false);
+    bool remove_dmac_handler(u32 channel, int id);
+
+    /**
+     * @brief Recomputes Cause.IP and cpuRegs.interrupt from the INTC, the DMAC and the
+     * COP0 timer. Call after anything that may raise, acknowledge or unmask an interrupt.
+     */
+    void update();
+
+    // True when an interrupt is pending and Status allows taking it now.
+    bool deliverable() const;
+
+    /**
+     * @brief Takes every deliverable interrupt. Only call at a safe point.
+     */
+    void deliver();
+
+    /**
+     * @brief Calls a guest function the way the kernel calls its handlers: in exception
+     * context, with (a0, a1, a2) as arguments, and every register put back afterwards.
+     * Used for handlers the kernel runs outside deliver() (alarms).
+     * @return The handler's $v0.
+     */
+    s32 call_handler(u32 function, u32 a0, u32 a1, u32 a2);
+
+    // Save states (see savestate.h): the handler chains. Call update() once the devices
+    // are loaded too.
+    void save_state(StateWriter& out) const;
+    bool load_state(StateReader& in);
+
+private:
+    struct Handler {
+        int id;
+        u32 function;
+        u32 arg;
+    };
+
+    // Everything a handler may clobber, put back on the way out.
+    struct SavedRegisters {
+        GPRregs gpr;
+        GPR_reg hi;
+        GPR_reg lo;
+        u32 sa;
+        fpuRegisters fpu;
+    };
+
+    static bool remove_handler(std::vector<Handler>& chain, int id);
+    static void save_chain(StateWriter& out, const std::vector<Handler>& chain);
+    static bool load_chain(StateReader& in, std::vector<Handler>& chain);
+    static void insert_handler(std::vector<Handler>& chain, const Handler& handler, bool first);
+
+    SavedRegisters save_registers() const;
+    void restore_registers(const SavedRegisters& saved);
+
+    bool enabled() const;
+    void run_chain(const std::vector<Handler>& chain, u32 cause);
+
+    EmotionEngineState& context;
+    Intc& intc;
+    Dmac& dmac;
+    Scheduler& scheduler;
+    std::vector<Handler> intc_handlers[INTC_LINE_COUNT];
+    std::vector<Handler> dmac_handlers[DMAC_CHANNEL_COUNT];
+    int next_id;
+};
@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+#include "interrupts.h"
+#include "dispatch.h"
+#include <vector>
+
+namespace {
+
+struct Call {
+    u32 handler;
+    u32 cause;
+    u32 arg;
+    bool exl;
+};
+std::vector<Call> calls;
+
+constexpr u32 VBLANK_HANDLER = 0x00200000;
+constexpr u32 STOPPING_HANDLER = 0x00200100;
+constexpr u32 GIF_HANDLER = 0x00200200;
+
+void record(EmotionEngineState* ctx, u32 handler, s32 result) {
+    cpuRegisters& regs = ctx->cpuRegs;
+    calls.push_back({ handler, regs.GPR.n.a0.UL[0], regs.GPR.n.a1.UL[0], regs.CP0.n.Status.b.EXL != 0 });
+    regs.GPR.n.t0.UD[0] = 0xDEAD;        // Handlers are free to clobber registers
+    regs.GPR.n.v0.SD[0] = result;
+    host_dispatch_jump(ctx, regs.GPR.n.ra.UD[0]);
+}
+
+void vblank_handler(EmotionEngineState* ctx) { record(ctx, VBLANK_HANDLER, 0); }
+void stopping_handler(EmotionEngineState* ctx) { record(ctx, STOPPING_HANDLER, -1); }
+void gif_handler(EmotionEngineState* ctx) { record(ctx, GIF_HANDLER, 0); }
+
+class InterruptsTest : public ::testing::Test {
+protected:
+    InterruptsTest() : context(), scheduler(context.cpuRegs), ram(4096), dmac(DmaMemory{ ram.data(), (u32)ram.size(), nullptr, 0 }), interrupts(context, intc, dmac, scheduler) {
+        calls.clear();
+        register_function(VBLANK_HANDLER, &vblank_handler);
+        register_function(STOPPING_HANDLER, &stopping_handler);
+        register_function(GIF_HANDLER, &gif_handler);
+
+        // Interrupts on, INT0/INT1 unmasked, as the kernel leaves them for user code.
+        auto& status = context.cpuRegs.CP0.n.Status;
+        status.b.IE = 1;
+        status.b.EIE = 1;
+        status.val |= Interrupts::CAUSE_IP2 | Interrupts::CAUSE_IP3;
+        context.cpuRegs.cycle = 1000;
+        context.cpuRegs.pc = 0x00100040;
+    }
+
+    EmotionEngineState context;
+    Scheduler scheduler;
+    Intc intc;
+    std::vector<u8> ram;
+    Dmac dmac;
+    Interrupts interrupts;
+};
+
+} // namespace
+
+TEST_F(InterruptsTest, RaisedLineRequestsCheckAtNextSafePoint) {
+    // 1. Arrange
+    interrupts.add_intc_handler(INTC_VBLANK_START, VBLANK_HANDLER, 0x1234);
+    intc.write32(Intc::INTC_MASK, 1u << INTC_VBLANK_START);
+
+    // 2. Act
+    intc.raise(INTC_VBLANK_START);
+    interrupts.update();
+
+    // 3. Assert: nothing runs yet, but the next block exit enters cpu_event_test().
+    EXPECT_TRUE(calls.empty());
+    EXPECT_EQ(context.cpuRegs.interrupt, Interrupts::CAUSE_IP2);
+    EXPECT_EQ(context.cpuRegs.nextEventCycle, context.cpuRegs.cycle);
+}
+
+TEST_F(InterruptsTest, DeliverCallsHandlerAndReturnsLikeEret) {
+    interrupts.add_intc_handler(INTC_VBLANK_START, VBLANK_HANDLER, 0x1234);
+    intc.write32(Intc::INTC_MASK, 1u << INTC_VBLANK_START);
+    intc.raise(INTC_VBLANK_START);
+    context.cpuRegs.GPR.n.t0.UD[0] = 7;
+    context.cpuRegs.GPR.n.ra.UD[0] = 0x00100100;
+    interrupts.update();
+
+    interrupts.deliver();
+
+    ASSERT_EQ(calls.size(), 1u);
+    EXPECT_EQ(calls[0].handler, VBLANK_HANDLER);
+    EXPECT_EQ(calls[0].cause, (u32)INTC_VBLANK_START);
+    EXPECT_EQ(calls[0].arg, 0x1234u);
+    EXPECT_TRUE(calls[0].exl);
+
+    // Acknowledged, registers and EXL restored, EPC points at the interrupted code.
+    EXPECT_EQ(intc.read32(Intc::INTC_STAT), 0u);
+    EXPECT_EQ(context.cpuRegs.interrupt, 0u);
+    EXPECT_EQ(context.cpuRegs.GPR.n.t0.UD[0], 7u);
+    EXPECT_EQ(context.cpuRegs.GPR.n.ra.UD[0], 0x00100100u);
+    EXPECT_EQ(context.cpuRegs.CP0.n.EPC, 0x00100040u);
+    EXPECT_FALSE(context.cpuRegs.CP0.n.Status.b.EXL);
+}
+
+TEST_F(InterruptsTest, NegativeReturnEndsHandlerChain) {
+    interrupts.add_intc_handler(INTC_TIMER0, STOPPING_HANDLER, 0);
+    interrupts.add_intc_handler(INTC_TIMER0, VBLANK_HANDLER, 0);
+    intc.write32(Intc::INTC_MASK, 1u << INTC_TIMER0);
+    intc.raise(INTC_TIMER0);
+    interrupts.update();
+
+    interrupts.deliver();
+
+    ASSERT_EQ(calls.size(), 1u);
+    EXPECT_EQ(calls[0].handler, STOPPING_HANDLER);
+}
+
+TEST_F(InterruptsTest, NothingIsTakenWhileDisabled) {
+    interrupts.add_intc_handler(INTC_VBLANK_START, VBLANK_HANDLER, 0);
+    intc.write32(Intc::INTC_MASK, 1u << INTC_VBLANK_START);
+    context.cpuRegs.CP0.n.Status.b.IE = 0;
+    intc.raise(INTC_VBLANK_START);
+    interrupts.update();
+
+    interrupts.deliver();
+    EXPECT_TRUE(calls.empty());
+    EXPECT_FALSE(interrupts.deliverable());
+
+    // Enabling interrupts (e.g. an MTC0 to Status) picks it up.
+    context.cpuRegs.CP0.n.Status.b.IE = 1;
+    interrupts.update();
+    interrupts.deliver();
+    EXPECT_EQ(calls.size(), 1u);
+}
+
+TEST_F(InterruptsTest, DmacCompletionRunsChannelHandler) {
+    interrupts.add_dmac_handler(DMAC_GIF, GIF_HANDLER, 0x55);
+    dmac.write32(Dmac::D_CTRL, 1);
+    dmac.write32(Dmac::D_STAT, 1u << (16 + DMAC_GIF));   // Unmask GIF
+    dmac.write32(0x1000A020, 0);                         // QWC 0
+    dmac.write32(0x1000A000, chcr::STR | chcr::DIR);
+    dmac.complete(DMAC_GIF);
+    interrupts.update();
+    EXPECT_EQ(context.cpuRegs.interrupt, Interrupts::CAUSE_IP3);
+
+    interrupts.deliver();
+
+    ASSERT_EQ(calls.size(), 1u);
+    EXPECT_EQ(calls[0].handler, GIF_HANDLER);
+    EXPECT_EQ(calls[0].cause, (u32)DMAC_GIF);
+    EXPECT_EQ(calls[0].arg, 0x55u);
+    EXPECT_FALSE(dmac.int1_asserted());
+}
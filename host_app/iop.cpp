@@ -0,0 +1,441 @@
+#include "iop.h"
+#include "fastmem.h"
+#include "kernel.h"
+#include "scheduler.h"
+#include <algorithm>
+#include <pthread.h>
+
+using namespace sif;
+
+namespace {
+
+constexpr u32 SIF0_CHCR = 0x1000C000;
+constexpr u32 SIF0_QWC = 0x1000C020;
+
+// Destination chain with tag interrupts, so each packet's IRQ tag ends the transfer.
+constexpr u32 SIF0_CHAIN = (1u << chcr::MOD_SHIFT) | chcr::TIE | chcr::STR;
+
+constexpr u32 HEAP_ALIGN = 64;
+
+} // namespace
+
+Iop::Iop(EmotionEngineState& context, Dmac& dmac, Scheduler& scheduler, Kernel& kernel)
+    : context(context), dmac(dmac), scheduler(scheduler), kernel(kernel), iop_ram(new u8[RAM_SIZE]()),
+      mscom(0), smcom(CMD_BUFFER), msflg(0), smflg(STAT_SIFINIT | STAT_CMDINIT | STAT_BOOTEND), ctrl(0), bd6(0),
+      sregs(), ee_buffer(0), next_dma_id(1), sent(0), in_flight(0), poll_event(-1), ee_waiting(false) {
+    sound.set_iop_memory(iop_ram.get(), RAM_SIZE);
+    sound.set_voice_engine(&spu2);
+
+    static const char* const names[MODULE_COUNT] = { "iop_sysmem", "iop_cdvd", "iop_pad", "iop_sound", "iop_mc",
+                                                     "iop_fileio" };
+    for (u32 i = 0; i < MODULE_COUNT; i++) {
+        workers[i].iop = this;
+        workers[i].name = names[i];
+    }
+
+    add_server(HEAP_SERVER, MODULE_SYSMEM, &serve_heap, this);
+    for (u32 id : { CdvdServer::SERVER_INIT, CdvdServer::SERVER_SCMD, CdvdServer::SERVER_NCMD,
+                    CdvdServer::SERVER_SEARCH_FILE, CdvdServer::SERVER_DISK_READY }) {
+        add_server(id, MODULE_CDVD, &CdvdServer::serve, &cdvd);
+    }
+    add_server(PadServer::SERVER_CONTROL, MODULE_PAD, &PadServer::serve, &pad);
+    add_server(PadServer::SERVER_DATA, MODULE_PAD, &PadServer::serve, &pad);
+    add_server(SoundServer::SERVER_ID, MODULE_SOUND, &SoundServer::serve, &sound);
+    add_server(McServer::SERVER_ID, MODULE_MC, &McServer::serve, &mc);
+    add_server(FileioServer::SERVER_ID, MODULE_FILEIO, &FileioServer::serve, &fileio);
+
+    poll_event = scheduler.register_event("iop_poll", &on_poll, this);
+    dmac.set_consumer(DMAC_SIF0, &on_sif0, this);
+}
+
+Iop::~Iop() {
+    for (Worker& worker : workers) {
+        if (worker.thread.joinable()) {
+            {
+                std::lock_guard<std::mutex> lock(worker.mutex);
+                worker.stop = true;
+            }
+            worker.wake.notify_one();
+            worker.thread.join();
+        }
+        for (RpcCall* call : worker.queue) {
+            delete call;
+        }
+    }
+    while (RpcCall* call = completed.pop()) {
+        delete call;
+    }
+    for (RpcCall* call : arrived) {
+        delete call;
+    }
+}
+
+u32 Iop::read32(u32 address) const {
+    switch (address) {
+        case MSCOM: return mscom;
+        case SMCOM: return smcom;
+        case MSFLG: return msflg;
+        case SMFLG: return smflg;
+        case CTRL:  return ctrl;
+        case BD6:   return bd6;
+        default:    return 0;
+    }
+}
+
+void Iop::write32(u32 address, u32 value) {
+    switch (address) {
+        case MSCOM: mscom = value; break;
+        case MSFLG: msflg |= value; break;
+        case SMFLG: smflg &= ~value; break;
+        case CTRL:  ctrl = value; break;
+        case BD6:   bd6 = value; break;
+        default:    break;      // SMCOM is the IOP's
+    }
+}
+
+u32 Iop::command_bits(u32 address) {
+    return address == MSFLG || address == SMFLG ? 0xFFFFFFFF : 0;
+}
+
+s32 Iop::set_dma(u32 transfers, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        const u8* transfer = fastmem_translate(transfers + i * dma_transfer::STRIDE, dma_transfer::STRIDE);
+        if (!transfer) {
+            return 0;
+        }
+        const u32 src = load32(transfer, dma_transfer::SRC);
+        const u32 dest = load32(transfer, dma_transfer::DEST) & (RAM_SIZE - 1);
+        const u32 size = load32(transfer, dma_transfer::SIZE);
+        if (size == 0) {
+            continue;
+        }
+        const u8* data = fastmem_translate(src, size);
+        if (!data || size > RAM_SIZE - dest) {
+            return 0;
+        }
+        std::memcpy(iop_ram.get() + dest, data, size);
+        if (dest == CMD_BUFFER && size >= header::SIZE) {
+            handle_packet(iop_ram.get() + dest);
+        }
+    }
+
+    const s32 id = next_dma_id;
+    next_dma_id = next_dma_id == 0x7FFFFFFF ? 1 : next_dma_id + 1;
+    return id;
+}
+
+void Iop::set_dchain() {
+    if (dmac.channel(DMAC_SIF0).chcr & chcr::STR) {
+        return;
+    }
+    dmac.write32(SIF0_QWC, 0);
+    dmac.write32(SIF0_CHCR, SIF0_CHAIN);
+}
+
+void Iop::on_vblank() {
+    std::vector<EeWrite> writes;
+    pad.update(writes);
+    for (const EeWrite& write : writes) {
+        write_ee(write.address, write.bytes(), write.length());
+    }
+}
+
+// --- Servers ---
+
+void Iop::add_server(u32 id, Module module, RpcFunction function, void* user) {
+    Server server;
+    server.id = id;
+    server.address = heap_alloc(HEAP_ALIGN);      // Stands in for the server's SifRpcServerData_t
+    server.buffer = heap_alloc(SERVER_BUFFER_SIZE);
+    server.module = module;
+    server.function = function;
+    server.user = user;
+    servers.push_back(server);
+}
+
+// The server table is fixed once the constructor is done, so workers read it unlocked.
+const Iop::Server* Iop::find_server(u32 id) const {
+    for (const Server& server : servers) {
+        if (server.id == id) {
+            return &server;
+        }
+    }
+    return nullptr;
+}
+
+const Iop::Server* Iop::find_server_at(u32 address) const {
+    for (const Server& server : servers) {
+        if (server.address == address) {
+            return &server;
+        }
+    }
+    return nullptr;
+}
+
+// First fit over the blocks handed out so far. Returns 0 when IOP RAM is full.
+u32 Iop::heap_alloc(u32 size) {
+    std::lock_guard<std::mutex> lock(heap_mutex);
+    size = (std::max(size, 1u) + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1);
+    u32 address = HEAP_START;
+    for (const auto& block : heap_blocks) {
+        if (block.first - address >= size) {
+            break;
+        }
+        address = block.first + block.second;
+    }
+    if (size > RAM_SIZE - address) {
+        return 0;
+    }
+    heap_blocks[address] = size;
+    return address;
+}
+
+void Iop::heap_free(u32 address) {
+    std::lock_guard<std::mutex> lock(heap_mutex);
+    heap_blocks.erase(address);
+}
+
+void Iop::serve_heap(void* user, RpcCall& call) {
+    Iop& iop = *static_cast<Iop*>(user);
+    switch (call.function) {
+        case HEAP_ALLOC:
+            call.set_reply(0, iop.heap_alloc(call.arg(0)));
+            break;
+        case HEAP_FREE:
+            iop.heap_free(call.arg(0));
+            call.set_reply(0, 0);
+            break;
+        default:
+            // HEAP_LOAD: there is no IOP file system to load modules from.
+            call.set_reply(0, (u32)-1);
+            break;
+    }
+}
+
+// --- EE to IOP ---
+
+void Iop::handle_packet(const u8* packet) {
+    switch (load32(packet, header::CID)) {
+        case CMD_CHANGE_SADDR:
+            ee_buffer = load32(packet, change_saddr::ADDRESS);
+            dmac.resume(DMAC_SIF0);
+            break;
+        case CMD_SET_SREG:
+            sregs[load32(packet, set_sreg::INDEX) & 31] = load32(packet, set_sreg::VALUE);
+            break;
+        case CMD_INIT_CMD: {
+            // sceSifInitRpc() waits for the IOP to say its RPC layer is up.
+            u8 reply[set_sreg::SIZE] = {};
+            store32(reply, header::SIZES, set_sreg::SIZE);
+            store32(reply, header::CID, CMD_SET_SREG);
+            store32(reply, set_sreg::INDEX, SREG_RPCINIT);
+            store32(reply, set_sreg::VALUE, 1);
+            send(reply, sizeof(reply));
+            break;
+        }
+        case CMD_RPC_BIND:
+            bind(packet);
+            break;
+        case CMD_RPC_CALL:
+            call(packet);
+            break;
+        case CMD_RPC_RDATA:
+            other_data(packet);
+            break;
+        default:
+            break;
+    }
+}
+
+// An unknown server binds to address 0, which libraries retry on.
+void Iop::bind(const u8* packet) {
+    const Server* server = find_server(load32(packet, rpc::BIND_SID));
+    send_end(packet, server ? server->address : 0, server ? server->buffer : 0);
+}
+
+void Iop::call(const u8* packet) {
+    const Server* server = find_server_at(load32(packet, rpc::CALL_SERVER));
+    if (!server) {
+        send_end(packet, 0, 0);
+        return;
+    }
+
+    RpcCall* call = new RpcCall;
+    call->server_id = server->id;
+    call->function = load32(packet, rpc::CALL_NUMBER);
+    const u32 send_size = std::min(load32(packet, rpc::CALL_SEND_SIZE), SERVER_BUFFER_SIZE);
+    call->args.assign(iop_ram.get() + server->buffer, iop_ram.get() + server->buffer + send_size);
+    call->receive = load32(packet, rpc::CALL_RECEIVE);
+    call->receive_size = load32(packet, rpc::CALL_RECV_SIZE);
+    std::memcpy(call->packet, packet, sizeof(call->packet));
+    call->issued = context.cpuRegs.cycle;
+
+    Worker& worker = workers[server->module];
+    {
+        std::lock_guard<std::mutex> lock(worker.mutex);
+        worker.queue.push_back(call);
+    }
+    if (!worker.thread.joinable()) {
+        worker.thread = std::thread(&run_worker, &worker);
+    }
+    worker.wake.notify_one();
+
+    in_flight++;
+    if (!scheduler.is_pending(poll_event)) {
+        scheduler.schedule(poll_event, POLL_INTERVAL);
+    }
+}
+
+// sceSifGetOtherData(): IOP RAM to EE RAM, answered right away.
+void Iop::other_data(const u8* packet) {
+    const u32 src = load32(packet, rpc::RDATA_SRC) & (RAM_SIZE - 1);
+    const u32 size = std::min(load32(packet, rpc::RDATA_SIZE), RAM_SIZE - src);
+    write_ee(load32(packet, rpc::RDATA_DEST), iop_ram.get() + src, size);
+    send_end(packet, 0, 0);
+}
+
+void Iop::run_worker(Worker* worker) {
+    pthread_setname_np(pthread_self(), worker->name);
+    Iop& iop = *worker->iop;
+    while (true) {
+        RpcCall* call;
+        {
+            std::unique_lock<std::mutex> lock(worker->mutex);
+            worker->wake.wait(lock, [worker] { return worker->stop || !worker->queue.empty(); });
+            if (worker->stop) {
+                return;
+            }
+            call = worker->queue.front();
+            worker->queue.pop_front();
+        }
+
+        const Server* server = iop.find_server(call->server_id);
+        server->function(server->user, *call);
+
+        iop.completed.push(call);
+        // Pairs with the fence in on_poll(): either the EE sees the call before it
+        // sleeps, or this thread sees it sleeping.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (iop.ee_waiting.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(iop.wait_mutex);
+            iop.wait_wake.notify_one();
+        }
+    }
+}
+
+// --- IOP to EE ---
+
+void Iop::on_poll(void* user, s32) {
+    Iop& iop = *static_cast<Iop*>(user);
+    const u32 finished = iop.drain();
+
+    if (finished == 0 && iop.arrived.empty() && iop.in_flight > 0 && iop.kernel.idling()) {
+        // Every EE thread is waiting and nothing came back: only the IOP can wake one.
+        // EE time stands still until it does rather than spinning through polls.
+        std::unique_lock<std::mutex> lock(iop.wait_mutex);
+        iop.ee_waiting.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        iop.wait_wake.wait(lock, [&iop] { return !iop.completed.empty(); });
+        iop.ee_waiting.store(false, std::memory_order_relaxed);
+        lock.unlock();
+        iop.drain();
+    }
+
+    if (iop.in_flight > 0) {
+        // Come back when the next delayed result is due, or to look for new ones.
+        u32 delay = iop.in_flight > iop.arrived.size() ? POLL_INTERVAL : 0xFFFFFFFF;
+        for (const RpcCall* call : iop.arrived) {
+            delay = std::min(delay, call->latency - (iop.context.cpuRegs.cycle - call->issued));
+        }
+        iop.scheduler.schedule(iop.poll_event, std::max(delay, 1u));
+    }
+}
+
+// Finishes, in the order they came back, the calls whose latency has run out. Returns
+// how many.
+u32 Iop::drain() {
+    while (RpcCall* call = completed.pop()) {
+        arrived.push_back(call);
+    }
+    const u32 now = context.cpuRegs.cycle;
+    u32 finished = 0;
+    size_t kept = 0;
+    for (RpcCall* call : arrived) {
+        if (now - call->issued >= call->latency) {
+            finish(call);
+            finished++;
+        } else {
+            arrived[kept++] = call;
+        }
+    }
+    arrived.resize(kept);
+    return finished;
+}
+
+// The server's results land in EE RAM before the END packet that announces them.
+void Iop::finish(RpcCall* call) {
+    for (const EeWrite& write : call->writes) {
+        write_ee(write.address, write.bytes(), write.length());
+    }
+    if (call->receive && !call->reply.empty()) {
+        write_ee(call->receive, call->reply.data(), std::min((u32)call->reply.size(), call->receive_size));
+    }
+    const Server* server = find_server(call->server_id);
+    send_end(call->packet, server->address, server->buffer);
+    delete call;
+    in_flight--;
+}
+
+void Iop::send_end(const u8* request, u32 server, u32 buffer) {
+    u8 end[rpc::END_SIZE] = {};
+    store32(end, header::SIZES, rpc::END_SIZE);
+    store32(end, header::CID, CMD_RPC_END);
+    // rec_id, pkt_addr, rpc_id and client go back as the EE sent them.
+    std::memcpy(end + rpc::REC_ID, request + rpc::REC_ID, rpc::BIND_SID - rpc::REC_ID);
+    store32(end, rpc::END_CID, load32(request, header::CID));
+    store32(end, rpc::END_SERVER, server);
+    store32(end, rpc::END_BUFF, buffer);
+    send(end, sizeof(end));
+}
+
+void Iop::send(const u8* packet, u32 size) {
+    std::vector<u8> padded((size + 15) & ~15u, 0);
+    std::memcpy(padded.data(), packet, size);
+    to_ee.push_back(std::move(padded));
+    dmac.resume(DMAC_SIF0);
+}
+
+// The IOP's side of a SIF0 destination chain: one CNT tag with IRQ set per packet, so
+// the channel stops and interrupts after each, then the packet itself. With nothing to
+// send (or nowhere to send it yet) the channel stalls until send() resumes it.
+u32 Iop::on_sif0(void* user, u32, const DmaSpan& span) {
+    Iop& iop = *static_cast<Iop*>(user);
+    if (iop.to_ee.empty() || !iop.ee_buffer) {
+        return 0;
+    }
+    const std::vector<u8>& packet = iop.to_ee.front();
+
+    if (span.is_tag) {
+        const u32 tag[4] = { (u32)(packet.size() / 16) | DMA_TAG_CNT << 28 | 1u << 31, iop.ee_buffer, 0, 0 };
+        std::memcpy(span.data, tag, sizeof(tag));
+        return 1;
+    }
+
+    const u32 qwc = std::min(span.qwc, (u32)(packet.size() - iop.sent) / 16);
+    std::memcpy(span.data, packet.data() + iop.sent, qwc * 16);
+    iop.sent += qwc * 16;
+    if (iop.sent == packet.size()) {
+        iop.to_ee.pop_front();
+        iop.sent = 0;
+    }
+    return qwc;
+}
+
+void Iop::write_ee(u32 address, const u8* data, u32 size) {
+    if (size == 0) {
+        return;
+    }
+    if (u8* host = fastmem_translate(address, size)) {
+        std::memcpy(host, data, size);
+    }
+}
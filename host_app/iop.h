@@ -0,0 +1,192 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "dmac.h"
+#include "sif.h"
+#include "mpsc_queue.h"
+#include "iop_cdvd.h"
+#include "iop_pad.h"
+#include "iop_sound.h"
+#include "iop_mc.h"
+#include "iop_fileio.h"
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class Scheduler;
+class Kernel;
+
+// HLE of the IOP: no IOP code runs, only the modules a game talks to over the SIF, as
+// host code. The EE side of the protocol is the game's own sifcmd/sifrpc (see sif.h).
+//
+// EE to IOP: sceSifSetDma() copies straight from EE RAM into IOP RAM (a plain host
+// buffer) and command packets are handled on the spot. A CALL is handed to the worker
+// thread of the module that owns the server, so CD reads, memory card writes and sound
+// uploads run in parallel with the EE instead of taking its time.
+//
+// IOP to EE: a finished call goes back through a lock-free queue that the EE thread
+// drains from a scheduler event (polled only while calls are in flight). Draining
+// copies the results into EE RAM and queues the END packet, which goes out through the
+// SIF0 DMA channel like on hardware: the DMAC pulls it from the IOP as a dest chain
+// into the EE's command buffer and raises the channel interrupt the game's sifcmd
+// handler waits on. When every EE thread is waiting and only the IOP can wake one, the
+// EE thread sleeps on the queue instead of spinning.
+//
+// Server functions never touch EE state, so none of this needs a lock on the EE side.
+
+class Iop {
+public:
+    static constexpr u32 RAM_SIZE = 2 * 1024 * 1024;
+
+    // IOP address of the buffer EE command packets are sent to (what SMCOM reports).
+    static constexpr u32 CMD_BUFFER = 0x00001000;
+
+    // Memory handed out by the heap server and for server buffers.
+    static constexpr u32 HEAP_START = 0x00100000;
+    static constexpr u32 SERVER_BUFFER_SIZE = 16 * 1024;
+
+    // How often the EE checks for finished calls while any are in flight.
+    static constexpr u32 POLL_INTERVAL = 4096;
+
+    // sceSifAllocIopHeap()/sceSifFreeIopHeap() server, by function number.
+    static constexpr u32 HEAP_SERVER = 0x80000003;
+    static constexpr u32 HEAP_ALLOC = 1;
+    static constexpr u32 HEAP_FREE = 2;
+    static constexpr u32 HEAP_LOAD = 3;
+
+    Iop(EmotionEngineState& context, Dmac& dmac, Scheduler& scheduler, Kernel& kernel);
+    ~Iop();
+
+    Iop(const Iop&) = delete;
+    Iop& operator=(const Iop&) = delete;
+
+    /**
+     * @brief Reads a SIF register (MSCOM/SMCOM/MSFLG/SMFLG/CTRL/BD6).
+     * @param address Physical address, sif::REG_START to sif::REG_END.
+     */
+    u32 read32(u32 address) const;
+
+    // The EE writes MSCOM and sets MSFLG bits; writing SMFLG clears bits.
+    void write32(u32 address, u32 value);
+
+    // Bits of a register that act when written as 1: all of MSFLG and SMFLG.
+    static u32 command_bits(u32 address);
+
+    /**
+     * @brief sceSifSetDma(): copies each SifDmaTransfer_t's bytes from EE RAM to IOP RAM,
+     * handling the ones sent to the command buffer as packets.
+     * @return A transfer id, or 0 if a transfer was out of range.
+     */
+    s32 set_dma(u32 transfers, u32 count);
+
+    // sceSifDmaStat(): transfers are over by the time set_dma() returns.
+    s32 dma_stat(s32) const { return -1; }
+
+    // sceSifSetDChain(): arms the SIF0 channel to receive the next IOP packet.
+    void set_dchain();
+
+    // Fills in the pad areas; called at the start of VBLANK.
+    void on_vblank();
+
+    u8* ram() { return iop_ram.get(); }
+
+    // Calls handed to a worker whose END has not been sent.
+    u32 calls_in_flight() const { return in_flight; }
+
+    // The IOP's software registers (sceSifGetSreg()), set by SET_SREG packets.
+    u32 sreg(u32 index) const { return sregs[index & 31]; }
+
+    CdvdServer cdvd;
+    PadServer pad;
+    Spu2 spu2;              // Plays what the sound server is told; see Spu2::start()
+    SoundServer sound;
+    McServer mc;
+    FileioServer fileio;
+
+private:
+    enum Module : u32 {
+        MODULE_SYSMEM,
+        MODULE_CDVD,
+        MODULE_PAD,
+        MODULE_SOUND,
+        MODULE_MC,
+        MODULE_FILEIO,
+        MODULE_COUNT
+    };
+
+    // One host thread per module, serving its calls in order like the module's RPC
+    // thread on the IOP.
+    struct Worker {
+        Iop* iop = nullptr;
+        const char* name = nullptr;
+        std::thread thread;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::deque<RpcCall*> queue;
+        bool stop = false;
+    };
+
+    struct Server {
+        u32 id;
+        u32 address;        // IOP address the EE knows the server by
+        u32 buffer;         // Where the EE sends arguments
+        Module module;
+        RpcFunction function;
+        void* user;
+    };
+
+    static void on_poll(void* user, s32 cycles_late);
+    static u32 on_sif0(void* user, u32 channel, const DmaSpan& span);
+    static void serve_heap(void* user, RpcCall& call);
+    static void run_worker(Worker* worker);
+
+    void add_server(u32 id, Module module, RpcFunction function, void* user);
+    const Server* find_server(u32 id) const;
+    const Server* find_server_at(u32 address) const;
+    u32 heap_alloc(u32 size);
+    void heap_free(u32 address);
+
+    void handle_packet(const u8* packet);
+    void bind(const u8* packet);
+    void call(const u8* packet);
+    void other_data(const u8* packet);
+    void finish(RpcCall* call);
+    u32 drain();
+    void send_end(const u8* request, u32 server, u32 buffer);
+    void send(const u8* packet, u32 size);
+    void write_ee(u32 address, const u8* data, u32 size);
+
+    EmotionEngineState& context;
+    Dmac& dmac;
+    Scheduler& scheduler;
+    Kernel& kernel;
+    std::unique_ptr<u8[]> iop_ram;
+
+    // SIF registers and the IOP's software registers.
+    u32 mscom, smcom, msflg, smflg, ctrl, bd6;
+    u32 sregs[32];
+    u32 ee_buffer;          // Where IOP packets go, from CHANGE_SADDR
+    s32 next_dma_id;
+
+    // Packets waiting for the SIF0 channel; the front one is partly sent after `sent`.
+    std::deque<std::vector<u8>> to_ee;
+    u32 sent;
+
+    std::vector<Server> servers;
+    std::mutex heap_mutex;
+    std::map<u32, u32> heap_blocks;     // Address -> size
+
+    Worker workers[MODULE_COUNT];
+    MpscQueue<RpcCall> completed;
+    std::vector<RpcCall*> arrived;      // Back from their worker, latency not run out yet
+    u32 in_flight;
+    int poll_event;
+
+    // Lets a worker wake the EE thread when it sleeps in drain().
+    std::atomic<bool> ee_waiting;
+    std::mutex wait_mutex;
+    std::condition_variable wait_wake;
+};
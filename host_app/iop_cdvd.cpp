@@ -0,0 +1,160 @@
+#include "iop_cdvd.h"
+#include <algorithm>
+#include <ctime>
+
+namespace {
+
+// sceCdRead() arguments: lbn, sectors, EE buffer, sceCdRMode (trycount, spindlctrl,
+// datapattern, pad).
+constexpr u32 READ_LBN = 0;
+constexpr u32 READ_SECTORS = 1;
+constexpr u32 READ_BUFFER = 2;
+constexpr u32 READ_MODE = 3;
+
+// sceCdSearchFile() arguments: the caller's sceCdlFILE, the path, and where the filled
+// sceCdlFILE goes in EE RAM.
+constexpr u32 SEARCH_PATH = 32;
+constexpr u32 SEARCH_PATH_SIZE = 256;
+constexpr u32 SEARCH_DEST = 288;
+
+u8 bcd(int value) {
+    return (u8)(((value / 10) << 4) | (value % 10));
+}
+
+} // namespace
+
+bool CdvdServer::insert(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex);
+    error = ERROR_NONE;
+    return disc.open(path);
+}
+
+void CdvdServer::eject() {
+    std::lock_guard<std::mutex> lock(mutex);
+    disc.close();
+}
+
+void CdvdServer::set_latency(CdvdLatency mode) {
+    std::lock_guard<std::mutex> lock(mutex);
+    latency = mode;
+}
+
+void CdvdServer::serve(void* user, RpcCall& call) {
+    CdvdServer& cdvd = *static_cast<CdvdServer*>(user);
+    std::lock_guard<std::mutex> lock(cdvd.mutex);
+    switch (call.server_id) {
+        case SERVER_INIT:
+            cdvd.error = ERROR_NONE;
+            call.set_reply(0, 1);
+            break;
+        case SERVER_DISK_READY:
+            call.set_reply(0, cdvd.disc.is_open() ? READY : NOT_READY);
+            break;
+        case SERVER_SEARCH_FILE:
+            cdvd.search_file(call);
+            break;
+        case SERVER_SCMD:
+            cdvd.s_command(call);
+            break;
+        case SERVER_NCMD:
+            switch (call.function) {
+                case NCMD_READ:
+                case NCMD_DVD_READ:
+                    cdvd.read(call);
+                    break;
+                case NCMD_SEEK:
+                case NCMD_STANDBY:
+                case NCMD_PAUSE:
+                    cdvd.status = STATUS_PAUSE;
+                    call.set_reply(0, 1);
+                    break;
+                case NCMD_STOP:
+                    cdvd.status = STATUS_STOP;
+                    call.set_reply(0, 1);
+                    break;
+                default:
+                    call.set_reply(0, 0);
+                    break;
+            }
+            break;
+    }
+}
+
+void CdvdServer::read(RpcCall& call) {
+    const u32 lbn = call.arg(READ_LBN);
+    const u32 sectors = call.arg(READ_SECTORS);
+    const u32 pattern = (call.arg(READ_MODE) >> 16) & 0xFF;
+
+    EeWrite write{ call.arg(READ_BUFFER), std::vector<u8>((size_t)sectors * DiscImage::SECTOR_SIZE) };
+    if (pattern != SECTOR_2048 || !disc.read(lbn, sectors, write.data.data())) {
+        error = ERROR_READ;
+        call.set_reply(0, 0);
+        return;
+    }
+    error = ERROR_NONE;
+    status = STATUS_PAUSE;
+    if (latency == CdvdLatency::Simulated) {
+        const u64 cycles = (lbn == head_lsn ? 0 : (u64)SEEK_CYCLES) + (u64)sectors * SECTOR_CYCLES;
+        call.latency = (u32)std::min<u64>(cycles, 0x7FFFFFFF);
+    }
+    head_lsn = lbn + sectors;
+    call.writes.push_back(std::move(write));
+    call.set_reply(0, 1);
+}
+
+void CdvdServer::search_file(RpcCall& call) {
+    if (call.args.size() < SEARCH_DEST + 4) {
+        call.set_reply(0, 0);
+        return;
+    }
+    const char* path = (const char*)call.args.data() + SEARCH_PATH;
+    DiscFile file;
+    if (!disc.find(std::string(path, strnlen(path, SEARCH_PATH_SIZE)), file)) {
+        call.set_reply(0, 0);
+        return;
+    }
+
+    // sceCdlFILE, with the date as libcdvd lays it out: pad, s, m, h, day, month, year.
+    EeWrite entry{ load32(call.args.data(), SEARCH_DEST), std::vector<u8>(FILE_ENTRY_SIZE) };
+    u8* out = entry.data.data();
+    store32(out, 0, file.lsn);
+    store32(out, 4, file.size);
+    std::memcpy(out + 8, file.name.data(), std::min<size_t>(file.name.size(), 15));
+    const u32 year = 1900 + file.date[0];
+    const u8 date[8] = { 0, file.date[5], file.date[4], file.date[3], file.date[2], file.date[1], (u8)year, (u8)(year >> 8) };
+    std::memcpy(out + 24, date, sizeof(date));
+    call.writes.push_back(std::move(entry));
+    call.set_reply(0, 1);
+}
+
+void CdvdServer::s_command(RpcCall& call) {
+    switch (call.function) {
+        case SCMD_READ_CLOCK: {
+            // sceCdCLOCK after the result: stat, second, minute, hour, pad, day, month,
+            // year, in BCD.
+            const time_t now = time(nullptr);
+            struct tm local;
+            localtime_r(&now, &local);
+            call.set_reply(0, 1);
+            call.set_reply(1, (u32)bcd(local.tm_sec) << 8 | (u32)bcd(local.tm_min) << 16 | (u32)bcd(local.tm_hour) << 24);
+            call.set_reply(2, (u32)bcd(local.tm_mday) | (u32)bcd(local.tm_mon + 1) << 8 | (u32)bcd(local.tm_year % 100) << 16);
+            break;
+        }
+        case SCMD_GET_DISK_TYPE:
+            call.set_reply(0, disc.is_open() ? DISK_PS2_DVD : DISK_NONE);
+            break;
+        case SCMD_GET_ERROR:
+            call.set_reply(0, error);
+            break;
+        case SCMD_TRAY_REQ:
+            call.set_reply(0, 1);
+            call.set_reply(1, 0);       // The tray has not been opened since last asked
+            break;
+        case SCMD_STATUS:
+            call.set_reply(0, status);
+            break;
+        default:
+            call.set_reply(0, 0);
+            break;
+    }
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include "sif.h"
+#include "disc_image.h"
+#include <mutex>
+#include <string>
+
+// HLE of cdvdman/cdvdfsv: the RPC servers libcdvd's sceCd* functions call, reading from
+// a disc image on the host. Runs on the IOP's CDVD worker thread (see iop.h), so a
+// sector read never holds up the EE; the EE sees it finish when the RPC completes.
+//
+// Reads finish as fast as the host can serve them, or, with CdvdLatency::Simulated,
+// no sooner in EE time than a PS2 DVD drive would: a seek unless the read continues the
+// last one, then the sectors at the drive's transfer rate.
+//
+// Server ids, function numbers and argument layouts are those of libcdvd.
+
+enum class CdvdLatency {
+    Instant,
+    Simulated,
+};
+
+class CdvdServer {
+public:
+    static constexpr u32 SERVER_INIT = 0x80000592;
+    static constexpr u32 SERVER_SCMD = 0x80000593;
+    static constexpr u32 SERVER_NCMD = 0x80000595;
+    static constexpr u32 SERVER_SEARCH_FILE = 0x80000597;
+    static constexpr u32 SERVER_DISK_READY = 0x8000059A;
+
+    // N-commands (drive operations), by function number.
+    static constexpr u32 NCMD_READ = 0x01;
+    static constexpr u32 NCMD_DVD_READ = 0x03;
+    static constexpr u32 NCMD_SEEK = 0x05;
+    static constexpr u32 NCMD_STANDBY = 0x06;
+    static constexpr u32 NCMD_STOP = 0x07;
+    static constexpr u32 NCMD_PAUSE = 0x08;
+
+    // S-commands (status queries).
+    static constexpr u32 SCMD_READ_CLOCK = 0x01;
+    static constexpr u32 SCMD_GET_DISK_TYPE = 0x03;
+    static constexpr u32 SCMD_GET_ERROR = 0x04;
+    static constexpr u32 SCMD_TRAY_REQ = 0x05;
+    static constexpr u32 SCMD_STATUS = 0x1C;
+
+    // sceCdGetDiskType() results.
+    static constexpr u32 DISK_NONE = 0x00;
+    static constexpr u32 DISK_PS2_DVD = 0x14;
+
+    // sceCdDiskReady() results.
+    static constexpr u32 READY = 0x02;
+    static constexpr u32 NOT_READY = 0x06;
+
+    // sceCdGetError() results.
+    static constexpr u32 ERROR_NONE = 0x00;
+    static constexpr u32 ERROR_READ = 0x30;
+
+    // sceCdStatus() results.
+    static constexpr u32 STATUS_STOP = 0x00;
+    static constexpr u32 STATUS_PAUSE = 0x0A;
+
+    // sceCdRMode.datapattern: only 2048-byte user data exists in a plain image.
+    static constexpr u32 SECTOR_2048 = 0;
+
+    // sceCdlFILE: lsn, size, name[16], date[8].
+    static constexpr u32 FILE_ENTRY_SIZE = 32;
+
+    // Simulated drive timing in EE cycles: an average DVD seek (~100 ms) and one sector
+    // at 4x DVD speed (~5.5 MB/s).
+    static constexpr u32 SEEK_CYCLES = 29491200;
+    static constexpr u32 SECTOR_CYCLES = 109800;
+
+    /**
+     * @brief Opens the disc image the drive reads from. Without one the drive reports
+     * no disc.
+     */
+    bool insert(const std::string& path);
+    void eject();
+
+    void set_latency(CdvdLatency mode);
+
+    // Serves every CDVD server id. Runs on the worker thread.
+    static void serve(void* user, RpcCall& call);
+
+private:
+    void read(RpcCall& call);
+    void search_file(RpcCall& call);
+    void s_command(RpcCall& call);
+
+    std::mutex mutex;       // insert()/eject() against the worker
+    DiscImage disc;
+    u32 error = ERROR_NONE;
+    u32 status = STATUS_STOP;
+    CdvdLatency latency = CdvdLatency::Instant;
+    u32 head_lsn = 0;       // Where the last read left the simulated head
+};
@@ -0,0 +1,217 @@
+#include "gtest/gtest.h"
+#include "iop_cdvd.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr u32 SECTOR = DiscImage::SECTOR_SIZE;
+constexpr u32 ROOT_LSN = 18;
+constexpr u32 DATA_DIR_LSN = 19;
+constexpr u32 CNF_LSN = 20;
+constexpr u32 FILE_LSN = 21;
+constexpr u32 FILE_SIZE = 2 * SECTOR;
+constexpr u32 IMAGE_SECTORS = 23;
+
+void put32(std::vector<u8>& image, size_t offset, u32 value) {
+    for (int i = 0; i < 4; i++) {
+        image[offset + i] = (u8)(value >> (8 * i));
+    }
+}
+
+// An ISO9660 directory record at `offset`; returns the offset after it.
+size_t add_record(std::vector<u8>& image, size_t offset, const std::string& name, u32 lsn, u32 size, bool directory) {
+    const u32 length = (u32)((33 + name.size() + 1) & ~size_t(1));
+    image[offset + 0] = (u8)length;
+    put32(image, offset + 2, lsn);
+    put32(image, offset + 10, size);
+    image[offset + 18] = 124;           // 2024
+    image[offset + 19] = 5;
+    image[offset + 20] = 17;
+    image[offset + 25] = directory ? 2 : 0;
+    image[offset + 32] = (u8)name.size();
+    std::memcpy(&image[offset + 33], name.data(), name.size());
+    return offset + length;
+}
+
+// A small image: SYSTEM.CNF and DATA\FILE.BIN, whose sectors hold their own LSN.
+std::string write_image() {
+    std::vector<u8> image(IMAGE_SECTORS * SECTOR);
+    u8* pvd = &image[16 * SECTOR];
+    pvd[0] = 1;
+    std::memcpy(pvd + 1, "CD001", 5);
+    add_record(image, 16 * SECTOR + 156, std::string(1, '\0'), ROOT_LSN, SECTOR, true);
+
+    size_t offset = ROOT_LSN * SECTOR;
+    offset = add_record(image, offset, std::string(1, '\0'), ROOT_LSN, SECTOR, true);
+    offset = add_record(image, offset, std::string(1, '\1'), ROOT_LSN, SECTOR, true);
+    offset = add_record(image, offset, "DATA", DATA_DIR_LSN, SECTOR, true);
+    add_record(image, offset, "SYSTEM.CNF;1", CNF_LSN, 30, false);
+    add_record(image, DATA_DIR_LSN * SECTOR, "FILE.BIN;1", FILE_LSN, FILE_SIZE, false);
+    std::memcpy(&image[CNF_LSN * SECTOR], "BOOT2 = cdrom0:\\SLUS_000.00;1\n", 30);
+    for (u32 lsn = FILE_LSN; lsn < FILE_LSN + 2; lsn++) {
+        std::memset(&image[lsn * SECTOR], (int)lsn, SECTOR);
+    }
+
+    char path[] = "/tmp/iop_cdvd_testXXXXXX";
+    const int fd = mkstemp(path);
+    EXPECT_GE(fd, 0);
+    EXPECT_EQ(write(fd, image.data(), image.size()), (ssize_t)image.size());
+    close(fd);
+    return path;
+}
+
+class CdvdServerTest : public ::testing::Test {
+protected:
+    CdvdServerTest() : image(write_image()) {}
+    ~CdvdServerTest() override { std::remove(image.c_str()); }
+
+    void call(RpcCall& rpc, u32 server, u32 function, const std::vector<u32>& args = {}) {
+        rpc.server_id = server;
+        rpc.function = function;
+        rpc.args.resize(args.size() * 4);
+        for (size_t i = 0; i < args.size(); i++) {
+            store32(rpc.args.data(), (u32)i * 4, args[i]);
+        }
+        CdvdServer::serve(&cdvd, rpc);
+    }
+
+    // First reply word of a call without arguments.
+    u32 result(u32 server, u32 function) {
+        RpcCall rpc;
+        call(rpc, server, function);
+        return load32(rpc.reply.data(), 0);
+    }
+
+    void search(RpcCall& rpc, const std::string& path, u32 dest) {
+        rpc.server_id = CdvdServer::SERVER_SEARCH_FILE;
+        rpc.args.resize(292);
+        std::memcpy(rpc.args.data() + 32, path.data(), path.size());
+        store32(rpc.args.data(), 288, dest);
+        CdvdServer::serve(&cdvd, rpc);
+    }
+
+    std::string image;
+    CdvdServer cdvd;
+};
+
+} // namespace
+
+TEST_F(CdvdServerTest, NoDiscReportsNotReady) {
+    EXPECT_EQ(result(CdvdServer::SERVER_DISK_READY, 0), CdvdServer::NOT_READY);
+    EXPECT_EQ(result(CdvdServer::SERVER_SCMD, CdvdServer::SCMD_GET_DISK_TYPE), CdvdServer::DISK_NONE);
+    EXPECT_FALSE(cdvd.insert("/nonexistent.iso"));
+}
+
+TEST_F(CdvdServerTest, SearchFileWalksDirectories) {
+    // 1. Arrange
+    ASSERT_TRUE(cdvd.insert(image));
+
+    // 2. Act
+    RpcCall nested, missing;
+    search(nested, "\\data\\file.bin;1", 0x00200000);
+    search(missing, "\\DATA\\NOPE.BIN", 0x00200000);
+
+    // 3. Assert: the sceCdlFILE goes to the EE's buffer.
+    EXPECT_EQ(load32(nested.reply.data(), 0), 1u);
+    ASSERT_EQ(nested.writes.size(), 1u);
+    EXPECT_EQ(nested.writes[0].address, 0x00200000u);
+    EXPECT_EQ(load32(nested.writes[0].data.data(), 0), FILE_LSN);
+    EXPECT_EQ(load32(nested.writes[0].data.data(), 4), FILE_SIZE);
+    EXPECT_STREQ((const char*)nested.writes[0].data.data() + 8, "FILE.BIN;1");
+    EXPECT_EQ(load32(missing.reply.data(), 0), 0u);
+    EXPECT_TRUE(missing.writes.empty());
+}
+
+TEST_F(CdvdServerTest, ReadCopiesSectorsToTheEe) {
+    // 1. Arrange
+    ASSERT_TRUE(cdvd.insert(image));
+
+    // 2. Act: sceCdRead(FILE_LSN, 2, buffer, mode with datapattern 0).
+    RpcCall read;
+    call(read, CdvdServer::SERVER_NCMD, CdvdServer::NCMD_READ, { FILE_LSN, 2, 0x00300000, 0 });
+
+    // 3. Assert
+    EXPECT_EQ(load32(read.reply.data(), 0), 1u);
+    ASSERT_EQ(read.writes.size(), 1u);
+    EXPECT_EQ(read.writes[0].address, 0x00300000u);
+    ASSERT_EQ(read.writes[0].data.size(), 2u * SECTOR);
+    EXPECT_EQ(read.writes[0].data[0], FILE_LSN);
+    EXPECT_EQ(read.writes[0].data[SECTOR], FILE_LSN + 1);
+    EXPECT_EQ(result(CdvdServer::SERVER_SCMD, CdvdServer::SCMD_GET_ERROR), CdvdServer::ERROR_NONE);
+}
+
+TEST_F(CdvdServerTest, ReadPastTheEndFails) {
+    ASSERT_TRUE(cdvd.insert(image));
+
+    RpcCall read;
+    call(read, CdvdServer::SERVER_NCMD, CdvdServer::NCMD_READ, { IMAGE_SECTORS - 1, 2, 0x00300000, 0 });
+
+    EXPECT_EQ(load32(read.reply.data(), 0), 0u);
+    EXPECT_TRUE(read.writes.empty());
+    EXPECT_EQ(result(CdvdServer::SERVER_SCMD, CdvdServer::SCMD_GET_ERROR), CdvdServer::ERROR_READ);
+}
+
+TEST_F(CdvdServerTest, SimulatedReadsCarryDriveLatency) {
+    // 1. Arrange
+    ASSERT_TRUE(cdvd.insert(image));
+    cdvd.set_latency(CdvdLatency::Simulated);
+
+    // 2. Act: a read somewhere new, then one carrying on from it.
+    RpcCall seek, stream;
+    call(seek, CdvdServer::SERVER_NCMD, CdvdServer::NCMD_READ, { CNF_LSN, 1, 0x00300000, 0 });
+    call(stream, CdvdServer::SERVER_NCMD, CdvdServer::NCMD_READ, { FILE_LSN, 2, 0x00300000, 0 });
+
+    // 3. Assert: only the first pays for the seek.
+    EXPECT_EQ(seek.latency, CdvdServer::SEEK_CYCLES + CdvdServer::SECTOR_CYCLES);
+    EXPECT_EQ(stream.latency, 2 * CdvdServer::SECTOR_CYCLES);
+}
+
+TEST_F(CdvdServerTest, InstantReadsHaveNoLatency) {
+    ASSERT_TRUE(cdvd.insert(image));
+    RpcCall read;
+    call(read, CdvdServer::SERVER_NCMD, CdvdServer::NCMD_READ, { CNF_LSN, 1, 0x00300000, 0 });
+    EXPECT_EQ(read.latency, 0u);
+}
+
+TEST_F(CdvdServerTest, IndexHoldsEveryFileAndDirectory) {
+    DiscImage disc;
+    ASSERT_TRUE(disc.open(image));
+
+    DiscFile file;
+    EXPECT_EQ(disc.file_count(), 3u);
+    EXPECT_TRUE(disc.find("DATA", file));
+    EXPECT_TRUE(disc.find("/Data/File.Bin", file));
+    EXPECT_EQ(file.lsn, FILE_LSN);
+    EXPECT_EQ(file.name, "FILE.BIN;1");
+    EXPECT_TRUE(disc.find("\\SYSTEM.CNF;1", file));
+    EXPECT_EQ(file.size, 30u);
+}
+
+TEST_F(CdvdServerTest, MappedAndCachedReadsAgree) {
+    // 1. Arrange
+    DiscImage mapped, cached;
+    ASSERT_TRUE(mapped.open(image));
+    ASSERT_TRUE(cached.open(image, false));
+    ASSERT_NE(cached.cache(), nullptr);
+
+    // 2. Act: the whole image, one sector at a time, as a stream.
+    std::vector<u8> a(SECTOR), b(SECTOR);
+    bool same = true;
+    for (u32 lsn = 0; lsn < IMAGE_SECTORS; lsn++) {
+        ASSERT_TRUE(mapped.read(lsn, 1, a.data()));
+        ASSERT_TRUE(cached.read(lsn, 1, b.data()));
+        same = same && a == b;
+    }
+
+    // 3. Assert: one 64 KB block holds this image, so only the volume descriptor missed.
+    EXPECT_TRUE(mapped.is_mapped());
+    EXPECT_FALSE(cached.is_mapped());
+    EXPECT_TRUE(same);
+    EXPECT_EQ(cached.cache()->misses(), 1u);
+    EXPECT_GE(cached.cache()->hits(), (u64)IMAGE_SECTORS);
+    EXPECT_FALSE(cached.read(IMAGE_SECTORS - 1, 2, b.data()));
+}
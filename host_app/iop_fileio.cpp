@@ -0,0 +1,181 @@
+#include "iop_fileio.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+// _fio_open_arg: mode, name[256] (a byte offset, like GETSTAT_NAME).
+constexpr u32 OPEN_MODE = 0;
+constexpr u32 OPEN_NAME = 4;
+
+// _fio_read_arg: fd, ptr, size, read_data.
+constexpr u32 READ_FD = 0;
+constexpr u32 READ_BUFFER = 1;
+constexpr u32 READ_SIZE = 2;
+constexpr u32 READ_DATA = 3;
+
+// _fio_lseek_arg: fd, offset, whence.
+constexpr u32 LSEEK_FD = 0;
+constexpr u32 LSEEK_OFFSET = 1;
+constexpr u32 LSEEK_WHENCE = 2;
+
+// _fio_getstat_arg: stat pointer, name[256].
+constexpr u32 GETSTAT_STAT = 0;
+constexpr u32 GETSTAT_NAME = 4;
+
+} // namespace
+
+bool FileioServer::mount(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::fill(std::begin(files), std::end(files), Handle());
+    return host.open(directory);
+}
+
+void FileioServer::unmount() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::fill(std::begin(files), std::end(files), Handle());
+    host.close();
+}
+
+void FileioServer::serve(void* user, RpcCall& call) {
+    FileioServer& fileio = *static_cast<FileioServer*>(user);
+    std::lock_guard<std::mutex> lock(fileio.mutex);
+    s32 result = ERR_INVALID;
+    switch (call.function) {
+        case FUNC_OPEN:
+            result = fileio.open(call);
+            break;
+        case FUNC_CLOSE: {
+            const u32 fd = call.arg(0);
+            if (fd < MAX_FILES && fileio.files[fd].file) {
+                fileio.files[fd] = Handle();
+                result = 0;
+            } else {
+                result = ERR_BAD_FD;
+            }
+            break;
+        }
+        case FUNC_READ:
+            result = fileio.read(call);
+            break;
+        case FUNC_WRITE: {
+            const u32 fd = call.arg(0);
+            result = fd < MAX_FILES && fileio.files[fd].file ? ERR_READ_ONLY : ERR_BAD_FD;
+            break;
+        }
+        case FUNC_LSEEK:
+            result = fileio.seek(call);
+            break;
+        case FUNC_GETSTAT:
+            result = fileio.get_stat(call);
+            break;
+    }
+    call.set_reply(0, (u32)result);
+}
+
+// "cdrom0:\DATA\FILE.BIN;1" or "host:data/file.bin": the device, less its unit number,
+// then a path on it.
+const HostFile* FileioServer::resolve(const char* path, u32 size, s32& error) const {
+    const std::string full(path, strnlen(path, size));
+    const size_t colon = full.find(':');
+    std::string device = full.substr(0, colon == std::string::npos ? 0 : colon);
+    while (!device.empty() && device.back() >= '0' && device.back() <= '9') {
+        device.pop_back();
+    }
+    if ((device != "cdrom" && device != "host") || !host.is_open()) {
+        error = ERR_NO_DEVICE;
+        return nullptr;
+    }
+    const HostFile* file = host.find(full.substr(colon + 1));
+    error = file ? 0 : ERR_NO_ENTRY;
+    return file;
+}
+
+s32 FileioServer::open(const RpcCall& call) {
+    if (call.args.size() <= OPEN_NAME) {
+        return ERR_INVALID;
+    }
+    s32 error;
+    const HostFile* file = resolve((const char*)call.args.data() + OPEN_NAME,
+                                   std::min<u32>(PATH_SIZE, (u32)call.args.size() - OPEN_NAME), error);
+    if (!file) {
+        return error;
+    }
+    if (file->directory) {
+        return ERR_IS_DIR;
+    }
+    if ((call.arg(OPEN_MODE) & OPEN_ACCESS) != OPEN_READ) {
+        return ERR_READ_ONLY;
+    }
+    for (u32 fd = 0; fd < MAX_FILES; fd++) {
+        if (!files[fd].file) {
+            files[fd] = Handle{ file, 0 };
+            return (s32)fd;
+        }
+    }
+    return ERR_TOO_MANY;
+}
+
+s32 FileioServer::read(RpcCall& call) {
+    const u32 fd = call.arg(READ_FD);
+    const s32 size = (s32)call.arg(READ_SIZE);
+    if (fd >= MAX_FILES || !files[fd].file) {
+        return ERR_BAD_FD;
+    }
+    if (size < 0) {
+        return ERR_INVALID;
+    }
+    Handle& handle = files[fd];
+    const u64 left = handle.position < handle.file->size ? handle.file->size - handle.position : 0;
+    const u32 count = (u32)std::min<u64>((u64)size, left);
+    if (count) {
+        EeWrite data{ call.arg(READ_BUFFER), {} };
+        data.source = handle.file->data + handle.position;
+        data.size = count;
+        call.writes.push_back(std::move(data));
+    }
+    if (call.arg(READ_DATA)) {
+        call.writes.push_back(EeWrite{ call.arg(READ_DATA), std::vector<u8>(READ_DATA_HEADER, 0) });
+    }
+    handle.position += count;
+    return (s32)count;
+}
+
+s32 FileioServer::seek(const RpcCall& call) {
+    const u32 fd = call.arg(LSEEK_FD);
+    if (fd >= MAX_FILES || !files[fd].file) {
+        return ERR_BAD_FD;
+    }
+    Handle& handle = files[fd];
+    s64 base;
+    switch (call.arg(LSEEK_WHENCE)) {
+        case SEEK_FROM_START: base = 0; break;
+        case SEEK_FROM_CURRENT: base = (s64)handle.position; break;
+        case SEEK_FROM_END: base = (s64)handle.file->size; break;
+        default: return ERR_INVALID;
+    }
+    const s64 position = base + (s32)call.arg(LSEEK_OFFSET);
+    if (position < 0 || position > 0x7FFFFFFF) {
+        return ERR_INVALID;
+    }
+    handle.position = (u64)position;
+    return (s32)position;
+}
+
+s32 FileioServer::get_stat(RpcCall& call) {
+    if (call.args.size() <= GETSTAT_NAME) {
+        return ERR_INVALID;
+    }
+    s32 error;
+    const HostFile* file = resolve((const char*)call.args.data() + GETSTAT_NAME,
+                                   std::min<u32>(PATH_SIZE, (u32)call.args.size() - GETSTAT_NAME), error);
+    if (!file) {
+        return error;
+    }
+    EeWrite stat{ call.arg(GETSTAT_STAT), std::vector<u8>(STAT_SIZE, 0) };
+    store32(stat.data.data(), STAT_MODE, file->directory ? MODE_DIR : MODE_FILE);
+    store32(stat.data.data(), STAT_FILE_SIZE, (u32)file->size);
+    store32(stat.data.data(), STAT_HI_SIZE, (u32)(file->size >> 32));
+    call.writes.push_back(std::move(stat));
+    return 0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include "sif.h"
+#include "host_directory.h"
+#include <mutex>
+#include <string>
+
+// HLE of FILEIO, the IOP's ioman RPC server behind the EE's sceOpen()/sceRead()/...
+// It serves cdrom0: (and host:) from a host directory mounted in place of the disc (see
+// host_directory.h), read-only. Runs on the IOP's FILEIO worker thread.
+//
+// A read is zero-copy until EE RAM: the call points its EeWrite at the file's mapping
+// and the IOP copies from there when the call completes. The whole read lands at the
+// EE's buffer, so the EE's fix-up of unaligned ends (struct _fio_read_data) is told there
+// is nothing left to do.
+//
+// Function numbers and argument blocks are those of the EE's fileio.c; results are
+// ioman's, a descriptor, a size or a negated errno.
+
+class FileioServer {
+public:
+    static constexpr u32 SERVER_ID = 0x80000001;
+
+    static constexpr u32 FUNC_OPEN = 0x00;
+    static constexpr u32 FUNC_CLOSE = 0x01;
+    static constexpr u32 FUNC_READ = 0x02;
+    static constexpr u32 FUNC_WRITE = 0x03;
+    static constexpr u32 FUNC_LSEEK = 0x04;
+    static constexpr u32 FUNC_GETSTAT = 0x0C;
+
+    static constexpr s32 ERR_NO_ENTRY = -2;
+    static constexpr s32 ERR_BAD_FD = -9;
+    static constexpr s32 ERR_NO_DEVICE = -19;
+    static constexpr s32 ERR_IS_DIR = -21;
+    static constexpr s32 ERR_INVALID = -22;
+    static constexpr s32 ERR_TOO_MANY = -24;
+    static constexpr s32 ERR_READ_ONLY = -30;
+
+    // Open modes (ioman O_*).
+    static constexpr u32 OPEN_ACCESS = 0x0003;
+    static constexpr u32 OPEN_READ = 0x0001;
+
+    static constexpr u32 SEEK_FROM_START = 0;
+    static constexpr u32 SEEK_FROM_CURRENT = 1;
+    static constexpr u32 SEEK_FROM_END = 2;
+
+    static constexpr u32 MAX_FILES = 32;
+    static constexpr u32 PATH_SIZE = 256;
+
+    // io_stat_t: mode, attr, size, ctime[8], atime[8], mtime[8], hisize.
+    static constexpr u32 STAT_SIZE = 40;
+    static constexpr u32 STAT_MODE = 0;
+    static constexpr u32 STAT_FILE_SIZE = 8;
+    static constexpr u32 STAT_HI_SIZE = 36;
+    static constexpr u32 MODE_FILE = 0x2000 | 0x0124;   // FIO_S_IFREG, readable
+    static constexpr u32 MODE_DIR = 0x1000 | 0x016D;    // FIO_S_IFDIR, readable and searchable
+
+    // struct _fio_read_data: size1, size2, dest1, dest2 ahead of the two fix-up buffers.
+    static constexpr u32 READ_DATA_HEADER = 16;
+
+    /**
+     * @brief Serves cdrom0: and host: from `directory`, replacing what was mounted and
+     * closing every open file. Reads still on their way to EE RAM point into the old
+     * mappings, so (un)mount while the game is not reading.
+     * @return false if it is not a readable directory.
+     */
+    bool mount(const std::string& directory);
+    void unmount();
+
+    // Runs on the worker thread.
+    static void serve(void* user, RpcCall& call);
+
+private:
+    struct Handle {
+        const HostFile* file = nullptr;
+        u64 position = 0;
+    };
+
+    const HostFile* resolve(const char* path, u32 size, s32& error) const;
+    s32 open(const RpcCall& call);
+    s32 read(RpcCall& call);
+    s32 seek(const RpcCall& call);
+    s32 get_stat(RpcCall& call);
+
+    std::mutex mutex;       // mount()/unmount() against the worker
+    HostDirectory host;
+    Handle files[MAX_FILES];
+};
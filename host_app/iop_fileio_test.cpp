@@ -0,0 +1,147 @@
+#include "gtest/gtest.h"
+#include "iop_fileio.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+namespace {
+
+constexpr u32 BUFFER = 0x00200000;
+constexpr u32 READ_DATA = 0x00300000;
+constexpr u32 STAT = 0x00400000;
+
+class FileioServerTest : public ::testing::Test {
+protected:
+    FileioServerTest() {
+        char path[] = "/tmp/iop_fileio_testXXXXXX";
+        root = mkdtemp(path);
+        mkdir((root + "/Data").c_str(), 0755);
+        write_file("/SYSTEM.CNF", "BOOT2 = cdrom0:\\SLUS_000.00;1\n");
+        write_file("/Data/level1.bin", std::string(5000, 'x') + "END");
+        write_file("/Data/empty.bin", "");
+    }
+    ~FileioServerTest() override {
+        std::system(("rm -rf " + root).c_str());
+    }
+
+    void write_file(const std::string& name, const std::string& data) {
+        FILE* file = std::fopen((root + name).c_str(), "wb");
+        std::fwrite(data.data(), 1, data.size(), file);
+        std::fclose(file);
+    }
+
+    s32 result(RpcCall& call) {
+        FileioServer::serve(&fileio, call);
+        return (s32)load32(call.reply.data(), 0);
+    }
+
+    // _fio_open_arg and _fio_getstat_arg: a word, then the path.
+    s32 path_call(u32 function, u32 word, const std::string& path) {
+        RpcCall call;
+        call.function = function;
+        call.args.resize(4 + FileioServer::PATH_SIZE);
+        store32(call.args.data(), 0, word);
+        std::memcpy(call.args.data() + 4, path.data(), path.size());
+        const s32 value = result(call);
+        writes = std::move(call.writes);
+        return value;
+    }
+
+    s32 open(const std::string& path, u32 mode = FileioServer::OPEN_READ) {
+        return path_call(FileioServer::FUNC_OPEN, mode, path);
+    }
+
+    s32 word_call(u32 function, const std::vector<u32>& words) {
+        RpcCall call;
+        call.function = function;
+        call.args.resize(16);
+        for (size_t i = 0; i < words.size(); i++) {
+            store32(call.args.data(), (u32)i * 4, words[i]);
+        }
+        const s32 value = result(call);
+        writes = std::move(call.writes);
+        return value;
+    }
+
+    std::string root;
+    FileioServer fileio;
+    std::vector<EeWrite> writes;
+};
+
+} // namespace
+
+TEST_F(FileioServerTest, NothingMountedHasNoDevice) {
+    EXPECT_EQ(open("cdrom0:\\SYSTEM.CNF;1"), FileioServer::ERR_NO_DEVICE);
+    ASSERT_TRUE(fileio.mount(root));
+    EXPECT_EQ(open("mc0:/SYSTEM.CNF"), FileioServer::ERR_NO_DEVICE);
+    EXPECT_FALSE(fileio.mount(root + "/SYSTEM.CNF"));
+}
+
+TEST_F(FileioServerTest, OpensResolveLikeTheDisc) {
+    // 1. Arrange
+    ASSERT_TRUE(fileio.mount(root));
+
+    // 2. Act / 3. Assert: any case, either separator, with or without a version.
+    EXPECT_GE(open("cdrom0:\\SYSTEM.CNF;1"), 0);
+    EXPECT_GE(open("cdrom:\\DATA\\LEVEL1.BIN;1"), 0);
+    EXPECT_GE(open("host0:data/level1.bin"), 0);
+    EXPECT_GE(open("cdrom0:\\DATA\\EMPTY.BIN;1"), 0);
+    EXPECT_EQ(open("cdrom0:\\DATA\\LEVEL2.BIN;1"), FileioServer::ERR_NO_ENTRY);
+    EXPECT_EQ(open("cdrom0:\\DATA"), FileioServer::ERR_IS_DIR);
+    EXPECT_EQ(open("cdrom0:\\SYSTEM.CNF;1", 0x0002), FileioServer::ERR_READ_ONLY);
+}
+
+TEST_F(FileioServerTest, ReadsPointIntoTheMappedFile) {
+    // 1. Arrange
+    ASSERT_TRUE(fileio.mount(root));
+    const s32 fd = open("cdrom0:\\DATA\\LEVEL1.BIN;1");
+    ASSERT_GE(fd, 0);
+
+    // 2. Act: seek to near the end and read past it.
+    EXPECT_EQ(word_call(FileioServer::FUNC_LSEEK, { (u32)fd, (u32)-5, FileioServer::SEEK_FROM_END }), 4998);
+    const s32 got = word_call(FileioServer::FUNC_READ, { (u32)fd, BUFFER, 64, READ_DATA });
+
+    // 3. Assert: what is left, straight from the mapping, and no unaligned fix-up to do.
+    EXPECT_EQ(got, 5);
+    ASSERT_EQ(writes.size(), 2u);
+    EXPECT_EQ(writes[0].address, BUFFER);
+    EXPECT_TRUE(writes[0].data.empty());
+    ASSERT_NE(writes[0].source, nullptr);
+    EXPECT_EQ(std::string((const char*)writes[0].bytes(), writes[0].length()), "xxEND");
+    EXPECT_EQ(writes[1].address, READ_DATA);
+    EXPECT_EQ(writes[1].data, std::vector<u8>(FileioServer::READ_DATA_HEADER, 0));
+    EXPECT_EQ(word_call(FileioServer::FUNC_READ, { (u32)fd, BUFFER, 64, 0 }), 0);
+    EXPECT_TRUE(writes.empty());
+}
+
+TEST_F(FileioServerTest, HandlesCloseAndRunOut) {
+    // 1. Arrange
+    ASSERT_TRUE(fileio.mount(root));
+    s32 last = -1;
+    for (u32 i = 0; i < FileioServer::MAX_FILES; i++) {
+        last = open("cdrom0:\\SYSTEM.CNF;1");
+    }
+
+    // 2. Act / 3. Assert
+    EXPECT_EQ(last, (s32)FileioServer::MAX_FILES - 1);
+    EXPECT_EQ(open("cdrom0:\\SYSTEM.CNF;1"), FileioServer::ERR_TOO_MANY);
+    EXPECT_EQ(word_call(FileioServer::FUNC_CLOSE, { 3 }), 0);
+    EXPECT_EQ(word_call(FileioServer::FUNC_CLOSE, { 3 }), FileioServer::ERR_BAD_FD);
+    EXPECT_EQ(open("cdrom0:\\SYSTEM.CNF;1"), 3);
+    EXPECT_EQ(word_call(FileioServer::FUNC_WRITE, { 3, BUFFER, 4 }), FileioServer::ERR_READ_ONLY);
+}
+
+TEST_F(FileioServerTest, GetStatReportsSizeAndKind) {
+    ASSERT_TRUE(fileio.mount(root));
+
+    ASSERT_EQ(path_call(FileioServer::FUNC_GETSTAT, STAT, "cdrom0:\\DATA\\LEVEL1.BIN;1"), 0);
+    ASSERT_EQ(writes.size(), 1u);
+    EXPECT_EQ(writes[0].address, STAT);
+    EXPECT_EQ(load32(writes[0].data.data(), FileioServer::STAT_MODE), FileioServer::MODE_FILE);
+    EXPECT_EQ(load32(writes[0].data.data(), FileioServer::STAT_FILE_SIZE), 5003u);
+
+    ASSERT_EQ(path_call(FileioServer::FUNC_GETSTAT, STAT, "cdrom0:\\DATA"), 0);
+    EXPECT_EQ(load32(writes[0].data.data(), FileioServer::STAT_MODE), FileioServer::MODE_DIR);
+}
@@ -0,0 +1,260 @@
+#include "iop_mc.h"
+#include <algorithm>
+#include <cerrno>
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// mcNameParam: port, slot, flags, maxent, table, name[1024].
+constexpr u32 NAME_PORT = 0;
+constexpr u32 NAME_FLAGS = 2;
+constexpr u32 NAME_MAX_ENTRIES = 3;
+constexpr u32 NAME_TABLE = 4;
+constexpr u32 NAME_PATH = 20;
+constexpr u32 NAME_PATH_SIZE = 1024;
+
+// mcDescParam: fd (port for GetInfo), size, offset, origin, buffer, param, data[16].
+// Written data follows it.
+constexpr u32 DESC_FD = 0;
+constexpr u32 DESC_SIZE = 1;
+constexpr u32 DESC_OFFSET = 2;
+constexpr u32 DESC_ORIGIN = 3;
+constexpr u32 DESC_BUFFER = 4;
+constexpr u32 DESC_WRITE_DATA = 48;
+
+std::string path_arg(const RpcCall& call) {
+    if (call.args.size() <= NAME_PATH) {
+        return std::string();
+    }
+    const char* path = (const char*)call.args.data() + NAME_PATH;
+    return std::string(path, strnlen(path, std::min<size_t>(NAME_PATH_SIZE, call.args.size() - NAME_PATH)));
+}
+
+void make_dirs(const std::string& path) {
+    for (size_t slash = path.find('/', 1); slash != std::string::npos; slash = path.find('/', slash + 1)) {
+        mkdir(path.substr(0, slash).c_str(), 0755);
+    }
+}
+
+} // namespace
+
+McServer::McServer() : root("memcards") {
+    std::fill(std::begin(files), std::end(files), -1);
+    for (std::string& dir : cwd) {
+        dir = "/";
+    }
+}
+
+McServer::~McServer() {
+    for (int fd : files) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+void McServer::set_root(const std::string& directory) {
+    root = directory;
+}
+
+// Card paths are absolute from the card's root or relative to its current directory;
+// ".." never leaves the card.
+std::string McServer::host_path(u32 port, const std::string& path) const {
+    std::vector<std::string> parts;
+    const std::string full = path.empty() || path[0] != '/' ? cwd[port] + "/" + path : path;
+    size_t start = 0;
+    while (start <= full.size()) {
+        size_t end = full.find('/', start);
+        if (end == std::string::npos) {
+            end = full.size();
+        }
+        const std::string part = full.substr(start, end - start);
+        if (part == "..") {
+            if (!parts.empty()) {
+                parts.pop_back();
+            }
+        } else if (!part.empty() && part != ".") {
+            parts.push_back(part);
+        }
+        start = end + 1;
+    }
+    std::string result = root + "/mc" + std::to_string(port);
+    for (const std::string& part : parts) {
+        result += "/" + part;
+    }
+    return result;
+}
+
+void McServer::serve(void* user, RpcCall& call) {
+    McServer& mc = *static_cast<McServer*>(user);
+    s32 result = RES_SUCCEED;
+    switch (call.function) {
+        case CMD_GET_INFO:
+            call.set_reply(1, CARD_PS2);
+            call.set_reply(2, FREE_CLUSTERS);
+            call.set_reply(3, 1);       // Formatted
+            break;
+        case CMD_OPEN:
+            result = mc.open(call);
+            break;
+        case CMD_CLOSE: {
+            const u32 fd = call.arg(DESC_FD);
+            if (fd < MAX_FILES && mc.files[fd] >= 0) {
+                ::close(mc.files[fd]);
+                mc.files[fd] = -1;
+            } else {
+                result = RES_DENIED;
+            }
+            break;
+        }
+        case CMD_SEEK: {
+            const u32 fd = call.arg(DESC_FD);
+            static const int whence[] = { SEEK_SET, SEEK_CUR, SEEK_END };
+            const u32 origin = call.arg(DESC_ORIGIN);
+            if (fd < MAX_FILES && mc.files[fd] >= 0 && origin < 3) {
+                result = (s32)lseek(mc.files[fd], (s32)call.arg(DESC_OFFSET), whence[origin]);
+            } else {
+                result = RES_DENIED;
+            }
+            break;
+        }
+        case CMD_READ:
+            result = mc.read(call);
+            break;
+        case CMD_WRITE:
+            result = mc.write(call);
+            break;
+        case CMD_FLUSH: {
+            const u32 fd = call.arg(DESC_FD);
+            if (fd < MAX_FILES && mc.files[fd] >= 0) {
+                fsync(mc.files[fd]);
+            }
+            break;
+        }
+        case CMD_CHANGE_DIR: {
+            const u32 port = call.arg(NAME_PORT) % PORT_COUNT;
+            const std::string path = mc.host_path(port, path_arg(call));
+            struct stat info;
+            if (stat(path.c_str(), &info) != 0 || !S_ISDIR(info.st_mode)) {
+                result = RES_NO_ENTRY;
+            } else {
+                const std::string prefix = mc.host_path(port, "/");
+                mc.cwd[port] = path.size() > prefix.size() ? path.substr(prefix.size()) : "/";
+            }
+            break;
+        }
+        case CMD_GET_DIR:
+            result = mc.get_dir(call);
+            break;
+        case CMD_DELETE:
+            result = mc.remove(call);
+            break;
+    }
+    call.set_reply(0, (u32)result);
+}
+
+s32 McServer::open(RpcCall& call) {
+    const u32 port = call.arg(NAME_PORT) % PORT_COUNT;
+    const u32 flags = call.arg(NAME_FLAGS);
+    const std::string path = host_path(port, path_arg(call));
+    make_dirs(host_path(port, "/") + "/");      // The card itself, on first use
+    if (flags & OPEN_CREATE_DIR) {
+        return mkdir(path.c_str(), 0755) == 0 ? RES_SUCCEED : RES_NO_ENTRY;
+    }
+
+    u32 slot = 0;
+    while (slot < MAX_FILES && files[slot] >= 0) {
+        slot++;
+    }
+    if (slot == MAX_FILES) {
+        return RES_UP_LIMIT_HANDLE;
+    }
+    int host_flags = (flags & OPEN_WRITE) ? ((flags & OPEN_READ) ? O_RDWR : O_WRONLY) : O_RDONLY;
+    if (flags & OPEN_CREATE) {
+        host_flags |= O_CREAT;
+    }
+    const int fd = ::open(path.c_str(), host_flags | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return RES_NO_ENTRY;
+    }
+    files[slot] = fd;
+    return (s32)slot;
+}
+
+s32 McServer::read(RpcCall& call) {
+    const u32 fd = call.arg(DESC_FD);
+    if (fd >= MAX_FILES || files[fd] < 0) {
+        return RES_DENIED;
+    }
+    EeWrite data{ call.arg(DESC_BUFFER), std::vector<u8>(call.arg(DESC_SIZE)) };
+    const ssize_t got = ::read(files[fd], data.data.data(), data.data.size());
+    if (got < 0) {
+        return RES_DENIED;
+    }
+    data.data.resize((size_t)got);
+    call.writes.push_back(std::move(data));
+    return (s32)got;
+}
+
+s32 McServer::write(RpcCall& call) {
+    const u32 fd = call.arg(DESC_FD);
+    if (fd >= MAX_FILES || files[fd] < 0) {
+        return RES_DENIED;
+    }
+    const size_t available = call.args.size() > DESC_WRITE_DATA ? call.args.size() - DESC_WRITE_DATA : 0;
+    const size_t size = std::min<size_t>(call.arg(DESC_SIZE), available);
+    const ssize_t written = ::write(files[fd], call.args.data() + DESC_WRITE_DATA, size);
+    return written < 0 ? RES_DENIED : (s32)written;
+}
+
+s32 McServer::get_dir(RpcCall& call) {
+    const u32 port = call.arg(NAME_PORT) % PORT_COUNT;
+    const std::string pattern_path = path_arg(call);
+    const size_t slash = pattern_path.rfind('/');
+    const std::string pattern = slash == std::string::npos ? pattern_path : pattern_path.substr(slash + 1);
+    const std::string dir_path = host_path(port, slash == std::string::npos ? "" : pattern_path.substr(0, slash + 1));
+
+    DIR* dir = opendir(dir_path.c_str());
+    if (!dir) {
+        return RES_NO_ENTRY;
+    }
+    EeWrite table{ call.arg(NAME_TABLE), {} };
+    const u32 max_entries = call.arg(NAME_MAX_ENTRIES);
+    u32 count = 0;
+    while (struct dirent* entry = readdir(dir)) {
+        if (count >= max_entries) {
+            break;
+        }
+        if (entry->d_name[0] == '.' || fnmatch(pattern.c_str(), entry->d_name, 0) != 0) {
+            continue;
+        }
+        struct stat info;
+        if (stat((dir_path + "/" + entry->d_name).c_str(), &info) != 0) {
+            continue;
+        }
+        table.data.resize((count + 1) * DIR_ENTRY_SIZE);
+        u8* out = table.data.data() + count * DIR_ENTRY_SIZE;
+        store32(out, DIR_ENTRY_SIZE_FIELD, S_ISDIR(info.st_mode) ? 0 : (u32)info.st_size);
+        const u16 attr = S_ISDIR(info.st_mode) ? ATTR_DIR : ATTR_FILE;
+        std::memcpy(out + DIR_ENTRY_ATTR, &attr, sizeof(attr));
+        std::memcpy(out + DIR_ENTRY_NAME, entry->d_name, std::min<size_t>(strlen(entry->d_name), 31));
+        count++;
+    }
+    closedir(dir);
+    call.writes.push_back(std::move(table));
+    return (s32)count;
+}
+
+s32 McServer::remove(RpcCall& call) {
+    const u32 port = call.arg(NAME_PORT) % PORT_COUNT;
+    const std::string path = host_path(port, path_arg(call));
+    if (::unlink(path.c_str()) == 0 || ::rmdir(path.c_str()) == 0) {
+        return RES_SUCCEED;
+    }
+    return errno == ENOTEMPTY ? RES_NOT_EMPTY : RES_NO_ENTRY;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "sif.h"
+#include <string>
+
+// HLE of mcserv: the memory card file system libmc calls into, kept as plain files in a
+// host directory per port (<root>/mc0, <root>/mc1). Runs on the IOP's memory card
+// worker thread.
+//
+// Function numbers, argument blocks and result codes are those of libmc.
+
+class McServer {
+public:
+    static constexpr u32 SERVER_ID = 0x80000400;
+
+    static constexpr u32 CMD_GET_INFO = 0x01;
+    static constexpr u32 CMD_OPEN = 0x02;
+    static constexpr u32 CMD_CLOSE = 0x03;
+    static constexpr u32 CMD_SEEK = 0x04;
+    static constexpr u32 CMD_READ = 0x05;
+    static constexpr u32 CMD_WRITE = 0x06;
+    static constexpr u32 CMD_FLUSH = 0x0A;
+    static constexpr u32 CMD_CHANGE_DIR = 0x0C;
+    static constexpr u32 CMD_GET_DIR = 0x0D;
+    static constexpr u32 CMD_DELETE = 0x0F;
+
+    // sceMcRes* results.
+    static constexpr s32 RES_SUCCEED = 0;
+    static constexpr s32 RES_NO_ENTRY = -4;
+    static constexpr s32 RES_DENIED = -5;
+    static constexpr s32 RES_NOT_EMPTY = -6;
+    static constexpr s32 RES_UP_LIMIT_HANDLE = -7;
+
+    // Open flags.
+    static constexpr u32 OPEN_READ = 0x0001;
+    static constexpr u32 OPEN_WRITE = 0x0002;
+    static constexpr u32 OPEN_CREATE_DIR = 0x0040;
+    static constexpr u32 OPEN_CREATE = 0x0200;
+
+    static constexpr u32 PORT_COUNT = 2;
+    static constexpr u32 MAX_FILES = 32;
+
+    // sceMcGetInfo(): a formatted 8 MB PS2 card, free space in 1 KB clusters.
+    static constexpr u32 CARD_PS2 = 2;
+    static constexpr u32 FREE_CLUSTERS = 8000;
+
+    // sceMcTblGetDir, one entry per file sceMcGetDir() lists.
+    static constexpr u32 DIR_ENTRY_SIZE = 64;
+    static constexpr u32 DIR_ENTRY_SIZE_FIELD = 16;
+    static constexpr u32 DIR_ENTRY_ATTR = 20;
+    static constexpr u32 DIR_ENTRY_NAME = 32;
+    static constexpr u16 ATTR_FILE = 0x8497;
+    static constexpr u16 ATTR_DIR = 0x8427;
+
+    McServer();
+    ~McServer();
+
+    // Where the card directories live; created on first write.
+    void set_root(const std::string& directory);
+
+    // Runs on the worker thread.
+    static void serve(void* user, RpcCall& call);
+
+private:
+    std::string host_path(u32 port, const std::string& path) const;
+    s32 open(RpcCall& call);
+    s32 get_dir(RpcCall& call);
+    s32 remove(RpcCall& call);
+    s32 read(RpcCall& call);
+    s32 write(RpcCall& call);
+
+    std::string root;
+    std::string cwd[PORT_COUNT];
+    int files[MAX_FILES];
+};
@@ -0,0 +1,102 @@
+#include "gtest/gtest.h"
+#include "iop_mc.h"
+#include <cstdlib>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr u32 TABLE = 0x00200000;
+
+class McServerTest : public ::testing::Test {
+protected:
+    McServerTest() {
+        char path[] = "/tmp/iop_mc_testXXXXXX";
+        root = mkdtemp(path);
+        mc.set_root(root);
+    }
+    ~McServerTest() override {
+        std::system(("rm -rf " + root).c_str());
+    }
+
+    // mcNameParam calls: open, change dir, get dir, delete.
+    s32 name_call(u32 function, const std::string& name, u32 flags = 0, u32 max_entries = 0) {
+        RpcCall call;
+        call.function = function;
+        call.args.resize(20 + 1024);
+        store32(call.args.data(), 8, flags);
+        store32(call.args.data(), 12, max_entries);
+        store32(call.args.data(), 16, TABLE);
+        std::memcpy(call.args.data() + 20, name.data(), name.size());
+        McServer::serve(&mc, call);
+        if (!call.writes.empty()) {
+            last_write = call.writes[0].data;
+        }
+        return (s32)load32(call.reply.data(), 0);
+    }
+
+    // mcDescParam calls: close, seek, read, write.
+    s32 desc_call(u32 function, s32 fd, u32 size, const std::string& data = "") {
+        RpcCall call;
+        call.function = function;
+        call.args.resize(48 + data.size());
+        store32(call.args.data(), 0, (u32)fd);
+        store32(call.args.data(), 4, size);
+        store32(call.args.data(), 16, TABLE);
+        std::memcpy(call.args.data() + 48, data.data(), data.size());
+        McServer::serve(&mc, call);
+        if (!call.writes.empty()) {
+            last_write = call.writes[0].data;
+        }
+        return (s32)load32(call.reply.data(), 0);
+    }
+
+    std::string root;
+    McServer mc;
+    std::vector<u8> last_write;
+};
+
+} // namespace
+
+TEST_F(McServerTest, WrittenFilesReadBack) {
+    // 1. Arrange: mkdir a save directory and write a file in it.
+    ASSERT_EQ(name_call(McServer::CMD_OPEN, "/SAVE0", McServer::OPEN_CREATE_DIR), McServer::RES_SUCCEED);
+    const s32 out = name_call(McServer::CMD_OPEN, "/SAVE0/data.bin", McServer::OPEN_CREATE | McServer::OPEN_WRITE);
+    ASSERT_GE(out, 0);
+    EXPECT_EQ(desc_call(McServer::CMD_WRITE, out, 5, "hello"), 5);
+    EXPECT_EQ(desc_call(McServer::CMD_CLOSE, out, 0), McServer::RES_SUCCEED);
+
+    // 2. Act: read it back relative to the card's current directory.
+    ASSERT_EQ(name_call(McServer::CMD_CHANGE_DIR, "/SAVE0"), McServer::RES_SUCCEED);
+    const s32 in = name_call(McServer::CMD_OPEN, "data.bin", McServer::OPEN_READ);
+    ASSERT_GE(in, 0);
+    const s32 got = desc_call(McServer::CMD_READ, in, 16);
+
+    // 3. Assert: it lives under <root>/mc0 and the bytes go to the EE buffer.
+    EXPECT_EQ(got, 5);
+    EXPECT_EQ(std::string(last_write.begin(), last_write.end()), "hello");
+    EXPECT_EQ(desc_call(McServer::CMD_CLOSE, in, 0), McServer::RES_SUCCEED);
+    EXPECT_EQ(access((root + "/mc0/SAVE0/data.bin").c_str(), F_OK), 0);
+}
+
+TEST_F(McServerTest, GetDirListsMatchingEntries) {
+    name_call(McServer::CMD_OPEN, "/SAVE0", McServer::OPEN_CREATE_DIR);
+    name_call(McServer::CMD_OPEN, "/SAVE1", McServer::OPEN_CREATE_DIR);
+    desc_call(McServer::CMD_CLOSE, name_call(McServer::CMD_OPEN, "/icon.sys", McServer::OPEN_CREATE | McServer::OPEN_WRITE), 0);
+
+    const s32 count = name_call(McServer::CMD_GET_DIR, "/SAVE*", 0, 8);
+
+    EXPECT_EQ(count, 2);
+    ASSERT_EQ(last_write.size(), 2 * McServer::DIR_ENTRY_SIZE);
+    u16 attr;
+    std::memcpy(&attr, last_write.data() + McServer::DIR_ENTRY_ATTR, sizeof(attr));
+    EXPECT_EQ(attr, McServer::ATTR_DIR);
+}
+
+TEST_F(McServerTest, MissingFilesAndBadHandlesFail) {
+    EXPECT_EQ(name_call(McServer::CMD_OPEN, "/nope.bin", McServer::OPEN_READ), McServer::RES_NO_ENTRY);
+    EXPECT_EQ(desc_call(McServer::CMD_READ, 3, 16), McServer::RES_DENIED);
+    EXPECT_EQ(name_call(McServer::CMD_DELETE, "/nope.bin"), McServer::RES_NO_ENTRY);
+    EXPECT_EQ(name_call(McServer::CMD_CHANGE_DIR, "/../.."), McServer::RES_SUCCEED);    // Stays on the card
+}
@@ -0,0 +1,92 @@
+#include "iop_pad.h"
+
+namespace {
+
+// Argument words: command, port, slot, then the command's own. Results go in word 3.
+constexpr u32 ARG_PORT = 1;
+constexpr u32 ARG_MODE = 3;
+constexpr u32 ARG_AREA = 4;
+constexpr u32 REPLY_RESULT = 3;
+
+} // namespace
+
+void PadServer::set_buttons(u32 port, u16 pressed) {
+    if (port < PORT_COUNT) {
+        buttons[port].store(pressed, std::memory_order_relaxed);
+    }
+}
+
+void PadServer::set_sticks(u32 port, u8 right_x, u8 right_y, u8 left_x, u8 left_y) {
+    if (port < PORT_COUNT) {
+        sticks[port].store((u32)right_x | (u32)right_y << 8 | (u32)left_x << 16 | (u32)left_y << 24, std::memory_order_relaxed);
+    }
+}
+
+void PadServer::serve(void* user, RpcCall& call) {
+    PadServer& pad = *static_cast<PadServer*>(user);
+    std::lock_guard<std::mutex> lock(pad.mutex);
+    const u32 port = call.arg(ARG_PORT);
+    u32 result = 1;
+    switch (call.arg(0)) {
+        case CMD_OPEN:
+            if (port < PORT_COUNT) {
+                pad.ports[port] = Port{ call.arg(ARG_AREA), 0, false };
+            } else {
+                result = 0;
+            }
+            break;
+        case CMD_CLOSE:
+            if (port < PORT_COUNT) {
+                pad.ports[port] = Port{};
+            }
+            break;
+        case CMD_SET_MAIN_MODE:
+            if (port < PORT_COUNT) {
+                pad.ports[port].analog = call.arg(ARG_MODE) != 0;
+            }
+            break;
+        case CMD_GET_PORT_MAX:
+            result = PORT_COUNT;
+            break;
+        case CMD_GET_SLOT_MAX:
+            result = 1;
+            break;
+    }
+    call.reply = call.args;
+    call.set_reply(REPLY_RESULT, result);
+}
+
+void PadServer::update(std::vector<EeWrite>& writes) {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (u32 port = 0; port < PORT_COUNT; port++) {
+        Port& state = ports[port];
+        if (!state.area) {
+            continue;
+        }
+        // Overwrite the older of the two halves, so the other stays consistent while
+        // libpad may be reading it.
+        EeWrite write{ state.area + (state.frame & 1) * pad_area::SIZE, std::vector<u8>(pad_area::SIZE) };
+        fill(port, write.data.data());
+        writes.push_back(std::move(write));
+    }
+}
+
+void PadServer::fill(u32 port, u8* data) {
+    Port& state = ports[port];
+    const u16 pressed = (u16)buttons[port].load(std::memory_order_relaxed);
+    const u32 stick = sticks[port].load(std::memory_order_relaxed);
+    const u16 reported = (u16)~pressed;
+
+    data[pad_area::DATA + 0] = 0;
+    data[pad_area::DATA + 1] = state.analog ? MODE_ANALOG : MODE_DIGITAL;
+    data[pad_area::DATA + 2] = (u8)reported;
+    data[pad_area::DATA + 3] = (u8)(reported >> 8);
+    store32(data, pad_area::DATA + 4, state.analog ? stick : 0x80808080u);
+    state.frame++;
+    store32(data, pad_area::FRAME, state.frame);
+    store32(data, pad_area::LENGTH, state.analog ? 8 : 4);
+    data[pad_area::MODE_CURRENT_ID] = state.analog ? MODE_ANALOG : MODE_DIGITAL;
+    data[pad_area::BUTTON_DATA_READY] = 1;
+    data[pad_area::STATE] = STATE_STABLE;
+    data[pad_area::OK] = 1;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "sif.h"
+#include <atomic>
+#include <mutex>
+
+// HLE of padman: the RPC server libpad opens ports through, and the per-frame update of
+// the pad areas libpad reads buttons from. The real padman polls the controllers over
+// SIO2 and DMAs the result into the EE's pad area every frame; here the host's input
+// is written there at VBLANK, on the EE thread.
+//
+// Commands, pad area layout and button bits are those of libpad.
+
+namespace pad_area {
+    // pad_data_t. The area holds two of them; libpad reads the one with the larger frame.
+    constexpr u32 DATA = 0;             // padButtonStatus: ok, mode, buttons, sticks
+    constexpr u32 FRAME = 88;
+    constexpr u32 LENGTH = 96;
+    constexpr u32 MODE_CURRENT_ID = 101;
+    constexpr u32 BUTTON_DATA_READY = 103;
+    constexpr u32 STATE = 110;
+    constexpr u32 OK = 112;
+    constexpr u32 SIZE = 128;
+}
+
+// Button bits of padButtonStatus.btns, set when pressed (the pad reports them inverted).
+namespace pad_button {
+    constexpr u16 SELECT = 1u << 0;
+    constexpr u16 L3 = 1u << 1;
+    constexpr u16 R3 = 1u << 2;
+    constexpr u16 START = 1u << 3;
+    constexpr u16 UP = 1u << 4;
+    constexpr u16 RIGHT = 1u << 5;
+    constexpr u16 DOWN = 1u << 6;
+    constexpr u16 LEFT = 1u << 7;
+    constexpr u16 L2 = 1u << 8;
+    constexpr u16 R2 = 1u << 9;
+    constexpr u16 L1 = 1u << 10;
+    constexpr u16 R1 = 1u << 11;
+    constexpr u16 TRIANGLE = 1u << 12;
+    constexpr u16 CIRCLE = 1u << 13;
+    constexpr u16 CROSS = 1u << 14;
+    constexpr u16 SQUARE = 1u << 15;
+}
+
+class PadServer {
+public:
+    static constexpr u32 SERVER_CONTROL = 0x8000010F;
+    static constexpr u32 SERVER_DATA = 0x8000011F;
+
+    // Commands, in the first word of the argument buffer.
+    static constexpr u32 CMD_OPEN = 0x80000100;
+    static constexpr u32 CMD_SET_MAIN_MODE = 0x80000105;
+    static constexpr u32 CMD_GET_PORT_MAX = 0x8000010B;
+    static constexpr u32 CMD_GET_SLOT_MAX = 0x8000010C;
+    static constexpr u32 CMD_CLOSE = 0x8000010D;
+
+    static constexpr u32 PORT_COUNT = 2;
+
+    // padButtonStatus.mode: controller type in the high nibble, half the data length in
+    // the low one.
+    static constexpr u8 MODE_DIGITAL = 0x41;
+    static constexpr u8 MODE_ANALOG = 0x73;
+
+    static constexpr u8 STATE_STABLE = 6;
+
+    // Host input, from any thread. `buttons` uses pad_button bits.
+    void set_buttons(u32 port, u16 buttons);
+    void set_sticks(u32 port, u8 right_x, u8 right_y, u8 left_x, u8 left_y);
+
+    // Runs on the worker thread.
+    static void serve(void* user, RpcCall& call);
+
+    /**
+     * @brief The pad area contents of every open port, for the IOP to copy into EE RAM.
+     * Called at VBLANK on the EE thread.
+     */
+    void update(std::vector<EeWrite>& writes);
+
+private:
+    struct Port {
+        u32 area = 0;           // EE address of the pad area, 0 while closed
+        u32 frame = 0;
+        bool analog = false;
+    };
+
+    void fill(u32 port, u8* data);
+
+    std::mutex mutex;
+    Port ports[PORT_COUNT];
+    std::atomic<u32> buttons[PORT_COUNT] = {};
+    std::atomic<u32> sticks[PORT_COUNT] = { { 0x80808080u }, { 0x80808080u } };
+};
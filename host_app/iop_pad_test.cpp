@@ -0,0 +1,67 @@
+#include "gtest/gtest.h"
+#include "iop_pad.h"
+#include <vector>
+
+namespace {
+
+constexpr u32 AREA = 0x00200000;
+
+class PadServerTest : public ::testing::Test {
+protected:
+    // The reply is the argument block with the result in word 3.
+    u32 call(const std::vector<u32>& args) {
+        RpcCall rpc;
+        rpc.args.resize(args.size() * 4);
+        for (size_t i = 0; i < args.size(); i++) {
+            store32(rpc.args.data(), (u32)i * 4, args[i]);
+        }
+        PadServer::serve(&pad, rpc);
+        return load32(rpc.reply.data(), 12);
+    }
+
+    PadServer pad;
+};
+
+} // namespace
+
+TEST_F(PadServerTest, ClosedPortsAreNotWritten) {
+    std::vector<EeWrite> writes;
+    pad.update(writes);
+    EXPECT_TRUE(writes.empty());
+    EXPECT_EQ(call({ PadServer::CMD_GET_PORT_MAX, 0, 0, 0 }), PadServer::PORT_COUNT);
+}
+
+TEST_F(PadServerTest, UpdateAlternatesHalvesAndReportsButtonsInverted) {
+    // 1. Arrange
+    ASSERT_EQ(call({ PadServer::CMD_OPEN, 1, 0, 0, AREA }), 1u);
+    pad.set_buttons(1, pad_button::START | pad_button::CIRCLE);
+
+    // 2. Act
+    std::vector<EeWrite> writes;
+    pad.update(writes);
+    pad.update(writes);
+
+    // 3. Assert
+    ASSERT_EQ(writes.size(), 2u);
+    EXPECT_EQ(writes[0].address, AREA);
+    EXPECT_EQ(writes[1].address, AREA + pad_area::SIZE);
+    const u8* data = writes[1].data.data();
+    EXPECT_EQ(load32(data, pad_area::FRAME), 2u);
+    EXPECT_EQ(data[pad_area::DATA + 1], PadServer::MODE_DIGITAL);
+    EXPECT_EQ(data[pad_area::DATA + 2], (u8)~pad_button::START);
+    EXPECT_EQ(data[pad_area::DATA + 3], (u8)~(pad_button::CIRCLE >> 8));
+    EXPECT_EQ(data[pad_area::STATE], PadServer::STATE_STABLE);
+}
+
+TEST_F(PadServerTest, AnalogModeReportsSticks) {
+    call({ PadServer::CMD_OPEN, 0, 0, 0, AREA });
+    call({ PadServer::CMD_SET_MAIN_MODE, 0, 0, 1 });
+    pad.set_sticks(0, 0x10, 0x20, 0x30, 0x40);
+
+    std::vector<EeWrite> writes;
+    pad.update(writes);
+
+    ASSERT_EQ(writes.size(), 1u);
+    EXPECT_EQ(writes[0].data[pad_area::DATA + 1], PadServer::MODE_ANALOG);
+    EXPECT_EQ(load32(writes[0].data.data(), pad_area::DATA + 4), 0x40302010u);
+}
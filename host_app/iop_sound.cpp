@@ -0,0 +1,211 @@
+#include "iop_sound.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// sceSdBatch: u16 func, u16 entry, u32 value.
+constexpr u32 BATCH_SIZE = 8;
+
+} // namespace
+
+SoundServer::SoundServer() : iop_ram(nullptr), iop_ram_size(0), spu2(nullptr), ram(SPU_RAM_SIZE) {}
+
+void SoundServer::set_iop_memory(u8* ram, u32 size) {
+    iop_ram = ram;
+    iop_ram_size = size;
+}
+
+u32 SoundServer::lookup(const std::unordered_map<u32, u32>& table, u32 entry) {
+    const auto it = table.find(entry);
+    return it == table.end() ? 0 : it->second;
+}
+
+u32 SoundServer::param(u32 entry) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lookup(params, entry);
+}
+
+u32 SoundServer::address(u32 entry) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lookup(addresses, entry);
+}
+
+u32 SoundServer::switches(u32 entry) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lookup(switch_values, entry);
+}
+
+u32 SoundServer::core_attr(u32 entry) const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return lookup(core_attrs, entry);
+}
+
+void SoundServer::reset() {
+    params.clear();
+    addresses.clear();
+    switch_values.clear();
+    core_attrs.clear();
+    std::fill(ram.begin(), ram.end(), 0);
+    if (spu2) {
+        for (u32 core = 0; core < Spu2::CORES; core++) {
+            spu2->write_switch(spu2::S_KOFF | core, (1u << Spu2::VOICES) - 1);
+            spu2->write_effect_mode(core, spu2::EFFECT_MODE_OFF);
+        }
+    }
+}
+
+void SoundServer::set_param(u32 entry, u32 value) {
+    params[entry] = value & 0xFFFF;
+    if (spu2) {
+        spu2->write_param(entry, value & 0xFFFF);
+    }
+}
+
+void SoundServer::set_switch(u32 entry, u32 value) {
+    switch_values[entry] = value;
+    if (spu2) {
+        spu2->write_switch(entry, value);
+    }
+}
+
+void SoundServer::set_address(u32 entry, u32 value) {
+    addresses[entry] = value & (SPU_RAM_SIZE - 1);
+    if (spu2) {
+        spu2->write_address(entry, value & (SPU_RAM_SIZE - 1));
+    }
+}
+
+void SoundServer::set_core_attr(u32 entry, u32 value) {
+    core_attrs[entry] = value;
+    if (spu2) {
+        spu2->write_core_attr(entry, value);
+    }
+}
+
+// The depth is the reverb's output volume, EVOL.
+void SoundServer::set_effect(u32 core, u32 mode, u32 depth_left, u32 depth_right) {
+    set_param(spu2::P_EVOLL | core, depth_left);
+    set_param(spu2::P_EVOLR | core, depth_right);
+    if (spu2) {
+        spu2->write_effect_mode(core, mode);
+    }
+}
+
+void SoundServer::serve(void* user, RpcCall& call) {
+    SoundServer& sound = *static_cast<SoundServer*>(user);
+    std::lock_guard<std::mutex> lock(sound.mutex);
+    u32 result = 0;
+    switch (call.function) {
+        case CMD_INIT:
+            sound.reset();
+            break;
+        case CMD_SET_PARAM:
+            sound.set_param(call.arg(0), call.arg(1));
+            break;
+        case CMD_GET_PARAM:
+            if (sound.spu2 && (call.arg(0) & spu2::ENTRY_REGISTER_MASK) == spu2::VP_ENVX) {
+                result = sound.spu2->envelope(spu2::entry_core(call.arg(0)), spu2::entry_voice(call.arg(0)));
+            } else {
+                result = lookup(sound.params, call.arg(0));
+            }
+            break;
+        case CMD_SET_SWITCH:
+            sound.set_switch(call.arg(0), call.arg(1));
+            break;
+        case CMD_GET_SWITCH:
+            if (sound.spu2 && (call.arg(0) & spu2::ENTRY_REGISTER_MASK) == spu2::S_ENDX) {
+                result = sound.spu2->endx(spu2::entry_core(call.arg(0)));
+            } else {
+                result = lookup(sound.switch_values, call.arg(0));
+            }
+            break;
+        case CMD_SET_ADDR:
+            sound.set_address(call.arg(0), call.arg(1));
+            break;
+        case CMD_GET_ADDR:
+            result = lookup(sound.addresses, call.arg(0));
+            break;
+        case CMD_SET_CORE_ATTR:
+            sound.set_core_attr(call.arg(0), call.arg(1));
+            break;
+        case CMD_GET_CORE_ATTR:
+            result = lookup(sound.core_attrs, call.arg(0));
+            break;
+        case CMD_NOTE_TO_PITCH: {
+            // (center note, center fine, note, fine), fine in 1/128 semitones; 0x1000 is
+            // the sample's own rate.
+            const double center = (double)call.arg(0) + (double)call.arg(1) / 128.0;
+            const double note = (double)call.arg(2) + (double)(s16)call.arg(3) / 128.0;
+            result = (u32)std::min(0x3FFFL, std::lround(4096.0 * std::exp2((note - center) / 12.0)));
+            break;
+        }
+        case CMD_PITCH_TO_NOTE: {
+            // (center note, center fine, pitch) to note << 8 | fine.
+            const double pitch = std::max(1u, call.arg(2) & 0xFFFF);
+            const double note = (double)call.arg(0) + (double)call.arg(1) / 128.0 + 12.0 * std::log2(pitch / 4096.0);
+            const long fine = std::lround(note * 128.0);
+            result = (u32)(((fine / 128) << 8) | (fine % 128));
+            break;
+        }
+        case CMD_PROC_BATCH:
+            result = sound.proc_batch(call.arg(0), call.arg(1));
+            break;
+        case CMD_VOICE_TRANS:
+        case CMD_BLOCK_TRANS:
+            // (channel, mode, IOP address, SPU2 address, size)
+            result = sound.voice_trans(call.arg(1), call.arg(2), call.arg(3), call.arg(4));
+            break;
+        case CMD_VOICE_TRANS_STATUS:
+            result = 1;             // Transfers finish before their call returns
+            break;
+        case CMD_BLOCK_TRANS_STATUS:
+            result = 0;
+            break;
+        case CMD_SET_EFFECT_ATTR:
+            // (core, mode, depth left, depth right, delay, feedback); echo and delay play
+            // their presets as they are, so the last two go unused.
+            sound.set_effect(call.arg(0) & 1, call.arg(1), call.arg(2), call.arg(3));
+            break;
+    }
+    call.set_reply(0, result);
+}
+
+u32 SoundServer::voice_trans(u32 mode, u32 iop_address, u32 spu_address, u32 size) {
+    if (!iop_ram) {
+        return 0;
+    }
+    iop_address &= iop_ram_size - 1;
+    spu_address &= SPU_RAM_SIZE - 1;
+    size = std::min({ size, iop_ram_size - iop_address, SPU_RAM_SIZE - spu_address });
+    if (mode & TRANS_READ) {
+        std::memcpy(iop_ram + iop_address, ram.data() + spu_address, size);
+    } else {
+        std::memcpy(ram.data() + spu_address, iop_ram + iop_address, size);
+        if (spu2) {
+            spu2->write_ram(spu_address, ram.data() + spu_address, size);
+        }
+    }
+    return size;
+}
+
+u32 SoundServer::proc_batch(u32 iop_address, u32 count) {
+    if (!iop_ram) {
+        return 0;
+    }
+    iop_address &= iop_ram_size - 1;
+    count = std::min(count, (iop_ram_size - iop_address) / BATCH_SIZE);
+    for (u32 i = 0; i < count; i++) {
+        const u8* batch = iop_ram + iop_address + i * BATCH_SIZE;
+        const u32 head = load32(batch, 0);
+        const u32 entry = head >> 16;
+        const u32 value = load32(batch, 4);
+        switch ((u16)head) {
+            case BATCH_SET_PARAM: set_param(entry, value); break;
+            case BATCH_SET_SWITCH: set_switch(entry, value); break;
+            case BATCH_SET_ADDR: set_address(entry, value); break;
+            case BATCH_SET_CORE: set_core_attr(entry, value); break;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "sif.h"
+#include "spu2.h"
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+// HLE of libsd as the EE drives it through sdremote (sceSdRemote()): SPU2 parameters,
+// switches, addresses and core attributes, and transfers of sample data from IOP RAM
+// into the 2 MB of SPU2 RAM. Runs on the IOP's sound worker thread.
+//
+// Entry numbers keep libsd's encoding (core in bit 0, voice in bits 1-5, register in the
+// rest), so whatever plays the voices can look them up as the game wrote them. With a
+// voice engine attached every setting and upload is also forwarded to it, and the voice
+// status the game polls (ENDX, ENVX) comes from it.
+
+class SoundServer {
+public:
+    static constexpr u32 SERVER_ID = 0x80000701;
+    static constexpr u32 SPU_RAM_SIZE = 2 * 1024 * 1024;
+
+    // sdremote commands, by function number.
+    static constexpr u32 CMD_INIT = 0x8000;
+    static constexpr u32 CMD_SET_PARAM = 0x8010;
+    static constexpr u32 CMD_GET_PARAM = 0x8020;
+    static constexpr u32 CMD_SET_SWITCH = 0x8030;
+    static constexpr u32 CMD_GET_SWITCH = 0x8040;
+    static constexpr u32 CMD_SET_ADDR = 0x8050;
+    static constexpr u32 CMD_GET_ADDR = 0x8060;
+    static constexpr u32 CMD_SET_CORE_ATTR = 0x8070;
+    static constexpr u32 CMD_GET_CORE_ATTR = 0x8080;
+    static constexpr u32 CMD_NOTE_TO_PITCH = 0x8090;
+    static constexpr u32 CMD_PITCH_TO_NOTE = 0x80A0;
+    static constexpr u32 CMD_PROC_BATCH = 0x80B0;
+    static constexpr u32 CMD_VOICE_TRANS = 0x80D0;
+    static constexpr u32 CMD_BLOCK_TRANS = 0x80E0;
+    static constexpr u32 CMD_VOICE_TRANS_STATUS = 0x80F0;
+    static constexpr u32 CMD_BLOCK_TRANS_STATUS = 0x8100;
+    static constexpr u32 CMD_SET_EFFECT_ATTR = 0x8130;
+
+    // sceSdBatch.func values for CMD_PROC_BATCH.
+    static constexpr u16 BATCH_SET_PARAM = 1;
+    static constexpr u16 BATCH_SET_SWITCH = 2;
+    static constexpr u16 BATCH_SET_ADDR = 3;
+    static constexpr u16 BATCH_SET_CORE = 4;
+
+    // VOICE_TRANS mode bit 0: 0 = IOP RAM to SPU2 RAM, 1 = the other way.
+    static constexpr u32 TRANS_READ = 1;
+
+    SoundServer();
+
+    /**
+     * @brief IOP RAM, where transfer sources live. The EE fills it with sceSifSetDma()
+     * before asking for a transfer.
+     */
+    void set_iop_memory(u8* ram, u32 size);
+
+    void set_voice_engine(Spu2* engine) { spu2 = engine; }
+
+    // Runs on the worker thread.
+    static void serve(void* user, RpcCall& call);
+
+    // What the game set, for the voice engine. Entries never written read as 0.
+    u32 param(u32 entry) const;
+    u32 address(u32 entry) const;
+    u32 switches(u32 entry) const;
+    u32 core_attr(u32 entry) const;
+
+    const u8* spu_ram() const { return ram.data(); }
+
+private:
+    static u32 lookup(const std::unordered_map<u32, u32>& table, u32 entry);
+    void reset();
+    u32 voice_trans(u32 mode, u32 iop_address, u32 spu_address, u32 size);
+    u32 proc_batch(u32 iop_address, u32 count);
+
+    void set_param(u32 entry, u32 value);
+    void set_switch(u32 entry, u32 value);
+    void set_address(u32 entry, u32 value);
+    void set_core_attr(u32 entry, u32 value);
+    void set_effect(u32 core, u32 mode, u32 depth_left, u32 depth_right);
+
+    u8* iop_ram;
+    u32 iop_ram_size;
+    Spu2* spu2;
+    mutable std::mutex mutex;   // The worker against readers on other threads
+    std::vector<u8> ram;
+    std::unordered_map<u32, u32> params;
+    std::unordered_map<u32, u32> addresses;
+    std::unordered_map<u32, u32> switch_values;
+    std::unordered_map<u32, u32> core_attrs;
+};
@@ -0,0 +1,78 @@
+#include "gtest/gtest.h"
+#include "iop_sound.h"
+#include <vector>
+
+namespace {
+
+class SoundServerTest : public ::testing::Test {
+protected:
+    SoundServerTest() : iop_ram(IOP_RAM_SIZE) {
+        sound.set_iop_memory(iop_ram.data(), IOP_RAM_SIZE);
+    }
+
+    u32 call(u32 function, const std::vector<u32>& args = {}) {
+        RpcCall rpc;
+        rpc.function = function;
+        rpc.args.resize(args.size() * 4);
+        for (size_t i = 0; i < args.size(); i++) {
+            store32(rpc.args.data(), (u32)i * 4, args[i]);
+        }
+        SoundServer::serve(&sound, rpc);
+        return load32(rpc.reply.data(), 0);
+    }
+
+    static constexpr u32 IOP_RAM_SIZE = 64 * 1024;
+    std::vector<u8> iop_ram;
+    SoundServer sound;
+};
+
+} // namespace
+
+TEST_F(SoundServerTest, ParametersReadBackAsWritten) {
+    // 1. Arrange / 2. Act: voice 3 of core 1, as libsd encodes entries.
+    const u32 entry = 1 | 3 << 1 | 0x0200;
+    call(SoundServer::CMD_SET_PARAM, { entry, 0x13FFF });
+    call(SoundServer::CMD_SET_ADDR, { entry, 0x00205000 });
+    call(SoundServer::CMD_SET_SWITCH, { entry, 0xFFFFFF });
+
+    // 3. Assert: parameters are 16 bits, addresses wrap at SPU2 RAM.
+    EXPECT_EQ(call(SoundServer::CMD_GET_PARAM, { entry }), 0x3FFFu);
+    EXPECT_EQ(sound.param(entry), 0x3FFFu);
+    EXPECT_EQ(sound.address(entry), 0x00005000u);
+    EXPECT_EQ(sound.switches(entry), 0xFFFFFFu);
+    EXPECT_EQ(sound.param(entry + 2), 0u);
+}
+
+TEST_F(SoundServerTest, VoiceTransCopiesIopRamToSpuRam) {
+    // 1. Arrange
+    for (u32 i = 0; i < 256; i++) {
+        iop_ram[0x1000 + i] = (u8)i;
+    }
+
+    // 2. Act: (channel, mode, IOP address, SPU2 address, size)
+    const u32 moved = call(SoundServer::CMD_VOICE_TRANS, { 0, 0, 0x1000, 0x5000, 256 });
+
+    // 3. Assert
+    EXPECT_EQ(moved, 256u);
+    EXPECT_EQ(sound.spu_ram()[0x5000 + 7], 7u);
+    EXPECT_EQ(sound.spu_ram()[0x5000 + 255], 255u);
+    EXPECT_EQ(call(SoundServer::CMD_VOICE_TRANS_STATUS, { 0 }), 1u);
+}
+
+TEST_F(SoundServerTest, BatchAppliesEachEntry) {
+    // sceSdBatch: u16 func, u16 entry, u32 value.
+    store32(iop_ram.data(), 0x2000, SoundServer::BATCH_SET_PARAM | 0x0040u << 16);
+    store32(iop_ram.data(), 0x2004, 0x1234);
+    store32(iop_ram.data(), 0x2008, SoundServer::BATCH_SET_ADDR | 0x0041u << 16);
+    store32(iop_ram.data(), 0x200C, 0x8000);
+
+    EXPECT_EQ(call(SoundServer::CMD_PROC_BATCH, { 0x2000, 2 }), 2u);
+    EXPECT_EQ(sound.param(0x40), 0x1234u);
+    EXPECT_EQ(sound.address(0x41), 0x8000u);
+}
+
+TEST_F(SoundServerTest, NoteToPitchIsTwelveToneEqual) {
+    EXPECT_EQ(call(SoundServer::CMD_NOTE_TO_PITCH, { 60, 0, 60, 0 }), 0x1000u);
+    EXPECT_EQ(call(SoundServer::CMD_NOTE_TO_PITCH, { 60, 0, 72, 0 }), 0x2000u);
+    EXPECT_EQ(call(SoundServer::CMD_NOTE_TO_PITCH, { 60, 0, 48, 0 }), 0x0800u);
+}
@@ -0,0 +1,304 @@
+#include "gtest/gtest.h"
+#include "runtime.h"
+#include "memory.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace sif;
+
+namespace {
+
+constexpr u32 PACKET = 0x00100000;          // EE side of the packets and arguments
+constexpr u32 ARGS = 0x00100100;
+constexpr u32 TRANSFERS = 0x00100200;
+constexpr u32 EE_BUFFER = 0x00100400;       // Where the IOP's packets go
+constexpr u32 RECEIVE = 0x00100600;
+constexpr u32 PAD_AREA = 0x00100800;
+
+constexpr u32 CIS_SIF0 = 1u << DMAC_SIF0;
+
+class IopTest : public ::testing::Test {
+protected:
+    IopTest() : previous_space(fastmem_current()), previous_smc(smc_current()) {
+        instance.bind();
+        WriteMemory32(Dmac::D_CTRL, 1);
+    }
+    ~IopTest() override {
+        fastmem_bind(previous_space);
+        smc_bind(previous_smc);
+    }
+
+    s32 syscall(s32 number, u32 a0 = 0, u32 a1 = 0) {
+        GPRregs& gpr = instance.cpuRegs.GPR;
+        gpr.n.v1.SD[0] = number;
+        gpr.n.a0.SD[0] = (s32)a0;
+        gpr.n.a1.SD[0] = (s32)a1;
+        cpu_syscall(instance);
+        return gpr.n.v0.SL[0];
+    }
+
+    void write_bytes(u32 address, const u8* data, u32 size) {
+        for (u32 i = 0; i < size; i++) {
+            WriteMemory8(address + i, data[i]);
+        }
+    }
+
+    // sceSifSetDma() of `packet` into the IOP's command buffer, after `args` if any.
+    s32 send(std::vector<u8> packet, const std::vector<u8>& args = {}, u32 args_dest = 0) {
+        u32 count = 0;
+        if (!args.empty()) {
+            write_bytes(ARGS, args.data(), (u32)args.size());
+            add_transfer(count++, ARGS, args_dest, (u32)args.size());
+        }
+        store32(packet.data(), header::SIZES, (u32)packet.size());
+        write_bytes(PACKET, packet.data(), (u32)packet.size());
+        add_transfer(count++, PACKET, Iop::CMD_BUFFER, (u32)packet.size());
+        return syscall(SYS_SIF_SET_DMA, TRANSFERS, count);
+    }
+
+    void add_transfer(u32 index, u32 src, u32 dest, u32 size) {
+        const u32 transfer = TRANSFERS + index * dma_transfer::STRIDE;
+        WriteMemory32(transfer + dma_transfer::SRC, src);
+        WriteMemory32(transfer + dma_transfer::DEST, dest);
+        WriteMemory32(transfer + dma_transfer::SIZE, size);
+        WriteMemory32(transfer + dma_transfer::ATTR, 0);
+    }
+
+    static std::vector<u8> packet(u32 cid, u32 size) {
+        std::vector<u8> data(size);
+        store32(data.data(), header::CID, cid);
+        return data;
+    }
+
+    // Tells the IOP where its packets go, like sceSifInitCmd().
+    void init_cmd() {
+        std::vector<u8> saddr = packet(CMD_CHANGE_SADDR, 32);
+        store32(saddr.data(), change_saddr::ADDRESS, EE_BUFFER);
+        send(saddr);
+    }
+
+    // Arms SIF0 like the game's interrupt handler and runs EE time until a packet has
+    // arrived (the worker threads may take a while). Returns its command id.
+    u32 receive() {
+        WriteMemory32(EE_BUFFER + header::CID, 0);
+        syscall(SYS_SIF_SET_DCHAIN);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (instance.dmac.channel(DMAC_SIF0).chcr & chcr::STR) {
+            if (std::chrono::steady_clock::now() > deadline) {
+                return 0;
+            }
+            instance.cpuRegs.cycle += Iop::POLL_INTERVAL;
+            instance.scheduler.run_due();
+            std::this_thread::yield();
+        }
+        return ReadMemory32(EE_BUFFER + header::CID);
+    }
+
+    // BIND to `server`; the END's server address, or 0.
+    u32 bind(u32 server) {
+        std::vector<u8> request = packet(CMD_RPC_BIND, 36);
+        store32(request.data(), rpc::BIND_SID, server);
+        send(request);
+        EXPECT_EQ(receive(), CMD_RPC_END);
+        return ReadMemory32(EE_BUFFER + rpc::END_SERVER);
+    }
+
+    // CALL `function` on the server bound at `server` with `args`, waiting for the END.
+    void call(u32 server, u32 function, const std::vector<u32>& args, u32 receive_size) {
+        const u32 buffer = ReadMemory32(EE_BUFFER + rpc::END_BUFF);
+        std::vector<u8> bytes(args.size() * 4);
+        for (size_t i = 0; i < args.size(); i++) {
+            store32(bytes.data(), (u32)i * 4, args[i]);
+        }
+        std::vector<u8> request = packet(CMD_RPC_CALL, 56);
+        store32(request.data(), rpc::REC_ID, 0x1234);
+        store32(request.data(), rpc::CALL_NUMBER, function);
+        store32(request.data(), rpc::CALL_SEND_SIZE, (u32)bytes.size());
+        store32(request.data(), rpc::CALL_RECEIVE, RECEIVE);
+        store32(request.data(), rpc::CALL_RECV_SIZE, receive_size);
+        store32(request.data(), rpc::CALL_SERVER, server);
+        send(request, bytes, buffer);
+        EXPECT_EQ(receive(), CMD_RPC_END);
+    }
+
+    FastmemSpace* previous_space;
+    SmcState* previous_smc;
+    EEInstance instance;
+};
+
+} // namespace
+
+TEST_F(IopTest, BootLeavesTheIopReady) {
+    EXPECT_EQ((u32)syscall(SYS_SIF_GET_REG, REG_SMFLAG) & (STAT_SIFINIT | STAT_CMDINIT), STAT_SIFINIT | STAT_CMDINIT);
+    EXPECT_EQ((u32)syscall(SYS_SIF_GET_REG, SYSREG_SUBADDR), Iop::CMD_BUFFER);
+    EXPECT_EQ(ReadMemory32(SMCOM), Iop::CMD_BUFFER);
+}
+
+TEST_F(IopTest, SifRegistersFollowTheirOwners) {
+    // 1. Arrange / 2. Act: the EE sets MSFLG bits, and clears SMFLG bits by writing them.
+    WriteMemory32(MSFLG, 0x1);
+    syscall(SYS_SIF_SET_REG, REG_MSFLAG, 0x4);
+    WriteMemory32(SMFLG, STAT_BOOTEND);
+    syscall(SYS_SIF_SET_REG, REG_MAINADDR, 0x00123450);
+    syscall(SYS_SIF_SET_REG, 0x80000002, 7);
+
+    // 3. Assert
+    EXPECT_EQ(ReadMemory32(MSFLG), 0x5u);
+    EXPECT_EQ(ReadMemory32(SMFLG) & STAT_BOOTEND, 0u);
+    EXPECT_EQ((u32)syscall(SYS_SIF_GET_REG, REG_MAINADDR), 0x00123450u);
+    EXPECT_EQ((u32)syscall(SYS_SIF_GET_REG, 0x80000002), 7u);
+}
+
+TEST_F(IopTest, InitCmdIsAnsweredOverSif0) {
+    // 1. Arrange
+    init_cmd();
+
+    // 2. Act
+    EXPECT_GT(send(packet(CMD_INIT_CMD, 16)), 0);
+    const u32 cid = receive();
+
+    // 3. Assert: SET_SREG(RPCINIT, 1), and the channel raised its interrupt.
+    EXPECT_EQ(cid, CMD_SET_SREG);
+    EXPECT_EQ(ReadMemory32(EE_BUFFER + set_sreg::INDEX), SREG_RPCINIT);
+    EXPECT_EQ(ReadMemory32(EE_BUFFER + set_sreg::VALUE), 1u);
+    EXPECT_NE(instance.dmac.read32(Dmac::D_STAT) & CIS_SIF0, 0u);
+    EXPECT_EQ(syscall(SYS_SIF_DMA_STAT, 1), -1);
+}
+
+TEST_F(IopTest, PacketsWaitForTheChannel) {
+    // 1. Arrange: two answers queue up before SIF0 is armed, and the EE sets an IOP
+    // software register on the way.
+    init_cmd();
+    std::vector<u8> sreg = packet(CMD_SET_SREG, set_sreg::SIZE);
+    store32(sreg.data(), set_sreg::INDEX, 3);
+    store32(sreg.data(), set_sreg::VALUE, 0x99);
+    send(packet(CMD_INIT_CMD, 16));
+    send(sreg);
+    send(packet(CMD_INIT_CMD, 16));
+
+    // 2. Act / 3. Assert: each SetDChain delivers one packet.
+    EXPECT_EQ(receive(), CMD_SET_SREG);
+    EXPECT_EQ(receive(), CMD_SET_SREG);
+    EXPECT_EQ(instance.iop.sreg(3), 0x99u);
+}
+
+TEST_F(IopTest, BindAndCallRoundTrip) {
+    // 1. Arrange
+    init_cmd();
+    const u32 server = bind(Iop::HEAP_SERVER);
+    ASSERT_NE(server, 0u);
+
+    // 2. Act: sceSifAllocIopHeap(0x100), twice.
+    call(server, Iop::HEAP_ALLOC, { 0x100 }, 4);
+    const u32 first = ReadMemory32(RECEIVE);
+    call(server, Iop::HEAP_ALLOC, { 0x100 }, 4);
+    const u32 second = ReadMemory32(RECEIVE);
+
+    // 3. Assert: the END echoes the call, and the result reached the receive buffer.
+    EXPECT_EQ(ReadMemory32(EE_BUFFER + rpc::REC_ID), 0x1234u);
+    EXPECT_EQ(ReadMemory32(EE_BUFFER + rpc::END_CID), CMD_RPC_CALL);
+    EXPECT_EQ(ReadMemory32(EE_BUFFER + rpc::END_SERVER), server);
+    EXPECT_GE(first, Iop::HEAP_START);
+    EXPECT_GE(second, first + 0x100);
+    EXPECT_EQ(instance.iop.calls_in_flight(), 0u);
+}
+
+TEST_F(IopTest, UnknownServerBindsToZero) {
+    init_cmd();
+    EXPECT_EQ(bind(0x80001234), 0u);
+}
+
+TEST_F(IopTest, OtherDataCopiesIopRam) {
+    // 1. Arrange
+    init_cmd();
+    std::memcpy(instance.iop.ram() + 0x20000, "sif0", 4);
+    std::vector<u8> request = packet(CMD_RPC_RDATA, 44);
+    store32(request.data(), rpc::RDATA_SRC, 0x20000);
+    store32(request.data(), rpc::RDATA_DEST, RECEIVE);
+    store32(request.data(), rpc::RDATA_SIZE, 4);
+
+    // 2. Act
+    send(request);
+
+    // 3. Assert
+    EXPECT_EQ(receive(), CMD_RPC_END);
+    EXPECT_EQ(ReadMemory32(RECEIVE), 0x30666973u);
+}
+
+TEST_F(IopTest, OpenPadIsWrittenAtVblank) {
+    // 1. Arrange: padPortOpen(0, 0, area) through the pad control server.
+    init_cmd();
+    const u32 server = bind(PadServer::SERVER_CONTROL);
+    call(server, 0, { PadServer::CMD_OPEN, 0, 0, 0, PAD_AREA }, 16);
+    instance.iop.pad.set_buttons(0, pad_button::CROSS);
+
+    // 2. Act
+    instance.cpuRegs.cycle += Timers::VISIBLE_SCANLINES * Timers::CYCLES_PER_SCANLINE;
+    cpu_event_test(instance);
+
+    // 3. Assert: buttons are reported inverted.
+    EXPECT_EQ(ReadMemory32(PAD_AREA + pad_area::FRAME), 1u);
+    EXPECT_EQ(ReadMemory8(PAD_AREA + pad_area::DATA + 3), (u8)~(pad_button::CROSS >> 8));
+    EXPECT_EQ(ReadMemory8(PAD_AREA + pad_area::OK), 1u);
+}
+
+TEST_F(IopTest, SimulatedDiscReadsArriveAfterTheDrive) {
+    // 1. Arrange: an image with only a volume descriptor, read like the real drive.
+    std::vector<u8> image(17 * DiscImage::SECTOR_SIZE);
+    image[16 * DiscImage::SECTOR_SIZE] = 1;
+    std::memcpy(&image[16 * DiscImage::SECTOR_SIZE + 1], "CD001", 5);
+    char path[] = "/tmp/iop_testXXXXXX";
+    const int fd = mkstemp(path);
+    ASSERT_EQ(write(fd, image.data(), image.size()), (ssize_t)image.size());
+    close(fd);
+    ASSERT_TRUE(instance.iop.cdvd.insert(path));
+    instance.iop.cdvd.set_latency(CdvdLatency::Simulated);
+    init_cmd();
+    const u32 server = bind(CdvdServer::SERVER_NCMD);
+
+    // 2. Act
+    const u32 issued = instance.cpuRegs.cycle;
+    call(server, CdvdServer::NCMD_READ, { 16, 1, 0x00200000, 0 }, 4);
+    const u32 elapsed = instance.cpuRegs.cycle - issued;
+    std::remove(path);
+
+    // 3. Assert: the END waited out the seek and the sector.
+    EXPECT_EQ(ReadMemory32(RECEIVE), 1u);
+    EXPECT_GE(elapsed, CdvdServer::SEEK_CYCLES + CdvdServer::SECTOR_CYCLES);
+    EXPECT_EQ(instance.iop.calls_in_flight(), 0u);
+}
+
+TEST_F(IopTest, FileioReadsLandInEeRam) {
+    // 1. Arrange: a host directory as cdrom0:, and sceOpen()'s _fio_open_arg.
+    char root[] = "/tmp/iop_testXXXXXX";
+    ASSERT_NE(mkdtemp(root), nullptr);
+    const std::string file = std::string(root) + "/SYSTEM.CNF";
+    FILE* out = std::fopen(file.c_str(), "wb");
+    std::fputs("BOOT2 = cdrom0:\\SLUS_000.00;1\n", out);
+    std::fclose(out);
+    ASSERT_TRUE(instance.iop.fileio.mount(root));
+    const char path[] = "cdrom0:\\SYSTEM.CNF;1";
+    std::vector<u32> open_arg(1 + FileioServer::PATH_SIZE / 4, 0);
+    open_arg[0] = FileioServer::OPEN_READ;
+    std::memcpy(&open_arg[1], path, sizeof(path));
+    init_cmd();
+    const u32 server = bind(FileioServer::SERVER_ID);
+
+    // 2. Act: open and read the first 8 bytes.
+    call(server, FileioServer::FUNC_OPEN, open_arg, 4);
+    const u32 fd = ReadMemory32(RECEIVE);
+    call(server, FileioServer::FUNC_READ, { fd, 0x00200000, 8, 0 }, 4);
+    instance.iop.fileio.unmount();
+    std::remove(file.c_str());
+    rmdir(root);
+
+    // 3. Assert
+    EXPECT_EQ(fd, 0u);
+    EXPECT_EQ(ReadMemory32(RECEIVE), 8u);
+    EXPECT_EQ(ReadMemory32(0x00200000), load32((const u8*)"BOOT", 0));
+    EXPECT_EQ(ReadMemory32(0x00200004), load32((const u8*)"2 = ", 0));
+}
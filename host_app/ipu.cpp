@@ -0,0 +1,733 @@
+#include "ipu.h"
+#include "scheduler.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr size_t DECODER_STACK_SIZE = 256 * 1024;
+
+// VDEC tables, by option TBL.
+constexpr u32 VDEC_ADDRESS_INCREMENT = 0;
+constexpr u32 VDEC_MB_TYPE = 1;
+constexpr u32 VDEC_MOTION_CODE = 2;
+
+// IPU_CTRL.PCT.
+constexpr u32 PICTURE_P = 2;
+constexpr u32 PICTURE_B = 3;
+constexpr u32 PICTURE_D = 4;
+
+// A start code: 23 zeros then a one, byte aligned.
+constexpr u32 START_CODE_ZEROS = 23;
+
+// Places an 8x8 block into a macroblock plane, clamped to what the output format holds.
+template <typename T>
+void place(const s16 block[64], T* dest, u32 stride, s32 low, s32 high) {
+    for (u32 y = 0; y < 8; y++) {
+        for (u32 x = 0; x < 8; x++) {
+            dest[y * stride + x] = (T)std::min(high, std::max(low, (s32)block[y * 8 + x]));
+        }
+    }
+}
+
+// Where luma block `index` (0-3) starts, for frame or field (interlaced rows) DCT.
+u32 luma_offset(u32 index, bool field) {
+    return (field ? (index >> 1) * 16 : (index >> 1) * 128) + (index & 1) * 8;
+}
+
+u32 latch_word(const u8 latch[16], u32 offset) {
+    u32 value;
+    std::memcpy(&value, latch + offset, 4);
+    return value;
+}
+
+} // namespace
+
+Ipu::Ipu(Dmac& dmac, Scheduler& scheduler)
+    : dmac(dmac), scheduler(scheduler), event(-1), irq_hook(nullptr), irq_user(nullptr),
+      idct(idct_select()), convert(csc_select()), decoder(&decoder_main, this, DECODER_STACK_SIZE),
+      running(false), in_decoder(false), waiting(Wait::None) {
+    event = scheduler.register_event("ipu", &on_event, this);
+    dmac.set_consumer(DMAC_IPU_TO, &on_ipu_to, this);
+    dmac.set_consumer(DMAC_IPU_FROM, &on_ipu_from, this);
+    reset();
+}
+
+void Ipu::reset() {
+    decoder.reset();
+    scheduler.cancel(event);
+    running = false;
+    waiting = Wait::None;
+    command = 0;
+    command_sent = false;
+    ctrl = 0;
+    cmd_data = 0;
+    std::memset(input, 0, sizeof(input));
+    input_qwc = 0;
+    bit = 0;
+    std::memset(input_latch, 0, sizeof(input_latch));
+    output_head = 0;
+    output_qwc = 0;
+    std::memset(output_latch, 0, sizeof(output_latch));
+    for (u32 i = 0; i < 64; i++) {
+        intra_matrix[i] = mpeg::DEFAULT_INTRA_MATRIX[i];
+        non_intra_matrix[i] = 16;
+    }
+    std::memset(clut, 0, sizeof(clut));
+    transparent = 0;
+    translucent = 0;
+    quantiser_scale = 0;
+    reset_dc_predictors();
+}
+
+void Ipu::set_irq_hook(IpuIrqHook hook, void* user) {
+    irq_hook = hook;
+    irq_user = user;
+}
+
+u32 Ipu::read32(u32 address) {
+    switch (address) {
+        case IPU_CMD:
+            // Before the first command, the head of whatever was sent in.
+            if (!command_sent && available_bits() >= 32) {
+                return peek(32);
+            }
+            return cmd_data;
+        case IPU_CMD + 4:
+            return running ? 0x80000000 : 0;
+        case IPU_CTRL: {
+            const u32 fp = std::min(input_qwc, 2u);
+            return ctrl | (input_qwc - fp) | output_qwc << 4 | (running ? CTRL_BUSY : 0);
+        }
+        case IPU_BP: {
+            const u32 fp = std::min(input_qwc, 2u);
+            return bit | (input_qwc - fp) << 8 | fp << 16;
+        }
+        case IPU_TOP:
+        case IPU_TOP + 4: {
+            if (available_bits() < 32 && !in_decoder) {
+                dmac.resume(DMAC_IPU_TO);
+            }
+            const u32 available = std::min(available_bits(), 32u);
+            if (address == IPU_TOP + 4) {
+                return running || available < 32 ? 0x80000000 : 0;
+            }
+            return available ? peek(available) << (32 - available) : 0;
+        }
+        case OUT_FIFO:
+            if (output_qwc) {
+                std::memcpy(output_latch, output_fifo[output_head], 16);
+                output_head = (output_head + 1) % FIFO_QWC;
+                output_qwc--;
+                if (waiting == Wait::Output) {
+                    pump();
+                }
+            } else {
+                std::memset(output_latch, 0, sizeof(output_latch));
+            }
+            return latch_word(output_latch, 0);
+        case OUT_FIFO + 4:
+        case OUT_FIFO + 8:
+        case OUT_FIFO + 12:
+            return latch_word(output_latch, address - OUT_FIFO);
+    }
+    return 0;
+}
+
+void Ipu::write32(u32 address, u32 value) {
+    switch (address) {
+        case IPU_CMD:
+            start(value);
+            break;
+        case IPU_CTRL:
+            if (value & CTRL_RST) {
+                const bool interrupted = running;
+                reset();
+                if (interrupted && irq_hook) {
+                    irq_hook(irq_user);
+                }
+            }
+            ctrl = (ctrl & ~CTRL_WRITABLE) | (value & CTRL_WRITABLE);
+            break;
+        case IN_FIFO:
+        case IN_FIFO + 4:
+        case IN_FIFO + 8:
+            std::memcpy(input_latch + (address - IN_FIFO), &value, 4);
+            break;
+        case IN_FIFO + 12:
+            std::memcpy(input_latch + 12, &value, 4);
+            if (input_qwc < INPUT_QWC) {
+                push_input(input_latch, 1);
+                if (waiting == Wait::Input) {
+                    pump();
+                }
+            }
+            break;
+    }
+}
+
+void Ipu::start(u32 value) {
+    if (running) {
+        return;
+    }
+    command = value;
+    command_sent = true;
+    ctrl &= ~(CTRL_ECD | CTRL_SCD);
+    running = true;
+    pump();
+}
+
+// Runs the command until it finishes or has to wait.
+void Ipu::pump() {
+    if (!running || in_decoder) {
+        return;
+    }
+    in_decoder = true;
+    caller.switch_to(decoder);
+    in_decoder = false;
+    if (!running && irq_hook) {
+        irq_hook(irq_user);
+    }
+}
+
+// Called from inside a DMA transfer, where the decoder must not start another one.
+void Ipu::wake() {
+    if (waiting != Wait::None && !in_decoder) {
+        scheduler.schedule(event, 0);
+    }
+}
+
+void Ipu::on_event(void* user, s32) {
+    static_cast<Ipu*>(user)->pump();
+}
+
+void Ipu::decoder_main(void* user) {
+    Ipu& ipu = *static_cast<Ipu*>(user);
+    while (true) {
+        ipu.execute(ipu.command);
+        ipu.running = false;
+        ipu.decoder.switch_to(ipu.caller);
+    }
+}
+
+u32 Ipu::on_ipu_to(void* user, u32, const DmaSpan& span) {
+    Ipu& ipu = *static_cast<Ipu*>(user);
+    const u32 taken = std::min(span.qwc, INPUT_QWC - ipu.input_qwc);
+    ipu.push_input(span.data, taken);
+    if (taken && ipu.waiting == Wait::Input) {
+        ipu.wake();
+    }
+    return taken;
+}
+
+u32 Ipu::on_ipu_from(void* user, u32, const DmaSpan& span) {
+    Ipu& ipu = *static_cast<Ipu*>(user);
+    const u32 given = std::min(span.qwc, ipu.output_qwc);
+    for (u32 i = 0; i < given; i++) {
+        std::memcpy(span.data + i * 16, ipu.output_fifo[ipu.output_head], 16);
+        ipu.output_head = (ipu.output_head + 1) % FIFO_QWC;
+    }
+    ipu.output_qwc -= given;
+    if (given && ipu.waiting == Wait::Output) {
+        ipu.wake();
+    }
+    return given;
+}
+
+void Ipu::push_input(const u8* data, u32 qwc) {
+    std::memcpy(input + input_qwc * 16, data, qwc * 16);
+    input_qwc += qwc;
+}
+
+// --- Bitstream ---
+
+u32 Ipu::available_bits() const {
+    const u32 total = input_qwc * 128;
+    return total > bit ? total - bit : 0;
+}
+
+// The next `count` (1-32) bits, first in the top bit. They must be there.
+u32 Ipu::peek(u32 count) const {
+    u64 word;
+    std::memcpy(&word, input + (bit >> 3), 8);
+    return (u32)((__builtin_bswap64(word) << (bit & 7)) >> (64 - count));
+}
+
+void Ipu::skip(u32 count) {
+    bit += count;
+    const u32 done = std::min(bit >> 7, input_qwc);
+    if (done) {
+        std::memmove(input, input + done * 16, (input_qwc - done) * 16);
+        input_qwc -= done;
+        bit -= done * 128;
+    }
+}
+
+// Waits until `count` bits are in, pulling on the DMA channel first.
+void Ipu::need(u32 count) {
+    while (available_bits() < count) {
+        if (input_qwc < INPUT_QWC) {
+            dmac.resume(DMAC_IPU_TO);
+            if (available_bits() >= count) {
+                break;
+            }
+        }
+        waiting = Wait::Input;
+        decoder.switch_to(caller);
+        waiting = Wait::None;
+    }
+}
+
+// Like need(), but gives up rather than wait on the game.
+bool Ipu::try_need(u32 count) {
+    if (available_bits() < count && input_qwc < INPUT_QWC) {
+        dmac.resume(DMAC_IPU_TO);
+    }
+    return available_bits() >= count;
+}
+
+u32 Ipu::get(u32 count) {
+    need(count);
+    const u32 value = peek(count);
+    skip(count);
+    return value;
+}
+
+void Ipu::read_bytes(u8* out, u32 size) {
+    while (size) {
+        need(8);
+        if (bit & 7) {
+            *out++ = (u8)get(8);
+            size--;
+            continue;
+        }
+        const u32 count = std::min(size, available_bits() / 8);
+        std::memcpy(out, input + bit / 8, count);
+        skip(count * 8);
+        out += count;
+        size -= count;
+    }
+}
+
+bool Ipu::at_start_code() {
+    need(START_CODE_ZEROS);
+    return peek(START_CODE_ZEROS) == 0;
+}
+
+// Queues `qwc` quadwords for the output FIFO, waiting for room as it fills up.
+void Ipu::output(const void* data, u32 qwc) {
+    const u8* bytes = static_cast<const u8*>(data);
+    while (qwc) {
+        if (output_qwc == FIFO_QWC) {
+            dmac.resume(DMAC_IPU_FROM);
+            if (output_qwc == FIFO_QWC) {
+                waiting = Wait::Output;
+                decoder.switch_to(caller);
+                waiting = Wait::None;
+                continue;
+            }
+        }
+        std::memcpy(output_fifo[(output_head + output_qwc) % FIFO_QWC], bytes, 16);
+        output_qwc++;
+        bytes += 16;
+        qwc--;
+    }
+    dmac.resume(DMAC_IPU_FROM);
+}
+
+// --- Commands ---
+
+void Ipu::execute(u32 value) {
+    const u32 option = value & 0x0FFFFFFF;
+    switch (value >> 28) {
+        case CMD_BCLR:
+            bclr(option);
+            break;
+        case CMD_IDEC:
+            idec(option);
+            break;
+        case CMD_BDEC:
+            bdec(option);
+            break;
+        case CMD_VDEC:
+            vdec(option);
+            break;
+        case CMD_FDEC:
+            need(option & OPT_FB_MASK);
+            skip(option & OPT_FB_MASK);
+            need(32);
+            cmd_data = peek(32);
+            break;
+        case CMD_SETIQ:
+            setiq(option);
+            break;
+        case CMD_SETVQ:
+            setvq();
+            break;
+        case CMD_CSC:
+            csc(option);
+            break;
+        case CMD_PACK:
+            pack(option);
+            break;
+        case CMD_SETTH:
+            transparent = option & 0x1FF;
+            translucent = (option >> 16) & 0x1FF;
+            break;
+    }
+}
+
+void Ipu::bclr(u32 option) {
+    input_qwc = 0;
+    bit = option & 0x7F;
+}
+
+// Decodes an I-picture slice from its first macroblock_type to the next start code,
+// all the way to pixels.
+void Ipu::idec(u32 option) {
+    need(option & OPT_FB_MASK);
+    skip(option & OPT_FB_MASK);
+    set_quantiser((option >> OPT_QSC_SHIFT) & 0x1F);
+    reset_dc_predictors();
+
+    while (true) {
+        need(VlcTable::MAX_BITS);
+        const VlcEntry& type = mpeg::MB_TYPE_I.lookup(peek(VlcTable::MAX_BITS));
+        if (!type.length) {
+            error();
+            return;
+        }
+        skip(type.length);
+        const bool field = (option & OPT_DTD) && get(1);
+        if (type.value & mpeg::MB_QUANT) {
+            set_quantiser(get(5));
+        }
+
+        Raw8Macroblock mb;
+        alignas(16) s16 coefficients[64];
+        alignas(16) s16 pixels[64];
+        for (u32 i = 0; i < 6; i++) {
+            const u32 component = i < 4 ? 0 : i - 3;
+            if (!decode_intra_block(component, coefficients)) {
+                error();
+                return;
+            }
+            idct(coefficients, pixels);
+            if (i < 4) {
+                place(pixels, mb.y + luma_offset(i, field), field ? 32 : 16, 0, 255);
+            } else {
+                place(pixels, i == 4 ? mb.cb : mb.cr, 8, 0, 255);
+            }
+        }
+        emit_rgb(mb, option, (option & OPT_SGN) != 0);
+
+        if (!next_macroblock()) {
+            return;
+        }
+    }
+}
+
+// Decodes one macroblock to RAW16: intra to pixels, non-intra to the residual the
+// game adds to its prediction.
+void Ipu::bdec(u32 option) {
+    need(option & OPT_FB_MASK);
+    skip(option & OPT_FB_MASK);
+    set_quantiser((option >> OPT_QSC_SHIFT) & 0x1F);
+    if (option & OPT_DCR) {
+        reset_dc_predictors();
+    }
+    const bool intra = (option & OPT_MBI) != 0;
+    const bool field = (option & OPT_DT) != 0;
+
+    u32 pattern = 0x3F;
+    if (!intra) {
+        need(VlcTable::MAX_BITS);
+        const VlcEntry& code = mpeg::CODED_BLOCK_PATTERN.lookup(peek(VlcTable::MAX_BITS));
+        if (!code.length) {
+            error();
+            return;
+        }
+        skip(code.length);
+        pattern = (u32)code.value;
+    }
+
+    alignas(16) s16 mb[384] = {};
+    alignas(16) s16 coefficients[64];
+    alignas(16) s16 pixels[64];
+    const s32 low = intra ? 0 : -256;
+    const s32 high = 255;
+    for (u32 i = 0; i < 6; i++) {
+        if (!(pattern & (0x20u >> i))) {
+            continue;
+        }
+        const bool ok = intra ? decode_intra_block(i < 4 ? 0 : i - 3, coefficients) : decode_non_intra_block(coefficients);
+        if (!ok) {
+            error();
+            return;
+        }
+        idct(coefficients, pixels);
+        if (i < 4) {
+            place(pixels, mb + luma_offset(i, field), field ? 32 : 16, low, high);
+        } else {
+            place(pixels, mb + (i == 4 ? 256 : 320), 8, low, high);
+        }
+    }
+    ctrl = (ctrl & ~(0x3Fu << 8)) | pattern << 8;
+    output(mb, RAW16_QWC);
+    if (try_need(START_CODE_ZEROS) && peek(START_CODE_ZEROS) == 0) {
+        ctrl |= CTRL_SCD;
+    }
+}
+
+// One code from a macroblock-level table. The result is the value in the low half and
+// the length of the code in the high half.
+void Ipu::vdec(u32 option) {
+    need(option & OPT_FB_MASK);
+    skip(option & OPT_FB_MASK);
+    need(VlcTable::MAX_BITS);
+
+    const VlcTable* table;
+    switch ((option >> OPT_TBL_SHIFT) & 3) {
+        case VDEC_ADDRESS_INCREMENT:
+            table = &mpeg::ADDRESS_INCREMENT;
+            break;
+        case VDEC_MB_TYPE:
+            switch ((ctrl >> CTRL_PCT_SHIFT) & 7) {
+                case PICTURE_P: table = &mpeg::MB_TYPE_P; break;
+                case PICTURE_B: table = &mpeg::MB_TYPE_B; break;
+                case PICTURE_D: table = &mpeg::MB_TYPE_D; break;
+                default: table = &mpeg::MB_TYPE_I; break;
+            }
+            break;
+        case VDEC_MOTION_CODE:
+            table = &mpeg::MOTION_CODE;
+            break;
+        default:
+            table = &mpeg::DMVECTOR;
+            break;
+    }
+
+    const VlcEntry& code = table->lookup(peek(VlcTable::MAX_BITS));
+    const bool stuffing = table == &mpeg::ADDRESS_INCREMENT && code.value == mpeg::MBA_STUFFING;
+    if (!code.length || (stuffing && !(ctrl & CTRL_MP1))) {
+        cmd_data = 0;
+        error();
+        return;
+    }
+    skip(code.length);
+    s32 value = code.value;
+    u32 length = code.length;
+    if (table == &mpeg::MOTION_CODE && value) {
+        value = get(1) ? -value : value;
+        length++;
+    }
+    cmd_data = length << 16 | (u16)value;
+}
+
+// A quantiser matrix as the sequence header carries it, in zigzag order.
+void Ipu::setiq(u32 option) {
+    need(option & OPT_FB_MASK);
+    skip(option & OPT_FB_MASK);
+    u8 values[64];
+    read_bytes(values, 64);
+    u8* matrix = option & OPT_IQM ? non_intra_matrix : intra_matrix;
+    for (u32 i = 0; i < 64; i++) {
+        matrix[mpeg::ZIGZAG_SCAN[i]] = values[i];
+    }
+}
+
+void Ipu::setvq() {
+    u8 values[32];
+    read_bytes(values, 32);
+    for (u32 i = 0; i < 16; i++) {
+        clut[i] = (u16)(values[i * 2] | values[i * 2 + 1] << 8);
+    }
+}
+
+void Ipu::csc(u32 option) {
+    for (u32 i = 0; i < (option & OPT_MBC_MASK); i++) {
+        Raw8Macroblock mb;
+        read_bytes(reinterpret_cast<u8*>(&mb), sizeof(mb));
+        emit_rgb(mb, option, false);
+    }
+}
+
+void Ipu::pack(u32 option) {
+    for (u32 i = 0; i < (option & OPT_MBC_MASK); i++) {
+        alignas(16) u32 rgb32[256];
+        alignas(16) u16 rgb16[256];
+        read_bytes(reinterpret_cast<u8*>(rgb32), sizeof(rgb32));
+        csc_rgb16(rgb32, rgb16, (option & OPT_DTE) != 0);
+        if (option & OPT_OFM) {
+            output(rgb16, RGB16_QWC);
+        } else {
+            alignas(16) u8 indices[128];
+            csc_indx4(rgb16, clut, indices);
+            output(indices, INDX4_QWC);
+        }
+    }
+}
+
+void Ipu::emit_rgb(const Raw8Macroblock& mb, u32 option, bool sign) {
+    alignas(16) u32 rgb32[256];
+    convert(mb, rgb32);
+    csc_alpha(rgb32, transparent, translucent);
+    if (sign) {
+        for (u32& pixel : rgb32) {
+            pixel ^= 0x808080;
+        }
+    }
+    if (option & OPT_OFM) {
+        alignas(16) u16 rgb16[256];
+        csc_rgb16(rgb32, rgb16, (option & OPT_DTE) != 0);
+        output(rgb16, RGB16_QWC);
+    } else {
+        output(rgb32, RGB32_QWC);
+    }
+}
+
+// --- Macroblocks ---
+
+void Ipu::set_quantiser(u32 code) {
+    quantiser_scale = ctrl & CTRL_QST ? mpeg::NON_LINEAR_QUANTISER_SCALE[code] : code * 2;
+}
+
+void Ipu::reset_dc_predictors() {
+    const s32 reset = 128 << ((ctrl >> CTRL_IDP_SHIFT) & 3);
+    dc_predictor[0] = dc_predictor[1] = dc_predictor[2] = reset;
+}
+
+// Intra block: a differential DC coefficient against the component's predictor, then
+// the AC coefficients. `component` is 0 for Y, 1 for Cb, 2 for Cr.
+bool Ipu::decode_intra_block(u32 component, s16 block[64]) {
+    std::memset(block, 0, 64 * sizeof(s16));
+    need(VlcTable::MAX_BITS);
+    const VlcTable& sizes = component ? mpeg::DC_SIZE_CHROMA : mpeg::DC_SIZE_LUMA;
+    const VlcEntry& size = sizes.lookup(peek(VlcTable::MAX_BITS));
+    if (!size.length) {
+        return false;
+    }
+    skip(size.length);
+    if (size.value) {
+        const s32 bits = (s32)get((u32)size.value);
+        dc_predictor[component] += bits & (1 << (size.value - 1)) ? bits : bits - (1 << size.value) + 1;
+    }
+    const u32 precision = (ctrl >> CTRL_IDP_SHIFT) & 3;
+    block[0] = (s16)(dc_predictor[component] << (3 - std::min(precision, 3u)));
+    return decode_coefficients(true, block, block[0]);
+}
+
+bool Ipu::decode_non_intra_block(s16 block[64]) {
+    std::memset(block, 0, 64 * sizeof(s16));
+    return decode_coefficients(false, block, 0);
+}
+
+// Run/level pairs up to the end of block, inverse quantised into raster order (7.4),
+// with MPEG-2 mismatch control or MPEG-1 oddification.
+bool Ipu::decode_coefficients(bool intra, s16 block[64], s32 sum) {
+    const VlcTable& table = intra && (ctrl & CTRL_IVF) ? mpeg::DCT_COEFFICIENTS_1 : mpeg::DCT_COEFFICIENTS_0;
+    const u8* matrix = intra ? intra_matrix : non_intra_matrix;
+    const u8* scan = ctrl & CTRL_AS ? mpeg::ALTERNATE_SCAN : mpeg::ZIGZAG_SCAN;
+    const bool mpeg1 = (ctrl & CTRL_MP1) != 0;
+    const s32 scale = (s32)quantiser_scale;
+    u32 index = intra ? 1 : 0;
+    while (true) {
+        need(VlcTable::MAX_BITS);
+        const u32 bits = peek(VlcTable::MAX_BITS);
+        s32 run;
+        s32 level;
+        if (index == 0 && (bits >> (VlcTable::MAX_BITS - 1))) {
+            // A non-intra block's first coefficient: "1s" is run 0, level 1.
+            skip(1);
+            run = 0;
+            level = get(1) ? -1 : 1;
+        } else {
+            const VlcEntry& code = table.lookup(bits);
+            if (!code.length) {
+                return false;
+            }
+            skip(code.length);
+            if (code.value == mpeg::DCT_END_OF_BLOCK) {
+                break;
+            }
+            if (code.value == mpeg::DCT_ESCAPE) {
+                if (!read_escape(run, level)) {
+                    return false;
+                }
+            } else {
+                run = code.value;
+                level = get(1) ? -code.level : code.level;
+            }
+        }
+
+        index += (u32)run;
+        if (index > 63) {
+            return false;
+        }
+        const u32 position = scan[index++];
+        s32 value = intra ? level * scale * matrix[position] / 16
+                          : (2 * level + (level > 0 ? 1 : -1)) * scale * matrix[position] / 32;
+        if (mpeg1 && value && !(value & 1)) {
+            value -= value > 0 ? 1 : -1;
+        }
+        value = std::min(2047, std::max(-2048, value));
+        block[position] = (s16)value;
+        sum += value;
+    }
+    if (!mpeg1 && !(sum & 1)) {
+        block[63] ^= 1;
+    }
+    return true;
+}
+
+// The fixed-length run and level after an escape code.
+bool Ipu::read_escape(s32& run, s32& level) {
+    run = (s32)get(6);
+    if (ctrl & CTRL_MP1) {
+        level = (s8)get(8);
+        if (level == 0) {
+            level = (s32)get(8);
+        } else if (level == -128) {
+            level = (s32)get(8) - 256;
+        }
+        return level != 0;
+    }
+    level = (s32)(get(12) << 20) >> 20;
+    return level != 0 && level != -2048;
+}
+
+// Steps to the next macroblock of an IDEC slice. False at the start code that ends the
+// slice (IPU_CTRL.SCD, left byte aligned in front of it) or on a bad increment.
+bool Ipu::next_macroblock() {
+    u32 increment = 0;
+    while (true) {
+        if (at_start_code()) {
+            skip((8 - (bit & 7)) & 7);
+            ctrl |= CTRL_SCD;
+            return false;
+        }
+        need(VlcTable::MAX_BITS);
+        const VlcEntry& code = mpeg::ADDRESS_INCREMENT.lookup(peek(VlcTable::MAX_BITS));
+        if (!code.length) {
+            error();
+            return false;
+        }
+        skip(code.length);
+        if (code.value == mpeg::MBA_ESCAPE) {
+            increment += 33;
+        } else if (code.value != mpeg::MBA_STUFFING) {
+            increment += (u32)code.value;
+            break;
+        }
+    }
+    // An I-picture codes every macroblock.
+    if (increment != 1) {
+        error();
+        return false;
+    }
+    return true;
+}
+
+void Ipu::error() {
+    ctrl |= CTRL_ECD;
+}
@@ -0,0 +1,211 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "csc.h"
+#include "dmac.h"
+#include "fiber.h"
+#include "idct.h"
+#include "mpeg_tables.h"
+
+class Scheduler;
+
+// The IPU, the EE's MPEG-1/2 decoder (see "Image Processing Unit" in docs/ps2_docs.txt).
+//
+// The game's MPEG library drives it a command at a time: VDEC/FDEC pull headers and
+// motion vectors out of the bitstream, IDEC decodes an I-picture slice all the way to
+// RGB, BDEC decodes one macroblock's residual for the library to add to its own motion
+// compensated prediction, CSC/PACK convert pixels. The bitstream comes in through an
+// 8-quadword FIFO fed by DMA channel 4 (toIPU) and results leave through another, drained
+// by channel 3 (fromIPU); either can also be read or written directly at 0x10007000.
+//
+// A command runs on a fiber of its own, so the decoder is written as plain sequential
+// code that waits where the hardware would stall: for bits when the input FIFO runs dry,
+// for room when the output FIFO is full. Waiting first pulls the DMA channel along (it
+// is stalled on a full FIFO, see Dmac::resume()); only if the channel has nothing to give
+// does the fiber switch back, and whatever brings data or room later (a channel being
+// started, a FIFO access) switches to it again from a scheduler event or the access
+// itself. Nothing runs on another thread, so decoding is deterministic.
+//
+// Finishing a command raises the IPU interrupt through the IRQ hook.
+
+using IpuIrqHook = void (*)(void* user);
+
+class Ipu {
+public:
+    static constexpr u32 IO_START = 0x10002000;
+    static constexpr u32 IO_END = 0x10002040;       // exclusive
+    static constexpr u32 IPU_CMD = 0x10002000;
+    static constexpr u32 IPU_CTRL = 0x10002010;
+    static constexpr u32 IPU_BP = 0x10002020;
+    static constexpr u32 IPU_TOP = 0x10002030;
+
+    static constexpr u32 FIFO_START = 0x10007000;
+    static constexpr u32 FIFO_END = 0x10007020;     // exclusive
+    static constexpr u32 OUT_FIFO = 0x10007000;
+    static constexpr u32 IN_FIFO = 0x10007010;
+    static constexpr u32 FIFO_QWC = 8;
+    // The input side also holds the (up to) two quadwords being decoded, IPU_BP.FP.
+    static constexpr u32 INPUT_QWC = FIFO_QWC + 2;
+
+    // IPU_CMD code, bits 28-31.
+    static constexpr u32 CMD_BCLR = 0;
+    static constexpr u32 CMD_IDEC = 1;
+    static constexpr u32 CMD_BDEC = 2;
+    static constexpr u32 CMD_VDEC = 3;
+    static constexpr u32 CMD_FDEC = 4;
+    static constexpr u32 CMD_SETIQ = 5;
+    static constexpr u32 CMD_SETVQ = 6;
+    static constexpr u32 CMD_CSC = 7;
+    static constexpr u32 CMD_PACK = 8;
+    static constexpr u32 CMD_SETTH = 9;
+
+    // Command options.
+    static constexpr u32 OPT_FB_MASK = 0x3F;
+    static constexpr u32 OPT_QSC_SHIFT = 16;
+    static constexpr u32 OPT_DTD = 1u << 24;        // IDEC
+    static constexpr u32 OPT_SGN = 1u << 25;        // IDEC
+    static constexpr u32 OPT_DT = 1u << 25;         // BDEC
+    static constexpr u32 OPT_DCR = 1u << 26;        // BDEC
+    static constexpr u32 OPT_DTE = 1u << 26;        // IDEC, CSC, PACK
+    static constexpr u32 OPT_MBI = 1u << 27;        // BDEC
+    static constexpr u32 OPT_OFM = 1u << 27;        // IDEC, CSC, PACK
+    static constexpr u32 OPT_IQM = 1u << 27;        // SETIQ
+    static constexpr u32 OPT_TBL_SHIFT = 26;        // VDEC
+    static constexpr u32 OPT_MBC_MASK = 0x7FF;      // CSC, PACK
+
+    // IPU_CTRL.
+    static constexpr u32 CTRL_ECD = 1u << 14;
+    static constexpr u32 CTRL_SCD = 1u << 15;
+    static constexpr u32 CTRL_IDP_SHIFT = 16;
+    static constexpr u32 CTRL_AS = 1u << 20;
+    static constexpr u32 CTRL_IVF = 1u << 21;
+    static constexpr u32 CTRL_QST = 1u << 22;
+    static constexpr u32 CTRL_MP1 = 1u << 23;
+    static constexpr u32 CTRL_PCT_SHIFT = 24;
+    static constexpr u32 CTRL_RST = 1u << 30;
+    static constexpr u32 CTRL_BUSY = 1u << 31;
+    static constexpr u32 CTRL_WRITABLE = 0x07F30000;   // IDP, AS, IVF, QST, MP1, PCT
+
+    // Output of one macroblock, in quadwords.
+    static constexpr u32 RAW16_QWC = 48;
+    static constexpr u32 RAW8_QWC = 24;
+    static constexpr u32 RGB32_QWC = 64;
+    static constexpr u32 RGB16_QWC = 32;
+    static constexpr u32 INDX4_QWC = 8;
+
+    Ipu(Dmac& dmac, Scheduler& scheduler);
+
+    Ipu(const Ipu&) = delete;
+    Ipu& operator=(const Ipu&) = delete;
+
+    // IPU_CTRL.RST: drops the command in progress and both FIFOs.
+    void reset();
+
+    /**
+     * @brief Reads an IPU register or pops the output FIFO.
+     * @param address Physical address, IO_START to IO_END or FIFO_START to FIFO_END. A
+     * quadword pop is a read of OUT_FIFO followed by the other three words.
+     */
+    u32 read32(u32 address);
+
+    /**
+     * @brief Writes IPU_CMD (starting a command) or IPU_CTRL, or fills the input FIFO: a
+     * quadword is pushed when its last word is written.
+     */
+    void write32(u32 address, u32 value);
+
+    void set_irq_hook(IpuIrqHook hook, void* user);
+
+    bool busy() const { return running; }
+
+private:
+    enum class Wait : u8 {
+        None,
+        Input,
+        Output,
+    };
+
+    static void decoder_main(void* user);
+    static void on_event(void* user, s32 cycles_late);
+    static u32 on_ipu_to(void* user, u32 channel, const DmaSpan& span);
+    static u32 on_ipu_from(void* user, u32 channel, const DmaSpan& span);
+
+    void start(u32 command);
+    void pump();
+    void wake();
+    void execute(u32 command);
+
+    // Bitstream, on the decoder fiber.
+    u32 available_bits() const;
+    u32 peek(u32 count) const;
+    void skip(u32 count);
+    void need(u32 count);
+    u32 get(u32 count);
+    void read_bytes(u8* out, u32 size);
+    bool try_need(u32 count);
+    bool at_start_code();
+    void output(const void* data, u32 qwc);
+    void push_input(const u8* data, u32 qwc);
+
+    // Commands.
+    void bclr(u32 option);
+    void idec(u32 option);
+    void bdec(u32 option);
+    void vdec(u32 option);
+    void setiq(u32 option);
+    void setvq();
+    void csc(u32 option);
+    void pack(u32 option);
+
+    // Macroblock decoding.
+    void set_quantiser(u32 code);
+    void reset_dc_predictors();
+    bool decode_intra_block(u32 component, s16 block[64]);
+    bool decode_non_intra_block(s16 block[64]);
+    bool decode_coefficients(bool intra, s16 block[64], s32 sum);
+    bool read_escape(s32& run, s32& level);
+    bool next_macroblock();
+    void error();
+    void emit_rgb(const Raw8Macroblock& mb, u32 option, bool sign);
+
+    Dmac& dmac;
+    Scheduler& scheduler;
+    int event;
+    IpuIrqHook irq_hook;
+    void* irq_user;
+    IdctFunction idct;
+    CscFunction convert;
+
+    Fiber decoder;
+    Fiber caller;
+    bool running;
+    bool in_decoder;
+    Wait waiting;
+    u32 command;
+    bool command_sent;
+
+    // Registers.
+    u32 ctrl;
+    u32 cmd_data;
+
+    // Input: INPUT_QWC quadwords, decoding `bit` bits into the first; zero padded so a
+    // peek may read past the end.
+    u8 input[INPUT_QWC * 16 + 8];
+    u32 input_qwc;
+    u32 bit;
+    u8 input_latch[16];
+
+    u8 output_fifo[FIFO_QWC][16];
+    u32 output_head;
+    u32 output_qwc;
+    u8 output_latch[16];
+
+    // Decoder state.
+    u8 intra_matrix[64];            // Raster order
+    u8 non_intra_matrix[64];
+    u16 clut[16];
+    u32 transparent;
+    u32 translucent;
+    u32 quantiser_scale;
+    s32 dc_predictor[3];
+};
@@ -0,0 +1,147 @@
+#include <benchmark/benchmark.h>
+#include "runtime.h"
+#include "memory.h"
+#include <random>
+#include <vector>
+
+// What an FMV costs the host: the IDCT and colour conversion kernels on their own, in
+// each version the CPU runs, and IDEC decoding a slice of I-picture macroblocks end to
+// end between the two DMA channels.
+
+namespace {
+
+// Blocks as dequantisation leaves them: a DC term and a handful of low AC terms.
+std::vector<s16> coefficient_blocks(u32 count) {
+    std::mt19937 random(46);
+    std::vector<s16> blocks(count * 64, 0);
+    for (u32 i = 0; i < count; i++) {
+        s16* block = &blocks[i * 64];
+        block[0] = (s16)(random() % 2048);
+        for (u32 k = 0; k < 6; k++) {
+            block[random() % 24] = (s16)((s32)(random() % 256) - 128);
+        }
+    }
+    return blocks;
+}
+
+void run_idct(benchmark::State& state, IdctFunction idct) {
+    const u32 count = 256;
+    const std::vector<s16> blocks = coefficient_blocks(count);
+    alignas(32) s16 out[64];
+    u32 i = 0;
+    for (auto _ : state) {
+        idct(&blocks[i * 64], out);
+        benchmark::DoNotOptimize(out);
+        i = (i + 1) % count;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_IdctScalar(benchmark::State& state) { run_idct(state, &idct_scalar); }
+BENCHMARK(BM_IdctScalar);
+
+#if IDCT_SIMD_ENABLED
+void BM_IdctSse2(benchmark::State& state) { run_idct(state, &idct_sse2); }
+BENCHMARK(BM_IdctSse2);
+
+void BM_IdctAvx2(benchmark::State& state) {
+    if (!idct_has_avx2()) {
+        state.SkipWithError("no AVX2");
+        return;
+    }
+    run_idct(state, &idct_avx2);
+}
+BENCHMARK(BM_IdctAvx2);
+#endif
+
+void run_csc(benchmark::State& state, CscFunction convert) {
+    std::mt19937 random(601);
+    Raw8Macroblock mb;
+    for (u8& byte : reinterpret_cast<u8(&)[384]>(mb)) {
+        byte = (u8)random();
+    }
+    alignas(16) u32 out[256];
+    for (auto _ : state) {
+        convert(mb, out);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_CscScalar(benchmark::State& state) { run_csc(state, &csc_scalar); }
+BENCHMARK(BM_CscScalar);
+
+#if CSC_SIMD_ENABLED
+void BM_CscSse2(benchmark::State& state) { run_csc(state, &csc_sse2); }
+BENCHMARK(BM_CscSse2);
+#endif
+
+constexpr u32 INPUT = 0x00100000;
+constexpr u32 OUTPUT = 0x00200000;
+constexpr u32 SLICE_MACROBLOCKS = 45;       // One row of a 720-wide picture
+
+// A slice of intra macroblocks with a few AC coefficients per block, then a start code.
+std::vector<u8> slice() {
+    std::vector<u8> bytes;
+    u32 count = 0;
+    auto put = [&](const char* bits) {
+        for (const char* c = bits; *c; c++) {
+            if ((count & 7) == 0) {
+                bytes.push_back(0);
+            }
+            if (*c == '1') {
+                bytes.back() |= (u8)(0x80 >> (count & 7));
+            }
+            count++;
+        }
+    };
+    for (u32 mb = 0; mb < SLICE_MACROBLOCKS; mb++) {
+        put(mb ? "11" : "1");                   // increment 1, intra
+        for (u32 block = 0; block < 6; block++) {
+            put(block < 4 ? "00" "1" : "01" "1");    // DC size 1, +1
+            put("01000" "0111" "110" "10");         // (0, 2), (1, -1), (0, -1), EOB
+        }
+    }
+    while (count & 7) {
+        put("0");
+    }
+    put("00000000" "00000000" "00000001" "00000010");
+    bytes.resize((bytes.size() + 15) & ~size_t(15));
+    return bytes;
+}
+
+void BM_IdecSlice(benchmark::State& state) {
+    FastmemSpace* previous_space = fastmem_current();
+    SmcState* previous_smc = smc_current();
+    {
+        EEInstance instance;
+        instance.bind();
+        WriteMemory32(Dmac::D_CTRL, 1);
+        const std::vector<u8> stream = slice();
+        for (size_t i = 0; i < stream.size(); i++) {
+            WriteMemory8(INPUT + (u32)i, stream[i]);
+        }
+        for (auto _ : state) {
+            WriteMemory32(Ipu::IPU_CTRL, Ipu::CTRL_RST);
+            WriteMemory32(0x1000B010, OUTPUT);
+            WriteMemory32(0x1000B020, SLICE_MACROBLOCKS * Ipu::RGB32_QWC);
+            WriteMemory32(0x1000B000, chcr::STR);
+            WriteMemory32(0x1000B410, INPUT);
+            WriteMemory32(0x1000B420, (u32)stream.size() / 16);
+            WriteMemory32(0x1000B400, chcr::STR | chcr::DIR);
+            WriteMemory32(Ipu::IPU_CMD, Ipu::CMD_IDEC << 28 | 4u << Ipu::OPT_QSC_SHIFT);
+            while (instance.ipu.busy() || (instance.dmac.channel(DMAC_IPU_FROM).chcr & chcr::STR)) {
+                instance.cpuRegs.cycle += 1000;
+                instance.scheduler.run_due();
+            }
+            // Channel 4 may still hold the bytes after the start code.
+            WriteMemory32(0x1000B400, 0);
+        }
+        state.SetItemsProcessed(state.iterations() * SLICE_MACROBLOCKS);
+    }
+    fastmem_bind(previous_space);
+    smc_bind(previous_smc);
+}
+BENCHMARK(BM_IdecSlice);
+
+} // namespace
@@ -0,0 +1,427 @@
+#include "gtest/gtest.h"
+#include "runtime.h"
+#include "memory.h"
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr u32 INPUT = 0x00100000;           // Bitstream for channel 4
+constexpr u32 OUTPUT = 0x00200000;          // Where channel 3 puts the results
+constexpr u32 IPU_FROM_REGS = 0x1000B000;
+constexpr u32 IPU_TO_REGS = 0x1000B400;
+
+// Builds a bitstream MSB first.
+class BitWriter {
+public:
+    // Appends a code written like the tables, e.g. "0000 11"; spaces are ignored.
+    BitWriter& code(const char* bits) {
+        for (const char* c = bits; *c; c++) {
+            if (*c != ' ') {
+                bit(*c == '1');
+            }
+        }
+        return *this;
+    }
+
+    BitWriter& value(u32 value, u32 count) {
+        for (u32 i = count; i-- > 0;) {
+            bit((value >> i) & 1);
+        }
+        return *this;
+    }
+
+    // Zero pads to a byte boundary and appends a start code.
+    BitWriter& start_code(u8 id) {
+        while (count & 7) {
+            bit(false);
+        }
+        return value(0x000001, 24).value(id, 8);
+    }
+
+    // The bytes, zero padded to whole quadwords.
+    std::vector<u8> quadwords() const {
+        std::vector<u8> padded = bytes;
+        padded.resize((padded.size() + 15) & ~size_t(15));
+        return padded;
+    }
+
+private:
+    void bit(bool set) {
+        if ((count & 7) == 0) {
+            bytes.push_back(0);
+        }
+        if (set) {
+            bytes.back() |= (u8)(0x80 >> (count & 7));
+        }
+        count++;
+    }
+
+    std::vector<u8> bytes;
+    u32 count = 0;
+};
+
+// An intra macroblock whose six blocks only carry a DC difference of 0, i.e. a flat
+// mid-grey: dct_dc_size 0 then end of block.
+void dc_only_macroblock(BitWriter& stream) {
+    for (u32 i = 0; i < 4; i++) {
+        stream.code("100").code("10");
+    }
+    for (u32 i = 0; i < 2; i++) {
+        stream.code("00").code("10");
+    }
+}
+
+u32 command(u32 code, u32 option) {
+    return code << 28 | option;
+}
+
+class IpuTest : public ::testing::Test {
+protected:
+    IpuTest() : previous_space(fastmem_current()), previous_smc(smc_current()) {
+        instance.bind();
+        WriteMemory32(Dmac::D_CTRL, 1);
+    }
+    ~IpuTest() override {
+        fastmem_bind(previous_space);
+        smc_bind(previous_smc);
+    }
+
+    // Starts channel 4 on `data`, copied to INPUT.
+    void send(const std::vector<u8>& data) {
+        for (size_t i = 0; i < data.size(); i++) {
+            WriteMemory8(INPUT + (u32)i, data[i]);
+        }
+        WriteMemory32(IPU_TO_REGS + 0x10, INPUT);
+        WriteMemory32(IPU_TO_REGS + 0x20, (u32)(data.size() / 16));
+        WriteMemory32(IPU_TO_REGS, chcr::STR | chcr::DIR);
+    }
+
+    // Starts channel 3 on `qwc` quadwords at OUTPUT.
+    void receive(u32 qwc) {
+        WriteMemory32(IPU_FROM_REGS + 0x10, OUTPUT);
+        WriteMemory32(IPU_FROM_REGS + 0x20, qwc);
+        WriteMemory32(IPU_FROM_REGS, chcr::STR);
+    }
+
+    // Pushes `data` through the input FIFO register.
+    void write_fifo(const std::vector<u8>& data) {
+        for (size_t i = 0; i < data.size(); i += 4) {
+            u32 word;
+            std::memcpy(&word, &data[i], 4);
+            WriteMemory32(Ipu::IN_FIFO + (u32)(i & 15), word);
+        }
+    }
+
+    // Runs scheduler events until neither IPU channel is busy.
+    void settle() {
+        for (u32 i = 0; i < 1000; i++) {
+            const bool busy = (instance.dmac.channel(DMAC_IPU_FROM).chcr | instance.dmac.channel(DMAC_IPU_TO).chcr) & chcr::STR;
+            if (!busy && !instance.ipu.busy()) {
+                return;
+            }
+            instance.cpuRegs.cycle += 1000;
+            instance.scheduler.run_due();
+        }
+    }
+
+    EEInstance instance;
+    FastmemSpace* previous_space;
+    SmcState* previous_smc;
+};
+
+} // namespace
+
+// Every code of every table decodes to its own value and length.
+TEST(MpegTablesTest, EveryCodeLooksUpToItself) {
+    const VlcTable* tables[] = {
+        &mpeg::ADDRESS_INCREMENT, &mpeg::MB_TYPE_I, &mpeg::MB_TYPE_P, &mpeg::MB_TYPE_B,
+        &mpeg::MB_TYPE_D, &mpeg::CODED_BLOCK_PATTERN, &mpeg::MOTION_CODE, &mpeg::DMVECTOR,
+        &mpeg::DC_SIZE_LUMA, &mpeg::DC_SIZE_CHROMA, &mpeg::DCT_COEFFICIENTS_0, &mpeg::DCT_COEFFICIENTS_1,
+    };
+    for (const VlcTable* table : tables) {
+        for (const VlcCode& code : table->codes()) {
+            u32 bits = 0;
+            u32 length = 0;
+            for (const char* c = code.bits; *c; c++) {
+                if (*c != ' ') {
+                    bits |= (u32)(*c == '1') << (VlcTable::MAX_BITS - 1 - length++);
+                }
+            }
+            // Whatever follows the code must not matter.
+            const u32 tail = (1u << (VlcTable::MAX_BITS - length)) - 1;
+            for (u32 follow : { 0u, tail, tail & 0x5555 }) {
+                const VlcEntry& entry = table->lookup(bits | follow);
+                EXPECT_EQ(entry.length, length) << code.bits;
+                EXPECT_EQ(entry.value, code.value) << code.bits;
+                EXPECT_EQ(entry.level, code.level) << code.bits;
+            }
+        }
+    }
+}
+
+TEST(IdctTest, SimdMatchesScalar) {
+    // 1. Arrange: sparse blocks like dequantised coefficients, plus a few saturating ones.
+    std::mt19937 random(46);
+    std::vector<std::vector<s16>> blocks;
+    for (u32 i = 0; i < 500; i++) {
+        std::vector<s16> block(64, 0);
+        const u32 count = 1 + random() % 20;
+        for (u32 k = 0; k < count; k++) {
+            block[random() % (i < 20 ? 64 : 24)] = (s16)((s32)(random() % 4096) - 2048);
+        }
+        blocks.push_back(block);
+    }
+
+    for (const std::vector<s16>& block : blocks) {
+        // 2. Act
+        alignas(32) s16 scalar[64];
+        alignas(32) s16 sse2[64];
+        alignas(32) s16 avx2[64];
+        idct_scalar(block.data(), scalar);
+#if IDCT_SIMD_ENABLED
+        idct_sse2(block.data(), sse2);
+        if (idct_has_avx2()) {
+            idct_avx2(block.data(), avx2);
+        } else {
+            std::memcpy(avx2, scalar, sizeof(avx2));
+        }
+#else
+        std::memcpy(sse2, scalar, sizeof(sse2));
+        std::memcpy(avx2, scalar, sizeof(avx2));
+#endif
+
+        // 3. Assert
+        ASSERT_EQ(0, std::memcmp(scalar, sse2, sizeof(scalar)));
+        ASSERT_EQ(0, std::memcmp(scalar, avx2, sizeof(scalar)));
+    }
+}
+
+// IEEE 1180 style: within one of the exact transform.
+TEST(IdctTest, ScalarIsWithinOneOfTheExactTransform) {
+    std::mt19937 random(1180);
+    const double pi = 3.14159265358979323846;
+    for (u32 i = 0; i < 200; i++) {
+        s16 block[64] = {};
+        for (u32 k = 0; k < 10; k++) {
+            block[random() % 64] = (s16)((s32)(random() % 512) - 256);
+        }
+        s16 out[64];
+        idct_scalar(block, out);
+        for (u32 y = 0; y < 8; y++) {
+            for (u32 x = 0; x < 8; x++) {
+                double sum = 0;
+                for (u32 v = 0; v < 8; v++) {
+                    for (u32 u = 0; u < 8; u++) {
+                        const double cu = u ? 1 : std::sqrt(0.5);
+                        const double cv = v ? 1 : std::sqrt(0.5);
+                        sum += cu * cv / 4 * block[v * 8 + u] * std::cos((2 * x + 1) * u * pi / 16) * std::cos((2 * y + 1) * v * pi / 16);
+                    }
+                }
+                EXPECT_LE(std::abs(out[y * 8 + x] - sum), 1.0);
+            }
+        }
+    }
+}
+
+#if CSC_SIMD_ENABLED
+TEST(CscTest, Sse2MatchesScalar) {
+    std::mt19937 random(601);
+    for (u32 i = 0; i < 50; i++) {
+        Raw8Macroblock mb;
+        for (u8& byte : reinterpret_cast<u8(&)[384]>(mb)) {
+            byte = (u8)random();
+        }
+        u32 scalar[256];
+        u32 sse2[256];
+        csc_scalar(mb, scalar);
+        csc_sse2(mb, sse2);
+        ASSERT_EQ(0, std::memcmp(scalar, sse2, sizeof(scalar)));
+    }
+}
+#endif
+
+TEST(CscTest, Rgb16DithersAndKeepsTranslucency) {
+    u32 in[256];
+    for (u32& pixel : in) {
+        pixel = 0x40828282;
+    }
+    u16 plain[256];
+    u16 dithered[256];
+    csc_rgb16(in, plain, false);
+    csc_rgb16(in, dithered, true);
+
+    EXPECT_EQ(plain[0], 0xC210);            // 130 >> 3 = 16 per channel, alpha bit
+    EXPECT_EQ(dithered[0], 0xBDEF);         // 126 >> 3 = 15
+    EXPECT_EQ(dithered[2], 0xBDEF);         // 127
+    EXPECT_EQ(dithered[16 + 2], 0xC210);    // 133
+}
+
+TEST_F(IpuTest, FdecPeeksAndBclrResetsTheBitPointer) {
+    // 1. Arrange
+    write_fifo(BitWriter().value(0xABCD1234, 32).value(0x5678, 16).quadwords());
+
+    // 2. Act: skip 8 bits, then peek.
+    WriteMemory32(Ipu::IPU_CMD, command(Ipu::CMD_FDEC, 8));
+    const u32 peeked = ReadMemory32(Ipu::IPU_CMD);
+    const u32 top = ReadMemory32(Ipu::IPU_TOP);
+    const u32 bp = ReadMemory32(Ipu::IPU_BP);
+    WriteMemory32(Ipu::IPU_CMD, command(Ipu::CMD_BCLR, 0));
+
+    // 3. Assert
+    EXPECT_EQ(peeked, 0xCD123456u);
+    EXPECT_EQ(top, 0xCD123456u);
+    EXPECT_EQ(bp & 0x7F, 8u);
+    EXPECT_EQ(ReadMemory32(Ipu::IPU_CTRL) & 0xF, 0u);
+    EXPECT_EQ(ReadMemory32(Ipu::IPU_BP), 0u);
+}
+
+TEST_F(IpuTest, VdecReturnsTheValueAndTheCodeLength) {
+    // 1. Arrange: address increment 4, then motion code -2 ("001" and a sign).
+    write_fifo(BitWriter().code("0011").code("001 1").value(0xFFFF, 16).quadwords());
+
+    // 2. Act
+    WriteMemory32(Ipu::IPU_CMD, command(Ipu::CMD_VDEC, 0));
+    const u32 increment = ReadMemory32(Ipu::IPU_CMD);
+    WriteMemory32(Ipu::IPU_CMD, command(Ipu::CMD_VDEC, 2u << Ipu::OPT_TBL_SHIFT));
+    const u32 motion = ReadMemory32(Ipu::IPU_CMD);
+
+    // 3. Assert
+    EXPECT_EQ(increment, 4u << 16 | 4);
+    EXPECT_EQ(motion, 4u << 16 | 0xFFFE);
+    EXPECT_EQ(ReadMemory32(Ipu::IPU_CTRL) & Ipu::CTRL_ECD, 0u);
+    EXPECT_NE(instance.intc.read32(Intc::INTC_STAT) & (1u << INTC_IPU), 0u);
+}
+
+TEST_F(IpuTest, BdecOfAnIntraMacroblockComesOutThroughTheFifo) {
+    // 1. Arrange
+    BitWriter stream;
+    dc_only_macroblock(stream);
+    stream.start_code(0x01);
+    write_fifo(stream.quadwords());
+
+    // 2. Act: the output is 48 quadwords, so reading it keeps the decoder going.
+    WriteMemory32(Ipu::IPU_CMD, command(Ipu::CMD_BDEC, Ipu::OPT_MBI | Ipu::OPT_DCR | 1u << Ipu::OPT_QSC_SHIFT));
+    std::vector<s16> raw;
+    for (u32 i = 0; i < Ipu::RAW16_QWC; i++) {
+        const u128 quad = ReadMemory128(Ipu::OUT_FIFO);
+        const s16* lanes = reinterpret_cast<const s16*>(&quad);
+        raw.insert(raw.end(), lanes, lanes + 8);
+    }
+
+    // 3. Assert
+    EXPECT_FALSE(instance.ipu.busy());
+    for (s16 value : raw) {
+        ASSERT_EQ(value, 128);
+    }
+    const u32 ctrl = ReadMemory32(Ipu::IPU_CTRL);
+    EXPECT_EQ((ctrl >> 8) & 0x3F, 0x3Fu);
+    EXPECT_NE(ctrl & Ipu::CTRL_SCD, 0u);
+    EXPECT_EQ(ctrl & Ipu::CTRL_ECD, 0u);
+}
+
+TEST_F(IpuTest, BdecDequantisesInScanOrderWithMismatchControl) {
+    // 1. Arrange: the first luma block adds (run 0, level 2) after its DC.
+    BitWriter stream;
+    stream.code("100").code("0100 0").code("10");
+    for (u32 i = 1; i < 4; i++) {
+        stream.code("100").code("10");
+    }
+    for (u32 i = 0; i < 2; i++) {
+        stream.code("00").code("10");
+    }
+    stream.start_code(0x01);
+    write_fifo(stream.quadwords());
+
+    // 2. Act: quantiser_scale_code 1 is a scale of 2.
+    WriteMemory32(Ipu::IPU_CMD, command(Ipu::CMD_BDEC, Ipu::OPT_MBI | Ipu::OPT_DCR | 1u << Ipu::OPT_QSC_SHIFT));
+    std::vector<s16> raw;
+    for (u32 i = 0; i < Ipu::RAW16_QWC; i++) {
+        const u128 quad = ReadMemory128(Ipu::OUT_FIFO);
+        const s16* lanes = reinterpret_cast<const s16*>(&quad);
+        raw.insert(raw.end(), lanes, lanes + 8);
+    }
+
+    // 3. Assert: 2 * 2 * 16 / 16 = 4 at zigzag position 1, and the sum 1028 is even,
+    // so the last coefficient is toggled.
+    s16 coefficients[64] = {};
+    coefficients[0] = 1024;
+    coefficients[1] = 4;
+    coefficients[63] = 1;
+    s16 expected[64];
+    idct_scalar(coefficients, expected);
+    for (u32 y = 0; y < 8; y++) {
+        for (u32 x = 0; x < 8; x++) {
+            ASSERT_EQ(raw[y * 16 + x], expected[y * 8 + x]) << x << "," << y;
+        }
+    }
+    EXPECT_NE(raw[0], raw[7]);
+    EXPECT_EQ(raw[8], 128);
+    EXPECT_EQ(ReadMemory32(Ipu::IPU_CTRL) & Ipu::CTRL_ECD, 0u);
+}
+
+TEST_F(IpuTest, IdecDecodesASliceBetweenTheDmaChannels) {
+    // 1. Arrange: three flat grey macroblocks, then the next start code.
+    BitWriter stream;
+    for (u32 i = 0; i < 3; i++) {
+        if (i) {
+            stream.code("1");       // macroblock_address_increment 1
+        }
+        stream.code("1");           // macroblock_type: intra
+        dc_only_macroblock(stream);
+    }
+    stream.start_code(0x02);
+
+    // 2. Act: 3 * 64 quadwords of RGB32, far more than either FIFO holds.
+    receive(3 * Ipu::RGB32_QWC);
+    send(stream.quadwords());
+    WriteMemory32(Ipu::IPU_CMD, command(Ipu::CMD_IDEC, 1u << Ipu::OPT_QSC_SHIFT));
+    settle();
+
+    // 3. Assert: Y = Cb = Cr = 128 is RGB 130, 130, 130.
+    EXPECT_FALSE(instance.ipu.busy());
+    EXPECT_EQ(instance.dmac.channel(DMAC_IPU_FROM).chcr & chcr::STR, 0u);
+    for (u32 i = 0; i < 3 * 256; i++) {
+        ASSERT_EQ(ReadMemory32(OUTPUT + i * 4), 0x80828282u) << i;
+    }
+    const u32 ctrl = ReadMemory32(Ipu::IPU_CTRL);
+    EXPECT_NE(ctrl & Ipu::CTRL_SCD, 0u);
+    EXPECT_EQ(ctrl & Ipu::CTRL_ECD, 0u);
+    EXPECT_EQ(ReadMemory32(Ipu::IPU_TOP), 0x00000102u);
+    EXPECT_NE(instance.intc.read32(Intc::INTC_STAT) & (1u << INTC_IPU), 0u);
+}
+
+TEST_F(IpuTest, CscAppliesTheSetthThresholds) {
+    // 1. Arrange: a RAW8 macroblock of mid-grey.
+    std::vector<u8> raw(sizeof(Raw8Macroblock), 128);
+    WriteMemory32(Ipu::IPU_CMD, command(Ipu::CMD_SETTH, 0 | 200u << 16));
+
+    // 2. Act
+    receive(Ipu::RGB32_QWC);
+    send(raw);
+    WriteMemory32(Ipu::IPU_CMD, command(Ipu::CMD_CSC, 1));
+    settle();
+
+    // 3. Assert: 130 is below the translucent threshold.
+    EXPECT_EQ(ReadMemory32(OUTPUT), 0x40828282u);
+    EXPECT_EQ(ReadMemory32(OUTPUT + 255 * 4), 0x40828282u);
+}
+
+TEST_F(IpuTest, ResetAbandonsAWaitingCommand) {
+    // 1. Arrange: IDEC with nothing to decode waits for input.
+    WriteMemory32(Ipu::IPU_CMD, command(Ipu::CMD_IDEC, 0));
+    ASSERT_TRUE(instance.ipu.busy());
+    EXPECT_NE(ReadMemory32(Ipu::IPU_CTRL) & Ipu::CTRL_BUSY, 0u);
+
+    // 2. Act
+    WriteMemory32(Ipu::IPU_CTRL, Ipu::CTRL_RST);
+
+    // 3. Assert
+    EXPECT_FALSE(instance.ipu.busy());
+    EXPECT_NE(instance.intc.read32(Intc::INTC_STAT) & (1u << INTC_IPU), 0u);
+    WriteMemory32(Ipu::IPU_CMD, command(Ipu::CMD_SETTH, 0));
+    EXPECT_FALSE(instance.ipu.busy());
+}
@@ -0,0 +1,688 @@
+#include "kernel.h"
+#include "memory.h"
+#include "dispatch.h"
+#include "timers.h"
+#include <cstring>
+#include <iostream>
+
+using namespace kernel;
+
+Kernel::Kernel(EmotionEngineState& context, Interrupts& interrupts, Intc& intc, Dmac& dmac, Scheduler& scheduler)
+    : context(context), interrupts(interrupts), intc(intc), dmac(dmac), scheduler(scheduler), threads(), semas(), alarms(),
+      current(MAIN_THREAD), next_wait_order(0), switch_pending(false), ready_bitmap(), contexts(MAX_THREADS), heap_end(0), gs_crt_interlace(0), gs_crt_mode(0), gs_crt_field(0),
+      gs_imr(0), vsync_flag(0), vsync_csr(0), sif_regs(), guest_syscalls() {
+    for (u32 priority = 0; priority < PRIORITY_COUNT; priority++) {
+        ready_head[priority] = ready_tail[priority] = -1;
+    }
+
+    // The game starts on the main thread, which runs on whatever host stack runs the
+    // instance, at the highest priority until it says otherwise.
+    Thread& main = threads[MAIN_THREAD];
+    main.status = THS_RUN;
+    main.ready_prev = main.ready_next = -1;
+    fibers[MAIN_THREAD] = std::make_unique<Fiber>();
+
+    // Non-Japanese system, English (ConfigParam.japLanguage and .language).
+    osd_config = (1u << 4) | (1u << 16);
+
+    alarm_event = scheduler.register_event("kernel_alarm", &on_alarm, this);
+}
+
+s32 Kernel::add_intc_handler(u32 cause, u32 handler, s32 next, u32 arg) {
+    // `next` 0 puts the handler first, anything else last.
+    return interrupts.add_intc_handler(cause, handler, arg, next == 0);
+}
+
+s32 Kernel::remove_intc_handler(u32 cause, s32 id) {
+    return interrupts.remove_intc_handler(cause, id) ? 0 : -1;
+}
+
+s32 Kernel::add_dmac_handler(u32 channel, u32 handler, s32 next, u32 arg) {
+    return interrupts.add_dmac_handler(channel, handler, arg, next == 0);
+}
+
+s32 Kernel::remove_dmac_handler(u32 channel, s32 id) {
+    return interrupts.remove_dmac_handler(channel, id) ? 0 : -1;
+}
+
+// INTC_MASK and the D_STAT mask bits flip on a 1, so only write when the bit has to change.
+s32 Kernel::enable_intc(u32 cause) {
+    if (cause >= INTC_LINE_COUNT || (intc.read32(Intc::INTC_MASK) & (1u << cause))) {
+        return 0;
+    }
+    intc.write32(Intc::INTC_MASK, 1u << cause);
+    interrupts.update();
+    return 1;
+}
+
+s32 Kernel::disable_intc(u32 cause) {
+    if (cause >= INTC_LINE_COUNT || !(intc.read32(Intc::INTC_MASK) & (1u << cause))) {
+        return 0;
+    }
+    intc.write32(Intc::INTC_MASK, 1u << cause);
+    interrupts.update();
+    return 1;
+}
+
+s32 Kernel::enable_dmac(u32 channel) {
+    const u32 mask = 1u << (16 + channel);
+    if (channel >= DMAC_CHANNEL_COUNT || (dmac.stat() & mask)) {
+        return 0;
+    }
+    dmac.write32(Dmac::D_STAT, mask);
+    interrupts.update();
+    return 1;
+}
+
+s32 Kernel::disable_dmac(u32 channel) {
+    const u32 mask = 1u << (16 + channel);
+    if (channel >= DMAC_CHANNEL_COUNT || !(dmac.stat() & mask)) {
+        return 0;
+    }
+    dmac.write32(Dmac::D_STAT, mask);
+    interrupts.update();
+    return 1;
+}
+
+s32 Kernel::set_alarm(u16 time, u32 handler, u32 arg) {
+    for (u32 id = 0; id < MAX_ALARMS; id++) {
+        Alarm& alarm = alarms[id];
+        if (!alarm.used) {
+            alarm = Alarm{ true, time, context.cpuRegs.cycle + (u32)time * Timers::CYCLES_PER_SCANLINE, handler, arg };
+            schedule_alarm();
+            return (s32)id;
+        }
+    }
+    return -1;
+}
+
+s32 Kernel::release_alarm(s32 id) {
+    if (id < 0 || (u32)id >= MAX_ALARMS || !alarms[id].used) {
+        return -1;
+    }
+    alarms[id].used = false;
+    schedule_alarm();
+    return id;
+}
+
+// One scheduler event, armed for the alarm due first.
+void Kernel::schedule_alarm() {
+    const u32 now = context.cpuRegs.cycle;
+    s32 earliest = -1;
+    for (u32 id = 0; id < MAX_ALARMS; id++) {
+        if (alarms[id].used && (earliest < 0 || (s32)(alarms[id].due - alarms[earliest].due) < 0)) {
+            earliest = (s32)id;
+        }
+    }
+    if (earliest < 0) {
+        scheduler.cancel(alarm_event);
+        return;
+    }
+    const s32 delay = (s32)(alarms[earliest].due - now);
+    scheduler.schedule(alarm_event, delay > 0 ? (u32)delay : 0);
+}
+
+// Alarm handlers often set the next alarm, so each one is released before it is called.
+void Kernel::on_alarm(void* user, s32) {
+    Kernel& kernel = *static_cast<Kernel*>(user);
+    const u32 now = kernel.context.cpuRegs.cycle;
+    for (u32 id = 0; id < MAX_ALARMS; id++) {
+        Alarm& alarm = kernel.alarms[id];
+        if (alarm.used && (s32)(alarm.due - now) <= 0) {
+            alarm.used = false;
+            kernel.interrupts.call_handler(alarm.handler, id, alarm.time, alarm.arg);
+        }
+    }
+    kernel.schedule_alarm();
+}
+
+s32 Kernel::create_thread(u32 param) {
+    const u32 priority = ReadMemory32(param + thread_param::INITIAL_PRIORITY);
+    if (priority >= PRIORITY_COUNT) {
+        return -1;
+    }
+    for (u32 id = MAIN_THREAD + 1; id < MAX_THREADS; id++) {
+        Thread& thread = threads[id];
+        if (thread.status == 0) {
+            thread = Thread{};
+            thread.status = THS_DORMANT;
+            thread.entry = ReadMemory32(param + thread_param::FUNC);
+            thread.stack = ReadMemory32(param + thread_param::STACK);
+            thread.stack_size = ReadMemory32(param + thread_param::STACK_SIZE);
+            thread.gp = ReadMemory32(param + thread_param::GP_REG);
+            thread.initial_priority = priority;
+            thread.current_priority = priority;
+            thread.attr = ReadMemory32(param + thread_param::ATTR);
+            thread.option = ReadMemory32(param + thread_param::OPTION);
+            thread.ready_prev = -1;
+            thread.ready_next = -1;
+            return (s32)id;
+        }
+    }
+    return -1;
+}
+
+// The fiber is kept: its stack is reused if the slot is.
+s32 Kernel::delete_thread(s32 id) {
+    if (!valid_thread(id) || id == current || threads[id].status != THS_DORMANT) {
+        return -1;
+    }
+    threads[id] = Thread{};
+    return id;
+}
+
+s32 Kernel::start_thread(s32 id, u32 arg) {
+    if (!valid_thread(id) || threads[id].status != THS_DORMANT) {
+        return -1;
+    }
+    Thread& thread = threads[id];
+    thread.start_arg = arg;
+    thread.current_priority = thread.initial_priority;
+
+    // Fresh registers: the argument, its stack and $gp. $ra is set on entry.
+    ThreadContext& regs = contexts[id];
+    regs = ThreadContext{};
+    regs.gpr.n.a0.SD[0] = (s32)arg;
+    regs.gpr.n.sp.UD[0] = (thread.stack + thread.stack_size) & ~15u;
+    regs.gpr.n.gp.UD[0] = thread.gp;
+    regs.pc = thread.entry;
+    if (fibers[id]) {
+        fibers[id]->reset();
+    } else {
+        fibers[id] = std::make_unique<Fiber>(&thread_entry, this);
+    }
+
+    make_ready(id);
+    reschedule();
+    return id;
+}
+
+// Runs on the thread's own fiber, with its registers already loaded. Returning from the
+// thread function is ExitThread.
+void Kernel::thread_entry(void* user) {
+    Kernel& kernel = *static_cast<Kernel*>(user);
+    call_guest_function(kernel.context, kernel.threads[kernel.current].entry);
+    kernel.exit_thread();
+}
+
+// Never returns to the caller: the thread's fiber is only entered again through a fresh
+// start.
+s32 Kernel::exit_thread() {
+    threads[current].status = THS_DORMANT;
+    reschedule();
+    return 0;
+}
+
+s32 Kernel::exit_delete_thread() {
+    threads[current] = Thread{};
+    reschedule();
+    return 0;
+}
+
+s32 Kernel::terminate_thread(s32 id) {
+    if (!valid_thread(id) || id == current || threads[id].status == THS_DORMANT) {
+        return -1;
+    }
+    Thread& thread = threads[id];
+    if (thread.status == THS_READY) {
+        dequeue(id);
+    } else if ((thread.status & THS_WAIT) && thread.wait_type == TSW_SEMA) {
+        semas[thread.wait_id].wait_threads--;
+    }
+    thread.status = THS_DORMANT;
+    thread.wait_type = TSW_NONE;
+    return id;
+}
+
+s32 Kernel::change_thread_priority(s32 id, s32 priority) {
+    if (id == 0) {
+        id = current;
+    }
+    if (!valid_thread(id) || threads[id].status == THS_DORMANT || priority < 0 || (u32)priority >= PRIORITY_COUNT) {
+        return -1;
+    }
+    Thread& thread = threads[id];
+    const s32 previous = (s32)thread.current_priority;
+    if (thread.status == THS_READY) {
+        dequeue(id);
+        thread.current_priority = (u32)priority;
+        enqueue(id, false);
+    } else {
+        thread.current_priority = (u32)priority;
+    }
+    reschedule();
+    return previous;
+}
+
+// The running thread, if it has that priority, goes behind the threads ready at it;
+// otherwise the front of the queue goes to the back.
+s32 Kernel::rotate_thread_ready_queue(s32 priority) {
+    if (priority < 0 || (u32)priority >= PRIORITY_COUNT) {
+        return -1;
+    }
+    const s32 front = ready_head[priority];
+    if (front < 0) {
+        return priority;
+    }
+    Thread& running = threads[current];
+    if (running.status == THS_RUN && running.current_priority == (u32)priority) {
+        running.status = THS_READY;
+        enqueue(current, false);
+        reschedule();
+    } else {
+        dequeue(front);
+        enqueue(front, false);
+    }
+    return priority;
+}
+
+s32 Kernel::release_wait_thread(s32 id) {
+    if (!valid_thread(id) || !(threads[id].status & THS_WAIT)) {
+        return -1;
+    }
+    release(id);
+    reschedule();
+    return id;
+}
+
+s32 Kernel::refer_thread_status(s32 id, u32 status) {
+    if (id == 0) {
+        id = current;
+    }
+    if (!valid_thread(id)) {
+        return -1;
+    }
+    const Thread& thread = threads[id];
+    if (status) {
+        WriteMemory32(status + thread_param::STATUS, thread.status);
+        WriteMemory32(status + thread_param::FUNC, thread.entry);
+        WriteMemory32(status + thread_param::STACK, thread.stack);
+        WriteMemory32(status + thread_param::STACK_SIZE, thread.stack_size);
+        WriteMemory32(status + thread_param::GP_REG, thread.gp);
+        WriteMemory32(status + thread_param::INITIAL_PRIORITY, thread.initial_priority);
+        WriteMemory32(status + thread_param::CURRENT_PRIORITY, thread.current_priority);
+        WriteMemory32(status + thread_param::ATTR, thread.attr);
+        WriteMemory32(status + thread_param::OPTION, thread.option);
+        WriteMemory32(status + thread_param::WAIT_TYPE, thread.wait_type);
+        WriteMemory32(status + thread_param::WAIT_ID, (u32)thread.wait_id);
+        WriteMemory32(status + thread_param::WAKEUP_COUNT, thread.wakeup_count);
+    }
+    return (s32)thread.status;
+}
+
+s32 Kernel::sleep_thread() {
+    Thread& thread = threads[current];
+    if (thread.wakeup_count > 0) {
+        thread.wakeup_count--;
+        return current;
+    }
+    const s32 id = current;
+    wait(TSW_SLEEP, 0);
+    return id;
+}
+
+s32 Kernel::wakeup_thread(s32 id) {
+    if (!valid_thread(id) || id == current || threads[id].status == THS_DORMANT) {
+        return -1;
+    }
+    Thread& thread = threads[id];
+    if ((thread.status & THS_WAIT) && thread.wait_type == TSW_SLEEP) {
+        release(id);
+        reschedule();
+    } else {
+        thread.wakeup_count++;
+    }
+    return id;
+}
+
+s32 Kernel::cancel_wakeup_thread(s32 id) {
+    if (id == 0) {
+        id = current;
+    }
+    if (!valid_thread(id)) {
+        return -1;
+    }
+    const s32 count = (s32)threads[id].wakeup_count;
+    threads[id].wakeup_count = 0;
+    return count;
+}
+
+s32 Kernel::suspend_thread(s32 id) {
+    if (!valid_thread(id) || id == current) {
+        return -1;
+    }
+    Thread& thread = threads[id];
+    if (thread.status == THS_READY) {
+        dequeue(id);
+        thread.status = THS_SUSPEND;
+    } else if (thread.status == THS_WAIT) {
+        thread.status = THS_WAITSUSPEND;
+    } else {
+        return -1;
+    }
+    return id;
+}
+
+s32 Kernel::resume_thread(s32 id) {
+    if (!valid_thread(id) || !(threads[id].status & THS_SUSPEND)) {
+        return -1;
+    }
+    Thread& thread = threads[id];
+    if (thread.status == THS_WAITSUSPEND) {
+        thread.status = THS_WAIT;
+    } else {
+        make_ready(id);
+        reschedule();
+    }
+    return id;
+}
+
+u32 Kernel::setup_thread(u32 gp, u32 stack, s32 stack_size, u32 args) {
+    if (stack == 0xFFFFFFFF) {
+        stack = fastmem::RAM_SIZE - (u32)stack_size;
+    }
+    Thread& main = threads[MAIN_THREAD];
+    main.stack = stack;
+    main.stack_size = (u32)stack_size;
+    main.gp = gp;
+
+    // Nothing was passed on the command line.
+    if (args) {
+        WriteMemory32(args, 0);
+    }
+    return stack + (u32)stack_size;
+}
+
+u32 Kernel::setup_heap(u32 start, s32 size) {
+    heap_end = size < 0 ? threads[MAIN_THREAD].stack : start + (u32)size;
+    return heap_end;
+}
+
+s32 Kernel::create_sema(u32 param) {
+    const s32 count = (s32)ReadMemory32(param + sema_param::INIT_COUNT);
+    const s32 max_count = (s32)ReadMemory32(param + sema_param::MAX_COUNT);
+    if (count < 0 || max_count <= 0 || count > max_count) {
+        return -1;
+    }
+    for (u32 id = 1; id < MAX_SEMAPHORES; id++) {
+        Semaphore& sema = semas[id];
+        if (!sema.used) {
+            sema = Semaphore{ true, count, max_count, count,
+                              ReadMemory32(param + sema_param::ATTR), ReadMemory32(param + sema_param::OPTION), 0 };
+            return (s32)id;
+        }
+    }
+    return -1;
+}
+
+s32 Kernel::delete_sema(s32 id) {
+    if (!valid_sema(id)) {
+        return -1;
+    }
+    for (u32 thread = 1; thread < MAX_THREADS; thread++) {
+        if ((threads[thread].status & THS_WAIT) && threads[thread].wait_type == TSW_SEMA && threads[thread].wait_id == id) {
+            release((s32)thread);
+        }
+    }
+    semas[id] = Semaphore{};
+    reschedule();
+    return id;
+}
+
+// Waiters are woken in the order they started waiting.
+s32 Kernel::signal_sema(s32 id) {
+    if (!valid_sema(id)) {
+        return -1;
+    }
+    Semaphore& sema = semas[id];
+    if (sema.wait_threads == 0) {
+        if (sema.count >= sema.max_count) {
+            return -1;
+        }
+        sema.count++;
+        return id;
+    }
+
+    s32 first = -1;
+    for (u32 thread = 1; thread < MAX_THREADS; thread++) {
+        const Thread& t = threads[thread];
+        if ((t.status & THS_WAIT) && t.wait_type == TSW_SEMA && t.wait_id == id &&
+            (first < 0 || t.wait_order < threads[first].wait_order)) {
+            first = (s32)thread;
+        }
+    }
+    release(first);
+    reschedule();
+    return id;
+}
+
+s32 Kernel::wait_sema(s32 id) {
+    if (!valid_sema(id)) {
+        return -1;
+    }
+    Semaphore& sema = semas[id];
+    if (sema.count > 0) {
+        sema.count--;
+        return id;
+    }
+    sema.wait_threads++;
+    wait(TSW_SEMA, id);
+    return id;
+}
+
+s32 Kernel::poll_sema(s32 id) {
+    if (!valid_sema(id) || semas[id].count == 0) {
+        return -1;
+    }
+    semas[id].count--;
+    return id;
+}
+
+s32 Kernel::refer_sema_status(s32 id, u32 param) {
+    if (!valid_sema(id)) {
+        return -1;
+    }
+    const Semaphore& sema = semas[id];
+    WriteMemory32(param + sema_param::COUNT, (u32)sema.count);
+    WriteMemory32(param + sema_param::MAX_COUNT, (u32)sema.max_count);
+    WriteMemory32(param + sema_param::INIT_COUNT, (u32)sema.init_count);
+    WriteMemory32(param + sema_param::WAIT_THREADS, sema.wait_threads);
+    WriteMemory32(param + sema_param::ATTR, sema.attr);
+    WriteMemory32(param + sema_param::OPTION, sema.option);
+    return id;
+}
+
+void Kernel::set_gs_crt(u32 interlace, u32 mode, u32 field) {
+    gs_crt_interlace = interlace;
+    gs_crt_mode = mode;
+    gs_crt_field = field;
+}
+
+u32 Kernel::gs_put_imr(u32 imr) {
+    const u32 previous = gs_imr;
+    gs_imr = imr;
+    return previous;
+}
+
+void Kernel::set_vsync_flag(u32 flag, u32 csr) {
+    vsync_flag = flag;
+    vsync_csr = csr;
+}
+
+// There is no GS yet, so the CSR copy the kernel also makes is left out.
+void Kernel::on_vblank_start() {
+    if (vsync_flag) {
+        WriteMemory32(vsync_flag, 1);
+    }
+}
+
+u32 Kernel::get_osd_config_param(u32 param) {
+    WriteMemory32(param, osd_config);
+    return osd_config;
+}
+
+void Kernel::set_osd_config_param(u32 param) {
+    osd_config = ReadMemory32(param);
+}
+
+void Kernel::sif_set_reg(u32 reg, u32 value) {
+    sif_regs[reg & 31] = value;
+}
+
+u32 Kernel::sif_get_reg(u32 reg) const {
+    return sif_regs[reg & 31];
+}
+
+void Kernel::set_syscall(u32 number, u32 function) {
+    guest_syscalls[number & 127] = function;
+}
+
+void Kernel::make_ready(s32 id) {
+    threads[id].status = THS_READY;
+    enqueue(id, false);
+}
+
+void Kernel::enqueue(s32 id, bool front) {
+    Thread& thread = threads[id];
+    const u32 priority = thread.current_priority;
+    if (ready_head[priority] < 0) {
+        thread.ready_prev = thread.ready_next = -1;
+        ready_head[priority] = ready_tail[priority] = id;
+        ready_bitmap[priority / 64] |= 1ull << (priority % 64);
+    } else if (front) {
+        thread.ready_prev = -1;
+        thread.ready_next = ready_head[priority];
+        threads[ready_head[priority]].ready_prev = id;
+        ready_head[priority] = id;
+    } else {
+        thread.ready_prev = ready_tail[priority];
+        thread.ready_next = -1;
+        threads[ready_tail[priority]].ready_next = id;
+        ready_tail[priority] = id;
+    }
+}
+
+void Kernel::dequeue(s32 id) {
+    Thread& thread = threads[id];
+    const u32 priority = thread.current_priority;
+    if (thread.ready_prev >= 0) {
+        threads[thread.ready_prev].ready_next = thread.ready_next;
+    } else {
+        ready_head[priority] = thread.ready_next;
+    }
+    if (thread.ready_next >= 0) {
+        threads[thread.ready_next].ready_prev = thread.ready_prev;
+    } else {
+        ready_tail[priority] = thread.ready_prev;
+    }
+    thread.ready_prev = thread.ready_next = -1;
+    if (ready_head[priority] < 0) {
+        ready_bitmap[priority / 64] &= ~(1ull << (priority % 64));
+    }
+}
+
+// Front of the queue of the lowest non-empty priority, or -1.
+s32 Kernel::highest_ready() const {
+    for (u32 word = 0; word < PRIORITY_COUNT / 64; word++) {
+        if (ready_bitmap[word]) {
+            return ready_head[word * 64 + __builtin_ctzll(ready_bitmap[word])];
+        }
+    }
+    return -1;
+}
+
+void Kernel::wait(u32 type, s32 id) {
+    Thread& thread = threads[current];
+    thread.status = THS_WAIT;
+    thread.wait_type = type;
+    thread.wait_id = id;
+    thread.wait_order = next_wait_order++;
+    reschedule();
+}
+
+void Kernel::release(s32 id) {
+    Thread& thread = threads[id];
+    if (thread.wait_type == TSW_SEMA) {
+        semas[thread.wait_id].wait_threads--;
+    }
+    thread.wait_type = TSW_NONE;
+    thread.wait_id = 0;
+    if (thread.status == THS_WAITSUSPEND) {
+        thread.status = THS_SUSPEND;
+    } else {
+        make_ready(id);
+    }
+}
+
+void Kernel::reschedule() {
+    // Inside an interrupt handler the switch waits until the interrupt returns.
+    if (context.cpuRegs.CP0.n.Status.b.EXL) {
+        switch_pending = true;
+        return;
+    }
+    switch_pending = false;
+
+    cpuRegisters& regs = context.cpuRegs;
+    u64 idled = 0;
+    for (;;) {
+        const s32 next = highest_ready();
+        Thread& running = threads[current];
+        if (running.status == THS_RUN) {
+            if (next < 0 || threads[next].current_priority >= running.current_priority) {
+                return;
+            }
+            // Preempted: it stays at the front of its priority.
+            running.status = THS_READY;
+            enqueue(current, true);
+        }
+        if (next >= 0) {
+            dequeue(next);
+            switch_to(next);
+            return;
+        }
+
+        // Nothing can run: skip ahead to the next event and take the interrupts it
+        // raises, one of which has to wake a thread.
+        if (idled >= IDLE_LIMIT) {
+            std::cerr << "FATAL_ERROR: Every EE thread is waiting and no interrupt woke one (deadlock)." << std::endl;
+            exit(1);
+        }
+        const s32 step = (s32)(regs.nextEventCycle - regs.cycle);
+        if (step > 0) {
+            regs.cycle += (u32)step;
+            idled += (u32)step;
+        }
+        scheduler.run_due();
+        interrupts.update();
+        interrupts.deliver();
+    }
+}
+
+// Returns when something switches back to the calling thread, with its registers loaded.
+void Kernel::switch_to(s32 id) {
+    threads[id].status = THS_RUN;
+    if (id == current) {
+        return;
+    }
+
+    cpuRegisters& regs = context.cpuRegs;
+    ThreadContext& saved = contexts[current];
+    saved.gpr = regs.GPR;
+    saved.hi = regs.HI;
+    saved.lo = regs.LO;
+    saved.sa = regs.sa;
+    saved.pc = regs.pc;
+    saved.fpu = context.fpuRegs;
+
+    const ThreadContext& loaded = contexts[id];
+    regs.GPR = loaded.gpr;
+    regs.HI = loaded.hi;
+    regs.LO = loaded.lo;
+    regs.sa = loaded.sa;
+    regs.pc = loaded.pc;
+    context.fpuRegs = loaded.fpu;
+
+    Fiber& from = *fibers[current];
+    current = id;
+    from.switch_to(*fibers[id]);
+}
@@ -0,0 +1,273 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "interrupts.h"
+#include "intc.h"
+#include "dmac.h"
+#include "scheduler.h"
+#include "fiber.h"
+#include <memory>
+#include <vector>
+
+// High-level emulation of the EE kernel.
+//
+// There is no BIOS: a SYSCALL in recompiled code calls straight into the host-side table
+// in syscalls.h, and the services below do what the kernel would, on host data
+// structures. Arguments come from the guest argument registers and results go back in
+// $v0; guest structures (ThreadParam, SemaParam...) are read and written in guest memory
+// with the layouts the game's libraries use.
+//
+// Each EE thread runs on a host fiber of its own (see fiber.h), so a thread that blocks
+// deep inside recompiled code just has its stack set aside. Switching saves the guest
+// registers of the outgoing thread and loads those of the incoming one into the shared
+// EmotionEngineState. The thread to run is picked from a ready queue per priority, with a
+// bitmap of the non-empty ones, so picking is O(1) whatever the number of threads.
+// When every thread waits, the kernel idles forward from event to event, taking
+// interrupts, until a handler or alarm wakes one.
+//
+// Switches asked for from interrupt context (iSignalSema, iWakeupThread...) wait until
+// the handlers have returned (interrupt_return()).
+//
+// Interrupt handler registration goes to Interrupts, which calls the handlers.
+
+namespace kernel {
+    constexpr u32 MAX_THREADS = 256;
+    constexpr u32 MAX_SEMAPHORES = 256;
+    constexpr u32 MAX_ALARMS = 64;
+    constexpr u32 PRIORITY_COUNT = 128;        // 0 is the highest
+    constexpr u32 MAIN_THREAD = 1;             // Id 0 is the kernel's idle thread
+
+    // Thread status (ThreadParam.status).
+    constexpr u32 THS_RUN = 0x01;
+    constexpr u32 THS_READY = 0x02;
+    constexpr u32 THS_WAIT = 0x04;
+    constexpr u32 THS_SUSPEND = 0x08;
+    constexpr u32 THS_WAITSUSPEND = THS_WAIT | THS_SUSPEND;
+    constexpr u32 THS_DORMANT = 0x10;
+
+    // What a waiting thread waits for (ThreadStatus.waitType).
+    constexpr u32 TSW_NONE = 0;
+    constexpr u32 TSW_SLEEP = 1;
+    constexpr u32 TSW_SEMA = 2;
+
+    // How long the kernel idles waiting for something to wake the only runnable thread
+    // before reporting a deadlock (ten seconds of EE time).
+    constexpr u64 IDLE_LIMIT = 10ull * 294912000;
+
+    // Offsets into the guest structures.
+    namespace thread_param {
+        constexpr u32 STATUS = 0;
+        constexpr u32 FUNC = 4;
+        constexpr u32 STACK = 8;
+        constexpr u32 STACK_SIZE = 12;
+        constexpr u32 GP_REG = 16;
+        constexpr u32 INITIAL_PRIORITY = 20;
+        constexpr u32 CURRENT_PRIORITY = 24;
+        constexpr u32 ATTR = 28;
+        constexpr u32 OPTION = 32;
+        constexpr u32 WAIT_TYPE = 36;           // ThreadStatus only, from here on
+        constexpr u32 WAIT_ID = 40;
+        constexpr u32 WAKEUP_COUNT = 44;
+    }
+    namespace sema_param {
+        constexpr u32 COUNT = 0;
+        constexpr u32 MAX_COUNT = 4;
+        constexpr u32 INIT_COUNT = 8;
+        constexpr u32 WAIT_THREADS = 12;
+        constexpr u32 ATTR = 16;
+        constexpr u32 OPTION = 20;
+    }
+}
+
+class Kernel {
+public:
+    Kernel(EmotionEngineState& context, Interrupts& interrupts, Intc& intc, Dmac& dmac, Scheduler& scheduler);
+
+    // Interrupts (AddIntcHandler, _EnableIntc...). Enable/disable return whether the mask
+    // bit changed.
+    s32 add_intc_handler(u32 cause, u32 handler, s32 next, u32 arg);
+    s32 remove_intc_handler(u32 cause, s32 id);
+    s32 add_dmac_handler(u32 channel, u32 handler, s32 next, u32 arg);
+    s32 remove_dmac_handler(u32 channel, s32 id);
+    s32 enable_intc(u32 cause);
+    s32 disable_intc(u32 cause);
+    s32 enable_dmac(u32 channel);
+    s32 disable_dmac(u32 channel);
+
+    /**
+     * @brief Calls `handler(id, time, arg)` in interrupt context after `time` scanlines.
+     * @return The alarm id, or -1 if every alarm is in use.
+     */
+    s32 set_alarm(u16 time, u32 handler, u32 arg);
+    s32 release_alarm(s32 id);
+
+    // Threads. Ids index the kernel's table; every call returns -1 for a bad id.
+    s32 create_thread(u32 param);
+    s32 delete_thread(s32 id);
+    s32 start_thread(s32 id, u32 arg);
+    s32 exit_thread();
+    s32 exit_delete_thread();
+    s32 terminate_thread(s32 id);
+    s32 change_thread_priority(s32 id, s32 priority);
+    s32 rotate_thread_ready_queue(s32 priority);
+    s32 release_wait_thread(s32 id);
+    s32 get_thread_id() const { return current; }
+
+    // True while no thread can run and the kernel waits for an interrupt to ready one.
+    bool idling() const { return threads[current].status != kernel::THS_RUN; }
+    s32 refer_thread_status(s32 id, u32 status);
+    s32 sleep_thread();
+    s32 wakeup_thread(s32 id);
+    s32 cancel_wakeup_thread(s32 id);
+    s32 suspend_thread(s32 id);
+    s32 resume_thread(s32 id);
+
+    /**
+     * @brief Sets up the main thread's stack and arguments (crt0).
+     * @param stack Bottom of the stack, or -1 to put it at the top of RAM.
+     * @return The main thread's initial $sp.
+     */
+    u32 setup_thread(u32 gp, u32 stack, s32 stack_size, u32 args);
+    u32 setup_heap(u32 start, s32 size);
+    u32 end_of_heap() const { return heap_end; }
+
+    // Semaphores. WaitSema blocks (see reschedule()); PollSema never does.
+    s32 create_sema(u32 param);
+    s32 delete_sema(s32 id);
+    s32 signal_sema(s32 id);
+    s32 wait_sema(s32 id);
+    s32 poll_sema(s32 id);
+    s32 refer_sema_status(s32 id, u32 param);
+
+    // GS mode and the rest of the small stuff.
+    void set_gs_crt(u32 interlace, u32 mode, u32 field);
+    u32 gs_get_imr() const { return gs_imr; }
+    u32 gs_put_imr(u32 imr);
+    void set_vsync_flag(u32 flag, u32 csr);
+    u32 get_osd_config_param(u32 param);
+    void set_osd_config_param(u32 param);
+    void sif_set_reg(u32 reg, u32 value);
+    u32 sif_get_reg(u32 reg) const;
+
+    /**
+     * @brief Replaces syscall `number` with a guest function (SetSyscall).
+     */
+    void set_syscall(u32 number, u32 function);
+    u32 guest_syscall(u32 number) const { return number < 128 ? guest_syscalls[number] : 0; }
+
+    /**
+     * @brief Called once interrupt handlers have returned: switches to the thread they
+     * readied, if it should preempt the running one.
+     */
+    void interrupt_return() {
+        if (switch_pending) {
+            reschedule();
+        }
+    }
+
+    // Called at the start of every VBLANK: raises the flag registered with SetVSyncFlag.
+    void on_vblank_start();
+
+    u32 thread_status(s32 id) const { return valid_thread(id) ? threads[id].status : 0; }
+    s32 thread_priority(s32 id) const { return valid_thread(id) ? threads[id].current_priority : -1; }
+    s32 sema_count(s32 id) const { return valid_sema(id) ? semas[id].count : -1; }
+    u32 gs_mode() const { return gs_crt_mode; }
+
+private:
+    struct Thread {
+        u32 status;                 // 0 while the slot is free
+        u32 entry;
+        u32 start_arg;
+        u32 stack;
+        u32 stack_size;
+        u32 gp;
+        u32 initial_priority;
+        u32 current_priority;
+        u32 attr;
+        u32 option;
+        u32 wait_type;
+        s32 wait_id;
+        u32 wakeup_count;
+        u32 wait_order;             // Waiters of a semaphore are woken in this order
+        s32 ready_prev;             // Links in its priority's ready queue, -1 at the ends
+        s32 ready_next;
+    };
+
+    // Guest registers of a thread that is not running.
+    struct ThreadContext {
+        GPRregs gpr;
+        GPR_reg hi;
+        GPR_reg lo;
+        u32 sa;
+        u32 pc;
+        fpuRegisters fpu;
+    };
+
+    struct Semaphore {
+        bool used;
+        s32 count;
+        s32 max_count;
+        s32 init_count;
+        u32 attr;
+        u32 option;
+        u32 wait_threads;
+    };
+
+    struct Alarm {
+        bool used;
+        u16 time;
+        u32 due;                    // Absolute cycle
+        u32 handler;
+        u32 arg;
+    };
+
+    static void on_alarm(void* user, s32 cycles_late);
+    static void thread_entry(void* user);
+
+    bool valid_thread(s32 id) const { return id > 0 && (u32)id < kernel::MAX_THREADS && threads[id].status != 0; }
+    bool valid_sema(s32 id) const { return id >= 0 && (u32)id < kernel::MAX_SEMAPHORES && semas[id].used; }
+
+    void make_ready(s32 id);
+    void enqueue(s32 id, bool front);
+    void dequeue(s32 id);
+    s32 highest_ready() const;
+    void wait(u32 type, s32 id);
+    void release(s32 id);
+    void reschedule();
+    void switch_to(s32 id);
+    void schedule_alarm();
+
+    EmotionEngineState& context;
+    Interrupts& interrupts;
+    Intc& intc;
+    Dmac& dmac;
+    Scheduler& scheduler;
+
+    Thread threads[kernel::MAX_THREADS];
+    Semaphore semas[kernel::MAX_SEMAPHORES];
+    Alarm alarms[kernel::MAX_ALARMS];
+    s32 current;
+    u32 next_wait_order;
+    bool switch_pending;
+
+    // Threads ready to run (not the running one), FIFO per priority. Bit n of the bitmap
+    // is set while priority n's queue is not empty.
+    u64 ready_bitmap[kernel::PRIORITY_COUNT / 64];
+    s32 ready_head[kernel::PRIORITY_COUNT];
+    s32 ready_tail[kernel::PRIORITY_COUNT];
+
+    std::vector<ThreadContext> contexts;            // Indexed by thread id
+    std::unique_ptr<Fiber> fibers[kernel::MAX_THREADS];
+    int alarm_event;
+
+    u32 heap_end;
+    u32 gs_crt_interlace;
+    u32 gs_crt_mode;
+    u32 gs_crt_field;
+    u32 gs_imr;
+    u32 vsync_flag;
+    u32 vsync_csr;
+    u32 osd_config;
+    u32 sif_regs[32];
+    u32 guest_syscalls[128];
+};
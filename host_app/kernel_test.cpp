@@ -0,0 +1,312 @@
+#include "gtest/gtest.h"
+#include "runtime.h"
+#include "memory.h"
+#include <vector>
+
+namespace {
+
+constexpr u32 PARAM = 0x00100000;           // Guest structures passed to the kernel
+constexpr u32 SIGNAL_ALARM = 0x00200000;
+constexpr u32 VBLANK_HANDLER = 0x00200100;
+constexpr u32 GAME_SYSCALL = 0x00200200;
+constexpr u32 SLEEPER = 0x00200300;         // Thread entry points
+constexpr u32 SIGNALLER = 0x00200400;
+constexpr u32 ROTATOR = 0x00200500;
+constexpr u32 WAKE_HANDLER = 0x00200600;
+constexpr u32 WOKEN = 1;                    // Added to an entry point for a later step
+
+std::vector<u32> calls;
+
+void return_to_caller(EmotionEngineState* ctx) {
+    host_dispatch_jump(ctx, ctx->cpuRegs.GPR.n.ra.UD[0]);
+}
+
+// An alarm handler doing iSignalSema(arg).
+void signal_alarm(EmotionEngineState* ctx) {
+    calls.push_back(SIGNAL_ALARM);
+    const u32 sema = ctx->cpuRegs.GPR.n.a2.UL[0];
+    ctx->cpuRegs.GPR.n.a0.SD[0] = (s32)sema;
+    ctx->cpuRegs.GPR.n.v1.SD[0] = -(s32)SYS_ISIGNAL_SEMA;
+    cpu_syscall(*ctx);
+    return_to_caller(ctx);
+}
+
+s32 guest_syscall(EmotionEngineState* ctx, s32 number, u32 a0 = 0) {
+    ctx->cpuRegs.GPR.n.a0.SD[0] = (s32)a0;
+    ctx->cpuRegs.GPR.n.v1.SD[0] = number;
+    cpu_syscall(*ctx);
+    return ctx->cpuRegs.GPR.n.v0.SL[0];
+}
+
+// A thread that goes to sleep once and returns (exits) when woken.
+void sleeper(EmotionEngineState* ctx) {
+    calls.push_back(SLEEPER);
+    guest_syscall(ctx, SYS_SLEEP_THREAD);
+    calls.push_back(SLEEPER + WOKEN);
+    return_to_caller(ctx);
+}
+
+// A thread that signals the semaphore it was started with.
+void signaller(EmotionEngineState* ctx) {
+    calls.push_back(SIGNALLER);
+    guest_syscall(ctx, SYS_SIGNAL_SEMA, ctx->cpuRegs.GPR.n.a0.UL[0]);
+    calls.push_back(SIGNALLER + WOKEN);
+    return_to_caller(ctx);
+}
+
+// A thread that hands its turn to the next thread of its priority, forever.
+void rotator(EmotionEngineState* ctx) {
+    const u32 priority = ctx->cpuRegs.GPR.n.a0.UL[0];
+    for (;;) {
+        calls.push_back(ROTATOR);
+        guest_syscall(ctx, SYS_ROTATE_THREAD_READY_QUEUE, priority);
+    }
+}
+
+// An INTC handler doing iWakeupThread(arg).
+void wake_handler(EmotionEngineState* ctx) {
+    calls.push_back(WAKE_HANDLER);
+    guest_syscall(ctx, -(s32)SYS_IWAKEUP_THREAD, ctx->cpuRegs.GPR.n.a1.UL[0]);
+    ctx->cpuRegs.GPR.n.v0.SD[0] = 0;
+    return_to_caller(ctx);
+}
+
+void vblank_handler(EmotionEngineState* ctx) {
+    calls.push_back(VBLANK_HANDLER);
+    ctx->cpuRegs.GPR.n.v0.SD[0] = 0;
+    return_to_caller(ctx);
+}
+
+void game_syscall(EmotionEngineState* ctx) {
+    calls.push_back(GAME_SYSCALL);
+    ctx->cpuRegs.GPR.n.v0.SD[0] = 0x77;
+    return_to_caller(ctx);
+}
+
+class KernelTest : public ::testing::Test {
+protected:
+    KernelTest() : previous_space(fastmem_current()), previous_smc(smc_current()) {
+        register_function(SIGNAL_ALARM, &signal_alarm);
+        register_function(VBLANK_HANDLER, &vblank_handler);
+        register_function(GAME_SYSCALL, &game_syscall);
+        register_function(SLEEPER, &sleeper);
+        register_function(SIGNALLER, &signaller);
+        register_function(ROTATOR, &rotator);
+        register_function(WAKE_HANDLER, &wake_handler);
+        calls.clear();
+        instance.bind();
+
+        // Interrupts on, INT0/INT1 unmasked, as the kernel leaves them for user code.
+        auto& status = instance.cpuRegs.CP0.n.Status;
+        status.b.IE = 1;
+        status.b.EIE = 1;
+        status.val |= Interrupts::CAUSE_IP2 | Interrupts::CAUSE_IP3;
+    }
+    ~KernelTest() override {
+        fastmem_bind(previous_space);
+        smc_bind(previous_smc);
+    }
+
+    // SYSCALL the way recompiled code does it when $v1 is not known.
+    s32 syscall(s32 number, u32 a0 = 0, u32 a1 = 0, u32 a2 = 0, u32 a3 = 0) {
+        GPRregs& gpr = instance.cpuRegs.GPR;
+        gpr.n.v1.SD[0] = number;
+        gpr.n.a0.SD[0] = (s32)a0;
+        gpr.n.a1.SD[0] = (s32)a1;
+        gpr.n.a2.SD[0] = (s32)a2;
+        gpr.n.a3.SD[0] = (s32)a3;
+        cpu_syscall(instance);
+        return gpr.n.v0.SL[0];
+    }
+
+    // A thread at `priority` starting in `entry`, on a stack of its own.
+    s32 create_thread(u32 entry, u32 priority) {
+        WriteMemory32(PARAM + kernel::thread_param::FUNC, entry);
+        WriteMemory32(PARAM + kernel::thread_param::STACK, 0x00400000 + next_stack);
+        WriteMemory32(PARAM + kernel::thread_param::STACK_SIZE, 0x1000);
+        WriteMemory32(PARAM + kernel::thread_param::INITIAL_PRIORITY, priority);
+        next_stack += 0x1000;
+        return syscall(SYS_CREATE_THREAD, PARAM);
+    }
+
+    u32 next_stack = 0;
+    FastmemSpace* previous_space;
+    SmcState* previous_smc;
+    EEInstance instance;
+};
+
+} // namespace
+
+TEST_F(KernelTest, CreateThreadReadsThreadParam) {
+    // 1. Arrange
+    WriteMemory32(PARAM + kernel::thread_param::FUNC, 0x00300000);
+    WriteMemory32(PARAM + kernel::thread_param::STACK, 0x00400000);
+    WriteMemory32(PARAM + kernel::thread_param::STACK_SIZE, 0x1000);
+    WriteMemory32(PARAM + kernel::thread_param::INITIAL_PRIORITY, 30);
+
+    // 2. Act
+    const s32 id = syscall(SYS_CREATE_THREAD, PARAM);
+    const s32 status = syscall(SYS_REFER_THREAD_STATUS, id, PARAM + 0x100);
+
+    // 3. Assert
+    EXPECT_EQ(id, 2);
+    EXPECT_EQ((u32)status, kernel::THS_DORMANT);
+    EXPECT_EQ(ReadMemory32(PARAM + 0x100 + kernel::thread_param::FUNC), 0x00300000u);
+    EXPECT_EQ(ReadMemory32(PARAM + 0x100 + kernel::thread_param::CURRENT_PRIORITY), 30u);
+    EXPECT_EQ(syscall(SYS_GET_THREAD_ID), (s32)kernel::MAIN_THREAD);
+    EXPECT_EQ(syscall(SYS_DELETE_THREAD, id), id);
+    EXPECT_EQ(syscall(SYS_REFER_THREAD_STATUS, id, 0), -1);
+}
+
+TEST_F(KernelTest, InterruptVariantsShareTheirSlot) {
+    WriteMemory32(PARAM + kernel::sema_param::INIT_COUNT, 1);
+    WriteMemory32(PARAM + kernel::sema_param::MAX_COUNT, 2);
+    const s32 sema = syscall(SYS_CREATE_SEMA, PARAM);
+
+    EXPECT_EQ(syscall(-(s32)SYS_IPOLL_SEMA, sema), sema);
+    EXPECT_EQ(syscall(SYS_POLL_SEMA, sema), -1);
+    EXPECT_EQ(syscall(-(s32)SYS_ISIGNAL_SEMA, sema), sema);
+    EXPECT_EQ(instance.kernel.sema_count(sema), 1);
+}
+
+TEST_F(KernelTest, WaitSemaIdlesUntilAnAlarmSignalsIt) {
+    // 1. Arrange: an empty semaphore and an alarm 10 scanlines away that signals it.
+    WriteMemory32(PARAM + kernel::sema_param::INIT_COUNT, 0);
+    WriteMemory32(PARAM + kernel::sema_param::MAX_COUNT, 1);
+    const s32 sema = syscall(SYS_CREATE_SEMA, PARAM);
+    const u32 start = instance.cpuRegs.cycle;
+    ASSERT_GE(syscall(SYS_SET_ALARM, 10, SIGNAL_ALARM, sema), 0);
+
+    // 2. Act
+    const s32 result = syscall(SYS_WAIT_SEMA, sema);
+
+    // 3. Assert: time went by up to the alarm, and the main thread got the count.
+    EXPECT_EQ(result, sema);
+    EXPECT_EQ(calls, std::vector<u32>{ SIGNAL_ALARM });
+    EXPECT_GE(instance.cpuRegs.cycle - start, 10 * Timers::CYCLES_PER_SCANLINE);
+    EXPECT_EQ(instance.kernel.sema_count(sema), 0);
+    EXPECT_EQ(instance.kernel.thread_status(kernel::MAIN_THREAD), kernel::THS_RUN);
+}
+
+TEST_F(KernelTest, SleepThreadUsesUpWakeups) {
+    const s32 id = instance.kernel.create_thread(PARAM);
+    instance.kernel.start_thread(id, 0);
+    EXPECT_EQ(syscall(SYS_WAKEUP_THREAD, kernel::MAIN_THREAD), -1);     // Not itself
+    EXPECT_EQ(syscall(SYS_CANCEL_WAKEUP_THREAD, 0), 0);
+
+    // A pending wakeup lets the next sleep return straight away.
+    instance.kernel.wakeup_thread(id);
+    EXPECT_EQ(syscall(SYS_CANCEL_WAKEUP_THREAD, id), 1);
+}
+
+TEST_F(KernelTest, EnableIntcOnlyFlipsTheMaskOnce) {
+    EXPECT_EQ(syscall(SYS_ENABLE_INTC, INTC_VBLANK_START), 1);
+    EXPECT_EQ(syscall(SYS_ENABLE_INTC, INTC_VBLANK_START), 0);
+    EXPECT_EQ(instance.intc.read32(Intc::INTC_MASK), 1u << INTC_VBLANK_START);
+    EXPECT_EQ(syscall(-(s32)SYS_IDISABLE_INTC, INTC_VBLANK_START), 1);
+    EXPECT_EQ(instance.intc.read32(Intc::INTC_MASK), 0u);
+}
+
+TEST_F(KernelTest, IntcHandlersAreCalledOnTheirInterrupt) {
+    // 1. Arrange
+    ASSERT_GT(syscall(SYS_ADD_INTC_HANDLER, INTC_VBLANK_START, VBLANK_HANDLER, (u32)-1, 0), 0);
+    syscall(SYS_ENABLE_INTC, INTC_VBLANK_START);
+
+    // 2. Act
+    instance.intc.raise(INTC_VBLANK_START);
+    cpu_event_test(instance);
+
+    // 3. Assert
+    EXPECT_EQ(calls, std::vector<u32>{ VBLANK_HANDLER });
+}
+
+TEST_F(KernelTest, SetSyscallFillsAnEmptySlot) {
+    // 1. Arrange
+    syscall(SYS_SET_SYSCALL, 0x5A, GAME_SYSCALL);
+    instance.cpuRegs.GPR.n.ra.UD[0] = 0x00100200;
+
+    // 2. Act
+    const s32 result = syscall(0x5A);
+
+    // 3. Assert: the game's function ran and the caller's $ra survived.
+    EXPECT_EQ(result, 0x77);
+    EXPECT_EQ(calls, std::vector<u32>{ GAME_SYSCALL });
+    EXPECT_EQ(instance.cpuRegs.GPR.n.ra.UD[0], 0x00100200u);
+}
+
+TEST_F(KernelTest, SetVSyncFlagIsRaisedAtVblank) {
+    syscall(SYS_SET_VSYNC_FLAG, PARAM, PARAM + 8);
+
+    instance.cpuRegs.cycle += Timers::VISIBLE_SCANLINES * Timers::CYCLES_PER_SCANLINE;
+    cpu_event_test(instance);
+
+    EXPECT_EQ(ReadMemory32(PARAM), 1u);
+}
+
+TEST_F(KernelTest, StartingAHigherPriorityThreadRunsItAtOnce) {
+    // 1. Arrange: main steps down to priority 10 so a priority 5 thread outranks it.
+    syscall(SYS_CHANGE_THREAD_PRIORITY, kernel::MAIN_THREAD, 10);
+    const s32 id = create_thread(SLEEPER, 5);
+
+    // 2. Act
+    syscall(SYS_START_THREAD, id, 0);
+    const std::vector<u32> after_start = calls;
+    syscall(SYS_WAKEUP_THREAD, id);
+
+    // 3. Assert: it ran until it slept, and again until it exited once woken.
+    EXPECT_EQ(after_start, std::vector<u32>{ SLEEPER });
+    EXPECT_EQ(calls, (std::vector<u32>{ SLEEPER, SLEEPER + WOKEN }));
+    EXPECT_EQ(instance.kernel.thread_status(id), kernel::THS_DORMANT);
+    EXPECT_EQ(syscall(SYS_GET_THREAD_ID), (s32)kernel::MAIN_THREAD);
+}
+
+TEST_F(KernelTest, WaitSemaRunsALowerPriorityThreadUntilItSignals) {
+    // 1. Arrange
+    syscall(SYS_CHANGE_THREAD_PRIORITY, kernel::MAIN_THREAD, 10);
+    WriteMemory32(PARAM + kernel::sema_param::INIT_COUNT, 0);
+    WriteMemory32(PARAM + kernel::sema_param::MAX_COUNT, 1);
+    const s32 sema = syscall(SYS_CREATE_SEMA, PARAM);
+    const s32 id = create_thread(SIGNALLER, 20);
+    syscall(SYS_START_THREAD, id, sema);
+    ASSERT_TRUE(calls.empty());
+
+    // 2. Act
+    instance.cpuRegs.GPR.n.s0.UD[0] = 0x1234;
+    const s32 result = syscall(SYS_WAIT_SEMA, sema);
+
+    // 3. Assert: the signal handed the CPU straight back to main, with its registers.
+    EXPECT_EQ(result, sema);
+    EXPECT_EQ(calls, std::vector<u32>{ SIGNALLER });
+    EXPECT_EQ(instance.kernel.thread_status(id), kernel::THS_READY);
+    EXPECT_EQ(instance.cpuRegs.GPR.n.s0.UD[0], 0x1234u);
+}
+
+TEST_F(KernelTest, RotateThreadReadyQueueTakesTurns) {
+    syscall(SYS_CHANGE_THREAD_PRIORITY, kernel::MAIN_THREAD, 10);
+    const s32 id = create_thread(ROTATOR, 10);
+    syscall(SYS_START_THREAD, id, 10);
+    EXPECT_TRUE(calls.empty());
+
+    syscall(SYS_ROTATE_THREAD_READY_QUEUE, 10);
+    syscall(SYS_ROTATE_THREAD_READY_QUEUE, 10);
+
+    EXPECT_EQ(calls, (std::vector<u32>{ ROTATOR, ROTATOR }));
+    EXPECT_EQ(syscall(SYS_GET_THREAD_ID), (s32)kernel::MAIN_THREAD);
+}
+
+TEST_F(KernelTest, ThreadWokenByAnInterruptRunsWhenTheHandlerReturns) {
+    // 1. Arrange: a priority 5 thread asleep and a VBLANK handler that wakes it.
+    syscall(SYS_CHANGE_THREAD_PRIORITY, kernel::MAIN_THREAD, 10);
+    const s32 id = create_thread(SLEEPER, 5);
+    syscall(SYS_START_THREAD, id, 0);
+    syscall(SYS_ADD_INTC_HANDLER, INTC_VBLANK_START, WAKE_HANDLER, (u32)-1, id);
+    syscall(SYS_ENABLE_INTC, INTC_VBLANK_START);
+
+    // 2. Act
+    instance.intc.raise(INTC_VBLANK_START);
+    cpu_event_test(instance);
+
+    // 3. Assert: the thread only ran once the handler was done.
+    EXPECT_EQ(calls, (std::vector<u32>{ SLEEPER, WAKE_HANDLER, SLEEPER + WOKEN }));
+    EXPECT_EQ(instance.kernel.thread_status(id), kernel::THS_DORMANT);
+}
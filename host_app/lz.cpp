@@ -0,0 +1,190 @@
+#include "lz.h"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr u32 HASH_BITS = 14;
+constexpr u32 MAX_OFFSET = 0xFFFF;
+
+// Matches stop this far from the end, so the last sequence always has literals and the
+// matcher's 4-byte reads stay inside the input.
+constexpr size_t LAST_LITERALS = 5;
+
+// Without a match for a while, probe every 2nd, 3rd, ... byte: incompressible data goes
+// through quickly and compressible data hardly notices.
+constexpr u32 SKIP_SHIFT = 6;
+
+u32 read32(const u8* data) {
+    u32 value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+u32 hash(u32 sequence, u32 bits) {
+    return (sequence * 2654435761u) >> (32 - bits);
+}
+
+// About a slot per 4 input bytes, up to HASH_BITS. Clearing the table is most of the cost
+// of compressing a small input (a 4 KB save state page, see savestate.h).
+u32 table_bits(size_t size) {
+    u32 bits = 8;
+    while (bits < HASH_BITS && (size_t)1 << (bits + 2) < size) {
+        bits++;
+    }
+    return bits;
+}
+
+u64 read64(const u8* data) {
+    u64 value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+// How far the match at `candidate` for `ip`, known to be LZ_MIN_MATCH long, goes on
+// before `limit`. Eight bytes are compared at a time.
+size_t match_length(const u8* in, size_t candidate, size_t ip, size_t limit) {
+    size_t length = LZ_MIN_MATCH;
+    while (ip + length + 8 <= limit) {
+        const u64 difference = read64(in + candidate + length) ^ read64(in + ip + length);
+        if (difference) {
+            return length + (size_t)__builtin_ctzll(difference) / 8;
+        }
+        length += 8;
+    }
+    while (ip + length < limit && in[candidate + length] == in[ip + length]) {
+        length++;
+    }
+    return length;
+}
+
+// Bytes a length of `length` takes beyond its nibble.
+size_t extra_bytes(size_t length) {
+    return length < 15 ? 0 : (length - 15) / 255 + 1;
+}
+
+u8* put_length(u8* out, size_t length) {
+    for (length -= 15; length >= 255; length -= 255) {
+        *out++ = 255;
+    }
+    *out++ = (u8)length;
+    return out;
+}
+
+bool get_length(const u8* in, size_t size, size_t& ip, size_t& length) {
+    u8 byte;
+    do {
+        if (ip >= size) {
+            return false;
+        }
+        byte = in[ip++];
+        length += byte;
+    } while (byte == 255);
+    return true;
+}
+
+// One sequence; a match length of 0 ends the stream after the literals.
+bool emit(u8* out, size_t& op, size_t capacity, const u8* literals, size_t literal_count, u32 offset, size_t match) {
+    const size_t match_code = match ? match - LZ_MIN_MATCH : 0;
+    const size_t need = 1 + extra_bytes(literal_count) + literal_count + (match ? 2 + extra_bytes(match_code) : 0);
+    if (need > capacity - op) {
+        return false;
+    }
+    u8* p = out + op;
+    u8* token = p++;
+    *token = (u8)((literal_count < 15 ? literal_count : 15) << 4);
+    if (literal_count >= 15) {
+        p = put_length(p, literal_count);
+    }
+    std::memcpy(p, literals, literal_count);
+    p += literal_count;
+    if (match) {
+        *token |= (u8)(match_code < 15 ? match_code : 15);
+        *p++ = (u8)offset;
+        *p++ = (u8)(offset >> 8);
+        if (match_code >= 15) {
+            p = put_length(p, match_code);
+        }
+    }
+    op = (size_t)(p - out);
+    return true;
+}
+
+} // namespace
+
+size_t lz_compress(const u8* in, size_t size, u8* out, size_t capacity) {
+    // Positions of recent 4-byte sequences, by hash; a stale or colliding entry is caught
+    // by comparing the bytes.
+    const u32 bits = table_bits(size);
+    std::vector<u32> table(1u << bits, 0);
+    const size_t match_limit = size > LAST_LITERALS ? size - LAST_LITERALS : 0;
+    size_t ip = 0;
+    size_t anchor = 0;
+    size_t op = 0;
+    while (ip + LZ_MIN_MATCH <= match_limit) {
+        const u32 sequence = read32(in + ip);
+        const u32 slot = hash(sequence, bits);
+        const size_t candidate = table[slot];
+        table[slot] = (u32)ip;
+        if (candidate >= ip || ip - candidate > MAX_OFFSET || read32(in + candidate) != sequence) {
+            ip += 1 + ((ip - anchor) >> SKIP_SHIFT);
+            continue;
+        }
+        size_t length = match_length(in, candidate, ip, match_limit);
+        if (!emit(out, op, capacity, in + anchor, ip - anchor, (u32)(ip - candidate), length)) {
+            return 0;
+        }
+        ip += length;
+        anchor = ip;
+    }
+    if (!emit(out, op, capacity, in + anchor, size - anchor, 0, 0)) {
+        return 0;
+    }
+    return op;
+}
+
+bool lz_decompress(const u8* in, size_t size, u8* out, size_t out_size) {
+    size_t ip = 0;
+    size_t op = 0;
+    while (ip < size) {
+        const u8 token = in[ip++];
+        size_t literal_count = token >> 4;
+        if (literal_count == 15 && !get_length(in, size, ip, literal_count)) {
+            return false;
+        }
+        if (literal_count > size - ip || literal_count > out_size - op) {
+            return false;
+        }
+        std::memcpy(out + op, in + ip, literal_count);
+        ip += literal_count;
+        op += literal_count;
+        if (ip == size) {
+            break;
+        }
+
+        if (size - ip < 2) {
+            return false;
+        }
+        const size_t offset = (size_t)in[ip] | ((size_t)in[ip + 1] << 8);
+        ip += 2;
+        size_t length = (token & 15);
+        if (length == 15 && !get_length(in, size, ip, length)) {
+            return false;
+        }
+        length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > op || length > out_size - op) {
+            return false;
+        }
+        const u8* from = out + op - offset;
+        if (offset >= length) {
+            std::memcpy(out + op, from, length);
+        } else {
+            // Overlapping: a run repeating the last `offset` bytes.
+            for (size_t i = 0; i < length; i++) {
+                out[op + i] = from[i];
+            }
+        }
+        op += length;
+    }
+    return op == out_size;
+}
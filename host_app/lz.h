@@ -0,0 +1,39 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <cstddef>
+
+// A byte-oriented LZ77 codec in the style of LZ4's block format, for data that is
+// decompressed far more often than it is compressed (disc image blocks, see
+// compressed_image.h). Greedy single-probe matching keeps compression fast; decompression
+// is a loop of two memcpy()s per sequence.
+//
+// The stream is a run of sequences, each
+//
+//   token       high nibble: literal count, low nibble: match length - LZ_MIN_MATCH
+//   [length]    more literal count when the nibble is 15: bytes added up until one < 255
+//   literals
+//   offset      u16 LE, how far back the match starts (1..65535)
+//   [length]    more match length when the nibble is 15, as above
+//
+// and the last sequence stops after its literals.
+
+constexpr u32 LZ_MIN_MATCH = 4;
+
+// The most lz_compress() can write for `size` bytes of input.
+constexpr size_t lz_bound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+/**
+ * @brief Compresses `size` bytes of `in` into `out`.
+ * @return The compressed size, or 0 if it would not fit in `capacity` bytes.
+ */
+size_t lz_compress(const u8* in, size_t size, u8* out, size_t capacity);
+
+/**
+ * @brief Decompresses `size` bytes of `in`, which must expand to exactly `out_size` bytes.
+ * Every length and offset is checked, so corrupt input cannot write outside `out`.
+ * @return false if the input is corrupt or does not expand to `out_size` bytes.
+ */
+bool lz_decompress(const u8* in, size_t size, u8* out, size_t out_size);
@@ -1,57 +1,221 @@
 #pragma once
 
 #include "cpu_state.h"
-#include <vector>
-#include <capstone/capstone.h>
-#include <iostream>
+#include "fastmem.h"
+#include <cstring>
 
 
-// This declares a global variable for the PS2's main memory (32MB).
-// It will be defined in memory.cpp.
-extern std::vector<uint8_t> main_memory;
+// The PS2's main memory (32MB) as a flat array. The storage belongs to the address space
+// bound to the calling thread (see fastmem.h), which also maps it at each of the EE's
+// RAM mirrors.
+struct GuestRam {
+    u8* data() const { return ram_memory; }
+    size_t size() const { return fastmem::RAM_SIZE; }
+    u8& operator[](size_t index) const { return ram_memory[index]; }
+};
+
+// This declares a global variable for the PS2's main memory. No thread has an address
+// space until it gets one: call fastmem_init(), or bind an EEInstance (see runtime.h).
+extern const GuestRam main_memory;
+
+namespace memory_detail {
+    // Clearing bits 29 and 31 folds KSEG0 (0x80000000), KSEG1 (0xA0000000) and the
+    // uncached mirror (0x20000000) onto RAM at 0, while every other segment stays at
+    // 0x10000000 or above. One compare then tells whether an access is plain RAM.
+    constexpr u32 RAM_MIRROR_MASK = 0x5FFFFFFF;
+
+    // Everything that is not plain RAM: the 0x30000000 mirror, the scratchpad, devices
+    // and out-of-bounds accesses. Defined in memory.cpp for u8/u16/u32/u64/u128; other
+    // types of the same width (s32, float, ...) go through the matching unsigned one.
+    template <typename T> [[gnu::cold, gnu::noinline]] T read_slow(u32 address);
+    template <typename T> [[gnu::cold, gnu::noinline]] void write_slow(u32 address, const T& value);
+
+    template <size_t Size> struct access;
+    template <> struct access<1> { using type = u8; };
+    template <> struct access<2> { using type = u16; };
+    template <> struct access<4> { using type = u32; };
+    template <> struct access<8> { using type = u64; };
+    template <> struct access<16> { using type = u128; };
+    template <typename T> using access_t = typename access<sizeof(T)>::type;
+
+    template <typename T>
+    inline T read_checked(u32 address) {
+        const u32 offset = address & RAM_MIRROR_MASK;
+        if (__builtin_expect(offset <= fastmem::RAM_SIZE - sizeof(T), 1)) {
+            T value;
+            std::memcpy(&value, ram_memory + offset, sizeof(T));
+            return value;
+        }
+        const access_t<T> raw = read_slow<access_t<T>>(address);
+        T value;
+        std::memcpy(&value, &raw, sizeof(T));
+        return value;
+    }
+
+    template <typename T>
+    inline void write_checked(u32 address, const T& value) {
+        const u32 offset = address & RAM_MIRROR_MASK;
+        if (__builtin_expect(offset <= fastmem::RAM_SIZE - sizeof(T), 1)) {
+            std::memcpy(ram_memory + offset, &value, sizeof(T));
+            return;
+        }
+        access_t<T> raw;
+        std::memcpy(&raw, &value, sizeof(T));
+        write_slow<access_t<T>>(address, raw);
+    }
+}
+
+/**
+ * @brief Reads an 8, 16, 32, 64 or 128-bit value (any trivially copyable type) from the emulated memory (the EE is little-endian,
+ * like the host, so no byte swapping is needed).
+ * @param address Any EE address: RAM and its mirrors, the scratchpad or a device register.
+ * @return The value at that address.
+ *
+ * With fastmem this is a single host load; otherwise RAM costs one compare and anything
+ * else goes through the out-of-line slow path.
+ */
+template <typename T>
+inline T ReadMemory(u32 address) {
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8 || sizeof(T) == 16,
+                  "EE memory accesses are 8, 16, 32, 64 or 128 bits wide");
+#if FASTMEM_ENABLED
+    memory_detail::access_t<T> raw;
+    if constexpr (sizeof(T) == 1) {
+        raw = fastmem_read8(address);
+    } else if constexpr (sizeof(T) == 2) {
+        raw = fastmem_read16(address);
+    } else if constexpr (sizeof(T) == 4) {
+        raw = fastmem_read32(address);
+    } else if constexpr (sizeof(T) == 8) {
+        raw = fastmem_read64(address);
+    } else {
+        raw = fastmem_read128(address);
+    }
+    T value;
+    std::memcpy(&value, &raw, sizeof(T));
+    return value;
+#else
+    return memory_detail::read_checked<T>(address);
+#endif
+}
+
+/**
+ * @brief Writes an 8, 16, 32, 64 or 128-bit value to the emulated memory.
+ * @param address Any EE address: RAM and its mirrors, the scratchpad or a device register.
+ * @param value The value to write.
+ */
+template <typename T>
+inline void WriteMemory(u32 address, const T& value) {
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4 || sizeof(T) == 8 || sizeof(T) == 16,
+                  "EE memory accesses are 8, 16, 32, 64 or 128 bits wide");
+#if FASTMEM_ENABLED
+    memory_detail::access_t<T> raw;
+    std::memcpy(&raw, &value, sizeof(T));
+    if constexpr (sizeof(T) == 1) {
+        fastmem_write8(address, raw);
+    } else if constexpr (sizeof(T) == 2) {
+        fastmem_write16(address, raw);
+    } else if constexpr (sizeof(T) == 4) {
+        fastmem_write32(address, raw);
+    } else if constexpr (sizeof(T) == 8) {
+        fastmem_write64(address, raw);
+    } else {
+        fastmem_write128(address, raw);
+    }
+#else
+    memory_detail::write_checked<T>(address, value);
+#endif
+}
+
+/**
+ * @brief Direct scratchpad accesses, emitted by the recompiler where it can prove the
+ * address is inside the scratchpad (see known_constants.h). No translation and no checks.
+ * @param offset Offset from 0x70000000; offset + sizeof(T) must not exceed 16 KB.
+ */
+template <typename T>
+inline T ReadScratchpad(u32 offset) {
+    T value;
+    std::memcpy(&value, scratchpad_memory + offset, sizeof(T));
+    return value;
+}
+
+template <typename T>
+inline void WriteScratchpad(u32 offset, const T& value) {
+    std::memcpy(scratchpad_memory + offset, &value, sizeof(T));
+}
+
+// Fixed-width names used by recompiled code.
+
+/**
+ * @brief Reads a 128-bit (16-byte) value from the emulated memory (LQ).
+ * @param address The 32-bit memory address to read from.
+ * @return The 128-bit value at that address.
+ */
+inline u128 ReadMemory128(u32 address) { return ReadMemory<u128>(address); }
+
+/**
+ * @brief Reads a 64-bit (8-byte) value from the emulated memory.
+ * @param address The 32-bit memory address to read from.
+ * @return The 64-bit value at that address.
+ */
+inline u64 ReadMemory64(u32 address) { return ReadMemory<u64>(address); }
 
 /**
  * @brief Reads a 32-bit (4-byte) value from the emulated memory.
  * @param address The 32-bit memory address to read from.
  * @return The 32-bit value at that address.
  */
-u32 ReadMemory32(u32 address);
+inline u32 ReadMemory32(u32 address) { return ReadMemory<u32>(address); }
 
 /**
  * @brief Reads a 16-bit (2-byte) value from the emulated memory.
- * @param address The 16-bit memory address to read from.
+ * @param address The 32-bit memory address to read from.
  * @return The 16-bit value at that address.
  */
-u16 ReadMemory16(u32 address);
+inline u16 ReadMemory16(u32 address) { return ReadMemory<u16>(address); }
 
 /**
  * @brief Reads a 8-bit (1-byte) value from the emulated memory.
- * @param address The 8-bit memory address to read from.
- * @return The 32-bit value at that address.
+ * @param address The 32-bit memory address to read from.
+ * @return The 8-bit value at that address.
  */
-u8 ReadMemory8(u32 address);
+inline u8 ReadMemory8(u32 address) { return ReadMemory<u8>(address); }
+
+/**
+ * @brief Writes a 128-bit (16-byte) value to the emulated memory (SQ).
+ * @param address The 32-bit memory address to write to.
+ * @param value The 128-bit value to write.
+ */
+inline void WriteMemory128(u32 address, const u128& value) { WriteMemory<u128>(address, value); }
+
+/**
+ * @brief Writes a 64-bit (8-byte) value to the emulated memory.
+ * @param address The 32-bit memory address to write to.
+ * @param value The 64-bit value to write.
+ */
+inline void WriteMemory64(u32 address, u64 value) { WriteMemory<u64>(address, value); }
 
 /**
  * @brief Writes a 32-bit (4-byte) value to the emulated memory.
  * @param address The 32-bit memory address to write to.
  * @param value The 32-bit value to write.
  */
-void WriteMemory32(u32 address, u32 value);
+inline void WriteMemory32(u32 address, u32 value) { WriteMemory<u32>(address, value); }
 
 /**
  * @brief Writes a 16-bit (2-byte) value to the emulated memory.
- * @param address The 16-bit memory address to write to.
+ * @param address The 32-bit memory address to write to.
  * @param value The 16-bit value to write.
  */
-void WriteMemory16(u32 address, u16 value);
+inline void WriteMemory16(u32 address, u16 value) { WriteMemory<u16>(address, value); }
 
 /**
  * @brief Writes a 8-bit (1-byte) value to the emulated memory.
- * @param address The 8-bit memory address to write to.
+ * @param address The 32-bit memory address to write to.
  * @param value The 8-bit value to write.
  */
-void WriteMemory8(u32 address, u8 value);
+inline void WriteMemory8(u32 address, u8 value) { WriteMemory<u8>(address, value); }
 
-// TODO: Add declarations for ReadMemory16, WriteMemory16, ReadMemory8, WriteMemory8
-// as you find you need them for instructions like LB, SB, LH, SH etc.
+// Every accessor takes any EE virtual address: RAM and its mirrors, the scratchpad, or a
+// device register (through the MMIO handlers). Anything else is fatal.
 
@@ -0,0 +1,110 @@
+#include <benchmark/benchmark.h>
+#include "memory.h"
+#include <iostream>
+
+// Compares the guest memory accessors: the original out-of-line byte-by-byte versions
+// (reproduced below as the baseline), the inline single-compare path and fastmem.
+
+namespace {
+
+[[gnu::noinline]] u32 legacy_read32(u32 address) {
+    if (address > (main_memory.size() - 4)) {
+        std::cerr << "FATAL_ERROR: Out-of-bounds memory read." << std::endl;
+        exit(1);
+    }
+    u32 val = 0;
+    val |= (u32)main_memory[address];
+    val |= (u32)main_memory[address + 1] << 8;
+    val |= (u32)main_memory[address + 2] << 16;
+    val |= (u32)main_memory[address + 3] << 24;
+    return val;
+}
+
+[[gnu::noinline]] void legacy_write32(u32 address, u32 value) {
+    if (address > (main_memory.size() - 4)) {
+        std::cerr << "FATAL_ERROR: Out-of-bounds memory write." << std::endl;
+        exit(1);
+    }
+    main_memory[address] = (u8)value;
+    main_memory[address + 1] = (u8)(value >> 8);
+    main_memory[address + 2] = (u8)(value >> 16);
+    main_memory[address + 3] = (u8)(value >> 24);
+}
+
+// A strided walk over 1 MB of RAM, so the loop measures the accessor and not the cache.
+constexpr u32 WINDOW = 1024 * 1024;
+constexpr u32 STRIDE = 68;
+
+template <u32 (*Read)(u32)>
+void read_loop(benchmark::State& state, u32 base) {
+    fastmem_init();
+    u32 offset = 0;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Read(base + offset));
+        offset = (offset + STRIDE) & (WINDOW - 4);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+template <void (*Write)(u32, u32)>
+void write_loop(benchmark::State& state, u32 base) {
+    fastmem_init();
+    u32 offset = 0;
+    for (auto _ : state) {
+        Write(base + offset, offset);
+        offset = (offset + STRIDE) & (WINDOW - 4);
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+u32 checked_read32(u32 address) { return memory_detail::read_checked<u32>(address); }
+void checked_write32(u32 address, u32 value) { memory_detail::write_checked<u32>(address, value); }
+u32 template_read32(u32 address) { return ReadMemory<u32>(address); }
+void template_write32(u32 address, u32 value) { WriteMemory<u32>(address, value); }
+
+void BM_Read32_Legacy(benchmark::State& state) { read_loop<legacy_read32>(state, 0); }
+void BM_Read32_SingleCompare(benchmark::State& state) { read_loop<checked_read32>(state, 0); }
+void BM_Read32_SingleCompareKseg0(benchmark::State& state) { read_loop<checked_read32>(state, 0x80000000); }
+void BM_Read32_Default(benchmark::State& state) { read_loop<template_read32>(state, 0x80000000); }
+
+void BM_Write32_Legacy(benchmark::State& state) { write_loop<legacy_write32>(state, 0); }
+void BM_Write32_SingleCompare(benchmark::State& state) { write_loop<checked_write32>(state, 0); }
+void BM_Write32_Default(benchmark::State& state) { write_loop<template_write32>(state, 0x80000000); }
+
+// LQ/SQ used to be four 32-bit accesses.
+void BM_Copy128_Legacy(benchmark::State& state) {
+    fastmem_init();
+    u32 offset = 0;
+    for (auto _ : state) {
+        for (u32 word = 0; word < 16; word += 4) {
+            legacy_write32(WINDOW + offset + word, legacy_read32(offset + word));
+        }
+        offset = (offset + 16) & (WINDOW - 16);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * 16);
+}
+
+void BM_Copy128_Default(benchmark::State& state) {
+    fastmem_init();
+    u32 offset = 0;
+    for (auto _ : state) {
+        WriteMemory<u128>(WINDOW + offset, ReadMemory<u128>(offset));
+        offset = (offset + 16) & (WINDOW - 16);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * 16);
+}
+
+} // namespace
+
+BENCHMARK(BM_Read32_Legacy);
+BENCHMARK(BM_Read32_SingleCompare);
+BENCHMARK(BM_Read32_SingleCompareKseg0);
+BENCHMARK(BM_Read32_Default);
+BENCHMARK(BM_Write32_Legacy);
+BENCHMARK(BM_Write32_SingleCompare);
+BENCHMARK(BM_Write32_Default);
+BENCHMARK(BM_Copy128_Legacy);
+BENCHMARK(BM_Copy128_Default);
@@ -2,9 +2,21 @@
 #include "gtest/gtest.h"
 #include "memory.h" // Include the header for the code we are testing
 
+namespace {
+
+// Accesses go to the address space bound to the test thread.
+class MemoryTest : public ::testing::Test {
+protected:
+    MemoryTest() { EXPECT_TRUE(fastmem_init()); }
+};
+
+using MemoryDeathTest = MemoryTest;
+
+} // namespace
+
 // This is a test fixture, a basic unit test in Google Test.
 // It's named in a "TestSuitName_TestName" format.
-TEST(MemoryTest, ReadWrite32) {
+TEST_F(MemoryTest, ReadWrite32) {
     // 1. Arrange: Define a test value and a test address.
     // Using a value with different bytes helps ensure endianness is correct.
     const u32 test_value = 0xABCD1234;
@@ -21,9 +33,9 @@ TEST(MemoryTest, ReadWrite32) {
 }
 
 // TODO: Add another test for a different address and value to be thorough.
-// TEST(MemoryTest, ReadWrite32_EdgeCase) { ... }
+// TEST_F(MemoryTest, ReadWrite32_EdgeCase) { ... }
 
-TEST(MemoryDeathTest, WriteOutOfBounds){
+TEST_F(MemoryDeathTest, WriteOutOfBounds){
     const u32 out_of_bounds_memory = main_memory.size() - 3;
     const u32 test_value = 0xABCD1234;
 
@@ -32,14 +44,48 @@ TEST(MemoryDeathTest, WriteOutOfBounds){
     }, "Out-of-bounds memory write");
 }
 
-TEST(MemoryDeathTest, ReadOutOfBounds){
+TEST_F(MemoryDeathTest, ReadOutOfBounds){
     const u32 out_of_bounds_memory = main_memory.size() - 3;
 
     ASSERT_DEATH({
         ReadMemory32(out_of_bounds_memory);
-    }, "Out-of-bounds memory write");
+    }, "Out-of-bounds memory read");
+}
+
+TEST_F(MemoryTest, ReadWrite16) {
+    // 1. Arrange: the last halfword of RAM, which the old size - 4 check refused.
+    const u32 test_address = main_memory.size() - 2;
+
+    // 2. Act
+    WriteMemory16(test_address, 0xBEEF);
+
+    // 3. Assert: little-endian, the same as the EE.
+    EXPECT_EQ(ReadMemory16(test_address), 0xBEEF);
+    EXPECT_EQ(main_memory[test_address], 0xEF);
+    EXPECT_EQ(main_memory[test_address + 1], 0xBE);
+}
+
+TEST_F(MemoryTest, ReadWrite8AtLastByte) {
+    const u32 test_address = main_memory.size() - 1;
+
+    WriteMemory8(test_address, 0x5A);
+
+    EXPECT_EQ(ReadMemory8(test_address), 0x5A);
 }
 
-// TODO: Once you implement WriteMemory16 and ReadMemory16, add a test for them.
-// TEST(MemoryTest, ReadWrite16) { ... }
+TEST_F(MemoryTest, WideAndTypedAccessesThroughMirrors) {
+    u128 quad;
+    quad.UD[0] = 0x0011223344556677ull;
+    quad.UD[1] = 0x8899AABBCCDDEEFFull;
+
+    WriteMemory128(0x80002000, quad);        // KSEG0
+    WriteMemory<float>(0x00002010, 1.5f);
+
+    u128 back = ReadMemory128(0xA0002000);   // KSEG1
+    EXPECT_EQ(back.UD[0], quad.UD[0]);
+    EXPECT_EQ(back.UD[1], quad.UD[1]);
+    EXPECT_EQ(ReadMemory64(0x20002008), quad.UD[1]);
+    EXPECT_EQ(ReadMemory<s8>(0x00002008), (s8)0xFF);
+    EXPECT_EQ(ReadMemory<float>(0x80002010), 1.5f);
+}
 
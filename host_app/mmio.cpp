@@ -0,0 +1,151 @@
+#include "mmio.h"
+#include <cstring>
+#include <iostream>
+
+MmioRegistry::MmioRegistry()
+    : page_index((SPACE_END - SPACE_START) >> PAGE_SHIFT, 0), pages(1, Page{}), handlers(1) {
+}
+
+void MmioRegistry::add(u32 start, u32 end, const MmioHandlers& entry) {
+    if (start < SPACE_START || end > SPACE_END || start >= end || ((start | end) & ((1u << SLOT_SHIFT) - 1))) {
+        std::cerr << "FATAL_ERROR: Bad MMIO range 0x" << std::hex << start << "-0x" << end << std::endl;
+        exit(1);
+    }
+    if (handlers.size() > 0xFF) {
+        std::cerr << "FATAL_ERROR: Too many MMIO handlers." << std::endl;
+        exit(1);
+    }
+    const u8 id = (u8)handlers.size();
+    handlers.push_back(entry);
+
+    for (u32 address = start; address < end; address += 1u << SLOT_SHIFT) {
+        u16& page = page_index[(address - SPACE_START) >> PAGE_SHIFT];
+        if (page == 0) {
+            page = (u16)pages.size();
+            pages.push_back(Page{});
+        }
+        pages[page].slots[(address >> SLOT_SHIFT) & (SLOTS_PER_PAGE - 1)] = id;
+    }
+}
+
+void MmioRegistry::add_latch(u32 start, u32 end) {
+    latches.push_back(std::unique_ptr<Latch>(new Latch{ start, std::vector<u8>(end - start) }));
+    add(start, end, MmioHandlers{ latches.back().get(), &latch_read32, &latch_write32, &latch_read64, &latch_write64 });
+}
+
+const MmioHandlers* MmioRegistry::find(u32 address) const {
+    if (address < SPACE_START || address >= SPACE_END) {
+        return nullptr;
+    }
+    const Page& page = pages[page_index[(address - SPACE_START) >> PAGE_SHIFT]];
+    const u8 id = page.slots[(address >> SLOT_SHIFT) & (SLOTS_PER_PAGE - 1)];
+    return id ? &handlers[id] : nullptr;
+}
+
+bool MmioRegistry::read(u32 address, u32 size, void* value) const {
+    const MmioHandlers* h = find(address);
+    if (!h || !h->read32) {
+        return false;
+    }
+
+    switch (size) {
+        case 1:
+        case 2: {
+            const u32 word = h->read32(h->user, address & ~3u) >> ((address & 3) * 8);
+            std::memcpy(value, &word, size);
+            return true;
+        }
+        case 4: {
+            const u32 word = h->read32(h->user, address);
+            std::memcpy(value, &word, 4);
+            return true;
+        }
+        default: {
+            // 64/128-bit: 64-bit handler if there is one, otherwise word by word.
+            u8* out = static_cast<u8*>(value);
+            for (u32 done = 0; done < size; ) {
+                if (h->read64) {
+                    const u64 dword = h->read64(h->user, address + done);
+                    std::memcpy(out + done, &dword, 8);
+                    done += 8;
+                } else {
+                    const u32 word = h->read32(h->user, address + done);
+                    std::memcpy(out + done, &word, 4);
+                    done += 4;
+                }
+            }
+            return true;
+        }
+    }
+}
+
+bool MmioRegistry::write(u32 address, u32 size, const void* value) const {
+    const MmioHandlers* h = find(address);
+    if (!h || !h->write32) {
+        return false;
+    }
+
+    switch (size) {
+        case 1:
+        case 2: {
+            const u32 aligned = address & ~3u;
+            const u32 shift = (address & 3) * 8;
+            const u32 mask = (size == 1 ? 0xFFu : 0xFFFFu) << shift;
+            u32 part = 0;
+            std::memcpy(&part, value, size);
+            const u32 old = h->read32 ? h->read32(h->user, aligned) : 0;
+            const u32 commands = h->command_bits ? h->command_bits(aligned) : 0;
+            h->write32(h->user, aligned, (old & ~mask & ~commands) | (part << shift));
+            return true;
+        }
+        case 4: {
+            u32 word;
+            std::memcpy(&word, value, 4);
+            h->write32(h->user, address, word);
+            return true;
+        }
+        default: {
+            const u8* in = static_cast<const u8*>(value);
+            for (u32 done = 0; done < size; ) {
+                if (h->write64) {
+                    u64 dword;
+                    std::memcpy(&dword, in + done, 8);
+                    h->write64(h->user, address + done, dword);
+                    done += 8;
+                } else {
+                    u32 word;
+                    std::memcpy(&word, in + done, 4);
+                    h->write32(h->user, address + done, word);
+                    done += 4;
+                }
+            }
+            return true;
+        }
+    }
+}
+
+// --- Latches ---
+
+u32 MmioRegistry::latch_read32(void* user, u32 address) {
+    const Latch* latch = static_cast<const Latch*>(user);
+    u32 value;
+    std::memcpy(&value, latch->storage.data() + (address - latch->start), 4);
+    return value;
+}
+
+void MmioRegistry::latch_write32(void* user, u32 address, u32 value) {
+    Latch* latch = static_cast<Latch*>(user);
+    std::memcpy(latch->storage.data() + (address - latch->start), &value, 4);
+}
+
+u64 MmioRegistry::latch_read64(void* user, u32 address) {
+    const Latch* latch = static_cast<const Latch*>(user);
+    u64 value;
+    std::memcpy(&value, latch->storage.data() + (address - latch->start), 8);
+    return value;
+}
+
+void MmioRegistry::latch_write64(void* user, u32 address, u64 value) {
+    Latch* latch = static_cast<Latch*>(user);
+    std::memcpy(latch->storage.data() + (address - latch->start), &value, 8);
+}
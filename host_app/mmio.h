@@ -0,0 +1,85 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <memory>
+#include <vector>
+
+// Registry of the EE's memory-mapped registers (0x10000000-0x1FFFFFFF physical). Each
+// subsystem registers typed handlers for the register ranges it owns; fastmem's MMIO
+// path (see fastmem.h) resolves an access with two table lookups: the 4 KB page, then
+// the 16-byte register slot within it.
+//
+// Handlers are 32-bit, with optional 64-bit ones (GS privileged registers). Other widths
+// are built from them: 64/128-bit accesses split into 32-bit ones, and 8/16-bit writes
+// are a read-modify-write of the containing word, which is what SB to CHCR+1 (starting
+// a DMA channel) relies on. Command bits (write-1-to-clear/flip/set, e.g. D_STAT and
+// INTC_STAT) are written as 0 outside the stored bytes instead, so a narrow store does
+// not act on the bits it did not touch.
+
+using MmioRead32 = u32 (*)(void* user, u32 address);
+using MmioWrite32 = void (*)(void* user, u32 address, u32 value);
+using MmioRead64 = u64 (*)(void* user, u32 address);
+using MmioWrite64 = void (*)(void* user, u32 address, u64 value);
+using MmioCommandBits = u32 (*)(u32 address);
+
+struct MmioHandlers {
+    void* user = nullptr;
+    MmioRead32 read32 = nullptr;
+    MmioWrite32 write32 = nullptr;
+    MmioRead64 read64 = nullptr;        // Optional
+    MmioWrite64 write64 = nullptr;      // Optional
+    MmioCommandBits command_bits = nullptr; // Optional: the register's command bits
+};
+
+class MmioRegistry {
+public:
+    static constexpr u32 SPACE_START = 0x10000000;
+    static constexpr u32 SPACE_END = 0x20000000;    // exclusive
+    static constexpr u32 PAGE_SHIFT = 12;
+    static constexpr u32 SLOT_SHIFT = 4;            // Registers are 16 bytes apart
+    static constexpr u32 SLOTS_PER_PAGE = 1u << (PAGE_SHIFT - SLOT_SHIFT);
+
+    MmioRegistry();
+
+    /**
+     * @brief Routes physical [start, end) (16-byte aligned) to `handlers`, replacing
+     * whatever was registered there before.
+     */
+    void add(u32 start, u32 end, const MmioHandlers& handlers);
+
+    /**
+     * @brief Backs [start, end) with plain storage: reads return what was last written.
+     * For register blocks that have no device model yet.
+     */
+    void add_latch(u32 start, u32 end);
+
+    // The handlers for a physical address, or nullptr.
+    const MmioHandlers* find(u32 address) const;
+
+    /**
+     * @brief Performs a 1/2/4/8/16-byte access at a physical address.
+     * @return false if nothing is registered there.
+     */
+    bool read(u32 address, u32 size, void* value) const;
+    bool write(u32 address, u32 size, const void* value) const;
+
+private:
+    struct Page {
+        u8 slots[SLOTS_PER_PAGE];     // Index into handlers, 0 = unmapped
+    };
+
+    struct Latch {
+        u32 start;
+        std::vector<u8> storage;
+    };
+
+    static u32 latch_read32(void* user, u32 address);
+    static void latch_write32(void* user, u32 address, u32 value);
+    static u64 latch_read64(void* user, u32 address);
+    static void latch_write64(void* user, u32 address, u64 value);
+
+    std::vector<u16> page_index;        // One per 4 KB page of the space, 0 = no page
+    std::vector<Page> pages;            // pages[0] is the empty page
+    std::vector<MmioHandlers> handlers; // handlers[0] is unused
+    std::vector<std::unique_ptr<Latch>> latches;
+};
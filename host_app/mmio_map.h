@@ -0,0 +1,48 @@
+#pragma once
+
+#include "cpu_state.h"
+
+// EE register ranges with a device model behind them, and the runtime functions that
+// serve them. Shared by the runtime, which registers them with the MMIO registry (see
+// mmio.h), and by the recompiler, which calls mmio_<name>_read32/_write32 directly
+// when it can prove a load or store hits one of these ranges.
+//
+// X(start, end, name): physical [start, end) is served by mmio_<name>_read32/_write32.
+#define EE_MMIO_ROUTES(X) \
+    X(0x10000000, 0x10002000, timers) \
+    X(0x10002000, 0x10002040, ipu) \
+    X(0x10007000, 0x10007020, ipu) \
+    X(0x10008000, 0x1000F000, dmac) \
+    X(0x1000F000, 0x1000F020, intc) \
+    X(0x1000F200, 0x1000F270, sif) \
+    X(0x1000F520, 0x1000F530, dmac) \
+    X(0x1000F590, 0x1000F5A0, dmac)
+
+struct MmioRoute {
+    u32 start;
+    u32 end;            // exclusive
+    const char* name;
+};
+
+constexpr MmioRoute MMIO_ROUTES[] = {
+#define MMIO_ROUTE_ENTRY(start, end, name) { start, end, #name },
+    EE_MMIO_ROUTES(MMIO_ROUTE_ENTRY)
+#undef MMIO_ROUTE_ENTRY
+};
+
+/**
+ * @brief Finds the device route for a virtual address in the fixed layout (the
+ * identity-mapped register space or its KSEG0/KSEG1 windows).
+ * @return nullptr if no modelled device sits there.
+ */
+inline const MmioRoute* find_mmio_route(u32 address) {
+    if (address >= 0x80000000 && address < 0xC0000000) {
+        address &= 0x1FFFFFFF;
+    }
+    for (const MmioRoute& route : MMIO_ROUTES) {
+        if (address >= route.start && address < route.end) {
+            return &route;
+        }
+    }
+    return nullptr;
+}
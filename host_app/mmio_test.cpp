@@ -0,0 +1,162 @@
+#include "gtest/gtest.h"
+#include "mmio.h"
+#include "dmac.h"
+#include "intc.h"
+#include <vector>
+
+namespace {
+
+// A device with a bank of plain 32-bit registers that logs every access.
+struct Device {
+    u32 regs[64] = {};
+    std::vector<u32> writes;
+    u32 base;
+
+    static u32 read32(void* user, u32 address) {
+        Device* d = static_cast<Device*>(user);
+        return d->regs[(address - d->base) / 4];
+    }
+
+    static void write32(void* user, u32 address, u32 value) {
+        Device* d = static_cast<Device*>(user);
+        d->writes.push_back(address);
+        d->regs[(address - d->base) / 4] = value;
+    }
+};
+
+// Routes the registry to a device model's own read32/write32.
+template <typename Model>
+u32 model_read32(void* user, u32 address) {
+    return static_cast<Model*>(user)->read32(address);
+}
+
+template <typename Model>
+void model_write32(void* user, u32 address, u32 value) {
+    static_cast<Model*>(user)->write32(address, value);
+}
+
+class MmioTest : public ::testing::Test {
+protected:
+    MmioTest() {
+        dmac.base = 0x1000F520;
+        intc.base = 0x1000F000;
+        registry.add(0x1000F000, 0x1000F020, MmioHandlers{ &intc, &Device::read32, &Device::write32 });
+        registry.add(0x1000F520, 0x1000F530, MmioHandlers{ &dmac, &Device::read32, &Device::write32 });
+    }
+
+    MmioRegistry registry;
+    Device intc;
+    Device dmac;
+};
+
+} // namespace
+
+TEST_F(MmioTest, RegistersInOnePageGoToTheirOwnHandlers) {
+    // 1. Arrange
+    const u32 value = 0x1234;
+
+    // 2. Act
+    ASSERT_TRUE(registry.write(0x1000F010, 4, &value));
+    ASSERT_TRUE(registry.write(0x1000F520, 4, &value));
+
+    // 3. Assert: both live in the 0x1000F000 page, one slot lookup apart.
+    EXPECT_EQ(intc.regs[4], 0x1234u);
+    EXPECT_EQ(dmac.regs[0], 0x1234u);
+    EXPECT_EQ(registry.find(0x1000F010)->user, &intc);
+    EXPECT_EQ(registry.find(0x1000F524)->user, &dmac);
+    EXPECT_EQ(registry.find(0x1000F100), nullptr);
+
+    u32 out = 0;
+    EXPECT_FALSE(registry.read(0x1000F100, 4, &out));
+    EXPECT_FALSE(registry.read(0x00100000, 4, &out));
+}
+
+TEST_F(MmioTest, NarrowAccessesUseTheContainingWord) {
+    intc.regs[0] = 0x11223344;
+
+    u8 byte = 0;
+    u16 half = 0;
+    ASSERT_TRUE(registry.read(0x1000F001, 1, &byte));
+    ASSERT_TRUE(registry.read(0x1000F002, 2, &half));
+    EXPECT_EQ(byte, 0x33);
+    EXPECT_EQ(half, 0x1122);
+
+    // SB to byte 1 (e.g. CHCR.STR) keeps the other bytes.
+    const u8 start = 0x01;
+    ASSERT_TRUE(registry.write(0x1000F001, 1, &start));
+    EXPECT_EQ(intc.regs[0], 0x11220144u);
+    EXPECT_EQ(intc.writes.back(), 0x1000F000u);
+}
+
+TEST_F(MmioTest, WideAccessesSplitIntoWords) {
+    const u64 value = 0xAAAABBBBCCCCDDDDull;
+    ASSERT_TRUE(registry.write(0x1000F008, 8, &value));
+
+    EXPECT_EQ(intc.regs[2], 0xCCCCDDDDu);
+    EXPECT_EQ(intc.regs[3], 0xAAAABBBBu);
+    EXPECT_EQ(intc.writes.size(), 2u);
+}
+
+TEST_F(MmioTest, LatchesHoldWrittenValues) {
+    registry.add_latch(0x12000000, 0x12002000);
+
+    const u64 csr = 0x0000000500000008ull;
+    ASSERT_TRUE(registry.write(0x12001000, 8, &csr));
+
+    u64 back = 0;
+    u32 low = 0;
+    ASSERT_TRUE(registry.read(0x12001000, 8, &back));
+    ASSERT_TRUE(registry.read(0x12001000, 4, &low));
+    EXPECT_EQ(back, csr);
+    EXPECT_EQ(low, 8u);
+
+    // A later registration takes over part of a latch.
+    registry.add(0x12001000, 0x12001010, MmioHandlers{ &dmac, &Device::read32, &Device::write32 });
+    EXPECT_EQ(registry.find(0x12001000)->user, &dmac);
+    EXPECT_NE(registry.find(0x12000FF0)->user, &dmac);
+}
+
+TEST(MmioCommandTest, NarrowStoresToDStatLeaveOtherBytesAlone) {
+    // 1. Arrange: GIF status and the VIF0 and GIF mask bits set.
+    Dmac dmac(DmaMemory{});
+    MmioRegistry registry;
+    registry.add(Dmac::D_CTRL, Dmac::D_STADR + 0x10, MmioHandlers{ &dmac, &model_read32<Dmac>, &model_write32<Dmac>,
+                                                                   nullptr, nullptr, &Dmac::command_bits });
+    dmac.write32(Dmac::D_CTRL, 1);
+    dmac.write32(0x1000A020, 0);                    // GIF QWC
+    dmac.write32(0x1000A000, chcr::STR | chcr::DIR);
+    dmac.complete(DMAC_GIF);
+    dmac.write32(Dmac::D_STAT, (1u << (16 + DMAC_VIF0)) | (1u << (16 + DMAC_GIF)));
+
+    // 2. Act: SB flipping the VIF0 mask bit, then SB acknowledging GIF.
+    const u8 flip = 1u << DMAC_VIF0;
+    const u8 clear = 1u << DMAC_GIF;
+    ASSERT_TRUE(registry.write(Dmac::D_STAT + 2, 1, &flip));
+    const u32 flipped = dmac.read32(Dmac::D_STAT);
+    ASSERT_TRUE(registry.write(Dmac::D_STAT, 1, &clear));
+
+    // 3. Assert: each store acted only on its own bits.
+    EXPECT_EQ(flipped, (1u << DMAC_GIF) | (1u << (16 + DMAC_GIF)));
+    EXPECT_EQ(dmac.read32(Dmac::D_STAT), 1u << (16 + DMAC_GIF));
+}
+
+TEST(MmioCommandTest, NarrowStoresToIntcLeaveOtherBytesAlone) {
+    // 1. Arrange: a line in each of the low two bytes, pending and unmasked.
+    Intc intc;
+    MmioRegistry registry;
+    registry.add(Intc::INTC_STAT, Intc::INTC_MASK + 0x10, MmioHandlers{ &intc, &model_read32<Intc>, &model_write32<Intc>,
+                                                                        nullptr, nullptr, &Intc::command_bits });
+    const u32 lines = (1u << INTC_VBLANK_START) | (1u << INTC_TIMER0);
+    intc.raise(INTC_VBLANK_START);
+    intc.raise(INTC_TIMER0);
+    intc.write32(Intc::INTC_MASK, lines);
+
+    // 2. Act: SB to byte 0 of each, for VBLANK_START only.
+    const u8 vblank = 1u << INTC_VBLANK_START;
+    ASSERT_TRUE(registry.write(Intc::INTC_MASK, 1, &vblank));
+    ASSERT_TRUE(registry.write(Intc::INTC_STAT, 1, &vblank));
+
+    // 3. Assert: TIMER0, in byte 1, is still pending and unmasked.
+    EXPECT_EQ(intc.read32(Intc::INTC_MASK), 1u << INTC_TIMER0);
+    EXPECT_EQ(intc.read32(Intc::INTC_STAT), 1u << INTC_TIMER0);
+}
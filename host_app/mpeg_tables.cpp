@@ -0,0 +1,256 @@
+#include "mpeg_tables.h"
+#include <algorithm>
+#include <iostream>
+
+VlcTable::VlcTable(std::initializer_list<VlcCode> codes) : entries(1u << PRIMARY_BITS), code_list(codes) {
+    struct Parsed {
+        u32 code;
+        u32 length;
+        const VlcCode* source;
+    };
+    std::vector<Parsed> parsed;
+    u8 sub_bits[1u << PRIMARY_BITS] = {};
+    bool valid = true;
+    for (const VlcCode& code : code_list) {
+        Parsed p{ 0, 0, &code };
+        for (const char* c = code.bits; *c; c++) {
+            if (*c == '0' || *c == '1') {
+                p.code = (p.code << 1) | (u32)(*c - '0');
+                p.length++;
+            }
+        }
+        valid = valid && p.length > 0 && p.length <= MAX_BITS;
+        if (p.length > PRIMARY_BITS) {
+            u8& bits = sub_bits[p.code >> (p.length - PRIMARY_BITS)];
+            bits = std::max<u8>(bits, (u8)(p.length - PRIMARY_BITS));
+        }
+        parsed.push_back(p);
+    }
+
+    for (u32 prefix = 0; prefix < (1u << PRIMARY_BITS); prefix++) {
+        if (sub_bits[prefix]) {
+            entries[prefix] = VlcEntry{ (s16)entries.size(), 0, 0, sub_bits[prefix] };
+            entries.resize(entries.size() + (1u << sub_bits[prefix]));
+        }
+    }
+
+    // Each code fills every slot whose index starts with it; a slot filled twice means
+    // one code is a prefix of another.
+    for (const Parsed& p : parsed) {
+        if (!valid) {
+            break;
+        }
+        u32 first;
+        u32 count;
+        if (p.length <= PRIMARY_BITS) {
+            first = p.code << (PRIMARY_BITS - p.length);
+            count = 1u << (PRIMARY_BITS - p.length);
+        } else {
+            const VlcEntry& primary = entries[p.code >> (p.length - PRIMARY_BITS)];
+            const u32 rest_bits = p.length - PRIMARY_BITS;
+            const u32 rest = p.code & ((1u << rest_bits) - 1);
+            first = (u16)primary.value + (rest << (primary.sub_bits - rest_bits));
+            count = 1u << (primary.sub_bits - rest_bits);
+        }
+        for (u32 i = first; i < first + count; i++) {
+            if (entries[i].length || entries[i].sub_bits) {
+                valid = false;
+                break;
+            }
+            entries[i] = VlcEntry{ p.source->value, p.source->level, (u8)p.length, 0 };
+        }
+    }
+
+    if (!valid) {
+        std::cerr << "FATAL_ERROR: Malformed VLC table." << std::endl;
+        exit(1);
+    }
+}
+
+namespace mpeg {
+
+const VlcTable ADDRESS_INCREMENT{
+    { "1", 1, 0 }, { "011", 2, 0 }, { "010", 3, 0 }, { "0011", 4, 0 }, { "0010", 5, 0 },
+    { "0001 1", 6, 0 }, { "0001 0", 7, 0 }, { "0000 111", 8, 0 }, { "0000 110", 9, 0 },
+    { "0000 1011", 10, 0 }, { "0000 1010", 11, 0 }, { "0000 1001", 12, 0 }, { "0000 1000", 13, 0 },
+    { "0000 0111", 14, 0 }, { "0000 0110", 15, 0 },
+    { "0000 0101 11", 16, 0 }, { "0000 0101 10", 17, 0 }, { "0000 0101 01", 18, 0 }, { "0000 0101 00", 19, 0 },
+    { "0000 0100 11", 20, 0 }, { "0000 0100 10", 21, 0 },
+    { "0000 0100 011", 22, 0 }, { "0000 0100 010", 23, 0 }, { "0000 0100 001", 24, 0 }, { "0000 0100 000", 25, 0 },
+    { "0000 0011 111", 26, 0 }, { "0000 0011 110", 27, 0 }, { "0000 0011 101", 28, 0 }, { "0000 0011 100", 29, 0 },
+    { "0000 0011 011", 30, 0 }, { "0000 0011 010", 31, 0 }, { "0000 0011 001", 32, 0 }, { "0000 0011 000", 33, 0 },
+    { "0000 0001 111", MBA_STUFFING, 0 }, { "0000 0001 000", MBA_ESCAPE, 0 },
+};
+
+const VlcTable MB_TYPE_I{
+    { "1", MB_INTRA, 0 },
+    { "01", MB_QUANT | MB_INTRA, 0 },
+};
+
+const VlcTable MB_TYPE_P{
+    { "1", MB_FORWARD | MB_PATTERN, 0 },
+    { "01", MB_PATTERN, 0 },
+    { "001", MB_FORWARD, 0 },
+    { "0001 1", MB_INTRA, 0 },
+    { "0001 0", MB_QUANT | MB_FORWARD | MB_PATTERN, 0 },
+    { "0000 1", MB_QUANT | MB_PATTERN, 0 },
+    { "0000 01", MB_QUANT | MB_INTRA, 0 },
+};
+
+const VlcTable MB_TYPE_B{
+    { "10", MB_FORWARD | MB_BACKWARD, 0 },
+    { "11", MB_FORWARD | MB_BACKWARD | MB_PATTERN, 0 },
+    { "010", MB_BACKWARD, 0 },
+    { "011", MB_BACKWARD | MB_PATTERN, 0 },
+    { "0010", MB_FORWARD, 0 },
+    { "0011", MB_FORWARD | MB_PATTERN, 0 },
+    { "0001 1", MB_INTRA, 0 },
+    { "0001 0", MB_QUANT | MB_FORWARD | MB_BACKWARD | MB_PATTERN, 0 },
+    { "0000 11", MB_QUANT | MB_FORWARD | MB_PATTERN, 0 },
+    { "0000 10", MB_QUANT | MB_BACKWARD | MB_PATTERN, 0 },
+    { "0000 01", MB_QUANT | MB_INTRA, 0 },
+};
+
+const VlcTable MB_TYPE_D{
+    { "1", MB_INTRA, 0 },
+};
+
+const VlcTable CODED_BLOCK_PATTERN{
+    { "111", 60, 0 }, { "1101", 4, 0 }, { "1100", 8, 0 }, { "1011", 16, 0 }, { "1010", 32, 0 },
+    { "1001 1", 12, 0 }, { "1001 0", 48, 0 }, { "1000 1", 20, 0 }, { "1000 0", 40, 0 },
+    { "0111 1", 28, 0 }, { "0111 0", 44, 0 }, { "0110 1", 52, 0 }, { "0110 0", 56, 0 },
+    { "0101 1", 1, 0 }, { "0101 0", 61, 0 }, { "0100 1", 2, 0 }, { "0100 0", 62, 0 },
+    { "0011 11", 24, 0 }, { "0011 10", 36, 0 }, { "0011 01", 3, 0 }, { "0011 00", 63, 0 },
+    { "0010 111", 5, 0 }, { "0010 110", 9, 0 }, { "0010 101", 17, 0 }, { "0010 100", 33, 0 },
+    { "0010 011", 6, 0 }, { "0010 010", 10, 0 }, { "0010 001", 18, 0 }, { "0010 000", 34, 0 },
+    { "0001 1111", 7, 0 }, { "0001 1110", 11, 0 }, { "0001 1101", 19, 0 }, { "0001 1100", 35, 0 },
+    { "0001 1011", 13, 0 }, { "0001 1010", 49, 0 }, { "0001 1001", 21, 0 }, { "0001 1000", 41, 0 },
+    { "0001 0111", 14, 0 }, { "0001 0110", 50, 0 }, { "0001 0101", 22, 0 }, { "0001 0100", 42, 0 },
+    { "0001 0011", 15, 0 }, { "0001 0010", 51, 0 }, { "0001 0001", 23, 0 }, { "0001 0000", 43, 0 },
+    { "0000 1111", 25, 0 }, { "0000 1110", 37, 0 }, { "0000 1101", 26, 0 }, { "0000 1100", 38, 0 },
+    { "0000 1011", 29, 0 }, { "0000 1010", 45, 0 }, { "0000 1001", 53, 0 }, { "0000 1000", 57, 0 },
+    { "0000 0111", 30, 0 }, { "0000 0110", 46, 0 }, { "0000 0101", 54, 0 }, { "0000 0100", 58, 0 },
+    { "0000 0011 1", 31, 0 }, { "0000 0011 0", 47, 0 }, { "0000 0010 1", 55, 0 }, { "0000 0010 0", 59, 0 },
+    { "0000 0001 1", 27, 0 }, { "0000 0001 0", 39, 0 }, { "0000 0000 1", 0, 0 },
+};
+
+const VlcTable MOTION_CODE{
+    { "1", 0, 0 }, { "01", 1, 0 }, { "001", 2, 0 }, { "0001", 3, 0 },
+    { "0000 11", 4, 0 }, { "0000 101", 5, 0 }, { "0000 100", 6, 0 }, { "0000 011", 7, 0 },
+    { "0000 0101 1", 8, 0 }, { "0000 0101 0", 9, 0 }, { "0000 0100 1", 10, 0 },
+    { "0000 0100 01", 11, 0 }, { "0000 0100 00", 12, 0 }, { "0000 0011 11", 13, 0 },
+    { "0000 0011 10", 14, 0 }, { "0000 0011 01", 15, 0 }, { "0000 0011 00", 16, 0 },
+};
+
+const VlcTable DMVECTOR{
+    { "0", 0, 0 }, { "10", 1, 0 }, { "11", -1, 0 },
+};
+
+const VlcTable DC_SIZE_LUMA{
+    { "100", 0, 0 }, { "00", 1, 0 }, { "01", 2, 0 }, { "101", 3, 0 }, { "110", 4, 0 }, { "1110", 5, 0 },
+    { "1111 0", 6, 0 }, { "1111 10", 7, 0 }, { "1111 110", 8, 0 }, { "1111 1110", 9, 0 },
+    { "1111 1111 0", 10, 0 }, { "1111 1111 1", 11, 0 },
+};
+
+const VlcTable DC_SIZE_CHROMA{
+    { "00", 0, 0 }, { "01", 1, 0 }, { "10", 2, 0 }, { "110", 3, 0 }, { "1110", 4, 0 }, { "1111 0", 5, 0 },
+    { "1111 10", 6, 0 }, { "1111 110", 7, 0 }, { "1111 1110", 8, 0 }, { "1111 1111 0", 9, 0 },
+    { "1111 1111 10", 10, 0 }, { "1111 1111 11", 11, 0 },
+};
+
+// The codes both coefficient tables share: everything of 10 bits and more, except what
+// B.15 moved to shorter codes.
+#define MPEG_DCT_LONG_CODES \
+    { "0000 0001 1100", 3, 3 }, { "0000 0001 0010", 4, 3 }, { "0000 0001 1110", 6, 2 }, \
+    { "0000 0001 0101", 7, 2 }, { "0000 0001 0001", 8, 2 }, { "0000 0001 1111", 17, 1 }, \
+    { "0000 0001 1010", 18, 1 }, { "0000 0001 1001", 19, 1 }, { "0000 0001 0111", 20, 1 }, \
+    { "0000 0001 0110", 21, 1 }, \
+    { "0000 0000 1011 0", 1, 6 }, { "0000 0000 1010 1", 1, 7 }, { "0000 0000 1010 0", 2, 5 }, \
+    { "0000 0000 1001 1", 3, 4 }, { "0000 0000 1001 0", 5, 3 }, { "0000 0000 1000 1", 9, 2 }, \
+    { "0000 0000 1000 0", 10, 2 }, { "0000 0000 1111 1", 22, 1 }, { "0000 0000 1111 0", 23, 1 }, \
+    { "0000 0000 1110 1", 24, 1 }, { "0000 0000 1110 0", 25, 1 }, { "0000 0000 1101 1", 26, 1 }, \
+    { "0000 0000 0111 11", 0, 16 }, { "0000 0000 0111 10", 0, 17 }, { "0000 0000 0111 01", 0, 18 }, \
+    { "0000 0000 0111 00", 0, 19 }, { "0000 0000 0110 11", 0, 20 }, { "0000 0000 0110 10", 0, 21 }, \
+    { "0000 0000 0110 01", 0, 22 }, { "0000 0000 0110 00", 0, 23 }, { "0000 0000 0101 11", 0, 24 }, \
+    { "0000 0000 0101 10", 0, 25 }, { "0000 0000 0101 01", 0, 26 }, { "0000 0000 0101 00", 0, 27 }, \
+    { "0000 0000 0100 11", 0, 28 }, { "0000 0000 0100 10", 0, 29 }, { "0000 0000 0100 01", 0, 30 }, \
+    { "0000 0000 0100 00", 0, 31 }, \
+    { "0000 0000 0011 000", 0, 32 }, { "0000 0000 0010 111", 0, 33 }, { "0000 0000 0010 110", 0, 34 }, \
+    { "0000 0000 0010 101", 0, 35 }, { "0000 0000 0010 100", 0, 36 }, { "0000 0000 0010 011", 0, 37 }, \
+    { "0000 0000 0010 010", 0, 38 }, { "0000 0000 0010 001", 0, 39 }, { "0000 0000 0010 000", 0, 40 }, \
+    { "0000 0000 0011 111", 1, 8 }, { "0000 0000 0011 110", 1, 9 }, { "0000 0000 0011 101", 1, 10 }, \
+    { "0000 0000 0011 100", 1, 11 }, { "0000 0000 0011 011", 1, 12 }, { "0000 0000 0011 010", 1, 13 }, \
+    { "0000 0000 0011 001", 1, 14 }, \
+    { "0000 0000 0001 0011", 1, 15 }, { "0000 0000 0001 0010", 1, 16 }, { "0000 0000 0001 0001", 1, 17 }, \
+    { "0000 0000 0001 0000", 1, 18 }, { "0000 0000 0001 0100", 6, 3 }, { "0000 0000 0001 1010", 11, 2 }, \
+    { "0000 0000 0001 1001", 12, 2 }, { "0000 0000 0001 1000", 13, 2 }, { "0000 0000 0001 0111", 14, 2 }, \
+    { "0000 0000 0001 0110", 15, 2 }, { "0000 0000 0001 0101", 16, 2 }, { "0000 0000 0001 1111", 27, 1 }, \
+    { "0000 0000 0001 1110", 28, 1 }, { "0000 0000 0001 1101", 29, 1 }, { "0000 0000 0001 1100", 30, 1 }, \
+    { "0000 0000 0001 1011", 31, 1 }
+
+const VlcTable DCT_COEFFICIENTS_0{
+    { "10", DCT_END_OF_BLOCK, 0 }, { "0000 01", DCT_ESCAPE, 0 },
+    { "11", 0, 1 }, { "011", 1, 1 }, { "0100", 0, 2 }, { "0101", 2, 1 },
+    { "0010 1", 0, 3 }, { "0011 1", 3, 1 }, { "0011 0", 4, 1 },
+    { "0001 10", 1, 2 }, { "0001 11", 5, 1 }, { "0001 01", 6, 1 }, { "0001 00", 7, 1 },
+    { "0000 110", 0, 4 }, { "0000 100", 2, 2 }, { "0000 111", 8, 1 }, { "0000 101", 9, 1 },
+    { "0010 0110", 0, 5 }, { "0010 0001", 0, 6 }, { "0010 0101", 1, 3 }, { "0010 0100", 3, 2 },
+    { "0010 0111", 10, 1 }, { "0010 0011", 11, 1 }, { "0010 0010", 12, 1 }, { "0010 0000", 13, 1 },
+    { "0000 0010 10", 0, 7 }, { "0000 0011 00", 1, 4 }, { "0000 0010 11", 2, 3 },
+    { "0000 0011 11", 4, 2 }, { "0000 0010 01", 5, 2 }, { "0000 0011 10", 14, 1 },
+    { "0000 0011 01", 15, 1 }, { "0000 0010 00", 16, 1 },
+    { "0000 0001 1101", 0, 8 }, { "0000 0001 1000", 0, 9 }, { "0000 0001 0011", 0, 10 },
+    { "0000 0001 0000", 0, 11 }, { "0000 0001 1011", 1, 5 }, { "0000 0001 0100", 2, 4 },
+    { "0000 0000 1101 0", 0, 12 }, { "0000 0000 1100 1", 0, 13 }, { "0000 0000 1100 0", 0, 14 },
+    { "0000 0000 1011 1", 0, 15 },
+    MPEG_DCT_LONG_CODES,
+};
+
+const VlcTable DCT_COEFFICIENTS_1{
+    { "0110", DCT_END_OF_BLOCK, 0 }, { "0000 01", DCT_ESCAPE, 0 },
+    { "10", 0, 1 }, { "010", 1, 1 }, { "110", 0, 2 }, { "0010 1", 2, 1 }, { "0111", 0, 3 },
+    { "0011 1", 3, 1 }, { "0001 10", 4, 1 }, { "0011 0", 1, 2 }, { "0001 11", 5, 1 },
+    { "0000 110", 6, 1 }, { "0000 100", 7, 1 }, { "1110 0", 0, 4 }, { "0000 111", 2, 2 },
+    { "0000 101", 8, 1 }, { "1111 000", 9, 1 }, { "1110 1", 0, 5 }, { "0001 01", 0, 6 },
+    { "1111 001", 1, 3 }, { "0010 0110", 3, 2 }, { "1111 010", 10, 1 }, { "0010 0001", 11, 1 },
+    { "0010 0101", 12, 1 }, { "0010 0100", 13, 1 }, { "0001 00", 0, 7 }, { "0010 0111", 1, 4 },
+    { "1111 1100", 2, 3 }, { "1111 1101", 4, 2 }, { "0000 0010 0", 5, 2 }, { "0000 0010 1", 14, 1 },
+    { "0000 0011 1", 15, 1 }, { "0000 0011 01", 16, 1 }, { "1111 011", 0, 8 }, { "1111 100", 0, 9 },
+    { "0010 0011", 0, 10 }, { "0010 0010", 0, 11 }, { "0010 0000", 1, 5 }, { "0000 0011 00", 2, 4 },
+    { "1111 1010", 0, 12 }, { "1111 1011", 0, 13 }, { "1111 1110", 0, 14 }, { "1111 1111", 0, 15 },
+    MPEG_DCT_LONG_CODES,
+};
+
+#undef MPEG_DCT_LONG_CODES
+
+const u8 ZIGZAG_SCAN[64] = {
+     0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+const u8 ALTERNATE_SCAN[64] = {
+     0,  8, 16, 24,  1,  9,  2, 10, 17, 25, 32, 40, 48, 56, 57, 49,
+    41, 33, 26, 18,  3, 11,  4, 12, 19, 27, 34, 42, 50, 58, 35, 43,
+    51, 59, 20, 28,  5, 13,  6, 14, 21, 29, 36, 44, 52, 60, 37, 45,
+    53, 61, 22, 30,  7, 15, 23, 31, 38, 46, 54, 62, 39, 47, 55, 63,
+};
+
+const u8 NON_LINEAR_QUANTISER_SCALE[32] = {
+     0,  1,  2,  3,  4,  5,  6,  7,  8, 10, 12, 14, 16, 18, 20, 22,
+    24, 28, 32, 36, 40, 44, 48, 52, 56, 64, 72, 80, 88, 96, 104, 112,
+};
+
+const u8 DEFAULT_INTRA_MATRIX[64] = {
+     8, 16, 19, 22, 26, 27, 29, 34,
+    16, 16, 22, 24, 27, 29, 34, 37,
+    19, 22, 26, 27, 29, 34, 34, 38,
+    22, 22, 26, 27, 29, 34, 37, 40,
+    22, 26, 27, 29, 32, 35, 40, 48,
+    26, 27, 29, 32, 35, 40, 48, 58,
+    26, 27, 29, 34, 38, 46, 56, 69,
+    27, 29, 35, 38, 46, 56, 69, 83,
+};
+
+} // namespace mpeg
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <initializer_list>
+#include <vector>
+
+// The fixed tables of MPEG-1/2 video (ISO/IEC 13818-2) that the IPU has in hardware: the
+// variable-length codes of Annex B, the scan orders and the quantiser scales.
+//
+// A VLC table is built once from its code list into two levels. The first PRIMARY_BITS
+// bits of the stream index a flat table that resolves every short code in one step; the
+// few longer codes, which all start with a run of zeros, go through a small second table
+// under their prefix. Every table is looked up with the next MAX_BITS bits, so decoding
+// a code is one peek, at most two loads and one skip.
+
+struct VlcCode {
+    const char* bits;   // e.g. "0000 11"; spaces are ignored
+    s16 value;
+    s16 level;          // DCT coefficient tables only
+};
+
+struct VlcEntry {
+    s16 value;          // Or, when sub_bits is set, where the second-level table starts
+    s16 level;
+    u8 length;          // Bits the code takes; 0 if the stream holds no valid code here
+    u8 sub_bits;
+};
+
+class VlcTable {
+public:
+    static constexpr u32 MAX_BITS = 16;
+    static constexpr u32 PRIMARY_BITS = 8;
+
+    // Exits with FATAL_ERROR if the codes are not prefix-free; the tables are constants.
+    VlcTable(std::initializer_list<VlcCode> codes);
+
+    /**
+     * @brief Decodes the code at the start of `bits`.
+     * @param bits The next MAX_BITS bits of the stream, the first one in the top bit.
+     */
+    const VlcEntry& lookup(u32 bits) const {
+        const VlcEntry& entry = entries[bits >> (MAX_BITS - PRIMARY_BITS)];
+        if (!entry.sub_bits) {
+            return entry;
+        }
+        const u32 index = (bits >> (MAX_BITS - PRIMARY_BITS - entry.sub_bits)) & ((1u << entry.sub_bits) - 1);
+        return entries[(u16)entry.value + index];
+    }
+
+    const std::vector<VlcCode>& codes() const { return code_list; }
+
+private:
+    std::vector<VlcEntry> entries;
+    std::vector<VlcCode> code_list;
+};
+
+namespace mpeg {
+
+// Macroblock types as VDEC reports them (macroblock_type flags).
+constexpr u32 MB_INTRA = 0x01;
+constexpr u32 MB_PATTERN = 0x02;
+constexpr u32 MB_BACKWARD = 0x04;
+constexpr u32 MB_FORWARD = 0x08;
+constexpr u32 MB_QUANT = 0x10;
+
+// macroblock_address_increment values beyond 1-33.
+constexpr s16 MBA_STUFFING = 0x22;      // MPEG-1 only
+constexpr s16 MBA_ESCAPE = 0x23;        // Adds 33 to the increment that follows
+
+// DCT coefficient table values other than a run.
+constexpr s16 DCT_END_OF_BLOCK = -1;
+constexpr s16 DCT_ESCAPE = -2;
+
+// B.1 macroblock_address_increment.
+extern const VlcTable ADDRESS_INCREMENT;
+// B.2-B.4 macroblock_type for I, P and B pictures, and the one code of D pictures.
+extern const VlcTable MB_TYPE_I;
+extern const VlcTable MB_TYPE_P;
+extern const VlcTable MB_TYPE_B;
+extern const VlcTable MB_TYPE_D;
+// B.9 coded_block_pattern (4:2:0).
+extern const VlcTable CODED_BLOCK_PATTERN;
+// B.10 motion_code: the magnitude; a sign bit follows every code but 0.
+extern const VlcTable MOTION_CODE;
+// B.11 dmvector.
+extern const VlcTable DMVECTOR;
+// B.12/B.13 dct_dc_size.
+extern const VlcTable DC_SIZE_LUMA;
+extern const VlcTable DC_SIZE_CHROMA;
+// B.14/B.15 DCT coefficients as (run, level); a sign bit follows every code but the
+// end of block and the escape. B.14's "1s" for a non-intra block's first coefficient
+// is left to the decoder.
+extern const VlcTable DCT_COEFFICIENTS_0;
+extern const VlcTable DCT_COEFFICIENTS_1;
+
+// Raster position of each coefficient in scan order.
+extern const u8 ZIGZAG_SCAN[64];
+extern const u8 ALTERNATE_SCAN[64];
+
+// quantiser_scale for each quantiser_scale_code with q_scale_type set (table 7-6).
+extern const u8 NON_LINEAR_QUANTISER_SCALE[32];
+
+// The default intra matrix, in raster order.
+extern const u8 DEFAULT_INTRA_MATRIX[64];
+
+} // namespace mpeg
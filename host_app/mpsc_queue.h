@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+
+// Intrusive lock-free queue for many producer threads and one consumer thread (Vyukov's
+// MPSC queue). A push is one atomic exchange and one store, never blocks and never
+// allocates; the consumer pops without any atomic read-modify-write.
+//
+// T needs a `std::atomic<T*> next` member. A node belongs to the queue from push() until
+// pop() returns it.
+
+template <typename T>
+class MpscQueue {
+public:
+    MpscQueue() : head(&stub), tail(&stub) {
+        stub.next.store(nullptr, std::memory_order_relaxed);
+    }
+
+    MpscQueue(const MpscQueue&) = delete;
+    MpscQueue& operator=(const MpscQueue&) = delete;
+
+    // Any thread.
+    void push(T* node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        T* previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * @brief Consumer thread only. Returns the oldest node, or nullptr when the queue is
+     * empty or a push is halfway through (the node shows up on a later call).
+     */
+    T* pop() {
+        T* first = tail;
+        T* next = first->next.load(std::memory_order_acquire);
+        if (first == &stub) {
+            if (!next) {
+                return nullptr;
+            }
+            tail = next;
+            first = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail = next;
+            return first;
+        }
+        if (first != head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+        // `first` is the last node: put the stub behind it so it can be handed out.
+        push(&stub);
+        next = first->next.load(std::memory_order_acquire);
+        if (next) {
+            tail = next;
+            return first;
+        }
+        return nullptr;
+    }
+
+    // Consumer thread only; may miss a push that is in progress.
+    bool empty() const {
+        const T* first = tail;
+        return first == &stub ? first->next.load(std::memory_order_acquire) == nullptr : false;
+    }
+
+private:
+    T stub;
+    alignas(64) std::atomic<T*> head;   // Producers
+    alignas(64) T* tail;                // Consumer
+};
@@ -0,0 +1,208 @@
+#include "runtime.h"
+#include "memory.h"
+#include <iostream>
+
+static thread_local EEInstance* current_instance = nullptr;
+
+void EEInstance::on_dmac_event(void* user, s32) {
+    const DmacEvent* event = static_cast<const DmacEvent*>(user);
+    event->instance->dmac.complete(event->channel);
+}
+
+void EEInstance::on_dmac_burst(void* user, u32 channel, u32 cycles) {
+    EEInstance* instance = static_cast<EEInstance*>(user);
+    instance->scheduler.schedule(instance->dmac_events[channel].event, cycles);
+}
+
+// Timer and VBLANK lines only ever rise inside scheduler events, so cpu_event_test()
+// picks them up right after the batch.
+void EEInstance::on_timer_irq(void* user, u32 line) {
+    EEInstance* instance = static_cast<EEInstance*>(user);
+    instance->intc.raise(line);
+    if (line == Timers::IRQ_VBLANK_START) {
+        if (instance->vsync_hook) {
+            instance->vsync_hook(instance->vsync_user, instance->timers.frame());
+        }
+        instance->kernel.on_vblank_start();
+        instance->iop.on_vblank();
+    }
+}
+
+// The IPU finishes commands from MMIO accesses as well as from scheduler events.
+void EEInstance::on_ipu_irq(void* user) {
+    EEInstance* instance = static_cast<EEInstance*>(user);
+    instance->intc.raise(INTC_IPU);
+    instance->interrupts.update();
+}
+
+u32 mmio_timers_read32(EmotionEngineState& context, u32 address) { return EEInstance::of(context).timers.read32(address); }
+void mmio_timers_write32(EmotionEngineState& context, u32 address, u32 value) { EEInstance::of(context).timers.write32(address, value); }
+u32 mmio_dmac_read32(EmotionEngineState& context, u32 address) { return EEInstance::of(context).dmac.read32(address); }
+u32 mmio_intc_read32(EmotionEngineState& context, u32 address) { return EEInstance::of(context).intc.read32(address); }
+u32 mmio_sif_read32(EmotionEngineState& context, u32 address) { return EEInstance::of(context).iop.read32(address); }
+void mmio_sif_write32(EmotionEngineState& context, u32 address, u32 value) { EEInstance::of(context).iop.write32(address, value); }
+u32 mmio_ipu_read32(EmotionEngineState& context, u32 address) { return EEInstance::of(context).ipu.read32(address); }
+void mmio_ipu_write32(EmotionEngineState& context, u32 address, u32 value) { EEInstance::of(context).ipu.write32(address, value); }
+u32 mmio_timers_command_bits(u32 address) { return Timers::command_bits(address); }
+u32 mmio_dmac_command_bits(u32 address) { return Dmac::command_bits(address); }
+u32 mmio_intc_command_bits(u32 address) { return Intc::command_bits(address); }
+u32 mmio_sif_command_bits(u32 address) { return Iop::command_bits(address); }
+u32 mmio_ipu_command_bits(u32) { return 0; }
+
+void mmio_intc_write32(EmotionEngineState& context, u32 address, u32 value) {
+    // Acknowledging or unmasking changes what is pending.
+    EEInstance& instance = EEInstance::of(context);
+    instance.intc.write32(address, value);
+    instance.interrupts.update();
+}
+
+void mmio_dmac_write32(EmotionEngineState& context, u32 address, u32 value) {
+    // So can a D_STAT write (INT1), and a channel started with CHCR.
+    EEInstance& instance = EEInstance::of(context);
+    instance.dmac.write32(address, value);
+    instance.interrupts.update();
+}
+
+template <u32 (*Read)(EmotionEngineState&, u32)>
+static u32 route_read32(void* user, u32 address) {
+    return Read(*static_cast<EEInstance*>(user), address);
+}
+
+template <void (*Write)(EmotionEngineState&, u32, u32)>
+static void route_write32(void* user, u32 address, u32 value) {
+    Write(*static_cast<EEInstance*>(user), address, value);
+}
+
+// Faulting accesses happen on the thread running the instance.
+static bool on_mmio_read(u32 address, u32 size, void* value) {
+    return current_instance->mmio.read(address, size, value);
+}
+
+static bool on_mmio_write(u32 address, u32 size, const void* value) {
+    return current_instance->mmio.write(address, size, value);
+}
+
+EEInstance::EEInstance()
+    : EmotionEngineState(), scheduler(cpuRegs), dmac(DmaMemory{}), timers(cpuRegs, scheduler),
+      interrupts(*this, intc, dmac, scheduler),
+      kernel(*this, interrupts, intc, dmac, scheduler), iop(*this, dmac, scheduler, kernel), ipu(dmac, scheduler), tlb(cpuRegs), space(fastmem_create()), smc(smc_create()), vsync_hook(nullptr), vsync_user(nullptr), dmac_events() {
+    static const char* const dmac_event_names[DMAC_CHANNEL_COUNT] = {
+        "dmac_vif0", "dmac_vif1", "dmac_gif", "dmac_ipu_from", "dmac_ipu_to",
+        "dmac_sif0", "dmac_sif1", "dmac_sif2", "dmac_spr_from", "dmac_spr_to",
+    };
+
+    if (!space) {
+        std::cerr << "FATAL_ERROR: Could not map emulated memory." << std::endl;
+        exit(1);
+    }
+    FastmemSpace* previous_space = fastmem_current();
+    SmcState* previous_smc = smc_current();
+    EEInstance* previous_instance = current_instance;
+    bind();
+
+    // SPR DMA (channels 8/9) works on the same buffer recompiled code reads and writes.
+    dmac.set_memory(DmaMemory{ ram_memory, fastmem::RAM_SIZE, scratchpad_memory, fastmem::SCRATCHPAD_SIZE });
+    for (u32 i = 0; i < DMAC_CHANNEL_COUNT; i++) {
+        dmac_events[i] = DmacEvent{ this, i, 0 };
+        dmac_events[i].event = scheduler.register_event(dmac_event_names[i], &on_dmac_event, &dmac_events[i]);
+    }
+    dmac.set_completion_hook(&on_dmac_burst, this);
+    timers.set_irq_hook(&on_timer_irq, this);
+    ipu.set_irq_hook(&on_ipu_irq, this);
+
+    // Register blocks without a device model yet (GIF, VIF and their FIFOs, SIO/SBUS, GS
+    // privileged registers, the IOP-side window) just hold what was written to them. The
+    // routes below take the IPU's out of these ranges.
+    mmio.add_latch(0x10002000, 0x10008000);
+    mmio.add_latch(0x1000F020, 0x10010000);
+    mmio.add_latch(0x12000000, 0x12002000);
+    mmio.add_latch(0x1F800000, 0x1F810000);
+#define MMIO_ROUTE_REGISTER(start, end, name) \
+    mmio.add(start, end, MmioHandlers{ this, &route_read32<&mmio_##name##_read32>, &route_write32<&mmio_##name##_write32>, \
+                                       nullptr, nullptr, &mmio_##name##_command_bits });
+    EE_MMIO_ROUTES(MMIO_ROUTE_REGISTER)
+#undef MMIO_ROUTE_REGISTER
+    fastmem_set_mmio_handlers(&on_mmio_read, &on_mmio_write);
+
+    // Stores to pages recompiled code came from (see smc.h).
+    smc_init();
+    for (const RecompiledCode& code : recompiled_code()) {
+        smc_register_code(code.address, code.size, code.hash);
+    }
+
+    fastmem_bind(previous_space);
+    smc_bind(previous_smc);
+    current_instance = previous_instance;
+}
+
+EEInstance::~EEInstance() {
+    if (current_instance == this) {
+        current_instance = nullptr;
+    }
+    smc_destroy(smc);
+    fastmem_destroy(space);
+}
+
+void EEInstance::bind() {
+    fastmem_bind(space);
+    smc_bind(smc);
+    current_instance = this;
+}
+
+EEInstance* EEInstance::current() {
+    return current_instance;
+}
+
+void EEInstance::set_vsync_hook(VsyncHook hook, void* user) {
+    vsync_hook = hook;
+    vsync_user = user;
+}
+
+void cpu_event_test(EmotionEngineState& context) {
+    EEInstance& instance = EEInstance::of(context);
+    instance.scheduler.run_due();
+    instance.interrupts.update();
+    instance.interrupts.deliver();
+    instance.kernel.interrupt_return();
+}
+
+u32 cop0_read_count(EmotionEngineState& context) {
+    return EEInstance::of(context).timers.read_count();
+}
+
+void cop0_write(EmotionEngineState& context, u32 reg, u32 value) {
+    EEInstance& instance = EEInstance::of(context);
+    switch (reg) {
+        case 9:
+            instance.timers.write_count(value);
+            break;
+        case 11:
+            instance.timers.write_compare(value);
+            instance.interrupts.update();
+            break;
+        case 12:
+            // May unmask or enable something that is already pending.
+            context.cpuRegs.CP0.n.Status.val = value;
+            instance.interrupts.update();
+            break;
+        default:
+            context.cpuRegs.CP0.r[reg] = value;
+            break;
+    }
+}
+
+void cop0_tlbwi(EmotionEngineState& context) {
+    EEInstance::of(context).tlb.write_indexed();
+}
+
+void cop0_tlbwr(EmotionEngineState& context) {
+    EEInstance::of(context).tlb.write_random();
+}
+
+void cop0_tlbp(EmotionEngineState& context) {
+    EEInstance::of(context).tlb.probe();
+}
+
+void cop0_tlbr(EmotionEngineState& context) {
+    EEInstance::of(context).tlb.read();
+}
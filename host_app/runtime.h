@@ -0,0 +1,125 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "scheduler.h"
+#include "dmac.h"
+#include "timers.h"
+#include "intc.h"
+#include "interrupts.h"
+#include "kernel.h"
+#include "iop.h"
+#include "ipu.h"
+#include "syscalls.h"
+#include "dispatch.h"
+#include "tlb.h"
+#include "mmio.h"
+#include "mmio_map.h"
+#include "smc.h"
+
+// Called at the start of each VBLANK with the frames completed so far (see
+// Timers::frame()), before the kernel and IOP see it.
+using VsyncHook = void (*)(void* user, u32 frame);
+
+/**
+ * @brief One emulated EE: its state, the subsystems hanging off it, and its own address
+ * space (RAM, scratchpad, TLB) and self-modifying code tracking.
+ *
+ * Nothing mutable is shared between instances, so a process can run many of them, one
+ * thread each. Recompiled code gets the instance as `ctx`; memory accesses and device
+ * callbacks find it through the instance bound to the calling thread (see bind()).
+ */
+class EEInstance : public EmotionEngineState {
+public:
+    // Maps a fresh address space and connects the subsystems (e.g. DMAC completions are
+    // posted through the scheduler). Leaves the calling thread's bindings as they were.
+    EEInstance();
+    ~EEInstance();
+
+    EEInstance(const EEInstance&) = delete;
+    EEInstance& operator=(const EEInstance&) = delete;
+
+    /**
+     * @brief Makes this the instance the calling thread runs: its memory accesses, MMIO
+     * and write faults go here from now on. Call on the instance's thread before running
+     * any recompiled code; an instance must not be bound to two running threads.
+     */
+    void bind();
+
+    // The instance bound to the calling thread, or nullptr.
+    static EEInstance* current();
+
+    // The instance recompiled code was handed as `ctx`.
+    static EEInstance& of(EmotionEngineState& context) { return static_cast<EEInstance&>(context); }
+
+    // One hook at a time (frame hashes, see frame_hash.h); nullptr removes it.
+    void set_vsync_hook(VsyncHook hook, void* user);
+
+    Scheduler scheduler;
+    Dmac dmac;
+    Timers timers;
+    Intc intc;
+    Interrupts interrupts;
+    Kernel kernel;
+    Iop iop;
+    Ipu ipu;
+    Tlb tlb;
+    MmioRegistry mmio;
+
+private:
+    struct DmacEvent {
+        EEInstance* instance;
+        u32 channel;
+        int event;
+    };
+
+    static void on_dmac_event(void* user, s32 cycles_late);
+    static void on_dmac_burst(void* user, u32 channel, u32 cycles);
+    static void on_timer_irq(void* user, u32 line);
+    static void on_ipu_irq(void* user);
+
+    FastmemSpace* space;
+    SmcState* smc;
+    VsyncHook vsync_hook;
+    void* vsync_user;
+
+    // One scheduler event per DMAC channel, indexed by DmacChannel.
+    DmacEvent dmac_events[DMAC_CHANNEL_COUNT];
+};
+
+/**
+ * @brief Entered from recompiled code at a safe point once cycle has reached
+ * nextEventCycle. Runs every due event in one batch, then takes any interrupt
+ * that became deliverable, and switches EE thread if a handler readied one that
+ * outranks the running thread.
+ */
+void cpu_event_test(EmotionEngineState& context);
+
+/**
+ * @brief MFC0 from COP0.Count, which is only brought up to date when it is read.
+ */
+u32 cop0_read_count(EmotionEngineState& context);
+
+/**
+ * @brief MTC0 to a COP0 register with side effects (Count, Compare, Status).
+ * @param reg COP0 register number.
+ */
+void cop0_write(EmotionEngineState& context, u32 reg, u32 value);
+
+/**
+ * @brief TLB instructions. Writes update the page table memory accesses go through
+ * (see tlb.h).
+ */
+void cop0_tlbwi(EmotionEngineState& context);
+void cop0_tlbwr(EmotionEngineState& context);
+void cop0_tlbp(EmotionEngineState& context);
+void cop0_tlbr(EmotionEngineState& context);
+
+// Register access for the modelled devices (see mmio_map.h). The MMIO registry routes
+// to these, and recompiled code calls them directly for constant addresses. The command
+// bits tell the registry which bits a narrow store must not write back (see mmio.h).
+#define MMIO_ROUTE_DECLARE(start, end, name) \
+    u32 mmio_##name##_read32(EmotionEngineState& context, u32 address); \
+    void mmio_##name##_write32(EmotionEngineState& context, u32 address, u32 value); \
+    u32 mmio_##name##_command_bits(u32 address);
+EE_MMIO_ROUTES(MMIO_ROUTE_DECLARE)
+#undef MMIO_ROUTE_DECLARE
@@ -0,0 +1,145 @@
+#include "gtest/gtest.h"
+#include "runtime.h"
+#include "memory.h"
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace {
+
+class RuntimeTest : public ::testing::Test {
+protected:
+    // Instances rebind the calling thread; give the test thread its own space back.
+    RuntimeTest() : previous_space(fastmem_current()), previous_smc(smc_current()) {}
+    ~RuntimeTest() override {
+        fastmem_bind(previous_space);
+        smc_bind(previous_smc);
+    }
+
+    // Interrupts on and INT0/INT1 unmasked in Status, as the kernel leaves them.
+    static void enable_interrupts(EEInstance& instance) {
+        auto& status = instance.cpuRegs.CP0.n.Status;
+        status.b.IE = 1;
+        status.b.EIE = 1;
+        status.val |= Interrupts::CAUSE_IP2 | Interrupts::CAUSE_IP3;
+    }
+
+    FastmemSpace* previous_space;
+    SmcState* previous_smc;
+};
+
+// What a recompiled block does to its instance: a store through memory, one through a
+// device register and one into the context.
+void guest_work(EmotionEngineState* __restrict ctx, u32 seed) {
+    WriteMemory32(0x00100000, seed);
+    WriteMemory32(0x10003000, seed * 2);            // Latched register block (GIF)
+    mmio_dmac_write32(*ctx, Dmac::D_CTRL, seed & 1);
+    ctx->cpuRegs.GPR.n.v0.UD[0] = ReadMemory32(0x80100000) + ReadMemory32(0x10003000);
+}
+
+} // namespace
+
+TEST_F(RuntimeTest, InstancesDoNotShareState) {
+    // 1. Arrange
+    EEInstance a;
+    EEInstance b;
+
+    // 2. Act
+    a.bind();
+    guest_work(&a, 3);
+    b.bind();
+    guest_work(&b, 4);
+
+    // 3. Assert: each instance still sees only its own writes.
+    EXPECT_EQ(b.cpuRegs.GPR.n.v0.UD[0], 12u);
+    EXPECT_EQ(ReadMemory32(0x00100000), 4u);
+    EXPECT_EQ(b.dmac.read32(Dmac::D_CTRL) & 1, 0u);
+    a.bind();
+    EXPECT_EQ(a.cpuRegs.GPR.n.v0.UD[0], 9u);
+    EXPECT_EQ(ReadMemory32(0x00100000), 3u);
+    EXPECT_EQ(ReadMemory32(0x10003000), 6u);
+    EXPECT_EQ(a.dmac.read32(Dmac::D_CTRL) & 1, 1u);
+    EXPECT_EQ(EEInstance::current(), &a);
+}
+
+TEST_F(RuntimeTest, ConstructionKeepsTheCallersBinding) {
+    EEInstance a;
+    a.bind();
+    WriteMemory32(0x00200000, 0x1234);
+
+    EEInstance b;
+
+    EXPECT_EQ(EEInstance::current(), &a);
+    EXPECT_EQ(ReadMemory32(0x00200000), 0x1234u);
+}
+
+TEST_F(RuntimeTest, OneThreadPerInstance) {
+    // 1. Arrange
+    constexpr u32 INSTANCE_COUNT = 4;
+    std::vector<std::unique_ptr<EEInstance>> instances;
+    for (u32 i = 0; i < INSTANCE_COUNT; i++) {
+        instances.push_back(std::make_unique<EEInstance>());
+    }
+
+    // 2. Act: every thread hammers the same guest addresses of its own instance.
+    std::vector<std::thread> threads;
+    std::vector<u32> mismatches(INSTANCE_COUNT, 0);
+    for (u32 i = 0; i < INSTANCE_COUNT; i++) {
+        threads.emplace_back([&, i] {
+            EEInstance& instance = *instances[i];
+            instance.bind();
+            for (u32 round = 0; round < 10000; round++) {
+                const u32 seed = i * 100000 + round;
+                guest_work(&instance, seed);
+                if (instance.cpuRegs.GPR.n.v0.UD[0] != (u64)(u32)(seed * 3)) {
+                    mismatches[i]++;
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // 3. Assert
+    for (u32 i = 0; i < INSTANCE_COUNT; i++) {
+        EXPECT_EQ(mismatches[i], 0u) << "instance " << i;
+    }
+}
+
+TEST_F(RuntimeTest, UnmaskedInterruptIsCheckedDespiteLaterScheduling) {
+    // 1. Arrange: a VBLANK start pending in INTC but masked.
+    EEInstance instance;
+    instance.bind();
+    enable_interrupts(instance);
+    instance.cpuRegs.cycle = 1000;
+    instance.intc.raise(INTC_VBLANK_START);
+
+    // 2. Act: one block unmasks it, then starts a timer, which schedules its match.
+    mmio_intc_write32(instance, Intc::INTC_MASK, 1u << INTC_VBLANK_START);
+    mmio_timers_write32(instance, 0x10000010, tmode::CUE | tmode::CMPE);
+
+    // 3. Assert: the next block exit enters cpu_event_test().
+    EXPECT_EQ(instance.cpuRegs.nextEventCycle, instance.cpuRegs.cycle);
+}
+
+TEST_F(RuntimeTest, UnmaskingAFinishedDmaChannelRaisesInt1) {
+    // 1. Arrange: GIF finished with its D_STAT mask bit clear.
+    EEInstance instance;
+    instance.bind();
+    enable_interrupts(instance);
+    instance.cpuRegs.cycle = 1000;
+    instance.dmac.write32(Dmac::D_CTRL, 1);
+    instance.dmac.write32(0x1000A020, 0);                         // QWC 0
+    instance.dmac.write32(0x1000A000, chcr::STR | chcr::DIR);
+    instance.dmac.complete(DMAC_GIF);
+    instance.interrupts.update();
+    ASSERT_FALSE(instance.cpuRegs.CP0.n.Cause & Interrupts::CAUSE_IP3);
+
+    // 2. Act: the constant-address store the recompiler emits for D_STAT.
+    mmio_dmac_write32(instance, Dmac::D_STAT, 1u << (16 + DMAC_GIF));
+
+    // 3. Assert
+    EXPECT_TRUE(instance.cpuRegs.CP0.n.Cause & Interrupts::CAUSE_IP3);
+    EXPECT_EQ(instance.cpuRegs.nextEventCycle, instance.cpuRegs.cycle);
+}
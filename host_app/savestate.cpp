@@ -0,0 +1,362 @@
+#include "savestate.h"
+#include "lz.h"
+#include "runtime.h"
+#include "state_hash.h"
+#include "state_stream.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+constexpr u32 REGION_PAGES[SaveStates::REGION_COUNT] = {
+    fastmem::RAM_SIZE / SaveStates::PAGE_SIZE,
+    fastmem::SCRATCHPAD_SIZE / SaveStates::PAGE_SIZE,
+    Spu2::RAM_SIZE / SaveStates::PAGE_SIZE,
+};
+
+static_assert(SaveStates::PAGE_SIZE == 1u << SMC_PAGE_SHIFT, "RAM pages are the ones smc.h tracks");
+
+constexpr char FILE_MAGIC[8] = { 'E', 'E', 'S', 'T', 'A', 'T', 'E', '2' };
+
+// Pages are handed out to the threads a batch at a time.
+constexpr u32 BATCH = 32;
+
+struct FileHeader {
+    char magic[8];
+    u32 page_size;
+    u32 region_pages[SaveStates::REGION_COUNT];
+    u32 devices_size;
+};
+
+// A page of one of the regions, to be hashed, compressed or written back.
+struct PageJob {
+    SaveStates::Region region;
+    u32 page;
+};
+
+template <typename Work>
+void parallel_for(u32 count, u32 threads, const Work& work) {
+    std::atomic<u32> next(0);
+    const auto run = [&] {
+        for (;;) {
+            const u32 first = next.fetch_add(BATCH, std::memory_order_relaxed);
+            if (first >= count) {
+                return;
+            }
+            for (u32 i = first; i < std::min(first + BATCH, count); i++) {
+                work(i);
+            }
+        }
+    };
+
+    const u32 helpers = std::min(threads, (count + BATCH - 1) / BATCH);
+    std::vector<std::thread> workers;
+    for (u32 i = 1; i < helpers; i++) {
+        workers.emplace_back(run);
+    }
+    run();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool write_all(int fd, const u8* data, size_t size) {
+    while (size > 0) {
+        const ssize_t put = ::write(fd, data, size);
+        if (put <= 0) {
+            return false;
+        }
+        data += put;
+        size -= (size_t)put;
+    }
+    return true;
+}
+
+} // namespace
+
+SaveStates::SaveStates(EEInstance& instance, u32 threads)
+    : instance(instance), threads(std::max(threads, 1u)), tracker(smc_track_writes()), sound_ram(new u8[Spu2::RAM_SIZE]),
+      stats() {
+    for (u32 region = 0; region < REGION_COUNT; region++) {
+        live[region].resize(REGION_PAGES[region]);
+    }
+}
+
+SaveStates::~SaveStates() {
+    smc_untrack_writes(tracker);
+}
+
+void SaveStates::save_devices(std::vector<u8>& out) {
+    StateWriter writer(out);
+    writer.write(static_cast<const EmotionEngineState&>(instance));
+    instance.scheduler.save_state(writer);
+    instance.dmac.save_state(writer);
+    instance.timers.save_state(writer);
+    instance.intc.save_state(writer);
+    instance.interrupts.save_state(writer);
+    instance.tlb.save_state(writer);
+    instance.iop.spu2.save_state(writer);
+}
+
+bool SaveStates::load_devices(const std::vector<u8>& in) {
+    StateReader reader(in.data(), in.size());
+    EmotionEngineState context;
+    if (!reader.read(context)) {
+        return false;
+    }
+    static_cast<EmotionEngineState&>(instance) = context;
+    const bool loaded = instance.scheduler.load_state(reader) && instance.dmac.load_state(reader) &&
+                        instance.timers.load_state(reader) && instance.intc.load_state(reader) &&
+                        instance.interrupts.load_state(reader) && instance.tlb.load_state(reader) &&
+                        instance.iop.spu2.load_state(reader);
+    instance.interrupts.update();
+    return loaded && reader.at_end();
+}
+
+u32 SaveStates::take() {
+    const auto start = std::chrono::steady_clock::now();
+    std::unique_ptr<Snapshot> snapshot(new Snapshot());
+    {
+        // The audio thread waits for the SPU2's cores and a copy of sound RAM, no longer.
+        auto lock = instance.iop.spu2.lock_state();
+        save_devices(snapshot->devices);
+        std::memcpy(sound_ram.get(), instance.iop.spu2.sound_ram(), Spu2::RAM_SIZE);
+    }
+
+    u64 written[SMC_PAGE_COUNT / 64];
+    smc_collect_written_pages(tracker, written);
+    std::vector<PageJob> jobs;
+    for (u32 page = 0; page < SMC_PAGE_COUNT; page++) {
+        if ((written[page / 64] >> (page % 64)) & 1) {
+            jobs.push_back(PageJob{ REGION_RAM, page });
+        }
+    }
+    for (u32 region = REGION_SCRATCHPAD; region < REGION_COUNT; region++) {
+        for (u32 page = 0; page < REGION_PAGES[region]; page++) {
+            jobs.push_back(PageJob{ (Region)region, page });
+        }
+    }
+
+    // Compare each page with the version memory held, and compress the ones that differ.
+    const u8* const memory[REGION_COUNT] = { fastmem_ram(), fastmem_scratchpad(), sound_ram.get() };
+    std::vector<PageRef> stored(jobs.size());
+    parallel_for((u32)jobs.size(), threads, [&](u32 i) {
+        const PageJob& job = jobs[i];
+        const u8* data = memory[job.region] + job.page * PAGE_SIZE;
+        const u64 hash = state_hash(data, PAGE_SIZE);
+        const PageRef& current = live[job.region][job.page];
+        if (current && current->hash == hash) {
+            return;
+        }
+
+        thread_local std::vector<u8> packed(lz_bound(PAGE_SIZE));
+        size_t size = lz_compress(data, PAGE_SIZE, packed.data(), packed.size());
+        const bool raw = size == 0 || size >= PAGE_SIZE;
+        size = raw ? PAGE_SIZE : size;
+        std::shared_ptr<Page> page(new Page{ hash, (u32)size, std::unique_ptr<u8[]>(new u8[size]) });
+        std::memcpy(page->data.get(), raw ? data : packed.data(), size);
+        stored[i] = std::move(page);
+    });
+
+    stats = Stats{ (u32)jobs.size(), 0, 0, 0.0 };
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (stored[i]) {
+            stats.pages_stored++;
+            stats.stored_bytes += stored[i]->size;
+            live[jobs[i].region][jobs[i].page] = std::move(stored[i]);
+        }
+    }
+    for (u32 region = 0; region < REGION_COUNT; region++) {
+        snapshot->pages[region] = live[region];
+    }
+    snapshots.push_back(std::move(snapshot));
+    stats.milliseconds = elapsed_ms(start);
+    return (u32)snapshots.size() - 1;
+}
+
+bool SaveStates::restore(u32 id) {
+    if (!has(id)) {
+        return false;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    const Snapshot& snapshot = *snapshots[id];
+    auto lock = instance.iop.spu2.lock_state();
+    if (!load_devices(snapshot.devices)) {
+        return false;
+    }
+
+    // Pages memory may no longer hold the snapshot's version of: RAM pages written since
+    // the last take() or restore(), or whose version there was another; every page of the
+    // untracked regions.
+    u64 written[SMC_PAGE_COUNT / 64];
+    smc_collect_written_pages(tracker, written);
+    std::vector<PageJob> jobs;
+    for (u32 page = 0; page < SMC_PAGE_COUNT; page++) {
+        if (((written[page / 64] >> (page % 64)) & 1) || live[REGION_RAM][page] != snapshot.pages[REGION_RAM][page]) {
+            jobs.push_back(PageJob{ REGION_RAM, page });
+        }
+    }
+    for (u32 region = REGION_SCRATCHPAD; region < REGION_COUNT; region++) {
+        for (u32 page = 0; page < REGION_PAGES[region]; page++) {
+            jobs.push_back(PageJob{ (Region)region, page });
+        }
+    }
+
+    u8* const memory[REGION_COUNT] = { fastmem_ram(), fastmem_scratchpad(), instance.iop.spu2.sound_ram() };
+    std::vector<u8> differs(jobs.size());
+    parallel_for((u32)jobs.size(), threads, [&](u32 i) {
+        const PageJob& job = jobs[i];
+        differs[i] = state_hash(memory[job.region] + job.page * PAGE_SIZE, PAGE_SIZE) != snapshot.pages[job.region][job.page]->hash;
+    });
+
+    // The worker threads cannot take write faults: open the RAM pages up first.
+    std::vector<PageJob> writes;
+    u64 rewritten[SMC_PAGE_COUNT / 64] = {};
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (differs[i]) {
+            writes.push_back(jobs[i]);
+            if (jobs[i].region == REGION_RAM) {
+                rewritten[jobs[i].page / 64] |= 1ull << (jobs[i].page % 64);
+            }
+        }
+    }
+    smc_write_pages(rewritten);
+
+    std::atomic<bool> corrupt(false);
+    parallel_for((u32)writes.size(), threads, [&](u32 i) {
+        const PageJob& job = writes[i];
+        const Page& page = *snapshot.pages[job.region][job.page];
+        u8* out = memory[job.region] + job.page * PAGE_SIZE;
+        if (page.size == PAGE_SIZE) {
+            std::memcpy(out, page.data.get(), PAGE_SIZE);
+        } else if (!lz_decompress(page.data.get(), page.size, out, PAGE_SIZE)) {
+            corrupt.store(true, std::memory_order_relaxed);
+        }
+    });
+
+    // What was just written back matches the snapshot: nothing to hash next time.
+    smc_collect_written_pages(tracker, written);
+    for (u32 region = 0; region < REGION_COUNT; region++) {
+        live[region] = snapshot.pages[region];
+    }
+
+    stats = Stats{ (u32)jobs.size(), (u32)writes.size(), 0, 0.0 };
+    for (const PageJob& job : writes) {
+        stats.stored_bytes += snapshot.pages[job.region][job.page]->size;
+    }
+    stats.milliseconds = elapsed_ms(start);
+    return !corrupt.load();
+}
+
+void SaveStates::drop(u32 id) {
+    if (has(id)) {
+        snapshots[id].reset();
+    }
+}
+
+// A header, the device state, then each page of each region as its hash, its size and
+// its bytes.
+bool SaveStates::write_file(u32 id, const std::string& path) const {
+    if (!has(id)) {
+        return false;
+    }
+    const Snapshot& snapshot = *snapshots[id];
+    std::vector<u8> image;
+    StateWriter writer(image);
+    FileHeader header = {};
+    std::memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.page_size = PAGE_SIZE;
+    std::copy(std::begin(REGION_PAGES), std::end(REGION_PAGES), header.region_pages);
+    header.devices_size = (u32)snapshot.devices.size();
+    writer.write(header);
+    writer.write_bytes(snapshot.devices.data(), snapshot.devices.size());
+    for (u32 region = 0; region < REGION_COUNT; region++) {
+        for (const PageRef& page : snapshot.pages[region]) {
+            writer.write(page->hash);
+            writer.write(page->size);
+            writer.write_bytes(page->data.get(), page->size);
+        }
+    }
+
+    const int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    const bool ok = write_all(fd, image.data(), image.size());
+    return close(fd) == 0 && ok;
+}
+
+s64 SaveStates::read_file(const std::string& path) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    struct stat info;
+    std::vector<u8> image;
+    if (fstat(fd, &info) == 0) {
+        image.resize((size_t)info.st_size);
+    }
+    size_t done = 0;
+    while (done < image.size()) {
+        const ssize_t got = ::read(fd, image.data() + done, image.size() - done);
+        if (got <= 0) {
+            break;
+        }
+        done += (size_t)got;
+    }
+    close(fd);
+    if (image.empty() || done != image.size()) {
+        return -1;
+    }
+
+    StateReader reader(image.data(), image.size());
+    FileHeader header;
+    if (!reader.read(header) || std::memcmp(header.magic, FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.page_size != PAGE_SIZE || !std::equal(std::begin(REGION_PAGES), std::end(REGION_PAGES), header.region_pages)) {
+        return -1;
+    }
+    std::unique_ptr<Snapshot> snapshot(new Snapshot());
+    snapshot->devices.resize(header.devices_size);
+    if (!reader.read_bytes(snapshot->devices.data(), header.devices_size)) {
+        return -1;
+    }
+    u8 check[PAGE_SIZE];
+    for (u32 region = 0; region < REGION_COUNT; region++) {
+        for (u32 i = 0; i < REGION_PAGES[region]; i++) {
+            std::shared_ptr<Page> page(new Page());
+            if (!reader.read(page->hash) || !reader.read(page->size) || page->size == 0 || page->size > PAGE_SIZE) {
+                return -1;
+            }
+            page->data.reset(new u8[page->size]);
+            if (!reader.read_bytes(page->data.get(), page->size)) {
+                return -1;
+            }
+            const u8* data = page->data.get();
+            if (page->size < PAGE_SIZE) {
+                if (!lz_decompress(data, page->size, check, PAGE_SIZE)) {
+                    return -1;
+                }
+                data = check;
+            }
+            if (state_hash(data, PAGE_SIZE) != page->hash) {
+                return -1;
+            }
+            snapshot->pages[region].push_back(std::move(page));
+        }
+    }
+    if (!reader.at_end()) {
+        return -1;
+    }
+    snapshots.push_back(std::move(snapshot));
+    return (s64)snapshots.size() - 1;
+}
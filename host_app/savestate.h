@@ -0,0 +1,118 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class EEInstance;
+
+// Save states of an EE instance, kept in memory as a chain of snapshots that regression
+// tests and crash triage can step back through.
+//
+// A snapshot holds the EE's registers, the devices' state (scheduler, DMAC, timers, INTC,
+// interrupt handlers, TLB and the SPU2's cores) and every page of RAM, the scratchpad and
+// sound RAM. Each version of a page is stored once, LZ-compressed (see lz.h), and shared
+// by every snapshot that has it, so a snapshot is a table of pages and taking one only
+// compresses the pages that changed since the last. RAM pages are found through write
+// protection (see smc.h). The scratchpad and sound RAM, and RAM without fastmem, have
+// every page hashed and compared with its last version instead. Hashing and compression
+// run on worker threads.
+//
+// Restoring writes back only the pages where memory differs from the snapshot: those that
+// were written since the last snapshot or restore and whose contents no longer match.
+//
+// Snapshots are taken and restored on the instance's thread, outside recompiled code, and
+// restore into that instance: device callbacks and scheduler events stay the instance's
+// own and only their state is saved. A snapshot written to a file can be read back into
+// a chain of the same build.
+//
+// Not saved: the HLE kernel's threads (they run on fibers), the IPU's decoder, and the IOP
+// modules other than the SPU2. The GS, VU and VIF are not emulated and hold no state.
+
+class SaveStates {
+public:
+    static constexpr u32 PAGE_SIZE = 4096;
+
+    // The memories saved page by page.
+    enum Region : u32 {
+        REGION_RAM,
+        REGION_SCRATCHPAD,
+        REGION_SOUND_RAM,
+        REGION_COUNT,
+    };
+
+    struct Stats {
+        u32 pages_checked;      // Pages hashed: written ones, or all of an untracked region
+        u32 pages_stored;       // New versions compressed (take) or written back (restore)
+        u64 stored_bytes;       // Their compressed size
+        double milliseconds;
+    };
+
+    /**
+     * @brief Starts tracking the writes of the instance bound to the calling thread.
+     * @param threads Threads hashing and compressing pages, the calling one included.
+     */
+    explicit SaveStates(EEInstance& instance, u32 threads = 4);
+    ~SaveStates();
+
+    SaveStates(const SaveStates&) = delete;
+    SaveStates& operator=(const SaveStates&) = delete;
+
+    // Snapshots the instance. Returns the snapshot's id, the next in the chain.
+    u32 take();
+
+    /**
+     * @brief Puts the instance back the way it was when snapshot `id` was taken.
+     * @return false if there is no such snapshot, or its device state does not load.
+     */
+    bool restore(u32 id);
+
+    // Frees snapshot `id`, and the pages no other snapshot shares.
+    void drop(u32 id);
+
+    bool has(u32 id) const { return id < snapshots.size() && snapshots[id]; }
+
+    // Of the last take() or restore().
+    const Stats& last_stats() const { return stats; }
+
+    /**
+     * @brief Writes snapshot `id` to `path`, whole.
+     * @return false if there is no such snapshot or the file cannot be written.
+     */
+    bool write_file(u32 id, const std::string& path) const;
+
+    /**
+     * @brief Adds the snapshot in `path` to the chain. Every page is checked as it is read.
+     * @return Its id, or -1 if the file cannot be read or is not a snapshot of this build.
+     */
+    s64 read_file(const std::string& path);
+
+private:
+    struct Page {
+        u64 hash;               // Of the uncompressed page, see state_hash.h
+        u32 size;               // Bytes of `data`; PAGE_SIZE when stored as is
+        std::unique_ptr<u8[]> data;
+    };
+
+    using PageRef = std::shared_ptr<const Page>;
+
+    struct Snapshot {
+        std::vector<u8> devices;
+        std::vector<PageRef> pages[REGION_COUNT];
+    };
+
+    void save_devices(std::vector<u8>& out);
+    bool load_devices(const std::vector<u8>& in);
+
+    EEInstance& instance;
+    const u32 threads;
+    int tracker;            // Of RAM writes, see smc.h
+    std::vector<std::unique_ptr<Snapshot>> snapshots;
+    // The version of each page that memory held as of the last take() or restore().
+    std::vector<PageRef> live[REGION_COUNT];
+    // Sound RAM as of the last take(), so the audio thread only waits for a copy.
+    std::unique_ptr<u8[]> sound_ram;
+    Stats stats;
+};
+
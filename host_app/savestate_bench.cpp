@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+#include "savestate.h"
+#include "runtime.h"
+#include "memory.h"
+#include <random>
+
+// What a snapshot costs: a whole first one of a filled 32 MB of RAM, then ones taken after
+// a frame's worth of guest stores land on `range(0)` pages, and restoring one of them.
+
+namespace {
+
+// RAM with something on every page: runs of small words, like code and game data.
+void fill_ram(std::mt19937& random) {
+    for (u32 address = 0; address < fastmem::RAM_SIZE; address += 16) {
+        const u32 value = random() % 64;
+        for (u32 i = 0; i < 16; i += 4) {
+            WriteMemory32(address + i, value + i);
+        }
+    }
+}
+
+void touch_pages(std::mt19937& random, u32 pages) {
+    for (u32 i = 0; i < pages; i++) {
+        const u32 page = random() % (fastmem::RAM_SIZE / SaveStates::PAGE_SIZE);
+        WriteMemory32(page * SaveStates::PAGE_SIZE + (random() % 1024) * 4, random());
+    }
+}
+
+void BM_FirstSnapshot(benchmark::State& state) {
+    EEInstance instance;
+    instance.bind();
+    std::mt19937 random(49);
+    fill_ram(random);
+    for (auto _ : state) {
+        SaveStates states(instance, (u32)state.range(0));
+        states.take();
+    }
+}
+BENCHMARK(BM_FirstSnapshot)->Arg(1)->Arg(4)->Unit(benchmark::kMillisecond);
+
+void BM_IncrementalSnapshot(benchmark::State& state) {
+    EEInstance instance;
+    instance.bind();
+    std::mt19937 random(50);
+    fill_ram(random);
+    SaveStates states(instance, 4);
+    u32 previous = states.take();
+    for (auto _ : state) {
+        state.PauseTiming();
+        touch_pages(random, (u32)state.range(0));
+        states.drop(previous);
+        state.ResumeTiming();
+        previous = states.take();
+    }
+}
+BENCHMARK(BM_IncrementalSnapshot)->Arg(64)->Arg(512)->Arg(2048)->Unit(benchmark::kMicrosecond);
+
+void BM_Restore(benchmark::State& state) {
+    EEInstance instance;
+    instance.bind();
+    std::mt19937 random(51);
+    fill_ram(random);
+    SaveStates states(instance, 4);
+    const u32 id = states.take();
+    for (auto _ : state) {
+        state.PauseTiming();
+        touch_pages(random, (u32)state.range(0));
+        state.ResumeTiming();
+        states.restore(id);
+    }
+}
+BENCHMARK(BM_Restore)->Arg(64)->Arg(512)->Arg(2048)->Unit(benchmark::kMicrosecond);
+
+} // namespace
@@ -0,0 +1,188 @@
+#include "gtest/gtest.h"
+#include "savestate.h"
+#include "runtime.h"
+#include "memory.h"
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unistd.h>
+
+namespace {
+
+std::string temp_path() {
+    char path[] = "/tmp/savestate_testXXXXXX";
+    const int fd = mkstemp(path);
+    EXPECT_GE(fd, 0);
+    close(fd);
+    return path;
+}
+
+void no_event(void*, s32) {}
+
+class SaveStateTest : public ::testing::Test {
+protected:
+    // The instance rebinds the test thread; give it its own space back afterwards.
+    SaveStateTest() : previous_space(fastmem_current()), previous_smc(smc_current()), instance(new EEInstance()) {
+        instance->bind();
+        states.reset(new SaveStates(*instance, 2));
+    }
+    ~SaveStateTest() override {
+        states.reset();
+        instance.reset();
+        fastmem_bind(previous_space);
+        smc_bind(previous_smc);
+    }
+
+    u8 sound_byte(u32 address) {
+        auto lock = instance->iop.spu2.lock_state();
+        return instance->iop.spu2.sound_ram()[address];
+    }
+
+    FastmemSpace* previous_space;
+    SmcState* previous_smc;
+    std::unique_ptr<EEInstance> instance;
+    std::unique_ptr<SaveStates> states;
+};
+
+} // namespace
+
+TEST_F(SaveStateTest, RestoreBringsBackMemoryAndRegisters) {
+    // 1. Arrange
+    WriteMemory32(0x00100000, 0x11111111);
+    WriteMemory32(0x70000010, 0x22222222);
+    instance->cpuRegs.GPR.n.a0.UD[0] = 0x33;
+    const u32 id = states->take();
+
+    // 2. Act
+    WriteMemory32(0x00100000, 0xDEAD);
+    WriteMemory32(0x01F00000, 0xBEEF);
+    WriteMemory32(0x70000010, 0);
+    instance->cpuRegs.GPR.n.a0.UD[0] = 0;
+    ASSERT_TRUE(states->restore(id));
+
+    // 3. Assert
+    EXPECT_EQ(ReadMemory32(0x00100000), 0x11111111u);
+    EXPECT_EQ(ReadMemory32(0x01F00000), 0u);
+    EXPECT_EQ(ReadMemory32(0x70000010), 0x22222222u);
+    EXPECT_EQ(instance->cpuRegs.GPR.n.a0.UD[0], 0x33u);
+}
+
+TEST_F(SaveStateTest, SnapshotsStoreOnlyChangedPages) {
+    // 1. Arrange
+    states->take();
+    EXPECT_GE(states->last_stats().pages_stored, 1u);
+
+    // 2. Act: three pages change, and one is written with what it already held.
+    WriteMemory32(0x00100000, 1);
+    WriteMemory32(0x00100004, 2);
+    WriteMemory32(0x00200000, 3);
+    WriteMemory32(0x70000000, 4);
+    WriteMemory32(0x00300000, 0);
+    states->take();
+
+    // 3. Assert
+    EXPECT_EQ(states->last_stats().pages_stored, 3u);
+#if FASTMEM_ENABLED
+    // Only written RAM pages were even looked at, besides the untracked regions.
+    const u32 untracked = (fastmem::SCRATCHPAD_SIZE + Spu2::RAM_SIZE) / SaveStates::PAGE_SIZE;
+    EXPECT_EQ(states->last_stats().pages_checked, untracked + 3);
+#endif
+}
+
+TEST_F(SaveStateTest, RestoreRewritesOnlyPagesThatDiffer) {
+    // 1. Arrange
+    WriteMemory32(0x00100000, 1);
+    const u32 first = states->take();
+    WriteMemory32(0x00100000, 2);
+    WriteMemory32(0x00400000, 2);
+    const u32 second = states->take();
+
+    // 2. Act
+    ASSERT_TRUE(states->restore(first));
+
+    // 3. Assert: the two pages that differ, and then back again.
+    EXPECT_EQ(states->last_stats().pages_stored, 2u);
+    EXPECT_EQ(ReadMemory32(0x00400000), 0u);
+    ASSERT_TRUE(states->restore(second));
+    EXPECT_EQ(states->last_stats().pages_stored, 2u);
+    EXPECT_EQ(ReadMemory32(0x00100000), 2u);
+    EXPECT_EQ(ReadMemory32(0x00400000), 2u);
+}
+
+TEST_F(SaveStateTest, RestoreBringsBackDeviceState) {
+    // 1. Arrange
+    instance->intc.write32(Intc::INTC_MASK, 1u << INTC_VBLANK_START);
+    instance->dmac.write32(Dmac::D_CTRL, 1);
+    const u32 timer_mode = 0x10000010;
+    instance->timers.write32(timer_mode, tmode::CUE);
+    const u32 id = states->take();
+    const int late = instance->scheduler.register_event("late", &no_event, nullptr);
+
+    // 2. Act: writing the mask bit again flips it off.
+    instance->intc.write32(Intc::INTC_MASK, 1u << INTC_VBLANK_START);
+    instance->dmac.write32(Dmac::D_CTRL, 0);
+    instance->timers.write32(timer_mode, 0);
+    instance->scheduler.schedule(late, 100);
+    ASSERT_TRUE(states->restore(id));
+
+    // 3. Assert: events registered since are there, just not pending.
+    EXPECT_EQ(instance->intc.read32(Intc::INTC_MASK), 1u << INTC_VBLANK_START);
+    EXPECT_EQ(instance->dmac.read32(Dmac::D_CTRL), 1u);
+    EXPECT_EQ(instance->timers.read32(timer_mode) & tmode::CUE, tmode::CUE);
+    EXPECT_FALSE(instance->scheduler.is_pending(late));
+}
+
+TEST_F(SaveStateTest, RestoreBringsBackSoundRam) {
+    // 1. Arrange
+    const u8 sample[16] = { 1, 2, 3, 4 };
+    instance->iop.spu2.write_ram(0x5000, sample, sizeof(sample));
+    const u32 id = states->take();
+
+    // 2. Act
+    const u8 zeros[16] = {};
+    instance->iop.spu2.write_ram(0x5000, zeros, sizeof(zeros));
+    ASSERT_EQ(sound_byte(0x5002), 0);
+    ASSERT_TRUE(states->restore(id));
+
+    // 3. Assert
+    EXPECT_EQ(sound_byte(0x5002), 3);
+}
+
+TEST_F(SaveStateTest, FilesRoundTrip) {
+    // 1. Arrange
+    const std::string path = temp_path();
+    WriteMemory32(0x00100000, 0x12345678);
+    const u32 id = states->take();
+    ASSERT_TRUE(states->write_file(id, path));
+
+    // 2. Act
+    const s64 loaded = states->read_file(path);
+    WriteMemory32(0x00100000, 0);
+
+    // 3. Assert
+    ASSERT_GE(loaded, 0);
+    ASSERT_TRUE(states->restore((u32)loaded));
+    EXPECT_EQ(ReadMemory32(0x00100000), 0x12345678u);
+    unlink(path.c_str());
+}
+
+TEST_F(SaveStateTest, DamagedFilesAreRejected) {
+    // 1. Arrange
+    const std::string path = temp_path();
+    ASSERT_TRUE(states->write_file(states->take(), path));
+
+    // 2. Act
+    ASSERT_EQ(truncate(path.c_str(), 4096), 0);
+
+    // 3. Assert
+    EXPECT_EQ(states->read_file(path), -1);
+    EXPECT_EQ(states->read_file("/nonexistent/state"), -1);
+    unlink(path.c_str());
+}
+
+TEST_F(SaveStateTest, DroppedSnapshotsCannotBeRestored) {
+    const u32 id = states->take();
+    states->drop(id);
+    EXPECT_FALSE(states->has(id));
+    EXPECT_FALSE(states->restore(id));
+}
@@ -0,0 +1,206 @@
+#include "scheduler.h"
+#include <algorithm>
+#include <utility>
+
+Scheduler::Scheduler(cpuRegisters& regs) : regs(regs), event_count(0), heap_size(0), check_requested(false) {
+    update_next_event();
+}
+
+int Scheduler::register_event(const char* name, EventCallback callback, void* user) {
+    if (event_count == MAX_EVENTS) {
+        return -1;
+    }
+    Event& e = events[event_count];
+    e.name = name;
+    e.callback = callback;
+    e.user = user;
+    e.due = 0;
+    e.heap_index = -1;
+    return event_count++;
+}
+
+void Scheduler::schedule(int event, u32 delay) {
+    if (delay > MAX_SLICE) {
+        delay = MAX_SLICE;
+    }
+    Event& e = events[event];
+    e.due = regs.cycle + delay;
+    if (e.heap_index < 0) {
+        e.heap_index = heap_size;
+        heap[heap_size++] = event;
+        sift_up(e.heap_index);
+    } else {
+        sift_up(e.heap_index);
+        sift_down(e.heap_index);
+    }
+    update_next_event();
+}
+
+void Scheduler::cancel(int event) {
+    const int index = events[event].heap_index;
+    if (index >= 0) {
+        remove_at(index);
+        update_next_event();
+    }
+}
+
+bool Scheduler::is_pending(int event) const {
+    return events[event].heap_index >= 0;
+}
+
+u32 Scheduler::cycles_until(int event) const {
+    const Event& e = events[event];
+    if (e.heap_index < 0) {
+        return 0;
+    }
+    const s32 left = (s32)(e.due - regs.cycle);
+    return left > 0 ? (u32)left : 0;
+}
+
+void Scheduler::request_check() {
+    check_requested = true;
+    update_next_event();
+}
+
+void Scheduler::run_due() {
+    const u32 now = regs.cycle;
+    regs.lastEventCycle = now;
+    check_requested = false;
+
+    // Pull the whole batch off the heap first, so a callback that reschedules itself
+    // (or something else) for "now" cannot keep this loop spinning.
+    int batch[MAX_EVENTS];
+    s32 late[MAX_EVENTS];
+    int batch_size = 0;
+    while (heap_size > 0) {
+        const int top = heap[0];
+        const s32 delta = (s32)(now - events[top].due);
+        if (delta < 0) {
+            break;
+        }
+        remove_at(0);
+        batch[batch_size] = top;
+        late[batch_size] = delta;
+        batch_size++;
+    }
+
+    for (int i = 0; i < batch_size; i++) {
+        const Event& e = events[batch[i]];
+        e.callback(e.user, late[i]);
+    }
+
+    update_next_event();
+}
+
+// --- Heap helpers ---
+
+// Earlier due cycle first; ties go to the event registered first so the order in which
+// simultaneous events run is stable.
+bool Scheduler::before(int a, int b) const {
+    const s32 delta = (s32)(events[a].due - events[b].due);
+    return delta < 0 || (delta == 0 && a < b);
+}
+
+void Scheduler::sift_up(int index) {
+    while (index > 0) {
+        const int parent = (index - 1) / 2;
+        if (!before(heap[index], heap[parent])) {
+            break;
+        }
+        std::swap(heap[index], heap[parent]);
+        events[heap[index]].heap_index = index;
+        events[heap[parent]].heap_index = parent;
+        index = parent;
+    }
+}
+
+void Scheduler::sift_down(int index) {
+    while (true) {
+        const int left = index * 2 + 1;
+        const int right = left + 1;
+        int smallest = index;
+        if (left < heap_size && before(heap[left], heap[smallest])) {
+            smallest = left;
+        }
+        if (right < heap_size && before(heap[right], heap[smallest])) {
+            smallest = right;
+        }
+        if (smallest == index) {
+            break;
+        }
+        std::swap(heap[index], heap[smallest]);
+        events[heap[index]].heap_index = index;
+        events[heap[smallest]].heap_index = smallest;
+        index = smallest;
+    }
+}
+
+void Scheduler::remove_at(int index) {
+    const int removed = heap[index];
+    events[removed].heap_index = -1;
+    heap_size--;
+    if (index == heap_size) {
+        return;
+    }
+    heap[index] = heap[heap_size];
+    events[heap[index]].heap_index = index;
+    sift_up(index);
+    sift_down(events[heap[index]].heap_index);
+}
+
+void Scheduler::update_next_event() {
+    if (check_requested) {
+        regs.nextEventCycle = regs.cycle;
+    } else if (heap_size > 0) {
+        regs.nextEventCycle = events[heap[0]].due;
+    } else {
+        regs.nextEventCycle = regs.cycle + MAX_SLICE;
+    }
+}
+
+void Scheduler::save_state(StateWriter& out) const {
+    out.write(event_count);
+    for (int i = 0; i < event_count; i++) {
+        out.write(events[i].due);
+        out.write(events[i].heap_index);
+    }
+    out.write(heap_size);
+    out.write_bytes(heap, sizeof(heap[0]) * heap_size);
+}
+
+bool Scheduler::load_state(StateReader& in) {
+    int count = 0;
+    if (!in.read(count) || count < 0 || count > event_count) {
+        return false;
+    }
+    Event saved[MAX_EVENTS];
+    for (int i = 0; i < count; i++) {
+        if (!in.read(saved[i].due) || !in.read(saved[i].heap_index)) {
+            return false;
+        }
+    }
+    int size = 0;
+    int order[MAX_EVENTS];
+    if (!in.read(size) || size < 0 || size > count || !in.read_bytes(order, sizeof(order[0]) * size)) {
+        return false;
+    }
+    for (int i = 0; i < size; i++) {
+        if (order[i] < 0 || order[i] >= count || saved[order[i]].heap_index != i) {
+            return false;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        if (saved[i].heap_index >= size) {
+            return false;
+        }
+    }
+
+    for (int i = 0; i < event_count; i++) {
+        events[i].due = i < count ? saved[i].due : 0;
+        events[i].heap_index = i < count ? saved[i].heap_index : -1;
+    }
+    std::copy(order, order + size, heap);
+    heap_size = size;
+    update_next_event();
+    return true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "state_stream.h"
+
+// Central event scheduler for everything that happens "later" on the EE side:
+// timers, vsync/hblank, DMA completion, SIF and interrupts.
+//
+// Pending events live in a binary min-heap ordered by due cycle, and the earliest one is
+// mirrored into cpuRegs.nextEventCycle. Recompiled code only ever does
+//
+//     if ((s32)(context.cpuRegs.cycle - context.cpuRegs.nextEventCycle) >= 0) cpu_event_test(context);
+//
+// at block exits, so the cost per block is one compare no matter how many subsystems are
+// registered. The compare is done on the signed difference so it survives `cycle`
+// wrapping around after 2^32 cycles (about 14.5 seconds of EE time).
+
+// Called when an event is due. `cycles_late` is how far past the due cycle the
+// scheduler got to it, so periodic events can reschedule without drifting.
+using EventCallback = void (*)(void* user, s32 cycles_late);
+
+class Scheduler {
+public:
+    static constexpr int MAX_EVENTS = 64;
+
+    // Upper bound on how long recompiled code runs between checks when nothing is pending.
+    // Keeps every due cycle within 2^31 of `cycle`, where the signed compare is exact.
+    static constexpr u32 MAX_SLICE = 1u << 30;
+
+    explicit Scheduler(cpuRegisters& regs);
+
+    /**
+     * @brief Registers an event type. Each type has at most one pending occurrence.
+     * @param name Used for diagnostics only.
+     * @return The event id to pass to schedule()/cancel(), or -1 if the table is full.
+     */
+    int register_event(const char* name, EventCallback callback, void* user);
+
+    /**
+     * @brief Schedules `event` to run `delay` cycles from now, replacing any pending
+     * occurrence of it.
+     */
+    void schedule(int event, u32 delay);
+
+    void cancel(int event);
+    bool is_pending(int event) const;
+
+    // Cycles left before `event` is due (0 if it is due or not pending).
+    u32 cycles_until(int event) const;
+
+    /**
+     * @brief Makes the very next safe-point check enter cpu_event_test(), for state changes
+     * that have to be seen promptly (e.g. a newly raised interrupt). The request holds
+     * through any schedule() or cancel() until run_due() takes it.
+     */
+    void request_check();
+
+    /**
+     * @brief Runs every event that is due, as one batch, then re-arms nextEventCycle.
+     * Events rescheduled by a callback run in the next batch at the earliest.
+     */
+    void run_due();
+
+    const char* event_name(int event) const { return events[event].name; }
+
+    // Save states (see savestate.h): when each pending event is due. Registered events
+    // stay as they are; loading fails if the state has more events than this scheduler.
+    void save_state(StateWriter& out) const;
+    bool load_state(StateReader& in);
+
+private:
+    struct Event {
+        const char* name;
+        EventCallback callback;
+        void* user;
+        u32 due;
+        int heap_index;   // -1 when not pending
+    };
+
+    bool before(int a, int b) const;
+    void sift_up(int index);
+    void sift_down(int index);
+    void remove_at(int index);
+    void update_next_event();
+
+    cpuRegisters& regs;
+    Event events[MAX_EVENTS];
+    int event_count;
+    int heap[MAX_EVENTS];
+    int heap_size;
+    bool check_requested;
+};
@@ -0,0 +1,145 @@
+#include "gtest/gtest.h"
+#include "scheduler.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+// Appends the event's name to a shared log when it fires.
+struct Log {
+    std::vector<std::string> fired;
+    std::vector<s32> late;
+};
+
+struct Probe {
+    Log* log;
+    const char* name;
+
+    static void fire(void* user, s32 cycles_late) {
+        Probe* self = static_cast<Probe*>(user);
+        self->log->fired.push_back(self->name);
+        self->log->late.push_back(cycles_late);
+    }
+};
+
+} // namespace
+
+TEST(SchedulerTest, NextEventCycleTracksEarliestEvent) {
+    cpuRegisters regs = {};
+    Scheduler scheduler(regs);
+    Log log;
+    Probe vsync{ &log, "vsync" }, timer{ &log, "timer" };
+    const int vsync_id = scheduler.register_event("vsync", &Probe::fire, &vsync);
+    const int timer_id = scheduler.register_event("timer", &Probe::fire, &timer);
+
+    scheduler.schedule(vsync_id, 1000);
+    EXPECT_EQ(regs.nextEventCycle, 1000u);
+
+    scheduler.schedule(timer_id, 300);
+    EXPECT_EQ(regs.nextEventCycle, 300u);
+
+    scheduler.cancel(timer_id);
+    EXPECT_FALSE(scheduler.is_pending(timer_id));
+    EXPECT_EQ(regs.nextEventCycle, 1000u);
+}
+
+TEST(SchedulerTest, RunsAllDueEventsAsOneBatchInOrder) {
+    cpuRegisters regs = {};
+    Scheduler scheduler(regs);
+    Log log;
+    Probe a{ &log, "a" }, b{ &log, "b" }, c{ &log, "c" };
+    const int a_id = scheduler.register_event("a", &Probe::fire, &a);
+    const int b_id = scheduler.register_event("b", &Probe::fire, &b);
+    const int c_id = scheduler.register_event("c", &Probe::fire, &c);
+
+    scheduler.schedule(a_id, 50);
+    scheduler.schedule(b_id, 20);
+    scheduler.schedule(c_id, 500);
+
+    // A block ran long and overshot both a and b.
+    regs.cycle = 60;
+    scheduler.run_due();
+
+    ASSERT_EQ(log.fired.size(), 2u);
+    EXPECT_EQ(log.fired[0], "b");
+    EXPECT_EQ(log.fired[1], "a");
+    EXPECT_EQ(log.late[0], 40);
+    EXPECT_EQ(log.late[1], 10);
+    EXPECT_EQ(regs.nextEventCycle, 500u);
+    EXPECT_EQ(regs.lastEventCycle, 60u);
+}
+
+TEST(SchedulerTest, RescheduleReplacesPendingOccurrence) {
+    cpuRegisters regs = {};
+    Scheduler scheduler(regs);
+    Log log;
+    Probe a{ &log, "a" };
+    const int a_id = scheduler.register_event("a", &Probe::fire, &a);
+
+    scheduler.schedule(a_id, 100);
+    scheduler.schedule(a_id, 400);
+    EXPECT_EQ(scheduler.cycles_until(a_id), 400u);
+
+    regs.cycle = 150;
+    scheduler.run_due();
+    EXPECT_TRUE(log.fired.empty());
+    EXPECT_EQ(scheduler.cycles_until(a_id), 250u);
+}
+
+TEST(SchedulerTest, CompareSurvivesCycleWraparound) {
+    cpuRegisters regs = {};
+    regs.cycle = 0xFFFFFF00;
+    Scheduler scheduler(regs);
+    Log log;
+    Probe a{ &log, "a" };
+    const int a_id = scheduler.register_event("a", &Probe::fire, &a);
+
+    scheduler.schedule(a_id, 0x200);
+    EXPECT_EQ(regs.nextEventCycle, 0x100u);
+
+    // The check recompiled code does at every block exit.
+    auto due = [&]() { return (s32)(regs.cycle - regs.nextEventCycle) >= 0; };
+    regs.cycle = 0xFFFFFFF0;
+    EXPECT_FALSE(due());
+    regs.cycle = 0x100;
+    EXPECT_TRUE(due());
+
+    scheduler.run_due();
+    ASSERT_EQ(log.fired.size(), 1u);
+}
+
+TEST(SchedulerTest, IdleSchedulerStillBoundsTheSlice) {
+    cpuRegisters regs = {};
+    regs.cycle = 1234;
+    Scheduler scheduler(regs);
+    EXPECT_EQ(regs.nextEventCycle, 1234u + Scheduler::MAX_SLICE);
+
+    scheduler.request_check();
+    EXPECT_EQ(regs.nextEventCycle, regs.cycle);
+}
+
+TEST(SchedulerTest, CheckRequestsOutliveLaterScheduling) {
+    // 1. Arrange
+    cpuRegisters regs = {};
+    Scheduler scheduler(regs);
+    Log log;
+    Probe timer{ &log, "timer" }, dmac{ &log, "dmac" };
+    const int timer_id = scheduler.register_event("timer", &Probe::fire, &timer);
+    const int dmac_id = scheduler.register_event("dmac", &Probe::fire, &dmac);
+    scheduler.schedule(timer_id, 5000);
+
+    // 2. Act: an interrupt becomes deliverable, then the same block writes device
+    // registers that schedule and cancel events.
+    regs.cycle = 100;
+    scheduler.request_check();
+    scheduler.schedule(dmac_id, 800);
+    scheduler.cancel(timer_id);
+
+    // 3. Assert: the check still happens at the next block exit, and only then does the
+    // heap take over again.
+    EXPECT_EQ(regs.nextEventCycle, 100u);
+    regs.cycle = 120;
+    scheduler.run_due();
+    EXPECT_TRUE(log.fired.empty());
+    EXPECT_EQ(regs.nextEventCycle, 900u);
+}
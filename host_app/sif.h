@@ -0,0 +1,171 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+// The SIF protocol between the game's EE libraries (sifcmd/sifrpc, recompiled with the
+// rest of the game) and the IOP, which is HLE'd (see iop.h).
+//
+// Each side sends the other command packets: a 16-byte header (packet size, extra data
+// size, where the extra data went, command id, option word) followed by the command's
+// fields. The EE DMAs its packets into the IOP's command buffer; the IOP DMAs its own
+// into the buffer the EE announced with CHANGE_SADDR and raises the SIF0 DMA interrupt,
+// whose handler dispatches them.
+//
+// An RPC is BIND (find the server by id, answered with the server's address and the
+// IOP buffer to send arguments to), then CALL (the arguments are already in that
+// buffer), answered with END once the server function is done and its result has been
+// DMAd into the EE's receive buffer. Packet layouts follow the ps2sdk structures.
+
+namespace sif {
+    // EE side of the SIF registers. The EE writes MSCOM/MSFLG, the IOP SMCOM/SMFLG.
+    constexpr u32 REG_START = 0x1000F200;
+    constexpr u32 MSCOM = 0x1000F200;
+    constexpr u32 SMCOM = 0x1000F210;
+    constexpr u32 MSFLG = 0x1000F220;
+    constexpr u32 SMFLG = 0x1000F230;
+    constexpr u32 CTRL = 0x1000F240;
+    constexpr u32 BD6 = 0x1000F260;
+    constexpr u32 REG_END = 0x1000F270;     // exclusive
+
+    // The same registers by their SifGetReg()/SifSetReg() numbers.
+    constexpr u32 REG_MAINADDR = 1;
+    constexpr u32 REG_SUBADDR = 2;
+    constexpr u32 REG_MSFLAG = 3;
+    constexpr u32 REG_SMFLAG = 4;
+
+    // Kernel register the boot leaves the IOP's command buffer address in; sifcmd reads
+    // it before SMCOM.
+    constexpr u32 SYSREG_SUBADDR = 0x80000000;
+
+    // SMFLG bits the IOP sets once each layer is up.
+    constexpr u32 STAT_SIFINIT = 0x10000;
+    constexpr u32 STAT_CMDINIT = 0x20000;
+    constexpr u32 STAT_BOOTEND = 0x40000;
+
+    // System command ids.
+    constexpr u32 CMD_CHANGE_SADDR = 0x80000000;
+    constexpr u32 CMD_SET_SREG = 0x80000001;
+    constexpr u32 CMD_INIT_CMD = 0x80000002;
+    constexpr u32 CMD_RESET = 0x80000003;
+    constexpr u32 CMD_RPC_END = 0x80000008;
+    constexpr u32 CMD_RPC_BIND = 0x80000009;
+    constexpr u32 CMD_RPC_CALL = 0x8000000A;
+    constexpr u32 CMD_RPC_RDATA = 0x8000000C;
+
+    // Software register sceSifInitRpc() waits on.
+    constexpr u32 SREG_RPCINIT = 0;
+
+    // SifDmaTransfer_t, as passed to sceSifSetDma().
+    namespace dma_transfer {
+        constexpr u32 SRC = 0;
+        constexpr u32 DEST = 4;
+        constexpr u32 SIZE = 8;
+        constexpr u32 ATTR = 12;
+        constexpr u32 STRIDE = 16;
+    }
+
+    // SifCmdHeader_t. The first word is psize (bits 0-7) | dsize (bits 8-31).
+    namespace header {
+        constexpr u32 SIZES = 0;
+        constexpr u32 DEST = 4;
+        constexpr u32 CID = 8;
+        constexpr u32 OPT = 12;
+        constexpr u32 SIZE = 16;
+    }
+
+    // Fields after the header. CHANGE_SADDR carries the new address, SET_SREG the
+    // register and its value.
+    namespace change_saddr { constexpr u32 ADDRESS = 16; }
+    namespace set_sreg { constexpr u32 INDEX = 16; constexpr u32 VALUE = 20; constexpr u32 SIZE = 24; }
+
+    // SifRpcPktHeader_t and the packets built on it.
+    namespace rpc {
+        constexpr u32 REC_ID = 16;
+        constexpr u32 PKT_ADDR = 20;
+        constexpr u32 RPC_ID = 24;
+        constexpr u32 CLIENT = 28;      // RDATA: the SifRpcReceiveData_t
+
+        // SifRpcBindPkt_t
+        constexpr u32 BIND_SID = 32;
+
+        // SifRpcCallPkt_t
+        constexpr u32 CALL_NUMBER = 32;
+        constexpr u32 CALL_SEND_SIZE = 36;
+        constexpr u32 CALL_RECEIVE = 40;
+        constexpr u32 CALL_RECV_SIZE = 44;
+        constexpr u32 CALL_RMODE = 48;
+        constexpr u32 CALL_SERVER = 52;
+
+        // SifRpcOtherDataPkt_t
+        constexpr u32 RDATA_SRC = 32;
+        constexpr u32 RDATA_DEST = 36;
+        constexpr u32 RDATA_SIZE = 40;
+
+        // SifRpcRendPkt_t, the IOP's answer to all three.
+        constexpr u32 END_CID = 32;
+        constexpr u32 END_SERVER = 36;
+        constexpr u32 END_BUFF = 40;
+        constexpr u32 END_CBUF = 44;
+        constexpr u32 END_SIZE = 48;
+    }
+}
+
+inline u32 load32(const u8* data, u32 offset) {
+    u32 value;
+    std::memcpy(&value, data + offset, sizeof(value));
+    return value;
+}
+
+inline void store32(u8* data, u32 offset, u32 value) {
+    std::memcpy(data + offset, &value, sizeof(value));
+}
+
+// Bytes a server DMAs into EE RAM besides its reply (a CD read's sectors, say): either
+// `data`, or `size` bytes at `source` that stay put until the call has finished (a
+// mapped file), copied straight from there.
+struct EeWrite {
+    u32 address;
+    std::vector<u8> data;
+    const u8* source = nullptr;
+    u32 size = 0;
+
+    const u8* bytes() const { return source ? source : data.data(); }
+    u32 length() const { return source ? size : (u32)data.size(); }
+};
+
+/**
+ * @brief One RPC call to an HLE IOP server. The server function runs on its module's
+ * worker thread and must not touch EE state: it reads `args` and leaves what goes back
+ * in `reply` and `writes`, which are copied into EE RAM on the EE thread when the call
+ * completes.
+ */
+struct RpcCall {
+    u32 server_id = 0;
+    u32 function = 0;
+    std::vector<u8> args;       // What the EE sent (a copy of the server's IOP buffer)
+    u32 receive_size = 0;       // Room in the EE's receive buffer
+    std::vector<u8> reply;      // Copied to the receive buffer, at most receive_size bytes
+    std::vector<EeWrite> writes;
+    u32 latency = 0;            // EE cycles after the CALL before the result may arrive
+
+    // Word accessors for the usual int-array argument and reply buffers.
+    u32 arg(u32 index) const { return (index + 1) * 4 <= args.size() ? load32(args.data(), index * 4) : 0; }
+    void set_reply(u32 index, u32 value) {
+        if (reply.size() < (index + 1) * 4) {
+            reply.resize((index + 1) * 4);
+        }
+        store32(reply.data(), index * 4, value);
+    }
+
+    // Owned by the IOP while the call is in flight.
+    u8 packet[sif::rpc::END_SIZE] = {};     // The CALL packet, echoed back in the END
+    u32 receive = 0;
+    u32 issued = 0;             // EE cycle of the CALL
+    std::atomic<RpcCall*> next{ nullptr };
+};
+
+// A server function, called on its module's worker thread.
+using RpcFunction = void (*)(void* user, RpcCall& call);
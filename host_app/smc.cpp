@@ -0,0 +1,384 @@
+#include "smc.h"
+#include "fastmem.h"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+namespace {
+
+struct CodeRange {
+    u32 address;
+    u32 size;
+    u32 hash;
+    bool verified;      // Matched its hash since its page last faulted
+    bool replaced;      // Did not match: the handler runs in its place (see smc.h)
+};
+
+const u64 clean_pages[SMC_PAGE_COUNT / 64] = {};
+
+// A user of write tracking, with the pages written since it last collected.
+struct WriteTracker {
+    bool active;
+    u64 pending[SMC_PAGE_COUNT / 64];
+};
+
+} // namespace
+
+struct SmcState {
+    u64 dirty_pages[SMC_PAGE_COUNT / 64] = {};
+    u64 protected_pages[SMC_PAGE_COUNT / 64] = {};     // Protected for the code on them
+    u64 written_pages[SMC_PAGE_COUNT / 64] = {};       // Since any tracker last collected
+    u64 readonly_pages[SMC_PAGE_COUNT / 64] = {};      // Write-protected right now
+    u64 hot_pages[SMC_PAGE_COUNT / 64] = {};           // Left writable, see smc.h
+    u64 streak_pages[SMC_PAGE_COUNT / 64] = {};        // Written in the last collection
+    bool tracking = false;                              // Some tracker is active
+    u32 collections = 0;
+    std::vector<WriteTracker> trackers;
+    u8 fault_counts[SMC_PAGE_COUNT] = {};
+    u8 write_streaks[SMC_PAGE_COUNT] = {};             // Collections in a row, for streak_pages
+    std::vector<CodeRange> code_ranges;
+    std::vector<std::vector<u32>> page_ranges = std::vector<std::vector<u32>>(SMC_PAGE_COUNT);     // Indices into code_ranges
+};
+
+FASTMEM_TLS const u64* smc_dirty_pages = clean_pages;
+static FASTMEM_TLS SmcState* state = nullptr;
+
+namespace {
+
+void default_modified_code_handler(EmotionEngineState&, u32 address) {
+    std::cerr << "FATAL_ERROR: Recompiled code at 0x" << std::hex << address
+              << " was modified at runtime, and there is no interpreter to run the new code." << std::endl;
+    exit(1);
+}
+
+// Process-wide: what to do about modified code does not differ between instances.
+ModifiedCodeHandler modified_code_handler = &default_modified_code_handler;
+
+bool test_bit(const u64* bits, u32 page) {
+    return (bits[page / 64] >> (page % 64)) & 1;
+}
+
+void set_bit(u64* bits, u32 page, bool value) {
+    if (value) {
+        bits[page / 64] |= 1ull << (page % 64);
+    } else {
+        bits[page / 64] &= ~(1ull << (page % 64));
+    }
+}
+
+// A page is write-protected while it holds verified code, and while writes are tracked
+// until it is written, unless it is hot.
+bool wants_readonly(u32 page) {
+    return test_bit(state->protected_pages, page) ||
+           (state->tracking && !test_bit(state->written_pages, page) && !test_bit(state->hot_pages, page));
+}
+
+bool sync_page(u32 page) {
+    const bool readonly = wants_readonly(page);
+    if (readonly == test_bit(state->readonly_pages, page)) {
+        return true;
+    }
+    if (!fastmem_protect_ram_page(page << SMC_PAGE_SHIFT, !readonly)) {
+        return false;
+    }
+    set_bit(state->readonly_pages, page, readonly);
+    return true;
+}
+
+// sync_page() for every page, a run of pages changing the same way at a time.
+bool sync_pages() {
+    bool ok = true;
+    u32 page = 0;
+    while (page < SMC_PAGE_COUNT) {
+        const bool readonly = wants_readonly(page);
+        if (readonly == test_bit(state->readonly_pages, page)) {
+            page++;
+            continue;
+        }
+        u32 end = page + 1;
+        while (end < SMC_PAGE_COUNT && wants_readonly(end) == readonly && test_bit(state->readonly_pages, end) != readonly) {
+            end++;
+        }
+        if (fastmem_protect_ram_range(page << SMC_PAGE_SHIFT, (end - page) << SMC_PAGE_SHIFT, !readonly)) {
+            for (u32 changed = page; changed < end; changed++) {
+                set_bit(state->readonly_pages, changed, readonly);
+            }
+        } else {
+            ok = false;
+        }
+        page = end;
+    }
+    return ok;
+}
+
+void protect_page(u32 page, bool on) {
+    set_bit(state->protected_pages, page, on);
+    if (!sync_page(page) && on) {
+        set_bit(state->protected_pages, page, false);
+    }
+}
+
+// A store to `page`: it no longer holds verified code, and has been written. The caller
+// lifts the protection.
+void mark_written(u32 page, bool fault) {
+    set_bit(state->written_pages, page, true);
+    if (!test_bit(state->protected_pages, page)) {
+        return;
+    }
+    set_bit(state->protected_pages, page, false);
+    set_bit(state->dirty_pages, page, true);
+    if (fault && state->fault_counts[page] < 0xFF) {
+        state->fault_counts[page]++;
+    }
+    for (u32 index : state->page_ranges[page]) {
+        state->code_ranges[index].verified = false;
+    }
+}
+
+// Offset into RAM of a guest address, or -1 if it is not RAM.
+s64 ram_offset(u32 address) {
+    const u8* host = fastmem_translate(address, 1);
+    const u8* ram = fastmem_ram();
+    if (!host || host < ram || host >= ram + fastmem::RAM_SIZE) {
+        return -1;
+    }
+    return host - ram;
+}
+
+// A collection: hot pages count as written, since their writes were not seen, and the
+// pages written this time extend their streaks. Every SMC_HOT_RECHECK collections the hot
+// pages are protected again, to find out which still are.
+void update_hot_pages() {
+    const bool recheck = ++state->collections % SMC_HOT_RECHECK == 0;
+    for (u32 i = 0; i < SMC_PAGE_COUNT / 64; i++) {
+        const u64 written = state->written_pages[i];
+        state->written_pages[i] |= state->hot_pages[i];
+        if (recheck) {
+            state->hot_pages[i] = 0;
+            state->streak_pages[i] = 0;
+            continue;
+        }
+        for (u64 bits = (written | state->streak_pages[i]) & ~state->hot_pages[i]; bits != 0; bits &= bits - 1) {
+            const u32 bit = (u32)__builtin_ctzll(bits);
+            const u32 page = i * 64 + bit;
+            if (!((written >> bit) & 1)) {
+                state->streak_pages[i] &= ~(1ull << bit);
+                continue;
+            }
+            const u32 streak = (state->streak_pages[i] >> bit) & 1 ? state->write_streaks[page] + 1u : 1u;
+            state->write_streaks[page] = (u8)streak;
+            state->streak_pages[i] |= 1ull << bit;
+            if (streak >= SMC_HOT_COLLECTIONS) {
+                state->hot_pages[i] |= 1ull << bit;
+            }
+        }
+    }
+}
+
+// The registered range of a function, or nullptr.
+CodeRange* find_range(u32 offset, u32 size, u32 hash) {
+    for (u32 index : state->page_ranges[smc_page(offset)]) {
+        CodeRange& range = state->code_ranges[index];
+        if (range.address == offset && range.size == size && range.hash == hash) {
+            return &range;
+        }
+    }
+    return nullptr;
+}
+
+void run_modified(EmotionEngineState& context, u32 address) {
+    context.cpuRegs.pc = address;
+    modified_code_handler(context, address);
+}
+
+bool fault_hook(u32 address) {
+    return smc_write_fault(address);
+}
+
+} // namespace
+
+SmcState* smc_create() {
+    return new SmcState();
+}
+
+void smc_destroy(SmcState* destroyed) {
+    if (destroyed == state) {
+        smc_bind(nullptr);
+    }
+    delete destroyed;
+}
+
+void smc_bind(SmcState* bound) {
+    state = bound;
+    smc_dirty_pages = bound ? bound->dirty_pages : clean_pages;
+}
+
+SmcState* smc_current() {
+    return state;
+}
+
+void smc_init() {
+    if (!state) {
+        smc_bind(smc_create());
+    }
+    fastmem_set_write_fault_hook(&fault_hook);
+}
+
+void smc_register_code(u32 address, u32 size, u32 hash) {
+    const s64 offset = ram_offset(address);
+    if (!state || offset < 0 || size == 0) {
+        return;
+    }
+
+    const u32 index = (u32)state->code_ranges.size();
+    state->code_ranges.push_back(CodeRange{ (u32)offset, size, hash, true, false });
+    for (u32 page = smc_page((u32)offset); page <= smc_page((u32)offset + size - 1); page++) {
+        state->page_ranges[page].push_back(index);
+        if (!test_bit(state->dirty_pages, page) && state->fault_counts[page] < SMC_MAX_FAULTS) {
+            protect_page(page, true);
+        }
+    }
+}
+
+bool smc_write_fault(u32 address) {
+    const s64 offset = ram_offset(address);
+    if (!state || offset < 0) {
+        return false;
+    }
+    const u32 page = smc_page((u32)offset);
+    if (!test_bit(state->readonly_pages, page)) {
+        return false;
+    }
+
+    mark_written(page, true);
+    return sync_page(page);
+}
+
+bool smc_verify(EmotionEngineState& context, u32 address, u32 size, u32 hash) {
+    const s64 offset = ram_offset(address);
+    CodeRange* function = state && offset >= 0 ? find_range((u32)offset, size, hash) : nullptr;
+    if (function && function->replaced) {
+        run_modified(context, address);
+        return false;
+    }
+    const u8* code = fastmem_translate(address, size);
+    if (!code || code_hash(code, size) != hash) {
+        // Never verified again, so its page stays dirty and every entry gets here.
+        if (function) {
+            function->replaced = true;
+        }
+        run_modified(context, address);
+        return false;
+    }
+
+    if (!function) {
+        return true;
+    }
+    function->verified = true;
+    for (u32 page = smc_page((u32)offset); page <= smc_page((u32)offset + size - 1); page++) {
+        bool clean = true;
+        for (u32 index : state->page_ranges[page]) {
+            clean = clean && state->code_ranges[index].verified;
+        }
+        // Pages given up on stay dirty, so their functions keep verifying.
+        if (clean && state->fault_counts[page] < SMC_MAX_FAULTS) {
+            set_bit(state->dirty_pages, page, false);
+            protect_page(page, true);
+        }
+    }
+    return true;
+}
+
+void smc_set_modified_code_handler(ModifiedCodeHandler handler) {
+    modified_code_handler = handler ? handler : &default_modified_code_handler;
+}
+
+int smc_track_writes() {
+    if (!state) {
+        return -1;
+    }
+    size_t id = 0;
+    while (id < state->trackers.size() && state->trackers[id].active) {
+        id++;
+    }
+    if (id == state->trackers.size()) {
+        state->trackers.emplace_back();
+    }
+    WriteTracker& tracker = state->trackers[id];
+    tracker.active = true;
+    std::memset(tracker.pending, 0xFF, sizeof(tracker.pending));
+    if (!state->tracking) {
+        state->tracking = true;
+        std::memset(state->written_pages, 0, sizeof(state->written_pages));
+        std::memset(state->hot_pages, 0, sizeof(state->hot_pages));
+        std::memset(state->streak_pages, 0, sizeof(state->streak_pages));
+        state->collections = 0;
+        sync_pages();
+    }
+    return (int)id;
+}
+
+void smc_untrack_writes(int id) {
+    if (!state || id < 0 || (size_t)id >= state->trackers.size()) {
+        return;
+    }
+    state->trackers[id].active = false;
+    for (const WriteTracker& tracker : state->trackers) {
+        if (tracker.active) {
+            return;
+        }
+    }
+    state->tracking = false;
+    sync_pages();
+}
+
+bool smc_collect_written_pages(int id, u64* pages) {
+    if (!state || id < 0 || (size_t)id >= state->trackers.size() || !state->trackers[id].active) {
+        std::memset(pages, 0xFF, sizeof(state->written_pages));
+        return false;
+    }
+    // Every tracker hears about what was written before the pages are protected again.
+    update_hot_pages();
+    for (WriteTracker& tracker : state->trackers) {
+        for (u32 i = 0; i < SMC_PAGE_COUNT / 64; i++) {
+            tracker.pending[i] |= state->written_pages[i];
+        }
+    }
+    std::memset(state->written_pages, 0, sizeof(state->written_pages));
+    WriteTracker& tracker = state->trackers[id];
+    std::memcpy(pages, tracker.pending, sizeof(tracker.pending));
+    std::memset(tracker.pending, 0, sizeof(tracker.pending));
+    if (!sync_pages()) {
+        // Nothing can be protected, so nothing is known to stay clean.
+        std::memset(pages, 0xFF, sizeof(tracker.pending));
+        return false;
+    }
+    return true;
+}
+
+void smc_write_pages(const u64* pages) {
+    if (!state) {
+        return;
+    }
+    for (u32 page = 0; page < SMC_PAGE_COUNT; page++) {
+        if (test_bit(pages, page)) {
+            mark_written(page, false);
+        }
+    }
+    sync_pages();
+}
+
+void smc_reset() {
+    if (!state) {
+        return;
+    }
+    for (u32 page = 0; page < SMC_PAGE_COUNT; page++) {
+        state->page_ranges[page].clear();
+    }
+    state->code_ranges.clear();
+    std::memset(state->dirty_pages, 0, sizeof(state->dirty_pages));
+    std::memset(state->protected_pages, 0, sizeof(state->protected_pages));
+    std::memset(state->fault_counts, 0, sizeof(state->fault_counts));
+    sync_pages();
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "fastmem.h"
+
+// Self-modifying code detection.
+//
+// Every RAM page that recompiled code was generated from is write-protected (at each
+// RAM mirror). The first write to such a page faults; the fault handler marks the page
+// dirty, lifts the protection and lets the write go through, so stores never pay
+// anything. Each recompiled function starts by testing the dirty bits of the pages it
+// was generated from. Once its page is dirty it re-hashes its original bytes: if they
+// still match, it runs as usual, and when every function on the page has matched the
+// page is protected again. If they do not match, the code was replaced (an overlay, a
+// patched jump table...) and the modified code handler is called instead. From then on
+// the function is retired in that state: every entry goes straight to the handler
+// without hashing, and its page stays dirty. The dispatch table is shared by every
+// instance and keeps its entry; the recompiled body never runs again in this one.
+//
+// A page that keeps faulting (code and hot data sharing a page) is left unprotected
+// after SMC_MAX_FAULTS faults, and its functions verify on every entry from then on.
+//
+// Protection needs fastmem (see fastmem.h); without it nothing is ever marked dirty.
+// Views of RAM mapped through the TLB are not protected.
+//
+// The same protection tracks which pages are written at all, for incremental save states
+// (see savestate.h) and frame hashes (frame_hash.h). While anyone tracks writes, a page is
+// also protected until it is first written after each collection, so a page costs one
+// fault per collection however often it is stored to. A page written in
+// SMC_HOT_COLLECTIONS collections in a row is hot: it is left writable and counts as
+// written in every collection, as rehashing it costs less than the fault and protection
+// calls would. Hot pages are protected again every SMC_HOT_RECHECK collections.
+//
+// The state lives in an SmcState per EE instance; the functions below work on the one
+// bound to the calling thread, like fastmem's address space.
+
+constexpr u32 SMC_PAGE_SHIFT = 12;
+constexpr u32 SMC_PAGE_COUNT = (32 * 1024 * 1024) >> SMC_PAGE_SHIFT;
+constexpr u32 SMC_MAX_FAULTS = 8;
+constexpr u32 SMC_HOT_COLLECTIONS = 4;
+constexpr u32 SMC_HOT_RECHECK = 64;
+
+struct SmcState;
+
+// Bit n set: RAM page n was written since it was last verified. Points at an all-clear
+// bitmap while no state is bound.
+extern FASTMEM_TLS const u64* smc_dirty_pages;
+
+// Runs guest code in place of a recompiled function whose code changed, and returns when
+// the recompiled function would have. Called with `context.cpuRegs.pc` set to the
+// function's guest address (also passed as `address`). It must execute the new code from
+// there (e.g. through an interpreter), exits included: recompiled code hands control on
+// by calling the next function, so whatever the new code jumps or falls through to has
+// to run before the handler returns (host_dispatch_jump() does that for jumps to
+// recompiled code). The recompiled function returns straight after.
+//
+// The default handler reports the change as a FATAL_ERROR and exits, as there is no
+// interpreter in the runtime yet.
+using ModifiedCodeHandler = void (*)(EmotionEngineState& context, u32 address);
+
+/**
+ * @brief FNV-1a over a function's original instruction bytes. The recompiler bakes it
+ * into the generated code; the runtime recomputes it over RAM.
+ */
+inline u32 code_hash(const u8* data, u32 size) {
+    u32 hash = 2166136261u;
+    for (u32 i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 16777619u;
+    }
+    return hash;
+}
+
+inline u32 smc_page(u32 address) {
+    return (address & (32 * 1024 * 1024 - 1)) >> SMC_PAGE_SHIFT;
+}
+
+/**
+ * @brief Whether any page of [address, address + size) is dirty. Emitted at the top of
+ * every recompiled function.
+ */
+inline bool smc_range_dirty(u32 address, u32 size) {
+    for (u32 page = smc_page(address); page <= smc_page(address + size - 1); page++) {
+        if (smc_dirty_pages[page / 64] & (1ull << (page % 64))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+SmcState* smc_create();
+void smc_destroy(SmcState* state);
+
+// Makes `state` the calling thread's (nullptr unbinds).
+void smc_bind(SmcState* state);
+SmcState* smc_current();
+
+/**
+ * @brief Hooks the write-fault path of the calling thread's address space, creating and
+ * binding an SmcState first if the thread has none. Call after fastmem_init().
+ */
+void smc_init();
+
+/**
+ * @brief Records a function generated from [address, address + size) with the given
+ * code hash, and write-protects its pages.
+ */
+void smc_register_code(u32 address, u32 size, u32 hash);
+
+/**
+ * @brief Checks a function on a dirty page against its original bytes. Re-protects the
+ * page once everything on it is verified. Emitted at the top of every recompiled
+ * function, after smc_range_dirty().
+ * @return true if the function can run; false if it changed or was retired, in which
+ * case the modified code handler has already run it against `context`.
+ */
+bool smc_verify(EmotionEngineState& context, u32 address, u32 size, u32 hash);
+
+// Process-wide; nullptr restores the default (fatal) handler.
+void smc_set_modified_code_handler(ModifiedCodeHandler handler);
+
+/**
+ * @brief Handles a write fault at a guest address. Called by fastmem's fault handler.
+ * @return true if the fault was on a protected code page (now writable again).
+ */
+bool smc_write_fault(u32 address);
+
+/**
+ * @brief Starts tracking which RAM pages are written, for one more user (save states,
+ * frame hashes). To begin with, every page counts as written for it.
+ * @return The tracker's id, or -1 without a bound state.
+ */
+int smc_track_writes();
+void smc_untrack_writes(int tracker);
+
+/**
+ * @brief Copies the set of pages written since `tracker` last collected into `pages` (a
+ * bit per page), clears it, and protects those pages again.
+ * @return false if writes are not tracked (no such tracker, or no fastmem to protect
+ * pages with), in which case every bit is set.
+ */
+bool smc_collect_written_pages(int tracker, u64* pages);
+
+/**
+ * @brief Counts the pages set in `pages` as written, as a store to each would, and makes
+ * them writable: for host code about to rewrite them where the faults cannot be taken
+ * (restoring a save state on worker threads).
+ */
+void smc_write_pages(const u64* pages);
+
+// Drops every registered function and protection of the bound state (tests, reloading a
+// game).
+void smc_reset();
@@ -0,0 +1,250 @@
+#include "gtest/gtest.h"
+#include "smc.h"
+#include "memory.h"
+#include <vector>
+
+namespace {
+
+std::vector<u32> modified_functions;
+u32 handler_pc;
+
+// Stands in for an interpreter: says where it was asked to start.
+void on_modified_code(EmotionEngineState& context, u32 address) {
+    modified_functions.push_back(address);
+    handler_pc = context.cpuRegs.pc;
+}
+
+constexpr u32 CODE_ADDRESS = 0x00180100;
+constexpr u32 CODE_SIZE = 16;
+
+class SmcTest : public ::testing::Test {
+protected:
+    SmcTest() {
+        EXPECT_TRUE(fastmem_init());
+        smc_init();
+        smc_set_modified_code_handler(&on_modified_code);
+        modified_functions.clear();
+        handler_pc = 0;
+        for (u32 i = 0; i < CODE_SIZE; i += 4) {
+            WriteMemory32(CODE_ADDRESS + i, 0x24020000 + i);     // addiu v0, zero, i
+        }
+        hash = code_hash(main_memory.data() + CODE_ADDRESS, CODE_SIZE);
+        smc_register_code(CODE_ADDRESS, CODE_SIZE, hash);
+    }
+    ~SmcTest() override {
+        smc_reset();
+        smc_set_modified_code_handler(nullptr);
+    }
+
+    EmotionEngineState context{};
+    u32 hash;
+};
+
+} // namespace
+
+#if FASTMEM_ENABLED
+TEST_F(SmcTest, WriteToCodePageMarksItDirty) {
+    // 1. Arrange
+    ASSERT_FALSE(smc_range_dirty(CODE_ADDRESS, CODE_SIZE));
+
+    // 2. Act: a data store elsewhere on the page, through the KSEG0 mirror.
+    WriteMemory32(0x80180F00, 0xCAFEBABE);
+
+    // 3. Assert: the store went through and the function has to check itself.
+    EXPECT_EQ(ReadMemory32(0x00180F00), 0xCAFEBABEu);
+    EXPECT_TRUE(smc_range_dirty(CODE_ADDRESS, CODE_SIZE));
+    EXPECT_FALSE(smc_range_dirty(0x00182000, 4));
+}
+
+TEST_F(SmcTest, UnchangedCodeVerifiesAndIsProtectedAgain) {
+    WriteMemory32(0x00180F00, 1);
+
+    EXPECT_TRUE(smc_verify(context, CODE_ADDRESS, CODE_SIZE, hash));
+    EXPECT_FALSE(smc_range_dirty(CODE_ADDRESS, CODE_SIZE));
+    EXPECT_TRUE(modified_functions.empty());
+
+    // Protected again: the next store is caught too.
+    WriteMemory32(0x00180F00, 2);
+    EXPECT_TRUE(smc_range_dirty(CODE_ADDRESS, CODE_SIZE));
+}
+
+TEST_F(SmcTest, ChangedCodeGoesToTheHandler) {
+    WriteMemory32(CODE_ADDRESS + 4, 0x24030001);
+
+    EXPECT_FALSE(smc_verify(context, CODE_ADDRESS, CODE_SIZE, hash));
+
+    ASSERT_EQ(modified_functions.size(), 1u);
+    EXPECT_EQ(modified_functions[0], CODE_ADDRESS);
+    EXPECT_EQ(handler_pc, CODE_ADDRESS);
+    EXPECT_TRUE(smc_range_dirty(CODE_ADDRESS, CODE_SIZE));
+}
+
+TEST_F(SmcTest, ReplacedFunctionsGoStraightToTheHandler) {
+    // 1. Arrange: a second function on another page.
+    const u32 other_address = 0x00182000;
+    WriteMemory32(other_address, 0x24040001);
+    const u32 other_hash = code_hash(main_memory.data() + other_address, 4);
+    smc_register_code(other_address, 4, other_hash);
+    WriteMemory32(CODE_ADDRESS + 4, 0x24030001);
+    ASSERT_FALSE(smc_verify(context, CODE_ADDRESS, CODE_SIZE, hash));
+
+    // 2. Act: the old code comes back, and the other function's page is written.
+    WriteMemory32(CODE_ADDRESS + 4, 0x24020004);
+    context.cpuRegs.pc = 0;
+    const bool replaced_ran = smc_verify(context, CODE_ADDRESS, CODE_SIZE, hash);
+    WriteMemory32(other_address + 0x100, 1);
+    const bool other_ran = smc_verify(context, other_address, 4, other_hash);
+
+    // 3. Assert: retired all the same, and its page is never protected again.
+    EXPECT_FALSE(replaced_ran);
+    ASSERT_EQ(modified_functions.size(), 2u);
+    EXPECT_EQ(modified_functions[1], CODE_ADDRESS);
+    EXPECT_EQ(handler_pc, CODE_ADDRESS);
+    EXPECT_TRUE(smc_range_dirty(CODE_ADDRESS, CODE_SIZE));
+    EXPECT_TRUE(other_ran);
+    EXPECT_FALSE(smc_range_dirty(other_address, 4));
+}
+
+TEST_F(SmcTest, PagesThatKeepFaultingAreLeftUnprotected) {
+    for (u32 i = 0; i < SMC_MAX_FAULTS; i++) {
+        WriteMemory32(0x00180F00, i);
+        ASSERT_TRUE(smc_verify(context, CODE_ADDRESS, CODE_SIZE, hash));
+    }
+
+    // Still dirty, so the function keeps checking itself on every entry.
+    EXPECT_TRUE(smc_range_dirty(CODE_ADDRESS, CODE_SIZE));
+    WriteMemory32(CODE_ADDRESS, 0);
+    EXPECT_FALSE(smc_verify(context, CODE_ADDRESS, CODE_SIZE, hash));
+    EXPECT_EQ(modified_functions.size(), 1u);
+}
+
+TEST_F(SmcTest, TrackedWritesAreCollectedOncePerPage) {
+    // 1. Arrange: starting counts every page as written.
+    u64 pages[SMC_PAGE_COUNT / 64];
+    const int tracker = smc_track_writes();
+    ASSERT_TRUE(smc_collect_written_pages(tracker, pages));
+    EXPECT_EQ(pages[0], ~0ull);
+
+    // 2. Act: two stores to one data page, one to another through a mirror.
+    WriteMemory32(0x00200000, 1);
+    WriteMemory32(0x00200004, 2);
+    WriteMemory32(0x80300010, 3);
+    const bool tracked = smc_collect_written_pages(tracker, pages);
+
+    // 3. Assert
+    EXPECT_TRUE(tracked);
+    u32 count = 0;
+    for (u64 bits : pages) {
+        count += (u32)__builtin_popcountll(bits);
+    }
+    EXPECT_EQ(count, 2u);
+    EXPECT_TRUE(pages[0x200 / 64] & (1ull << (0x200 % 64)));
+    EXPECT_TRUE(pages[0x300 / 64] & (1ull << (0x300 % 64)));
+    EXPECT_EQ(ReadMemory32(0x00300010), 3u);
+
+    smc_collect_written_pages(tracker, pages);
+    EXPECT_EQ(pages[0x200 / 64], 0u);
+    smc_untrack_writes(tracker);
+}
+
+TEST_F(SmcTest, EachTrackerSeesEveryWrite) {
+    // 1. Arrange
+    u64 pages[SMC_PAGE_COUNT / 64];
+    const int first = smc_track_writes();
+    const int second = smc_track_writes();
+    smc_collect_written_pages(first, pages);
+    smc_collect_written_pages(second, pages);
+
+    // 2. Act: the first tracker collects between the two stores.
+    WriteMemory32(0x00200000, 1);
+    smc_collect_written_pages(first, pages);
+    WriteMemory32(0x00210000, 2);
+
+    // 3. Assert: the second still gets both pages, the first only what came after.
+    smc_collect_written_pages(second, pages);
+    EXPECT_TRUE(pages[0x200 / 64] & (1ull << (0x200 % 64)));
+    EXPECT_TRUE(pages[0x210 / 64] & (1ull << (0x210 % 64)));
+    smc_collect_written_pages(first, pages);
+    EXPECT_FALSE(pages[0x200 / 64] & (1ull << (0x200 % 64)));
+    EXPECT_TRUE(pages[0x210 / 64] & (1ull << (0x210 % 64)));
+    smc_untrack_writes(first);
+    smc_untrack_writes(second);
+}
+
+TEST_F(SmcTest, PagesWrittenEveryCollectionAreLeftWritable) {
+    // 1. Arrange
+    u64 pages[SMC_PAGE_COUNT / 64];
+    const int tracker = smc_track_writes();
+    smc_collect_written_pages(tracker, pages);
+    for (u32 i = 0; i < SMC_HOT_COLLECTIONS; i++) {
+        WriteMemory32(0x00200000, i);
+        smc_collect_written_pages(tracker, pages);
+    }
+
+    // 2. Act: no store this time.
+    smc_collect_written_pages(tracker, pages);
+
+    // 3. Assert: still counted, without a fault, until a recheck finds it quiet.
+    EXPECT_TRUE(pages[0x200 / 64] & (1ull << (0x200 % 64)));
+    EXPECT_FALSE(smc_write_fault(0x00200000));
+    for (u32 i = 0; i < SMC_HOT_RECHECK; i++) {
+        smc_collect_written_pages(tracker, pages);
+    }
+    EXPECT_FALSE(pages[0x200 / 64] & (1ull << (0x200 % 64)));
+    EXPECT_TRUE(smc_write_fault(0x00200000));
+    smc_untrack_writes(tracker);
+}
+
+TEST_F(SmcTest, TrackingKeepsCodePagesProtected) {
+    // 1. Arrange
+    u64 pages[SMC_PAGE_COUNT / 64];
+    const int tracker = smc_track_writes();
+    smc_collect_written_pages(tracker, pages);
+
+    // 2. Act: a store to the code page is seen by both.
+    WriteMemory32(0x00180F00, 1);
+    smc_collect_written_pages(tracker, pages);
+
+    // 3. Assert: stopping tracking leaves the code page's protection to SMC.
+    EXPECT_TRUE(pages[0x180 / 64] & (1ull << (0x180 % 64)));
+    EXPECT_TRUE(smc_range_dirty(CODE_ADDRESS, CODE_SIZE));
+    smc_untrack_writes(tracker);
+    EXPECT_TRUE(smc_verify(context, CODE_ADDRESS, CODE_SIZE, hash));
+    EXPECT_FALSE(smc_range_dirty(CODE_ADDRESS, CODE_SIZE));
+    WriteMemory32(0x00180F00, 2);
+    EXPECT_TRUE(smc_range_dirty(CODE_ADDRESS, CODE_SIZE));
+}
+
+TEST_F(SmcTest, HostRewritesCountAsWrites) {
+    // 1. Arrange
+    u64 pages[SMC_PAGE_COUNT / 64];
+    const int tracker = smc_track_writes();
+    smc_collect_written_pages(tracker, pages);
+    u64 rewrite[SMC_PAGE_COUNT / 64] = {};
+    rewrite[0x180 / 64] |= 1ull << (0x180 % 64);
+
+    // 2. Act
+    smc_write_pages(rewrite);
+
+    // 3. Assert: the page is writable without a fault, and its code has to check itself.
+    EXPECT_TRUE(smc_range_dirty(CODE_ADDRESS, CODE_SIZE));
+    EXPECT_FALSE(smc_write_fault(0x00180F00));
+    smc_collect_written_pages(tracker, pages);
+    EXPECT_TRUE(pages[0x180 / 64] & (1ull << (0x180 % 64)));
+    smc_untrack_writes(tracker);
+}
+#endif
+
+TEST_F(SmcTest, UntrackedWritesReportEveryPage) {
+    u64 pages[SMC_PAGE_COUNT / 64] = {};
+    EXPECT_FALSE(smc_collect_written_pages(-1, pages));
+    EXPECT_EQ(pages[0], ~0ull);
+    EXPECT_EQ(pages[SMC_PAGE_COUNT / 64 - 1], ~0ull);
+}
+
+TEST_F(SmcTest, CodeHashCoversEveryByte) {
+    const u8 a[] = { 0x00, 0x00, 0x02, 0x24 };
+    const u8 b[] = { 0x00, 0x00, 0x03, 0x24 };
+    EXPECT_NE(code_hash(a, 4), code_hash(b, 4));
+    EXPECT_EQ(code_hash(a, 4), code_hash(a, 4));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <atomic>
+
+// Bounded lock-free ring for one producer thread and one consumer thread. Items are
+// copied in and out; a push or pop is one acquire load of the other side's index (only
+// when the cached copy says full or empty) and one release store of its own. Neither
+// side ever blocks: push() fails when the ring is full, pop() when it is empty.
+//
+// T must be trivially copyable. CAPACITY must be a power of two.
+
+template <typename T, u32 CAPACITY>
+class SpscRing {
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : head(0), cached_tail(0), tail(0), cached_head(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer thread only. False if the ring is full.
+    bool push(const T& item) {
+        const u32 position = head.load(std::memory_order_relaxed);
+        if (position - cached_tail == CAPACITY) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (position - cached_tail == CAPACITY) {
+                return false;
+            }
+        }
+        slots[position & (CAPACITY - 1)] = item;
+        head.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer thread only. False if the ring is empty.
+    bool pop(T& item) {
+        const u32 position = tail.load(std::memory_order_relaxed);
+        if (position == cached_head) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (position == cached_head) {
+                return false;
+            }
+        }
+        item = slots[position & (CAPACITY - 1)];
+        tail.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    // Each side's index and its cached copy of the other's share a cache line.
+    alignas(64) std::atomic<u32> head;      // Producer
+    u32 cached_tail;
+    alignas(64) std::atomic<u32> tail;      // Consumer
+    u32 cached_head;
+    alignas(64) T slots[CAPACITY];
+};
@@ -0,0 +1,517 @@
+#include "spu2.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iterator>
+
+namespace {
+
+constexpr s32 ENVELOPE_MAX = 0x7FFF;
+constexpr u32 PITCH_MAX = 0x3FFF;
+
+// Falling behind by more than this (a stalled host) starts the clock over instead of
+// rushing to catch up.
+constexpr auto MAX_LAG = std::chrono::milliseconds(100);
+
+// The reverb presets of sceSdSetEffectAttr(), by mode. Pipe is not here and plays dry.
+constexpr ReverbRegisters REVERB_PRESETS[] = {
+    // Off
+    {},
+    // Room
+    { 0x007D, 0x005B, 0x6D80, 0x54B8, 0xBED0, 0x0000, 0x0000, 0xBA80, 0x5800, 0x5300, 0x04D6, 0x0333, 0x03F0, 0x0227,
+      0x0374, 0x01EF, 0x0334, 0x01B5, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x01B4, 0x0136,
+      0x00B8, 0x005C, 0x8000, 0x8000 },
+    // Studio A (small)
+    { 0x0033, 0x0025, 0x70F0, 0x4FA8, 0xBCE0, 0x4410, 0xC0F0, 0x9C00, 0x5280, 0x4EC0, 0x03E4, 0x031B, 0x03A4, 0x02AF,
+      0x0372, 0x0266, 0x031C, 0x025D, 0x025C, 0x018E, 0x022F, 0x0135, 0x01D2, 0x00B7, 0x018F, 0x00B5, 0x00B4, 0x0080,
+      0x004C, 0x0026, 0x8000, 0x8000 },
+    // Studio B (medium)
+    { 0x00B1, 0x007F, 0x70F0, 0x4FA8, 0xBCE0, 0x4510, 0xBEF0, 0xB4C0, 0x5280, 0x4EC0, 0x0904, 0x076B, 0x0824, 0x065F,
+      0x07A2, 0x0616, 0x076C, 0x05ED, 0x05EC, 0x042E, 0x050F, 0x0305, 0x0462, 0x02B7, 0x042F, 0x0265, 0x0264, 0x01B2,
+      0x0100, 0x0080, 0x8000, 0x8000 },
+    // Studio C (large)
+    { 0x00E3, 0x00A9, 0x6F60, 0x4FA8, 0xBCE0, 0x4510, 0xBEF0, 0xA680, 0x5680, 0x52C0, 0x0DFB, 0x0B58, 0x0D09, 0x0A3C,
+      0x0BD9, 0x0973, 0x0B59, 0x08DA, 0x08D9, 0x05E9, 0x07EC, 0x04B0, 0x06EF, 0x03D2, 0x05EA, 0x031D, 0x031C, 0x0238,
+      0x0154, 0x00AA, 0x8000, 0x8000 },
+    // Hall
+    { 0x01A5, 0x0139, 0x6000, 0x5000, 0x4C00, 0xB800, 0xBC00, 0xC000, 0x6000, 0x5C00, 0x15BA, 0x11BB, 0x14C2, 0x10BD,
+      0x11BC, 0x0DC1, 0x11C0, 0x0DC3, 0x0DC0, 0x09C1, 0x0BC4, 0x07C1, 0x0A00, 0x06CD, 0x09C2, 0x05C1, 0x05C0, 0x041A,
+      0x0274, 0x013A, 0x8000, 0x8000 },
+    // Space
+    { 0x033D, 0x0231, 0x7E00, 0x5000, 0xB400, 0xB000, 0x4C00, 0xB000, 0x6000, 0x5400, 0x1ED6, 0x1A31, 0x1D14, 0x183B,
+      0x1BC2, 0x16B2, 0x1A32, 0x15EF, 0x15EE, 0x1055, 0x1334, 0x0F2D, 0x11F6, 0x0C5D, 0x1056, 0x0AE1, 0x0AE0, 0x07A2,
+      0x0464, 0x0232, 0x8000, 0x8000 },
+    // Echo
+    { 0x0001, 0x0001, 0x7FFF, 0x7FFF, 0x0000, 0x0000, 0x0000, 0x8100, 0x0000, 0x0000, 0x1FFF, 0x0FFF, 0x1005, 0x0005,
+      0x0000, 0x0000, 0x1005, 0x0005, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1004, 0x1002,
+      0x0004, 0x0002, 0x8000, 0x8000 },
+    // Delay
+    { 0x0001, 0x0001, 0x7FFF, 0x7FFF, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1FFF, 0x0FFF, 0x1005, 0x0005,
+      0x0000, 0x0000, 0x1005, 0x0005, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x1004, 0x1002,
+      0x0004, 0x0002, 0x8000, 0x8000 },
+};
+
+// A 15-bit fixed volume (bit 15 clear) as a 1.15 factor. Sweeps keep the last one.
+void fixed_volume(u32 value, s16& volume) {
+    if (!(value & 0x8000)) {
+        volume = (s16)(value << 1);
+    }
+}
+
+// How an envelope moves at `rate` (0-127): by `step` every `cycles` samples.
+struct EnvelopeRate {
+    s32 step;
+    u32 cycles;
+};
+
+EnvelopeRate envelope_rate(u32 rate, bool decrease) {
+    const s32 shift = (s32)(rate >> 2) - 11;
+    const s32 step = decrease ? -8 + (s32)(rate & 3) : 7 - (s32)(rate & 3);
+    return shift < 0 ? EnvelopeRate{ step * (1 << -shift), 1 } : EnvelopeRate{ step, 1u << shift };
+}
+
+} // namespace
+
+Spu2::Spu2()
+    : decode(adpcm_select()), mix(mix_voice_select()), interpolate(interpolate_select()), reverb(reverb_select()),
+      ram(new s16[RAM_SIZE / 2]()), cores(), published_endx(),
+      published_envelope(), thread_running(false), stop_requested(false), sink(nullptr), sink_user(nullptr) {}
+
+Spu2::~Spu2() {
+    stop();
+    std::lock_guard<std::mutex> lock(state_mutex);
+    drain();
+}
+
+u16 Spu2::envelope(u32 core, u32 voice) const {
+    return published_envelope[(core & 1) * VOICES + voice % VOICES].load(std::memory_order_relaxed);
+}
+
+// --- Producer side ---
+
+void Spu2::write_param(u32 entry, u32 value) {
+    push(Message{ Write::Param, entry, value, nullptr });
+}
+
+void Spu2::write_switch(u32 entry, u32 value) {
+    push(Message{ Write::Switch, entry, value, nullptr });
+}
+
+void Spu2::write_address(u32 entry, u32 value) {
+    push(Message{ Write::Address, entry, value, nullptr });
+}
+
+void Spu2::write_core_attr(u32 entry, u32 value) {
+    push(Message{ Write::CoreAttr, entry, value, nullptr });
+}
+
+void Spu2::write_effect_mode(u32 core, u32 mode) {
+    push(Message{ Write::EffectMode, core, mode, nullptr });
+}
+
+void Spu2::write_ram(u32 address, const u8* data, u32 size) {
+    u8* copy = new u8[size];
+    std::memcpy(copy, data, size);
+    push(Message{ Write::Ram, address, size, copy });
+}
+
+// A full ring waits for the audio thread. With no thread to wait for, the producer
+// applies the queue itself under the lock a renderer would hold.
+void Spu2::push(const Message& message) {
+    while (!queue.push(message)) {
+        if (running()) {
+            std::this_thread::yield();
+        } else {
+            std::lock_guard<std::mutex> lock(state_mutex);
+            drain();
+        }
+    }
+}
+
+// --- Consumer side ---
+
+void Spu2::drain() {
+    Message message;
+    while (queue.pop(message)) {
+        apply(message);
+    }
+}
+
+void Spu2::apply(const Message& message) {
+    using namespace spu2;
+    Core& core = cores[entry_core(message.entry)];
+    Voice& voice = core.voices[entry_voice(message.entry) % VOICES];
+    const u32 value = message.value;
+    switch (message.kind) {
+        case Write::Param:
+            switch (message.entry & ENTRY_REGISTER_MASK) {
+                case VP_VOLL: fixed_volume(value, voice.volume[0]); break;
+                case VP_VOLR: fixed_volume(value, voice.volume[1]); break;
+                case VP_PITCH: voice.pitch = (u16)std::min(value & 0xFFFF, PITCH_MAX); break;
+                case VP_ADSR1: voice.adsr1 = (u16)value; break;
+                case VP_ADSR2: voice.adsr2 = (u16)value; break;
+                case P_MVOLL: fixed_volume(value, core.main_volume[0]); break;
+                case P_MVOLR: fixed_volume(value, core.main_volume[1]); break;
+                case P_EVOLL: fixed_volume(value, core.effect_volume[0]); break;
+                case P_EVOLR: fixed_volume(value, core.effect_volume[1]); break;
+            }
+            break;
+        case Write::Switch:
+            switch (message.entry & ENTRY_REGISTER_MASK) {
+                case S_KON:
+                    for (u32 i = 0; i < VOICES; i++) {
+                        if (value & (1u << i)) {
+                            key_on(core.voices[i]);
+                            core.endx &= ~(1u << i);
+                        }
+                    }
+                    break;
+                case S_KOFF:
+                    for (u32 i = 0; i < VOICES; i++) {
+                        if (value & (1u << i)) {
+                            key_off(core.voices[i]);
+                        }
+                    }
+                    break;
+                case S_VMIXL: core.vmix[0] = value; break;
+                case S_VMIXR: core.vmix[1] = value; break;
+                case S_VMIXEL: core.vmix_effect[0] = value; break;
+                case S_VMIXER: core.vmix_effect[1] = value; break;
+            }
+            break;
+        case Write::Address:
+            switch (message.entry & ENTRY_REGISTER_MASK) {
+                case VA_SSA: voice.ssa = value & (RAM_SIZE - 1); break;
+                case VA_LSAX:
+                    voice.lsa = value & (RAM_SIZE - 1);
+                    voice.lsa_set = true;
+                    break;
+                case VA_NAX: voice.nax = value & (RAM_SIZE - 1); break;
+                case A_ESA:
+                    core.esa = value & (RAM_SIZE - 1);
+                    update_reverb(core);
+                    break;
+                case A_EEA:
+                    core.eea = value & (RAM_SIZE - 1);
+                    update_reverb(core);
+                    break;
+            }
+            break;
+        case Write::CoreAttr:
+            if (value) {
+                core.attributes |= 1u << (message.entry & 0xE);
+            } else {
+                core.attributes &= ~(1u << (message.entry & 0xE));
+            }
+            break;
+        case Write::EffectMode:
+            core.effect_mode = value & ~EFFECT_MODE_CLEAR;
+            update_reverb(core);
+            if ((value & EFFECT_MODE_CLEAR) && core.reverb.size) {
+                std::fill(ram.get() + core.esa / 2, ram.get() + core.esa / 2 + core.reverb.size, 0);
+            }
+            break;
+        case Write::Ram: {
+            const u32 address = message.entry & (RAM_SIZE - 1);
+            const u32 first = std::min(value, RAM_SIZE - address);
+            std::memcpy(ram_bytes() + address, message.data, first);
+            std::memcpy(ram_bytes(), message.data + first, value - first);
+            delete[] message.data;
+            break;
+        }
+    }
+}
+
+void Spu2::key_on(Voice& voice) {
+    voice.phase = Phase::Attack;
+    voice.level = 0;
+    voice.counter = 0;
+    voice.nax = voice.ssa;
+    voice.lsa_set = false;
+    voice.position = 0;
+    voice.fraction = 0;
+    voice.history[0] = voice.history[1] = 0;
+    std::memset(voice.window, 0, sizeof(voice.window));
+    voice.block = ~0u;          // Decoded on its first sample
+}
+
+void Spu2::key_off(Voice& voice) {
+    if (voice.phase != Phase::Off) {
+        voice.phase = Phase::Release;
+        voice.counter = 0;
+    }
+}
+
+// The work area is ESA to EEA, both included, in samples.
+void Spu2::update_reverb(Core& core) {
+    const u32 start = core.esa / 2;
+    const u32 end = core.eea / 2;
+    if (core.effect_mode == spu2::EFFECT_MODE_OFF || core.effect_mode >= std::size(REVERB_PRESETS) || end <= start) {
+        core.reverb.size = 0;
+        return;
+    }
+    const u32 size = end - start + 1;
+    reverb_prepare(REVERB_PRESETS[core.effect_mode], size, core.reverb);
+    core.reverb_position %= size;
+}
+
+// Decodes the block at NAX into the window and moves NAX past it.
+void Spu2::load_block(Voice& voice) {
+    voice.block = voice.nax & ~(ADPCM_BLOCK_BYTES - 1);
+    const u8* block = ram_bytes() + voice.block;
+    voice.flags = block[1];
+    if ((voice.flags & ADPCM_LOOP_START) && !voice.lsa_set) {
+        voice.lsa = voice.block;
+    }
+    std::memcpy(voice.window, voice.window + ADPCM_BLOCK_SAMPLES, 3 * sizeof(s16));
+    decode(block, voice.window + 3, voice.history);
+    voice.nax = (voice.block + ADPCM_BLOCK_BYTES) & (RAM_SIZE - 1);
+}
+
+// The voice's samples at its pitch, Gaussian interpolated a block at a time: each run of
+// output plays from the block in the window, then the position moves on past it. A block
+// with the loop end flag sets ENDX once it has played, then jumps to the loop start.
+// Without the repeat flag the sample is over: the rest of the chunk is silent and the
+// result false.
+bool Spu2::voice_samples(Voice& voice, u32 core, u32 index, s16* out, u32 frames) {
+    if (voice.block == ~0u) {
+        load_block(voice);
+    }
+    u32 done = 0;
+    while (done < frames) {
+        u32 run = frames - done;
+        if (voice.pitch) {
+            const u32 to_end = ((ADPCM_BLOCK_SAMPLES - voice.position) << 12) - voice.fraction;
+            run = std::min(run, (to_end - 1) / voice.pitch + 1);
+        }
+        interpolate(voice.window + voice.position, voice.fraction, voice.pitch, out + done, run);
+        done += run;
+
+        const u32 phase = voice.fraction + voice.pitch * run;
+        voice.position += phase >> 12;
+        voice.fraction = phase & 0xFFF;
+        if (voice.position >= ADPCM_BLOCK_SAMPLES) {
+            voice.position -= ADPCM_BLOCK_SAMPLES;
+            if (voice.flags & ADPCM_LOOP_END) {
+                cores[core].endx |= 1u << index;
+                if (!(voice.flags & ADPCM_LOOP_REPEAT)) {
+                    std::fill(out + done, out + frames, 0);
+                    return false;
+                }
+                voice.nax = voice.lsa;
+            }
+            load_block(voice);
+        }
+    }
+    return true;
+}
+
+// The envelope level for each sample of the chunk. Between steps the level holds, so it
+// is filled in as runs.
+void Spu2::voice_envelope(Voice& voice, s16* out, u32 frames) {
+    u32 done = 0;
+    while (done < frames) {
+        bool decrease = false;
+        bool exponential = false;
+        u32 rate = 0;
+        switch (voice.phase) {
+            case Phase::Off:
+                std::fill(out + done, out + frames, 0);
+                return;
+            case Phase::Attack:
+                rate = (voice.adsr1 >> 8) & 0x7F;
+                exponential = (voice.adsr1 & 0x8000) != 0;
+                break;
+            case Phase::Decay:
+                rate = ((voice.adsr1 >> 4) & 0xF) << 2;
+                decrease = true;
+                exponential = true;
+                break;
+            case Phase::Sustain:
+                rate = (voice.adsr2 >> 6) & 0x7F;
+                decrease = (voice.adsr2 & 0x4000) != 0;
+                exponential = (voice.adsr2 & 0x8000) != 0;
+                break;
+            case Phase::Release:
+                rate = (voice.adsr2 & 0x1F) << 2;
+                decrease = true;
+                exponential = (voice.adsr2 & 0x20) != 0;
+                break;
+        }
+        const s32 sustain_level = (s32)((voice.adsr1 & 0xF) + 1) * 0x800;
+        if (voice.phase == Phase::Decay && voice.level <= sustain_level) {
+            voice.phase = Phase::Sustain;
+            continue;
+        }
+        EnvelopeRate step = envelope_rate(rate, decrease);
+        if (exponential && !decrease && voice.level > 0x6000) {
+            step.cycles *= 4;
+        }
+        if (exponential && decrease) {
+            step.step = step.step * voice.level / 0x8000;
+        }
+
+        const u32 run = std::min(frames - done, step.cycles - std::min(voice.counter, step.cycles - 1));
+        std::fill(out + done, out + done + run, (s16)voice.level);
+        done += run;
+        voice.counter += run;
+        if (voice.counter < step.cycles) {
+            continue;
+        }
+        voice.counter = 0;
+        voice.level = std::min(ENVELOPE_MAX, std::max(0, voice.level + step.step));
+
+        switch (voice.phase) {
+            case Phase::Attack:
+                if (voice.level == ENVELOPE_MAX) {
+                    voice.phase = Phase::Decay;
+                }
+                break;
+            case Phase::Decay:
+                if (voice.level <= sustain_level) {
+                    voice.phase = Phase::Sustain;
+                }
+                break;
+            case Phase::Release:
+                if (voice.level == 0) {
+                    voice.phase = Phase::Off;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+void Spu2::render(s16* out, u32 frames) {
+    std::lock_guard<std::mutex> lock(state_mutex);
+    drain();
+
+    alignas(16) s32 output[2][CHUNK_FRAMES] = {};
+    for (u32 offset = 0; offset < frames; offset += CHUNK_FRAMES) {
+        const u32 count = std::min(frames - offset, CHUNK_FRAMES);
+        std::memset(output, 0, sizeof(output));
+        for (u32 c = 0; c < CORES; c++) {
+            Core& core = cores[c];
+            alignas(16) s32 dry[2][CHUNK_FRAMES] = {};
+            alignas(16) s32 wet[2][CHUNK_FRAMES] = {};
+            for (u32 v = 0; v < VOICES; v++) {
+                Voice& voice = core.voices[v];
+                if (voice.phase == Phase::Off) {
+                    continue;
+                }
+                alignas(16) s16 levels[CHUNK_FRAMES];
+                alignas(16) s16 samples[CHUNK_FRAMES];
+                const bool playing = voice_samples(voice, c, v, samples, count);
+                voice_envelope(voice, levels, count);
+                if (!playing) {
+                    voice.phase = Phase::Off;
+                    voice.level = 0;
+                }
+                const s16 left = core.vmix[0] & (1u << v) ? voice.volume[0] : 0;
+                const s16 right = core.vmix[1] & (1u << v) ? voice.volume[1] : 0;
+                if (left || right) {
+                    mix(samples, levels, left, right, dry[0], dry[1], count);
+                }
+                const s16 effect_left = core.vmix_effect[0] & (1u << v) ? voice.volume[0] : 0;
+                const s16 effect_right = core.vmix_effect[1] & (1u << v) ? voice.volume[1] : 0;
+                if (effect_left || effect_right) {
+                    mix(samples, levels, effect_left, effect_right, wet[0], wet[1], count);
+                }
+            }
+            // The reverb keeps running (and its tail ringing) with nothing sent to it.
+            if ((core.attributes & (1u << spu2::CORE_EFFECT_ENABLE)) && core.reverb.size) {
+                alignas(16) s32 reverb_out[2][CHUNK_FRAMES];
+                reverb(core.reverb, ram.get() + core.esa / 2, core.reverb_position, wet[0], wet[1], reverb_out[0],
+                       reverb_out[1], count);
+                for (u32 side = 0; side < 2; side++) {
+                    for (u32 i = 0; i < count; i++) {
+                        dry[side][i] += (reverb_out[side][i] * core.effect_volume[side]) >> 15;
+                    }
+                }
+            }
+            if (core.attributes & (1u << spu2::CORE_MUTE_ENABLE)) {
+                continue;
+            }
+            for (u32 side = 0; side < 2; side++) {
+                for (u32 i = 0; i < count; i++) {
+                    const s32 clamped = std::min(32767, std::max(-32768, dry[side][i]));
+                    output[side][i] += (clamped * core.main_volume[side]) >> 15;
+                }
+            }
+        }
+        for (u32 i = 0; i < count; i++) {
+            out[(offset + i) * 2] = (s16)std::min(32767, std::max(-32768, output[0][i]));
+            out[(offset + i) * 2 + 1] = (s16)std::min(32767, std::max(-32768, output[1][i]));
+        }
+    }
+    publish();
+}
+
+void Spu2::publish() {
+    for (u32 c = 0; c < CORES; c++) {
+        published_endx[c].store(cores[c].endx, std::memory_order_relaxed);
+        for (u32 v = 0; v < VOICES; v++) {
+            published_envelope[c * VOICES + v].store((u16)cores[c].voices[v].level, std::memory_order_relaxed);
+        }
+    }
+}
+
+std::unique_lock<std::mutex> Spu2::lock_state() {
+    std::unique_lock<std::mutex> lock(state_mutex);
+    drain();
+    return lock;
+}
+
+void Spu2::save_state(StateWriter& out) const {
+    out.write(cores);
+}
+
+bool Spu2::load_state(StateReader& in) {
+    Core loaded[CORES];
+    if (!in.read(loaded)) {
+        return false;
+    }
+    std::copy(std::begin(loaded), std::end(loaded), std::begin(cores));
+    publish();
+    return true;
+}
+
+// --- Audio thread ---
+
+void Spu2::start(AudioSink new_sink, void* user) {
+    if (running()) {
+        return;
+    }
+    sink = new_sink;
+    sink_user = user;
+    stop_requested.store(false, std::memory_order_relaxed);
+    thread_running.store(true, std::memory_order_release);
+    thread = std::thread(&Spu2::run, this);
+}
+
+void Spu2::stop() {
+    if (!thread.joinable()) {
+        return;
+    }
+    stop_requested.store(true, std::memory_order_release);
+    thread.join();
+    thread_running.store(false, std::memory_order_release);
+}
+
+void Spu2::run() {
+    alignas(16) s16 chunk[CHUNK_FRAMES * 2];
+    auto next = std::chrono::steady_clock::now();
+    while (!stop_requested.load(std::memory_order_acquire)) {
+        render(chunk, CHUNK_FRAMES);
+        if (sink) {
+            sink(sink_user, chunk, CHUNK_FRAMES);
+        }
+        next += std::chrono::milliseconds(1);
+        const auto now = std::chrono::steady_clock::now();
+        if (now - next > MAX_LAG) {
+            next = now;
+        }
+        std::this_thread::sleep_until(next);
+    }
+}
@@ -0,0 +1,254 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "spsc_ring.h"
+#include "spu2_dsp.h"
+#include "state_stream.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// The SPU2's voice engine: 2 cores of 24 voices playing ADPCM out of their own 2 MB of
+// sound RAM, each through an ADSR envelope, pitch and volume, mixed to 48 kHz stereo
+// (see "Sound Processing Unit (SPU2)" in docs/ps2_docs.txt).
+//
+// The sound server (iop_sound.h) forwards what the game sets as it sets it, from the
+// IOP's sound worker thread; the engine runs on an audio thread of its own. Between the
+// two is a lock-free single-producer ring of register writes and sample uploads, which
+// the audio thread drains at the start of every chunk. Nothing else is shared but the
+// voice status the game polls (ENDX, ENVX), published once per chunk.
+//
+// The audio thread mixes 1 ms (48 frames) at a time and hands each chunk to a sink, paced
+// by the host clock. Within a chunk a voice decodes whole ADPCM blocks, is resampled a
+// block's worth of samples at a time, computes its envelope as runs of constant level and
+// is mixed in; each core then runs the voices sent to its effect through the reverb, in
+// the work area between ESA and EEA. All of it is the block kernels of spu2_dsp.h. Without
+// a sink (a headless machine) the chunks are mixed and dropped; wav_file.h writes them to
+// a file.
+//
+// Not modelled: pitch modulation (PMON), noise (NON), volume sweeps (a sweeping volume
+// holds where it was), the SPU2 interrupt, core 0 feeding core 1 (both cores mix straight
+// into the output), the pipe reverb preset and the delay and feedback of echo and delay.
+
+// `frames` interleaved left/right samples, from the audio thread.
+using AudioSink = void (*)(void* user, const s16* frames, u32 count);
+
+namespace spu2 {
+
+// Registers as libsd numbers its entries: core in bit 0, voice in bits 1-5, the register
+// in the rest.
+constexpr u32 ENTRY_REGISTER_MASK = 0xFFC0;
+
+// Voice parameters.
+constexpr u32 VP_VOLL = 0x0000;
+constexpr u32 VP_VOLR = 0x0100;
+constexpr u32 VP_PITCH = 0x0200;
+constexpr u32 VP_ADSR1 = 0x0300;
+constexpr u32 VP_ADSR2 = 0x0400;
+constexpr u32 VP_ENVX = 0x0500;
+constexpr u32 VP_VOLXL = 0x0600;
+constexpr u32 VP_VOLXR = 0x0700;
+// Core parameters.
+constexpr u32 P_MMIX = 0x0800;
+constexpr u32 P_MVOLL = 0x0980;
+constexpr u32 P_MVOLR = 0x0A80;
+constexpr u32 P_EVOLL = 0x0B80;
+constexpr u32 P_EVOLR = 0x0C80;
+// Switches, a bit per voice of the core.
+constexpr u32 S_PMON = 0x1300;
+constexpr u32 S_NON = 0x1400;
+constexpr u32 S_KON = 0x1500;
+constexpr u32 S_KOFF = 0x1600;
+constexpr u32 S_ENDX = 0x1700;
+constexpr u32 S_VMIXL = 0x1800;
+constexpr u32 S_VMIXEL = 0x1900;
+constexpr u32 S_VMIXR = 0x1A00;
+constexpr u32 S_VMIXER = 0x1B00;
+// Addresses, in bytes of sound RAM.
+constexpr u32 A_ESA = 0x1C00;
+constexpr u32 A_EEA = 0x1D00;
+constexpr u32 VA_SSA = 0x2040;
+constexpr u32 VA_LSAX = 0x2140;
+constexpr u32 VA_NAX = 0x2240;
+// sceSdSetCoreAttr() attributes.
+constexpr u32 CORE_EFFECT_ENABLE = 0x2;
+constexpr u32 CORE_MUTE_ENABLE = 0x6;
+// sceSdSetEffectAttr() modes: the reverb presets, and a flag to clear the work area.
+constexpr u32 EFFECT_MODE_OFF = 0;
+constexpr u32 EFFECT_MODE_ROOM = 1;
+constexpr u32 EFFECT_MODE_STUDIO_A = 2;
+constexpr u32 EFFECT_MODE_STUDIO_B = 3;
+constexpr u32 EFFECT_MODE_STUDIO_C = 4;
+constexpr u32 EFFECT_MODE_HALL = 5;
+constexpr u32 EFFECT_MODE_SPACE = 6;
+constexpr u32 EFFECT_MODE_ECHO = 7;
+constexpr u32 EFFECT_MODE_DELAY = 8;
+constexpr u32 EFFECT_MODE_PIPE = 9;
+constexpr u32 EFFECT_MODE_CLEAR = 0x100;
+
+constexpr u32 entry_core(u32 entry) { return entry & 1; }
+constexpr u32 entry_voice(u32 entry) { return (entry >> 1) & 0x1F; }
+
+} // namespace spu2
+
+class Spu2 {
+public:
+    static constexpr u32 CORES = 2;
+    static constexpr u32 VOICES = 24;               // Per core
+    static constexpr u32 RAM_SIZE = 2 * 1024 * 1024;
+    static constexpr u32 SAMPLE_RATE = 48000;
+    static constexpr u32 CHUNK_FRAMES = 48;         // 1 ms
+    static constexpr u32 QUEUE_SIZE = 4096;
+
+    Spu2();
+    ~Spu2();
+
+    Spu2(const Spu2&) = delete;
+    Spu2& operator=(const Spu2&) = delete;
+
+    // The producer side: one thread at a time, the one serving sdremote. `entry` is libsd's.
+    void write_param(u32 entry, u32 value);
+    void write_switch(u32 entry, u32 value);
+    void write_address(u32 entry, u32 value);
+    void write_core_attr(u32 entry, u32 value);
+    // An EFFECT_MODE_* preset for `core`'s reverb.
+    void write_effect_mode(u32 core, u32 mode);
+    // Copies `size` bytes into sound RAM at `address`, wrapping at the end.
+    void write_ram(u32 address, const u8* data, u32 size);
+
+    // Voices of `core` that have played a block with the loop end flag since their key
+    // on, and a voice's envelope level, as of the last chunk. Any thread.
+    u32 endx(u32 core) const { return published_endx[core & 1].load(std::memory_order_relaxed); }
+    u16 envelope(u32 core, u32 voice) const;
+
+    /**
+     * @brief Starts the audio thread. `sink` may be nullptr to mix into nothing.
+     */
+    void start(AudioSink sink, void* user);
+    void stop();
+    bool running() const { return thread_running.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Applies every queued write, then mixes `frames` (a multiple of 8) into `out`,
+     * interleaved. This is what the audio thread does for each chunk; call it directly
+     * only while the thread is stopped.
+     */
+    void render(s16* out, u32 frames);
+
+    /**
+     * @brief For save states (see savestate.h): holds the audio thread off between two
+     * chunks, with every write queued so far applied, for as long as the lock is held.
+     * The calls below are only for while it is.
+     */
+    std::unique_lock<std::mutex> lock_state();
+    u8* sound_ram() { return ram_bytes(); }
+    // The cores and their voices; sound RAM is the caller's to save.
+    void save_state(StateWriter& out) const;
+    bool load_state(StateReader& in);
+
+private:
+    enum class Write : u8 {
+        Param,
+        Switch,
+        Address,
+        CoreAttr,
+        EffectMode,
+        Ram,
+    };
+
+    // A queued write. A Ram write owns `data` (new[]) until it is applied.
+    struct Message {
+        Write kind;
+        u32 entry;
+        u32 value;
+        u8* data;
+    };
+
+    enum class Phase : u8 {
+        Off,
+        Attack,
+        Decay,
+        Sustain,
+        Release,
+    };
+
+    struct Voice {
+        // Registers
+        s16 volume[2];
+        u16 pitch;
+        u16 adsr1;
+        u16 adsr2;
+        u32 ssa;
+        u32 lsa;
+        u32 nax;
+        bool lsa_set;           // LSAX written since key on; block flags no longer move it
+
+        // Envelope: `level` changes by a step every `cycles` samples.
+        Phase phase;
+        s32 level;
+        u32 counter;
+
+        // Decoding: the block at `block` is in window[3..30], after the last three
+        // samples of the one before; `position` is the sample being played and
+        // `fraction` how far past it, in 1/4096ths.
+        u32 block;
+        u8 flags;
+        u32 position;
+        u32 fraction;
+        s32 history[2];
+        s16 window[3 + ADPCM_BLOCK_SAMPLES];
+    };
+
+    struct Core {
+        Voice voices[VOICES];
+        s16 main_volume[2];
+        u32 vmix[2];            // Dry mix, left and right
+        u32 vmix_effect[2];     // Into the reverb
+        u32 endx;
+        u32 esa;
+        u32 eea;
+        u32 attributes;
+
+        // Reverb: `reverb.size` is 0 while there is no preset or no work area.
+        u32 effect_mode;
+        s16 effect_volume[2];
+        ReverbParams reverb;
+        u32 reverb_position;
+    };
+
+    void push(const Message& message);
+    void drain();
+    void apply(const Message& message);
+    void key_on(Voice& voice);
+    void key_off(Voice& voice);
+    void update_reverb(Core& core);
+    void load_block(Voice& voice);
+    bool voice_samples(Voice& voice, u32 core, u32 index, s16* out, u32 frames);
+    void voice_envelope(Voice& voice, s16* out, u32 frames);
+    void publish();
+    void run();
+
+    u8* ram_bytes() { return reinterpret_cast<u8*>(ram.get()); }
+
+    AdpcmFunction decode;
+    MixFunction mix;
+    InterpolateFunction interpolate;
+    ReverbFunction reverb;
+
+    // Consumer state: the audio thread's, or whoever renders while it is stopped.
+    std::mutex state_mutex;
+    std::unique_ptr<s16[]> ram;
+    Core cores[CORES];
+
+    SpscRing<Message, QUEUE_SIZE> queue;
+
+    std::atomic<u32> published_endx[CORES];
+    std::atomic<u16> published_envelope[CORES * VOICES];
+
+    std::thread thread;
+    std::atomic<bool> thread_running;
+    std::atomic<bool> stop_requested;
+    AudioSink sink;
+    void* sink_user;
+};
@@ -0,0 +1,173 @@
+#include <benchmark/benchmark.h>
+#include "spu2.h"
+#include <cstring>
+#include <random>
+#include <vector>
+
+// What sound costs the host: the ADPCM, interpolation, mixing and reverb kernels on their
+// own, in each version the CPU runs, and a 1 ms chunk of all 48 voices playing through
+// both cores' reverb, which the audio thread has 1 ms to mix.
+
+namespace {
+
+void run_adpcm(benchmark::State& state, AdpcmFunction decode) {
+    std::mt19937 random(47);
+    std::vector<u8> blocks(256 * ADPCM_BLOCK_BYTES);
+    for (u8& byte : blocks) {
+        byte = (u8)random();
+    }
+    for (u32 i = 0; i < 256; i++) {
+        blocks[i * ADPCM_BLOCK_BYTES] = (u8)(i % 13 | (i % 5) << 4);
+    }
+    s16 out[ADPCM_BLOCK_SAMPLES];
+    s32 history[2] = { 0, 0 };
+    u32 i = 0;
+    for (auto _ : state) {
+        decode(&blocks[i * ADPCM_BLOCK_BYTES], out, history);
+        benchmark::DoNotOptimize(out);
+        i = (i + 1) % 256;
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_AdpcmScalar(benchmark::State& state) { run_adpcm(state, &adpcm_decode_scalar); }
+BENCHMARK(BM_AdpcmScalar);
+
+#if SPU2_SIMD_ENABLED
+void BM_AdpcmSse2(benchmark::State& state) { run_adpcm(state, &adpcm_decode_sse2); }
+BENCHMARK(BM_AdpcmSse2);
+#endif
+
+void run_mix(benchmark::State& state, MixFunction mix) {
+    std::mt19937 random(48);
+    alignas(16) s16 samples[Spu2::CHUNK_FRAMES];
+    alignas(16) s16 envelope[Spu2::CHUNK_FRAMES];
+    for (u32 i = 0; i < Spu2::CHUNK_FRAMES; i++) {
+        samples[i] = (s16)random();
+        envelope[i] = (s16)(random() % 0x8000);
+    }
+    alignas(16) s32 left[Spu2::CHUNK_FRAMES] = {};
+    alignas(16) s32 right[Spu2::CHUNK_FRAMES] = {};
+    for (auto _ : state) {
+        mix(samples, envelope, 0x3000, 0x5000, left, right, Spu2::CHUNK_FRAMES);
+        benchmark::DoNotOptimize(left);
+        benchmark::DoNotOptimize(right);
+    }
+    state.SetItemsProcessed(state.iterations() * Spu2::CHUNK_FRAMES);
+}
+
+void BM_MixScalar(benchmark::State& state) { run_mix(state, &mix_voice_scalar); }
+BENCHMARK(BM_MixScalar);
+
+#if SPU2_SIMD_ENABLED
+void BM_MixSse2(benchmark::State& state) { run_mix(state, &mix_voice_sse2); }
+BENCHMARK(BM_MixSse2);
+#endif
+
+void run_interpolate(benchmark::State& state, InterpolateFunction interpolate) {
+    std::mt19937 random(49);
+    std::vector<s16> source(256);
+    for (s16& sample : source) {
+        sample = (s16)random();
+    }
+    alignas(16) s16 out[Spu2::CHUNK_FRAMES];
+    for (auto _ : state) {
+        // A voice a fifth up: 48 outputs from 72 samples.
+        interpolate(source.data(), 0x123, 0x1800, out, Spu2::CHUNK_FRAMES);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations() * Spu2::CHUNK_FRAMES);
+}
+
+void BM_InterpolateScalar(benchmark::State& state) { run_interpolate(state, &interpolate_scalar); }
+BENCHMARK(BM_InterpolateScalar);
+
+#if SPU2_SIMD_ENABLED
+void BM_InterpolateSse2(benchmark::State& state) { run_interpolate(state, &interpolate_sse2); }
+BENCHMARK(BM_InterpolateSse2);
+#endif
+
+void run_reverb(benchmark::State& state, ReverbFunction reverb) {
+    std::mt19937 random(50);
+    u16 raw[sizeof(ReverbRegisters) / 2];
+    for (u16& value : raw) {
+        value = (u16)(random() % 0x2000);
+    }
+    ReverbRegisters registers;
+    std::memcpy(&registers, raw, sizeof(registers));
+    ReverbParams params;
+    reverb_prepare(registers, 0x10000, params);
+    std::vector<s16> work(0x10000);
+    u32 position = 0;
+    alignas(16) s32 in[2][Spu2::CHUNK_FRAMES];
+    alignas(16) s32 out[2][Spu2::CHUNK_FRAMES];
+    for (u32 i = 0; i < Spu2::CHUNK_FRAMES; i++) {
+        in[0][i] = (s16)random();
+        in[1][i] = (s16)random();
+    }
+    for (auto _ : state) {
+        reverb(params, work.data(), position, in[0], in[1], out[0], out[1], Spu2::CHUNK_FRAMES);
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(state.iterations() * Spu2::CHUNK_FRAMES);
+}
+
+void BM_ReverbScalar(benchmark::State& state) { run_reverb(state, &reverb_scalar); }
+BENCHMARK(BM_ReverbScalar);
+
+#if SPU2_SIMD_ENABLED
+void BM_ReverbSse2(benchmark::State& state) { run_reverb(state, &reverb_sse2); }
+BENCHMARK(BM_ReverbSse2);
+#endif
+
+// Every voice of both cores on its own looping sample at its own pitch.
+void BM_Render48Voices(benchmark::State& state) {
+    Spu2 spu2;
+    std::mt19937 random(2);
+    std::vector<u8> sample(64 * ADPCM_BLOCK_BYTES);
+    for (u8& byte : sample) {
+        byte = (u8)random();
+    }
+    for (u32 i = 0; i < 64; i++) {
+        sample[i * ADPCM_BLOCK_BYTES] = (u8)(8 | (i % 4) << 4);
+        sample[i * ADPCM_BLOCK_BYTES + 1] = 0;
+    }
+    sample[1] = ADPCM_LOOP_START;
+    sample[63 * ADPCM_BLOCK_BYTES + 1] = ADPCM_LOOP_END | ADPCM_LOOP_REPEAT;
+    spu2.write_ram(0x1000, sample.data(), (u32)sample.size());
+
+    for (u32 core = 0; core < Spu2::CORES; core++) {
+        spu2.write_param(spu2::P_MVOLL | core, 0x3FFF);
+        spu2.write_param(spu2::P_MVOLR | core, 0x3FFF);
+        spu2.write_switch(spu2::S_VMIXL | core, 0xFFFFFF);
+        spu2.write_switch(spu2::S_VMIXR | core, 0xFFFFFF);
+        spu2.write_switch(spu2::S_VMIXEL | core, 0xFFFFFF);
+        spu2.write_switch(spu2::S_VMIXER | core, 0xFFFFFF);
+        spu2.write_address(spu2::A_ESA | core, 0x100000 + core * 0x80000);
+        spu2.write_address(spu2::A_EEA | core, 0x17FFFF + core * 0x80000);
+        spu2.write_effect_mode(core, spu2::EFFECT_MODE_HALL);
+        spu2.write_param(spu2::P_EVOLL | core, 0x2000);
+        spu2.write_param(spu2::P_EVOLR | core, 0x2000);
+        spu2.write_core_attr(spu2::CORE_EFFECT_ENABLE | core, 1);
+        for (u32 voice = 0; voice < Spu2::VOICES; voice++) {
+            const u32 entry = core | voice << 1;
+            spu2.write_param(spu2::VP_VOLL | entry, 0x0800);
+            spu2.write_param(spu2::VP_VOLR | entry, 0x0600);
+            spu2.write_param(spu2::VP_PITCH | entry, 0x0800 + voice * 0x100);
+            spu2.write_param(spu2::VP_ADSR1 | entry, 0x000F);
+            spu2.write_param(spu2::VP_ADSR2 | entry, 0x1FC0);
+            spu2.write_address(spu2::VA_SSA | entry, 0x1000);
+        }
+        spu2.write_switch(spu2::S_KON | core, 0xFFFFFF);
+    }
+
+    alignas(16) s16 chunk[Spu2::CHUNK_FRAMES * 2];
+    for (auto _ : state) {
+        spu2.render(chunk, Spu2::CHUNK_FRAMES);
+        benchmark::DoNotOptimize(chunk);
+    }
+    state.SetItemsProcessed(state.iterations() * Spu2::CHUNK_FRAMES);
+}
+BENCHMARK(BM_Render48Voices);
+
+} // namespace
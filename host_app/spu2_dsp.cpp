@@ -0,0 +1,484 @@
+#include "spu2_dsp.h"
+#include <algorithm>
+#include <cmath>
+#if SPU2_SIMD_ENABLED
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// Prediction filter coefficients in 1/64ths, for the two previous samples.
+constexpr s32 FILTER_NEWER[5] = { 0, 60, 115, 98, 122 };
+constexpr s32 FILTER_OLDER[5] = { 0, 0, -52, -55, -60 };
+
+// Shifts 13-15 decode like 9.
+u32 block_shift(const u8* block) {
+    const u32 shift = block[0] & 0x0F;
+    return shift > 12 ? 9 : shift;
+}
+
+u32 block_filter(const u8* block) {
+    return std::min(block[0] >> 4, 4);
+}
+
+s32 clamp16(s32 value) {
+    return std::min(32767, std::max(-32768, value));
+}
+
+// Multiplication in 1.15 fixed point.
+s32 scale15(s32 a, s32 b) {
+    return (a * b) >> 15;
+}
+
+// The 4-tap interpolation's weights. The hardware's table is in ROM; this is a Gaussian of
+// the same width (about 0.57 samples), weights[k] weighing a sample (511.5 - k) / 256
+// samples from the point played, scaled so that no four taps add up to more than 1.
+// `taps` regroups it by fraction: the four weights one output uses, oldest sample first.
+struct GaussianTable {
+    s16 weights[512];
+    alignas(16) s16 taps[256][4];
+
+    GaussianTable() {
+        const double sigma = 0.571;
+        double raw[512];
+        for (int k = 0; k < 512; k++) {
+            const double distance = (511.5 - k) / 256.0;
+            raw[k] = std::exp(-distance * distance / (2 * sigma * sigma));
+        }
+        double largest = 0;
+        for (int i = 0; i < 256; i++) {
+            largest = std::max(largest, raw[255 - i] + raw[511 - i] + raw[256 + i] + raw[i]);
+        }
+        for (int k = 0; k < 512; k++) {
+            weights[k] = (s16)std::floor(raw[k] * 0x7FFF / largest);
+        }
+        for (int i = 0; i < 256; i++) {
+            taps[i][0] = weights[255 - i];
+            taps[i][1] = weights[511 - i];
+            taps[i][2] = weights[256 + i];
+            taps[i][3] = weights[i];
+        }
+    }
+};
+
+const GaussianTable& gaussian() {
+    static const GaussianTable table;
+    return table;
+}
+
+// A work area address `offset` samples on from `position`, both already within it.
+u32 reverb_address(const ReverbParams& params, u32 position, u32 offset) {
+    const u32 address = position + offset;
+    return address >= params.size ? address - params.size : address;
+}
+
+// The prediction filter over samples that are already scaled.
+void predict(const s16* scaled, u32 filter, s16* out, s32 history[2]) {
+    const s32 newer = FILTER_NEWER[filter];
+    const s32 older = FILTER_OLDER[filter];
+    s32 previous = history[0];
+    s32 before = history[1];
+    for (u32 i = 0; i < ADPCM_BLOCK_SAMPLES; i++) {
+        const s32 sample = clamp16(scaled[i] + ((previous * newer + before * older + 32) >> 6));
+        out[i] = (s16)sample;
+        before = previous;
+        previous = sample;
+    }
+    history[0] = previous;
+    history[1] = before;
+}
+
+} // namespace
+
+#if SPU2_SIMD_ENABLED
+namespace {
+
+// (a * b) >> 15 for 8 lanes, as 32-bit results in `low` (lanes 0-3) and `high`.
+void scale(__m128i a, __m128i b, __m128i& low, __m128i& high) {
+    const __m128i product_low = _mm_mullo_epi16(a, b);
+    const __m128i product_high = _mm_mulhi_epi16(a, b);
+    low = _mm_srai_epi32(_mm_unpacklo_epi16(product_low, product_high), 15);
+    high = _mm_srai_epi32(_mm_unpackhi_epi16(product_low, product_high), 15);
+}
+
+void accumulate(s32* sum, __m128i low, __m128i high) {
+    __m128i* dest = reinterpret_cast<__m128i*>(sum);
+    _mm_storeu_si128(dest, _mm_add_epi32(_mm_loadu_si128(dest), low));
+    _mm_storeu_si128(dest + 1, _mm_add_epi32(_mm_loadu_si128(dest + 1), high));
+}
+
+// Lane i of the result is the sum of the four lanes of rows[i].
+__m128i sum_rows(const __m128i rows[4]) {
+    const __m128i first = _mm_add_epi32(_mm_unpacklo_epi32(rows[0], rows[1]), _mm_unpackhi_epi32(rows[0], rows[1]));
+    const __m128i second = _mm_add_epi32(_mm_unpacklo_epi32(rows[2], rows[3]), _mm_unpackhi_epi32(rows[2], rows[3]));
+    return _mm_add_epi32(_mm_unpacklo_epi64(first, second), _mm_unpackhi_epi64(first, second));
+}
+
+// Lanes 0-3 of 16-bit `value`, sign extended to 32 bits.
+__m128i widen_low(__m128i value) {
+    return _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16);
+}
+
+__m128i load64(const void* address) {
+    return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(address));
+}
+
+} // namespace
+#endif
+
+void adpcm_decode_scalar(const u8 block[ADPCM_BLOCK_BYTES], s16 out[ADPCM_BLOCK_SAMPLES], s32 history[2]) {
+    const u32 shift = block_shift(block);
+    s16 scaled[ADPCM_BLOCK_SAMPLES];
+    for (u32 i = 0; i < ADPCM_BLOCK_SAMPLES; i++) {
+        const u32 nibble = (block[2 + i / 2] >> ((i & 1) * 4)) & 0x0F;
+        scaled[i] = (s16)((s16)(nibble << 12) >> shift);
+    }
+    predict(scaled, block_filter(block), out, history);
+}
+
+#if SPU2_SIMD_ENABLED
+void adpcm_decode_sse2(const u8 block[ADPCM_BLOCK_BYTES], s16 out[ADPCM_BLOCK_SAMPLES], s32 history[2]) {
+    const __m128i data = _mm_srli_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(block)), 2);
+    // Each nibble moved to the top of a byte, low nibble first.
+    const __m128i mask = _mm_set1_epi8((char)0xF0);
+    const __m128i low = _mm_and_si128(_mm_slli_epi16(data, 4), mask);
+    const __m128i high = _mm_and_si128(data, mask);
+    const __m128i first = _mm_unpacklo_epi8(low, high);       // Samples 0-15
+    const __m128i second = _mm_unpackhi_epi8(low, high);      // Samples 16-27 (and 4 spare)
+    // ...then to the top of a 16-bit lane and scaled down.
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i shift = _mm_cvtsi32_si128((int)block_shift(block));
+    alignas(16) s16 scaled[32];
+    __m128i* dest = reinterpret_cast<__m128i*>(scaled);
+    _mm_store_si128(dest + 0, _mm_sra_epi16(_mm_unpacklo_epi8(zero, first), shift));
+    _mm_store_si128(dest + 1, _mm_sra_epi16(_mm_unpackhi_epi8(zero, first), shift));
+    _mm_store_si128(dest + 2, _mm_sra_epi16(_mm_unpacklo_epi8(zero, second), shift));
+    _mm_store_si128(dest + 3, _mm_sra_epi16(_mm_unpackhi_epi8(zero, second), shift));
+    predict(scaled, block_filter(block), out, history);
+}
+#endif
+
+void mix_voice_scalar(const s16* samples, const s16* envelope, s16 volume_left, s16 volume_right,
+                      s32* left, s32* right, u32 count) {
+    for (u32 i = 0; i < count; i++) {
+        const s32 sample = (samples[i] * envelope[i]) >> 15;
+        left[i] += (sample * volume_left) >> 15;
+        right[i] += (sample * volume_right) >> 15;
+    }
+}
+
+#if SPU2_SIMD_ENABLED
+void mix_voice_sse2(const s16* samples, const s16* envelope, s16 volume_left, s16 volume_right,
+                    s32* left, s32* right, u32 count) {
+    const __m128i volume_l = _mm_set1_epi16(volume_left);
+    const __m128i volume_r = _mm_set1_epi16(volume_right);
+    for (u32 i = 0; i < count; i += 8) {
+        __m128i low, high;
+        scale(_mm_loadu_si128(reinterpret_cast<const __m128i*>(samples + i)),
+              _mm_loadu_si128(reinterpret_cast<const __m128i*>(envelope + i)), low, high);
+        // Envelope levels stop at 0x7FFF, so the enveloped sample still fits 16 bits.
+        const __m128i sample = _mm_packs_epi32(low, high);
+        scale(sample, volume_l, low, high);
+        accumulate(left + i, low, high);
+        scale(sample, volume_r, low, high);
+        accumulate(right + i, low, high);
+    }
+}
+#endif
+
+void interpolate_scalar(const s16* source, u32 fraction, u32 pitch, s16* out, u32 count) {
+    const GaussianTable& table = gaussian();
+    for (u32 i = 0; i < count; i++) {
+        const u32 phase = fraction + pitch * i;
+        const s16* taps = source + (phase >> 12);
+        const u32 weight = (phase >> 4) & 0xFF;
+        out[i] = (s16)clamp16(scale15(table.weights[255 - weight], taps[0]) +
+                              scale15(table.weights[511 - weight], taps[1]) +
+                              scale15(table.weights[256 + weight], taps[2]) +
+                              scale15(table.weights[weight], taps[3]));
+    }
+}
+
+#if SPU2_SIMD_ENABLED
+void interpolate_sse2(const s16* source, u32 fraction, u32 pitch, s16* out, u32 count) {
+    const GaussianTable& table = gaussian();
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i sums[2];
+        for (u32 half = 0; half < 2; half++) {
+            // Two outputs per vector: four taps each, times their four weights.
+            __m128i rows[4];
+            for (u32 pair = 0; pair < 2; pair++) {
+                const u32 first = fraction + pitch * (i + half * 4 + pair * 2);
+                const u32 second = first + pitch;
+                const __m128i samples = _mm_unpacklo_epi64(load64(source + (first >> 12)), load64(source + (second >> 12)));
+                const __m128i weights = _mm_unpacklo_epi64(load64(table.taps[(first >> 4) & 0xFF]),
+                                                           load64(table.taps[(second >> 4) & 0xFF]));
+                scale(samples, weights, rows[pair * 2], rows[pair * 2 + 1]);
+            }
+            sums[half] = sum_rows(rows);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_packs_epi32(sums[0], sums[1]));
+    }
+    if (i < count) {
+        const u32 phase = fraction + pitch * i;
+        interpolate_scalar(source + (phase >> 12), phase & 0xFFF, pitch, out + i, count - i);
+    }
+}
+#endif
+
+void reverb_prepare(const ReverbRegisters& registers, u32 size, ReverbParams& params) {
+    // Offsets are in 8-byte units, 4 samples each.
+    auto offset = [size](u16 units) { return (u32)units * 4 % size; };
+    auto before = [size](u32 address, u32 distance) { return (address + size - distance % size) % size; };
+
+    params.size = size;
+    const u16 iir[4] = { registers.same_left, registers.same_right, registers.diff_left, registers.diff_right };
+    const u16 wall[4] = { registers.same_delay_left, registers.same_delay_right, registers.diff_delay_right,
+                          registers.diff_delay_left };
+    for (u32 i = 0; i < 4; i++) {
+        params.iir_write[i] = offset(iir[i]);
+        params.iir_previous[i] = before(params.iir_write[i], 1);
+        params.iir_wall[i] = offset(wall[i]);
+    }
+    const u16 comb[8] = { registers.comb1_left, registers.comb2_left, registers.comb3_left, registers.comb4_left,
+                          registers.comb1_right, registers.comb2_right, registers.comb3_right, registers.comb4_right };
+    for (u32 i = 0; i < 8; i++) {
+        params.comb[i] = offset(comb[i]);
+    }
+    params.apf1_write[0] = offset(registers.apf1_left);
+    params.apf1_write[1] = offset(registers.apf1_right);
+    params.apf2_write[0] = offset(registers.apf2_left);
+    params.apf2_write[1] = offset(registers.apf2_right);
+    for (u32 side = 0; side < 2; side++) {
+        params.apf1_read[side] = before(params.apf1_write[side], registers.apf1_offset * 4);
+        params.apf2_read[side] = before(params.apf2_write[side], registers.apf2_offset * 4);
+    }
+
+    params.in_volume[0] = (s16)registers.in_volume_left;
+    params.in_volume[1] = (s16)registers.in_volume_right;
+    params.iir_volume = (s16)registers.iir_volume;
+    params.wall_volume = (s16)registers.wall_volume;
+    params.comb_volume[0] = (s16)registers.comb1_volume;
+    params.comb_volume[1] = (s16)registers.comb2_volume;
+    params.comb_volume[2] = (s16)registers.comb3_volume;
+    params.comb_volume[3] = (s16)registers.comb4_volume;
+    params.apf_volume[0] = (s16)registers.apf1_volume;
+    params.apf_volume[1] = (s16)registers.apf2_volume;
+}
+
+namespace {
+
+// One all-pass stage, both sides: both reads happen before either write.
+void all_pass(const ReverbParams& params, s16* work, u32 position, const u32 write[2], const u32 read[2],
+              s32 volume, s32 sample[2]) {
+    s32 filtered[2];
+    for (u32 side = 0; side < 2; side++) {
+        const s32 delayed = work[reverb_address(params, position, read[side])];
+        filtered[side] = clamp16(sample[side] - scale15(delayed, volume));
+        sample[side] = clamp16(scale15(filtered[side], volume) + delayed);
+    }
+    for (u32 side = 0; side < 2; side++) {
+        work[reverb_address(params, position, write[side])] = (s16)filtered[side];
+    }
+}
+
+} // namespace
+
+void reverb_scalar(const ReverbParams& params, s16* work, u32& position, const s32* in_left,
+                   const s32* in_right, s32* out_left, s32* out_right, u32 count) {
+    for (u32 i = 0; i < count; i += 2) {
+        const s32 in[2] = {
+            scale15(clamp16((in_left[i] + in_left[i + 1]) >> 1), params.in_volume[0]),
+            scale15(clamp16((in_right[i] + in_right[i + 1]) >> 1), params.in_volume[1]),
+        };
+
+        // The IIR filters: each reads its own last output and a delayed sample, then
+        // writes, all four reads first.
+        s32 iir[4];
+        for (u32 j = 0; j < 4; j++) {
+            const s32 wall = scale15(work[reverb_address(params, position, params.iir_wall[j])], params.wall_volume);
+            const s32 previous = work[reverb_address(params, position, params.iir_previous[j])];
+            const s32 delta = clamp16(in[j & 1] + wall - previous);
+            iir[j] = clamp16(scale15(delta, params.iir_volume) + previous);
+        }
+        for (u32 j = 0; j < 4; j++) {
+            work[reverb_address(params, position, params.iir_write[j])] = (s16)iir[j];
+        }
+
+        s32 sample[2];
+        for (u32 side = 0; side < 2; side++) {
+            s32 sum = 0;
+            for (u32 k = 0; k < 4; k++) {
+                sum += scale15(work[reverb_address(params, position, params.comb[side * 4 + k])], params.comb_volume[k]);
+            }
+            sample[side] = clamp16(sum);
+        }
+        all_pass(params, work, position, params.apf1_write, params.apf1_read, params.apf_volume[0], sample);
+        all_pass(params, work, position, params.apf2_write, params.apf2_read, params.apf_volume[1], sample);
+
+        out_left[i] = out_left[i + 1] = sample[0];
+        out_right[i] = out_right[i + 1] = sample[1];
+        position = position + 1 == params.size ? 0 : position + 1;
+    }
+}
+
+#if SPU2_SIMD_ENABLED
+namespace {
+
+constexpr u32 REVERB_BATCH = 64;
+
+// A step's input for each side: the average of its two frames, clamped, times the input
+// volume. Independent of the filters, so done for a batch of steps up front.
+void reverb_inputs(const s32* in, s16 volume, s32* steps, u32 count) {
+    const __m128i scale_by = _mm_set1_epi16(volume);
+    u32 i = 0;
+    for (; i + 8 <= count; i += 8) {
+        const __m128i a = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i)), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i b = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i + 4)), _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i average = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b)), 1);
+        const __m128i clamped = _mm_packs_epi32(average, average);
+        __m128i low, high;
+        scale(clamped, scale_by, low, high);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(steps + i / 2), low);
+    }
+    for (; i < count; i += 2) {
+        steps[i / 2] = scale15(clamp16((in[i] + in[i + 1]) >> 1), volume);
+    }
+}
+
+// Every address a step touches, in one array so that a step can move them all on at once.
+enum ReverbTap : u32 {
+    TAP_IIR_WALL = 0,
+    TAP_IIR_PREVIOUS = 4,
+    TAP_IIR_WRITE = 8,
+    TAP_COMB = 12,
+    TAP_APF1_READ = 20,
+    TAP_APF1_WRITE = 22,
+    TAP_APF2_READ = 24,
+    TAP_APF2_WRITE = 26,
+    TAP_COUNT = 32,         // Padded to whole vectors
+};
+
+// All-pass over lanes 0 and 1 of `sample` (32-bit), as all_pass() does.
+__m128i all_pass_sse2(s16* work, const u32* read, const u32* write, s16 volume, __m128i sample) {
+    const __m128i delayed = _mm_setr_epi16(work[read[0]], work[read[1]], 0, 0, 0, 0, 0, 0);
+    const __m128i scale_by = _mm_set1_epi16(volume);
+    __m128i low, high;
+    scale(delayed, scale_by, low, high);
+    const __m128i filtered = _mm_packs_epi32(_mm_sub_epi32(sample, low), _mm_setzero_si128());
+    scale(filtered, scale_by, low, high);
+    work[write[0]] = (s16)_mm_extract_epi16(filtered, 0);
+    work[write[1]] = (s16)_mm_extract_epi16(filtered, 1);
+    return widen_low(_mm_packs_epi32(_mm_add_epi32(low, widen_low(delayed)), _mm_setzero_si128()));
+}
+
+} // namespace
+
+void reverb_sse2(const ReverbParams& params, s16* work, u32& position, const s32* in_left,
+                 const s32* in_right, s32* out_left, s32* out_right, u32 count) {
+    const __m128i wall_volume = _mm_setr_epi16(params.wall_volume, params.wall_volume, params.wall_volume,
+                                               params.wall_volume, 0, 0, 0, 0);
+    const __m128i iir_volume = _mm_set1_epi16(params.iir_volume);
+    const __m128i comb_volume = _mm_setr_epi16(params.comb_volume[0], params.comb_volume[1], params.comb_volume[2],
+                                               params.comb_volume[3], params.comb_volume[0], params.comb_volume[1],
+                                               params.comb_volume[2], params.comb_volume[3]);
+    alignas(16) u32 offsets[TAP_COUNT] = {};
+    std::copy(params.iir_wall, params.iir_wall + 4, offsets + TAP_IIR_WALL);
+    std::copy(params.iir_previous, params.iir_previous + 4, offsets + TAP_IIR_PREVIOUS);
+    std::copy(params.iir_write, params.iir_write + 4, offsets + TAP_IIR_WRITE);
+    std::copy(params.comb, params.comb + 8, offsets + TAP_COMB);
+    std::copy(params.apf1_read, params.apf1_read + 2, offsets + TAP_APF1_READ);
+    std::copy(params.apf1_write, params.apf1_write + 2, offsets + TAP_APF1_WRITE);
+    std::copy(params.apf2_read, params.apf2_read + 2, offsets + TAP_APF2_READ);
+    std::copy(params.apf2_write, params.apf2_write + 2, offsets + TAP_APF2_WRITE);
+    const __m128i size = _mm_set1_epi32((int)params.size);
+    const __m128i last = _mm_set1_epi32((int)params.size - 1);
+
+    alignas(16) s32 steps[2][REVERB_BATCH / 2];
+    for (u32 batch = 0; batch < count; batch += REVERB_BATCH) {
+        const u32 frames = std::min(count - batch, REVERB_BATCH);
+        reverb_inputs(in_left + batch, params.in_volume[0], steps[0], frames);
+        reverb_inputs(in_right + batch, params.in_volume[1], steps[1], frames);
+
+        for (u32 step = 0; step < frames / 2; step++) {
+            // This step's addresses, wrapped into the work area.
+            alignas(16) u32 at[TAP_COUNT];
+            const __m128i here = _mm_set1_epi32((int)position);
+            for (u32 i = 0; i < TAP_COUNT; i += 4) {
+                const __m128i address = _mm_add_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(offsets + i)), here);
+                const __m128i wrapped = _mm_sub_epi32(address, _mm_and_si128(_mm_cmpgt_epi32(address, last), size));
+                _mm_store_si128(reinterpret_cast<__m128i*>(at + i), wrapped);
+            }
+
+            // IIR: walls in lanes 0-3, each filter's last output in lanes 4-7.
+            const __m128i taps = _mm_setr_epi16(work[at[TAP_IIR_WALL]], work[at[TAP_IIR_WALL + 1]],
+                                                work[at[TAP_IIR_WALL + 2]], work[at[TAP_IIR_WALL + 3]],
+                                                work[at[TAP_IIR_PREVIOUS]], work[at[TAP_IIR_PREVIOUS + 1]],
+                                                work[at[TAP_IIR_PREVIOUS + 2]], work[at[TAP_IIR_PREVIOUS + 3]]);
+            const __m128i previous = _mm_srai_epi32(_mm_unpackhi_epi16(taps, taps), 16);
+            const __m128i in = _mm_setr_epi32(steps[0][step], steps[1][step], steps[0][step], steps[1][step]);
+            __m128i wall, unused;
+            scale(taps, wall_volume, wall, unused);
+            const __m128i delta = _mm_packs_epi32(_mm_sub_epi32(_mm_add_epi32(in, wall), previous), _mm_setzero_si128());
+            __m128i filtered;
+            scale(delta, iir_volume, filtered, unused);
+            const __m128i iir = _mm_packs_epi32(_mm_add_epi32(filtered, previous), _mm_setzero_si128());
+            work[at[TAP_IIR_WRITE]] = (s16)_mm_extract_epi16(iir, 0);
+            work[at[TAP_IIR_WRITE + 1]] = (s16)_mm_extract_epi16(iir, 1);
+            work[at[TAP_IIR_WRITE + 2]] = (s16)_mm_extract_epi16(iir, 2);
+            work[at[TAP_IIR_WRITE + 3]] = (s16)_mm_extract_epi16(iir, 3);
+
+            // Combs: left taps in lanes 0-3, right in 4-7, summed to {left, right, ...}.
+            const __m128i combs = _mm_setr_epi16(work[at[TAP_COMB]], work[at[TAP_COMB + 1]], work[at[TAP_COMB + 2]],
+                                                 work[at[TAP_COMB + 3]], work[at[TAP_COMB + 4]], work[at[TAP_COMB + 5]],
+                                                 work[at[TAP_COMB + 6]], work[at[TAP_COMB + 7]]);
+            __m128i left, right;
+            scale(combs, comb_volume, left, right);
+            const __m128i pairs = _mm_add_epi32(_mm_unpacklo_epi64(left, right), _mm_unpackhi_epi64(left, right));
+            const __m128i sums = _mm_add_epi32(pairs, _mm_shuffle_epi32(pairs, _MM_SHUFFLE(2, 3, 0, 1)));
+            __m128i sample = widen_low(_mm_packs_epi32(_mm_shuffle_epi32(sums, _MM_SHUFFLE(2, 0, 2, 0)), _mm_setzero_si128()));
+
+            sample = all_pass_sse2(work, at + TAP_APF1_READ, at + TAP_APF1_WRITE, params.apf_volume[0], sample);
+            sample = all_pass_sse2(work, at + TAP_APF2_READ, at + TAP_APF2_WRITE, params.apf_volume[1], sample);
+
+            const u32 frame = batch + step * 2;
+            out_left[frame] = out_left[frame + 1] = _mm_cvtsi128_si32(sample);
+            out_right[frame] = out_right[frame + 1] = _mm_cvtsi128_si32(_mm_shuffle_epi32(sample, _MM_SHUFFLE(1, 1, 1, 1)));
+            position = position + 1 == params.size ? 0 : position + 1;
+        }
+    }
+}
+#endif
+
+AdpcmFunction adpcm_select() {
+#if SPU2_SIMD_ENABLED
+    return &adpcm_decode_sse2;
+#else
+    return &adpcm_decode_scalar;
+#endif
+}
+
+MixFunction mix_voice_select() {
+#if SPU2_SIMD_ENABLED
+    return &mix_voice_sse2;
+#else
+    return &mix_voice_scalar;
+#endif
+}
+
+InterpolateFunction interpolate_select() {
+#if SPU2_SIMD_ENABLED
+    return &interpolate_sse2;
+#else
+    return &interpolate_scalar;
+#endif
+}
+
+ReverbFunction reverb_select() {
+#if SPU2_SIMD_ENABLED
+    return &reverb_sse2;
+#else
+    return &reverb_scalar;
+#endif
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "cpu_state.h"
+
+// The SPU2's sample-level kernels, each with a scalar reference and an SSE2 version that
+// is bit-exact with it. The voice engine (spu2.h) calls them on whole blocks: an ADPCM
+// block at a time, a voice's samples from one block at a time, a 1 ms chunk of a voice or
+// of a core's reverb at a time.
+
+#if defined(__x86_64__)
+#define SPU2_SIMD_ENABLED 1
+#else
+#define SPU2_SIMD_ENABLED 0
+#endif
+
+// SPU ADPCM: 16-byte blocks of 28 samples. Byte 0 holds the shift (low nibble) and the
+// prediction filter (high nibble), byte 1 the loop flags, then one 4-bit sample per
+// nibble, low nibble first.
+constexpr u32 ADPCM_BLOCK_BYTES = 16;
+constexpr u32 ADPCM_BLOCK_SAMPLES = 28;
+constexpr u8 ADPCM_LOOP_END = 1u << 0;
+constexpr u8 ADPCM_LOOP_REPEAT = 1u << 1;
+constexpr u8 ADPCM_LOOP_START = 1u << 2;
+
+/**
+ * @brief Decodes one ADPCM block.
+ * @param history The last two decoded samples, newest first; updated for the next block.
+ */
+using AdpcmFunction = void (*)(const u8 block[ADPCM_BLOCK_BYTES], s16 out[ADPCM_BLOCK_SAMPLES], s32 history[2]);
+
+void adpcm_decode_scalar(const u8 block[ADPCM_BLOCK_BYTES], s16 out[ADPCM_BLOCK_SAMPLES], s32 history[2]);
+#if SPU2_SIMD_ENABLED
+// Unpacks and scales all 28 nibbles at once; only the prediction filter is sequential.
+void adpcm_decode_sse2(const u8 block[ADPCM_BLOCK_BYTES], s16 out[ADPCM_BLOCK_SAMPLES], s32 history[2]);
+#endif
+
+/**
+ * @brief Adds `count` samples of a voice into a core's mix: each sample is scaled by its
+ * envelope level, then by the voice's left and right volume, all in 1.15 fixed point.
+ * @param count A multiple of 8.
+ */
+using MixFunction = void (*)(const s16* samples, const s16* envelope, s16 volume_left, s16 volume_right,
+                             s32* left, s32* right, u32 count);
+
+void mix_voice_scalar(const s16* samples, const s16* envelope, s16 volume_left, s16 volume_right,
+                      s32* left, s32* right, u32 count);
+#if SPU2_SIMD_ENABLED
+void mix_voice_sse2(const s16* samples, const s16* envelope, s16 volume_left, s16 volume_right,
+                    s32* left, s32* right, u32 count);
+#endif
+
+/**
+ * @brief Resamples a voice with the SPU2's 4-tap Gaussian interpolation. Output sample i is
+ * played `fraction + i * pitch` (in 1/4096ths of a sample) past `source`, and weighs the
+ * four source samples from there on; pitch 0x1000 plays at the original rate.
+ * @param source Must hold every sample the last output reaches, plus three.
+ */
+using InterpolateFunction = void (*)(const s16* source, u32 fraction, u32 pitch, s16* out, u32 count);
+
+void interpolate_scalar(const s16* source, u32 fraction, u32 pitch, s16* out, u32 count);
+#if SPU2_SIMD_ENABLED
+// Eight outputs at a time: each one's taps and weights are a single 64-bit load.
+void interpolate_sse2(const s16* source, u32 fraction, u32 pitch, s16* out, u32 count);
+#endif
+
+// A reverb preset as the hardware takes it (the 32 registers from 0x2E4 of a core, in
+// order): offsets in 8-byte units, volumes in 1.15.
+struct ReverbRegisters {
+    u16 apf1_offset, apf2_offset;
+    u16 iir_volume;
+    u16 comb1_volume, comb2_volume, comb3_volume, comb4_volume;
+    u16 wall_volume;
+    u16 apf1_volume, apf2_volume;
+    u16 same_left, same_right;
+    u16 comb1_left, comb1_right, comb2_left, comb2_right;
+    u16 same_delay_left, same_delay_right;
+    u16 diff_left, diff_right;
+    u16 comb3_left, comb3_right, comb4_left, comb4_right;
+    u16 diff_delay_left, diff_delay_right;
+    u16 apf1_left, apf1_right, apf2_left, apf2_right;
+    u16 in_volume_left, in_volume_right;
+};
+
+// ReverbRegisters laid out for the kernels: every address as a sample index into a work
+// area of `size` samples, relative to its current position, and grouped in the order the
+// SIMD lanes take them.
+struct ReverbParams {
+    u32 size;
+    u32 iir_write[4];       // Same left, same right, diff left, diff right
+    u32 iir_previous[4];    // The sample before each
+    u32 iir_wall[4];        // What feeds each: same left/right, then diff right/left
+    u32 comb[8];            // Left 1-4, then right 1-4
+    u32 apf1_write[2];
+    u32 apf1_read[2];
+    u32 apf2_write[2];
+    u32 apf2_read[2];
+    s16 in_volume[2];
+    s16 iir_volume;
+    s16 wall_volume;
+    s16 comb_volume[4];
+    s16 apf_volume[2];
+};
+
+/**
+ * @brief Prepares `registers` for a work area of `size` (at least 1) samples.
+ */
+void reverb_prepare(const ReverbRegisters& registers, u32 size, ReverbParams& params);
+
+/**
+ * @brief Runs `count` (even) frames through a core's reverb: four IIR filters that write
+ * into the work area, four comb taps per side that read back out of it, then two all-pass
+ * stages. The reverb runs at half rate, like the hardware: each pair of input frames is
+ * averaged into one step and its result fills both output frames.
+ * @param position Where in `work` the reverb is; moves on a sample per step.
+ */
+using ReverbFunction = void (*)(const ReverbParams& params, s16* work, u32& position, const s32* in_left,
+                                const s32* in_right, s32* out_left, s32* out_right, u32 count);
+
+void reverb_scalar(const ReverbParams& params, s16* work, u32& position, const s32* in_left,
+                   const s32* in_right, s32* out_left, s32* out_right, u32 count);
+#if SPU2_SIMD_ENABLED
+// The steps are sequential (each IIR feeds on its last output); a step's four filters,
+// eight comb taps and two all-pass sides each run as lanes of one vector.
+void reverb_sse2(const ReverbParams& params, s16* work, u32& position, const s32* in_left,
+                 const s32* in_right, s32* out_left, s32* out_right, u32 count);
+#endif
+
+// The fastest versions this CPU runs.
+AdpcmFunction adpcm_select();
+MixFunction mix_voice_select();
+InterpolateFunction interpolate_select();
+ReverbFunction reverb_select();
@@ -0,0 +1,473 @@
+#include "gtest/gtest.h"
+#include "iop_sound.h"
+#include "wav_file.h"
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+// A block of one repeated nibble: with filter 0 and shift 0, nibble n decodes to n << 12.
+std::vector<u8> adpcm_block(u8 nibble, u8 flags, u8 shift = 0, u8 filter = 0) {
+    std::vector<u8> block(ADPCM_BLOCK_BYTES, (u8)(nibble | nibble << 4));
+    block[0] = (u8)(shift | filter << 4);
+    block[1] = flags;
+    return block;
+}
+
+// Voice 0 of core 0, set up as a game would through sdremote.
+class Spu2Test : public ::testing::Test {
+protected:
+    Spu2Test() : iop_ram(IOP_RAM_SIZE) {
+        sound.set_iop_memory(iop_ram.data(), IOP_RAM_SIZE);
+        sound.set_voice_engine(&spu2);
+    }
+
+    u32 call(u32 function, const std::vector<u32>& args = {}) {
+        RpcCall rpc;
+        rpc.function = function;
+        rpc.args.resize(args.size() * 4);
+        for (size_t i = 0; i < args.size(); i++) {
+            store32(rpc.args.data(), (u32)i * 4, args[i]);
+        }
+        SoundServer::serve(&sound, rpc);
+        return load32(rpc.reply.data(), 0);
+    }
+
+    // Uploads `blocks` to SAMPLE_ADDRESS through IOP RAM.
+    void upload(const std::vector<std::vector<u8>>& blocks) {
+        u32 size = 0;
+        for (const std::vector<u8>& block : blocks) {
+            std::copy(block.begin(), block.end(), iop_ram.begin() + size);
+            size += (u32)block.size();
+        }
+        call(SoundServer::CMD_VOICE_TRANS, { 0, 0, 0, SAMPLE_ADDRESS, size });
+    }
+
+    // Full volume at the original pitch; an instant attack up to a sustain that holds, and
+    // an instant release.
+    void set_up_voice() {
+        call(SoundServer::CMD_SET_PARAM, { spu2::P_MVOLL, 0x3FFF });
+        call(SoundServer::CMD_SET_PARAM, { spu2::P_MVOLR, 0x3FFF });
+        call(SoundServer::CMD_SET_PARAM, { spu2::VP_VOLL, 0x3FFF });
+        call(SoundServer::CMD_SET_PARAM, { spu2::VP_VOLR, 0x3FFF });
+        call(SoundServer::CMD_SET_PARAM, { spu2::VP_PITCH, 0x1000 });
+        call(SoundServer::CMD_SET_PARAM, { spu2::VP_ADSR1, 0x000F });
+        call(SoundServer::CMD_SET_PARAM, { spu2::VP_ADSR2, 0x1FC0 });
+        call(SoundServer::CMD_SET_ADDR, { spu2::VA_SSA, SAMPLE_ADDRESS });
+        call(SoundServer::CMD_SET_SWITCH, { spu2::S_VMIXL, 1 });
+        call(SoundServer::CMD_SET_SWITCH, { spu2::S_VMIXR, 1 });
+    }
+
+    std::vector<s16> render(u32 frames) {
+        std::vector<s16> out(frames * 2);
+        spu2.render(out.data(), frames);
+        return out;
+    }
+
+    static constexpr u32 IOP_RAM_SIZE = 64 * 1024;
+    static constexpr u32 SAMPLE_ADDRESS = 0x5000;
+    std::vector<u8> iop_ram;
+    Spu2 spu2;
+    SoundServer sound;
+};
+
+std::string temp_path() {
+    char path[] = "/tmp/spu2_testXXXXXX";
+    const int fd = mkstemp(path);
+    EXPECT_GE(fd, 0);
+    close(fd);
+    return path;
+}
+
+u32 read_u32(const std::vector<char>& data, size_t offset) {
+    u32 value = 0;
+    std::memcpy(&value, data.data() + offset, 4);
+    return value;
+}
+
+} // namespace
+
+TEST(Spu2DspTest, AdpcmScalesAndPredicts) {
+    s16 out[ADPCM_BLOCK_SAMPLES];
+
+    // Filter 0 only scales: nibbles are signed, shifts 13-15 act like 9.
+    s32 history[2] = { 0, 0 };
+    adpcm_decode_scalar(adpcm_block(0x1, 0).data(), out, history);
+    EXPECT_EQ(out[0], 0x1000);
+    adpcm_decode_scalar(adpcm_block(0xF, 0).data(), out, history);
+    EXPECT_EQ(out[27], -0x1000);
+    adpcm_decode_scalar(adpcm_block(0x1, 0, 4).data(), out, history);
+    EXPECT_EQ(out[5], 0x100);
+    adpcm_decode_scalar(adpcm_block(0x1, 0, 13).data(), out, history);
+    EXPECT_EQ(out[5], 0x1000 >> 9);
+
+    // Filter 1 decays from the previous block: (previous * 60 + 32) >> 6.
+    history[0] = 0x1000;
+    history[1] = 0;
+    adpcm_decode_scalar(adpcm_block(0x0, 0, 0, 1).data(), out, history);
+    EXPECT_EQ(out[0], 3840);
+    EXPECT_EQ(out[1], 3600);
+    EXPECT_EQ(history[0], out[27]);
+    EXPECT_EQ(history[1], out[26]);
+}
+
+#if SPU2_SIMD_ENABLED
+TEST(Spu2DspTest, AdpcmSse2MatchesScalar) {
+    std::mt19937 random(47);
+    s32 scalar_history[2] = { 0, 0 };
+    s32 simd_history[2] = { 0, 0 };
+    for (u32 i = 0; i < 2000; i++) {
+        // 1. Arrange: every shift and filter, including the out-of-range ones.
+        u8 block[ADPCM_BLOCK_BYTES];
+        for (u8& byte : block) {
+            byte = (u8)random();
+        }
+        block[0] = (u8)((i % 16) | (i / 16 % 8) << 4);
+
+        // 2. Act
+        s16 scalar[ADPCM_BLOCK_SAMPLES];
+        s16 simd[ADPCM_BLOCK_SAMPLES];
+        adpcm_decode_scalar(block, scalar, scalar_history);
+        adpcm_decode_sse2(block, simd, simd_history);
+
+        // 3. Assert
+        ASSERT_EQ(std::vector<s16>(scalar, scalar + ADPCM_BLOCK_SAMPLES),
+                  std::vector<s16>(simd, simd + ADPCM_BLOCK_SAMPLES)) << "block " << i;
+        ASSERT_EQ(scalar_history[0], simd_history[0]);
+        ASSERT_EQ(scalar_history[1], simd_history[1]);
+    }
+}
+
+TEST(Spu2DspTest, MixSse2MatchesScalar) {
+    std::mt19937 random(4800);
+    const u32 count = 48;
+    std::vector<s16> samples(count);
+    std::vector<s16> envelope(count);
+    for (u32 i = 0; i < count; i++) {
+        samples[i] = (s16)random();
+        envelope[i] = (s16)(random() % 0x8000);
+    }
+    samples[0] = -32768;
+    envelope[0] = 0x7FFF;
+
+    for (s16 volume : { (s16)0x7FFE, (s16)-32768, (s16)0x1234, (s16)0 }) {
+        std::vector<s32> scalar_left(count, 7), scalar_right(count, -7);
+        std::vector<s32> simd_left(count, 7), simd_right(count, -7);
+        mix_voice_scalar(samples.data(), envelope.data(), volume, (s16)-volume, scalar_left.data(),
+                         scalar_right.data(), count);
+        mix_voice_sse2(samples.data(), envelope.data(), volume, (s16)-volume, simd_left.data(),
+                       simd_right.data(), count);
+        EXPECT_EQ(scalar_left, simd_left);
+        EXPECT_EQ(scalar_right, simd_right);
+    }
+}
+#endif
+
+TEST(Spu2DspTest, InterpolationAtTheOriginalRateKeepsALevel) {
+    // 1. Arrange
+    std::vector<s16> source(64, 0x1000);
+    s16 out[48];
+
+    // 2. Act
+    interpolate_scalar(source.data(), 0x800, 0x1000, out, 48);
+
+    // 3. Assert: wherever the point falls between two samples, the four weights add up
+    // to within 1% of 1, and never more.
+    for (s16 sample : out) {
+        EXPECT_GE(sample, 0x1000 * 99 / 100);
+        EXPECT_LE(sample, 0x1000);
+    }
+}
+
+#if SPU2_SIMD_ENABLED
+TEST(Spu2DspTest, InterpolateSse2MatchesScalar) {
+    std::mt19937 random(48);
+    std::vector<s16> source(256);
+    for (s16& sample : source) {
+        sample = (s16)random();
+    }
+    source[10] = source[11] = source[12] = source[13] = -32768;
+    for (u32 pitch : { 0u, 1u, 0x800u, 0x1000u, 0x1234u, 0x3FFFu }) {
+        for (u32 count = 1; count <= 48; count++) {
+            // 1. Arrange
+            const u32 fraction = random() & 0xFFF;
+            std::vector<s16> scalar(count), simd(count);
+
+            // 2. Act
+            interpolate_scalar(source.data() + 8, fraction, pitch, scalar.data(), count);
+            interpolate_sse2(source.data() + 8, fraction, pitch, simd.data(), count);
+
+            // 3. Assert
+            ASSERT_EQ(scalar, simd) << "pitch " << pitch << ", " << count << " samples";
+        }
+    }
+}
+#endif
+
+namespace {
+
+// A reverb that is a pure delay of the left input: the IIR passes it through, the first
+// comb reads it straight back and each all-pass stage, at volume 0, delays it by its
+// offset. Everything else has an address of its own.
+ReverbRegisters delay_registers() {
+    ReverbRegisters registers = {};
+    registers.apf1_offset = 2;
+    registers.apf2_offset = 3;
+    registers.iir_volume = 0x7FFF;
+    registers.comb1_volume = 0x7FFF;
+    registers.same_left = 1;
+    registers.comb1_left = 1;
+    registers.apf1_left = 10;
+    registers.apf2_left = 20;
+    registers.same_right = 30;
+    registers.comb1_right = 30;
+    registers.diff_left = 40;
+    registers.diff_right = 50;
+    registers.apf1_right = 60;
+    registers.apf2_right = 70;
+    registers.in_volume_left = 0x7FFF;
+    return registers;
+}
+
+} // namespace
+
+TEST(Spu2DspTest, ReverbAllPassStagesDelay) {
+    // 1. Arrange: an impulse in the first step.
+    ReverbParams params;
+    reverb_prepare(delay_registers(), 1024, params);
+    std::vector<s16> work(1024, 0);
+    u32 position = 0;
+    std::vector<s32> in_left(96, 0), in_right(96, 0), out_left(96), out_right(96);
+    in_left[0] = in_left[1] = 0x4000;
+
+    // 2. Act
+    reverb_scalar(params, work.data(), position, in_left.data(), in_right.data(), out_left.data(),
+                  out_right.data(), 96);
+
+    // 3. Assert: it comes out (2 + 3) * 4 steps later, filling both frames of the step.
+    for (u32 i = 0; i < 96; i++) {
+        if (i / 2 == 20) {
+            EXPECT_GT(out_left[i], 0x3F00) << "frame " << i;
+        } else {
+            EXPECT_EQ(out_left[i], 0) << "frame " << i;
+        }
+        EXPECT_EQ(out_right[i], 0) << "frame " << i;
+    }
+    EXPECT_EQ(position, 48u);
+}
+
+#if SPU2_SIMD_ENABLED
+TEST(Spu2DspTest, ReverbSse2MatchesScalar) {
+    std::mt19937 random(2048);
+    // A work area the offsets fit in, and one so small that they wrap and collide.
+    for (u32 size : { 0x4000u, 37u }) {
+        // 1. Arrange: random registers, work area and input, loud enough to clamp.
+        u16 raw[sizeof(ReverbRegisters) / 2];
+        for (u32 i = 0; i < 32; i++) {
+            raw[i] = (u16)random();
+        }
+        ReverbRegisters registers;
+        std::memcpy(&registers, raw, sizeof(registers));
+        registers.apf1_offset &= 0xFF;
+        registers.apf2_offset &= 0xFF;
+        ReverbParams params;
+        reverb_prepare(registers, size, params);
+
+        std::vector<s16> scalar_work(size), simd_work(size);
+        for (u32 i = 0; i < size; i++) {
+            scalar_work[i] = simd_work[i] = (s16)random();
+        }
+        std::vector<s32> in_left(480), in_right(480);
+        for (u32 i = 0; i < 480; i++) {
+            in_left[i] = (s32)(random() % 200000) - 100000;
+            in_right[i] = (s16)random();
+        }
+
+        // 2. Act: in chunks, as the engine calls it, with a short one at the end.
+        u32 scalar_position = 5, simd_position = 5;
+        std::vector<s32> scalar_out[2], simd_out[2];
+        for (std::vector<s32>* out : { scalar_out, simd_out }) {
+            out[0].assign(480, 0);
+            out[1].assign(480, 0);
+        }
+        for (u32 frame = 0; frame < 480; frame += 48) {
+            const u32 count = frame == 432 ? 46 : 48;
+            reverb_scalar(params, scalar_work.data(), scalar_position, &in_left[frame], &in_right[frame],
+                          &scalar_out[0][frame], &scalar_out[1][frame], count);
+            reverb_sse2(params, simd_work.data(), simd_position, &in_left[frame], &in_right[frame],
+                        &simd_out[0][frame], &simd_out[1][frame], count);
+        }
+
+        // 3. Assert
+        EXPECT_EQ(scalar_out[0], simd_out[0]) << "size " << size;
+        EXPECT_EQ(scalar_out[1], simd_out[1]) << "size " << size;
+        EXPECT_EQ(scalar_work, simd_work) << "size " << size;
+        EXPECT_EQ(scalar_position, simd_position);
+    }
+}
+#endif
+
+TEST_F(Spu2Test, LoopingVoicePlaysAtItsVolume) {
+    // 1. Arrange: one block that loops on itself.
+    upload({ adpcm_block(0x1, ADPCM_LOOP_START | ADPCM_LOOP_END | ADPCM_LOOP_REPEAT) });
+    set_up_voice();
+
+    // 2. Act
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_KON, 1 });
+    const std::vector<s16> out = render(96);
+
+    // 3. Assert: 0x1000 through the interpolation and three near-unity volumes.
+    const s16 left = out[90 * 2];
+    EXPECT_GE(left, 0x1000 - 16);
+    EXPECT_LE(left, 0x1000);
+    EXPECT_EQ(out[90 * 2 + 1], left);
+    EXPECT_EQ(out[95 * 2], left);
+    EXPECT_EQ(call(SoundServer::CMD_GET_SWITCH, { spu2::S_ENDX }), 1u);
+    EXPECT_EQ(call(SoundServer::CMD_GET_PARAM, { spu2::VP_ENVX }), 0x7FFFu);
+}
+
+TEST_F(Spu2Test, LoopReturnsToTheLoopStartBlock) {
+    // 1. Arrange: an intro block, then a loop of two.
+    upload({ adpcm_block(0x1, 0), adpcm_block(0x2, ADPCM_LOOP_START),
+             adpcm_block(0x2, ADPCM_LOOP_END | ADPCM_LOOP_REPEAT) });
+    set_up_voice();
+
+    // 2. Act: past the end of the loop twice.
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_KON, 1 });
+    const std::vector<s16> out = render(192);
+
+    // 3. Assert: the intro never comes back.
+    for (u32 i = 60; i < 192; i++) {
+        ASSERT_GE(out[i * 2], 0x2000 - 32) << "frame " << i;
+    }
+}
+
+TEST_F(Spu2Test, OneShotVoiceEndsAfterItsLastBlock) {
+    // 1. Arrange
+    upload({ adpcm_block(0x1, ADPCM_LOOP_END) });
+    set_up_voice();
+
+    // 2. Act
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_KON, 1 });
+    const std::vector<s16> out = render(48);
+
+    // 3. Assert: silent from the end of its 28 samples, and reported as ended.
+    EXPECT_GT(out[20 * 2], 0);
+    for (u32 i = ADPCM_BLOCK_SAMPLES; i < 48; i++) {
+        ASSERT_EQ(out[i * 2], 0) << "frame " << i;
+    }
+    EXPECT_EQ(call(SoundServer::CMD_GET_SWITCH, { spu2::S_ENDX }), 1u);
+    EXPECT_EQ(call(SoundServer::CMD_GET_PARAM, { spu2::VP_ENVX }), 0u);
+}
+
+TEST_F(Spu2Test, KeyOffReleasesTheVoice) {
+    // 1. Arrange
+    upload({ adpcm_block(0x1, ADPCM_LOOP_START | ADPCM_LOOP_END | ADPCM_LOOP_REPEAT) });
+    set_up_voice();
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_KON, 1 });
+    render(48);
+
+    // 2. Act: release rate 0 falls by 0x4000 a sample.
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_KOFF, 1 });
+    const std::vector<s16> out = render(48);
+
+    // 3. Assert
+    EXPECT_GT(out[0], 0);
+    EXPECT_EQ(out[2 * 2], 0);
+    EXPECT_EQ(out[47 * 2], 0);
+    EXPECT_EQ(call(SoundServer::CMD_GET_PARAM, { spu2::VP_ENVX }), 0u);
+}
+
+TEST_F(Spu2Test, MutedCoreIsSilent) {
+    upload({ adpcm_block(0x1, ADPCM_LOOP_START | ADPCM_LOOP_END | ADPCM_LOOP_REPEAT) });
+    set_up_voice();
+    call(SoundServer::CMD_SET_CORE_ATTR, { spu2::CORE_MUTE_ENABLE, 1 });
+
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_KON, 1 });
+    const std::vector<s16> out = render(48);
+
+    EXPECT_EQ(out[40 * 2], 0);
+    EXPECT_EQ(call(SoundServer::CMD_GET_PARAM, { spu2::VP_ENVX }), 0x7FFFu);
+}
+
+TEST_F(Spu2Test, WritesPastAFullQueueAreKept) {
+    // 1. Arrange
+    upload({ adpcm_block(0x1, ADPCM_LOOP_START | ADPCM_LOOP_END | ADPCM_LOOP_REPEAT) });
+    set_up_voice();
+
+    // 2. Act: with no audio thread, more writes than the queue holds.
+    for (u32 i = 0; i < Spu2::QUEUE_SIZE * 2; i++) {
+        spu2.write_param(spu2::VP_PITCH, i & 0xFFF);
+    }
+    spu2.write_param(spu2::VP_PITCH, 0x1000);
+    spu2.write_switch(spu2::S_KON, 1);
+    const std::vector<s16> out = render(96);
+
+    // 3. Assert: the last writes, queued behind the flood, were applied in order.
+    EXPECT_GE(out[90 * 2], 0x1000 - 16);
+    EXPECT_EQ(spu2.envelope(0, 0), 0x7FFF);
+}
+
+TEST_F(Spu2Test, AudioThreadWritesChunksToAWavFile) {
+    // 1. Arrange
+    upload({ adpcm_block(0x1, ADPCM_LOOP_START | ADPCM_LOOP_END | ADPCM_LOOP_REPEAT) });
+    set_up_voice();
+    const std::string path = temp_path();
+    WavFile wav;
+    ASSERT_TRUE(wav.open(path, Spu2::SAMPLE_RATE));
+
+    // 2. Act
+    spu2.start(&WavFile::sink, &wav);
+    EXPECT_TRUE(spu2.running());
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_KON, 1 });
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    spu2.stop();
+    EXPECT_FALSE(spu2.running());
+    EXPECT_TRUE(wav.close());
+
+    // 3. Assert: whole chunks of 16-bit stereo behind a finished header.
+    std::ifstream file(path, std::ios::binary);
+    const std::vector<char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    unlink(path.c_str());
+    ASSERT_GT(data.size(), 44u);
+    EXPECT_EQ(std::string(data.data(), 4), "RIFF");
+    EXPECT_EQ(std::string(data.data() + 8, 4), "WAVE");
+    EXPECT_EQ(read_u32(data, 4), data.size() - 8);
+    EXPECT_EQ(read_u32(data, 24), Spu2::SAMPLE_RATE);
+    EXPECT_EQ(read_u32(data, 40), data.size() - 44);
+    EXPECT_EQ((data.size() - 44) % (Spu2::CHUNK_FRAMES * 4), 0u);
+    EXPECT_EQ(spu2.endx(0), 1u);
+}
+
+TEST_F(Spu2Test, EchoPlaysTheVoiceBackLater) {
+    // 1. Arrange: a one-shot voice sent only to the reverb, in the echo preset with the
+    // top megabyte of sound RAM to work in.
+    upload({ adpcm_block(0x1, ADPCM_LOOP_END) });
+    set_up_voice();
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_VMIXL, 0 });
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_VMIXR, 0 });
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_VMIXEL, 1 });
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_VMIXER, 1 });
+    call(SoundServer::CMD_SET_ADDR, { spu2::A_ESA, 0x100000 });
+    call(SoundServer::CMD_SET_ADDR, { spu2::A_EEA, 0x1FFFFF });
+    call(SoundServer::CMD_SET_EFFECT_ATTR, { 0, spu2::EFFECT_MODE_ECHO | spu2::EFFECT_MODE_CLEAR, 0x3FFF, 0x3FFF, 0, 0 });
+    call(SoundServer::CMD_SET_CORE_ATTR, { spu2::CORE_EFFECT_ENABLE, 1 });
+
+    // 2. Act: a second of sound.
+    call(SoundServer::CMD_SET_SWITCH, { spu2::S_KON, 1 });
+    const std::vector<s16> out = render(Spu2::SAMPLE_RATE);
+
+    // 3. Assert: nothing dry, then the echo, about two thirds of a second on (the preset
+    // taps its IIR output 0xFFA units of 4 steps, at 24 kHz, after writing it).
+    u32 first = 0;
+    while (first < Spu2::SAMPLE_RATE && out[first * 2] == 0) {
+        first++;
+    }
+    EXPECT_GT(first, 30000u);
+    EXPECT_LT(first, 34000u);
+    EXPECT_NE(out[first * 2 + 1], 0);
+}
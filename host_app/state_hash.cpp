@@ -0,0 +1,196 @@
+#include "state_hash.h"
+#include <cstring>
+
+#if STATE_HASH_SIMD_ENABLED
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr u32 PRIME32_1 = 0x9E3779B1u;
+constexpr u32 PRIME32_2 = 0x85EBCA77u;
+constexpr u32 PRIME32_3 = 0xC2B2AE3Du;
+constexpr u64 PRIME64_1 = 0x9E3779B185EBCA87ull;
+constexpr u64 PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+constexpr u64 PRIME64_3 = 0x165667B19E3779F9ull;
+constexpr u64 PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+constexpr u64 PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+constexpr size_t STRIPE = 64;
+constexpr size_t KEY_SIZE = 192;
+constexpr size_t KEY_STEP = 8;                                   // Key offset per stripe
+constexpr size_t STRIPES_PER_BLOCK = (KEY_SIZE - STRIPE) / KEY_STEP;
+constexpr size_t BLOCK = STRIPE * STRIPES_PER_BLOCK;
+constexpr size_t SCRAMBLE_KEY = KEY_SIZE - STRIPE;
+constexpr size_t LAST_STRIPE_KEY = KEY_SIZE - STRIPE - 7;
+constexpr size_t MERGE_KEY = 11;
+
+alignas(16) constexpr u64 INITIAL_LANES[8] = {
+    PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1,
+};
+
+struct Key {
+    u8 bytes[KEY_SIZE];
+};
+
+// SplitMix64 output: any well-mixed bytes do.
+constexpr Key make_key() {
+    Key key{};
+    u64 state = 0x243F6A8885A308D3ull;
+    for (size_t i = 0; i < KEY_SIZE / 8; i++) {
+        state += 0x9E3779B97F4A7C15ull;
+        u64 z = state;
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        z ^= z >> 31;
+        for (size_t b = 0; b < 8; b++) {
+            key.bytes[i * 8 + b] = (u8)(z >> (8 * b));
+        }
+    }
+    return key;
+}
+
+constexpr Key KEY = make_key();
+
+u64 read64(const u8* data) {
+    u64 value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+}
+
+u64 fold_multiply(u64 a, u64 b) {
+    const unsigned __int128 product = (unsigned __int128)a * b;
+    return (u64)product ^ (u64)(product >> 64);
+}
+
+u64 merge(const u64 lanes[8], size_t size) {
+    u64 hash = size * PRIME64_1;
+    for (u32 i = 0; i < 4; i++) {
+        const u8* key = KEY.bytes + MERGE_KEY + 16 * i;
+        hash += fold_multiply(lanes[2 * i] ^ read64(key), lanes[2 * i + 1] ^ read64(key + 8));
+    }
+    hash ^= hash >> 37;
+    hash *= 0x165667919E3779F9ull;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+// Every stripe but the last goes through the lanes a block at a time, scrambling after
+// each full block; the last stripe is the input's last 64 bytes, overlapping the one
+// before, or the whole input zero-padded when it is shorter than that.
+template <typename Lanes>
+u64 hash_with(const u8* data, size_t size) {
+    Lanes lanes;
+    alignas(16) u8 padded[STRIPE] = {};
+    const u8* last = padded;
+    if (size > STRIPE) {
+        const size_t stripes = (size - 1) / STRIPE;
+        const size_t blocks = stripes / STRIPES_PER_BLOCK;
+        for (size_t block = 0; block < blocks; block++) {
+            for (size_t stripe = 0; stripe < STRIPES_PER_BLOCK; stripe++) {
+                lanes.accumulate(data + block * BLOCK + stripe * STRIPE, KEY.bytes + stripe * KEY_STEP);
+            }
+            lanes.scramble(KEY.bytes + SCRAMBLE_KEY);
+        }
+        for (size_t stripe = 0; stripe < stripes % STRIPES_PER_BLOCK; stripe++) {
+            lanes.accumulate(data + blocks * BLOCK + stripe * STRIPE, KEY.bytes + stripe * KEY_STEP);
+        }
+        last = data + size - STRIPE;
+    } else if (size > 0) {
+        std::memcpy(padded, data, size);
+    }
+    lanes.accumulate(last, KEY.bytes + LAST_STRIPE_KEY);
+
+    alignas(16) u64 result[8];
+    lanes.store(result);
+    return merge(result, size);
+}
+
+struct ScalarLanes {
+    u64 lanes[8];
+
+    ScalarLanes() { std::memcpy(lanes, INITIAL_LANES, sizeof(lanes)); }
+
+    void accumulate(const u8* in, const u8* key) {
+        for (u32 i = 0; i < 8; i++) {
+            const u64 data = read64(in + 8 * i);
+            const u64 keyed = data ^ read64(key + 8 * i);
+            lanes[i ^ 1] += data;
+            lanes[i] += (keyed & 0xFFFFFFFFu) * (keyed >> 32);
+        }
+    }
+
+    void scramble(const u8* key) {
+        for (u32 i = 0; i < 8; i++) {
+            u64 lane = lanes[i];
+            lane ^= lane >> 47;
+            lane ^= read64(key + 8 * i);
+            lanes[i] = lane * PRIME32_1;
+        }
+    }
+
+    void store(u64 out[8]) const { std::memcpy(out, lanes, sizeof(lanes)); }
+};
+
+#if STATE_HASH_SIMD_ENABLED
+// Lanes 2i and 2i+1 in lanes[i].
+struct Sse2Lanes {
+    __m128i lanes[4];
+
+    Sse2Lanes() {
+        for (u32 i = 0; i < 4; i++) {
+            lanes[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(INITIAL_LANES) + i);
+        }
+    }
+
+    void accumulate(const u8* in, const u8* key) {
+        for (u32 i = 0; i < 4; i++) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in) + i);
+            const __m128i keyed = _mm_xor_si128(data, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key) + i));
+            // Low half of each lane times its high half, moved down for _mm_mul_epu32.
+            const __m128i product = _mm_mul_epu32(keyed, _mm_shuffle_epi32(keyed, _MM_SHUFFLE(0, 3, 0, 1)));
+            const __m128i swapped = _mm_shuffle_epi32(data, _MM_SHUFFLE(1, 0, 3, 2));
+            lanes[i] = _mm_add_epi64(lanes[i], _mm_add_epi64(product, swapped));
+        }
+    }
+
+    void scramble(const u8* key) {
+        const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+        for (u32 i = 0; i < 4; i++) {
+            __m128i lane = lanes[i];
+            lane = _mm_xor_si128(lane, _mm_srli_epi64(lane, 47));
+            lane = _mm_xor_si128(lane, _mm_loadu_si128(reinterpret_cast<const __m128i*>(key) + i));
+            // A 64x32 multiply from two 32x32 ones.
+            const __m128i low = _mm_mul_epu32(lane, prime);
+            const __m128i high = _mm_mul_epu32(_mm_srli_epi64(lane, 32), prime);
+            lanes[i] = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+        }
+    }
+
+    void store(u64 out[8]) const {
+        for (u32 i = 0; i < 4; i++) {
+            _mm_store_si128(reinterpret_cast<__m128i*>(out) + i, lanes[i]);
+        }
+    }
+};
+#endif
+
+} // namespace
+
+u64 state_hash_scalar(const void* data, size_t size) {
+    return hash_with<ScalarLanes>(static_cast<const u8*>(data), size);
+}
+
+#if STATE_HASH_SIMD_ENABLED
+u64 state_hash_sse2(const void* data, size_t size) {
+    return hash_with<Sse2Lanes>(static_cast<const u8*>(data), size);
+}
+#endif
+
+StateHashFunction state_hash_select() {
+#if STATE_HASH_SIMD_ENABLED
+    return &state_hash_sse2;
+#else
+    return &state_hash_scalar;
+#endif
+}
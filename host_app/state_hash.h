@@ -0,0 +1,34 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <cstddef>
+
+// A fast 64-bit hash for telling machine states apart: save state page versions (see
+// savestate.h) and per-frame determinism checks (frame_hash.h). Not for anything that has
+// to resist deliberate collisions.
+//
+// It is XXH3's long-input construction with a key of its own: eight 64-bit lanes, each
+// stripe of 64 input bytes XORed with a sliding window of the key and folded in with a
+// 32x32->64 multiply, the lanes scrambled every 1 KB, and a 128-bit multiply fold at the
+// end. The SSE2 version works on the lanes two at a time and gives the same hash.
+
+#if defined(__x86_64__)
+#define STATE_HASH_SIMD_ENABLED 1
+#else
+#define STATE_HASH_SIMD_ENABLED 0
+#endif
+
+using StateHashFunction = u64 (*)(const void* data, size_t size);
+
+u64 state_hash_scalar(const void* data, size_t size);
+#if STATE_HASH_SIMD_ENABLED
+u64 state_hash_sse2(const void* data, size_t size);
+#endif
+
+// The fastest version the CPU runs.
+StateHashFunction state_hash_select();
+
+inline u64 state_hash(const void* data, size_t size) {
+    static const StateHashFunction hash = state_hash_select();
+    return hash(data, size);
+}
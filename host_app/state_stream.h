@@ -0,0 +1,60 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+// The byte streams devices save themselves to and load themselves back from, for save
+// states (see savestate.h). Values go in host byte order and in the device's own layout:
+// a stream is only ever read back by the build that wrote it.
+
+class StateWriter {
+public:
+    explicit StateWriter(std::vector<u8>& out) : out(out) {}
+
+    template <typename T>
+    void write(const T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Save state values are copied bytewise");
+        write_bytes(&value, sizeof(value));
+    }
+
+    void write_bytes(const void* data, size_t size) {
+        const u8* bytes = static_cast<const u8*>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+private:
+    std::vector<u8>& out;
+};
+
+// Reads fail (return false, and keep failing) once the stream runs out.
+class StateReader {
+public:
+    StateReader(const u8* data, size_t size) : data(data), size(size), position(0), failed(false) {}
+
+    template <typename T>
+    bool read(T& value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Save state values are copied bytewise");
+        return read_bytes(&value, sizeof(value));
+    }
+
+    bool read_bytes(void* out, size_t count) {
+        if (failed || count > size - position) {
+            failed = true;
+            return false;
+        }
+        std::memcpy(out, data + position, count);
+        position += count;
+        return true;
+    }
+
+    bool ok() const { return !failed; }
+    bool at_end() const { return position == size; }
+
+private:
+    const u8* data;
+    size_t size;
+    size_t position;
+    bool failed;
+};
@@ -0,0 +1,200 @@
+#include "syscalls.h"
+#include "runtime.h"
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+Kernel& kernel_of(EmotionEngineState& context) {
+    return EEInstance::of(context).kernel;
+}
+
+u32 arg(const EmotionEngineState& context, int index) {
+    return context.cpuRegs.GPR.r[4 + index].UL[0];
+}
+
+void result(EmotionEngineState& context, s32 value) {
+    context.cpuRegs.GPR.n.v0.SD[0] = value;
+}
+
+// Numbers the kernel has no native version of: a game may have installed its own.
+template <u32 Number>
+void not_native(EmotionEngineState& context) {
+    const u32 function = kernel_of(context).guest_syscall(Number);
+    if (!function) {
+        std::cerr << "FATAL_ERROR: Syscall 0x" << std::hex << Number << " at 0x" << context.cpuRegs.pc
+                  << " is not implemented." << std::endl;
+        exit(1);
+    }
+    const GPR_reg ra = context.cpuRegs.GPR.n.ra;
+    call_guest_function(context, function);
+    context.cpuRegs.GPR.n.ra = ra;
+}
+
+void ignored(EmotionEngineState& context) {
+    result(context, 0);
+}
+
+void set_gs_crt(EmotionEngineState& context) { kernel_of(context).set_gs_crt(arg(context, 0), arg(context, 1), arg(context, 2)); }
+
+void exit_game(EmotionEngineState& context) {
+    std::cerr << "Game exited with status " << std::dec << (s32)arg(context, 0) << "." << std::endl;
+    exit((s32)arg(context, 0));
+}
+
+void add_intc_handler(EmotionEngineState& context) {
+    result(context, kernel_of(context).add_intc_handler(arg(context, 0), arg(context, 1), (s32)arg(context, 2), arg(context, 3)));
+}
+void remove_intc_handler(EmotionEngineState& context) { result(context, kernel_of(context).remove_intc_handler(arg(context, 0), (s32)arg(context, 1))); }
+void add_dmac_handler(EmotionEngineState& context) {
+    result(context, kernel_of(context).add_dmac_handler(arg(context, 0), arg(context, 1), (s32)arg(context, 2), arg(context, 3)));
+}
+void remove_dmac_handler(EmotionEngineState& context) { result(context, kernel_of(context).remove_dmac_handler(arg(context, 0), (s32)arg(context, 1))); }
+void enable_intc(EmotionEngineState& context) { result(context, kernel_of(context).enable_intc(arg(context, 0))); }
+void disable_intc(EmotionEngineState& context) { result(context, kernel_of(context).disable_intc(arg(context, 0))); }
+void enable_dmac(EmotionEngineState& context) { result(context, kernel_of(context).enable_dmac(arg(context, 0))); }
+void disable_dmac(EmotionEngineState& context) { result(context, kernel_of(context).disable_dmac(arg(context, 0))); }
+void set_alarm(EmotionEngineState& context) { result(context, kernel_of(context).set_alarm((u16)arg(context, 0), arg(context, 1), arg(context, 2))); }
+void release_alarm(EmotionEngineState& context) { result(context, kernel_of(context).release_alarm((s32)arg(context, 0))); }
+
+void create_thread(EmotionEngineState& context) { result(context, kernel_of(context).create_thread(arg(context, 0))); }
+void delete_thread(EmotionEngineState& context) { result(context, kernel_of(context).delete_thread((s32)arg(context, 0))); }
+void start_thread(EmotionEngineState& context) { result(context, kernel_of(context).start_thread((s32)arg(context, 0), arg(context, 1))); }
+void exit_thread(EmotionEngineState& context) { result(context, kernel_of(context).exit_thread()); }
+void exit_delete_thread(EmotionEngineState& context) { result(context, kernel_of(context).exit_delete_thread()); }
+void terminate_thread(EmotionEngineState& context) { result(context, kernel_of(context).terminate_thread((s32)arg(context, 0))); }
+void change_thread_priority(EmotionEngineState& context) {
+    result(context, kernel_of(context).change_thread_priority((s32)arg(context, 0), (s32)arg(context, 1)));
+}
+void rotate_thread_ready_queue(EmotionEngineState& context) { result(context, kernel_of(context).rotate_thread_ready_queue((s32)arg(context, 0))); }
+void release_wait_thread(EmotionEngineState& context) { result(context, kernel_of(context).release_wait_thread((s32)arg(context, 0))); }
+void get_thread_id(EmotionEngineState& context) { result(context, kernel_of(context).get_thread_id()); }
+void refer_thread_status(EmotionEngineState& context) { result(context, kernel_of(context).refer_thread_status((s32)arg(context, 0), arg(context, 1))); }
+void sleep_thread(EmotionEngineState& context) { result(context, kernel_of(context).sleep_thread()); }
+void wakeup_thread(EmotionEngineState& context) { result(context, kernel_of(context).wakeup_thread((s32)arg(context, 0))); }
+void cancel_wakeup_thread(EmotionEngineState& context) { result(context, kernel_of(context).cancel_wakeup_thread((s32)arg(context, 0))); }
+void suspend_thread(EmotionEngineState& context) { result(context, kernel_of(context).suspend_thread((s32)arg(context, 0))); }
+void resume_thread(EmotionEngineState& context) { result(context, kernel_of(context).resume_thread((s32)arg(context, 0))); }
+void setup_thread(EmotionEngineState& context) {
+    result(context, (s32)kernel_of(context).setup_thread(arg(context, 0), arg(context, 1), (s32)arg(context, 2), arg(context, 3)));
+}
+void setup_heap(EmotionEngineState& context) { result(context, (s32)kernel_of(context).setup_heap(arg(context, 0), (s32)arg(context, 1))); }
+void end_of_heap(EmotionEngineState& context) { result(context, (s32)kernel_of(context).end_of_heap()); }
+
+void create_sema(EmotionEngineState& context) { result(context, kernel_of(context).create_sema(arg(context, 0))); }
+void delete_sema(EmotionEngineState& context) { result(context, kernel_of(context).delete_sema((s32)arg(context, 0))); }
+void signal_sema(EmotionEngineState& context) { result(context, kernel_of(context).signal_sema((s32)arg(context, 0))); }
+void wait_sema(EmotionEngineState& context) { result(context, kernel_of(context).wait_sema((s32)arg(context, 0))); }
+void poll_sema(EmotionEngineState& context) { result(context, kernel_of(context).poll_sema((s32)arg(context, 0))); }
+void refer_sema_status(EmotionEngineState& context) { result(context, kernel_of(context).refer_sema_status((s32)arg(context, 0), arg(context, 1))); }
+
+void set_osd_config_param(EmotionEngineState& context) { kernel_of(context).set_osd_config_param(arg(context, 0)); }
+void get_osd_config_param(EmotionEngineState& context) { result(context, (s32)kernel_of(context).get_osd_config_param(arg(context, 0))); }
+void gs_get_imr(EmotionEngineState& context) { result(context, (s32)kernel_of(context).gs_get_imr()); }
+void gs_put_imr(EmotionEngineState& context) { result(context, (s32)kernel_of(context).gs_put_imr(arg(context, 0))); }
+void set_vsync_flag(EmotionEngineState& context) { kernel_of(context).set_vsync_flag(arg(context, 0), arg(context, 1)); }
+void set_syscall(EmotionEngineState& context) { kernel_of(context).set_syscall(arg(context, 0), arg(context, 1)); }
+void sif_dma_stat(EmotionEngineState& context) { result(context, EEInstance::of(context).iop.dma_stat((s32)arg(context, 0))); }
+void sif_set_dma(EmotionEngineState& context) { result(context, EEInstance::of(context).iop.set_dma(arg(context, 0), arg(context, 1))); }
+void sif_set_dchain(EmotionEngineState& context) { EEInstance::of(context).iop.set_dchain(); }
+
+// Registers 1-4 are the SIF's own (MSCOM, SMCOM, MSFLG, SMFLG); the rest are kernel
+// variables, except the IOP command buffer address the boot leaves behind.
+void sif_set_reg(EmotionEngineState& context) {
+    const u32 reg = arg(context, 0);
+    if (reg >= sif::REG_MAINADDR && reg <= sif::REG_SMFLAG) {
+        EEInstance::of(context).iop.write32(sif::MSCOM + (reg - sif::REG_MAINADDR) * 0x10, arg(context, 1));
+    } else {
+        kernel_of(context).sif_set_reg(reg, arg(context, 1));
+    }
+}
+
+void sif_get_reg(EmotionEngineState& context) {
+    const u32 reg = arg(context, 0);
+    Iop& iop = EEInstance::of(context).iop;
+    if (reg >= sif::REG_MAINADDR && reg <= sif::REG_SMFLAG) {
+        result(context, (s32)iop.read32(sif::MSCOM + (reg - sif::REG_MAINADDR) * 0x10));
+    } else if (reg == sif::SYSREG_SUBADDR) {
+        result(context, (s32)iop.read32(sif::SMCOM));
+    } else {
+        result(context, (s32)kernel_of(context).sif_get_reg(reg));
+    }
+}
+
+void machine_type(EmotionEngineState& context) { result(context, 0); }        // Retail
+void get_memory_size(EmotionEngineState& context) { result(context, (s32)fastmem::RAM_SIZE); }
+
+using SyscallTable = std::array<SyscallHandler, SYSCALL_COUNT>;
+
+template <size_t... Numbers>
+constexpr SyscallTable not_native_table(std::index_sequence<Numbers...>) {
+    return SyscallTable{ &not_native<Numbers>... };
+}
+
+constexpr SyscallTable build_syscall_table() {
+    SyscallTable table = not_native_table(std::make_index_sequence<SYSCALL_COUNT>());
+    table[SYS_SET_GS_CRT] = &set_gs_crt;
+    table[SYS_EXIT] = &exit_game;
+    table[SYS_ADD_INTC_HANDLER] = &add_intc_handler;
+    table[SYS_REMOVE_INTC_HANDLER] = &remove_intc_handler;
+    table[SYS_ADD_DMAC_HANDLER] = &add_dmac_handler;
+    table[SYS_REMOVE_DMAC_HANDLER] = &remove_dmac_handler;
+    table[SYS_ENABLE_INTC] = table[SYS_IENABLE_INTC] = &enable_intc;
+    table[SYS_DISABLE_INTC] = table[SYS_IDISABLE_INTC] = &disable_intc;
+    table[SYS_ENABLE_DMAC] = table[SYS_IENABLE_DMAC] = &enable_dmac;
+    table[SYS_DISABLE_DMAC] = table[SYS_IDISABLE_DMAC] = &disable_dmac;
+    table[SYS_SET_ALARM] = table[SYS_ISET_ALARM] = &set_alarm;
+    table[SYS_RELEASE_ALARM] = table[SYS_IRELEASE_ALARM] = &release_alarm;
+    table[SYS_CREATE_THREAD] = &create_thread;
+    table[SYS_DELETE_THREAD] = &delete_thread;
+    table[SYS_START_THREAD] = &start_thread;
+    table[SYS_EXIT_THREAD] = &exit_thread;
+    table[SYS_EXIT_DELETE_THREAD] = &exit_delete_thread;
+    table[SYS_TERMINATE_THREAD] = table[SYS_ITERMINATE_THREAD] = &terminate_thread;
+    table[SYS_DISABLE_DISPATCH_THREAD] = table[SYS_ENABLE_DISPATCH_THREAD] = &ignored;
+    table[SYS_CHANGE_THREAD_PRIORITY] = table[SYS_ICHANGE_THREAD_PRIORITY] = &change_thread_priority;
+    table[SYS_ROTATE_THREAD_READY_QUEUE] = table[SYS_IROTATE_THREAD_READY_QUEUE] = &rotate_thread_ready_queue;
+    table[SYS_RELEASE_WAIT_THREAD] = table[SYS_IRELEASE_WAIT_THREAD] = &release_wait_thread;
+    table[SYS_GET_THREAD_ID] = &get_thread_id;
+    table[SYS_REFER_THREAD_STATUS] = table[SYS_IREFER_THREAD_STATUS] = &refer_thread_status;
+    table[SYS_SLEEP_THREAD] = &sleep_thread;
+    table[SYS_WAKEUP_THREAD] = table[SYS_IWAKEUP_THREAD] = &wakeup_thread;
+    table[SYS_CANCEL_WAKEUP_THREAD] = table[SYS_ICANCEL_WAKEUP_THREAD] = &cancel_wakeup_thread;
+    table[SYS_SUSPEND_THREAD] = table[SYS_ISUSPEND_THREAD] = &suspend_thread;
+    table[SYS_RESUME_THREAD] = table[SYS_IRESUME_THREAD] = &resume_thread;
+    table[SYS_SETUP_THREAD] = &setup_thread;
+    table[SYS_SETUP_HEAP] = &setup_heap;
+    table[SYS_END_OF_HEAP] = &end_of_heap;
+    table[SYS_CREATE_SEMA] = &create_sema;
+    table[SYS_DELETE_SEMA] = table[SYS_IDELETE_SEMA] = &delete_sema;
+    table[SYS_SIGNAL_SEMA] = table[SYS_ISIGNAL_SEMA] = &signal_sema;
+    table[SYS_WAIT_SEMA] = &wait_sema;
+    table[SYS_POLL_SEMA] = table[SYS_IPOLL_SEMA] = &poll_sema;
+    table[SYS_REFER_SEMA_STATUS] = table[SYS_IREFER_SEMA_STATUS] = &refer_sema_status;
+    table[SYS_SET_OSD_CONFIG_PARAM] = &set_osd_config_param;
+    table[SYS_GET_OSD_CONFIG_PARAM] = &get_osd_config_param;
+    // Host memory is coherent, and stores over code are caught by SMC detection.
+    table[SYS_FLUSH_CACHE] = table[SYS_IFLUSH_CACHE] = &ignored;
+    table[SYS_GS_GET_IMR] = &gs_get_imr;
+    table[SYS_GS_PUT_IMR] = &gs_put_imr;
+    table[SYS_SET_VSYNC_FLAG] = &set_vsync_flag;
+    table[SYS_SET_SYSCALL] = &set_syscall;
+    table[SYS_SIF_DMA_STAT] = &sif_dma_stat;
+    table[SYS_SIF_SET_DMA] = &sif_set_dma;
+    table[SYS_SIF_SET_DCHAIN] = &sif_set_dchain;
+    table[SYS_SIF_SET_REG] = &sif_set_reg;
+    table[SYS_SIF_GET_REG] = &sif_get_reg;
+    table[SYS_DECI2_CALL] = &ignored;      // Debugger channel, there is no debugger
+    table[SYS_MACHINE_TYPE] = &machine_type;
+    table[SYS_GET_MEMORY_SIZE] = &get_memory_size;
+    return table;
+}
+
+} // namespace
+
+const std::array<SyscallHandler, SYSCALL_COUNT> syscall_table = build_syscall_table();
+
+void cpu_syscall(EmotionEngineState& context) {
+    syscall_table[syscall_index(context.cpuRegs.GPR.n.v1.SL[0])](context);
+}
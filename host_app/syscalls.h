@@ -0,0 +1,111 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <array>
+
+// EE kernel syscalls, by the number a SYSCALL finds in $v1 (see kernel.h for what they
+// do). The interrupt-context variants (iSignalSema...) are called with the negated
+// number of a slot of their own, which the same table serves.
+//
+// Recompiled code calls the table entry directly when it can work out $v1 at recompile
+// time (it is nearly always loaded right before the SYSCALL) and goes through
+// cpu_syscall() otherwise.
+
+enum SyscallNumber : u32 {
+    SYS_SET_GS_CRT = 0x02,
+    SYS_EXIT = 0x04,
+    SYS_ADD_INTC_HANDLER = 0x10,
+    SYS_REMOVE_INTC_HANDLER = 0x11,
+    SYS_ADD_DMAC_HANDLER = 0x12,
+    SYS_REMOVE_DMAC_HANDLER = 0x13,
+    SYS_ENABLE_INTC = 0x14,
+    SYS_DISABLE_INTC = 0x15,
+    SYS_ENABLE_DMAC = 0x16,
+    SYS_DISABLE_DMAC = 0x17,
+    SYS_SET_ALARM = 0x18,
+    SYS_RELEASE_ALARM = 0x19,
+    SYS_IENABLE_INTC = 0x1A,
+    SYS_IDISABLE_INTC = 0x1B,
+    SYS_IENABLE_DMAC = 0x1C,
+    SYS_IDISABLE_DMAC = 0x1D,
+    SYS_ISET_ALARM = 0x1E,
+    SYS_IRELEASE_ALARM = 0x1F,
+    SYS_CREATE_THREAD = 0x20,
+    SYS_DELETE_THREAD = 0x21,
+    SYS_START_THREAD = 0x22,
+    SYS_EXIT_THREAD = 0x23,
+    SYS_EXIT_DELETE_THREAD = 0x24,
+    SYS_TERMINATE_THREAD = 0x25,
+    SYS_ITERMINATE_THREAD = 0x26,
+    SYS_DISABLE_DISPATCH_THREAD = 0x27,
+    SYS_ENABLE_DISPATCH_THREAD = 0x28,
+    SYS_CHANGE_THREAD_PRIORITY = 0x29,
+    SYS_ICHANGE_THREAD_PRIORITY = 0x2A,
+    SYS_ROTATE_THREAD_READY_QUEUE = 0x2B,
+    SYS_IROTATE_THREAD_READY_QUEUE = 0x2C,
+    SYS_RELEASE_WAIT_THREAD = 0x2D,
+    SYS_IRELEASE_WAIT_THREAD = 0x2E,
+    SYS_GET_THREAD_ID = 0x2F,
+    SYS_REFER_THREAD_STATUS = 0x30,
+    SYS_IREFER_THREAD_STATUS = 0x31,
+    SYS_SLEEP_THREAD = 0x32,
+    SYS_WAKEUP_THREAD = 0x33,
+    SYS_IWAKEUP_THREAD = 0x34,
+    SYS_CANCEL_WAKEUP_THREAD = 0x35,
+    SYS_ICANCEL_WAKEUP_THREAD = 0x36,
+    SYS_SUSPEND_THREAD = 0x37,
+    SYS_ISUSPEND_THREAD = 0x38,
+    SYS_RESUME_THREAD = 0x39,
+    SYS_IRESUME_THREAD = 0x3A,
+    SYS_SETUP_THREAD = 0x3C,
+    SYS_SETUP_HEAP = 0x3D,
+    SYS_END_OF_HEAP = 0x3E,
+    SYS_CREATE_SEMA = 0x40,
+    SYS_DELETE_SEMA = 0x41,
+    SYS_SIGNAL_SEMA = 0x42,
+    SYS_ISIGNAL_SEMA = 0x43,
+    SYS_WAIT_SEMA = 0x44,
+    SYS_POLL_SEMA = 0x45,
+    SYS_IPOLL_SEMA = 0x46,
+    SYS_REFER_SEMA_STATUS = 0x47,
+    SYS_IREFER_SEMA_STATUS = 0x48,
+    SYS_IDELETE_SEMA = 0x49,
+    SYS_SET_OSD_CONFIG_PARAM = 0x4A,
+    SYS_GET_OSD_CONFIG_PARAM = 0x4B,
+    SYS_FLUSH_CACHE = 0x64,
+    SYS_IFLUSH_CACHE = 0x68,
+    SYS_GS_GET_IMR = 0x70,
+    SYS_GS_PUT_IMR = 0x71,
+    SYS_SET_VSYNC_FLAG = 0x73,
+    SYS_SET_SYSCALL = 0x74,
+    SYS_SIF_DMA_STAT = 0x76,
+    SYS_SIF_SET_DMA = 0x77,
+    SYS_SIF_SET_DCHAIN = 0x78,
+    SYS_SIF_SET_REG = 0x79,
+    SYS_SIF_GET_REG = 0x7A,
+    SYS_DECI2_CALL = 0x7C,
+    SYS_MACHINE_TYPE = 0x7E,
+    SYS_GET_MEMORY_SIZE = 0x7F,
+};
+
+constexpr u32 SYSCALL_COUNT = 128;
+
+// Takes its arguments from $a0-$a3 and leaves its result in $v0, like the kernel.
+using SyscallHandler = void (*)(EmotionEngineState& context);
+
+/**
+ * @brief Every syscall, indexed by syscall_index(). Numbers without a native
+ * implementation run the guest function installed with SetSyscall, if any, and are a
+ * fatal error otherwise.
+ */
+extern const std::array<SyscallHandler, SYSCALL_COUNT> syscall_table;
+
+// The table slot for the number in $v1.
+inline u32 syscall_index(s32 number) {
+    return (u32)(number < 0 ? -number : number) & (SYSCALL_COUNT - 1);
+}
+
+/**
+ * @brief SYSCALL with a $v1 only known at runtime.
+ */
+void cpu_syscall(EmotionEngineState& context);
@@ -0,0 +1,323 @@
+#include "timers.h"
+
+// Register offsets inside a timer's block (timer N lives at IO_START + N * 0x800).
+enum : u32 {
+    REG_COUNT = 0x00,
+    REG_MODE  = 0x10,
+    REG_COMP  = 0x20,
+    REG_HOLD  = 0x30,
+};
+
+static constexpr u32 COUNTER_RANGE = 0x10000;
+
+// EE cycles per count for each TN_MODE clock selection.
+static u32 cycles_per_tick(u32 mode) {
+    switch (mode & tmode::CLKS_MASK) {
+        case 0: return 2;
+        case 1: return 2 * 16;
+        case 2: return 2 * 256;
+        default: return Timers::CYCLES_PER_SCANLINE;
+    }
+}
+
+// With ZRET the counter wraps at COMP instead of at 0x10000, but only once it is below
+// COMP; a count written above COMP runs up to 0xFFFF first.
+static bool wraps_at_comp(u32 mode, u32 comp, u32 count) {
+    return (mode & tmode::ZRET) && comp != 0 && count < comp;
+}
+
+Timers::Timers(cpuRegisters& regs, Scheduler& scheduler) : regs(regs), scheduler(scheduler) {
+    static const char* const timer_event_names[TIMER_COUNT] = { "timer0", "timer1", "timer2", "timer3" };
+
+    for (u32 i = 0; i < TIMER_COUNT; i++) {
+        timers[i].owner = this;
+        timers[i].index = i;
+        timers[i].alarm.event = scheduler.register_event(timer_event_names[i], &on_timer, &timers[i]);
+    }
+    compare_alarm.event = scheduler.register_event("cop0_compare", &on_cop0_compare, this);
+    vblank_start_event = scheduler.register_event("vblank_start", &on_vblank_start, this);
+    vblank_end_event = scheduler.register_event("vblank_end", &on_vblank_end, this);
+    irq_hook = nullptr;
+    irq_user = nullptr;
+    reset();
+}
+
+void Timers::reset() {
+    for (u32 i = 0; i < TIMER_COUNT; i++) {
+        Timer& t = timers[i];
+        scheduler.cancel(t.alarm.event);
+        t.mode = 0;
+        t.comp = 0;
+        t.hold = 0;
+        t.base_count = 0;
+        t.base_cycle = regs.cycle;
+        t.cycles_per_tick = cycles_per_tick(0);
+        t.match_flags = 0;
+    }
+    frames = 0;
+
+    regs.CP0.n.Count = 0;
+    regs.CP0.n.Compare = 0;
+    regs.lastCOP0Cycle = regs.cycle;
+    schedule_compare();
+
+    scheduler.cancel(vblank_end_event);
+    scheduler.schedule(vblank_start_event, VISIBLE_SCANLINES * CYCLES_PER_SCANLINE);
+}
+
+void Timers::save_state(StateWriter& out) const {
+    for (const Timer& t : timers) {
+        const u32 fields[] = { t.mode, t.comp, t.hold, t.base_count, t.base_cycle, t.cycles_per_tick, t.match_flags };
+        out.write(fields);
+        out.write(t.alarm.left);
+        out.write(t.alarm.from);
+    }
+    out.write(compare_alarm.left);
+    out.write(compare_alarm.from);
+    out.write(frames);
+}
+
+bool Timers::load_state(StateReader& in) {
+    for (Timer& t : timers) {
+        u32 fields[7];
+        if (!in.read(fields) || !in.read(t.alarm.left) || !in.read(t.alarm.from)) {
+            return false;
+        }
+        t.mode = fields[0];
+        t.comp = fields[1];
+        t.hold = fields[2];
+        t.base_count = fields[3];
+        t.base_cycle = fields[4];
+        t.cycles_per_tick = fields[5];
+        t.match_flags = fields[6];
+    }
+    return in.read(compare_alarm.left) && in.read(compare_alarm.from) && in.read(frames);
+}
+
+void Timers::set_irq_hook(TimerIrqHook hook, void* user) {
+    irq_hook = hook;
+    irq_user = user;
+}
+
+void Timers::raise(u32 line) {
+    if (irq_hook) {
+        irq_hook(irq_user, line);
+    }
+}
+
+// --- Long delays ---
+
+void Timers::arm(Alarm& alarm, u64 delay) {
+    alarm.left = delay;
+    alarm.from = regs.cycle;
+    scheduler.schedule(alarm.event, delay < Scheduler::MAX_SLICE ? (u32)delay : Scheduler::MAX_SLICE);
+}
+
+// Called from the alarm's event. Returns false (and re-arms) when the event only fired
+// because the delay was capped at MAX_SLICE.
+bool Timers::expired(Alarm& alarm) {
+    const u32 elapsed = regs.cycle - alarm.from;
+    if (elapsed >= alarm.left) {
+        return true;
+    }
+    arm(alarm, alarm.left - elapsed);
+    return false;
+}
+
+// --- EE timers ---
+
+u32 Timers::count_of(const Timer& timer) const {
+    if (!(timer.mode & tmode::CUE)) {
+        return timer.base_count;
+    }
+    const u32 count = timer.base_count + (regs.cycle - timer.base_cycle) / timer.cycles_per_tick;
+    if (wraps_at_comp(timer.mode, timer.comp, timer.base_count)) {
+        return count % timer.comp;
+    }
+    return count % COUNTER_RANGE;
+}
+
+// Folds the ticks counted so far into base_count, keeping the phase of the next tick.
+// Done before any change to the timer, and at every VBLANK so that base_cycle never
+// falls far enough behind cycle for the subtraction to wrap.
+void Timers::rebase(Timer& timer) {
+    if (!(timer.mode & tmode::CUE)) {
+        timer.base_cycle = regs.cycle;
+        return;
+    }
+    const u32 ticks = (regs.cycle - timer.base_cycle) / timer.cycles_per_tick;
+    timer.base_count = count_of(timer);
+    timer.base_cycle += ticks * timer.cycles_per_tick;
+}
+
+// Arms the timer's event for the next compare match or overflow that has its interrupt
+// enabled. Must be called right after rebase().
+void Timers::schedule_match(Timer& timer) {
+    scheduler.cancel(timer.alarm.event);
+    timer.match_flags = 0;
+    if (!(timer.mode & tmode::CUE) || !(timer.mode & (tmode::CMPE | tmode::OVFE))) {
+        return;
+    }
+
+    const u32 count = timer.base_count;
+    const bool zret = wraps_at_comp(timer.mode, timer.comp, count);
+    u32 to_compare = 0;
+    u32 to_overflow = 0;
+    if (timer.mode & tmode::CMPE) {
+        // Reaching COMP under ZRET is the wrap back to 0.
+        to_compare = zret ? timer.comp - count : ((timer.comp - count) % COUNTER_RANGE);
+        if (to_compare == 0) {
+            to_compare = COUNTER_RANGE;
+        }
+    }
+    if ((timer.mode & tmode::OVFE) && !zret) {
+        to_overflow = COUNTER_RANGE - count;
+    }
+
+    u32 ticks;
+    if (to_compare && to_overflow) {
+        ticks = to_compare < to_overflow ? to_compare : to_overflow;
+        timer.match_flags = (to_compare == ticks ? tmode::EQUF : 0) | (to_overflow == ticks ? tmode::OVFF : 0);
+    } else if (to_compare) {
+        ticks = to_compare;
+        timer.match_flags = tmode::EQUF;
+    } else {
+        ticks = to_overflow;
+        timer.match_flags = tmode::OVFF;
+    }
+
+    const u32 phase = regs.cycle - timer.base_cycle;
+    arm(timer.alarm, (u64)ticks * timer.cycles_per_tick - phase);
+}
+
+void Timers::timer_match(u32 index) {
+    Timer& timer = timers[index];
+    if (!expired(timer.alarm)) {
+        return;
+    }
+
+    // Interrupts are edge-triggered: only a flag going from 0 to 1 raises one.
+    const u32 newly_set = timer.match_flags & ~timer.mode;
+    timer.mode |= timer.match_flags;
+    rebase(timer);
+    schedule_match(timer);
+    if (newly_set) {
+        raise(IRQ_TIMER0 + index);
+    }
+}
+
+void Timers::on_timer(void* user, s32) {
+    Timer* timer = static_cast<Timer*>(user);
+    timer->owner->timer_match(timer->index);
+}
+
+u32 Timers::read32(u32 address) {
+    if (address < IO_START || address >= IO_END) {
+        return 0;
+    }
+    const u32 index = (address - IO_START) >> 11;
+    Timer& timer = timers[index];
+    switch (address & 0x7FF) {
+        case REG_COUNT: return count_of(timer);
+        case REG_MODE:  return timer.mode;
+        case REG_COMP:  return timer.comp;
+        case REG_HOLD:  return index < 2 ? timer.hold : 0;
+        default:        return 0;
+    }
+}
+
+u32 Timers::command_bits(u32 address) {
+    return address >= IO_START && address < IO_END && (address & 0x7FF) == REG_MODE ? tmode::FLAGS : 0;
+}
+
+void Timers::write32(u32 address, u32 value) {
+    if (address < IO_START || address >= IO_END) {
+        return;
+    }
+    const u32 index = (address - IO_START) >> 11;
+    Timer& timer = timers[index];
+    rebase(timer);
+    switch (address & 0x7FF) {
+        case REG_COUNT:
+            timer.base_count = value & 0xFFFF;
+            timer.base_cycle = regs.cycle;
+            break;
+        case REG_MODE: {
+            const bool starting = !(timer.mode & tmode::CUE) && (value & tmode::CUE);
+            const u32 flags = timer.mode & tmode::FLAGS & ~value;
+            timer.mode = flags | (value & tmode::WRITABLE);
+            timer.cycles_per_tick = cycles_per_tick(timer.mode);
+            if (starting) {
+                timer.base_cycle = regs.cycle;
+            }
+            break;
+        }
+        case REG_COMP:
+            timer.comp = value & 0xFFFF;
+            break;
+        case REG_HOLD:
+            if (index < 2) {
+                timer.hold = value & 0xFFFF;
+            }
+            return;
+        default:
+            return;
+    }
+    schedule_match(timer);
+}
+
+// --- COP0 timer ---
+
+// Count runs at the EE clock, so it is simply advanced by the cycles since it was last
+// brought up to date (lastCOP0Cycle).
+u32 Timers::read_count() {
+    regs.CP0.n.Count += regs.cycle - regs.lastCOP0Cycle;
+    regs.lastCOP0Cycle = regs.cycle;
+    return regs.CP0.n.Count;
+}
+
+void Timers::write_count(u32 value) {
+    regs.CP0.n.Count = value;
+    regs.lastCOP0Cycle = regs.cycle;
+    schedule_compare();
+}
+
+void Timers::write_compare(u32 value) {
+    regs.CP0.n.Compare = value;
+    regs.CP0.n.Cause &= ~CAUSE_IP7;
+    schedule_compare();
+}
+
+void Timers::schedule_compare() {
+    const u32 left = regs.CP0.n.Compare - read_count();
+    // Count == Compare right now matches again only after a full wrap.
+    arm(compare_alarm, left != 0 ? left : (1ull << 32));
+}
+
+void Timers::on_cop0_compare(void* user, s32 cycles_late) {
+    Timers* self = static_cast<Timers*>(user);
+    if (!self->expired(self->compare_alarm)) {
+        return;
+    }
+    self->regs.CP0.n.Cause |= CAUSE_IP7;
+    self->arm(self->compare_alarm, (1ull << 32) - (u32)cycles_late);
+}
+
+// --- Video timing ---
+
+void Timers::on_vblank_start(void* user, s32 cycles_late) {
+    Timers* self = static_cast<Timers*>(user);
+    const u32 blank = (SCANLINES_PER_FRAME - VISIBLE_SCANLINES) * CYCLES_PER_SCANLINE;
+    self->scheduler.schedule(self->vblank_end_event, blank - cycles_late);
+    self->raise(IRQ_VBLANK_START);
+}
+
+void Timers::on_vblank_end(void* user, s32 cycles_late) {
+    Timers* self = static_cast<Timers*>(user);
+    self->frames++;
+    for (u32 i = 0; i < TIMER_COUNT; i++) {
+        self->rebase(self->timers[i]);
+    }
+    self->scheduler.schedule(self->vblank_start_event, VISIBLE_SCANLINES * CYCLES_PER_SCANLINE - cycles_late);
+    self->raise(IRQ_VBLANK_END);
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "scheduler.h"
+
+// EE timers T0-T3, the COP0 Count/Compare timer and the video timing (HBLANK/VBLANK)
+// they count against. See "EE Timers" and "EE COP0 Timer" in docs/ps2_docs.txt.
+//
+// Nothing here is ticked. Each counter is kept as the value it had at a base cycle plus
+// the rate it counts at, and a read works out the current value from cpuRegs.cycle.
+// A scheduler event is only armed for the next compare match or overflow that would
+// actually raise an interrupt, so a timer costs nothing between accesses.
+//
+// Gated counting (TN_MODE bits 2-5) is not emulated; gated timers count as if ungated.
+
+// Bits of TN_MODE.
+namespace tmode {
+    constexpr u32 CLKS_MASK = 3u;       // 0 = BUSCLK, 1 = BUSCLK/16, 2 = BUSCLK/256, 3 = HBLANK
+    constexpr u32 GATE = 1u << 2;
+    constexpr u32 GATS = 1u << 3;
+    constexpr u32 GATM_MASK = 3u << 4;
+    constexpr u32 ZRET = 1u << 6;       // Clear the counter when it reaches COMP
+    constexpr u32 CUE = 1u << 7;        // Count enable
+    constexpr u32 CMPE = 1u << 8;       // Compare interrupt enable
+    constexpr u32 OVFE = 1u << 9;       // Overflow interrupt enable
+    constexpr u32 EQUF = 1u << 10;      // Compare flag, write 1 to clear
+    constexpr u32 OVFF = 1u << 11;      // Overflow flag, write 1 to clear
+    constexpr u32 FLAGS = EQUF | OVFF;
+    constexpr u32 WRITABLE = 0x3FF;
+}
+
+// Called with the INTC_STAT bit to raise (2/3 for VBLANK start/end, 9-12 for T0-T3).
+using TimerIrqHook = void (*)(void* user, u32 line);
+
+class Timers {
+public:
+    static constexpr u32 IO_START = 0x10000000;
+    static constexpr u32 IO_END = 0x10002000;   // exclusive
+    static constexpr u32 TIMER_COUNT = 4;
+
+    // NTSC video timing, in EE cycles (9370 BUSCLK per scanline, BUSCLK = EE clock / 2).
+    static constexpr u32 CYCLES_PER_SCANLINE = 2 * 9370;
+    static constexpr u32 SCANLINES_PER_FRAME = 262;
+    static constexpr u32 VISIBLE_SCANLINES = 240;
+
+    // INTC_STAT bits raised through the irq hook.
+    static constexpr u32 IRQ_VBLANK_START = 2;
+    static constexpr u32 IRQ_VBLANK_END = 3;
+    static constexpr u32 IRQ_TIMER0 = 9;
+
+    // Cause bit set when COP0.Count reaches COP0.Compare (IP7).
+    static constexpr u32 CAUSE_IP7 = 1u << 15;
+
+    /**
+     * @brief Registers the timer events with `scheduler` and starts video timing.
+     * @param regs The CPU whose cycle counter drives the timers and whose COP0 holds
+     * Count/Compare.
+     */
+    Timers(cpuRegisters& regs, Scheduler& scheduler);
+
+    void reset();
+
+    /**
+     * @brief Reads a timer register (TN_COUNT, TN_MODE, TN_COMP, TN_HOLD).
+     * @return The register value, 0 for unmapped offsets.
+     */
+    u32 read32(u32 address);
+
+    /**
+     * @brief Writes a timer register and re-arms the timer's match event.
+     */
+    void write32(u32 address, u32 value);
+
+    // Bits of a register that act when written as 1: TN_MODE's write-1-to-clear flags.
+    static u32 command_bits(u32 address);
+
+    void set_irq_hook(TimerIrqHook hook, void* user);
+
+    // COP0.Count, brought up to date with cpuRegs.cycle.
+    u32 read_count();
+    void write_count(u32 value);
+
+    /**
+     * @brief Writes COP0.Compare, which also acknowledges a pending COP0 timer interrupt.
+     */
+    void write_compare(u32 value);
+
+    // Frames completed since reset, counted at the end of each VBLANK.
+    u32 frame() const { return frames; }
+
+    // Save states (see savestate.h). The alarms' events are the scheduler's to save.
+    void save_state(StateWriter& out) const;
+    bool load_state(StateReader& in);
+
+private:
+    // A match that can be further away than the scheduler's MAX_SLICE. The event is
+    // re-armed for what is left until the whole delay has passed.
+    struct Alarm {
+        int event;
+        u64 left;
+        u32 from;
+    };
+
+    struct Timer {
+        Timers* owner;
+        u32 index;
+        u32 mode;
+        u32 comp;
+        u32 hold;
+        u32 base_count;     // Count at base_cycle
+        u32 base_cycle;
+        u32 cycles_per_tick;
+        u32 match_flags;    // Flags the armed alarm sets when it goes off
+        Alarm alarm;
+    };
+
+    static void on_timer(void* user, s32 cycles_late);
+    static void on_cop0_compare(void* user, s32 cycles_late);
+    static void on_vblank_start(void* user, s32 cycles_late);
+    static void on_vblank_end(void* user, s32 cycles_late);
+
+    void arm(Alarm& alarm, u64 delay);
+    bool expired(Alarm& alarm);
+
+    u32 count_of(const Timer& timer) const;
+    void rebase(Timer& timer);
+    void schedule_match(Timer& timer);
+    void schedule_compare();
+    void timer_match(u32 index);
+    void raise(u32 line);
+
+    cpuRegisters& regs;
+    Scheduler& scheduler;
+    Timer timers[TIMER_COUNT];
+    Alarm compare_alarm;
+    int vblank_start_event;
+    int vblank_end_event;
+    u32 frames;
+    TimerIrqHook irq_hook;
+    void* irq_user;
+};
@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+#include "timers.h"
+#include <vector>
+
+namespace {
+
+struct Irqs {
+    std::vector<u32> lines;
+
+    static void raise(void* user, u32 line) {
+        static_cast<Irqs*>(user)->lines.push_back(line);
+    }
+};
+
+class TimersTest : public ::testing::Test {
+protected:
+    TimersTest() : regs(), scheduler(regs), timers(regs, scheduler) {
+        timers.set_irq_hook(&Irqs::raise, &irqs);
+    }
+
+    // Moves time forward the way recompiled code does, entering the scheduler at
+    // block exits whenever an event is due.
+    void run_for(u32 cycles, u32 block = 100) {
+        for (u32 done = 0; done < cycles; done += block) {
+            regs.cycle += block;
+            if ((s32)(regs.cycle - regs.nextEventCycle) >= 0) {
+                scheduler.run_due();
+            }
+        }
+    }
+
+    u32 timer_reg(u32 index, u32 offset) const { return Timers::IO_START + index * 0x800 + offset; }
+
+    cpuRegisters regs;
+    Scheduler scheduler;
+    Timers timers;
+    Irqs irqs;
+};
+
+} // namespace
+
+TEST_F(TimersTest, CountIsComputedFromCycleOnRead) {
+    // 1. Arrange: T0 on BUSCLK/16, i.e. one count every 32 EE cycles.
+    timers.write32(timer_reg(0, 0x10), tmode::CUE | 1);
+
+    // 2. Act
+    regs.cycle += 32 * 100 + 31;
+
+    // 3. Assert: nothing was scheduled for it, the value is just worked out.
+    EXPECT_EQ(timers.read32(timer_reg(0, 0x00)), 100u);
+    EXPECT_EQ(regs.nextEventCycle, Timers::VISIBLE_SCANLINES * Timers::CYCLES_PER_SCANLINE);
+
+    // Writing COUNT restarts from the written value.
+    timers.write32(timer_reg(0, 0x00), 0xFFF0);
+    regs.cycle += 32 * 0x20;
+    EXPECT_EQ(timers.read32(timer_reg(0, 0x00)), 0x10u);
+}
+
+TEST_F(TimersTest, CompareMatchIsPostedOnlyWhenDue) {
+    timers.write32(timer_reg(1, 0x20), 500);
+    timers.write32(timer_reg(1, 0x10), tmode::CUE | tmode::CMPE);   // BUSCLK, 2 cycles per count
+    EXPECT_EQ(regs.nextEventCycle, 1000u);
+
+    run_for(900);
+    EXPECT_TRUE(irqs.lines.empty());
+
+    run_for(200);
+    ASSERT_EQ(irqs.lines.size(), 1u);
+    EXPECT_EQ(irqs.lines[0], Timers::IRQ_TIMER0 + 1);
+    EXPECT_TRUE(timers.read32(timer_reg(1, 0x10)) & tmode::EQUF);
+}
+
+TEST_F(TimersTest, InterruptsAreEdgeTriggered) {
+    // ZRET: the timer wraps at COMP, so it matches every 100 counts.
+    timers.write32(timer_reg(2, 0x20), 100);
+    timers.write32(timer_reg(2, 0x10), tmode::CUE | tmode::CMPE | tmode::ZRET);
+
+    run_for(200 * 3);
+    EXPECT_EQ(irqs.lines.size(), 1u);       // Flag never cleared, so only the first edge
+    EXPECT_LT(timers.read32(timer_reg(2, 0x00)), 100u);
+
+    // Writing 1 to EQUF clears it, and the next match raises again.
+    timers.write32(timer_reg(2, 0x10), tmode::CUE | tmode::CMPE | tmode::ZRET | tmode::EQUF);
+    EXPECT_FALSE(timers.read32(timer_reg(2, 0x10)) & tmode::EQUF);
+    run_for(200);
+    EXPECT_EQ(irqs.lines.size(), 2u);
+}
+
+TEST_F(TimersTest, OverflowInterrupt) {
+    timers.write32(timer_reg(3, 0x00), 0xFFFE);
+    timers.write32(timer_reg(3, 0x10), tmode::CUE | tmode::OVFE);
+
+    run_for(100, 1);
+    ASSERT_EQ(irqs.lines.size(), 1u);
+    EXPECT_EQ(irqs.lines[0], Timers::IRQ_TIMER0 + 3);
+    EXPECT_TRUE(timers.read32(timer_reg(3, 0x10)) & tmode::OVFF);
+    EXPECT_FALSE(timers.read32(timer_reg(3, 0x10)) & tmode::EQUF);
+}
+
+TEST_F(TimersTest, Cop0CompareSetsCauseAndWriteAcknowledges) {
+    timers.write_compare(5000);
+    run_for(4900);
+    EXPECT_EQ(timers.read_count(), 4900u);
+    EXPECT_FALSE(regs.CP0.n.Cause & Timers::CAUSE_IP7);
+
+    run_for(200);
+    EXPECT_TRUE(regs.CP0.n.Cause & Timers::CAUSE_IP7);
+
+    timers.write_compare(timers.read_count() + 1000);
+    EXPECT_FALSE(regs.CP0.n.Cause & Timers::CAUSE_IP7);
+}
+
+TEST_F(TimersTest, VblankStartAndEndEachFrame) {
+    const u32 frame = Timers::SCANLINES_PER_FRAME * Timers::CYCLES_PER_SCANLINE;
+    run_for(frame * 2, 1000);
+
+    ASSERT_EQ(irqs.lines.size(), 4u);
+    EXPECT_EQ(irqs.lines[0], Timers::IRQ_VBLANK_START);
+    EXPECT_EQ(irqs.lines[1], Timers::IRQ_VBLANK_END);
+    EXPECT_EQ(irqs.lines[2], Timers::IRQ_VBLANK_START);
+    EXPECT_EQ(irqs.lines[3], Timers::IRQ_VBLANK_END);
+    EXPECT_EQ(timers.frame(), 2u);
+}
@@ -0,0 +1,153 @@
+#include "tlb.h"
+#include "fastmem.h"
+
+// KSEG0/KSEG1 are never translated, whatever an entry says.
+static bool is_unmapped_segment(u64 start, u64 end) {
+    return start < 0xC0000000ull && end > 0x80000000ull;
+}
+
+Tlb::Tlb(cpuRegisters& regs) : regs(regs), entries() {
+    regs.CP0.n.Random = ENTRY_COUNT - 1;
+}
+
+void Tlb::reset() {
+    for (Entry& entry : entries) {
+        unmap(entry);
+        entry = Entry{};
+    }
+    regs.CP0.n.Random = ENTRY_COUNT - 1;
+}
+
+u32 Tlb::page_size(const Entry& entry) {
+    return ((entry.page_mask & tlb_bits::PAGE_MASK_MASK) >> 1) + fastmem::PAGE_SIZE;
+}
+
+// Virtual address of the even page; the odd page follows it.
+u32 Tlb::even_page(const Entry& entry) {
+    return entry.entry_hi & tlb_bits::HI_VPN2_MASK & ~(entry.page_mask & tlb_bits::PAGE_MASK_MASK);
+}
+
+bool Tlb::overlaps(const Entry& a, const Entry& b) {
+    const u64 a_start = even_page(a), a_end = a_start + 2ull * page_size(a);
+    const u64 b_start = even_page(b), b_end = b_start + 2ull * page_size(b);
+    return a_start < b_end && b_start < a_end;
+}
+
+void Tlb::map(const Entry& entry) {
+    const u32 size = page_size(entry);
+    const u32 lo[2] = { entry.entry_lo0, entry.entry_lo1 };
+    for (u32 half = 0; half < 2; half++) {
+        const u32 address = even_page(entry) + half * size;
+        if (!(lo[half] & tlb_bits::LO_VALID) || is_unmapped_segment(address, (u64)address + size)) {
+            continue;
+        }
+
+        // The scratchpad entry (S in EntryLo0) maps the 16 KB scratchpad, not RAM.
+        if (half == 0 && (lo[half] & tlb_bits::LO_SCRATCHPAD)) {
+            fastmem_map_pages(address, size < fastmem::SCRATCHPAD_SIZE ? size : fastmem::SCRATCHPAD_SIZE, PageTarget::Scratchpad, 0);
+            continue;
+        }
+
+        const u32 physical = (((lo[half] >> tlb_bits::LO_PFN_SHIFT) & tlb_bits::LO_PFN_MASK) << fastmem::PAGE_SHIFT) & ~(size - 1);
+        const bool ram = (u64)physical + size <= fastmem::RAM_SIZE;
+        fastmem_map_pages(address, size, ram ? PageTarget::Ram : PageTarget::Device, physical);
+    }
+}
+
+void Tlb::unmap(const Entry& entry) {
+    const u32 size = page_size(entry);
+    const u32 lo[2] = { entry.entry_lo0, entry.entry_lo1 };
+    for (u32 half = 0; half < 2; half++) {
+        const u32 address = even_page(entry) + half * size;
+        if ((lo[half] & tlb_bits::LO_VALID) && !is_unmapped_segment(address, (u64)address + size)) {
+            fastmem_unmap_pages(address, size);
+        }
+    }
+}
+
+void Tlb::write(u32 index) {
+    index &= 0x3F;
+    if (index >= ENTRY_COUNT) {
+        return;
+    }
+
+    const Entry previous = entries[index];
+    Entry& entry = entries[index];
+    entry.page_mask = regs.CP0.n.PageMask & tlb_bits::PAGE_MASK_MASK;
+    entry.entry_hi = regs.CP0.n.EntryHi & (tlb_bits::HI_VPN2_MASK | tlb_bits::HI_ASID_MASK);
+    entry.entry_lo0 = regs.CP0.n.EntryLo0;
+    entry.entry_lo1 = regs.CP0.n.EntryLo1;
+
+    // Only the pages of the old and new entry change. Entries that shared pages with the
+    // old one get them back.
+    unmap(previous);
+    for (u32 other = 0; other < ENTRY_COUNT; other++) {
+        if (other != index && overlaps(entries[other], previous)) {
+            map(entries[other]);
+        }
+    }
+    map(entry);
+}
+
+void Tlb::save_state(StateWriter& out) const {
+    out.write(entries);
+}
+
+bool Tlb::load_state(StateReader& in) {
+    Entry loaded[ENTRY_COUNT];
+    if (!in.read(loaded)) {
+        return false;
+    }
+    for (Entry& entry : entries) {
+        unmap(entry);
+    }
+    for (u32 i = 0; i < ENTRY_COUNT; i++) {
+        entries[i] = loaded[i];
+        map(entries[i]);
+    }
+    return true;
+}
+
+void Tlb::write_indexed() {
+    write(regs.CP0.n.Index);
+}
+
+void Tlb::write_random() {
+    u32 index = regs.CP0.n.Random & 0x3F;
+    if (index >= ENTRY_COUNT) {
+        index = ENTRY_COUNT - 1;
+    }
+    write(index);
+
+    // Random really counts down every instruction; stepping it per TLBWR still walks
+    // every non-wired entry.
+    const u32 wired = regs.CP0.n.Wired & 0x3F;
+    regs.CP0.n.Random = index <= wired ? ENTRY_COUNT - 1 : index - 1;
+}
+
+void Tlb::probe() {
+    const u32 hi = regs.CP0.n.EntryHi;
+    for (u32 index = 0; index < ENTRY_COUNT; index++) {
+        const Entry& entry = entries[index];
+        const u32 vpn_mask = tlb_bits::HI_VPN2_MASK & ~entry.page_mask;
+        const bool global = (entry.entry_lo0 & entry.entry_lo1 & tlb_bits::LO_GLOBAL) != 0;
+        if ((entry.entry_hi & vpn_mask) == (hi & vpn_mask) &&
+            (global || (entry.entry_hi & tlb_bits::HI_ASID_MASK) == (hi & tlb_bits::HI_ASID_MASK))) {
+            regs.CP0.n.Index = index;
+            return;
+        }
+    }
+    regs.CP0.n.Index = tlb_bits::INDEX_PROBE_FAILED;
+}
+
+void Tlb::read() {
+    const u32 index = regs.CP0.n.Index & 0x3F;
+    if (index >= ENTRY_COUNT) {
+        return;
+    }
+    const Entry& entry = entries[index];
+    regs.CP0.n.PageMask = entry.page_mask;
+    regs.CP0.n.EntryHi = entry.entry_hi;
+    regs.CP0.n.EntryLo0 = entry.entry_lo0;
+    regs.CP0.n.EntryLo1 = entry.entry_lo1;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "cpu_state.h"
+#include "state_stream.h"
+
+// The EE's 48-entry TLB. See "EE COP0 Memory Management" in docs/ps2_docs.txt.
+//
+// Entries are not searched on memory accesses. Each TLBWI/TLBWR pushes the pages of the
+// entry it replaces and of the new entry into fastmem's 4 KB page table (and, with
+// fastmem, into the host mapping), so a TLB-mapped access costs the same as any other.
+// Pages no entry covers keep the fixed layout the kernel sets up: RAM and its mirrors,
+// the scratchpad at 0x70000000 and the device registers.
+//
+// ASIDs are not tracked in the page table: the last written entry for a page wins,
+// which is what PS2 software (a single address space) expects. The dirty bit is not
+// enforced.
+
+// Bits of EntryLo0/EntryLo1, EntryHi and PageMask.
+namespace tlb_bits {
+    constexpr u32 LO_GLOBAL = 1u << 0;
+    constexpr u32 LO_VALID = 1u << 1;
+    constexpr u32 LO_DIRTY = 1u << 2;
+    constexpr u32 LO_PFN_SHIFT = 6;
+    constexpr u32 LO_PFN_MASK = 0x000FFFFFu;
+    constexpr u32 LO_SCRATCHPAD = 1u << 31;
+    constexpr u32 HI_ASID_MASK = 0xFFu;
+    constexpr u32 HI_VPN2_MASK = 0xFFFFE000u;
+    constexpr u32 PAGE_MASK_MASK = 0x01FFE000u;
+    constexpr u32 INDEX_PROBE_FAILED = 1u << 31;
+}
+
+class Tlb {
+public:
+    static constexpr u32 ENTRY_COUNT = 48;
+
+    /**
+     * @param regs The CPU whose COP0 Index/Random/Wired/EntryLo/EntryHi/PageMask the
+     * TLB instructions use.
+     */
+    explicit Tlb(cpuRegisters& regs);
+
+    // Invalidates every entry and drops their mappings.
+    void reset();
+
+    // TLBWI: writes the entry selected by Index.
+    void write_indexed();
+
+    // TLBWR: writes the entry selected by Random, then steps Random down towards Wired.
+    void write_random();
+
+    // TLBP: sets Index to the entry matching EntryHi, or to bit 31 if there is none.
+    void probe();
+
+    // TLBR: loads the entry selected by Index into PageMask/EntryHi/EntryLo0/EntryLo1.
+    void read();
+
+    // Save states (see savestate.h). Loading remaps the bound address space to the
+    // loaded entries.
+    void save_state(StateWriter& out) const;
+    bool load_state(StateReader& in);
+
+private:
+    struct Entry {
+        u32 page_mask;
+        u32 entry_hi;
+        u32 entry_lo0;
+        u32 entry_lo1;
+    };
+
+    void write(u32 index);
+    static void map(const Entry& entry);
+    static void unmap(const Entry& entry);
+    static u32 page_size(const Entry& entry);
+    static u32 even_page(const Entry& entry);
+    static bool overlaps(const Entry& a, const Entry& b);
+
+    cpuRegisters& regs;
+    Entry entries[ENTRY_COUNT];
+};
@@ -0,0 +1,128 @@
+#include "gtest/gtest.h"
+#include "tlb.h"
+#include "memory.h"
+#include <vector>
+
+namespace {
+
+std::vector<u32> device_reads;
+
+bool on_mmio_read(u32 address, u32 size, void* value) {
+    device_reads.push_back(address);
+    std::memset(value, 0xAB, size);
+    return true;
+}
+
+bool on_mmio_write(u32, u32, const void*) {
+    return false;
+}
+
+// EntryLo for a valid, dirty 4 KB page at `physical`.
+u32 entry_lo(u32 physical) {
+    return ((physical >> 12) << tlb_bits::LO_PFN_SHIFT) | tlb_bits::LO_VALID | tlb_bits::LO_DIRTY;
+}
+
+class TlbTest : public ::testing::Test {
+protected:
+    TlbTest() : regs(), tlb(regs) {
+        EXPECT_TRUE(fastmem_init());
+        fastmem_set_mmio_handlers(&on_mmio_read, &on_mmio_write);
+        device_reads.clear();
+    }
+    ~TlbTest() override {
+        tlb.reset();
+        fastmem_set_mmio_handlers(nullptr, nullptr);
+    }
+
+    void write_entry(u32 index, u32 virtual_address, u32 lo0, u32 lo1, u32 page_mask = 0) {
+        regs.CP0.n.Index = index;
+        regs.CP0.n.EntryHi = virtual_address;
+        regs.CP0.n.EntryLo0 = lo0;
+        regs.CP0.n.EntryLo1 = lo1;
+        regs.CP0.n.PageMask = page_mask;
+        tlb.write_indexed();
+    }
+
+    cpuRegisters regs;
+    Tlb tlb;
+};
+
+} // namespace
+
+TEST_F(TlbTest, MappedPagesReachTheirPhysicalMemory) {
+    // 1. Arrange: 0x40000000 is not RAM in the fixed layout.
+    WriteMemory32(0x00100010, 0x11111111);
+    WriteMemory32(0x00101020, 0x22222222);
+
+    // 2. Act: map the even/odd pair onto physical 0x100000 and 0x101000.
+    write_entry(3, 0x40000000, entry_lo(0x00100000), entry_lo(0x00101000));
+
+    // 3. Assert
+    EXPECT_EQ(ReadMemory32(0x40000010), 0x11111111u);
+    EXPECT_EQ(ReadMemory32(0x40001020), 0x22222222u);
+    WriteMemory32(0x40000014, 0x33333333);
+    EXPECT_EQ(ReadMemory32(0x00100014), 0x33333333u);
+    EXPECT_NE(fastmem_translate(0x40000000, 4), nullptr);
+}
+
+TEST_F(TlbTest, OverwritingAnEntryOnlyUnmapsItsPages) {
+    write_entry(0, 0x40000000, entry_lo(0x00200000), 0);
+    write_entry(1, 0x40010000, entry_lo(0x00201000), 0);
+
+    write_entry(0, 0x40020000, entry_lo(0x00202000), 0);
+
+    EXPECT_EQ(fastmem_translate(0x40000000, 4), nullptr);
+    EXPECT_EQ(fastmem_translate(0x40010000, 4), main_memory.data() + 0x00201000);
+    EXPECT_EQ(fastmem_translate(0x40020000, 4), main_memory.data() + 0x00202000);
+    EXPECT_EQ(fastmem_translate(0x40021000, 4), nullptr);   // Odd page is not valid
+
+    // Remapping over a RAM mirror and dropping it again restores the mirror.
+    write_entry(2, 0x00000000, entry_lo(0x00300000), 0);
+    EXPECT_EQ(fastmem_translate(0x00000000, 4), main_memory.data() + 0x00300000);
+    tlb.reset();
+    EXPECT_EQ(fastmem_translate(0x00000000, 4), main_memory.data());
+}
+
+TEST_F(TlbTest, LargePagesAndScratchpad) {
+    // 16 KB pages (PageMask 3 << 13): each half covers four table entries.
+    write_entry(4, 0x50000000, entry_lo(0x00400000), entry_lo(0x00404000), 0x3u << 13);
+    EXPECT_EQ(fastmem_translate(0x50003FFC, 4), main_memory.data() + 0x00403FFC);
+    EXPECT_EQ(fastmem_translate(0x50004000, 4), main_memory.data() + 0x00404000);
+
+    write_entry(5, 0x60000000, tlb_bits::LO_SCRATCHPAD | tlb_bits::LO_VALID | tlb_bits::LO_DIRTY, 0, 0x3u << 13);
+    WriteMemory32(0x60000100, 0xFEEDFACE);
+    EXPECT_EQ(ReadMemory32(fastmem::SCRATCHPAD_START + 0x100), 0xFEEDFACEu);
+}
+
+TEST_F(TlbTest, DevicePagesPassThePhysicalAddress) {
+    write_entry(6, 0x40040000, entry_lo(0x10003000), 0);
+
+    EXPECT_EQ(ReadMemory32(0x40040010), 0xABABABABu);
+
+    ASSERT_EQ(device_reads.size(), 1u);
+    EXPECT_EQ(device_reads[0], 0x10003010u);
+}
+
+TEST_F(TlbTest, ProbeReadAndRandom) {
+    write_entry(7, 0x40060000, entry_lo(0x00500000), 0);
+
+    regs.CP0.n.EntryHi = 0x40061000;         // Odd page of the same pair
+    tlb.probe();
+    EXPECT_EQ(regs.CP0.n.Index, 7u);
+
+    regs.CP0.n.EntryHi = 0x40080000;
+    tlb.probe();
+    EXPECT_EQ(regs.CP0.n.Index, tlb_bits::INDEX_PROBE_FAILED);
+
+    regs.CP0.n.Index = 7;
+    tlb.read();
+    EXPECT_EQ(regs.CP0.n.EntryHi, 0x40060000u);
+    EXPECT_EQ(regs.CP0.n.EntryLo0, entry_lo(0x00500000));
+
+    // TLBWR walks down from 47 and wraps back at Wired.
+    regs.CP0.n.Wired = 46;
+    tlb.write_random();
+    EXPECT_EQ(regs.CP0.n.Random, 46u);
+    tlb.write_random();
+    EXPECT_EQ(regs.CP0.n.Random, Tlb::ENTRY_COUNT - 1);
+}
@@ -0,0 +1,56 @@
+#include "frame_hash.h"
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Compares two frame hash logs (see frame_hash.h) and reports the first frame where the
+// runs that wrote them diverged, and which part of the state differed.
+// Exits with 0 if the logs agree, 1 if they diverge and 2 if one cannot be read.
+
+namespace {
+
+void print_hash(const char* name, u64 a, u64 b) {
+    std::cout << "  " << std::setw(12) << std::left << name << std::hex << std::setfill('0') << std::right
+              << std::setw(16) << a << "  " << std::setw(16) << b << std::dec << std::setfill(' ')
+              << (a != b ? "  differs" : "") << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    if (argc != 3) {
+        std::cerr << "Usage: " << argv[0] << " <a.log> <b.log>" << std::endl;
+        return 2;
+    }
+    std::vector<FrameHash> a, b;
+    for (int i = 1; i <= 2; i++) {
+        if (!frame_hash_read_log(argv[i], i == 1 ? a : b)) {
+            std::cerr << "Error: " << argv[i] << " is not a readable frame hash log" << std::endl;
+            return 2;
+        }
+    }
+
+    const s64 index = frame_hash_first_divergence(a, b);
+    if (index < 0) {
+        std::cout << "Logs agree for " << std::min(a.size(), b.size()) << " frames";
+        if (a.size() != b.size()) {
+            std::cout << "; " << argv[a.size() > b.size() ? 1 : 2] << " goes on for "
+                      << (a.size() > b.size() ? a.size() - b.size() : b.size() - a.size()) << " more";
+        }
+        std::cout << std::endl;
+        return 0;
+    }
+
+    const FrameHash& x = a[(size_t)index];
+    const FrameHash& y = b[(size_t)index];
+    std::cout << "First divergence at record " << index << " (frame " << x.frame;
+    if (x.frame != y.frame) {
+        std::cout << " vs " << y.frame;
+    }
+    std::cout << ")" << std::endl;
+    print_hash("registers", x.registers, y.registers);
+    print_hash("ram", x.ram, y.ram);
+    print_hash("scratchpad", x.scratchpad, y.scratchpad);
+    return 1;
+}
@@ -0,0 +1,89 @@
+#include "wav_file.h"
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr u32 HEADER_SIZE = 44;
+constexpr u32 CHANNELS = 2;
+constexpr u32 BYTES_PER_FRAME = CHANNELS * 2;
+
+void put16(u8* out, u32 value) {
+    out[0] = (u8)value;
+    out[1] = (u8)(value >> 8);
+}
+
+void put32(u8* out, u32 value) {
+    put16(out, value);
+    put16(out + 2, value >> 16);
+}
+
+// RIFF header of a PCM file holding `data_bytes` of samples.
+void make_header(u8 header[HEADER_SIZE], u32 sample_rate, u32 data_bytes) {
+    std::memcpy(header, "RIFF", 4);
+    put32(header + 4, HEADER_SIZE - 8 + data_bytes);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    put32(header + 16, 16);                         // fmt chunk size
+    put16(header + 20, 1);                          // PCM
+    put16(header + 22, CHANNELS);
+    put32(header + 24, sample_rate);
+    put32(header + 28, sample_rate * BYTES_PER_FRAME);
+    put16(header + 32, BYTES_PER_FRAME);
+    put16(header + 34, 16);                         // Bits per sample
+    std::memcpy(header + 36, "data", 4);
+    put32(header + 40, data_bytes);
+}
+
+} // namespace
+
+WavFile::WavFile() : fd(-1), sample_rate(0), data_bytes(0) {}
+
+WavFile::~WavFile() {
+    close();
+}
+
+bool WavFile::open(const std::string& path, u32 rate) {
+    close();
+    sample_rate = rate;
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    u8 header[HEADER_SIZE];
+    make_header(header, sample_rate, 0);
+    if (::write(fd, header, HEADER_SIZE) != (ssize_t)HEADER_SIZE) {
+        close();
+        return false;
+    }
+    data_bytes = 0;
+    return true;
+}
+
+bool WavFile::close() {
+    if (fd < 0) {
+        return true;
+    }
+    u8 header[HEADER_SIZE];
+    make_header(header, sample_rate, data_bytes);
+    const bool ok = pwrite(fd, header, HEADER_SIZE, 0) == (ssize_t)HEADER_SIZE;
+    ::close(fd);
+    fd = -1;
+    return ok;
+}
+
+void WavFile::write(const s16* frames, u32 count) {
+    if (fd < 0) {
+        return;
+    }
+    const u32 size = count * BYTES_PER_FRAME;
+    if (::write(fd, frames, size) != (ssize_t)size) {
+        close();
+        return;
+    }
+    data_bytes += size;
+}
+
+void WavFile::sink(void* user, const s16* frames, u32 count) {
+    static_cast<WavFile*>(user)->write(frames, count);
+}
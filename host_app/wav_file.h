@@ -0,0 +1,37 @@
+#pragma once
+
+#include "cpu_state.h"
+#include <string>
+
+// A 16-bit stereo PCM .wav being written, usable as the SPU2's audio sink (see spu2.h)
+// on machines without a sound device. The header's sizes are filled in on close().
+
+class WavFile {
+public:
+    WavFile();
+    ~WavFile();
+
+    WavFile(const WavFile&) = delete;
+    WavFile& operator=(const WavFile&) = delete;
+
+    /**
+     * @brief Creates (or truncates) `path` and writes a header for `sample_rate` Hz.
+     * @return false if the file cannot be created.
+     */
+    bool open(const std::string& path, u32 sample_rate);
+    // False if the header could not be finished.
+    bool close();
+
+    bool is_open() const { return fd >= 0; }
+
+    // Appends `count` interleaved stereo frames. Write errors close the file.
+    void write(const s16* frames, u32 count);
+
+    // AudioSink for Spu2::start(), with the WavFile as `user`.
+    static void sink(void* user, const s16* frames, u32 count);
+
+private:
+    int fd;
+    u32 sample_rate;
+    u32 data_bytes;
+};
@@ -0,0 +1,177 @@
+#include "cycle_table.h"
+#include "recompiler.h"
+#include <cmath>
+
+double cycle_scale = 1.0;
+
+/*
+R5900 timings, rounded to whole EE cycles. These are latencies rather than issue rates:
+the EE stalls on a dependent instruction, and game code almost always uses a result
+right after producing it, so the latency is the better estimate of what a block costs.
+Anything not listed is a single-cycle integer op.
+*/
+namespace cycles {
+    constexpr u32 DEFAULT = 1;
+    constexpr u32 LOAD = 2;         // 1 cycle + load delay
+    constexpr u32 STORE = 1;
+    constexpr u32 MULT = 4;         // MULT/MULTU/MADD/MADDU to HI/LO
+    constexpr u32 DIV = 37;         // DIV/DIVU to HI/LO
+    constexpr u32 FPU_ARITH = 4;    // ADD.S/SUB.S/MUL.S/MADD.S/MSUB.S/CVT
+    constexpr u32 FPU_DIV = 8;      // DIV.S
+    constexpr u32 FPU_SQRT = 8;     // SQRT.S
+    constexpr u32 FPU_RSQRT = 14;   // RSQRT.S
+    constexpr u32 COP_MOVE = 1;     // MFC1/MTC1/CFC1/CTC1, QMFC2/QMTC2/CFC2/CTC2
+    constexpr u32 COP2_MACRO = 4;   // VU0 macro mode arithmetic
+    constexpr u32 BRANCH = 2;       // 1 cycle + taken-branch bubble
+    constexpr u32 EXCEPTION = 4;    // SYSCALL/BREAK/ERET pipeline flush
+    constexpr u32 COP0_SYSTEM = 4;  // TLB ops, CACHE
+}
+
+// add.s/sub.s/mul.s/div.s share their capstone id with the integer instructions, so
+// tell them apart by the destination register file.
+static bool is_fpu_operation(const cs_insn& insn) {
+    const cs_mips& mips = insn.detail->mips;
+    return mips.op_count > 0 &&
+           mips.operands[0].type == MIPS_OP_REG &&
+           mips.operands[0].reg >= MIPS_REG_F0 &&
+           mips.operands[0].reg <= MIPS_REG_F31;
+}
+
+// Capstone has no names for the VU0 macro instructions, so they are recognised by their
+// encoding: the COP2 major opcode with the CO bit set. The COP2 moves and branches leave
+// it clear and have ids of their own.
+static bool is_cop2_macro(const cs_insn& insn) {
+    const u32 word = (u32)insn.bytes[0] | ((u32)insn.bytes[1] << 8) | ((u32)insn.bytes[2] << 16) |
+                     ((u32)insn.bytes[3] << 24);
+    return (word >> 26) == 0x12 && (word & (1u << 25)) != 0;
+}
+
+u32 instruction_cycles(const cs_insn& insn) {
+    if (is_cop2_macro(insn)) {
+        return cycles::COP2_MACRO;
+    }
+    switch (insn.id) {
+        // --- Loads ---
+        case MIPS_INS_LB:
+        case MIPS_INS_LBU:
+        case MIPS_INS_LH:
+        case MIPS_INS_LHU:
+        case MIPS_INS_LW:
+        case MIPS_INS_LWU:
+        case MIPS_INS_LWL:
+        case MIPS_INS_LWR:
+        case MIPS_INS_LD:
+        case MIPS_INS_LDL:
+        case MIPS_INS_LDR:
+        case MIPS_INS_LWC1:
+        case MIPS_INS_LDC2:     // LQC2
+            return cycles::LOAD;
+
+        // --- Stores ---
+        case MIPS_INS_SB:
+        case MIPS_INS_SH:
+        case MIPS_INS_SW:
+        case MIPS_INS_SWL:
+        case MIPS_INS_SWR:
+        case MIPS_INS_SD:
+        case MIPS_INS_SDL:
+        case MIPS_INS_SDR:
+        case MIPS_INS_SWC1:
+        case MIPS_INS_SDC2:     // SQC2
+            return cycles::STORE;
+
+        // --- HI/LO unit ---
+        case MIPS_INS_MULT:
+        case MIPS_INS_MULTU:
+        case MIPS_INS_MADDU:
+            return cycles::MULT;
+        case MIPS_INS_DIVU:
+            return cycles::DIV;
+
+        // --- Shared between the integer unit and the FPU ---
+        case MIPS_INS_ADD:
+        case MIPS_INS_SUB:
+            return is_fpu_operation(insn) ? cycles::FPU_ARITH : cycles::DEFAULT;
+        case MIPS_INS_MUL:
+        case MIPS_INS_MADD:
+        case MIPS_INS_MSUB:
+            return is_fpu_operation(insn) ? cycles::FPU_ARITH : cycles::MULT;
+        case MIPS_INS_DIV:
+            return is_fpu_operation(insn) ? cycles::FPU_DIV : cycles::DIV;
+
+        // --- FPU only ---
+        case MIPS_INS_SQRT:
+            return cycles::FPU_SQRT;
+        case MIPS_INS_FRSQRT:
+            return cycles::FPU_RSQRT;
+        case MIPS_INS_CVT:
+        case MIPS_INS_TRUNC:
+            return cycles::FPU_ARITH;
+
+        // --- Coprocessor moves ---
+        case MIPS_INS_MFC1:
+        case MIPS_INS_MTC1:
+        case MIPS_INS_CFC1:
+        case MIPS_INS_CTC1:
+        case MIPS_INS_MFC2:
+        case MIPS_INS_MTC2:
+        case MIPS_INS_DMFC2:    // QMFC2
+        case MIPS_INS_DMTC2:    // QMTC2
+            return cycles::COP_MOVE;
+
+        // --- Branches and jumps ---
+        case MIPS_INS_BEQ:
+        case MIPS_INS_BNE:
+        case MIPS_INS_BGTZ:
+        case MIPS_INS_BLEZ:
+        case MIPS_INS_BLTZ:
+        case MIPS_INS_BGEZ:
+        case MIPS_INS_BLTZAL:
+        case MIPS_INS_BGEZAL:
+        case MIPS_INS_BEQL:
+        case MIPS_INS_BNEL:
+        case MIPS_INS_BGTZL:
+        case MIPS_INS_BLEZL:
+        case MIPS_INS_BLTZL:
+        case MIPS_INS_BGEZL:
+        case MIPS_INS_BLTZALL:
+        case MIPS_INS_BGEZALL:
+        case MIPS_INS_BC1F:
+        case MIPS_INS_BC1T:
+        case MIPS_INS_BC1FL:
+        case MIPS_INS_BC1TL:
+        case MIPS_INS_BC2F:
+        case MIPS_INS_BC2T:
+        case MIPS_INS_J:
+        case MIPS_INS_JAL:
+        case MIPS_INS_JR:
+        case MIPS_INS_JALR:
+        case MIPS_INS_B:
+        case MIPS_INS_BAL:
+            return cycles::BRANCH;
+
+        // --- System ---
+        case MIPS_INS_SYSCALL:
+        case MIPS_INS_BREAK:
+        case MIPS_INS_ERET:
+            return cycles::EXCEPTION;
+        case MIPS_INS_TLBP:
+        case MIPS_INS_TLBR:
+        case MIPS_INS_TLBWI:
+        case MIPS_INS_TLBWR:
+        case MIPS_INS_CACHE:
+            return cycles::COP0_SYSTEM;
+
+        default:
+            return cycles::DEFAULT;
+    }
+}
+
+u32 block_cycle_cost(const basic_block& block) {
+    u32 total = 0;
+    for (const cs_insn* insn : block.instructions) {
+        total += instruction_cycles(*insn);
+    }
+    const double scaled = std::round(total * cycle_scale);
+    return scaled < 1.0 ? 1 : (u32)scaled;
+}
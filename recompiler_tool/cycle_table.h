@@ -0,0 +1,19 @@
+#ifndef CYCLE_TABLE_H
+#define CYCLE_TABLE_H
+
+#include <capstone/capstone.h>
+#include "cpu_state.h"
+
+struct basic_block;
+
+// Multiplier applied to every block's cycle cost, for over/underclocking the EE.
+// Folded into the constants at recompile time, so it costs nothing at runtime.
+extern double cycle_scale;
+
+// Static R5900 cost of a single instruction, in EE cycles.
+u32 instruction_cycles(const cs_insn& insn);
+
+// Total cost of a basic block (scaled by cycle_scale, at least 1).
+u32 block_cycle_cost(const basic_block& block);
+
+#endif // CYCLE_TABLE_H
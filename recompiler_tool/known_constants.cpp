@@ -0,0 +1,124 @@
+#include "known_constants.h"
+#include "recompiler.h"
+
+// Capstone GPR operand -> 0-31, or -1 for anything else (FPU, COP0, immediates...).
+static int gpr_operand(const cs_mips_op& op) {
+    if (op.type != MIPS_OP_REG || op.reg < MIPS_REG_0 || op.reg > MIPS_REG_31) {
+        return -1;
+    }
+    return op.reg - MIPS_REG_0;
+}
+
+void KnownConstants::reset() {
+    known = 1;          // $zero
+    value[0] = 0;
+}
+
+bool KnownConstants::get(int gpr, u32& out) const {
+    if (gpr < 0 || !(known & (1u << gpr))) {
+        return false;
+    }
+    out = value[gpr];
+    return true;
+}
+
+void KnownConstants::set(int gpr, u32 v) {
+    if (gpr > 0) {
+        value[gpr] = v;
+        known |= 1u << gpr;
+    }
+}
+
+void KnownConstants::forget(int gpr) {
+    if (gpr > 0) {
+        known &= ~(1u << gpr);
+    }
+}
+
+void KnownConstants::update(const cs_insn& insn) {
+    if (!insn.detail) {
+        reset();
+        return;
+    }
+    const cs_mips& mips = insn.detail->mips;
+    const int dest = mips.op_count > 0 ? gpr_operand(mips.operands[0]) : -1;
+    u32 a = 0, b = 0;
+
+    switch (insn.id) {
+        case MIPS_INS_LUI:
+            set(dest, (u32)mips.operands[1].imm << 16);
+            return;
+        case MIPS_INS_ADDIU:
+        case MIPS_INS_DADDIU:
+            if (get(gpr_operand(mips.operands[1]), a)) {
+                set(dest, a + (u32)(s32)(s16)mips.operands[2].imm);
+            } else {
+                forget(dest);
+            }
+            return;
+        case MIPS_INS_ORI:
+            if (get(gpr_operand(mips.operands[1]), a)) {
+                set(dest, a | (u32)(u16)mips.operands[2].imm);
+            } else {
+                forget(dest);
+            }
+            return;
+        case MIPS_INS_MOVE:
+            if (get(gpr_operand(mips.operands[1]), a)) {
+                set(dest, a);
+            } else {
+                forget(dest);
+            }
+            return;
+        case MIPS_INS_ADDU:
+        case MIPS_INS_DADDU:
+        case MIPS_INS_OR:
+            if (get(gpr_operand(mips.operands[1]), a) && get(gpr_operand(mips.operands[2]), b)) {
+                set(dest, insn.id == MIPS_INS_OR ? a | b : a + b);
+            } else {
+                forget(dest);
+            }
+            return;
+        default:
+            break;
+    }
+
+    // Calls clobber registers (a syscall at least $v0), and code after a branch is only
+    // reached one way, so be conservative and start over.
+    if (is_control_flow_instruction(insn) || insn.id == MIPS_INS_SYSCALL) {
+        reset();
+        return;
+    }
+
+    // Anything else: the first operand is the destination for everything that writes
+    // a GPR (for stores and MULT/DIV this only loses precision).
+    forget(dest);
+    for (u8 i = 0; i < insn.detail->regs_write_count; i++) {
+        cs_mips_op implicit = {};
+        implicit.type = MIPS_OP_REG;
+        implicit.reg = (mips_reg)insn.detail->regs_write[i];
+        forget(gpr_operand(implicit));
+    }
+}
+
+bool known_address(const KnownConstants& constants, int base_index, s64 offset, u32& address) {
+    u32 base;
+    if (!constants.get(base_index, base)) {
+        return false;
+    }
+    address = base + (u32)offset;
+    return true;
+}
+
+bool scratchpad_offset(const KnownConstants& constants, int base_index, s64 offset, u32 size, u32& spr_offset) {
+    u32 address;
+    if (!known_address(constants, base_index, offset, address)) {
+        return false;
+    }
+    const u32 relative = address - SCRATCHPAD_START;
+    if (relative > SCRATCHPAD_SIZE - size) {
+        return false;
+    }
+    spr_offset = relative;
+    return true;
+}
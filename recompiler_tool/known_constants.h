@@ -0,0 +1,45 @@
+#ifndef KNOWN_CONSTANTS_H
+#define KNOWN_CONSTANTS_H
+
+#include <capstone/capstone.h>
+#include "cpu_state.h"
+
+// The scratchpad as the kernel maps it. Recompiled code treats it as fixed, like
+// every PS2 title does.
+constexpr u32 SCRATCHPAD_START = 0x70000000;
+constexpr u32 SCRATCHPAD_SIZE = 16 * 1024;
+
+// Lower 32 bits of the GPRs whose value is known at recompile time, followed through
+// one basic block (lui/ori/addiu chains and moves). Used to classify memory accesses.
+struct KnownConstants {
+    u32 value[32];
+    u32 known;          // Bit n set: value[n] is valid
+
+    KnownConstants() { reset(); }
+
+    // Forget everything (block entry, or after leaving the straight-line path).
+    void reset();
+
+    bool get(int gpr, u32& out) const;
+
+    // Steps over `insn`, which must already have been translated.
+    void update(const cs_insn& insn);
+
+private:
+    void set(int gpr, u32 v);
+    void forget(int gpr);
+};
+
+/**
+ * @brief The address of a base+offset access, if the base register is known.
+ */
+bool known_address(const KnownConstants& constants, int base_index, s64 offset, u32& address);
+
+/**
+ * @brief Works out whether a base+offset access of `size` bytes is provably inside the
+ * scratchpad.
+ * @param spr_offset Receives the offset into the scratchpad.
+ */
+bool scratchpad_offset(const KnownConstants& constants, int base_index, s64 offset, u32 size, u32& spr_offset);
+
+#endif // KNOWN_CONSTANTS_H
@@ -1,14 +1,23 @@
 #include "recompiler.h"
+#include "cycle_table.h"
 #include <iostream>
 #include <vector>
 #include <fstream>
+#include <cstdlib>
 
 int main(int argc, char* argv[]) {
     // --- File loading  ---
-    if (argc != 2) { 
-        std::cerr << "Usage: " << argv[0] << " <path_to_game_binary>" << std::endl;
+    if (argc != 2 && !(argc == 4 && std::string(argv[2]) == "--cycle-scale")) { 
+        std::cerr << "Usage: " << argv[0] << " <path_to_game_binary> [--cycle-scale <factor>]" << std::endl;
         return 1; 
     }
+    if (argc == 4) {
+        cycle_scale = std::atof(argv[3]);
+        if (cycle_scale <= 0.0) {
+            std::cerr << "Error: --cycle-scale must be a positive number" << std::endl;
+            return 1;
+        }
+    }
     const std::string file_path = argv[1];
     std::ifstream game_file(file_path, std::ios::binary);
     if (!game_file) {
@@ -52,12 +61,20 @@ int main(int argc, char* argv[]) {
          // Write file headers
          outFile << "// Code generated by CrashRecomp\n";
          outFile << "#include \"../../host_app/cpu_state.h\"\n";
-         outFile << "#include \"../../host_app/memory.h\"\n\n";
-         outFile << "extern CPUState context;\n\n";
+         outFile << "#include \"../../host_app/memory.h\"\n";
+         outFile << "#include \"../../host_app/runtime.h\"\n\n";
 
          // Generate the code
          generate_functions_from_block(blocks, outFile);
 
+         // Table for jumps and calls whose target is only known at runtime
+         outFile << "void register_recompiled_functions() {\n";
+         for (const auto& block : blocks) {
+             outFile << "    register_function(0x" << std::hex << block.start_address << ", &func_" << block.start_address
+                     << ", " << std::dec << block_code_size(block) << ", 0x" << std::hex << block_code_hash(block) << ");\n";
+         }
+         outFile << "}\n";
+
          outFile.close();
          std::cout << "Successfully generated recompiled_code.cpp" << std::endl;
 
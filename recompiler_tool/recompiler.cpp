@@ -2,6 +2,63 @@
 #include <iomanip>
 #include <algorithm>
 #include "recompiler.h"
+#include "cycle_table.h"
+#include "known_constants.h"
+#include "mmio_map.h"
+#include "smc.h"
+#include "syscalls.h"
+#include <sstream>
+
+// GPR values known at the instruction being translated. generate_functions_from_block()
+// resets it at each block start and steps it after every instruction.
+static KnownConstants block_constants;
+
+/*
+Accessor calls for a base+offset load/store. Accesses that provably hit the scratchpad
+(e.g. a lui 0x7000 base) index its buffer directly, and word accesses to a constant
+device register call that register's handler (see mmio_map.h) instead of faulting into
+the MMIO lookup. Everything else goes through ReadMemory/WriteMemory with the `address`
+the caller emitted.
+*/
+static const char* const access_types[] = { "", "u8", "u16", "", "u32", "", "", "", "u64" };
+
+static const MmioRoute* constant_mmio_route(u32 size, int base_index, s64 offset, std::string& address) {
+    u32 value;
+    if (size != 4 || !known_address(block_constants, base_index, offset, value)) {
+        return nullptr;
+    }
+    const MmioRoute* route = find_mmio_route(value);
+    if (route) {
+        std::ostringstream literal;
+        literal << "0x" << std::hex << (value & 0x1FFFFFFF);
+        address = literal.str();
+    }
+    return route;
+}
+
+static std::string read_call(u32 size, int base_index, s64 offset) {
+    u32 spr_offset;
+    std::string address;
+    if (scratchpad_offset(block_constants, base_index, offset, size, spr_offset)) {
+        return std::string("ReadScratchpad<") + access_types[size] + ">(" + std::to_string(spr_offset) + ")";
+    }
+    if (const MmioRoute* route = constant_mmio_route(size, base_index, offset, address)) {
+        return std::string("mmio_") + route->name + "_read32(*ctx, " + address + ")";
+    }
+    return "ReadMemory" + std::to_string(size * 8) + "(address)";
+}
+
+static std::string write_call(u32 size, int base_index, s64 offset, const std::string& value) {
+    u32 spr_offset;
+    std::string address;
+    if (scratchpad_offset(block_constants, base_index, offset, size, spr_offset)) {
+        return std::string("WriteScratchpad<") + access_types[size] + ">(" + std::to_string(spr_offset) + ", " + value + ")";
+    }
+    if (const MmioRoute* route = constant_mmio_route(size, base_index, offset, address)) {
+        return std::string("mmio_") + route->name + "_write32(*ctx, " + address + ", " + value + ")";
+    }
+    return "WriteMemory" + std::to_string(size * 8) + "(address, " + value + ")";
+}
 // Helper function to map Capstone's register enum to the correct 0-31 GPR index.
 // This function should be placed in main.cpp, typically above the main() function.
 int get_gpr_index(mips_reg capstone_reg) {
@@ -63,7 +120,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             const auto& target_reg_capstone = mips_details.operands[0].reg;
             int target_reg_index = get_gpr_index(target_reg_capstone);
 
-            out_file << "    host_dispatch_jump(context.cpuRegs.GPR.r[" << target_reg_index << "].UD[0]);" << std::endl;
+            out_file << "    host_dispatch_jump(ctx, ctx->cpuRegs.GPR.r[" << target_reg_index << "].UD[0]);" << std::endl;
             out_file << "    return;" << std::endl;
             break;
         }
@@ -79,8 +136,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             u32 target = calculate_target(*insn);
 
-            out_file << "    if (context.cpuRegs.GPR.r[" << rs_index << "].UD[0] == context.cpuRegs.GPR.r[" << rt_index << "].UD[0]) {" << std::endl;
-            out_file << "        func_" << std::hex << target << "();" << std::endl;
+            out_file << "    if (ctx->cpuRegs.GPR.r[" << rs_index << "].UD[0] == ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0]) {" << std::endl;
+            out_file << "        func_" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -97,8 +154,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             u32 target = calculate_target(*insn);
 
-            out_file << "    if (context.cpuRegs.GPR.r[" << rs_index << "].UD[0] != context.cpuRegs.GPR.r[" << rt_index << "].UD[0]) {" << std::endl;
-            out_file << "        func_" << std::hex << target << "();" << std::endl;
+            out_file << "    if (ctx->cpuRegs.GPR.r[" << rs_index << "].UD[0] != ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0]) {" << std::endl;
+            out_file << "        func_" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -115,7 +172,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int dest_index = get_gpr_index(dest_capstone);
             int source_index = get_gpr_index(source_capstone);
 
-            out_file << "context.cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)(s32)(context.cpuRegs.GPR.r[" << source_index << "].SD[0] + (s16)" << imm << ");" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)(s32)(ctx->cpuRegs.GPR.r[" << source_index << "].SD[0] + (s16)" << imm << ");" << std::endl;
             break;
         }
         case MIPS_INS_LW: {
@@ -128,8 +185,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
 
             out_file << "{" << std::endl;
-            out_file << "    u32 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
-            out_file << "    context.cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)(s32)ReadMemory32(address);" << std::endl;
+            out_file << "    u32 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)(s32)" << read_call(4, base_index, offset) << ";" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -143,8 +200,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
 
             out_file << "{" << std::endl;
-            out_file << "    u32 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
-            out_file << "    WriteMemory32(address, (u32)context.cpuRegs.GPR.r[" << source_index << "].UD[0]);" << std::endl;
+            out_file << "    u32 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    " << write_call(4, base_index, offset, "(u32)ctx->cpuRegs.GPR.r[" + std::to_string(source_index) + "].UD[0]") << ";" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -159,7 +216,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int r1_index = get_gpr_index(r1_capstone);
             int r2_index = get_gpr_index(r2_capstone);
 
-            out_file << "context.cpuRegs.GPR.r[" << dest_index << "].UD[0] = context.cpuRegs.GPR.r[" << r1_index << "].UD[0] | context.cpuRegs.GPR.r[" << r2_index << "].UD[0];" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << dest_index << "].UD[0] = ctx->cpuRegs.GPR.r[" << r1_index << "].UD[0] | ctx->cpuRegs.GPR.r[" << r2_index << "].UD[0];" << std::endl;
             break;
         }
         case MIPS_INS_LUI: {
@@ -169,7 +226,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             const auto& imm = mips_details.operands[1].imm;
             int rt_index = get_gpr_index(rt_capstone);
 
-            out_file << "context.cpuRegs.GPR.r[" << rt_index << "].SD[0] = (s64)(s32)(" << imm << " << 16);" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << rt_index << "].SD[0] = (s64)(s32)(" << imm << " << 16);" << std::endl;
             break;
         }
         case MIPS_INS_SLL: {
@@ -182,7 +239,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rd_index = get_gpr_index(rd_capstone);
             int rt_index = get_gpr_index(rt_capstone);
 
-            out_file << "context.cpuRegs.GPR.r[" << rd_index << "].SD[0] = (s64)(s32)((u32)context.cpuRegs.GPR.r[" << rt_index << "].UD[0] << " << sa << ");" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << rd_index << "].SD[0] = (s64)(s32)((u32)ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0] << " << sa << ");" << std::endl;
             break;
         }
         case MIPS_INS_NOP: {
@@ -200,7 +257,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int dest_index = get_gpr_index(dest_reg);
             int source_index = get_gpr_index(source_reg);
 
-            out_file << "context.cpuRegs.GPR.r[" << dest_index << "].UD[0] = context.cpuRegs.GPR.r["<< source_index << "].UD[0] | (u32)("<< imm << ");"<< std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << dest_index << "].UD[0] = ctx->cpuRegs.GPR.r["<< source_index << "].UD[0] | (u32)("<< imm << ");"<< std::endl;
             break;
         }
         case MIPS_INS_ADDU: {
@@ -215,7 +272,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int reg1_index = get_gpr_index(reg1);
             int reg2_index = get_gpr_index(reg2);
 
-            out_file << "context.cpuRegs.GPR.r[" << dest_index << "].UD[0] = (u64)(u32)(context.cpuRegs.GPR.r[" << reg1_index << "].UD[0] + context.cpuRegs.GPR.r["<< reg2_index << "].UD[0]);"<< std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << dest_index << "].UD[0] = (u64)(u32)(ctx->cpuRegs.GPR.r[" << reg1_index << "].UD[0] + ctx->cpuRegs.GPR.r["<< reg2_index << "].UD[0]);"<< std::endl;
             break;
 
         }
@@ -231,7 +288,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int reg1_index = get_gpr_index(reg1);
             int reg2_index = get_gpr_index(reg2);
 
-            out_file << "context.cpuRegs.GPR.r[" << dest_index << "].UD[0] = (u64)(u32)(context.cpuRegs.GPR.r[" << reg1_index << "].UD[0] - context.cpuRegs.GPR.r["<< reg2_index << "].UD[0]);"<< std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << dest_index << "].UD[0] = (u64)(u32)(ctx->cpuRegs.GPR.r[" << reg1_index << "].UD[0] - ctx->cpuRegs.GPR.r["<< reg2_index << "].UD[0]);"<< std::endl;
             break;
 
         }
@@ -247,7 +304,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int reg1_index = get_gpr_index(reg1);
             int reg2_index = get_gpr_index(reg2);
 
-            out_file << "context.cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)((s32)context.cpuRegs.GPR.r[" << reg1_index << "].SD[0] < (s32)context.cpuRegs.GPR.r["<< reg2_index << "].SD[0] ? 1 : 0);"<< std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)((s32)ctx->cpuRegs.GPR.r[" << reg1_index << "].SD[0] < (s32)ctx->cpuRegs.GPR.r["<< reg2_index << "].SD[0] ? 1 : 0);"<< std::endl;
             break;
         }
         case MIPS_INS_SLTI: {
@@ -261,7 +318,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int dest_index = get_gpr_index(dest_reg);
             int source_index = get_gpr_index(source_reg);
 
-            out_file << "context.cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)((s32)context.cpuRegs.GPR.r[" << source_index << "].SD[0] < (s32)" << imm << " ? 1 : 0);"<< std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)((s32)ctx->cpuRegs.GPR.r[" << source_index << "].SD[0] < (s32)" << imm << " ? 1 : 0);"<< std::endl;
             break;
         }
         case MIPS_INS_MULT : {
@@ -275,20 +332,20 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
             {
-                s32 op1 = context.cpuRegs.GPR.r[dest_index].SD[0];
-                s32 op2 = context.cpuRegs.GPR.r[source_index].SD[0];
+                s32 op1 = ctx->cpuRegs.GPR.r[dest_index].SD[0];
+                s32 op2 = ctx->cpuRegs.GPR.r[source_index].SD[0];
                 s64 product = op1 * op2;
-                context.cpuRegs.GPR.r[dest_index].LO.SD[0] = (s64)(s32)product;
-                context.cpuRegs.GPR.r[dest_index].HI.SD[0] = (s64)(s32)(product >> 32);
+                ctx->cpuRegs.GPR.r[dest_index].LO.SD[0] = (s64)(s32)product;
+                ctx->cpuRegs.GPR.r[dest_index].HI.SD[0] = (s64)(s32)(product >> 32);
             
             }
             */
            out_file << "{" << std::endl;
-           out_file << "   s32 op1 = context.cpuRegs.GPR.r[ " << dest_index << "].SD[0];" << std::endl;
-           out_file << "   s32 op2 = context.cpuRegs.GPR.r[ " << source_index <<" ].SD[0];" << std::endl;
+           out_file << "   s32 op1 = ctx->cpuRegs.GPR.r[ " << dest_index << "].SD[0];" << std::endl;
+           out_file << "   s32 op2 = ctx->cpuRegs.GPR.r[ " << source_index <<" ].SD[0];" << std::endl;
            out_file << "   s64 product = op1 * op2;" << std::endl;
-           out_file << "   context.cpuRegs.LO.SD[0] = (s64)(s32)product;" << std::endl;
-           out_file << "   context.cpuRegs.HI.SD[0] = (s64)(s32)(product >> 32);" << std::endl;
+           out_file << "   ctx->cpuRegs.LO.SD[0] = (s64)(s32)product;" << std::endl;
+           out_file << "   ctx->cpuRegs.HI.SD[0] = (s64)(s32)(product >> 32);" << std::endl;
            out_file << "}" << std::endl;
            break;
         }
@@ -303,26 +360,26 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
             {
-                s32 num = context.cpuRegs.GPR.r[dest_index].SD[0];
-                s32 den = context.cpuRegs.GPR.r[source_index].SD[0];
+                s32 num = ctx->cpuRegs.GPR.r[dest_index].SD[0];
+                s32 den = ctx->cpuRegs.GPR.r[source_index].SD[0];
 
                 if (den != 0){
                     s32 HI_ans = num % den;
                     s32 LO_ans = num / den;
-                    context.cpuRegs.LO.SD[0] = (s64)(s32)LO_ans;
-                    context.cpuRegs.HI.SD[0] = (s64)(s32)(HI_ans);
+                    ctx->cpuRegs.LO.SD[0] = (s64)(s32)LO_ans;
+                    ctx->cpuRegs.HI.SD[0] = (s64)(s32)(HI_ans);
                 }
             
             }
             */
            out_file << "{" << std::endl;
-           out_file << "   s32 num = (s32)context.cpuRegs.GPR.r[ " << dest_index << "].SD[0];" << std::endl;
-           out_file << "   s32 den = (s32)context.cpuRegs.GPR.r[ " << source_index <<" ].SD[0];" << std::endl;
+           out_file << "   s32 num = (s32)ctx->cpuRegs.GPR.r[ " << dest_index << "].SD[0];" << std::endl;
+           out_file << "   s32 den = (s32)ctx->cpuRegs.GPR.r[ " << source_index <<" ].SD[0];" << std::endl;
            out_file << "   if (den != 0){" << std::endl;
            out_file << "       s32 HI_ans = num " << "%" << " den;"  <<std::endl;
            out_file << "       s32 LO_ans = num / den;" << std::endl;
-           out_file << "       context.cpuRegs.LO.SD[0] = (s64)(s32)LO_ans;" << std::endl;
-           out_file << "       context.cpuRegs.HI.SD[0] = (s64)(s32)(HI_ans);" << std::endl;
+           out_file << "       ctx->cpuRegs.LO.SD[0] = (s64)(s32)LO_ans;" << std::endl;
+           out_file << "       ctx->cpuRegs.HI.SD[0] = (s64)(s32)(HI_ans);" << std::endl;
            out_file << "   }" << std::endl;
            out_file << "}" << std::endl;
            break;
@@ -341,16 +398,16 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
             {
-                u64 rs = context.cpuRegs.GPR.r[rs_index].UD[0];
-                u64 rt = context.cpuRegs.GPR.r[rt_index].UD[0];
-                context.cpuRegs.GPT.r[rd_index].UD[0] = rs ^ rt;
+                u64 rs = ctx->cpuRegs.GPR.r[rs_index].UD[0];
+                u64 rt = ctx->cpuRegs.GPR.r[rt_index].UD[0];
+                ctx->cpuRegs.GPT.r[rd_index].UD[0] = rs ^ rt;
             
             }
             */
            out_file << "{" << std::endl;
-           out_file << "   u64 rs_val = context.cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
-           out_file << "   u64 rt_val = context.cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
-           out_file << "   context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = rs_val ^ rt_val;" << std::endl;
+           out_file << "   u64 rs_val = ctx->cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
+           out_file << "   u64 rt_val = ctx->cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
+           out_file << "   ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = rs_val ^ rt_val;" << std::endl;
            out_file << "}" << std::endl;
            break;
         }
@@ -368,16 +425,16 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
             {
-                u64 rs = context.cpuRegs.GPR.r[rs_index].UD[0];
-                u64 rt = context.cpuRegs.GPR.r[rt_index].UD[0];
-                context.cpuRegs.GPT.r[rd_index].UD[0] = ~(rs | rt);
+                u64 rs = ctx->cpuRegs.GPR.r[rs_index].UD[0];
+                u64 rt = ctx->cpuRegs.GPR.r[rt_index].UD[0];
+                ctx->cpuRegs.GPT.r[rd_index].UD[0] = ~(rs | rt);
             
             }
             */
            out_file << "{" << std::endl;
-           out_file << "   u64 rs_val = context.cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
-           out_file << "   u64 rt_val = context.cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
-           out_file << "   context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = ~(rs_val | rt_val);" << std::endl;
+           out_file << "   u64 rs_val = ctx->cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
+           out_file << "   u64 rt_val = ctx->cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
+           out_file << "   ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = ~(rs_val | rt_val);" << std::endl;
            out_file << "}" << std::endl;
            break;
         }
@@ -395,14 +452,14 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             /*
             {
 
-                u64 rt_val = context.cpuRegs.GPR.r[rt_index].UD[0];
-                context.cpuRegs.GPT.r[rd_index].UD[0] = u64(rt_val >> imm);
+                u64 rt_val = ctx->cpuRegs.GPR.r[rt_index].UD[0];
+                ctx->cpuRegs.GPT.r[rd_index].UD[0] = u64(rt_val >> imm);
             
             }
             */
            out_file << "{" << std::endl;
-           out_file << "   u64 rt_val = context.cpuRegs.GPR.r[" << rt_index << "].UD[0];" << std::endl;
-           out_file << "   context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = (u64)((u32)rt_val >>" << imm << ");" << std::endl;
+           out_file << "   u64 rt_val = ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0];" << std::endl;
+           out_file << "   ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = (u64)((u32)rt_val >>" << imm << ");" << std::endl;
            out_file << "}" << std::endl;
            break;
         }
@@ -420,14 +477,14 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             /*
             {
 
-                u64 rt_val = context.cpuRegs.GPR.r[rt_index].UD[0];
-                context.cpuRegs.GPT.r[rd_index].SD[0] = (s64)(s32)((u32)(rt_val) >> imm);
+                u64 rt_val = ctx->cpuRegs.GPR.r[rt_index].UD[0];
+                ctx->cpuRegs.GPT.r[rd_index].SD[0] = (s64)(s32)((u32)(rt_val) >> imm);
             
             }
             */
            out_file << "{" << std::endl;
-           out_file << "   s64 rt_val = context.cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
-           out_file << "   context.cpuRegs.GPR.r[" << rd_index << "].SD[0] = (s64)((s32)(rt_val) >>" << imm << ");" << std::endl;
+           out_file << "   s64 rt_val = ctx->cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
+           out_file << "   ctx->cpuRegs.GPR.r[" << rd_index << "].SD[0] = (s64)((s32)(rt_val) >>" << imm << ");" << std::endl;
            out_file << "}" << std::endl;
            break;
         }
@@ -441,8 +498,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
 
             out_file << "{" << std::endl;
-            out_file << "    u32 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
-            out_file << "    context.cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)(s32)ReadMemory8(address);" << std::endl;
+            out_file << "    u32 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)(s32)(s8)" << read_call(1, base_index, offset) << ";" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -456,8 +513,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
 
             out_file << "{" << std::endl;
-            out_file << "    u32 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
-            out_file << "    context.cpuRegs.GPR.r[" << dest_index << "].UD[0] = (u64)(u32)ReadMemory8(address);" << std::endl;
+            out_file << "    u32 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << dest_index << "].UD[0] = (u64)(u32)" << read_call(1, base_index, offset) << ";" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -474,7 +531,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             std::cerr << "  Operand 1 [mem]: type=" << mips_details.operands[1].type << ", base=" << mips_details.operands[1].mem.base << ", disp=" << mips_details.operands[1].mem.disp << std::endl;
         
             out_file << "{" << std::endl;
-            out_file << "    u32 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u32 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
         
             // Alignment Check: Address must be 2-byte aligned (address % 2 == 0)
             out_file << "    if (address % 2 != 0) {" << std::endl;
@@ -483,9 +540,9 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             out_file << "    }" << std::endl;
         
             // Read the 16-bit value and cast it to a signed 16-bit integer (s16)
-            out_file << "    s16 value = (s16)ReadMemory16(address);" << std::endl;
+            out_file << "    s16 value = (s16)" << read_call(2, base_index, offset) << ";" << std::endl;
             // Assign the signed 16-bit value to the signed 64-bit register. C++ handles the sign extension.
-            out_file << "    context.cpuRegs.GPR.r[" << rt_index << "].SD[0] = (s64)value;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << rt_index << "].SD[0] = (s64)value;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -502,7 +559,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             std::cerr << "  Operand 1 [mem]: type=" << mips_details.operands[1].type << ", base=" << mips_details.operands[1].mem.base << ", disp=" << mips_details.operands[1].mem.disp << std::endl;
         
             out_file << "{" << std::endl;
-            out_file << "    u32 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u32 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
         
             // Alignment Check: Address must be 2-byte aligned (address % 2 == 0)
             out_file << "    if (address % 2 != 0) {" << std::endl;
@@ -511,9 +568,9 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             out_file << "    }" << std::endl;
         
             // Read the 16-bit value and cast it to a signed 16-bit integer (s16)
-            out_file << "    u16 value = ReadMemory16(address);" << std::endl;
+            out_file << "    u16 value = " << read_call(2, base_index, offset) << ";" << std::endl;
             // Assign the signed 16-bit value to the signed 64-bit register. C++ handles the sign extension.
-            out_file << "    context.cpuRegs.GPR.r[" << rt_index << "].UD[0] = (u64)value;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0] = (u64)value;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -527,8 +584,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
 
             out_file << "{" << std::endl;
-            out_file << "    u32 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
-            out_file << "    WriteMemory8(address, (u8)context.cpuRegs.GPR.r[" << source_index << "].UD[0]);" << std::endl;
+            out_file << "    u32 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    " << write_call(1, base_index, offset, "(u8)ctx->cpuRegs.GPR.r[" + std::to_string(source_index) + "].UD[0]") << ";" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -542,14 +599,14 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
 
             out_file << "{" << std::endl;
-            out_file << "    u32 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u32 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
         
             // Alignment Check: Address must be 2-byte aligned (address % 2 == 0)
             out_file << "    if (address % 2 != 0) {" << std::endl;
             out_file << "        std::cerr << \"FATAL ERROR: Unaligned memory access for LH at address: 0x\" << std::hex << address << std::endl;" << std::endl;
             out_file << "        exit(1);" << std::endl;
             out_file << "    }" << std::endl;
-            out_file << "    WriteMemory16(address, (u16)context.cpuRegs.GPR.r[" << source_index << "].UD[0]);" << std::endl;
+            out_file << "    " << write_call(2, base_index, offset, "(u16)ctx->cpuRegs.GPR.r[" + std::to_string(source_index) + "].UD[0]") << ";" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -563,8 +620,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             
 
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] > 0) {" << std::endl;
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] > 0) {" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -578,8 +635,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             u32 target = calculate_target(*insn);
 
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] <= 0) {" << std::endl;
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] <= 0) {" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -589,14 +646,14 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             const auto& target_imm = mips_details.operands[0].imm;
 
             u32 target = calculate_target(*insn);
-            out_file << "    context.cpuRegs.GPR.r[31].UD[0] = " << insn->address << "+ 8;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[31].UD[0] = " << insn->address << "+ 8;" << std::endl;
             /*                      0xFFFFFFFF                              0x02FFFFFF
                                     0xF0000000                              0x0FFFFFF0
 
 
-            context.cpuRegs.pc = (insn->address & 0xF0000000) | (target_reg_index << 2);
+            ctx->cpuRegs.pc = (insn->address & 0xF0000000) | (target_reg_index << 2);
             */
-            out_file << "    func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "    func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "    return;" << std::endl;
             break;
         }
@@ -610,9 +667,9 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
                                     0xF0000000                              0x0FFFFFF0
 
 
-            context.cpuRegs.pc = (insn->address & 0xF0000000) | (target_reg_index << 2);
+            ctx->cpuRegs.pc = (insn->address & 0xF0000000) | (target_reg_index << 2);
             */
-           out_file << "    func_0x" << std::hex << target << "();" << std::endl;
+           out_file << "    func_0x" << std::hex << target << "(ctx);" << std::endl;
            out_file << "    return;" << std::endl;
            break;
         }
@@ -629,49 +686,31 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             We save this place we want to return in the rd register. We dont save the next instruction because that is already done since J instructions do the next immediate
             instruction before the jump so we store the one after. 
 
-            context.cpuRegs.GPR.r[rd_index].UD[0] = insn->address + 8;
-            context.cpuRegs.pc = context.cpuRegs.GPR.r[rs_index];
+            ctx->cpuRegs.GPR.r[rd_index].UD[0] = insn->address + 8;
+            ctx->cpuRegs.pc = ctx->cpuRegs.GPR.r[rs_index];
             */
 
-            out_file << "    context.cpuRegs.GPR.r[ "<< rd_index <<" ].UD[0] = " << std::hex << insn->address <<  + 8 << ";" << std::endl;
-            out_file << "    host_dispatch_jump(context.cpuRegs.GPR.r[ "<< rs_index <<" ].UD[0]);" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[ "<< rd_index <<" ].UD[0] = " << std::hex << insn->address <<  + 8 << ";" << std::endl;
+            out_file << "    host_dispatch_jump(ctx, ctx->cpuRegs.GPR.r[ "<< rs_index <<" ].UD[0]);" << std::endl;
             out_file << "    return;" << std::endl;
             break;
         }
         case MIPS_INS_SYSCALL : {
-
             /*
-            
-                SYS operation: v0 -> $2
-                Parameters: a0-a3 ->  $4, $5, $6, $7
-
-
-
-
-                Mode SWITCH
-                context.cpuRegs.CP0.n.EPC = current_insn + 4;
-                context.cpuRegs.CP0.n.Cause = syscall_code;
-                                              |      | 
-                1111 1111 1111 1111 1111 1111 1000 0011
-                8 =                               01010
-                Need to shift by 2 -> 8 << 2
-
-                                              |      | 
-                1111 1111 1111 1111 1111 1111 1000 0011
-                                              |      |
-                8 =                            010 10__
-
+                There is no BIOS: kernel services are native (see syscalls.h), called
+                with the number in $v1, arguments in $a0-$a3 and the result in $v0.
+                $v1 is nearly always loaded right before the SYSCALL, in which case the
+                table entry is called directly.
 
-                // sys_handlers returns the address to go to
-                sys_handler(cs_mips& context_details);
-            
+                syscall_table[syscall_index(ctx->cpuRegs.GPR.r[3].SL[0])](*ctx);
             */
-
-            out_file << "context.cpuRegs.CP0.n.EPC = " << insn->address <<" + 4;" << std::endl;
-            out_file << "context.cpuRegs.CP0.n.Cause = (context.cpuRegs.CP0.n.Cause & 0xFFFFFF83) | (8 << 2);" << std::endl;
-            out_file << "sys_handler(context);" << std::endl;
-
-
+            u32 number;
+            if (block_constants.get(3, number)) {
+                out_file << "    syscall_table[0x" << std::hex << syscall_index((s32)number) << "](*ctx);" << std::endl;
+            }
+            else {
+                out_file << "    cpu_syscall(*ctx);" << std::endl;
+            }
             break;
         }
         case MIPS_INS_MFC0 : {
@@ -682,12 +721,21 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             int rt_index = get_gpr_index(rt_reg);
 
+            // Capstone reports the COP0 register as the GPR with the same number.
+            int rd_index = get_gpr_index(rd_reg);
+
             /*
             
-            context.cpuRegs.GPR.r[rt_index].SD[0] = (s64)(s32)context.cpuRegs.CP0.r[rd_reg];
+            ctx->cpuRegs.GPR.r[rt_index].SD[0] = (s64)(s32)ctx->cpuRegs.CP0.r[rd_index];
             */
 
-            out_file << "context.cpuRegs.GPR.r["<< rt_index <<"].SD[0] = (s64)(s32)context.cpuRegs.CP0.r["<< rd_reg <<"];" << std::endl;
+            // Count is not ticked, it is worked out from cycle when read (see timers.h).
+            if(rd_index == 9){
+                out_file << "ctx->cpuRegs.GPR.r["<< rt_index <<"].SD[0] = (s64)(s32)cop0_read_count(*ctx);" << std::endl;
+            }
+            else{
+                out_file << "ctx->cpuRegs.GPR.r["<< rt_index <<"].SD[0] = (s64)(s32)ctx->cpuRegs.CP0.r["<< rd_index <<"];" << std::endl;
+            }
             break;
         }
         case MIPS_INS_MTC0 : {
@@ -698,12 +746,38 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             int rt_index = get_gpr_index(rt_reg);
 
+            int rd_index = get_gpr_index(rd_reg);
+
             /*
 
-            context.cpuRegs.CP0.r[rd_reg] = (s32)context.cpuRegs.GPR.r[rt_index];
+            ctx->cpuRegs.CP0.r[rd_index] = (s32)ctx->cpuRegs.GPR.r[rt_index];
             */
 
-            out_file << "context.cpuRegs.CP0.r["<< rd_reg <<"] = (u32)context.cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
+            // Count and Compare re-arm the COP0 timer and Status can unmask a pending
+            // interrupt, so those go through the runtime.
+            if(rd_index == 9 || rd_index == 11 || rd_index == 12){
+                out_file << "cop0_write(*ctx, " << std::to_string(rd_index) << ", (u32)ctx->cpuRegs.GPR.r["<< rt_index <<"].UD[0]);" << std::endl;
+            }
+            else{
+                out_file << "ctx->cpuRegs.CP0.r["<< rd_index <<"] = (u32)ctx->cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
+            }
+            break;
+        }
+        case MIPS_INS_TLBWI: {
+            // TLB writes remap pages, so they go through the runtime (see tlb.h).
+            out_file << "cop0_tlbwi(*ctx);" << std::endl;
+            break;
+        }
+        case MIPS_INS_TLBWR: {
+            out_file << "cop0_tlbwr(*ctx);" << std::endl;
+            break;
+        }
+        case MIPS_INS_TLBP: {
+            out_file << "cop0_tlbp(*ctx);" << std::endl;
+            break;
+        }
+        case MIPS_INS_TLBR: {
+            out_file << "cop0_tlbr(*ctx);" << std::endl;
             break;
         }
 
@@ -728,10 +802,10 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
                 0000 0000 0000 0000 0000 0000 0001 1111
-                context.cpuRegs.GPR[rd_index].UD[0] = (s64)((s32)context.cpuRegs.GPR[rt_index].UD[0] <<  (s32)(context.cpuRegs.GPR[rs_index].SD[0] & 0x1F));
+                ctx->cpuRegs.GPR[rd_index].UD[0] = (s64)((s32)ctx->cpuRegs.GPR[rt_index].UD[0] <<  (s32)(ctx->cpuRegs.GPR[rs_index].SD[0] & 0x1F));
             */
 
-            out_file << "context.cpuRegs.GPR["<< rd_index <<"].UD[0] = (u64)((u32)context.cpuRegs.GPR["<< rt_index <<"].UD[0] << (u32)(context.cpuRegs.GPR["<< rs_index <<"].UD[0] & 0x1F));" << std::endl;
+            out_file << "ctx->cpuRegs.GPR["<< rd_index <<"].UD[0] = (u64)((u32)ctx->cpuRegs.GPR["<< rt_index <<"].UD[0] << (u32)(ctx->cpuRegs.GPR["<< rs_index <<"].UD[0] & 0x1F));" << std::endl;
             break;
         }
         case MIPS_INS_SRLV: {
@@ -751,10 +825,10 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
                 0000 0000 0000 0000 0000 0000 0001 1111
-                context.cpuRegs.GPR[rd_index].SD[0] = (s64)((s32)context.cpuRegs.GPR[rt_index].UD[0] >>  (s32)(context.cpuRegs.GPR[rs_index].SD[0] & 0x1F));
+                ctx->cpuRegs.GPR[rd_index].SD[0] = (s64)((s32)ctx->cpuRegs.GPR[rt_index].UD[0] >>  (s32)(ctx->cpuRegs.GPR[rs_index].SD[0] & 0x1F));
             */
 
-            out_file << "context.cpuRegs.GPR["<< rd_index <<"].UD[0] = (u64)((u32)context.cpuRegs.GPR["<< rt_index <<"].UD[0] >> (u32)(context.cpuRegs.GPR["<< rs_index <<"].UD[0] & 0x1F));" << std::endl;
+            out_file << "ctx->cpuRegs.GPR["<< rd_index <<"].UD[0] = (u64)((u32)ctx->cpuRegs.GPR["<< rt_index <<"].UD[0] >> (u32)(ctx->cpuRegs.GPR["<< rs_index <<"].UD[0] & 0x1F));" << std::endl;
             break;
         }
         case MIPS_INS_SRAV: {
@@ -774,10 +848,10 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
                 0000 0000 0000 0000 0000 0000 0011 1111
-                context.cpuRegs.GPR[rd_index].SD[0] = (s64)((s32)context.cpuRegs.GPR[rt_index].UD[0] >>  (s32)(context.cpuRegs.GPR[rs_index].SD[0] & 0x1F));
+                ctx->cpuRegs.GPR[rd_index].SD[0] = (s64)((s32)ctx->cpuRegs.GPR[rt_index].UD[0] >>  (s32)(ctx->cpuRegs.GPR[rs_index].SD[0] & 0x1F));
             */
 
-            out_file << "context.cpuRegs.GPR["<< rd_index <<"].SD[0] = (s64)((s32)context.cpuRegs.GPR["<< rt_index <<"].SD[0] >> (s32)(context.cpuRegs.GPR["<< rs_index <<"].SD[0] & 0x1F));" << std::endl;
+            out_file << "ctx->cpuRegs.GPR["<< rd_index <<"].SD[0] = (s64)((s32)ctx->cpuRegs.GPR["<< rt_index <<"].SD[0] >> (s32)(ctx->cpuRegs.GPR["<< rs_index <<"].SD[0] & 0x1F));" << std::endl;
             break;
         }
         case MIPS_INS_DSLLV: {
@@ -797,10 +871,10 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
                 0000 0000 0000 0000 0000 0000 1111 1111
-                context.cpuRegs.GPR[rd_index].UD[0] = (s64)((s32)context.cpuRegs.GPR[rt_index].UD[0] <<  (s32)(context.cpuRegs.GPR[rs_index].SD[0] & 0x3F));
+                ctx->cpuRegs.GPR[rd_index].UD[0] = (s64)((s32)ctx->cpuRegs.GPR[rt_index].UD[0] <<  (s32)(ctx->cpuRegs.GPR[rs_index].SD[0] & 0x3F));
             */
 
-            out_file << "context.cpuRegs.GPR["<< rd_index <<"].UD[0] = (u64)((u32)context.cpuRegs.GPR["<< rt_index <<"].UD[0] << (u32)(context.cpuRegs.GPR["<< rs_index <<"].UD[0] & 0x3F));" << std::endl;
+            out_file << "ctx->cpuRegs.GPR["<< rd_index <<"].UD[0] = (u64)((u32)ctx->cpuRegs.GPR["<< rt_index <<"].UD[0] << (u32)(ctx->cpuRegs.GPR["<< rs_index <<"].UD[0] & 0x3F));" << std::endl;
             break;
         }
         case MIPS_INS_DSRLV: {
@@ -819,10 +893,10 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
                 0000 0000 0000 0000 0000 0000 0001 1111
-                context.cpuRegs.GPR[rd_index].SD[0] = (s64)((s32)context.cpuRegs.GPR[rt_index].UD[0] >>  (s32)(context.cpuRegs.GPR[rs_index].SD[0] & 0x1F));
+                ctx->cpuRegs.GPR[rd_index].SD[0] = (s64)((s32)ctx->cpuRegs.GPR[rt_index].UD[0] >>  (s32)(ctx->cpuRegs.GPR[rs_index].SD[0] & 0x1F));
             */
 
-            out_file << "context.cpuRegs.GPR["<< rd_index <<"].UD[0] = (u64)((u32)context.cpuRegs.GPR["<< rt_index <<"].UD[0] >> (u32)(context.cpuRegs.GPR["<< rs_index <<"].UD[0] & 0x3F));" << std::endl;
+            out_file << "ctx->cpuRegs.GPR["<< rd_index <<"].UD[0] = (u64)((u32)ctx->cpuRegs.GPR["<< rt_index <<"].UD[0] >> (u32)(ctx->cpuRegs.GPR["<< rs_index <<"].UD[0] & 0x3F));" << std::endl;
             break;
             break;
         }
@@ -843,10 +917,10 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
                 0000 0000 0000 0000 0000 0000 0011 1111
-                context.cpuRegs.GPR[rd_index].SD[0] = (s64)((s32)context.cpuRegs.GPR[rt_index].UD[0] >>  (s32)(context.cpuRegs.GPR[rs_index].SD[0] & 0x1F));
+                ctx->cpuRegs.GPR[rd_index].SD[0] = (s64)((s32)ctx->cpuRegs.GPR[rt_index].UD[0] >>  (s32)(ctx->cpuRegs.GPR[rs_index].SD[0] & 0x1F));
             */
 
-            out_file << "context.cpuRegs.GPR["<< rd_index <<"].SD[0] = (s64)((s32)context.cpuRegs.GPR["<< rt_index <<"].SD[0] >> (s32)(context.cpuRegs.GPR["<< rs_index <<"].SD[0] & 0x3F));" << std::endl;
+            out_file << "ctx->cpuRegs.GPR["<< rd_index <<"].SD[0] = (s64)((s32)ctx->cpuRegs.GPR["<< rt_index <<"].SD[0] >> (s32)(ctx->cpuRegs.GPR["<< rs_index <<"].SD[0] & 0x3F));" << std::endl;
             break;
             break;
         }
@@ -868,15 +942,15 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
             {
-                if (context.cpuRegs.GPR.r[rt_index].UD[0] == 0){
-                    context.cpuRegs.GPR.r[rd_index].UD[0] = context.cpuRegs.GPR.r[rs_index].UD[0];
+                if (ctx->cpuRegs.GPR.r[rt_index].UD[0] == 0){
+                    ctx->cpuRegs.GPR.r[rd_index].UD[0] = ctx->cpuRegs.GPR.r[rs_index].UD[0];
                 }
             }
             */
            
             out_file << "{" << std::endl;
-            out_file << "  if (context.cpuRegs.GPR.r["<< rt_index <<"].UD[0] == 0){" << std::endl;
-            out_file << "      context.cpuRegs.GPR.r["<< rd_index <<"].UD[0] = context.cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
+            out_file << "  if (ctx->cpuRegs.GPR.r["<< rt_index <<"].UD[0] == 0){" << std::endl;
+            out_file << "      ctx->cpuRegs.GPR.r["<< rd_index <<"].UD[0] = ctx->cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
             out_file << "  }" << std::endl;
             out_file << "}" << std::endl;
 
@@ -899,15 +973,15 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
             {
-                if (context.cpuRegs.GPR.r[rt_index].UD[0] != 0){
-                    context.cpuRegs.GPR.r[rd_index].UD[0] = context.cpuRegs.GPR.r[rs_index].UD[0];
+                if (ctx->cpuRegs.GPR.r[rt_index].UD[0] != 0){
+                    ctx->cpuRegs.GPR.r[rd_index].UD[0] = ctx->cpuRegs.GPR.r[rs_index].UD[0];
                 }
             }
             */
            
             out_file << "{" << std::endl;
-            out_file << "  if (context.cpuRegs.GPR.r["<< rt_index <<"].UD[0] != 0){" << std::endl;
-            out_file << "      context.cpuRegs.GPR.r["<< rd_index <<"].UD[0] = context.cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
+            out_file << "  if (ctx->cpuRegs.GPR.r["<< rt_index <<"].UD[0] != 0){" << std::endl;
+            out_file << "      ctx->cpuRegs.GPR.r["<< rd_index <<"].UD[0] = ctx->cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
             out_file << "  }" << std::endl;
             out_file << "}" << std::endl;
 
@@ -928,9 +1002,9 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rd_index = get_gpr_index(rd_reg);
 
             /*
-            context.cpuRegs.GPR.r[rd_index].UD[0] = context.cpuRegs.HI.UD[0];
+            ctx->cpuRegs.GPR.r[rd_index].UD[0] = ctx->cpuRegs.HI.UD[0];
             */
-            out_file << "context.cpuRegs.GPR.r["<< rd_index <<"].UD[0] = context.cpuRegs.HI.UD[0];" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r["<< rd_index <<"].UD[0] = ctx->cpuRegs.HI.UD[0];" << std::endl;
             break;
         }
         case MIPS_INS_MTHI: {
@@ -941,10 +1015,10 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             int rd_index = get_gpr_index(rd_reg);
             /*
-            context.cpuRegs.HI.UD[0] = (u32)context.cpuRegs.GPR.[ rd_index ].UD[0];
+            ctx->cpuRegs.HI.UD[0] = (u32)ctx->cpuRegs.GPR.[ rd_index ].UD[0];
             */
 
-            out_file << "context.cpuRegs.HI.UD[0] = (u32)context.cpuRegs.GPR.["<< rd_index <<"].UD[0];" << std::endl;
+            out_file << "ctx->cpuRegs.HI.UD[0] = (u32)ctx->cpuRegs.GPR.["<< rd_index <<"].UD[0];" << std::endl;
             break;
         }
         case MIPS_INS_MFLO: {
@@ -957,9 +1031,9 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rd_index = get_gpr_index(rd_reg);
 
             /*
-            context.cpuRegs.GPR.r[rd_index].UD[0] = context.cpuRegs.LO.UD[0];
+            ctx->cpuRegs.GPR.r[rd_index].UD[0] = ctx->cpuRegs.LO.UD[0];
             */
-            out_file << "context.cpuRegs.GPR.r["<< rd_index <<"].UD[0] = context.cpuRegs.LO.UD[0];" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r["<< rd_index <<"].UD[0] = ctx->cpuRegs.LO.UD[0];" << std::endl;
             break;
         }
         case MIPS_INS_MTLO: {
@@ -970,10 +1044,10 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             int rd_index = get_gpr_index(rd_reg);
             /*
-            context.cpuRegs.LO.UD[0] = (u32)context.cpuRegs.GPR.[ rd_index ].UD[0];
+            ctx->cpuRegs.LO.UD[0] = (u32)ctx->cpuRegs.GPR.[ rd_index ].UD[0];
             */
 
-            out_file << "context.cpuRegs.LO.UD[0] = (u32)context.cpuRegs.GPR.["<< rd_index <<"].UD[0];" << std::endl;
+            out_file << "ctx->cpuRegs.LO.UD[0] = (u32)ctx->cpuRegs.GPR.["<< rd_index <<"].UD[0];" << std::endl;
             break;
         }
         case MIPS_INS_MULTU: {
@@ -988,18 +1062,18 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            u32 op1 = (u32)context.cpuRegs.GPR.r[rs_index].UD[0];
-            u32 op2 = (u32)context.cpuRegs.GPR.r[rt_index].UD[0];
+            u32 op1 = (u32)ctx->cpuRegs.GPR.r[rs_index].UD[0];
+            u32 op2 = (u32)ctx->cpuRegs.GPR.r[rt_index].UD[0];
             u64 product = (u64)op1 * op2;
-            context.cpuRegs.LO.UD[0] = (u64)(u32)product;
-            context.cpuRegs.HI.UD[0] = (u64)(u32)(product >> 32);
+            ctx->cpuRegs.LO.UD[0] = (u64)(u32)product;
+            ctx->cpuRegs.HI.UD[0] = (u64)(u32)(product >> 32);
             */
 
-            out_file << "u32 op1 = (u32)context.cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
-            out_file << "u32 op2 = (u32)context.cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
+            out_file << "u32 op1 = (u32)ctx->cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
+            out_file << "u32 op2 = (u32)ctx->cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
             out_file << "u64 product = (u64)op1 * op2;" << std::endl;
-            out_file << "context.cpuRegs.LO.UD[0] = (u64)(u32)product;" << std::endl;
-            out_file << "context.cpuRegs.HI.UD[0] = (u64)(u32)(product >> 32);" << std::endl;
+            out_file << "ctx->cpuRegs.LO.UD[0] = (u64)(u32)product;" << std::endl;
+            out_file << "ctx->cpuRegs.HI.UD[0] = (u64)(u32)(product >> 32);" << std::endl;
 
             break;
         }
@@ -1017,27 +1091,27 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
             {
-                u32 num = context.cpuRegs.GPR.r[rs_index].UD[0];
-                u32 den = context.cpuRegs.GPR.r[rt_index].UD[0];
+                u32 num = ctx->cpuRegs.GPR.r[rs_index].UD[0];
+                u32 den = ctx->cpuRegs.GPR.r[rt_index].UD[0];
 
                 if (den != 0){
                     u32 HI_ans = num % den;
                     u32 LO_ans = num / den;
-                    context.cpuRegs.LO.UD[0] = (u64)(u32)(LO_ans);
-                    context.cpuRegs.HI.UD[0] = (u64)(u32)(HI_ans);
+                    ctx->cpuRegs.LO.UD[0] = (u64)(u32)(LO_ans);
+                    ctx->cpuRegs.HI.UD[0] = (u64)(u32)(HI_ans);
                 }
             
             }
             */
 
             out_file << "{" << std::endl;
-            out_file << "u32 num = context.cpuRegs.GPR.r[" << rs_index << "].UD[0];"<< std::endl;
-            out_file << "u32 den = context.cpuRegs.GPR.r[" << rt_index << "].UD[0];"<< std::endl;
+            out_file << "u32 num = ctx->cpuRegs.GPR.r[" << rs_index << "].UD[0];"<< std::endl;
+            out_file << "u32 den = ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0];"<< std::endl;
             out_file << "  if (den != 0){"<< std::endl;
             out_file << "      u32 HI_ans = num " << "%" << " den;" << std::endl;
             out_file << "      u32 LO_ans = num " << "/" << " den;" << std::endl;
-            out_file << "      context.cpuRegs.LO.UD[0] = (u64)(u32)(LO_ans);"<< std::endl;
-            out_file << "      context.cpuRegs.HI.UD[0] = (u64)(u32)(HI_ans);"<< std::endl;
+            out_file << "      ctx->cpuRegs.LO.UD[0] = (u64)(u32)(LO_ans);"<< std::endl;
+            out_file << "      ctx->cpuRegs.HI.UD[0] = (u64)(u32)(HI_ans);"<< std::endl;
             out_file <<"   }"<< std::endl;
             out_file <<"}"<< std::endl;
             break;
@@ -1057,8 +1131,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            s32 op1 = (s32)context.cpuRegs.GPR.r[rs_index].SD[0];
-            s32 op2 = (s32)context.cpuRegs.GPR.r[rt_index].SD[0];
+            s32 op1 = (s32)ctx->cpuRegs.GPR.r[rs_index].SD[0];
+            s32 op2 = (s32)ctx->cpuRegs.GPR.r[rt_index].SD[0];
 
 
             s64 sum = (s64)op1 + (s64)op2;
@@ -1071,19 +1145,19 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             }
             else{
-                context.cpuRegs.GPR.r[rd_index].SD[0] = sum;
+                ctx->cpuRegs.GPR.r[rd_index].SD[0] = sum;
             }
 
             */
 
-            out_file << "s32 op1 = (s32)context.cpuRegs.GPR.r[" << rs_index <<"].SD[0];" << std::endl;
-            out_file << "s32 op2 = (s32)context.cpuRegs.GPR.r[" << rt_index << "].SD[0];" << std::endl;
+            out_file << "s32 op1 = (s32)ctx->cpuRegs.GPR.r[" << rs_index <<"].SD[0];" << std::endl;
+            out_file << "s32 op2 = (s32)ctx->cpuRegs.GPR.r[" << rt_index << "].SD[0];" << std::endl;
             out_file << "s64 sum = (s64)op1 + (s64)op2;" << std::endl;
             out_file << "if (sum != (s64)(s32)sum){" << std::endl;
             out_file << "  handle_overflow();" << std::endl;
             out_file << "}" << std::endl;
             out_file << "else{" << std::endl;
-            out_file << "  context.cpuRegs.GPR.r[" << rd_index <<"].SD[0] = sum;" << std::endl;
+            out_file << "  ctx->cpuRegs.GPR.r[" << rd_index <<"].SD[0] = sum;" << std::endl;
             out_file << "}" << std::endl;
 
 
@@ -1107,8 +1181,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-                s32 op1 = (s32)context.cpuRegs.GPR.r[rs_index].SD[0];
-                s32 op2 = (s32)context.cpuRegs.GPR.r[rt_index].SD[0];
+                s32 op1 = (s32)ctx->cpuRegs.GPR.r[rs_index].SD[0];
+                s32 op2 = (s32)ctx->cpuRegs.GPR.r[rt_index].SD[0];
 
                 s64 diff = (s64)op1 - (s64)op2;
 
@@ -1116,19 +1190,19 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
                     handle_overflow();
                 }
                 else{
-                    context.cpuRegs.GPR.r[rd_index].SD[0] = diff;
+                    ctx->cpuRegs.GPR.r[rd_index].SD[0] = diff;
                 }
             
             */
 
-            out_file << "s32 op1 = (s32)context.cpuRegs.GPR.r[rs_index].SD[0];" << std::endl;
-            out_file << "s32 op2 = (s32)context.cpuRegs.GPR.r[rt_index].SD[0];" << std::endl;
+            out_file << "s32 op1 = (s32)ctx->cpuRegs.GPR.r[rs_index].SD[0];" << std::endl;
+            out_file << "s32 op2 = (s32)ctx->cpuRegs.GPR.r[rt_index].SD[0];" << std::endl;
             out_file << "s64 diff = (s64)op1 - (s64)op2;" << std::endl;
             out_file << "if (diff != (s64)(s32)diff){" << std::endl;
             out_file << "  handle_overflow();" << std::endl;
             out_file << "}" << std::endl;
             out_file << "else{" << std::endl;
-            out_file << "  context.cpuRegs.GPR.r[rd_index].SD[0] = diff;" << std::endl;
+            out_file << "  ctx->cpuRegs.GPR.r[rd_index].SD[0] = diff;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -1149,16 +1223,16 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
  
              /*
              {
-                 u64 rs = context.cpuRegs.GPR.r[rs_index].UD[0];
-                 u64 rt = context.cpuRegs.GPR.r[rt_index].UD[0];
-                 context.cpuRegs.GPT.r[rd_index].UD[0] = rs & rt;
+                 u64 rs = ctx->cpuRegs.GPR.r[rs_index].UD[0];
+                 u64 rt = ctx->cpuRegs.GPR.r[rt_index].UD[0];
+                 ctx->cpuRegs.GPT.r[rd_index].UD[0] = rs & rt;
              
              }
              */
             out_file << "{" << std::endl;
-            out_file << "   u64 rs_val = context.cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
-            out_file << "   u64 rt_val = context.cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
-            out_file << "   context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = rs_val & rt_val;" << std::endl;
+            out_file << "   u64 rs_val = ctx->cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
+            out_file << "   u64 rt_val = ctx->cpuRegs.GPR.r["<< rt_index <<"].UD[0];" << std::endl;
+            out_file << "   ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = rs_val & rt_val;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -1189,7 +1263,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
             int rt_index = get_gpr_index(rt_reg);
 
-            out_file << "context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = (u64)((u32)context.cpuRegs.GPR.r[" << rs_index << "].UD[0] < (u32)context.cpuRegs.GPR.r[" << rt_index << "].UD[0] ? 1 : 0);"<< std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = (u64)((u32)ctx->cpuRegs.GPR.r[" << rs_index << "].UD[0] < (u32)ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0] ? 1 : 0);"<< std::endl;
             break;
         }
         case MIPS_INS_DADD: {
@@ -1207,8 +1281,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
             int rt_index = get_gpr_index(rt_reg);
             /*
-            s64 rs = (s64)context.cpuRegs.GPR.r[rs_index].SD[0];
-            s64 rt = (s64)context.cpuRegs.GPR.r[rt_index].SD[0];
+            s64 rs = (s64)ctx->cpuRegs.GPR.r[rs_index].SD[0];
+            s64 rt = (s64)ctx->cpuRegs.GPR.r[rt_index].SD[0];
 
 
             s64 sum = (s64)rs + (s64)rt;
@@ -1221,18 +1295,18 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             }
             else{
-                context.cpuRegs.GPR.r[rd_index].SD[0] = sum;
+                ctx->cpuRegs.GPR.r[rd_index].SD[0] = sum;
             }
             */
 
             out_file << "{" << std::endl;
-            out_file << "    s64 rs = context.cpuRegs.GPR.r[" << rs_index << "].SD[0];" << std::endl;
-            out_file << "    s64 rt = context.cpuRegs.GPR.r[" << rt_index << "].SD[0];" << std::endl;
+            out_file << "    s64 rs = ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0];" << std::endl;
+            out_file << "    s64 rt = ctx->cpuRegs.GPR.r[" << rt_index << "].SD[0];" << std::endl;
             out_file << "    s64 sum = rs + rt;" << std::endl;
             out_file << "    if (((rs > 0 && rt > 0) && sum < 0) || ((rs < 0 && rt < 0) && sum > 0)) {" << std::endl;
             out_file << "        // TODO: Trigger Overflow Exception" << std::endl;
             out_file << "    } else {" << std::endl;
-            out_file << "        context.cpuRegs.GPR.r[" << rd_index << "].SD[0] = sum;" << std::endl;
+            out_file << "        ctx->cpuRegs.GPR.r[" << rd_index << "].SD[0] = sum;" << std::endl;
             out_file << "    }" << std::endl;
             out_file << "}" << std::endl;
             break;
@@ -1252,8 +1326,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
             int rt_index = get_gpr_index(rt_reg);
             /*
-            u64 rs = (u64)context.cpuRegs.GPR.r[rs_index].UD[0];
-            u64 rt = (u64)context.cpuRegs.GPR.r[rt_index].UD[0];
+            u64 rs = (u64)ctx->cpuRegs.GPR.r[rs_index].UD[0];
+            u64 rt = (u64)ctx->cpuRegs.GPR.r[rt_index].UD[0];
 
 
             u64 sum = (u64)rs + (u64)rt;
@@ -1266,15 +1340,15 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             }
             else{
-                context.cpuRegs.GPR.r[rd_index].UD[0] = sum;
+                ctx->cpuRegs.GPR.r[rd_index].UD[0] = sum;
             }
             */
 
             out_file << "{" << std::endl;
-            out_file << "    u64 rs = context.cpuRegs.GPR.r[" << rs_index << "].UD[0];" << std::endl;
-            out_file << "    u64 rt = context.cpuRegs.GPR.r[" << rt_index << "].UD[0];" << std::endl;
+            out_file << "    u64 rs = ctx->cpuRegs.GPR.r[" << rs_index << "].UD[0];" << std::endl;
+            out_file << "    u64 rt = ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0];" << std::endl;
             out_file << "    u64 sum = rs + rt;" << std::endl;
-            out_file << "    context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = sum;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = sum;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -1293,8 +1367,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
             int rt_index = get_gpr_index(rt_reg);
             /*
-            s64 rs = (s64)context.cpuRegs.GPR.r[rs_index].SD[0];
-            s64 rt = (s64)context.cpuRegs.GPR.r[rt_index].SD[0];
+            s64 rs = (s64)ctx->cpuRegs.GPR.r[rs_index].SD[0];
+            s64 rt = (s64)ctx->cpuRegs.GPR.r[rt_index].SD[0];
 
 
             s64 sum = (s64)rs + (s64)rt;
@@ -1307,18 +1381,18 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             }
             else{
-                context.cpuRegs.GPR.r[rd_index].SD[0] = sum;
+                ctx->cpuRegs.GPR.r[rd_index].SD[0] = sum;
             }
             */
 
             out_file << "{" << std::endl;
-            out_file << "    s64 rs = context.cpuRegs.GPR.r[" << rs_index << "].SD[0];" << std::endl;
-            out_file << "    s64 rt = context.cpuRegs.GPR.r[" << rt_index << "].SD[0];" << std::endl;
+            out_file << "    s64 rs = ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0];" << std::endl;
+            out_file << "    s64 rt = ctx->cpuRegs.GPR.r[" << rt_index << "].SD[0];" << std::endl;
             out_file << "    s64 diff = rs - rt;" << std::endl;
             out_file << "    if (((rs > 0 && rt < 0) && diff < 0) || ((rs < 0 && rt > 0) && diff > 0)) {" << std::endl;
             out_file << "        // TODO: Trigger Overflow Exception" << std::endl;
             out_file << "    } else {" << std::endl;
-            out_file << "        context.cpuRegs.GPR.r[" << rd_index << "].SD[0] = diff;" << std::endl;
+            out_file << "        ctx->cpuRegs.GPR.r[" << rd_index << "].SD[0] = diff;" << std::endl;
             out_file << "    }" << std::endl;
             out_file << "}" << std::endl;
             break;
@@ -1339,10 +1413,10 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             out_file << "{" << std::endl;
-            out_file << "    u64 rs = context.cpuRegs.GPR.r[" << rs_index << "].UD[0];" << std::endl;
-            out_file << "    u64 rt = context.cpuRegs.GPR.r[" << rt_index << "].UD[0];" << std::endl;
+            out_file << "    u64 rs = ctx->cpuRegs.GPR.r[" << rs_index << "].UD[0];" << std::endl;
+            out_file << "    u64 rt = ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0];" << std::endl;
             out_file << "    u64 diff = rs - rt;" << std::endl;
-            out_file << "    context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = diff;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = diff;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -1359,12 +1433,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] >= context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] >= ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].SD[0] >= context.cpuRegs.GPR.r[" << rt_index <<"].SD[0]){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].SD[0] >= ctx->cpuRegs.GPR.r[" << rt_index <<"].SD[0]){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
 
@@ -1383,12 +1457,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] >= context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] >= ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].UD[0] >= context.cpuRegs.GPR.r[" << rt_index <<"].UD[0]){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].UD[0] >= ctx->cpuRegs.GPR.r[" << rt_index <<"].UD[0]){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
 
@@ -1407,12 +1481,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] < context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] < ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].SD[0] < context.cpuRegs.GPR.r[" << rt_index <<"].SD[0]){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].SD[0] < ctx->cpuRegs.GPR.r[" << rt_index <<"].SD[0]){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
 
@@ -1431,12 +1505,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] >= context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] >= ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].UD[0] < context.cpuRegs.GPR.r[" << rt_index <<"].UD[0]){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].UD[0] < ctx->cpuRegs.GPR.r[" << rt_index <<"].UD[0]){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
 
@@ -1457,12 +1531,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] == context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] == ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].SD[0] == context.cpuRegs.GPR.r[" << rt_index <<"].SD[0]){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].SD[0] == ctx->cpuRegs.GPR.r[" << rt_index <<"].SD[0]){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
 
@@ -1481,12 +1555,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] == context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] == ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].SD[0] != context.cpuRegs.GPR.r[" << rt_index <<"].SD[0]){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].SD[0] != ctx->cpuRegs.GPR.r[" << rt_index <<"].SD[0]){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
 
@@ -1507,11 +1581,11 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            context.cpuRegs.GPR.r[rd_index].UD[0] = (u64)(context.cpuRegs.GPR.r[rt_index].UD[0] << context.cpuRegs.GPR.sa);
+            ctx->cpuRegs.GPR.r[rd_index].UD[0] = (u64)(ctx->cpuRegs.GPR.r[rt_index].UD[0] << ctx->cpuRegs.GPR.sa);
             
             */
 
-            out_file << "context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = context.cpuRegs.GPR.r[" << rt_index << "].UD[0] << " << sa << ";" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0] << " << sa << ";" << std::endl;
 
             break;
         }
@@ -1531,11 +1605,11 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            context.cpuRegs.GPR.r[rd_index].UD[0] = (u64)(context.cpuRegs.GPR.r[rt_index].UD[0] >> context.cpuRegs.GPR.sa);
+            ctx->cpuRegs.GPR.r[rd_index].UD[0] = (u64)(ctx->cpuRegs.GPR.r[rt_index].UD[0] >> ctx->cpuRegs.GPR.sa);
             
             */
 
-            out_file << "context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = context.cpuRegs.GPR.r[" << rt_index << "].UD[0] >> " << sa << ";" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0] >> " << sa << ";" << std::endl;
 
             break;
         }
@@ -1555,11 +1629,11 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            context.cpuRegs.GPR.r[rd_index].UD[0] = (u64)(context.cpuRegs.GPR.r[rt_index].UD[0] >> context.cpuRegs.GPR.sa);
+            ctx->cpuRegs.GPR.r[rd_index].UD[0] = (u64)(ctx->cpuRegs.GPR.r[rt_index].UD[0] >> ctx->cpuRegs.GPR.sa);
             
             */
 
-            out_file << "context.cpuRegs.GPR.r[" << rd_index << "].SD[0] = context.cpuRegs.GPR.r[" << rt_index << "].SD[0] >> " << sa << ";" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << rd_index << "].SD[0] = ctx->cpuRegs.GPR.r[" << rt_index << "].SD[0] >> " << sa << ";" << std::endl;
 
             break;
         }
@@ -1578,11 +1652,11 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            context.cpuRegs.GPR.r[rd_index].UD[0] = (u64)(context.cpuRegs.GPR.r[rt_index].UD[0] << context.cpuRegs.GPR.sa);
+            ctx->cpuRegs.GPR.r[rd_index].UD[0] = (u64)(ctx->cpuRegs.GPR.r[rt_index].UD[0] << ctx->cpuRegs.GPR.sa);
             
             */
 
-            out_file << "context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = context.cpuRegs.GPR.r[" << rt_index << "].UD[0] << (32 + " << sa << ");" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0] << (32 + " << sa << ");" << std::endl;
 
             break;
         }
@@ -1602,11 +1676,11 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            context.cpuRegs.GPR.r[rd_index].UD[0] = context.cpuRegs.GPR.r[rt_index].UD[0] >> (32 + sa);
+            ctx->cpuRegs.GPR.r[rd_index].UD[0] = ctx->cpuRegs.GPR.r[rt_index].UD[0] >> (32 + sa);
             
             */
 
-            out_file << "context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = context.cpuRegs.GPR.r[" << rt_index << "].UD[0] >> (32 + " << sa << ");" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0] >> (32 + " << sa << ");" << std::endl;
 
             break;
         }
@@ -1626,11 +1700,11 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            context.cpuRegs.GPR.r[rd_index].UD[0] = (u64)(context.cpuRegs.GPR.r[rt_index].UD[0] >> context.cpuRegs.GPR.sa);
+            ctx->cpuRegs.GPR.r[rd_index].UD[0] = (u64)(ctx->cpuRegs.GPR.r[rt_index].UD[0] >> ctx->cpuRegs.GPR.sa);
             
             */
 
-            out_file << "context.cpuRegs.GPR.r[" << rd_index << "].SD[0] = context.cpuRegs.GPR.r[" << rt_index << "].SD[0] >> (32 + " << sa << ");" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << rd_index << "].SD[0] = ctx->cpuRegs.GPR.r[" << rt_index << "].SD[0] >> (32 + " << sa << ");" << std::endl;
 
 
             break;
@@ -1651,15 +1725,15 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
             
-            if (context.cpuRegs.GPR.r[rs_index].SD[0] < 0){
-                context.cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
+            if (ctx->cpuRegs.GPR.r[rs_index].SD[0] < 0){
+                ctx->cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
             }
             else{
-                context.cpuRegs.GPR.pc = insn->address + 8;
+                ctx->cpuRegs.GPR.pc = insn->address + 8;
             }
             */
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] < 0) {" << std::endl;
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] < 0) {" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -1678,15 +1752,15 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
             
-            if (context.cpuRegs.GPR.r[rs_index].SD[0] < 0){
-                context.cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
+            if (ctx->cpuRegs.GPR.r[rs_index].SD[0] < 0){
+                ctx->cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
             }
             else{
-                context.cpuRegs.GPR.pc = insn->address + 8;
+                ctx->cpuRegs.GPR.pc = insn->address + 8;
             }
             */
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] >= 0) {" << std::endl;
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] >= 0) {" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -1703,12 +1777,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] >= context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] >= ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].SD[0] >= " << imm <<"){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].SD[0] >= " << imm <<"){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
 
@@ -1726,12 +1800,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] >= context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] >= ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].UD[0] >= " << imm <<"){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].UD[0] >= " << imm <<"){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
 
@@ -1749,12 +1823,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] < context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] < ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].SD[0] < " << imm <<"){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].SD[0] < " << imm <<"){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
 
@@ -1772,12 +1846,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] < context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] < ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].UD[0] < " << imm <<"){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].UD[0] < " << imm <<"){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
 
@@ -1795,12 +1869,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] >= context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] >= ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].SD[0] = " << imm <<"){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].SD[0] = " << imm <<"){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
 
@@ -1818,12 +1892,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
 
             /*
-            if (context.cpuRegs.GPR.r[rs_index] >= context.cpuRegs.GPR.r[rt_index]){
+            if (ctx->cpuRegs.GPR.r[rs_index] >= ctx->cpuRegs.GPR.r[rt_index]){
                 // TODO HANDLE TRAP
             }
             */
 
-            out_file << "if (context.cpuRegs.GPR.r[" << rs_index <<"].SD[0] != " << imm <<"){" << std::endl;
+            out_file << "if (ctx->cpuRegs.GPR.r[" << rs_index <<"].SD[0] != " << imm <<"){" << std::endl;
             out_file << "// TODO HANDLE TRAP" << std::endl;
             out_file << "}" << std::endl;
             break;
@@ -1855,7 +1929,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
             int rs_index = get_gpr_index(rs_reg);
 
-            out_file << "context.cpuRegs.GPR.r[" << rt_index << "].UD[0] = (u64)((u32)context.cpuRegs.GPR.r[" << rs_index << "].UD[0] < (u32)" << imm << " ? 1 : 0);"<< std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0] = (u64)((u32)ctx->cpuRegs.GPR.r[" << rs_index << "].UD[0] < (u32)" << imm << " ? 1 : 0);"<< std::endl;
             break;
         }
         case MIPS_INS_ANDI: {
@@ -1872,16 +1946,16 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
  
              /*
              {
-                 u64 rs = context.cpuRegs.GPR.r[rs_index].UD[0];
-                 u64 rt = context.cpuRegs.GPR.r[rt_index].UD[0];
-                 context.cpuRegs.GPT.r[rd_index].UD[0] = rs & rt;
+                 u64 rs = ctx->cpuRegs.GPR.r[rs_index].UD[0];
+                 u64 rt = ctx->cpuRegs.GPR.r[rt_index].UD[0];
+                 ctx->cpuRegs.GPT.r[rd_index].UD[0] = rs & rt;
              
              }
              */
             out_file << "{" << std::endl;
-            out_file << "   u64 rs_val = context.cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
+            out_file << "   u64 rs_val = ctx->cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
             out_file << "   u64 rt_val = "<< imm <<";" << std::endl;
-            out_file << "   context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = rs_val & rt_val;" << std::endl;
+            out_file << "   ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = rs_val & rt_val;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -1898,16 +1972,16 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             /*
             {
-                u64 rs = context.cpuRegs.GPR.r[rs_index].UD[0];
-                u64 rt = context.cpuRegs.GPR.r[rt_index].UD[0];
-                context.cpuRegs.GPT.r[rd_index].UD[0] = rs ^ rt;
+                u64 rs = ctx->cpuRegs.GPR.r[rs_index].UD[0];
+                u64 rt = ctx->cpuRegs.GPR.r[rt_index].UD[0];
+                ctx->cpuRegs.GPT.r[rd_index].UD[0] = rs ^ rt;
             
             }
             */
            out_file << "{" << std::endl;
-           out_file << "   u64 rs_val = context.cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
+           out_file << "   u64 rs_val = ctx->cpuRegs.GPR.r["<< rs_index <<"].UD[0];" << std::endl;
            out_file << "   u64 rt_val = "<< imm <<";" << std::endl;
-           out_file << "   context.cpuRegs.GPR.r[" << rd_index << "].UD[0] = rs_val ^ rt_val;" << std::endl;
+           out_file << "   ctx->cpuRegs.GPR.r[" << rd_index << "].UD[0] = rs_val ^ rt_val;" << std::endl;
            out_file << "}" << std::endl;
            break;
         }
@@ -1923,8 +1997,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
 
             /*
-            u64 rs = (u64)context.cpuRegs.GPR.r[rs_index].UD[0];
-            u64 rt = (u64)context.cpuRegs.GPR.r[rt_index].UD[0];
+            u64 rs = (u64)ctx->cpuRegs.GPR.r[rs_index].UD[0];
+            u64 rt = (u64)ctx->cpuRegs.GPR.r[rt_index].UD[0];
 
 
             u64 sum = (u64)rs + (u64)rt;
@@ -1937,15 +2011,15 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             }
             else{
-                context.cpuRegs.GPR.r[rd_index].UD[0] = sum;
+                ctx->cpuRegs.GPR.r[rd_index].UD[0] = sum;
             }
             */
 
             out_file << "{" << std::endl;
-            out_file << "    s64 rs = context.cpuRegs.GPR.r[" << rs_index << "].SD[0];" << std::endl;
+            out_file << "    s64 rs = ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0];" << std::endl;
             out_file << "    s64 rt = "<< imm <<";" << std::endl;
             out_file << "    s64 sum = rs + rt;" << std::endl;
-            out_file << "    context.cpuRegs.GPR.r[" << rt_index << "].SD[0] = sum;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << rt_index << "].SD[0] = sum;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -1960,8 +2034,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rs_index = get_gpr_index(rs_reg);
 
             /*
-            u64 rs = (u64)context.cpuRegs.GPR.r[rs_index].UD[0];
-            u64 rt = (u64)context.cpuRegs.GPR.r[rt_index].UD[0];
+            u64 rs = (u64)ctx->cpuRegs.GPR.r[rs_index].UD[0];
+            u64 rt = (u64)ctx->cpuRegs.GPR.r[rt_index].UD[0];
 
 
             u64 sum = (u64)rs + (u64)rt;
@@ -1974,15 +2048,15 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             }
             else{
-                context.cpuRegs.GPR.r[rd_index].UD[0] = sum;
+                ctx->cpuRegs.GPR.r[rd_index].UD[0] = sum;
             }
             */
 
             out_file << "{" << std::endl;
-            out_file << "    u64 rs = context.cpuRegs.GPR.r[" << rs_index << "].UD[0];" << std::endl;
+            out_file << "    u64 rs = ctx->cpuRegs.GPR.r[" << rs_index << "].UD[0];" << std::endl;
             out_file << "    u64 rt = "<< imm <<";" << std::endl;
             out_file << "    u64 sum = rs + rt;" << std::endl;
-            out_file << "    context.cpuRegs.GPR.r[" << rt_index << "].UD[0] = sum;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0] = sum;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -1999,8 +2073,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int rt_index = get_gpr_index(rt_reg);
 
             /*
-            s32 op1 = (s32)context.cpuRegs.GPR.r[rs_index].SD[0];
-            s32 op2 = (s32)context.cpuRegs.GPR.r[rt_index].SD[0];
+            s32 op1 = (s32)ctx->cpuRegs.GPR.r[rs_index].SD[0];
+            s32 op2 = (s32)ctx->cpuRegs.GPR.r[rt_index].SD[0];
 
 
             s64 sum = (s64)op1 + (s64)op2;
@@ -2013,19 +2087,19 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             }
             else{
-                context.cpuRegs.GPR.r[rd_index].SD[0] = sum;
+                ctx->cpuRegs.GPR.r[rd_index].SD[0] = sum;
             }
 
             */
 
-            out_file << "s32 op1 = (s32)context.cpuRegs.GPR.r[" << rs_index << "].SD[0];" << std::endl;
+            out_file << "s32 op1 = (s32)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0];" << std::endl;
             out_file << "s32 op2 = (s32)" << imm << ";" << std::endl;
             out_file << "s64 sum = (s64)op1 + (s64)op2;" << std::endl;
             out_file << "if (sum != (s64)(s32)sum){" << std::endl;
             out_file << "  handle_overflow();" << std::endl;
             out_file << "}" << std::endl;
             out_file << "else{" << std::endl;
-            out_file << "  context.cpuRegs.GPR.r[" << rt_index << "].SD[0] = sum;" << std::endl;
+            out_file << "  ctx->cpuRegs.GPR.r[" << rt_index << "].SD[0] = sum;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -2047,12 +2121,12 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             // For this explanation, we'll represent it conceptually.
         
             out_file << "{" << std::endl;
-            out_file << "    u32 addr = (u32)context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u32 addr = (u32)ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
             out_file << "    u32 shift = addr & 7;" << std::endl;
             out_file << "    u64 mem = ReadMemory64(addr & ~7);" << std::endl;
             out_file << "    u64 mask = 0x00FFFFFFFFFFFFFF >> (shift * 8);" << std::endl;
             out_file << "    u64 data = mem << (56 - (shift * 8));" << std::endl;
-            out_file << "    context.cpuRegs.GPR.r[" << dest_index << "].UD[0] = (context.cpuRegs.GPR.r[" << dest_index << "].UD[0] & mask) | data;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << dest_index << "].UD[0] = (ctx->cpuRegs.GPR.r[" << dest_index << "].UD[0] & mask) | data;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -2068,7 +2142,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
                     
             // Generate the C++ code for the unaligned load logic
             out_file << "{" << std::endl;
-            out_file << "    u32 addr = (u32)context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u32 addr = (u32)ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
             // 'shift' is how many bytes we are into the 8-byte aligned block
             out_file << "    u32 shift = addr & 7;" << std::endl;
             // Read the full 8-byte aligned block that contains our address
@@ -2078,7 +2152,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             // Shift the data from memory to align it to the right side of the register
             out_file << "    u64 data = mem >> (56 - (shift * 8));" << std::endl;
             // Merge the new data with the preserved part of the destination register
-            out_file << "    context.cpuRegs.GPR.r[" << dest_index << "].UD[0] = (context.cpuRegs.GPR.r[" << dest_index << "].UD[0] & mask) | data;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << dest_index << "].UD[0] = (ctx->cpuRegs.GPR.r[" << dest_index << "].UD[0] & mask) | data;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -2107,7 +2181,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             // Generate the C++ code for the unaligned load logic
             out_file << "{" << std::endl;
-            out_file << "    u32 addr = (u32)context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u32 addr = (u32)ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
             // 'shift' is how many bytes we are into the 4-byte aligned block (0-3)
             out_file << "    u32 shift = addr & 3;" << std::endl;
             // Read the full 4-byte aligned word from memory
@@ -2118,8 +2192,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             out_file << "    u32 data = mem << (24 - (shift * 8));" << std::endl;
             // Merge the new data with the preserved part of the destination register
             // The result is then sign-extended into the 64-bit GPR.
-            out_file << "    u32 result = (context.cpuRegs.GPR.r[" << dest_index << "].UL[0] & mask) | data;" << std::endl;
-            out_file << "    context.cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)(s32)result;" << std::endl;
+            out_file << "    u32 result = (ctx->cpuRegs.GPR.r[" << dest_index << "].UL[0] & mask) | data;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)(s32)result;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -2135,7 +2209,7 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
 
             // Generate the C++ code for the unaligned load logic
             out_file << "{" << std::endl;
-            out_file << "    u32 addr = (u32)context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u32 addr = (u32)ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
             // 'shift' is how many bytes we are into the 4-byte aligned block
             out_file << "    u32 shift = addr & 3;" << std::endl;
             // Read the full 4-byte aligned word from memory
@@ -2146,8 +2220,8 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             out_file << "    u32 data = mem >> (shift * 8);" << std::endl;
             // Merge the new data with the preserved part of the destination register
             // The result is then sign-extended into the 64-bit GPR.
-            out_file << "    u32 result = (context.cpuRegs.GPR.r[" << dest_index << "].UL[0] & mask) | data;" << std::endl;
-            out_file << "    context.cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)(s32)result;" << std::endl;
+            out_file << "    u32 result = (ctx->cpuRegs.GPR.r[" << dest_index << "].UL[0] & mask) | data;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << dest_index << "].SD[0] = (s64)(s32)result;" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -2161,10 +2235,10 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
 
             out_file << "{" << std::endl;
-            out_file << "    u32 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u32 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
             // LWU zero-extends the 32-bit memory value into the 64-bit register.
             // Casting the u32 result of ReadMemory32 to u64 achieves this.
-            out_file << "    context.cpuRegs.GPR.r[" << dest_index << "].UD[0] = (u64)ReadMemory32(address);" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << dest_index << "].UD[0] = (u64)" << read_call(4, base_index, offset) << ";" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -2178,11 +2252,11 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
 
             out_file << "{" << std::endl;
-            out_file << "    u32 address = context.cpuRegs.GPR.r[" << base_index << "].UL[0] + " << offset << ";" << std::endl;
+            out_file << "    u32 address = ctx->cpuRegs.GPR.r[" << base_index << "].UL[0] + " << offset << ";" << std::endl;
             out_file << "    u32 shift = address & 3;" << std::endl;
             out_file << "    u32 aligned_address = address & ~3;" << std::endl;
             out_file << "    u32 mem = ReadMemory32(aligned_address);" << std::endl;
-            out_file << "    u32 reg_val = context.cpuRegs.GPR.r[" << rt_index << "].UL[0];" << std::endl;
+            out_file << "    u32 reg_val = ctx->cpuRegs.GPR.r[" << rt_index << "].UL[0];" << std::endl;
             out_file << "    switch (shift) {" << std::endl;
             out_file << "        case 0: WriteMemory32(aligned_address, (mem & 0xFFFFFF00) | (reg_val >> 24)); break;" << std::endl;
             out_file << "        case 1: WriteMemory32(aligned_address, (mem & 0xFFFF0000) | (reg_val >> 16)); break;" << std::endl;
@@ -2203,11 +2277,11 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
                     
             out_file << "{" << std::endl;
-            out_file << "    u32 address = context.cpuRegs.GPR.r[" << base_index << "].UL[0] + " << offset << ";" << std::endl;
+            out_file << "    u32 address = ctx->cpuRegs.GPR.r[" << base_index << "].UL[0] + " << offset << ";" << std::endl;
             out_file << "    u32 shift = address & 3;" << std::endl;
             out_file << "    u32 aligned_address = address & ~3;" << std::endl;
             out_file << "    u32 mem = ReadMemory32(aligned_address);" << std::endl;
-            out_file << "    u32 reg_val = context.cpuRegs.GPR.r[" << rt_index << "].UL[0];" << std::endl;
+            out_file << "    u32 reg_val = ctx->cpuRegs.GPR.r[" << rt_index << "].UL[0];" << std::endl;
             out_file << "    switch (shift) {" << std::endl;
             out_file << "        case 0: WriteMemory32(aligned_address, reg_val); break;" << std::endl;
             out_file << "        case 1: WriteMemory32(aligned_address, (mem & 0x000000FF) | (reg_val << 8)); break;" << std::endl;
@@ -2227,11 +2301,11 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
 
             out_file << "{" << std::endl;
-            out_file << "    u64 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u64 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
             out_file << "    u64 shift = address & 7;" << std::endl;
             out_file << "    u64 aligned_address = address & ~7;" << std::endl;
             out_file << "    u64 mem = ReadMemory64(aligned_address);" << std::endl;
-            out_file << "    u64 reg_val = context.cpuRegs.GPR.r[" << rt_index << "].UD[0];" << std::endl;
+            out_file << "    u64 reg_val = ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0];" << std::endl;
             out_file << "    switch (shift) {" << std::endl;
             out_file << "        case 0: WriteMemory64(aligned_address, (mem & 0xFFFFFFFFFFFFFF00ULL) | (reg_val >> 56)); break;" << std::endl;
             out_file << "        case 1: WriteMemory64(aligned_address, (mem & 0xFFFFFFFFFFFF0000ULL) | (reg_val >> 48)); break;" << std::endl;
@@ -2256,11 +2330,11 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
                     
             out_file << "{" << std::endl;
-            out_file << "    u64 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u64 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
             out_file << "    u64 shift = address & 7;" << std::endl;
             out_file << "    u64 aligned_address = address & ~7;" << std::endl;
             out_file << "    u64 mem = ReadMemory64(aligned_address);" << std::endl;
-            out_file << "    u64 reg_val = context.cpuRegs.GPR.r[" << rt_index << "].UD[0];" << std::endl;
+            out_file << "    u64 reg_val = ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0];" << std::endl;
             out_file << "    switch (shift) {" << std::endl;
             out_file << "        case 0: WriteMemory64(aligned_address, reg_val); break;" << std::endl;
             out_file << "        case 1: WriteMemory64(aligned_address, (mem & 0xFF00000000000000ULL) | (reg_val << 8)); break;" << std::endl;
@@ -2298,14 +2372,14 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
 
             out_file << "{" << std::endl;
-            out_file << "    u64 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u64 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
             // LD requires the address to be 8-byte aligned.
             out_file << "    if (address & 7) {" << std::endl;
             out_file << "        std::cerr << \"FATAL ERROR: Unaligned memory access for LD at address: 0x\" << std::hex << address << std::endl;" << std::endl;
             out_file << "        exit(1);" << std::endl;
             out_file << "    }" << std::endl;
             // LD is a direct 64-bit load. No sign/zero extension is needed.
-            out_file << "    context.cpuRegs.GPR.r[" << rt_index << "].UD[0] = ReadMemory64(address);" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[" << rt_index << "].UD[0] = " << read_call(8, base_index, offset) << ";" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -2319,14 +2393,14 @@ void translate_instruction_block(std::ofstream& out_file, cs_insn* insn) {
             int base_index = get_gpr_index(base_capstone);
 
             out_file << "{" << std::endl;
-            out_file << "    u64 address = context.cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
+            out_file << "    u64 address = ctx->cpuRegs.GPR.r[" << base_index << "].UD[0] + " << offset << ";" << std::endl;
             // SD requires the address to be 8-byte aligned.
             out_file << "    if (address & 7) {" << std::endl;
             out_file << "        std::cerr << \"FATAL ERROR: Unaligned memory access for SD at address: 0x\" << std::hex << address << std::endl;" << std::endl;
             out_file << "        exit(1);" << std::endl;
             out_file << "    }" << std::endl;
             // SD is a direct 64-bit store. No truncation is needed.
-            out_file << "    WriteMemory64(address, context.cpuRegs.GPR.r[" << rt_index << "].UD[0]);" << std::endl;
+            out_file << "    " << write_call(8, base_index, offset, "ctx->cpuRegs.GPR.r[" + std::to_string(rt_index) + "].UD[0]") << ";" << std::endl;
             out_file << "}" << std::endl;
             break;
         }
@@ -2437,6 +2511,19 @@ std::vector<basic_block> collect_basic_blocks(cs_insn* insns, size_t count){
     return block_entries;
 }
 
+// Every R5900 instruction is 4 bytes.
+u32 block_code_size(const basic_block& block) {
+    return (u32)block.instructions.size() * 4;
+}
+
+u32 block_code_hash(const basic_block& block) {
+    std::vector<u8> bytes;
+    for (const cs_insn* insn : block.instructions) {
+        bytes.insert(bytes.end(), insn->bytes, insn->bytes + 4);
+    }
+    return code_hash(bytes.data(), (u32)bytes.size());
+}
+
 void generate_functions_from_block(const std::vector<basic_block>& blocks, std::ofstream& out_file){
     /*
         So this would be called after the function entries are collected
@@ -2446,27 +2533,63 @@ void generate_functions_from_block(const std::vector<basic_block>& blocks, std::
     */
     for(const auto& block : blocks){
 
-        out_file << "void func_" << std::hex << block.start_address << "(){"<<std::endl;
+        out_file << "void func_" << std::hex << block.start_address << "(EmotionEngineState* __restrict ctx){"<<std::endl;
 
+        // Self-modifying code: a write to one of the block's pages marks it dirty, and
+        // the original bytes are checked again before running the translation. If they
+        // changed, the modified code handler has run the new code in its place (see smc.h).
+        out_file << "    if (smc_range_dirty(0x" << block.start_address << ", " << std::dec << block_code_size(block)
+                 << ") && !smc_verify(*ctx, 0x" << std::hex << block.start_address << ", " << std::dec << block_code_size(block)
+                 << ", 0x" << std::hex << block_code_hash(block) << ")) return;" << std::endl;
 
+        // The whole block is charged at every exit; it is cheaper than keeping a running
+        // count and close enough, since blocks are short.
+        const u32 block_cycles = block_cycle_cost(block);
+        bool has_exit = false;
+        block_constants.reset();
         for(int i = 0; i < block.instructions.size() - 1; ++i){
 
+            // Every way out of the block (including backward branches, i.e. loops)
+            // goes through the event check first.
+            if(is_control_flow_instruction(*block.instructions[i])){
+                emit_block_exit(out_file, block_cycles);
+                has_exit = true;
+            }
+
             if(is_branch_likely(*block.instructions[i])){
                 if(i + 1 >= block.instructions.size()){
                     out_file << " // ERROR: Branch-likely at end of block" << std::endl;
                     return; 
                 }
                 translate_likely_instructions(out_file, block.instructions[i], block.instructions[i+1]);
+                block_constants.reset();
                 i++;
             }
             else{
                 translate_instruction_block(out_file, block.instructions[i]);
+                block_constants.update(*block.instructions[i]);
             }
         }
+        // Blocks cut short by the next entry point fall through to it.
+        if(!has_exit){
+            emit_block_exit(out_file, block_cycles);
+        }
         out_file << "}" << std::endl << std::endl;
     }
 }
 
+/*
+Emitted wherever control leaves a block. The block's static cost (see cycle_table.cpp)
+is added to cycle in one go, then the event check runs. Recompiled code never looks at
+individual timers or devices, it only compares cycle against nextEventCycle (kept up to
+date by the scheduler). The compare is on the signed difference so it keeps working when
+cycle wraps around.
+*/
+void emit_block_exit(std::ofstream& out_file, u32 cycles){
+    out_file << "    ctx->cpuRegs.cycle += " << std::to_string(cycles) << ";" << std::endl;
+    out_file << "    if ((s32)(ctx->cpuRegs.cycle - ctx->cpuRegs.nextEventCycle) >= 0) cpu_event_test(*ctx);" << std::endl;
+}
+
 
 u32 calculate_target(cs_insn& insn){
     u32 res = 0;
@@ -2585,16 +2708,16 @@ void translate_likely_instructions(std::ofstream& out_file, cs_insn* insn, cs_in
     
             /*
             
-            if (context.cpuRegs.GPR.r[rs_index].SD[0] < 0){
-                context.cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
+            if (ctx->cpuRegs.GPR.r[rs_index].SD[0] < 0){
+                ctx->cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
             }
             else{
-                context.cpuRegs.GPR.pc = insn->address + 8;
+                ctx->cpuRegs.GPR.pc = insn->address + 8;
             }
             */
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] == (s64)context.cpuRegs.GPR.r[" << rt_index << "].SD[0]) {" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] == (s64)ctx->cpuRegs.GPR.r[" << rt_index << "].SD[0]) {" << std::endl;
             translate_instruction_block(out_file, delay_slot_insn);
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -2613,16 +2736,16 @@ void translate_likely_instructions(std::ofstream& out_file, cs_insn* insn, cs_in
     
             /*
             
-            if (context.cpuRegs.GPR.r[rs_index].SD[0] < 0){
-                context.cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
+            if (ctx->cpuRegs.GPR.r[rs_index].SD[0] < 0){
+                ctx->cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
             }
             else{
-                context.cpuRegs.GPR.pc = insn->address + 8;
+                ctx->cpuRegs.GPR.pc = insn->address + 8;
             }
             */
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] != (s64)context.cpuRegs.GPR.r[" << rt_index << "].SD[0]) {" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] != (s64)ctx->cpuRegs.GPR.r[" << rt_index << "].SD[0]) {" << std::endl;
             translate_instruction_block(out_file, delay_slot_insn);
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -2639,16 +2762,16 @@ void translate_likely_instructions(std::ofstream& out_file, cs_insn* insn, cs_in
     
             /*
             
-            if (context.cpuRegs.GPR.r[rs_index].SD[0] < 0){
-                context.cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
+            if (ctx->cpuRegs.GPR.r[rs_index].SD[0] < 0){
+                ctx->cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
             }
             else{
-                context.cpuRegs.GPR.pc = insn->address + 8;
+                ctx->cpuRegs.GPR.pc = insn->address + 8;
             }
             */
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] <= 0) {" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] <= 0) {" << std::endl;
             translate_instruction_block(out_file, delay_slot_insn);
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -2665,16 +2788,16 @@ void translate_likely_instructions(std::ofstream& out_file, cs_insn* insn, cs_in
     
             /*
             
-            if (context.cpuRegs.GPR.r[rs_index].SD[0] < 0){
-                context.cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
+            if (ctx->cpuRegs.GPR.r[rs_index].SD[0] < 0){
+                ctx->cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
             }
             else{
-                context.cpuRegs.GPR.pc = insn->address + 8;
+                ctx->cpuRegs.GPR.pc = insn->address + 8;
             }
             */
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] > 0) {" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] > 0) {" << std::endl;
             translate_instruction_block(out_file, delay_slot_insn);
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -2692,16 +2815,16 @@ void translate_likely_instructions(std::ofstream& out_file, cs_insn* insn, cs_in
     
             /*
             
-            if (context.cpuRegs.GPR.r[rs_index].SD[0] < 0){
-                context.cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
+            if (ctx->cpuRegs.GPR.r[rs_index].SD[0] < 0){
+                ctx->cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
             }
             else{
-                context.cpuRegs.GPR.pc = insn->address + 8;
+                ctx->cpuRegs.GPR.pc = insn->address + 8;
             }
             */
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] < 0) {" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] < 0) {" << std::endl;
             translate_instruction_block(out_file, delay_slot_insn);
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -2719,16 +2842,16 @@ void translate_likely_instructions(std::ofstream& out_file, cs_insn* insn, cs_in
     
             /*
             
-            if (context.cpuRegs.GPR.r[rs_index].SD[0] < 0){
-                context.cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
+            if (ctx->cpuRegs.GPR.r[rs_index].SD[0] < 0){
+                ctx->cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
             }
             else{
-                context.cpuRegs.GPR.pc = insn->address + 8;
+                ctx->cpuRegs.GPR.pc = insn->address + 8;
             }
             */
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] >= 0) {" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] >= 0) {" << std::endl;
             translate_instruction_block(out_file, delay_slot_insn);
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -2743,19 +2866,19 @@ void translate_likely_instructions(std::ofstream& out_file, cs_insn* insn, cs_in
     
             int rs_index = get_gpr_index(rs_reg);
             u32 target = calculate_target(*insn);
-            out_file << "context.cpuRegs.GPR.r[31] = "<< insn->address <<" + 8;" << std::endl;
+            out_file << "ctx->cpuRegs.GPR.r[31] = "<< insn->address <<" + 8;" << std::endl;
             /*
             
-            if (context.cpuRegs.GPR.r[rs_index].SD[0] < 0){
-                context.cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
+            if (ctx->cpuRegs.GPR.r[rs_index].SD[0] < 0){
+                ctx->cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
             }
             else{
-                context.cpuRegs.GPR.pc = insn->address + 8;
+                ctx->cpuRegs.GPR.pc = insn->address + 8;
             }
             */
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] < 0) {" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] < 0) {" << std::endl;
             translate_instruction_block(out_file, delay_slot_insn);
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -2770,19 +2893,19 @@ void translate_likely_instructions(std::ofstream& out_file, cs_insn* insn, cs_in
     
             int rs_index = get_gpr_index(rs_reg);
             u32 target = calculate_target(*insn);
-            out_file << "    context.cpuRegs.GPR.r[31] = "<< insn->address <<" + 8;" << std::endl;
+            out_file << "    ctx->cpuRegs.GPR.r[31] = "<< insn->address <<" + 8;" << std::endl;
             /*
             
-            if (context.cpuRegs.GPR.r[rs_index].SD[0] < 0){
-                context.cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
+            if (ctx->cpuRegs.GPR.r[rs_index].SD[0] < 0){
+                ctx->cpuRegs.GPR.pc = insn->address + 4 + (offset << 2);
             }
             else{
-                context.cpuRegs.GPR.pc = insn->address + 8;
+                ctx->cpuRegs.GPR.pc = insn->address + 8;
             }
             */
-            out_file << "    if ((s64)context.cpuRegs.GPR.r[" << rs_index << "].SD[0] >= 0) {" << std::endl;
+            out_file << "    if ((s64)ctx->cpuRegs.GPR.r[" << rs_index << "].SD[0] >= 0) {" << std::endl;
             translate_instruction_block(out_file, delay_slot_insn);
-            out_file << "        func_0x" << std::hex << target << "();" << std::endl;
+            out_file << "        func_0x" << std::hex << target << "(ctx);" << std::endl;
             out_file << "        return;" << std::endl;
             out_file << "    }" << std::endl;
             break;
@@ -30,9 +30,15 @@ std::set<uint64_t> collect_function_entries(cs_insn* insns, size_t count);
 
 std::vector<basic_block> collect_basic_blocks(cs_insn* insns, size_t count);
 
+// Size in bytes and code_hash() (see smc.h) of the instructions a block was generated
+// from, for the self-modifying code check at the top of each generated function.
+u32 block_code_size(const basic_block& block);
+u32 block_code_hash(const basic_block& block);
+
 void generate_functions_from_block(const std::vector<basic_block>& blocks, std::ofstream& out_file);
 void translate_instruction_block(std::ofstream& out_file, cs_insn* insn);
 void translate_likely_instructions(std::ofstream& out_file, cs_insn* branch_insn, cs_insn* delay_slot_insn);
+void emit_block_exit(std::ofstream& out_file, u32 cycles);
 
 int get_gpr_index(mips_reg capstone_reg);
 
@@ -1,7 +1,13 @@
 
 #include "gtest/gtest.h"
 #include "recompiler.h"
+#include "cycle_table.h"
+#include "known_constants.h"
+#include "smc.h"
 #include <cstring> // For memset
+#include <cstdio>
+#include <iterator>
+#include <sstream>
 
 // Mock cs_insn and cs_detail for testing
 // This allows us to create fake instructions without real disassembly
@@ -9,8 +15,9 @@ void setup_mock_instruction(cs_insn& insn, cs_detail& detail, mips_insn id, uint
     insn.id = id;
     insn.address = address;
     insn.detail = &detail;
-    // Zero out detail to avoid garbage data in tests
+    // Zero out detail and the encoding to avoid garbage data in tests
     memset(&detail, 0, sizeof(cs_detail));
+    memset(insn.bytes, 0, sizeof(insn.bytes));
 }
 
 // Test suite for GPR index mapping
@@ -231,3 +238,336 @@ TEST(BlockCollection, CorrectlyIdentifiesSyscallWrapperBlocks) {
     EXPECT_EQ(blocks[3].end_address,   0x23C);
     EXPECT_EQ(blocks[3].instructions.size(), 4);
 }
+
+TEST(CodeGeneration, EventCheckEmittedAtBlockExit) {
+    // nop; jr ra; nop
+    const size_t num_insns = 3;
+    cs_insn insns[num_insns];
+    cs_detail details[num_insns];
+    setup_mock_instruction(insns[0], details[0], MIPS_INS_NOP, 0x100);
+    setup_mock_instruction(insns[1], details[1], MIPS_INS_JR, 0x104);
+    details[1].groups[0] = CS_GRP_JUMP;
+    details[1].groups_count = 1;
+    details[1].mips.op_count = 1;
+    details[1].mips.operands[0].type = MIPS_OP_REG;
+    details[1].mips.operands[0].reg = MIPS_REG_RA;
+    setup_mock_instruction(insns[2], details[2], MIPS_INS_NOP, 0x108);
+
+    std::vector<basic_block> blocks = collect_basic_blocks(insns, num_insns);
+    const char* path = "event_check_test.cpp";
+    {
+        std::ofstream out(path);
+        generate_functions_from_block(blocks, out);
+    }
+    std::ifstream in(path);
+    std::string code((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::remove(path);
+
+    // Exactly one check, and it comes before the jump leaves the block.
+    const size_t check = code.find("cpu_event_test(*ctx)");
+    ASSERT_NE(check, std::string::npos);
+    EXPECT_EQ(code.find("cpu_event_test(*ctx)", check + 1), std::string::npos);
+    EXPECT_LT(check, code.find("host_dispatch_jump"));
+
+    // The block's cost is charged right before the check: nop + jr + nop = 1 + 2 + 1.
+    const size_t charge = code.find("ctx->cpuRegs.cycle += 4;");
+    ASSERT_NE(charge, std::string::npos);
+    EXPECT_LT(charge, check);
+}
+
+TEST(CodeGeneration, ContextIsPassedThroughEveryCall) {
+    // nop; jr ra; nop
+    const size_t num_insns = 3;
+    cs_insn insns[num_insns];
+    cs_detail details[num_insns];
+    setup_mock_instruction(insns[0], details[0], MIPS_INS_NOP, 0x100);
+    setup_mock_instruction(insns[1], details[1], MIPS_INS_JR, 0x104);
+    details[1].groups[0] = CS_GRP_JUMP;
+    details[1].groups_count = 1;
+    details[1].mips.op_count = 1;
+    details[1].mips.operands[0].type = MIPS_OP_REG;
+    details[1].mips.operands[0].reg = MIPS_REG_RA;
+    setup_mock_instruction(insns[2], details[2], MIPS_INS_NOP, 0x108);
+
+    std::vector<basic_block> blocks = collect_basic_blocks(insns, num_insns);
+    const char* path = "context_abi_test.cpp";
+    {
+        std::ofstream out(path);
+        generate_functions_from_block(blocks, out);
+    }
+    std::ifstream in(path);
+    std::string code((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::remove(path);
+
+    // The state comes in as a restrict pointer and goes out with the jump; the global
+    // is never referenced.
+    EXPECT_NE(code.find("void func_100(EmotionEngineState* __restrict ctx){"), std::string::npos);
+    EXPECT_NE(code.find("host_dispatch_jump(ctx, ctx->cpuRegs.GPR.r["), std::string::npos);
+    EXPECT_EQ(code.find("context"), std::string::npos);
+}
+
+TEST(CycleAccounting, BlockCostUsesLatencyTable) {
+    // 1. Arrange: lw; mult; div; fpu div (div.s $f0, ...); jr
+    const size_t num_insns = 5;
+    cs_insn insns[num_insns];
+    cs_detail details[num_insns];
+    setup_mock_instruction(insns[0], details[0], MIPS_INS_LW, 0x100);
+    setup_mock_instruction(insns[1], details[1], MIPS_INS_MULT, 0x104);
+    setup_mock_instruction(insns[2], details[2], MIPS_INS_DIV, 0x108);
+    setup_mock_instruction(insns[3], details[3], MIPS_INS_DIV, 0x10C);
+    details[3].mips.op_count = 1;
+    details[3].mips.operands[0].type = MIPS_OP_REG;
+    details[3].mips.operands[0].reg = MIPS_REG_F0;
+    setup_mock_instruction(insns[4], details[4], MIPS_INS_JR, 0x110);
+
+    basic_block block;
+    block.start_address = 0x100;
+    block.end_address = 0x110;
+    for (size_t i = 0; i < num_insns; ++i) {
+        block.instructions.push_back(&insns[i]);
+    }
+
+    // 2. Act
+    const u32 unscaled = block_cycle_cost(block);
+    cycle_scale = 2.0;
+    const u32 scaled = block_cycle_cost(block);
+    cycle_scale = 0.01;
+    const u32 floored = block_cycle_cost(block);
+    cycle_scale = 1.0;
+
+    // 3. Assert: 2 + 4 + 37 + 8 + 2
+    EXPECT_EQ(instruction_cycles(insns[2]), 37u);
+    EXPECT_EQ(instruction_cycles(insns[3]), 8u);
+    EXPECT_EQ(unscaled, 53u);
+    EXPECT_EQ(scaled, 106u);
+    EXPECT_EQ(floored, 1u);
+}
+
+TEST(CycleAccounting, Cop2IsClassifiedByEncoding) {
+    // 1. Arrange: vadd.xyzw vf1, vf2, vf3; qmfc2 t0, vf1; and an undecodable word
+    const u32 words[] = { 0x4BE31068, 0x48280800, 0xEC000000 };
+    const mips_insn ids[] = { MIPS_INS_INVALID, MIPS_INS_DMFC2, MIPS_INS_INVALID };
+    cs_insn insns[3];
+    cs_detail details[3];
+    for (size_t i = 0; i < 3; ++i) {
+        setup_mock_instruction(insns[i], details[i], ids[i], 0x100 + i * 4);
+        memcpy(insns[i].bytes, &words[i], 4);
+    }
+
+    // 2. Act / 3. Assert: only the macro op pays for VU0 arithmetic.
+    EXPECT_EQ(instruction_cycles(insns[0]), 4u);
+    EXPECT_EQ(instruction_cycles(insns[1]), 1u);
+    EXPECT_EQ(instruction_cycles(insns[2]), 1u);
+}
+
+TEST(ScratchpadClassification, ConstantBasesAccessTheBufferDirectly) {
+    // 1. Arrange: lui t0, 0x7000; lw t1, 0x10(t0); addu t0, t0, t2; sw t1, 0x20(t0); jr ra; nop
+    const size_t num_insns = 6;
+    cs_insn insns[num_insns];
+    cs_detail details[num_insns];
+    setup_mock_instruction(insns[0], details[0], MIPS_INS_LUI, 0x100);
+    details[0].mips.op_count = 2;
+    details[0].mips.operands[0].type = MIPS_OP_REG;
+    details[0].mips.operands[0].reg = MIPS_REG_T0;
+    details[0].mips.operands[1].type = MIPS_OP_IMM;
+    details[0].mips.operands[1].imm = 0x7000;
+    setup_mock_instruction(insns[1], details[1], MIPS_INS_LW, 0x104);
+    details[1].mips.op_count = 2;
+    details[1].mips.operands[0].type = MIPS_OP_REG;
+    details[1].mips.operands[0].reg = MIPS_REG_T1;
+    details[1].mips.operands[1].type = MIPS_OP_MEM;
+    details[1].mips.operands[1].mem.base = MIPS_REG_T0;
+    details[1].mips.operands[1].mem.disp = 0x10;
+    setup_mock_instruction(insns[2], details[2], MIPS_INS_ADDU, 0x108);
+    details[2].mips.op_count = 3;
+    details[2].mips.operands[0].type = MIPS_OP_REG;
+    details[2].mips.operands[0].reg = MIPS_REG_T0;
+    details[2].mips.operands[1].type = MIPS_OP_REG;
+    details[2].mips.operands[1].reg = MIPS_REG_T0;
+    details[2].mips.operands[2].type = MIPS_OP_REG;
+    details[2].mips.operands[2].reg = MIPS_REG_T2;
+    setup_mock_instruction(insns[3], details[3], MIPS_INS_SW, 0x10C);
+    details[3].mips.op_count = 2;
+    details[3].mips.operands[0].type = MIPS_OP_REG;
+    details[3].mips.operands[0].reg = MIPS_REG_T1;
+    details[3].mips.operands[1].type = MIPS_OP_MEM;
+    details[3].mips.operands[1].mem.base = MIPS_REG_T0;
+    details[3].mips.operands[1].mem.disp = 0x20;
+    setup_mock_instruction(insns[4], details[4], MIPS_INS_JR, 0x110);
+    details[4].groups[0] = CS_GRP_JUMP;
+    details[4].groups_count = 1;
+    details[4].mips.op_count = 1;
+    details[4].mips.operands[0].type = MIPS_OP_REG;
+    details[4].mips.operands[0].reg = MIPS_REG_RA;
+    setup_mock_instruction(insns[5], details[5], MIPS_INS_NOP, 0x114);
+
+    // 2. Act
+    std::vector<basic_block> blocks = collect_basic_blocks(insns, num_insns);
+    const char* path = "scratchpad_test.cpp";
+    {
+        std::ofstream out(path);
+        generate_functions_from_block(blocks, out);
+    }
+    std::ifstream in(path);
+    std::string code((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::remove(path);
+
+    // 3. Assert: the load goes straight to the buffer; after t0 += t2 the store can't
+    // be proven and keeps the generic path.
+    EXPECT_NE(code.find("ReadScratchpad<u32>(16)"), std::string::npos);
+    EXPECT_EQ(code.find("ReadMemory32(address)"), std::string::npos);
+    EXPECT_NE(code.find("WriteMemory32(address, "), std::string::npos);
+}
+
+TEST(ScratchpadClassification, RangeIsChecked) {
+    KnownConstants constants;
+    cs_insn insn;
+    cs_detail detail;
+    setup_mock_instruction(insn, detail, MIPS_INS_LUI);
+    detail.mips.op_count = 2;
+    detail.mips.operands[0].type = MIPS_OP_REG;
+    detail.mips.operands[0].reg = MIPS_REG_A0;
+    detail.mips.operands[1].type = MIPS_OP_IMM;
+    detail.mips.operands[1].imm = 0x7000;
+    constants.update(insn);
+
+    u32 offset = 0;
+    EXPECT_TRUE(scratchpad_offset(constants, 4, 0x3FFC, 4, offset));
+    EXPECT_EQ(offset, 0x3FFCu);
+    EXPECT_FALSE(scratchpad_offset(constants, 4, 0x3FFD, 4, offset));
+    EXPECT_FALSE(scratchpad_offset(constants, 4, -4, 4, offset));
+    EXPECT_FALSE(scratchpad_offset(constants, 5, 0, 4, offset));     // a1 unknown
+}
+
+TEST(MmioClassification, ConstantRegisterAccessCallsHandlerDirectly) {
+    // 1. Arrange: lui t0, 0x1001; lw t1, -0x1ff0(t0) (D_STAT); sw t1, -0x1ff0(t0); jr ra; nop
+    const size_t num_insns = 5;
+    cs_insn insns[num_insns];
+    cs_detail details[num_insns];
+    setup_mock_instruction(insns[0], details[0], MIPS_INS_LUI, 0x100);
+    details[0].mips.op_count = 2;
+    details[0].mips.operands[0].type = MIPS_OP_REG;
+    details[0].mips.operands[0].reg = MIPS_REG_T0;
+    details[0].mips.operands[1].type = MIPS_OP_IMM;
+    details[0].mips.operands[1].imm = 0x1001;
+    setup_mock_instruction(insns[1], details[1], MIPS_INS_LW, 0x104);
+    details[1].mips.op_count = 2;
+    details[1].mips.operands[0].type = MIPS_OP_REG;
+    details[1].mips.operands[0].reg = MIPS_REG_T1;
+    details[1].mips.operands[1].type = MIPS_OP_MEM;
+    details[1].mips.operands[1].mem.base = MIPS_REG_T0;
+    details[1].mips.operands[1].mem.disp = -0x1FF0;
+    setup_mock_instruction(insns[2], details[2], MIPS_INS_SW, 0x108);
+    details[2].mips = details[1].mips;
+    setup_mock_instruction(insns[3], details[3], MIPS_INS_JR, 0x10C);
+    details[3].groups[0] = CS_GRP_JUMP;
+    details[3].groups_count = 1;
+    details[3].mips.op_count = 1;
+    details[3].mips.operands[0].type = MIPS_OP_REG;
+    details[3].mips.operands[0].reg = MIPS_REG_RA;
+    setup_mock_instruction(insns[4], details[4], MIPS_INS_NOP, 0x110);
+
+    // 2. Act
+    std::vector<basic_block> blocks = collect_basic_blocks(insns, num_insns);
+    const char* path = "mmio_test.cpp";
+    {
+        std::ofstream out(path);
+        generate_functions_from_block(blocks, out);
+    }
+    std::ifstream in(path);
+    std::string code((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::remove(path);
+
+    // 3. Assert
+    EXPECT_NE(code.find("mmio_dmac_read32(*ctx, 0x1000e010)"), std::string::npos);
+    EXPECT_NE(code.find("mmio_dmac_write32(*ctx, 0x1000e010, "), std::string::npos);
+    EXPECT_EQ(code.find("ReadMemory32"), std::string::npos);
+}
+
+TEST(SyscallClassification, KnownNumberCallsTableEntryDirectly) {
+    // 1. Arrange: addiu v1, zero, -0x43 (iSignalSema); syscall; syscall; jr ra; nop
+    const size_t num_insns = 5;
+    cs_insn insns[num_insns];
+    cs_detail details[num_insns];
+    setup_mock_instruction(insns[0], details[0], MIPS_INS_ADDIU, 0x100);
+    details[0].mips.op_count = 3;
+    details[0].mips.operands[0].type = MIPS_OP_REG;
+    details[0].mips.operands[0].reg = MIPS_REG_V1;
+    details[0].mips.operands[1].type = MIPS_OP_REG;
+    details[0].mips.operands[1].reg = MIPS_REG_ZERO;
+    details[0].mips.operands[2].type = MIPS_OP_IMM;
+    details[0].mips.operands[2].imm = -0x43;
+    setup_mock_instruction(insns[1], details[1], MIPS_INS_SYSCALL, 0x104);
+    setup_mock_instruction(insns[2], details[2], MIPS_INS_SYSCALL, 0x108);
+    setup_mock_instruction(insns[3], details[3], MIPS_INS_JR, 0x10C);
+    details[3].groups[0] = CS_GRP_JUMP;
+    details[3].groups_count = 1;
+    details[3].mips.op_count = 1;
+    details[3].mips.operands[0].type = MIPS_OP_REG;
+    details[3].mips.operands[0].reg = MIPS_REG_RA;
+    setup_mock_instruction(insns[4], details[4], MIPS_INS_NOP, 0x110);
+
+    // 2. Act
+    std::vector<basic_block> blocks = collect_basic_blocks(insns, num_insns);
+    const char* path = "syscall_test.cpp";
+    {
+        std::ofstream out(path);
+        generate_functions_from_block(blocks, out);
+    }
+    std::ifstream in(path);
+    std::string code((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::remove(path);
+
+    // 3. Assert: the first call goes straight to the slot; the kernel may have changed
+    // $v1 by the second, which looks it up at runtime.
+    EXPECT_NE(code.find("syscall_table[0x43](*ctx);"), std::string::npos);
+    EXPECT_NE(code.find("cpu_syscall(*ctx);"), std::string::npos);
+    EXPECT_EQ(code.find("sys_handler"), std::string::npos);
+}
+
+TEST(SmcCheck, FunctionsVerifyTheirCodeOnEntry) {
+    // 1. Arrange: addiu v0, zero, 1; jr ra; nop
+    const size_t num_insns = 3;
+    cs_insn insns[num_insns];
+    cs_detail details[num_insns];
+    const u8 code[num_insns][4] = { { 0x01, 0x00, 0x02, 0x24 }, { 0x08, 0x00, 0xE0, 0x03 }, { 0, 0, 0, 0 } };
+    setup_mock_instruction(insns[0], details[0], MIPS_INS_ADDIU, 0x100);
+    details[0].mips.op_count = 3;
+    details[0].mips.operands[0].type = MIPS_OP_REG;
+    details[0].mips.operands[0].reg = MIPS_REG_V0;
+    details[0].mips.operands[1].type = MIPS_OP_REG;
+    details[0].mips.operands[1].reg = MIPS_REG_ZERO;
+    details[0].mips.operands[2].type = MIPS_OP_IMM;
+    details[0].mips.operands[2].imm = 1;
+    setup_mock_instruction(insns[1], details[1], MIPS_INS_JR, 0x104);
+    details[1].groups[0] = CS_GRP_JUMP;
+    details[1].groups_count = 1;
+    details[1].mips.op_count = 1;
+    details[1].mips.operands[0].type = MIPS_OP_REG;
+    details[1].mips.operands[0].reg = MIPS_REG_RA;
+    setup_mock_instruction(insns[2], details[2], MIPS_INS_NOP, 0x108);
+    for (size_t i = 0; i < num_insns; i++) {
+        insns[i].size = 4;
+        memcpy(insns[i].bytes, code[i], 4);
+    }
+
+    // 2. Act
+    std::vector<basic_block> blocks = collect_basic_blocks(insns, num_insns);
+    const char* path = "smc_test.cpp";
+    {
+        std::ofstream out(path);
+        generate_functions_from_block(blocks, out);
+    }
+    std::ifstream in(path);
+    std::string code_text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    std::remove(path);
+
+    // 3. Assert: the check comes first and covers every instruction of the block.
+    ASSERT_EQ(blocks.size(), 1u);
+    EXPECT_EQ(block_code_size(blocks[0]), 12u);
+    EXPECT_EQ(block_code_hash(blocks[0]), code_hash(&code[0][0], 12));
+    std::ostringstream expected;
+    expected << "void func_100(EmotionEngineState* __restrict ctx){\n    if (smc_range_dirty(0x100, 12) && !smc_verify(*ctx, 0x100, 12, 0x"
+             << std::hex << code_hash(&code[0][0], 12) << ")) return;\n";
+    EXPECT_EQ(code_text.rfind(expected.str(), 0), 0u);
+}